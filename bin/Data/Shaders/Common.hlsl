@@ -22,4 +22,39 @@
 #define pointClampSampler  4
 #define pointWrapSampler   5
 
+//Decoding of the compact vertex attributes, VertexCompression.h encodes them
+float3 DecodePosition(uint positionXY, uint positionZ, float3 positionOffset, float3 positionScale)
+{
+    float3 quantized = float3(positionXY & 0xFFFF, positionXY >> 16, positionZ & 0xFFFF);
+    return positionOffset + quantized * positionScale;
+}
+
+float3 DecodeOctahedral(uint packed)
+{
+    //snorm16 pair, sign extended by the arithmetic shift
+    float2 encoded = max(float2(asint(uint2(packed << 16, packed)) >> 16) / 32767.0f, -1.0f);
+    float3 n = float3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+    //the lower hemisphere is folded over the diagonals
+    float t = saturate(-n.z);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return normalize(n);
+}
+
+//xyz tangent, w bitangent sign
+float4 DecodeTangent(uint packed)
+{
+    return float4(DecodeOctahedral(packed), (packed & 0x10000) != 0 ? -1.0f : 1.0f);
+}
+
+float2 DecodeHalf2(uint packed)
+{
+    return float2(f16tof32(packed), f16tof32(packed >> 16));
+}
+
+float4 DecodeColor(uint packed)
+{
+    return float4(packed & 0xFF, (packed >> 8) & 0xFF, (packed >> 16) & 0xFF, packed >> 24) / 255.0f;
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,48 @@
+#include "Data/Shaders/Common.hlsl"
+
+//Frustum culling of the objects of an indirect draw, see IndirectDrawD3D12. CullIndirectDraws() does the same on the CPU.
+ConstantBuffer<IndirectCullConstants> CullConstantBuffer : register(b0, perPassSpace);
+RWStructuredBuffer<IndirectDrawCommand> DrawCommands : register(u0, perPassSpace);
+RWByteAddressBuffer DrawCount : register(u1, perPassSpace);
+
+[numthreads(64, 1, 1)]
+void ComputeShader(uint3 dispatchThreadId : SV_DispatchThreadID)
+{
+    uint objectIndex = dispatchThreadId.x;
+    if (objectIndex >= CullConstantBuffer.numObjects)
+    {
+        return;
+    }
+
+    StructuredBuffer<IndirectDrawObject> objectBuffer = ResourceDescriptorHeap[CullConstantBuffer.objectBufferIndex];
+    IndirectDrawObject object = objectBuffer[objectIndex];
+
+    //A box is culled when it lies completely behind one of the planes
+    bool inside = true;
+    for (uint plane = 0; plane < 6; plane++)
+    {
+        float4 frustumPlane = CullConstantBuffer.frustumPlanes[plane];
+        float distance = dot(frustumPlane.xyz, object.boundsCenter) + frustumPlane.w;
+        float radius = dot(abs(frustumPlane.xyz), object.boundsExtents);
+        inside = inside && distance + radius >= 0.0f;
+    }
+
+    if (!inside)
+    {
+        return;
+    }
+
+    //Appends in any order, the count is the argument count of ExecuteIndirect
+    uint commandIndex;
+    DrawCount.InterlockedAdd(0, 1, commandIndex);
+
+    IndirectDrawCommand command;
+    command.objectConstantsAddress = CullConstantBuffer.objectConstantsAddress + uint64_t(objectIndex) * INDIRECT_OBJECT_CONSTANTS_STRIDE;
+    command.indexCountPerInstance = object.indexCount;
+    command.instanceCount = 1;
+    command.startIndexLocation = object.startIndexLocation;
+    command.baseVertexLocation = object.baseVertexLocation;
+    command.startInstanceLocation = 0;
+    command.padding = 0;
+    DrawCommands[commandIndex] = command;
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+#include "Data/Shaders/Common.hlsl"
+
+//Mesh.hlsl with CompressedMeshVertex, the constants carry the bounds the positions are quantized to
+ConstantBuffer<CompressedMeshConstants> ObjectConstantBuffer : register(b0, perObjectSpace);
+ConstantBuffer<MeshPassConstants> PassConstantBuffer : register(b0, perPassSpace);
+
+struct VertexOutput
+{
+    float4 position : SV_POSITION;
+    float3 worldPosition : WORLD_POSITION;
+    float2 uv : TEXCOORD0;
+    float3 normal : NORMAL;
+};
+
+VertexOutput VertexShader(uint vertexId : SV_VertexID)
+{
+    ByteAddressBuffer vertexBuffer = ResourceDescriptorHeap[ObjectConstantBuffer.vertexBufferIndex];
+    CompressedMeshVertex vertex = vertexBuffer.Load<CompressedMeshVertex>(vertexId * sizeof(CompressedMeshVertex));
+
+    float3 position = DecodePosition(vertex.positionXY, vertex.positionZ, ObjectConstantBuffer.positionOffset, ObjectConstantBuffer.positionScale);
+
+    VertexOutput output;
+    output.position = mul(ObjectConstantBuffer.worldMatrix, float4(position, 1));
+    output.worldPosition = output.position.xyz;
+    output.position = mul(PassConstantBuffer.viewMatrix, output.position);
+    output.position = mul(PassConstantBuffer.projectionMatrix, output.position);
+    output.uv = DecodeHalf2(vertex.uv);
+    output.normal = mul(ObjectConstantBuffer.worldMatrix, float4(DecodeOctahedral(vertex.normal), 0)).xyz;
+
+    return output;
+}
+
+float4 PixelShader(VertexOutput input) : SV_TARGET
+{
+    //Similarly to the vertex buffer, we load the texture by indexing into the descriptor heap
+    Texture2D<float4> colorTexture = ResourceDescriptorHeap[ObjectConstantBuffer.textureIndex];
+
+    //We also index into the sampler heap to get the texture sampler we want
+    SamplerState anisoSampler = SamplerDescriptorHeap[anisoClampSampler];
+
+    //Apply some simple lighting
+    float3 color = colorTexture.Sample(anisoSampler, input.uv).rgb;
+    float3 lightDirection = normalize(PassConstantBuffer.cameraPosition);
+    float3 viewDirection = normalize(PassConstantBuffer.cameraPosition - input.worldPosition);
+
+    float3 halfVector = normalize(viewDirection + lightDirection);
+    float specular = pow(saturate(dot(halfVector, input.normal)), 8.0f);
+    float diffuse = saturate(dot(normalize(input.normal), lightDirection));
+
+    float3 lighting = color * (diffuse + specular);
+
+    return float4(lighting, 1);
+}
\ No newline at end of file
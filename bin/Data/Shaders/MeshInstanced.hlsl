@@ -0,0 +1,57 @@
+#include "Data/Shaders/Common.hlsl"
+
+//The batch constants point at the instances of one instanced draw, see InstanceBufferD3D12
+ConstantBuffer<InstanceBatchConstants> BatchConstantBuffer : register(b0, perObjectSpace);
+ConstantBuffer<MeshPassConstants> PassConstantBuffer : register(b0, perPassSpace);
+
+struct VertexOutput
+{
+    float4 position : SV_POSITION;
+    float3 worldPosition : WORLD_POSITION;
+    float2 uv : TEXCOORD0;
+    float3 normal : NORMAL;
+    nointerpolation uint textureIndex : TEXTURE_INDEX;
+};
+
+/*
+    SV_InstanceID counts from 0 in every draw and, like SV_VertexID with BaseVertexLocation, leaves out StartInstanceLocation,
+    there is no system generated value for it. The batch constants carry the first instance of the draw instead.
+*/
+VertexOutput VertexShader(uint vertexId : SV_VertexID, uint instanceId : SV_InstanceID)
+{
+    StructuredBuffer<MeshInstance> instanceBuffer = ResourceDescriptorHeap[BatchConstantBuffer.instanceBufferIndex];
+    MeshInstance instance = instanceBuffer[BatchConstantBuffer.firstInstance + instanceId];
+
+    ByteAddressBuffer vertexBuffer = ResourceDescriptorHeap[instance.vertexBufferIndex];
+    MeshVertex vertex = vertexBuffer.Load<MeshVertex>(vertexId * sizeof(MeshVertex));
+
+    VertexOutput output;
+    output.position = mul(instance.worldMatrix, float4(vertex.position, 1));
+    output.worldPosition = output.position.xyz;
+    output.position = mul(PassConstantBuffer.viewMatrix, output.position);
+    output.position = mul(PassConstantBuffer.projectionMatrix, output.position);
+    output.uv = vertex.uv;
+    output.normal = mul(instance.worldMatrix, float4(vertex.normal, 0)).xyz;
+    output.textureIndex = instance.textureIndex;
+
+    return output;
+}
+
+float4 PixelShader(VertexOutput input) : SV_TARGET
+{
+    //The instances of a draw may use different textures, the index is the same for all pixels of a triangle
+    Texture2D<float4> colorTexture = ResourceDescriptorHeap[NonUniformResourceIndex(input.textureIndex)];
+    SamplerState anisoSampler = SamplerDescriptorHeap[anisoClampSampler];
+
+    float3 color = colorTexture.Sample(anisoSampler, input.uv).rgb;
+    float3 lightDirection = normalize(PassConstantBuffer.cameraPosition);
+    float3 viewDirection = normalize(PassConstantBuffer.cameraPosition - input.worldPosition);
+
+    float3 halfVector = normalize(viewDirection + lightDirection);
+    float specular = pow(saturate(dot(halfVector, input.normal)), 8.0f);
+    float diffuse = saturate(dot(normalize(input.normal), lightDirection));
+
+    float3 lighting = color * (diffuse + specular);
+
+    return float4(lighting, 1);
+}
\ No newline at end of file
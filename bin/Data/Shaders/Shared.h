@@ -9,6 +9,14 @@
 #define Vector3  float3
 #define Vector4  float4
 #define Matrix   float4x4
+#else
+//The engine includes this file for the constants below, the structs are in a namespace of their own
+namespace hlsl
+{
+using Vector2 = glm::vec2;
+using Vector3 = glm::vec3;
+using Vector4 = glm::vec4;
+using Matrix  = glm::mat4;
 #endif
 
 struct TriangleVertex
@@ -29,6 +37,15 @@ struct MeshVertex
     Vector3 normal;
 };
 
+//MeshVertex in 16 bytes, see VertexCompression.h and the Decode helpers in Common.hlsl
+struct CompressedMeshVertex
+{
+    uint32_t positionXY; //unorm16 x | y << 16, relative to the mesh bounds
+    uint32_t positionZ;  //unorm16, the high half is free
+    uint32_t normal;     //octahedral snorm16 x | y << 16
+    uint32_t uv;         //half x | y << 16
+};
+
 struct MeshConstants
 {
     Matrix worldMatrix;
@@ -36,6 +53,84 @@ struct MeshConstants
     uint32_t textureIndex;
 };
 
+//position = positionOffset + unorm16 position * positionScale
+struct CompressedMeshConstants
+{
+    Matrix worldMatrix;
+    Vector3 positionOffset;
+    uint32_t vertexBufferIndex;
+    Vector3 positionScale;
+    uint32_t textureIndex;
+};
+
+struct MeshInstance
+{
+    Matrix worldMatrix;
+    uint32_t vertexBufferIndex;
+    uint32_t textureIndex;
+    uint32_t padding0;
+    uint32_t padding1;
+};
+
+struct InstanceBatchConstants
+{
+    uint32_t instanceBufferIndex; //StructuredBuffer<MeshInstance>
+    uint32_t firstInstance;
+};
+
+struct IndirectDrawObject
+{
+    Vector3 boundsCenter;
+    uint32_t indexCount;
+    Vector3 boundsExtents;
+    uint32_t startIndexLocation;
+    int32_t baseVertexLocation;
+    uint32_t padding0;
+    uint32_t padding1;
+    uint32_t padding2;
+};
+
+//Root CBV address and D3D12_DRAW_INDEXED_ARGUMENTS, the layout of the indirect command signature
+struct IndirectDrawCommand
+{
+    uint64_t objectConstantsAddress;
+    uint32_t indexCountPerInstance;
+    uint32_t instanceCount;
+    uint32_t startIndexLocation;
+    int32_t baseVertexLocation;
+    uint32_t startInstanceLocation;
+    uint32_t padding;
+};
+
+//Object i of the indirect draws has its constants at objectConstantsAddress + i * INDIRECT_OBJECT_CONSTANTS_STRIDE,
+//D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT
+static const uint32_t INDIRECT_OBJECT_CONSTANTS_STRIDE = 256;
+
+struct IndirectCullConstants
+{
+    Vector4 frustumPlanes[6];
+    uint64_t objectConstantsAddress;
+    uint32_t objectBufferIndex; //StructuredBuffer<IndirectDrawObject>
+    uint32_t numObjects;
+};
+
+//Meshlet vertex i is vertexIndices[vertexOffset + i], triangle j is triangles[triangleOffset + j] with three 8-bit meshlet vertex indices
+struct Meshlet
+{
+    uint32_t vertexOffset;
+    uint32_t triangleOffset;
+    uint32_t vertexCount;
+    uint32_t triangleCount;
+};
+
+//Cone culled when dot(center - cameraPosition, axis) >= cutoff * length(center - cameraPosition) + radius
+struct MeshletBounds
+{
+    Vector3 center;
+    float radius;
+    uint32_t normalCone; //axis xyz and cutoff, snorm8 each
+};
+
 struct MeshPassConstants
 {
     Matrix viewMatrix;
@@ -43,4 +138,8 @@ struct MeshPassConstants
     Vector3 cameraPosition;
 };
 
+#ifdef __cplusplus
+} // namespace hlsl
+#endif
+
 #endif
\ No newline at end of file
@@ -0,0 +1,39 @@
+﻿#include "Engine/BaseHeader.h"
+#include "Engine/Log.h"
+#include "Engine/LogSystem.h"
+#include "Engine/Profiler.h"
+#include "Game/BVHBenchmark.h"
+//=============================================================================
+// The benchmark samples run in EngineApp, this runs the BVH one without a window or a device, e.g. on Linux:
+//   cmake -S src -B build -DCMAKE_BUILD_TYPE=Release && cmake --build build --target BVHBenchmark && build/BVHBenchmark
+//=============================================================================
+namespace
+{
+	bool requestExit = false;
+}
+//=============================================================================
+// Fatal() of the engine log
+void RequestExit()
+{
+	requestExit = true;
+}
+//=============================================================================
+int main()
+{
+	LogSystem logSystem;
+	if (!logSystem.Create({})) return 1;
+
+	JobSystem jobSystem;
+	if (jobSystem.Create({}))
+	{
+		bvhBenchmark::Run(jobSystem);
+	}
+	else
+	{
+		requestExit = true;
+	}
+	jobSystem.Destroy();
+	logSystem.Destroy();
+	return requestExit ? 1 : 0;
+}
+//=============================================================================
@@ -0,0 +1,215 @@
+﻿#include "stdafx.h"
+#include "Cooker.h"
+#include <sstream>
+//=============================================================================
+namespace
+{
+	constexpr uint32_t MAX_PERMUTATION_BITS = 16;
+
+	struct ShaderFeature final
+	{
+		std::wstring define;
+		uint32_t     offset{ 0 };
+		uint32_t     numBits{ 1 };
+	};
+
+	std::wstring toWide(const std::string& str)
+	{
+		return std::wstring(str.begin(), str.end());
+	}
+
+	bool parseStage(const std::string& stage, std::wstring& target)
+	{
+		if (stage == "vs")      target = L"vs_6_6";
+		else if (stage == "ps") target = L"ps_6_6";
+		else if (stage == "cs") target = L"cs_6_6";
+		else return false;
+		return true;
+	}
+
+	bool parseShaderLine(std::istringstream& lineStream, const std::string& location, std::vector<CookJob>& jobs)
+	{
+		std::string file;
+		std::string entryPoint;
+		std::string stage;
+		if (!(lineStream >> file >> entryPoint >> stage))
+		{
+			printf("%s: expected 'shader <file> <entry point> <vs|ps|cs>'\n", location.c_str());
+			return false;
+		}
+
+		std::wstring target;
+		if (!parseStage(stage, target))
+		{
+			printf("%s: unknown shader stage '%s'\n", location.c_str(), stage.c_str());
+			return false;
+		}
+
+		std::vector<ShaderFeature> features;
+		uint32_t totalBits = 0;
+		std::string featureToken;
+		while (lineStream >> featureToken)
+		{
+			const size_t separator = featureToken.find(':');
+			ShaderFeature feature;
+			feature.define = toWide(featureToken.substr(0, separator));
+			feature.numBits = separator == std::string::npos ? 1 : static_cast<uint32_t>(strtoul(featureToken.c_str() + separator + 1, nullptr, 10));
+			feature.offset = totalBits;
+			totalBits += feature.numBits;
+			if (feature.numBits == 0 || feature.numBits > MAX_PERMUTATION_BITS)
+			{
+				printf("%s: invalid shader feature '%s'\n", location.c_str(), featureToken.c_str());
+				return false;
+			}
+			if (totalBits > MAX_PERMUTATION_BITS)
+			{
+				printf("%s: shader features use more than %u bits, that is too many permutations to cook\n", location.c_str(), MAX_PERMUTATION_BITS);
+				return false;
+			}
+			features.push_back(feature);
+		}
+
+		const uint64_t numPermutations = 1ull << totalBits;
+		for (uint64_t key = 0; key < numPermutations; key++)
+		{
+			CookJob job;
+			job.type = AssetType::shader;
+			job.sourcePath = file;
+			job.entryPoint = toWide(entryPoint);
+			job.target = target;
+
+			// must match ShaderPermutationSet::MakeVariantDesc()
+			std::wstring variantName;
+			if (!features.empty())
+			{
+				for (const ShaderFeature& feature : features)
+				{
+					const uint64_t value = (key >> feature.offset) & ((1ull << feature.numBits) - 1);
+					job.defines.push_back({ feature.define, std::to_wstring(value) });
+				}
+
+				char keyName[17]{};
+				snprintf(keyName, sizeof(keyName), "%016llX", static_cast<unsigned long long>(key));
+				variantName = toWide(keyName);
+			}
+
+			job.assetName = MakeShaderAssetName(toWide(file), job.entryPoint, variantName, MakeDefineArguments(job.defines));
+			jobs.push_back(std::move(job));
+		}
+
+		return true;
+	}
+}
+//=============================================================================
+bool ParseCookManifest(const CookerOptions& options, std::vector<CookJob>& jobs)
+{
+	std::ifstream file(options.manifestPath);
+	if (!file)
+	{
+		printf("Failed to open cook manifest %s\n", options.manifestPath.c_str());
+		return false;
+	}
+
+	std::string line;
+	uint32_t lineNumber = 0;
+	while (std::getline(file, line))
+	{
+		lineNumber++;
+		std::istringstream lineStream(line);
+		std::string kind;
+		if (!(lineStream >> kind) || kind[0] == '#')
+		{
+			continue;
+		}
+
+		const std::string location = options.manifestPath + "(" + std::to_string(lineNumber) + ")";
+		if (kind == "shader")
+		{
+			if (!parseShaderLine(lineStream, location, jobs)) return false;
+		}
+		else if (kind == "texture")
+		{
+			CookJob job;
+			job.type = AssetType::texture;
+			if (!(lineStream >> job.sourcePath))
+			{
+				printf("%s: expected 'texture <path>'\n", location.c_str());
+				return false;
+			}
+			job.assetName = MakeTextureAssetName(job.sourcePath);
+			jobs.push_back(std::move(job));
+		}
+		else
+		{
+			printf("%s: unknown asset kind '%s'\n", location.c_str(), kind.c_str());
+			return false;
+		}
+	}
+
+	return true;
+}
+//=============================================================================
+// <file> <entry point> <hex key> <vs|ps|cs> [<DEFINE>[=<value>] ...], the defines are the complete define set of the variant
+bool ParseShaderUsageList(const CookerOptions& options, std::vector<CookJob>& jobs)
+{
+	std::ifstream file(options.usageListPath);
+	if (!file)
+	{
+		// nothing was run yet
+		return true;
+	}
+
+	std::unordered_set<std::string> assetNames;
+	for (const CookJob& job : jobs)
+	{
+		assetNames.insert(job.assetName);
+	}
+
+	std::string line;
+	uint32_t lineNumber = 0;
+	while (std::getline(file, line))
+	{
+		lineNumber++;
+		std::istringstream lineStream(line);
+		std::string shaderFile;
+		std::string entryPoint;
+		std::string keyToken;
+		std::string stage;
+		if (!(lineStream >> shaderFile >> entryPoint >> keyToken))
+		{
+			continue;
+		}
+
+		CookJob job;
+		const std::string location = options.usageListPath + "(" + std::to_string(lineNumber) + ")";
+		if (!(lineStream >> stage) || !parseStage(stage, job.target))
+		{
+			// "<file> <entry point> <key>" lines of older lists have no stage, the next run writes them again
+			printf("%s: skipped, no shader stage\n", location.c_str());
+			continue;
+		}
+
+		std::string defineToken;
+		while (lineStream >> defineToken)
+		{
+			const size_t separator = defineToken.find('=');
+			job.defines.push_back({ toWide(defineToken.substr(0, separator)), separator == std::string::npos ? std::wstring() : toWide(defineToken.substr(separator + 1)) });
+		}
+
+		// must match ShaderPermutationSet::MakeVariantDesc()
+		char keyName[17]{};
+		snprintf(keyName, sizeof(keyName), "%016llX", strtoull(keyToken.c_str(), nullptr, 16));
+
+		job.type = AssetType::shader;
+		job.sourcePath = shaderFile;
+		job.entryPoint = toWide(entryPoint);
+		job.assetName = MakeShaderAssetName(toWide(shaderFile), job.entryPoint, toWide(keyName), MakeDefineArguments(job.defines));
+		if (assetNames.insert(job.assetName).second)
+		{
+			jobs.push_back(std::move(job));
+		}
+	}
+
+	return true;
+}
+//=============================================================================
@@ -0,0 +1,134 @@
+﻿#include "stdafx.h"
+#include "Cooker.h"
+//=============================================================================
+namespace
+{
+	bool computeSourceHash(const CookJob& job, const CookerOptions& options, uint64_t& hash)
+	{
+		if (job.type == AssetType::texture)
+		{
+			hash = HashAssetData(&COOKER_VERSION, sizeof(COOKER_VERSION));
+			hash = HashAssetData(job.assetName.data(), job.assetName.size(), hash);
+			return HashFile(job.sourcePath, hash);
+		}
+
+		// the runtime computes the same hash to find out whether the cooked shader is stale
+		return HashShaderSource(options.shaderPath, std::wstring(job.sourcePath.begin(), job.sourcePath.end()), job.entryPoint, job.target, MakeDefineArguments(job.defines), hash);
+	}
+
+	void cookWorker(const std::vector<CookJob>& jobs, const CookerOptions& options, const AssetPack& previousPack, std::atomic<size_t>& nextJob, std::vector<CookResult>& results)
+	{
+#if PLATFORM_WINDOWS
+		// WIC texture loading needs COM on every thread
+		const HRESULT comResult = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+#endif
+		std::unique_ptr<ShaderCompiler> shaderCompiler;
+
+		for (size_t jobIndex = nextJob++; jobIndex < jobs.size(); jobIndex = nextJob++)
+		{
+			const CookJob& job = jobs[jobIndex];
+			CookResult& result = results[jobIndex];
+
+			if (!computeSourceHash(job, options, result.sourceHash))
+			{
+				result.message = "Failed to read the sources of " + job.assetName;
+				continue;
+			}
+
+			const AssetPackEntry* previousEntry = previousPack.Find(job.assetName);
+			if (previousEntry && previousEntry->sourceHash == result.sourceHash && previousEntry->type == job.type)
+			{
+				const uint8_t* previousData = previousPack.GetData(*previousEntry);
+				result.data.assign(previousData, previousData + previousEntry->size);
+				result.succeeded = true;
+				result.upToDate = true;
+				continue;
+			}
+
+			if (job.type == AssetType::shader)
+			{
+				if (!shaderCompiler) shaderCompiler = std::make_unique<ShaderCompiler>();
+				result.succeeded = shaderCompiler->Compile(job, options, result.data, result.message);
+			}
+			else
+			{
+				result.succeeded = CookTexture(job, result.data, result.message);
+			}
+		}
+
+		shaderCompiler.reset();
+#if PLATFORM_WINDOWS
+		if (SUCCEEDED(comResult)) CoUninitialize();
+#endif
+	}
+}
+//=============================================================================
+bool RunCooker(const CookerOptions& options)
+{
+	std::vector<CookJob> jobs;
+	if (!ParseCookManifest(options, jobs) || !ParseShaderUsageList(options, jobs)) return false;
+
+	AssetPack previousPack;
+	if (!options.force && previousPack.Open(options.outputPath))
+	{
+		printf("Incremental cook against %s (%zu assets)\n", options.outputPath.c_str(), previousPack.GetEntries().size());
+	}
+
+	uint32_t numThreads = options.numThreads != 0 ? options.numThreads : std::max(1u, std::thread::hardware_concurrency());
+	numThreads = static_cast<uint32_t>(std::min<size_t>(numThreads, std::max<size_t>(jobs.size(), 1)));
+
+	std::vector<CookResult> results(jobs.size());
+	std::atomic<size_t> nextJob{ 0 };
+	std::vector<std::thread> workers;
+	for (uint32_t threadIndex = 0; threadIndex < numThreads; threadIndex++)
+	{
+		workers.emplace_back(cookWorker, std::cref(jobs), std::cref(options), std::cref(previousPack), std::ref(nextJob), std::ref(results));
+	}
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+
+	AssetPackWriter writer;
+	uint32_t numCooked = 0;
+	uint32_t numUpToDate = 0;
+	uint32_t numFailed = 0;
+	for (size_t jobIndex = 0; jobIndex < jobs.size(); jobIndex++)
+	{
+		const CookJob& job = jobs[jobIndex];
+		const CookResult& result = results[jobIndex];
+		if (!result.succeeded)
+		{
+			printf("FAILED %s\n%s\n", job.assetName.c_str(), result.message.c_str());
+			numFailed++;
+			continue;
+		}
+
+		if (result.upToDate)
+		{
+			numUpToDate++;
+		}
+		else
+		{
+			printf("Cooked %s\n", job.assetName.c_str());
+			numCooked++;
+		}
+		writer.AddAsset(job.assetName, job.type, result.sourceHash, result.data.data(), result.data.size());
+	}
+
+	printf("%u cooked, %u up to date, %u failed, %u threads\n", numCooked, numUpToDate, numFailed, numThreads);
+	if (numFailed != 0) return false;
+
+	// Nothing changed and no asset was removed from the manifest
+	if (numCooked == 0 && previousPack.GetEntries().size() == jobs.size()) return true;
+
+	previousPack.Close();
+	if (!writer.Write(options.outputPath))
+	{
+		printf("Failed to write %s\n", options.outputPath.c_str());
+		return false;
+	}
+
+	return true;
+}
+//=============================================================================
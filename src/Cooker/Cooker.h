@@ -0,0 +1,74 @@
+﻿#pragma once
+
+#include "Engine/AssetPack.h"
+
+struct CookerOptions final
+{
+	std::string manifestPath{ "Data/Cook.txt" };
+	std::string shaderPath{ "Data/Shaders/" };
+	std::string usageListPath{ SHADER_USAGE_LIST_PATH };
+	std::string outputPath{ COOKED_ASSET_PACK_PATH };
+	uint32_t    numThreads{ 0 }; // 0 - all hardware threads
+	bool        force{ false };  // ignore the previous pack and cook everything
+};
+
+struct ShaderDefineDesc final
+{
+	std::wstring name;
+	std::wstring value;
+};
+
+struct CookJob final
+{
+	AssetType                     type{ AssetType::shader };
+	std::string                   assetName;
+	std::string                   sourcePath;
+	// shader only
+	std::wstring                  entryPoint;
+	std::wstring                  target;
+	std::vector<ShaderDefineDesc> defines;
+};
+
+struct CookResult final
+{
+	bool                 succeeded{ false };
+	bool                 upToDate{ false };
+	uint64_t             sourceHash{ 0 };
+	std::vector<uint8_t> data;
+	std::string          message;
+};
+
+// Manifest lines:
+//	shader <file> <entry point> <vs|ps|cs> [<DEFINE>:<bits> ...]
+//	texture <path>
+// Shader features are packed into the permutation key in the listed order, the same way as ShaderFeatureField::Next() does at runtime,
+// and every combination is cooked.
+[[nodiscard]] bool ParseCookManifest(const CookerOptions& options, std::vector<CookJob>& jobs);
+
+// Usage list lines, as ShaderPermutationLibrary::SaveUsageList() writes them:
+//	<file> <entry point> <hex key> <vs|ps|cs> [<DEFINE>[=<value>] ...]
+// Adds a job per variant that the manifest does not cook already. A missing list is not an error.
+[[nodiscard]] bool ParseShaderUsageList(const CookerOptions& options, std::vector<CookJob>& jobs);
+
+// "NAME" or "NAME=value", as DXC gets them and as MakeShaderAssetName() and HashShaderSource() take them
+std::vector<std::wstring> MakeDefineArguments(const std::vector<ShaderDefineDesc>& defines);
+[[nodiscard]] bool HashFile(const std::filesystem::path& path, uint64_t& hash);
+
+// Each worker thread owns one ShaderCompiler, DXC compiler instances must not be shared between threads.
+class ShaderCompiler final
+{
+public:
+	ShaderCompiler();
+	~ShaderCompiler();
+
+	[[nodiscard]] bool Compile(const CookJob& job, const CookerOptions& options, std::vector<uint8_t>& dxil, std::string& errors);
+
+private:
+	IDxcUtils*          m_utils{ nullptr };
+	IDxcCompiler3*      m_compiler{ nullptr };
+	IDxcIncludeHandler* m_includeHandler{ nullptr };
+};
+
+[[nodiscard]] bool CookTexture(const CookJob& job, std::vector<uint8_t>& dds, std::string& errors);
+
+[[nodiscard]] bool RunCooker(const CookerOptions& options);
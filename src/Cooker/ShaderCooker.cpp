@@ -0,0 +1,136 @@
+﻿#include "stdafx.h"
+#include "Cooker.h"
+//=============================================================================
+namespace
+{
+	bool readFile(const std::filesystem::path& path, std::vector<uint8_t>& data)
+	{
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (!file) return false;
+
+		data.resize(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		return static_cast<bool>(file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size())));
+	}
+}
+//=============================================================================
+std::vector<std::wstring> MakeDefineArguments(const std::vector<ShaderDefineDesc>& defines)
+{
+	std::vector<std::wstring> arguments;
+	arguments.reserve(defines.size());
+	for (const ShaderDefineDesc& define : defines)
+	{
+		arguments.push_back(define.value.empty() ? define.name : define.name + L"=" + define.value);
+	}
+	return arguments;
+}
+//=============================================================================
+bool HashFile(const std::filesystem::path& path, uint64_t& hash)
+{
+	std::vector<uint8_t> data;
+	if (!readFile(path, data)) return false;
+
+	hash = HashAssetData(data.data(), data.size(), hash);
+	return true;
+}
+//=============================================================================
+ShaderCompiler::ShaderCompiler()
+{
+	DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&m_utils));
+	DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&m_compiler));
+	if (m_utils)
+	{
+		m_utils->CreateDefaultIncludeHandler(&m_includeHandler);
+	}
+}
+//=============================================================================
+ShaderCompiler::~ShaderCompiler()
+{
+	if (m_includeHandler) m_includeHandler->Release();
+	if (m_compiler) m_compiler->Release();
+	if (m_utils) m_utils->Release();
+}
+//=============================================================================
+bool ShaderCompiler::Compile(const CookJob& job, const CookerOptions& options, std::vector<uint8_t>& dxil, std::string& errors)
+{
+	if (!m_utils || !m_compiler || !m_includeHandler)
+	{
+		errors = "Failed to create the DXC compiler";
+		return false;
+	}
+
+	const std::filesystem::path sourcePath = std::filesystem::path(options.shaderPath) / job.sourcePath;
+	std::vector<uint8_t> source;
+	if (!readFile(sourcePath, source))
+	{
+		errors = "Failed to read " + sourcePath.generic_string();
+		return false;
+	}
+
+	DxcBuffer sourceBuffer{};
+	sourceBuffer.Ptr = source.data();
+	sourceBuffer.Size = source.size();
+	sourceBuffer.Encoding = DXC_CP_ACP;
+
+	// The source name the runtime compiles it under, the default include handler resolves the includes of the shader against the
+	// working directory the same way as in CreateShader()
+	const std::wstring sourceName(job.sourcePath.begin(), job.sourcePath.end());
+	const std::vector<std::wstring> defines = MakeDefineArguments(job.defines);
+
+	// Same arguments as CreateShader() at runtime, without debug info
+	std::vector<LPCWSTR> arguments;
+	arguments.push_back(sourceName.c_str());
+	arguments.push_back(L"-E");
+	arguments.push_back(job.entryPoint.c_str());
+	arguments.push_back(L"-T");
+	arguments.push_back(job.target.c_str());
+	arguments.push_back(L"-WX");
+	arguments.push_back(L"-Qstrip_reflect");
+	arguments.push_back(L"-Qstrip_debug");
+	for (const std::wstring& define : defines)
+	{
+		arguments.push_back(L"-D");
+		arguments.push_back(define.c_str());
+	}
+
+	IDxcResult* compilationResults = nullptr;
+	HRESULT result = m_compiler->Compile(&sourceBuffer, arguments.data(), static_cast<uint32_t>(arguments.size()), m_includeHandler, IID_PPV_ARGS(&compilationResults));
+	if (FAILED(result) || !compilationResults)
+	{
+		errors = "IDxcCompiler3::Compile() failed";
+		return false;
+	}
+
+	IDxcBlobUtf8* errorBlob = nullptr;
+	compilationResults->GetOutput(DXC_OUT_ERRORS, IID_PPV_ARGS(&errorBlob), nullptr);
+	if (errorBlob)
+	{
+		if (errorBlob->GetStringLength() != 0)
+		{
+			errors = errorBlob->GetStringPointer();
+		}
+		errorBlob->Release();
+	}
+
+	HRESULT status = E_FAIL;
+	compilationResults->GetStatus(&status);
+
+	IDxcBlob* shaderBlob = nullptr;
+	if (SUCCEEDED(status))
+	{
+		compilationResults->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&shaderBlob), nullptr);
+	}
+	compilationResults->Release();
+
+	if (!shaderBlob)
+	{
+		if (errors.empty()) errors = "Shader compilation failed";
+		return false;
+	}
+
+	const uint8_t* shaderData = static_cast<const uint8_t*>(shaderBlob->GetBufferPointer());
+	dxil.assign(shaderData, shaderData + shaderBlob->GetBufferSize());
+	shaderBlob->Release();
+	return true;
+}
+//=============================================================================
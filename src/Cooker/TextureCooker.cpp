@@ -0,0 +1,65 @@
+﻿#include "stdafx.h"
+#include "Cooker.h"
+//=============================================================================
+namespace
+{
+	std::string toLower(std::string str)
+	{
+		std::transform(str.begin(), str.end(), str.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+		return str;
+	}
+
+	HRESULT loadImage(const std::filesystem::path& path, DirectX::ScratchImage& image)
+	{
+		const std::string extension = toLower(path.extension().string());
+		const std::wstring widePath = path.wstring();
+
+		if (extension == ".dds") return DirectX::LoadFromDDSFile(widePath.c_str(), DirectX::DDS_FLAGS_NONE, nullptr, image);
+		if (extension == ".tga") return DirectX::LoadFromTGAFile(widePath.c_str(), nullptr, image);
+		if (extension == ".hdr") return DirectX::LoadFromHDRFile(widePath.c_str(), nullptr, image);
+#if PLATFORM_WINDOWS
+		// png, jpg, bmp, tiff... WIC is only available on Windows
+		return DirectX::LoadFromWICFile(widePath.c_str(), DirectX::WIC_FLAGS_NONE, nullptr, image);
+#else
+		return E_NOTIMPL;
+#endif
+	}
+}
+//=============================================================================
+bool CookTexture(const CookJob& job, std::vector<uint8_t>& dds, std::string& errors)
+{
+	DirectX::ScratchImage image;
+	HRESULT result = loadImage(job.sourcePath, image);
+	if (FAILED(result))
+	{
+		errors = "Failed to load texture " + job.sourcePath;
+		return false;
+	}
+
+	// The runtime uploads every mip level as stored, so generate the chain here instead of at load time
+	const DirectX::TexMetadata& metadata = image.GetMetadata();
+	if (metadata.mipLevels == 1 && !DirectX::IsCompressed(metadata.format) && metadata.dimension != DirectX::TEX_DIMENSION_TEXTURE3D && (metadata.width > 1 || metadata.height > 1))
+	{
+		DirectX::ScratchImage mipChain;
+		result = DirectX::GenerateMipMaps(image.GetImages(), image.GetImageCount(), metadata, DirectX::TEX_FILTER_DEFAULT, 0, mipChain);
+		if (FAILED(result))
+		{
+			errors = "Failed to generate mip maps for " + job.sourcePath;
+			return false;
+		}
+		image = std::move(mipChain);
+	}
+
+	DirectX::Blob blob;
+	result = DirectX::SaveToDDSMemory(image.GetImages(), image.GetImageCount(), image.GetMetadata(), DirectX::DDS_FLAGS_NONE, blob);
+	if (FAILED(result))
+	{
+		errors = "Failed to encode " + job.sourcePath + " as DDS";
+		return false;
+	}
+
+	const uint8_t* blobData = static_cast<const uint8_t*>(blob.GetBufferPointer());
+	dds.assign(blobData, blobData + blob.GetBufferSize());
+	return true;
+}
+//=============================================================================
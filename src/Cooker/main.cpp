@@ -0,0 +1,45 @@
+﻿#include "stdafx.h"
+#include "Cooker.h"
+//=============================================================================
+#if defined(_MSC_VER)
+#	pragma comment( lib, "Engine.lib" )
+#	pragma comment( lib, "3rdparty.lib" )
+#endif
+//=============================================================================
+void PrintUsage()
+{
+	printf(
+		"Usage: Cooker [options]\n"
+		"  --manifest <path>  list of assets to cook (default Data/Cook.txt)\n"
+		"  --shaders <path>   shader source directory (default Data/Shaders/)\n"
+		"  --usage <path>     shader variants used at runtime (default %s)\n"
+		"  --out <path>       output pack (default %s)\n"
+		"  --jobs <n>         number of worker threads (default: all cores)\n"
+		"  --force            ignore the previous pack and cook everything\n", SHADER_USAGE_LIST_PATH, COOKED_ASSET_PACK_PATH);
+}
+//=============================================================================
+int main(int argc, char* argv[])
+{
+	CookerOptions options;
+
+	for (int argIndex = 1; argIndex < argc; argIndex++)
+	{
+		const std::string arg = argv[argIndex];
+		const bool hasValue = argIndex + 1 < argc;
+
+		if (arg == "--manifest" && hasValue)     options.manifestPath = argv[++argIndex];
+		else if (arg == "--shaders" && hasValue) options.shaderPath = argv[++argIndex];
+		else if (arg == "--usage" && hasValue)   options.usageListPath = argv[++argIndex];
+		else if (arg == "--out" && hasValue)     options.outputPath = argv[++argIndex];
+		else if (arg == "--jobs" && hasValue)    options.numThreads = static_cast<uint32_t>(strtoul(argv[++argIndex], nullptr, 10));
+		else if (arg == "--force")               options.force = true;
+		else
+		{
+			PrintUsage();
+			return 2;
+		}
+	}
+
+	return RunCooker(options) ? 0 : 1;
+}
+//=============================================================================
@@ -0,0 +1,37 @@
+﻿#pragma once
+
+// The cooker does not use the engine base header, so that it builds without the D3D12 runtime headers (the cooker runs on CI machines, including Linux).
+#include "Engine/EngineConfigMacros.h"
+
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#if PLATFORM_WINDOWS
+#	define WIN32_LEAN_AND_MEAN
+#	define NOMINMAX
+#	include <Windows.h>
+#	include <objbase.h>
+#endif // PLATFORM_WINDOWS
+
+// On Linux dxcapi.h and WinAdapter.h come from the DirectXShaderCompiler release package (see CMakeLists.txt), DirectXTex needs the
+// DirectX-Headers package.
+#if PLATFORM_WINDOWS
+#	include <DirectXShaderCompiler/dxcapi.h>
+#else
+#	include <dxc/dxcapi.h>
+#endif
+#include <DirectXTex/DirectXTex.h>
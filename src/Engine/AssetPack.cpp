@@ -0,0 +1,264 @@
+﻿#include "stdafx.h"
+#include "AssetPack.h"
+#include <fstream>
+#include <filesystem>
+#include <unordered_set>
+//=============================================================================
+namespace
+{
+	template<typename T>
+	bool readValue(const std::vector<uint8_t>& data, uint64_t& cursor, T& value)
+	{
+		if (cursor + sizeof(T) > data.size()) return false;
+		memcpy(&value, data.data() + cursor, sizeof(T));
+		cursor += sizeof(T);
+		return true;
+	}
+
+	template<typename T>
+	void writeValue(std::ofstream& file, const T& value)
+	{
+		file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	std::string toAssetName(const std::wstring& str)
+	{
+		return std::string(str.begin(), str.end());
+	}
+
+	std::vector<std::wstring> sortDefines(const std::vector<std::wstring>& defines)
+	{
+		std::vector<std::wstring> sorted = defines;
+		std::sort(sorted.begin(), sorted.end());
+		return sorted;
+	}
+
+	bool readFile(const std::filesystem::path& path, std::vector<uint8_t>& data)
+	{
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (!file) return false;
+
+		data.resize(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		return static_cast<bool>(file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size())));
+	}
+
+	// includeDirectories: the directories of the including files, the innermost last
+	bool hashShaderSourceRecursive(const std::filesystem::path& sourcePath, std::vector<std::filesystem::path>& includeDirectories, uint64_t& hash,
+		std::unordered_set<std::string>& visited)
+	{
+		std::vector<uint8_t> source;
+		if (!readFile(sourcePath, source)) return false;
+		hash = HashAssetData(source.data(), source.size(), hash);
+
+		const std::string text(source.begin(), source.end());
+		size_t position = 0;
+		while ((position = text.find("#include", position)) != std::string::npos)
+		{
+			position += 8;
+			const size_t lineEnd = text.find('\n', position);
+			const size_t open = text.find('"', position);
+			if (open == std::string::npos || open > lineEnd) continue;
+			const size_t close = text.find('"', open + 1);
+			if (close == std::string::npos || close > lineEnd) continue;
+
+			const std::string includeName = text.substr(open + 1, close - open - 1);
+			std::filesystem::path includePath;
+			for (auto directory = includeDirectories.rbegin(); directory != includeDirectories.rend() && includePath.empty(); ++directory)
+			{
+				const std::filesystem::path candidate = (*directory / includeName).lexically_normal();
+				std::error_code errorCode;
+				if (std::filesystem::is_regular_file(candidate, errorCode)) includePath = candidate;
+			}
+			if (includePath.empty()) return false;
+
+			// the name of the include is hashed too, a file found at another place is another input
+			hash = HashAssetData(includePath.generic_string().data(), includePath.generic_string().size(), hash);
+			if (!visited.insert(includePath.generic_string()).second) continue;
+
+			includeDirectories.push_back(includePath.parent_path());
+			const bool succeeded = hashShaderSourceRecursive(includePath, includeDirectories, hash, visited);
+			includeDirectories.pop_back();
+			if (!succeeded) return false;
+		}
+
+		return true;
+	}
+}
+//=============================================================================
+bool AssetPack::Open(const std::string& path)
+{
+	Close();
+
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file) return false;
+
+	const std::streamoff fileSize = file.tellg();
+	if (fileSize < static_cast<std::streamoff>(sizeof(AssetPackHeader))) return false;
+
+	std::vector<uint8_t> data(static_cast<size_t>(fileSize));
+	file.seekg(0);
+	if (!file.read(reinterpret_cast<char*>(data.data()), fileSize)) return false;
+
+	uint64_t cursor = 0;
+	AssetPackHeader header;
+	readValue(data, cursor, header);
+	if (header.magic != ASSET_PACK_MAGIC || header.version != ASSET_PACK_VERSION) return false;
+
+	std::vector<AssetPackEntry> entries(header.numEntries);
+	for (AssetPackEntry& entry : entries)
+	{
+		uint32_t nameLength = 0;
+		uint32_t type = 0;
+		if (!readValue(data, cursor, nameLength) || cursor + nameLength > data.size()) return false;
+		entry.name.assign(reinterpret_cast<const char*>(data.data() + cursor), nameLength);
+		cursor += nameLength;
+
+		if (!readValue(data, cursor, type) || !readValue(data, cursor, entry.sourceHash) || !readValue(data, cursor, entry.offset) || !readValue(data, cursor, entry.size)) return false;
+		if (type > static_cast<uint32_t>(AssetType::texture)) return false;
+		if (entry.offset > data.size() || entry.size > data.size() - entry.offset) return false;
+		entry.type = static_cast<AssetType>(type);
+	}
+
+	m_data = std::move(data);
+	m_entries = std::move(entries);
+	for (uint32_t entryIndex = 0; entryIndex < m_entries.size(); entryIndex++)
+	{
+		m_lookup[m_entries[entryIndex].name] = entryIndex;
+	}
+
+	return true;
+}
+//=============================================================================
+void AssetPack::Close()
+{
+	m_data.clear();
+	m_data.shrink_to_fit();
+	m_entries.clear();
+	m_lookup.clear();
+}
+//=============================================================================
+const AssetPackEntry* AssetPack::Find(const std::string& name) const
+{
+	auto it = m_lookup.find(name);
+	return it != m_lookup.end() ? &m_entries[it->second] : nullptr;
+}
+//=============================================================================
+void AssetPackWriter::AddAsset(const std::string& name, AssetType type, uint64_t sourceHash, const void* data, size_t size)
+{
+	PendingAsset asset;
+	asset.entry.name = name;
+	asset.entry.type = type;
+	asset.entry.sourceHash = sourceHash;
+	asset.entry.size = size;
+	asset.data.assign(static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+	m_assets.push_back(std::move(asset));
+}
+//=============================================================================
+bool AssetPackWriter::Write(const std::string& path)
+{
+	std::sort(m_assets.begin(), m_assets.end(), [](const PendingAsset& a, const PendingAsset& b) { return a.entry.name < b.entry.name; });
+
+	AssetPackHeader header;
+	header.numEntries = static_cast<uint32_t>(m_assets.size());
+
+	uint64_t offset = sizeof(AssetPackHeader);
+	for (const PendingAsset& asset : m_assets)
+	{
+		offset += sizeof(uint32_t) + asset.entry.name.size() + sizeof(uint32_t) + 3 * sizeof(uint64_t);
+	}
+	for (PendingAsset& asset : m_assets)
+	{
+		asset.entry.offset = offset;
+		offset += asset.entry.size;
+	}
+
+	// Write next to the target and rename, so a reader never sees a half written pack
+	const std::string tempPath = path + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file) return false;
+
+		writeValue(file, header);
+		for (const PendingAsset& asset : m_assets)
+		{
+			writeValue(file, static_cast<uint32_t>(asset.entry.name.size()));
+			file.write(asset.entry.name.data(), static_cast<std::streamsize>(asset.entry.name.size()));
+			writeValue(file, static_cast<uint32_t>(asset.entry.type));
+			writeValue(file, asset.entry.sourceHash);
+			writeValue(file, asset.entry.offset);
+			writeValue(file, asset.entry.size);
+		}
+		for (const PendingAsset& asset : m_assets)
+		{
+			file.write(reinterpret_cast<const char*>(asset.data.data()), static_cast<std::streamsize>(asset.data.size()));
+		}
+
+		if (!file.good()) return false;
+	}
+
+	std::error_code errorCode;
+	std::filesystem::rename(tempPath, path, errorCode);
+	return !errorCode;
+}
+//=============================================================================
+uint64_t HashAssetData(const void* data, size_t size, uint64_t seed)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	uint64_t hash = seed;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+//=============================================================================
+std::string MakeShaderAssetName(const std::wstring& shaderName, const std::wstring& entryPoint, const std::wstring& variantName, const std::vector<std::wstring>& defines)
+{
+	std::string name = "Shaders/" + toAssetName(shaderName) + "/" + toAssetName(entryPoint);
+	if (!variantName.empty())
+	{
+		name += "/" + toAssetName(variantName);
+	}
+	const std::vector<std::wstring> sortedDefines = sortDefines(defines);
+	for (size_t defineIndex = 0; defineIndex < sortedDefines.size(); defineIndex++)
+	{
+		name += (defineIndex == 0 ? "/" : ",") + toAssetName(sortedDefines[defineIndex]);
+	}
+	return name;
+}
+//=============================================================================
+std::string MakeTextureAssetName(const std::string& texturePath)
+{
+	std::string name = texturePath;
+	std::replace(name.begin(), name.end(), '\\', '/');
+	if (name.rfind("./", 0) == 0)
+	{
+		name.erase(0, 2);
+	}
+	return name;
+}
+//=============================================================================
+bool HashShaderSource(const std::filesystem::path& sourceDirectory, const std::wstring& shaderName, const std::wstring& entryPoint, const std::wstring& target,
+	const std::vector<std::wstring>& defines, uint64_t& hash)
+{
+	hash = HashAssetData(&COOKER_VERSION, sizeof(COOKER_VERSION));
+	const std::string name = toAssetName(shaderName);
+	hash = HashAssetData(name.data(), name.size() + 1, hash);
+	const std::string entryPointName = toAssetName(entryPoint);
+	hash = HashAssetData(entryPointName.data(), entryPointName.size() + 1, hash);
+	const std::string targetName = toAssetName(target);
+	hash = HashAssetData(targetName.data(), targetName.size() + 1, hash);
+	for (const std::wstring& define : sortDefines(defines))
+	{
+		const std::string defineName = toAssetName(define);
+		hash = HashAssetData(defineName.data(), defineName.size() + 1, hash);
+	}
+
+	// the shader itself is compiled under its bare name, its includes resolve against the working directory
+	std::vector<std::filesystem::path> includeDirectories{ std::filesystem::path(shaderName).parent_path() };
+	std::unordered_set<std::string> visited;
+	return hashShaderSourceRecursive(sourceDirectory / shaderName, includeDirectories, hash, visited);
+}
+//=============================================================================
@@ -0,0 +1,89 @@
+﻿#pragma once
+
+#include <filesystem>
+
+// Packed, versioned container of cooked assets (DXIL shaders, DDS textures) written by the Cooker tool and read by the runtime.
+// The format is CPU-only and does not depend on any platform API.
+//
+// Layout (little-endian):
+//	AssetPackHeader
+//	entry table: numEntries * { uint32 nameLength, char name[nameLength], uint32 type, uint64 sourceHash, uint64 offset, uint64 size }
+//	data: entry payloads, offsets are relative to the start of the file
+
+constexpr uint32_t ASSET_PACK_MAGIC   = 0x4B415047; // 'GPAK'
+constexpr uint32_t ASSET_PACK_VERSION = 1;
+inline constexpr const char* COOKED_ASSET_PACK_PATH = "Data/Cooked.pak";
+inline constexpr const char* SHADER_USAGE_LIST_PATH = "Data/ShaderUsage.txt"; // written by ShaderPermutationLibrary, cooked by the Cooker
+// Bump when the cooked output changes for the same input (compiler arguments, texture processing), so that all assets are cooked again.
+constexpr uint64_t COOKER_VERSION = 2;
+
+enum class AssetType : uint32_t
+{
+	shader = 0,
+	texture
+};
+
+struct AssetPackHeader final
+{
+	uint32_t magic{ ASSET_PACK_MAGIC };
+	uint32_t version{ ASSET_PACK_VERSION };
+	uint32_t numEntries{ 0 };
+	uint32_t reserved{ 0 };
+};
+
+struct AssetPackEntry final
+{
+	std::string name;
+	AssetType   type{ AssetType::shader };
+	uint64_t    sourceHash{ 0 }; // hash of everything the cooked data was built from, used for incremental cooking
+	uint64_t    offset{ 0 };
+	uint64_t    size{ 0 };
+};
+
+class AssetPack final
+{
+public:
+	[[nodiscard]] bool Open(const std::string& path);
+	void Close();
+
+	bool IsOpen() const { return !m_entries.empty(); }
+	const AssetPackEntry* Find(const std::string& name) const;
+	const uint8_t* GetData(const AssetPackEntry& entry) const { return m_data.data() + entry.offset; }
+	const std::vector<AssetPackEntry>& GetEntries() const { return m_entries; }
+
+private:
+	std::vector<uint8_t>                      m_data;
+	std::vector<AssetPackEntry>               m_entries;
+	std::unordered_map<std::string, uint32_t> m_lookup;
+};
+
+class AssetPackWriter final
+{
+public:
+	void AddAsset(const std::string& name, AssetType type, uint64_t sourceHash, const void* data, size_t size);
+	// Entries are written sorted by name, so identical input produces an identical pack.
+	[[nodiscard]] bool Write(const std::string& path);
+
+private:
+	struct PendingAsset final
+	{
+		AssetPackEntry       entry;
+		std::vector<uint8_t> data;
+	};
+	std::vector<PendingAsset> m_assets;
+};
+
+// FNV-1a, stable across runs and platforms
+uint64_t HashAssetData(const void* data, size_t size, uint64_t seed = 0xcbf29ce484222325ull);
+
+// defines: as DXC gets them, "NAME" or "NAME=value". Two define sets never share a cooked shader, whatever their variant name.
+std::string MakeShaderAssetName(const std::wstring& shaderName, const std::wstring& entryPoint, const std::wstring& variantName, const std::vector<std::wstring>& defines);
+std::string MakeTextureAssetName(const std::string& texturePath);
+
+// Hash of everything a cooked shader is built from: COOKER_VERSION, the entry point, target and defines and the source with every file
+// it includes. The shader is compiled as <sourceDirectory>/<shaderName> under the source name shaderName, so the DXC default include
+// handler resolves #include "..." against the directory of the including file, then of the files including it, up to the working
+// directory. The Cooker stores the hash in the pack, the runtime compares it before it loads a cooked shader. Returns false if a
+// file can not be read.
+[[nodiscard]] bool HashShaderSource(const std::filesystem::path& sourceDirectory, const std::wstring& shaderName, const std::wstring& entryPoint, const std::wstring& target,
+	const std::vector<std::wstring>& defines, uint64_t& hash);
@@ -0,0 +1,509 @@
+﻿#include "stdafx.h"
+#include "BoundingVolumeHierarchy.h"
+#include "FrustumCulling.h"
+#include "JobSystem.h"
+#include "Log.h"
+//=============================================================================
+namespace
+{
+	constexpr uint32_t NUM_BINS = 16;
+	constexpr uint32_t SAH_MAX_DEPTH = 64;                // deeper nodes split at the median, the tree stays within BVH_MAX_DEPTH
+	constexpr uint32_t PARALLEL_BUILD_THRESHOLD = 4096; // smaller subtrees are built by the thread that split them
+	constexpr float TRAVERSAL_COST = 1.0f;              // relative to one box test
+	constexpr uint16_t QUANTIZED_MAX = UINT16_MAX;
+
+	float halfArea(const glm::vec3& min, const glm::vec3& max)
+	{
+		const glm::vec3 size = max - min;
+		return size.x * size.y + size.y * size.z + size.z * size.x;
+	}
+
+	bool isBoxInside(const CullingFrustum& frustum, const glm::vec3& center, const glm::vec3& extents)
+	{
+		// the expression of cullScalar() in FrustumCulling.cpp, both have to round the same way
+		bool inside = true;
+		for (const glm::vec4& plane : frustum.planes)
+		{
+			const float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+			const float radius = std::abs(plane.x) * extents.x + std::abs(plane.y) * extents.y + std::abs(plane.z) * extents.z;
+			inside = inside && distance + radius >= 0.0f;
+		}
+		return inside;
+	}
+
+	float distanceSquared(const glm::vec3& point, const glm::vec3& min, const glm::vec3& max)
+	{
+		const glm::vec3 outside = glm::max(glm::max(min - point, point - max), glm::vec3(0.0f));
+		return glm::dot(outside, outside);
+	}
+
+	// entry distance of the ray into the box, FLT_MAX when it misses within maxDistance
+	float intersectRay(const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance, const glm::vec3& min, const glm::vec3& max)
+	{
+		const glm::vec3 t0 = (min - origin) * inverseDirection;
+		const glm::vec3 t1 = (max - origin) * inverseDirection;
+		const glm::vec3 entries = glm::min(t0, t1);
+		const glm::vec3 exits = glm::max(t0, t1);
+		const float entry = std::max(std::max(entries.x, entries.y), std::max(entries.z, 0.0f));
+		const float exit = std::min(std::min(exits.x, exits.y), std::min(exits.z, maxDistance));
+		return entry <= exit ? entry : FLT_MAX;
+	}
+}
+//=============================================================================
+struct BoundingVolumeHierarchy::BuildContext final
+{
+	struct Node final
+	{
+		glm::vec3 min;
+		glm::vec3 max;
+		uint32_t  leftChild{ BVH_INVALID_INDEX }; // the right child follows it
+		uint32_t  firstPrimitive{ 0 };
+		uint32_t  numPrimitives{ 0 };
+	};
+
+	struct Primitive final
+	{
+		glm::vec3 center;
+		glm::vec3 extents;
+		uint32_t  index;
+	};
+
+	std::vector<Primitive> primitives; // partitioned in place, the primitives of a node are contiguous
+	std::vector<Node>      nodes;
+	std::atomic<uint32_t>  numNodes{ 1 };
+	std::atomic<uint32_t>  depth{ 0 };
+	JobSystem*             jobSystem{ nullptr };
+};
+//=============================================================================
+bool BoundingVolumeHierarchy::Build(const CullingBounds& bounds, JobSystem* jobSystem)
+{
+	Clear();
+	const uint32_t numPrimitives = bounds.GetCount();
+	if (numPrimitives > BVH_MAX_PRIMITIVES)
+	{
+		Error("BoundingVolumeHierarchy: " + std::to_string(numPrimitives) + " boxes, at most " + std::to_string(BVH_MAX_PRIMITIVES) + " are supported");
+		return false;
+	}
+	if (numPrimitives == 0) return true;
+
+	BuildContext context;
+	context.jobSystem = jobSystem;
+	context.primitives.resize(numPrimitives);
+	for (uint32_t primitive = 0; primitive < numPrimitives; primitive++)
+	{
+		context.primitives[primitive].center = { bounds.GetCenterX()[primitive], bounds.GetCenterY()[primitive], bounds.GetCenterZ()[primitive] };
+		context.primitives[primitive].extents = { bounds.GetExtentX()[primitive], bounds.GetExtentY()[primitive], bounds.GetExtentZ()[primitive] };
+		context.primitives[primitive].index = primitive;
+	}
+	context.nodes.resize(2 * size_t(numPrimitives) - 1);
+	buildNode(context, 0, 0, numPrimitives, 1);
+	m_depth = context.depth.load();
+
+	// leaf order of the primitives
+	m_primitiveIndices.resize(numPrimitives);
+	m_centers.resize(numPrimitives);
+	m_extents.resize(numPrimitives);
+	for (uint32_t primitive = 0; primitive < numPrimitives; primitive++)
+	{
+		m_primitiveIndices[primitive] = context.primitives[primitive].index;
+		m_centers[primitive] = context.primitives[primitive].center;
+		m_extents[primitive] = context.primitives[primitive].extents;
+	}
+
+	const uint32_t numNodes = context.numNodes.load();
+	m_nodes.reserve(numNodes);
+	m_nodeMin.reserve(numNodes);
+	m_nodeMax.reserve(numNodes);
+	flatten(context, 0);
+	quantizeNodes();
+	computeSAHCost();
+	return true;
+}
+//=============================================================================
+void BoundingVolumeHierarchy::buildNode(BuildContext& context, uint32_t nodeIndex, uint32_t begin, uint32_t end, uint32_t depth)
+{
+	uint32_t previousDepth = context.depth.load(std::memory_order_relaxed);
+	while (previousDepth < depth && !context.depth.compare_exchange_weak(previousDepth, depth, std::memory_order_relaxed)) {}
+
+	const uint32_t count = end - begin;
+	glm::vec3 min(FLT_MAX), max(-FLT_MAX);
+	glm::vec3 centerMin(FLT_MAX), centerMax(-FLT_MAX);
+	BuildContext::Primitive* primitives = context.primitives.data();
+	for (uint32_t i = begin; i < end; i++)
+	{
+		min = glm::min(min, primitives[i].center - primitives[i].extents);
+		max = glm::max(max, primitives[i].center + primitives[i].extents);
+		centerMin = glm::min(centerMin, primitives[i].center);
+		centerMax = glm::max(centerMax, primitives[i].center);
+	}
+
+	BuildContext::Node& node = context.nodes[nodeIndex];
+	node.min = min;
+	node.max = max;
+	node.firstPrimitive = begin;
+	node.numPrimitives = count;
+	if (count <= 2) return;
+
+	// binned SAH over the centers, one pass bins all axes, the split with the least expected cost on any of them
+	const glm::vec3 centerSize = centerMax - centerMin;
+	const glm::vec3 binScale = glm::vec3(static_cast<float>(NUM_BINS)) / glm::max(centerSize, glm::vec3(FLT_MIN));
+	const auto getBin = [&](const glm::vec3& center, uint32_t axis)
+	{
+		return std::min(static_cast<uint32_t>((center[axis] - centerMin[axis]) * binScale[axis]), NUM_BINS - 1);
+	};
+	uint32_t splitAxis = 3;
+	uint32_t splitBin = 0;
+	float splitCost = FLT_MAX;
+	if (depth < SAH_MAX_DEPTH && centerSize != glm::vec3(0.0f))
+	{
+		struct Bin final
+		{
+			glm::vec3 min{ FLT_MAX };
+			glm::vec3 max{ -FLT_MAX };
+			uint32_t  count{ 0 };
+		};
+		std::array<Bin, NUM_BINS> bins[3]{};
+		for (uint32_t i = begin; i < end; i++)
+		{
+			const glm::vec3 primitiveMin = primitives[i].center - primitives[i].extents;
+			const glm::vec3 primitiveMax = primitives[i].center + primitives[i].extents;
+			for (uint32_t axis = 0; axis < 3; axis++)
+			{
+				Bin& bin = bins[axis][getBin(primitives[i].center, axis)];
+				bin.min = glm::min(bin.min, primitiveMin);
+				bin.max = glm::max(bin.max, primitiveMax);
+				bin.count++;
+			}
+		}
+
+		for (uint32_t axis = 0; axis < 3; axis++)
+		{
+			if (centerSize[axis] <= 0.0f) continue;
+
+			// right side costs from the back, then the left side sweeps forward
+			std::array<float, NUM_BINS> rightCosts{};
+			Bin right;
+			for (uint32_t bin = NUM_BINS - 1; bin > 0; bin--)
+			{
+				right.min = glm::min(right.min, bins[axis][bin].min);
+				right.max = glm::max(right.max, bins[axis][bin].max);
+				right.count += bins[axis][bin].count;
+				rightCosts[bin] = right.count ? halfArea(right.min, right.max) * right.count : 0.0f;
+			}
+			Bin left;
+			for (uint32_t bin = 1; bin < NUM_BINS; bin++)
+			{
+				left.min = glm::min(left.min, bins[axis][bin - 1].min);
+				left.max = glm::max(left.max, bins[axis][bin - 1].max);
+				left.count += bins[axis][bin - 1].count;
+				if (left.count == 0 || left.count == count) continue;
+				const float cost = halfArea(left.min, left.max) * left.count + rightCosts[bin];
+				if (cost < splitCost)
+				{
+					splitCost = cost;
+					splitAxis = axis;
+					splitBin = bin;
+				}
+			}
+		}
+	}
+
+	uint32_t middle = begin;
+	if (splitAxis < 3)
+	{
+		const float area = halfArea(min, max);
+		splitCost = area > 0.0f ? TRAVERSAL_COST + splitCost / area : TRAVERSAL_COST + static_cast<float>(count);
+		if (count <= BVH_MAX_LEAF_SIZE && splitCost >= static_cast<float>(count)) return;
+
+		middle = static_cast<uint32_t>(std::partition(primitives + begin, primitives + end,
+			[&](const BuildContext::Primitive& primitive) { return getBin(primitive.center, splitAxis) < splitBin; }) - primitives);
+	}
+	else
+	{
+		// too deep or all centers in one point: the median along the widest axis
+		if (count <= BVH_MAX_LEAF_SIZE && centerSize == glm::vec3(0.0f)) return;
+		const uint32_t axis = centerSize.x >= centerSize.y && centerSize.x >= centerSize.z ? 0 : (centerSize.y >= centerSize.z ? 1 : 2);
+		middle = begin + count / 2;
+		std::nth_element(primitives + begin, primitives + middle, primitives + end,
+			[axis](const BuildContext::Primitive& a, const BuildContext::Primitive& b) { return a.center[axis] < b.center[axis]; });
+	}
+
+	const uint32_t leftChild = context.numNodes.fetch_add(2, std::memory_order_relaxed);
+	node.leftChild = leftChild;
+	node.numPrimitives = 0;
+	if (context.jobSystem && count >= PARALLEL_BUILD_THRESHOLD)
+	{
+		JobCounter counter;
+		context.jobSystem->Schedule([&context, leftChild, begin, middle, depth] { buildNode(context, leftChild, begin, middle, depth + 1); }, &counter);
+		buildNode(context, leftChild + 1, middle, end, depth + 1);
+		context.jobSystem->Wait(counter);
+	}
+	else
+	{
+		buildNode(context, leftChild, begin, middle, depth + 1);
+		buildNode(context, leftChild + 1, middle, end, depth + 1);
+	}
+}
+//=============================================================================
+uint32_t BoundingVolumeHierarchy::flatten(const BuildContext& context, uint32_t buildNode)
+{
+	const BuildContext::Node& source = context.nodes[buildNode];
+	const uint32_t node = static_cast<uint32_t>(m_nodes.size());
+	m_nodes.push_back({});
+	m_nodeMin.push_back(source.min);
+	m_nodeMax.push_back(source.max);
+	if (source.numPrimitives > 0)
+	{
+		m_nodes[node].data = source.firstPrimitive << 4 | source.numPrimitives;
+	}
+	else
+	{
+		flatten(context, source.leftChild);
+		m_nodes[node].data = flatten(context, source.leftChild + 1) << 4;
+	}
+	return node;
+}
+//=============================================================================
+void BoundingVolumeHierarchy::quantizeNodes()
+{
+	// the grid spans the root with one step to spare, outward rounding is checked against dequantize() so that the node boxes
+	// never shrink
+	m_origin = m_nodeMin[0];
+	const glm::vec3 size = m_nodeMax[0] - m_nodeMin[0];
+	m_step = glm::max(size / static_cast<float>(QUANTIZED_MAX - 1), glm::vec3(FLT_MIN));
+	const glm::vec3 scale = 1.0f / m_step;
+
+	for (size_t node = 0; node < m_nodes.size(); node++)
+	{
+		uint16_t* min = m_nodes[node].min;
+		uint16_t* max = m_nodes[node].max;
+		for (uint32_t axis = 0; axis < 3; axis++)
+		{
+			min[axis] = static_cast<uint16_t>(std::clamp(std::floor((m_nodeMin[node][axis] - m_origin[axis]) * scale[axis]), 0.0f, float(QUANTIZED_MAX)));
+			max[axis] = static_cast<uint16_t>(std::clamp(std::ceil((m_nodeMax[node][axis] - m_origin[axis]) * scale[axis]), 0.0f, float(QUANTIZED_MAX)));
+		}
+		for (uint32_t axis = 0; axis < 3; axis++)
+		{
+			while (min[axis] > 0 && dequantize(min)[axis] > m_nodeMin[node][axis]) min[axis]--;
+			while (max[axis] < QUANTIZED_MAX && dequantize(max)[axis] < m_nodeMax[node][axis]) max[axis]++;
+		}
+	}
+}
+//=============================================================================
+void BoundingVolumeHierarchy::computeSAHCost()
+{
+	const float rootArea = halfArea(m_nodeMin[0], m_nodeMax[0]);
+	float cost = 0.0f;
+	for (size_t node = 0; node < m_nodes.size(); node++)
+	{
+		const float area = rootArea > 0.0f ? halfArea(m_nodeMin[node], m_nodeMax[node]) / rootArea : 1.0f;
+		cost += area * (m_nodes[node].IsLeaf() ? static_cast<float>(m_nodes[node].GetNumPrimitives()) : TRAVERSAL_COST);
+	}
+	m_sahCost = cost;
+}
+//=============================================================================
+void BoundingVolumeHierarchy::Refit(const CullingBounds& bounds)
+{
+	if (m_nodes.empty()) return;
+	assert(bounds.GetCount() == GetNumPrimitives());
+
+	for (uint32_t primitive = 0; primitive < GetNumPrimitives(); primitive++)
+	{
+		const uint32_t index = m_primitiveIndices[primitive];
+		m_centers[primitive] = { bounds.GetCenterX()[index], bounds.GetCenterY()[index], bounds.GetCenterZ()[index] };
+		m_extents[primitive] = { bounds.GetExtentX()[index], bounds.GetExtentY()[index], bounds.GetExtentZ()[index] };
+	}
+
+	// children come after their parent
+	for (size_t node = m_nodes.size(); node-- > 0;)
+	{
+		const BvhNode& source = m_nodes[node];
+		if (source.IsLeaf())
+		{
+			glm::vec3 min(FLT_MAX), max(-FLT_MAX);
+			for (uint32_t primitive = source.GetFirstPrimitive(); primitive < source.GetFirstPrimitive() + source.GetNumPrimitives(); primitive++)
+			{
+				min = glm::min(min, m_centers[primitive] - m_extents[primitive]);
+				max = glm::max(max, m_centers[primitive] + m_extents[primitive]);
+			}
+			m_nodeMin[node] = min;
+			m_nodeMax[node] = max;
+		}
+		else
+		{
+			m_nodeMin[node] = glm::min(m_nodeMin[node + 1], m_nodeMin[source.GetRightChild()]);
+			m_nodeMax[node] = glm::max(m_nodeMax[node + 1], m_nodeMax[source.GetRightChild()]);
+		}
+	}
+	quantizeNodes();
+	computeSAHCost();
+}
+//=============================================================================
+void BoundingVolumeHierarchy::Clear()
+{
+	m_nodes.clear();
+	m_primitiveIndices.clear();
+	m_centers.clear();
+	m_extents.clear();
+	m_nodeMin.clear();
+	m_nodeMax.clear();
+	m_depth = 0;
+	m_sahCost = 0.0f;
+}
+//=============================================================================
+void BoundingVolumeHierarchy::getPrimitiveRange(uint32_t node, uint32_t& first, uint32_t& end) const
+{
+	uint32_t leftmost = node;
+	while (!m_nodes[leftmost].IsLeaf()) leftmost++;
+	uint32_t rightmost = node;
+	while (!m_nodes[rightmost].IsLeaf()) rightmost = m_nodes[rightmost].GetRightChild();
+	first = m_nodes[leftmost].GetFirstPrimitive();
+	end = m_nodes[rightmost].GetFirstPrimitive() + m_nodes[rightmost].GetNumPrimitives();
+}
+//=============================================================================
+void BoundingVolumeHierarchy::QueryFrustum(const CullingFrustum& frustum, std::vector<uint32_t>& primitives) const
+{
+	if (m_nodes.empty()) return;
+
+	// planes the node box crosses, a subtree inside of all planes is taken without further tests
+	struct Entry final
+	{
+		uint32_t node;
+		uint32_t planeMask;
+	};
+	Entry stack[BVH_MAX_DEPTH];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = { 0, 63 };
+	while (stackSize > 0)
+	{
+		const Entry entry = stack[--stackSize];
+		const BvhNode& node = m_nodes[entry.node];
+		const glm::vec3 min = dequantize(node.min);
+		const glm::vec3 max = dequantize(node.max);
+		const glm::vec3 center = (min + max) * 0.5f;
+		const glm::vec3 extents = (max - min) * 0.5f;
+
+		uint32_t planeMask = entry.planeMask;
+		bool outside = false;
+		for (uint32_t plane = 0; plane < 6 && !outside; plane++)
+		{
+			if (!(planeMask & (1u << plane))) continue;
+			const glm::vec4& p = frustum.planes[plane];
+			const float distance = glm::dot(glm::vec3(p), center) + p.w;
+			const float radius = glm::dot(glm::abs(glm::vec3(p)), extents);
+			outside = distance + radius < 0.0f;
+			if (distance - radius >= 0.0f) planeMask &= ~(1u << plane);
+		}
+		if (outside) continue;
+
+		if (planeMask == 0)
+		{
+			uint32_t first, end;
+			getPrimitiveRange(entry.node, first, end);
+			primitives.insert(primitives.end(), m_primitiveIndices.begin() + first, m_primitiveIndices.begin() + end);
+		}
+		else if (node.IsLeaf())
+		{
+			for (uint32_t primitive = node.GetFirstPrimitive(); primitive < node.GetFirstPrimitive() + node.GetNumPrimitives(); primitive++)
+			{
+				if (isBoxInside(frustum, m_centers[primitive], m_extents[primitive])) primitives.push_back(m_primitiveIndices[primitive]);
+			}
+		}
+		else
+		{
+			stack[stackSize++] = { node.GetRightChild(), planeMask };
+			stack[stackSize++] = { entry.node + 1, planeMask };
+		}
+	}
+}
+//=============================================================================
+void BoundingVolumeHierarchy::QuerySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& primitives) const
+{
+	if (m_nodes.empty()) return;
+
+	const float radiusSquared = radius * radius;
+	uint32_t stack[BVH_MAX_DEPTH];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0)
+	{
+		const uint32_t nodeIndex = stack[--stackSize];
+		const BvhNode& node = m_nodes[nodeIndex];
+		if (distanceSquared(center, dequantize(node.min), dequantize(node.max)) > radiusSquared) continue;
+
+		if (node.IsLeaf())
+		{
+			for (uint32_t primitive = node.GetFirstPrimitive(); primitive < node.GetFirstPrimitive() + node.GetNumPrimitives(); primitive++)
+			{
+				if (distanceSquared(center, m_centers[primitive] - m_extents[primitive], m_centers[primitive] + m_extents[primitive]) <= radiusSquared)
+					primitives.push_back(m_primitiveIndices[primitive]);
+			}
+		}
+		else
+		{
+			stack[stackSize++] = node.GetRightChild();
+			stack[stackSize++] = nodeIndex + 1;
+		}
+	}
+}
+//=============================================================================
+bool BoundingVolumeHierarchy::Raycast(const BvhRay& ray, BvhRayHit& hit) const
+{
+	if (m_nodes.empty()) return false;
+
+	// no zero components, the slabs of an axis parallel ray become +-infinity instead of NaN
+	glm::vec3 inverseDirection;
+	for (uint32_t axis = 0; axis < 3; axis++)
+	{
+		const float direction = ray.direction[axis];
+		inverseDirection[axis] = 1.0f / (std::abs(direction) > 1e-30f ? direction : std::copysign(1e-30f, direction));
+	}
+
+	float closest = ray.maxDistance;
+	uint32_t closestPrimitive = BVH_INVALID_INDEX;
+
+	// nearer child first, a node is skipped when something closer than its entry was hit meanwhile
+	struct Entry final
+	{
+		uint32_t node;
+		float    distance;
+	};
+	Entry stack[BVH_MAX_DEPTH];
+	uint32_t stackSize = 0;
+	const float rootDistance = intersectRay(ray.origin, inverseDirection, closest, dequantize(m_nodes[0].min), dequantize(m_nodes[0].max));
+	if (rootDistance != FLT_MAX) stack[stackSize++] = { 0, rootDistance };
+	while (stackSize > 0)
+	{
+		const Entry entry = stack[--stackSize];
+		if (entry.distance > closest) continue;
+
+		const BvhNode& node = m_nodes[entry.node];
+		if (node.IsLeaf())
+		{
+			for (uint32_t primitive = node.GetFirstPrimitive(); primitive < node.GetFirstPrimitive() + node.GetNumPrimitives(); primitive++)
+			{
+				const float distance = intersectRay(ray.origin, inverseDirection, closest, m_centers[primitive] - m_extents[primitive], m_centers[primitive] + m_extents[primitive]);
+				if (distance != FLT_MAX && (distance < closest || closestPrimitive == BVH_INVALID_INDEX))
+				{
+					closest = distance;
+					closestPrimitive = m_primitiveIndices[primitive];
+				}
+			}
+			continue;
+		}
+
+		Entry left{ entry.node + 1, 0.0f };
+		Entry right{ node.GetRightChild(), 0.0f };
+		left.distance = intersectRay(ray.origin, inverseDirection, closest, dequantize(m_nodes[left.node].min), dequantize(m_nodes[left.node].max));
+		right.distance = intersectRay(ray.origin, inverseDirection, closest, dequantize(m_nodes[right.node].min), dequantize(m_nodes[right.node].max));
+		if (left.distance > right.distance) std::swap(left, right);
+		if (right.distance != FLT_MAX) stack[stackSize++] = right;
+		if (left.distance != FLT_MAX) stack[stackSize++] = left;
+	}
+
+	if (closestPrimitive == BVH_INVALID_INDEX) return false;
+	hit.primitive = closestPrimitive;
+	hit.distance = closest;
+	return true;
+}
+//=============================================================================
@@ -0,0 +1,96 @@
+﻿#pragma once
+
+// Bounding volume hierarchy over the boxes of CullingBounds, for culling and queries in large static scenes.
+//  - built top-down with binned SAH (surface area heuristic), with a job system the subtrees of large nodes are built in parallel
+//  - flattened depth first into 16 byte nodes: the left child follows its parent, the bounds are quantized to 16 bits on the
+//    bounds of the whole tree and rounded outwards, four nodes share a cache line
+//  - the primitives of a subtree are contiguous, a frustum query takes a subtree that is inside of all planes without testing
+//  - Refit() keeps the tree and recomputes the bounds bottom up, for objects that move a little. The tree quality drops with
+//    the distance they move, rebuild when GetSAHCost() grew by too much.
+//
+// Primitive boxes are tested the same way as by CullBoxes(), both find the same visible boxes.
+
+class JobSystem;
+class CullingBounds;
+struct CullingFrustum;
+
+constexpr uint32_t BVH_INVALID_INDEX = UINT32_MAX;
+constexpr uint32_t BVH_MAX_LEAF_SIZE = 15;        // fits the 4 bits of BvhNode::data
+constexpr uint32_t BVH_MAX_PRIMITIVES = 1u << 27; // node and primitive indices fit the 28 bits of BvhNode::data
+constexpr uint32_t BVH_MAX_DEPTH = 96;            // traversal stack size
+
+struct BvhNode final
+{
+	[[nodiscard]] bool IsLeaf() const { return (data & 15) != 0; }
+	[[nodiscard]] uint32_t GetFirstPrimitive() const { return data >> 4; } // leaf
+	[[nodiscard]] uint32_t GetNumPrimitives() const { return data & 15; }  // leaf
+	[[nodiscard]] uint32_t GetRightChild() const { return data >> 4; }     // interior node, the left child is the next node
+
+	uint16_t min[3];
+	uint16_t max[3];
+	uint32_t data;
+};
+static_assert(sizeof(BvhNode) == 16);
+
+struct BvhRay final
+{
+	glm::vec3 origin{ 0.0f };
+	glm::vec3 direction{ 0.0f, 0.0f, 1.0f }; // need not be normalized, distances are in multiples of its length
+	float     maxDistance{ FLT_MAX };
+};
+
+struct BvhRayHit final
+{
+	uint32_t primitive{ BVH_INVALID_INDEX };
+	float    distance{ 0.0f };
+};
+
+class BoundingVolumeHierarchy final
+{
+public:
+	// Primitive i is box i of bounds. Returns false for more than BVH_MAX_PRIMITIVES boxes.
+	[[nodiscard]] bool Build(const CullingBounds& bounds, JobSystem* jobSystem = nullptr);
+	// bounds holds the boxes of Build() in the same order, at their new places
+	void Refit(const CullingBounds& bounds);
+	void Clear();
+
+	// The queries append primitive indices in no particular order and may run on several threads at once
+	void QueryFrustum(const CullingFrustum& frustum, std::vector<uint32_t>& primitives) const;
+	void QuerySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& primitives) const;
+	// The nearest box the ray enters within maxDistance, distance 0 when the ray starts inside of it
+	[[nodiscard]] bool Raycast(const BvhRay& ray, BvhRayHit& hit) const;
+
+	[[nodiscard]] bool IsEmpty() const { return m_nodes.empty(); }
+	[[nodiscard]] const std::vector<BvhNode>& GetNodes() const { return m_nodes; }
+	[[nodiscard]] uint32_t GetNumPrimitives() const { return static_cast<uint32_t>(m_primitiveIndices.size()); }
+	[[nodiscard]] uint32_t GetDepth() const { return m_depth; }
+	// Expected cost of a random query relative to testing one box, traversal steps and box tests count the same
+	[[nodiscard]] float GetSAHCost() const { return m_sahCost; }
+
+private:
+	struct BuildContext;
+
+	static void buildNode(BuildContext& context, uint32_t node, uint32_t begin, uint32_t end, uint32_t depth);
+	uint32_t flatten(const BuildContext& context, uint32_t buildNode);
+	void quantizeNodes();
+	void computeSAHCost();
+
+	glm::vec3 dequantize(const uint16_t value[3]) const
+	{
+		return m_origin + glm::vec3(value[0], value[1], value[2]) * m_step;
+	}
+	void getPrimitiveRange(uint32_t node, uint32_t& first, uint32_t& end) const;
+
+	std::vector<BvhNode>   m_nodes;
+	std::vector<uint32_t>  m_primitiveIndices; // index in CullingBounds of the primitives in leaf order
+	std::vector<glm::vec3> m_centers;          // in leaf order
+	std::vector<glm::vec3> m_extents;
+	glm::vec3              m_origin{ 0.0f };   // quantization grid
+	glm::vec3              m_step{ 0.0f };
+	uint32_t               m_depth{ 0 };
+	float                  m_sahCost{ 0.0f };
+
+	// exact node bounds for quantizeNodes(), Refit() recomputes them
+	std::vector<glm::vec3> m_nodeMin;
+	std::vector<glm::vec3> m_nodeMax;
+};
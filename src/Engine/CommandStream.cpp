@@ -0,0 +1,249 @@
+﻿#include "stdafx.h"
+#include "CommandStream.h"
+#include "RenderCore.h"
+#include "Log.h"
+//=============================================================================
+bool CommandStream::Create(size_t capacity)
+{
+	assert(!m_data);
+	if (capacity == 0)
+	{
+		Fatal("CommandStream: capacity must not be 0");
+		return false;
+	}
+	m_capacity = (capacity + COMMAND_STREAM_ALIGNMENT - 1) / COMMAND_STREAM_ALIGNMENT * COMMAND_STREAM_ALIGNMENT;
+	m_data = std::make_unique_for_overwrite<std::byte[]>(m_capacity);
+	Reset();
+	return true;
+}
+//=============================================================================
+void CommandStream::Destroy()
+{
+	m_data.reset();
+	m_capacity = 0;
+	Reset();
+}
+//=============================================================================
+void CommandStream::Reset()
+{
+	m_size = 0;
+	m_numCommands = 0;
+	m_overflowed = false;
+}
+//=============================================================================
+template<typename Command>
+void CommandStreamRecorder::write(const Command& command)
+{
+	static_assert(std::is_trivially_copyable_v<Command>);
+	constexpr size_t packetSize = (sizeof(CommandStreamPacket) + sizeof(Command) + COMMAND_STREAM_ALIGNMENT - 1) / COMMAND_STREAM_ALIGNMENT * COMMAND_STREAM_ALIGNMENT;
+	static_assert(packetSize <= UINT16_MAX);
+
+	if (m_stream.m_overflowed) return;
+	if (m_stream.m_size + packetSize > m_stream.m_capacity)
+	{
+		Error("CommandStream: out of memory after " + std::to_string(m_stream.m_numCommands) + " commands, the rest is dropped");
+		m_stream.m_overflowed = true;
+		return;
+	}
+
+	const CommandStreamPacket packet{ Command::op, static_cast<uint16_t>(packetSize) };
+	std::byte* destination = m_stream.m_data.get() + m_stream.m_size;
+	memcpy(destination, &packet, sizeof(packet));
+	memcpy(destination + sizeof(packet), &command, sizeof(Command));
+	m_stream.m_size += packetSize;
+	m_stream.m_numCommands++;
+}
+//=============================================================================
+void CommandStreamRecorder::SetDefaultViewPortAndScissor(glm::ivec2 screenSize)
+{
+	write(CommandStreamCommand::SetDefaultViewportAndScissor{ screenSize.x, screenSize.y });
+}
+//=============================================================================
+void CommandStreamRecorder::SetViewport(float topLeftX, float topLeftY, float width, float height, float minDepth, float maxDepth)
+{
+	write(CommandStreamCommand::SetViewport{ topLeftX, topLeftY, width, height, minDepth, maxDepth });
+}
+//=============================================================================
+void CommandStreamRecorder::SetScissorRect(int32_t left, int32_t top, int32_t right, int32_t bottom)
+{
+	write(CommandStreamCommand::SetScissorRect{ left, top, right, bottom });
+}
+//=============================================================================
+void CommandStreamRecorder::SetStencilRef(uint32_t stencilRef)
+{
+	write(CommandStreamCommand::SetStencilRef{ stencilRef });
+}
+//=============================================================================
+void CommandStreamRecorder::SetBlendFactor(glm::vec4 blendFactor)
+{
+	write(CommandStreamCommand::SetBlendFactor{ { blendFactor.x, blendFactor.y, blendFactor.z, blendFactor.w } });
+}
+//=============================================================================
+void CommandStreamRecorder::SetPrimitiveTopology(CommandStreamTopology topology)
+{
+	write(CommandStreamCommand::SetPrimitiveTopology{ topology });
+}
+//=============================================================================
+void CommandStreamRecorder::SetPipeline(const PipelineInfo& pipelineBinding)
+{
+	write(CommandStreamCommand::SetPipeline{ &pipelineBinding });
+}
+//=============================================================================
+void CommandStreamRecorder::SetPipelineResources(uint32_t spaceId, const PipelineResourceSpace& resources)
+{
+	write(CommandStreamCommand::SetPipelineResources{ &resources, spaceId });
+}
+//=============================================================================
+void CommandStreamRecorder::SetIndexBuffer(const BufferResource& indexBuffer)
+{
+	write(CommandStreamCommand::SetIndexBuffer{ &indexBuffer });
+}
+//=============================================================================
+void CommandStreamRecorder::ClearRenderTarget(const TextureResource& target, glm::vec4 color)
+{
+	write(CommandStreamCommand::ClearRenderTarget{ &target, { color.x, color.y, color.z, color.w } });
+}
+//=============================================================================
+void CommandStreamRecorder::ClearDepthStencilTarget(const TextureResource& target, float depth, uint8_t stencil)
+{
+	write(CommandStreamCommand::ClearDepthStencilTarget{ &target, depth, stencil });
+}
+//=============================================================================
+void CommandStreamRecorder::DrawFullScreenTriangle()
+{
+	Draw(3);
+}
+//=============================================================================
+void CommandStreamRecorder::Draw(uint32_t vertexCount, uint32_t vertexStartOffset)
+{
+	DrawInstanced(vertexCount, 1, vertexStartOffset, 0);
+}
+//=============================================================================
+void CommandStreamRecorder::DrawIndexed(uint32_t indexCount, uint32_t startIndexLocation, uint32_t baseVertexLocation)
+{
+	DrawIndexedInstanced(indexCount, 1, startIndexLocation, baseVertexLocation, 0);
+}
+//=============================================================================
+void CommandStreamRecorder::DrawInstanced(uint32_t vertexCountPerInstance, uint32_t instanceCount, uint32_t startVertexLocation, uint32_t startInstanceLocation)
+{
+	write(CommandStreamCommand::DrawInstanced{ vertexCountPerInstance, instanceCount, startVertexLocation, startInstanceLocation });
+}
+//=============================================================================
+void CommandStreamRecorder::DrawIndexedInstanced(uint32_t indexCountPerInstance, uint32_t instanceCount, uint32_t startIndexLocation, uint32_t baseVertexLocation, uint32_t startInstanceLocation)
+{
+	write(CommandStreamCommand::DrawIndexedInstanced{ indexCountPerInstance, instanceCount, startIndexLocation, baseVertexLocation, startInstanceLocation });
+}
+//=============================================================================
+void CommandStreamRecorder::Dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ)
+{
+	write(CommandStreamCommand::Dispatch{ groupCountX, groupCountY, groupCountZ });
+}
+//=============================================================================
+void CommandStreamRecorder::Dispatch1D(uint32_t threadCountX, uint32_t groupSizeX)
+{
+	Dispatch(GetGroupCount(threadCountX, groupSizeX), 1, 1);
+}
+//=============================================================================
+void CommandStreamRecorder::Dispatch2D(uint32_t threadCountX, uint32_t threadCountY, uint32_t groupSizeX, uint32_t groupSizeY)
+{
+	Dispatch(GetGroupCount(threadCountX, groupSizeX), GetGroupCount(threadCountY, groupSizeY), 1);
+}
+//=============================================================================
+void CommandStreamRecorder::Dispatch3D(uint32_t threadCountX, uint32_t threadCountY, uint32_t threadCountZ, uint32_t groupSizeX, uint32_t groupSizeY, uint32_t groupSizeZ)
+{
+	Dispatch(GetGroupCount(threadCountX, groupSizeX), GetGroupCount(threadCountY, groupSizeY), GetGroupCount(threadCountZ, groupSizeZ));
+}
+//=============================================================================
+void CommandStreamRecorder::AddBarrier(Resource& resource, uint32_t newState)
+{
+	write(CommandStreamCommand::AddBarrier{ &resource, newState });
+}
+//=============================================================================
+void CommandStreamRecorder::FlushBarriers()
+{
+	write(CommandStreamCommand::FlushBarriers{});
+}
+//=============================================================================
+void CommandStreamRecorder::CopyResource(const Resource& destination, const Resource& source)
+{
+	write(CommandStreamCommand::CopyResource{ &destination, &source });
+}
+//=============================================================================
+void CommandStreamRecorder::CopyBufferRegion(Resource& destination, uint64_t destOffset, Resource& source, uint64_t sourceOffset, uint64_t numBytes)
+{
+	write(CommandStreamCommand::CopyBufferRegion{ &destination, &source, destOffset, sourceOffset, numBytes });
+}
+//=============================================================================
+void CommandStreamRecorder::CopyTextureRegion(Resource& destination, Resource& source, size_t sourceOffset, const void* subResourceLayouts, uint32_t numSubResources)
+{
+	assert(subResourceLayouts);
+	write(CommandStreamCommand::CopyTextureRegion{ &destination, &source, sourceOffset, subResourceLayouts, numSubResources });
+}
+//=============================================================================
+void CommandStreamRecorder::ExecuteIndirect(void* commandSignature, uint32_t maxCommandCount, const BufferResource& argumentBuffer, const BufferResource* countBuffer)
+{
+	assert(commandSignature);
+	write(CommandStreamCommand::ExecuteIndirect{ commandSignature, &argumentBuffer, countBuffer, maxCommandCount });
+}
+//=============================================================================
+void CommandStreamRecorder::ExecuteStream(const CommandStream& stream)
+{
+	assert(&stream != &m_stream);
+	write(CommandStreamCommand::ExecuteStream{ &stream });
+}
+//=============================================================================
+CommandStreamStats ReplayCommandStreamNull(const CommandStream& stream)
+{
+	CommandStreamStats stats{};
+	const auto replay = [&stats](const CommandStream& replayedStream, const auto& self) -> void
+	{
+		replayedStream.Visit([&stats, &self]<typename Command>(const Command& command)
+		{
+			stats.numCommands++;
+			if constexpr (std::is_same_v<Command, CommandStreamCommand::DrawInstanced>)
+			{
+				stats.numDraws++;
+				stats.numVertices += uint64_t(command.vertexCountPerInstance) * command.instanceCount;
+			}
+			else if constexpr (std::is_same_v<Command, CommandStreamCommand::DrawIndexedInstanced>)
+			{
+				stats.numDraws++;
+				stats.numVertices += uint64_t(command.indexCountPerInstance) * command.instanceCount;
+			}
+			else if constexpr (std::is_same_v<Command, CommandStreamCommand::Dispatch>)
+			{
+				stats.numDispatches++;
+				stats.numThreadGroups += uint64_t(command.groupCountX) * command.groupCountY * command.groupCountZ;
+			}
+			else if constexpr (std::is_same_v<Command, CommandStreamCommand::AddBarrier>)
+			{
+				stats.numBarriers++;
+			}
+			else if constexpr (std::is_same_v<Command, CommandStreamCommand::SetPipeline>)
+			{
+				stats.numPipelineChanges++;
+			}
+			else if constexpr (std::is_same_v<Command, CommandStreamCommand::SetPipelineResources>)
+			{
+				stats.numResourceBindings++;
+			}
+			else if constexpr (std::is_same_v<Command, CommandStreamCommand::CopyResource> || std::is_same_v<Command, CommandStreamCommand::CopyBufferRegion> ||
+				std::is_same_v<Command, CommandStreamCommand::CopyTextureRegion>)
+			{
+				stats.numCopies++;
+			}
+			else if constexpr (std::is_same_v<Command, CommandStreamCommand::ExecuteIndirect>)
+			{
+				stats.numIndirectExecutes++;
+				stats.maxIndirectCommands += command.maxCommandCount;
+			}
+			else if constexpr (std::is_same_v<Command, CommandStreamCommand::ExecuteStream>)
+			{
+				self(*command.stream, self);
+			}
+		});
+	};
+	replay(stream, replay);
+	return stats;
+}
+//=============================================================================
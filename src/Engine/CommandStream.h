@@ -0,0 +1,227 @@
+﻿#pragma once
+
+// Backend independent command stream. A CommandStreamRecorder writes the GraphicsCommandContextD3D12 API as packets into the
+// fixed memory of a CommandStream, a translator replays it onto a command list (ReplayCommandStream() in CommandStreamD3D12.h)
+// or onto nothing at all (ReplayCommandStreamNull(), counts what a replay would do). Recording needs no command list and no
+// allocations, every thread records its own stream and the lists are built later.
+//
+// A stream is not consumed by a replay: a static stream is recorded once and replayed every frame like a bundle, but it may
+// set pipelines and resources, the bindings are resolved again on every replay. The objects a stream points to have to live as
+// long as the stream is replayed.
+//
+// Packet: CommandStreamPacket, then the command struct, padded to COMMAND_STREAM_ALIGNMENT.
+
+struct PipelineInfo;
+class PipelineResourceSpace;
+struct Resource;
+struct BufferResource;
+struct TextureResource;
+class CommandStream;
+
+constexpr size_t COMMAND_STREAM_ALIGNMENT = 8;
+
+enum class CommandStreamOp : uint16_t
+{
+	setDefaultViewportAndScissor,
+	setViewport,
+	setScissorRect,
+	setStencilRef,
+	setBlendFactor,
+	setPrimitiveTopology,
+	setPipeline,
+	setPipelineResources,
+	setIndexBuffer,
+	clearRenderTarget,
+	clearDepthStencilTarget,
+	drawInstanced,
+	drawIndexedInstanced,
+	dispatch,
+	addBarrier,
+	flushBarriers,
+	copyResource,
+	copyBufferRegion,
+	copyTextureRegion,
+	executeIndirect,
+	executeStream
+};
+
+enum class CommandStreamTopology : uint8_t
+{
+	pointList,
+	lineList,
+	lineStrip,
+	triangleList,
+	triangleStrip
+};
+
+struct alignas(COMMAND_STREAM_ALIGNMENT) CommandStreamPacket final
+{
+	CommandStreamOp op;
+	uint16_t        size; // of the whole packet
+};
+
+// The payloads, plain data only
+namespace CommandStreamCommand
+{
+	struct SetDefaultViewportAndScissor final { static constexpr CommandStreamOp op = CommandStreamOp::setDefaultViewportAndScissor; int32_t width, height; };
+	struct SetViewport final                  { static constexpr CommandStreamOp op = CommandStreamOp::setViewport; float topLeftX, topLeftY, width, height, minDepth, maxDepth; };
+	struct SetScissorRect final               { static constexpr CommandStreamOp op = CommandStreamOp::setScissorRect; int32_t left, top, right, bottom; };
+	struct SetStencilRef final                { static constexpr CommandStreamOp op = CommandStreamOp::setStencilRef; uint32_t stencilRef; };
+	struct SetBlendFactor final               { static constexpr CommandStreamOp op = CommandStreamOp::setBlendFactor; float factor[4]; };
+	struct SetPrimitiveTopology final         { static constexpr CommandStreamOp op = CommandStreamOp::setPrimitiveTopology; CommandStreamTopology topology; };
+	struct SetPipeline final                  { static constexpr CommandStreamOp op = CommandStreamOp::setPipeline; const PipelineInfo* pipeline; };
+	struct SetPipelineResources final         { static constexpr CommandStreamOp op = CommandStreamOp::setPipelineResources; const PipelineResourceSpace* resources; uint32_t spaceId; };
+	struct SetIndexBuffer final               { static constexpr CommandStreamOp op = CommandStreamOp::setIndexBuffer; const BufferResource* indexBuffer; };
+	struct ClearRenderTarget final            { static constexpr CommandStreamOp op = CommandStreamOp::clearRenderTarget; const TextureResource* target; float color[4]; };
+	struct ClearDepthStencilTarget final      { static constexpr CommandStreamOp op = CommandStreamOp::clearDepthStencilTarget; const TextureResource* target; float depth; uint8_t stencil; };
+	struct DrawInstanced final                { static constexpr CommandStreamOp op = CommandStreamOp::drawInstanced; uint32_t vertexCountPerInstance, instanceCount, startVertexLocation, startInstanceLocation; };
+	struct DrawIndexedInstanced final         { static constexpr CommandStreamOp op = CommandStreamOp::drawIndexedInstanced; uint32_t indexCountPerInstance, instanceCount, startIndexLocation, baseVertexLocation, startInstanceLocation; };
+	struct Dispatch final                     { static constexpr CommandStreamOp op = CommandStreamOp::dispatch; uint32_t groupCountX, groupCountY, groupCountZ; };
+	struct AddBarrier final                   { static constexpr CommandStreamOp op = CommandStreamOp::addBarrier; Resource* resource; uint32_t newState; }; // state of the backend, e.g. D3D12_RESOURCE_STATES
+	struct FlushBarriers final                { static constexpr CommandStreamOp op = CommandStreamOp::flushBarriers; };
+	struct CopyResource final                 { static constexpr CommandStreamOp op = CommandStreamOp::copyResource; const Resource* destination; const Resource* source; };
+	struct CopyBufferRegion final             { static constexpr CommandStreamOp op = CommandStreamOp::copyBufferRegion; Resource* destination; Resource* source; uint64_t destOffset, sourceOffset, numBytes; };
+	struct CopyTextureRegion final            { static constexpr CommandStreamOp op = CommandStreamOp::copyTextureRegion; Resource* destination; Resource* source; uint64_t sourceOffset; const void* subResourceLayouts; uint32_t numSubResources; }; // footprints of the backend, e.g. SubResourceLayouts
+	struct ExecuteIndirect final              { static constexpr CommandStreamOp op = CommandStreamOp::executeIndirect; void* commandSignature; const BufferResource* argumentBuffer; const BufferResource* countBuffer; uint32_t maxCommandCount; }; // signature of the backend, e.g. ID3D12CommandSignature
+	struct ExecuteStream final                { static constexpr CommandStreamOp op = CommandStreamOp::executeStream; const CommandStream* stream; };
+}
+
+class CommandStream final
+{
+public:
+	[[nodiscard]] bool Create(size_t capacity);
+	void Destroy();
+
+	// Forgets the commands and keeps the memory
+	void Reset();
+
+	[[nodiscard]] bool IsEmpty() const { return m_size == 0; }
+	[[nodiscard]] size_t GetSize() const { return m_size; }
+	[[nodiscard]] size_t GetCapacity() const { return m_capacity; }
+	[[nodiscard]] uint32_t GetNumCommands() const { return m_numCommands; }
+	// A command did not fit, it and everything after it were dropped
+	[[nodiscard]] bool HasOverflowed() const { return m_overflowed; }
+
+	// Calls visitor(const CommandStreamCommand::X&) for every command in order, nested streams are not entered
+	template<typename Visitor>
+	void Visit(Visitor&& visitor) const;
+
+private:
+	friend class CommandStreamRecorder;
+
+	std::unique_ptr<std::byte[]> m_data;
+	size_t                       m_capacity{ 0 };
+	size_t                       m_size{ 0 };
+	uint32_t                     m_numCommands{ 0 };
+	bool                         m_overflowed{ false };
+};
+
+// Mirrors GraphicsCommandContextD3D12, the helpers (Draw, Dispatch1D, ...) are resolved while recording
+class CommandStreamRecorder final
+{
+public:
+	explicit CommandStreamRecorder(CommandStream& stream) : m_stream(stream) {}
+
+	void SetDefaultViewPortAndScissor(glm::ivec2 screenSize);
+	void SetViewport(float topLeftX, float topLeftY, float width, float height, float minDepth = 0.0f, float maxDepth = 1.0f);
+	void SetScissorRect(int32_t left, int32_t top, int32_t right, int32_t bottom);
+	void SetStencilRef(uint32_t stencilRef);
+	void SetBlendFactor(glm::vec4 blendFactor);
+	void SetPrimitiveTopology(CommandStreamTopology topology);
+	void SetPipeline(const PipelineInfo& pipelineBinding);
+	void SetPipelineResources(uint32_t spaceId, const PipelineResourceSpace& resources);
+	void SetIndexBuffer(const BufferResource& indexBuffer);
+	void ClearRenderTarget(const TextureResource& target, glm::vec4 color);
+	void ClearDepthStencilTarget(const TextureResource& target, float depth, uint8_t stencil);
+	void DrawFullScreenTriangle();
+	void Draw(uint32_t vertexCount, uint32_t vertexStartOffset = 0);
+	void DrawIndexed(uint32_t indexCount, uint32_t startIndexLocation = 0, uint32_t baseVertexLocation = 0);
+	void DrawInstanced(uint32_t vertexCountPerInstance, uint32_t instanceCount, uint32_t startVertexLocation = 0, uint32_t startInstanceLocation = 0);
+	void DrawIndexedInstanced(uint32_t indexCountPerInstance, uint32_t instanceCount, uint32_t startIndexLocation, uint32_t baseVertexLocation, uint32_t startInstanceLocation);
+	void Dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ);
+	void Dispatch1D(uint32_t threadCountX, uint32_t groupSizeX);
+	void Dispatch2D(uint32_t threadCountX, uint32_t threadCountY, uint32_t groupSizeX, uint32_t groupSizeY);
+	void Dispatch3D(uint32_t threadCountX, uint32_t threadCountY, uint32_t threadCountZ, uint32_t groupSizeX, uint32_t groupSizeY, uint32_t groupSizeZ);
+	void AddBarrier(Resource& resource, uint32_t newState);
+	void FlushBarriers();
+	void CopyResource(const Resource& destination, const Resource& source);
+	void CopyBufferRegion(Resource& destination, uint64_t destOffset, Resource& source, uint64_t sourceOffset, uint64_t numBytes);
+	// subResourceLayouts: the placed footprints of the backend (SubResourceLayouts for D3D12) of the source buffer
+	void CopyTextureRegion(Resource& destination, Resource& source, size_t sourceOffset, const void* subResourceLayouts, uint32_t numSubResources);
+	// commandSignature: the object of the backend (ID3D12CommandSignature for D3D12). Without a count buffer all maxCommandCount commands run.
+	void ExecuteIndirect(void* commandSignature, uint32_t maxCommandCount, const BufferResource& argumentBuffer, const BufferResource* countBuffer = nullptr);
+	// Replays another stream at this point, e.g. a static one recorded once
+	void ExecuteStream(const CommandStream& stream);
+
+private:
+	template<typename Command>
+	void write(const Command& command);
+
+	CommandStream& m_stream;
+};
+
+// What a replay would submit, nested streams included
+struct CommandStreamStats final
+{
+	uint32_t numCommands{ 0 };
+	uint32_t numDraws{ 0 };
+	uint32_t numDispatches{ 0 };
+	uint32_t numBarriers{ 0 };
+	uint32_t numPipelineChanges{ 0 };
+	uint32_t numResourceBindings{ 0 };
+	uint32_t numCopies{ 0 };
+	uint32_t numIndirectExecutes{ 0 };
+	uint64_t numVertices{ 0 };  // vertices or indices times instances of direct draws
+	uint64_t numThreadGroups{ 0 };
+	uint64_t maxIndirectCommands{ 0 }; // the GPU decides how many run
+};
+
+// The null backend
+CommandStreamStats ReplayCommandStreamNull(const CommandStream& stream);
+
+//=============================================================================
+template<typename Visitor>
+inline void CommandStream::Visit(Visitor&& visitor) const
+{
+	// payloads are copied out, the stream memory only holds bytes
+	const auto visit = [&visitor]<typename Command>(const std::byte* payload, Command command)
+	{
+		memcpy(&command, payload, sizeof(Command));
+		visitor(static_cast<const Command&>(command));
+	};
+
+	for (size_t offset = 0; offset < m_size;)
+	{
+		CommandStreamPacket packet;
+		memcpy(&packet, m_data.get() + offset, sizeof(packet));
+		const std::byte* payload = m_data.get() + offset + sizeof(CommandStreamPacket);
+
+		switch (packet.op)
+		{
+		case CommandStreamOp::setDefaultViewportAndScissor: visit(payload, CommandStreamCommand::SetDefaultViewportAndScissor{}); break;
+		case CommandStreamOp::setViewport:                  visit(payload, CommandStreamCommand::SetViewport{}); break;
+		case CommandStreamOp::setScissorRect:               visit(payload, CommandStreamCommand::SetScissorRect{}); break;
+		case CommandStreamOp::setStencilRef:                visit(payload, CommandStreamCommand::SetStencilRef{}); break;
+		case CommandStreamOp::setBlendFactor:               visit(payload, CommandStreamCommand::SetBlendFactor{}); break;
+		case CommandStreamOp::setPrimitiveTopology:         visit(payload, CommandStreamCommand::SetPrimitiveTopology{}); break;
+		case CommandStreamOp::setPipeline:                  visit(payload, CommandStreamCommand::SetPipeline{}); break;
+		case CommandStreamOp::setPipelineResources:         visit(payload, CommandStreamCommand::SetPipelineResources{}); break;
+		case CommandStreamOp::setIndexBuffer:               visit(payload, CommandStreamCommand::SetIndexBuffer{}); break;
+		case CommandStreamOp::clearRenderTarget:            visit(payload, CommandStreamCommand::ClearRenderTarget{}); break;
+		case CommandStreamOp::clearDepthStencilTarget:      visit(payload, CommandStreamCommand::ClearDepthStencilTarget{}); break;
+		case CommandStreamOp::drawInstanced:                visit(payload, CommandStreamCommand::DrawInstanced{}); break;
+		case CommandStreamOp::drawIndexedInstanced:         visit(payload, CommandStreamCommand::DrawIndexedInstanced{}); break;
+		case CommandStreamOp::dispatch:                     visit(payload, CommandStreamCommand::Dispatch{}); break;
+		case CommandStreamOp::addBarrier:                   visit(payload, CommandStreamCommand::AddBarrier{}); break;
+		case CommandStreamOp::flushBarriers:                visit(payload, CommandStreamCommand::FlushBarriers{}); break;
+		case CommandStreamOp::copyResource:                 visit(payload, CommandStreamCommand::CopyResource{}); break;
+		case CommandStreamOp::copyBufferRegion:             visit(payload, CommandStreamCommand::CopyBufferRegion{}); break;
+		case CommandStreamOp::copyTextureRegion:            visit(payload, CommandStreamCommand::CopyTextureRegion{}); break;
+		case CommandStreamOp::executeIndirect:              visit(payload, CommandStreamCommand::ExecuteIndirect{}); break;
+		case CommandStreamOp::executeStream:                visit(payload, CommandStreamCommand::ExecuteStream{}); break;
+		default: assert(false); return;
+		}
+		offset += packet.size;
+	}
+}
+//=============================================================================
@@ -0,0 +1,114 @@
+﻿#include "stdafx.h"
+#if RENDER_D3D12
+#include "CommandStreamD3D12.h"
+//=============================================================================
+namespace
+{
+	D3D12_PRIMITIVE_TOPOLOGY toD3D12Topology(CommandStreamTopology topology)
+	{
+		switch (topology)
+		{
+		case CommandStreamTopology::pointList:     return D3D_PRIMITIVE_TOPOLOGY_POINTLIST;
+		case CommandStreamTopology::lineList:      return D3D_PRIMITIVE_TOPOLOGY_LINELIST;
+		case CommandStreamTopology::lineStrip:     return D3D_PRIMITIVE_TOPOLOGY_LINESTRIP;
+		case CommandStreamTopology::triangleList:  return D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+		case CommandStreamTopology::triangleStrip: return D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP;
+		}
+		return D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+	}
+}
+//=============================================================================
+void ReplayCommandStream(const CommandStream& stream, GraphicsCommandContextD3D12& context)
+{
+	namespace Command = CommandStreamCommand;
+
+	stream.Visit([&context]<typename T>(const T& command)
+	{
+		if constexpr (std::is_same_v<T, Command::SetDefaultViewportAndScissor>)
+		{
+			context.SetDefaultViewPortAndScissor({ command.width, command.height });
+		}
+		else if constexpr (std::is_same_v<T, Command::SetViewport>)
+		{
+			context.SetViewport({ command.topLeftX, command.topLeftY, command.width, command.height, command.minDepth, command.maxDepth });
+		}
+		else if constexpr (std::is_same_v<T, Command::SetScissorRect>)
+		{
+			context.SetScissorRect({ command.left, command.top, command.right, command.bottom });
+		}
+		else if constexpr (std::is_same_v<T, Command::SetStencilRef>)
+		{
+			context.SetStencilRef(command.stencilRef);
+		}
+		else if constexpr (std::is_same_v<T, Command::SetBlendFactor>)
+		{
+			context.SetBlendFactor({ command.factor[0], command.factor[1], command.factor[2], command.factor[3] });
+		}
+		else if constexpr (std::is_same_v<T, Command::SetPrimitiveTopology>)
+		{
+			context.SetPrimitiveTopology(toD3D12Topology(command.topology));
+		}
+		else if constexpr (std::is_same_v<T, Command::SetPipeline>)
+		{
+			context.SetPipeline(*command.pipeline);
+		}
+		else if constexpr (std::is_same_v<T, Command::SetPipelineResources>)
+		{
+			context.SetPipelineResources(command.spaceId, *command.resources);
+		}
+		else if constexpr (std::is_same_v<T, Command::SetIndexBuffer>)
+		{
+			context.SetIndexBuffer(*command.indexBuffer);
+		}
+		else if constexpr (std::is_same_v<T, Command::ClearRenderTarget>)
+		{
+			context.ClearRenderTarget(*command.target, { command.color[0], command.color[1], command.color[2], command.color[3] });
+		}
+		else if constexpr (std::is_same_v<T, Command::ClearDepthStencilTarget>)
+		{
+			context.ClearDepthStencilTarget(*command.target, command.depth, command.stencil);
+		}
+		else if constexpr (std::is_same_v<T, Command::DrawInstanced>)
+		{
+			context.DrawInstanced(command.vertexCountPerInstance, command.instanceCount, command.startVertexLocation, command.startInstanceLocation);
+		}
+		else if constexpr (std::is_same_v<T, Command::DrawIndexedInstanced>)
+		{
+			context.DrawIndexedInstanced(command.indexCountPerInstance, command.instanceCount, command.startIndexLocation, command.baseVertexLocation, command.startInstanceLocation);
+		}
+		else if constexpr (std::is_same_v<T, Command::Dispatch>)
+		{
+			context.Dispatch(command.groupCountX, command.groupCountY, command.groupCountZ);
+		}
+		else if constexpr (std::is_same_v<T, Command::AddBarrier>)
+		{
+			context.AddBarrier(*command.resource, static_cast<D3D12_RESOURCE_STATES>(command.newState));
+		}
+		else if constexpr (std::is_same_v<T, Command::FlushBarriers>)
+		{
+			context.FlushBarriers();
+		}
+		else if constexpr (std::is_same_v<T, Command::CopyResource>)
+		{
+			context.CopyResource(*command.destination, *command.source);
+		}
+		else if constexpr (std::is_same_v<T, Command::CopyBufferRegion>)
+		{
+			context.CopyBufferRegion(*command.destination, command.destOffset, *command.source, command.sourceOffset, command.numBytes);
+		}
+		else if constexpr (std::is_same_v<T, Command::CopyTextureRegion>)
+		{
+			context.CopyTextureRegion(*command.destination, *command.source, command.sourceOffset, *static_cast<const SubResourceLayouts*>(command.subResourceLayouts), command.numSubResources);
+		}
+		else if constexpr (std::is_same_v<T, Command::ExecuteIndirect>)
+		{
+			context.ExecuteIndirect(static_cast<ID3D12CommandSignature*>(command.commandSignature), command.maxCommandCount, *command.argumentBuffer, command.countBuffer);
+		}
+		else if constexpr (std::is_same_v<T, Command::ExecuteStream>)
+		{
+			ReplayCommandStream(*command.stream, context);
+		}
+	});
+}
+//=============================================================================
+#endif // RENDER_D3D12
@@ -0,0 +1,11 @@
+﻿#pragma once
+
+#if RENDER_D3D12
+
+#include "CommandStream.h"
+#include "oCommandContextD3D12.h"
+
+// Translates a CommandStream into calls of the context, nested streams are replayed in place
+void ReplayCommandStream(const CommandStream& stream, GraphicsCommandContextD3D12& context);
+
+#endif // RENDER_D3D12
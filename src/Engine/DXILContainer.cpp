@@ -0,0 +1,208 @@
+﻿#include "stdafx.h"
+#include "DXILContainer.h"
+#include <fstream>
+#include <filesystem>
+//=============================================================================
+namespace
+{
+	constexpr uint32_t DXIL_CONTAINER_HEADER_SIZE = 4 + 16 + 2 + 2 + 4 + 4; // fourCC, digest, major, minor, containerSize, partCount
+	constexpr uint32_t DXIL_PART_HEADER_SIZE      = 4 + 4; // fourCC, partSize
+	constexpr uint32_t PSV_RESOURCE_BIND_INFO0_SIZE = 4 * sizeof(uint32_t);
+
+	constexpr uint32_t REFLECTION_CACHE_MAGIC   = MakeDXILFourCC('R', 'F', 'L', 'C');
+	constexpr uint32_t REFLECTION_CACHE_VERSION = 2;
+
+	// Values of PSVResourceType from DxilPipelineStateValidation.h
+	enum PSVResourceType : uint32_t
+	{
+		PSV_INVALID = 0,
+		PSV_SAMPLER,
+		PSV_CBV,
+		PSV_SRV_TYPED,
+		PSV_SRV_RAW,
+		PSV_SRV_STRUCTURED,
+		PSV_UAV_TYPED,
+		PSV_UAV_RAW,
+		PSV_UAV_STRUCTURED,
+		PSV_UAV_STRUCTURED_WITH_COUNTER
+	};
+
+	template<typename T>
+	T readValue(const uint8_t* data)
+	{
+		T value;
+		memcpy(&value, data, sizeof(T));
+		return value;
+	}
+
+	bool convertPSVResourceType(uint32_t resType, ShaderBindingType& type)
+	{
+		switch (resType)
+		{
+		case PSV_SAMPLER:
+			type = ShaderBindingType::sampler;
+			return true;
+		case PSV_CBV:
+			type = ShaderBindingType::cbv;
+			return true;
+		case PSV_SRV_TYPED:
+		case PSV_SRV_RAW:
+		case PSV_SRV_STRUCTURED:
+			type = ShaderBindingType::srv;
+			return true;
+		case PSV_UAV_TYPED:
+		case PSV_UAV_RAW:
+		case PSV_UAV_STRUCTURED:
+		case PSV_UAV_STRUCTURED_WITH_COUNTER:
+			type = ShaderBindingType::uav;
+			return true;
+		default:
+			return false;
+		}
+	}
+}
+//=============================================================================
+bool ParseDXILContainerParts(const void* data, size_t size, std::array<uint8_t, 16>& digest, std::vector<DXILContainerPart>& parts)
+{
+	parts.clear();
+
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	if (!bytes || size < DXIL_CONTAINER_HEADER_SIZE) return false;
+	if (readValue<uint32_t>(bytes) != DXIL_FOURCC_CONTAINER) return false;
+
+	memcpy(digest.data(), bytes + 4, digest.size());
+
+	const uint32_t containerSize = readValue<uint32_t>(bytes + 24);
+	const uint32_t partCount = readValue<uint32_t>(bytes + 28);
+	if (containerSize > size) return false;
+
+	const uint64_t partTableEnd = uint64_t(DXIL_CONTAINER_HEADER_SIZE) + uint64_t(partCount) * sizeof(uint32_t);
+	if (partTableEnd > containerSize) return false;
+
+	parts.reserve(partCount);
+	for (uint32_t partIndex = 0; partIndex < partCount; partIndex++)
+	{
+		const uint32_t partOffset = readValue<uint32_t>(bytes + DXIL_CONTAINER_HEADER_SIZE + partIndex * sizeof(uint32_t));
+		if (uint64_t(partOffset) + DXIL_PART_HEADER_SIZE > containerSize) return false;
+
+		DXILContainerPart part;
+		part.fourCC = readValue<uint32_t>(bytes + partOffset);
+		part.size = readValue<uint32_t>(bytes + partOffset + 4);
+		part.data = bytes + partOffset + DXIL_PART_HEADER_SIZE;
+		if (uint64_t(partOffset) + DXIL_PART_HEADER_SIZE + part.size > containerSize) return false;
+
+		parts.push_back(part);
+	}
+
+	return true;
+}
+//=============================================================================
+bool ParseDXILReflection(const void* data, size_t size, ShaderReflectionData& reflection)
+{
+	reflection.bindings.clear();
+
+	std::vector<DXILContainerPart> parts;
+	if (!ParseDXILContainerParts(data, size, reflection.digest, parts)) return false;
+
+	auto psvPart = std::find_if(parts.begin(), parts.end(), [](const DXILContainerPart& part) { return part.fourCC == DXIL_FOURCC_PSV0; });
+	if (psvPart == parts.end()) return false;
+
+	// PSV0 layout: uint32 runtimeInfoSize, runtime info, uint32 resourceCount, [uint32 bindInfoSize, bind infos...], ...
+	const uint8_t* cursor = psvPart->data;
+	const uint8_t* end = psvPart->data + psvPart->size;
+
+	auto canRead = [&](uint64_t numBytes) { return uint64_t(end - cursor) >= numBytes; };
+
+	if (!canRead(sizeof(uint32_t))) return false;
+	const uint32_t runtimeInfoSize = readValue<uint32_t>(cursor);
+	cursor += sizeof(uint32_t);
+	if (!canRead(runtimeInfoSize)) return false;
+	cursor += runtimeInfoSize;
+
+	if (!canRead(sizeof(uint32_t))) return false;
+	const uint32_t resourceCount = readValue<uint32_t>(cursor);
+	cursor += sizeof(uint32_t);
+	if (resourceCount == 0) return true;
+
+	if (!canRead(sizeof(uint32_t))) return false;
+	const uint32_t bindInfoSize = readValue<uint32_t>(cursor);
+	cursor += sizeof(uint32_t);
+	if (bindInfoSize < PSV_RESOURCE_BIND_INFO0_SIZE) return false;
+	if (!canRead(uint64_t(bindInfoSize) * resourceCount)) return false;
+
+	reflection.bindings.reserve(resourceCount);
+	for (uint32_t resourceIndex = 0; resourceIndex < resourceCount; resourceIndex++)
+	{
+		const uint8_t* bindInfo = cursor + uint64_t(resourceIndex) * bindInfoSize;
+
+		ShaderResourceBindingDesc binding;
+		if (!convertPSVResourceType(readValue<uint32_t>(bindInfo), binding.type)) continue;
+		binding.space      = readValue<uint32_t>(bindInfo + 4);
+		binding.lowerBound = readValue<uint32_t>(bindInfo + 8);
+		binding.upperBound = readValue<uint32_t>(bindInfo + 12);
+		if (binding.upperBound != DXIL_UNBOUNDED_RANGE && binding.upperBound < binding.lowerBound) return false;
+
+		reflection.bindings.push_back(binding);
+	}
+
+	return true;
+}
+//=============================================================================
+bool SaveShaderReflection(const std::wstring& path, uint64_t sourceHash, const ShaderReflectionData& reflection)
+{
+	std::ofstream file(std::filesystem::path(path), std::ios::binary | std::ios::trunc);
+	if (!file) return false;
+
+	const uint32_t numBindings = static_cast<uint32_t>(reflection.bindings.size());
+	file.write(reinterpret_cast<const char*>(&REFLECTION_CACHE_MAGIC), sizeof(uint32_t));
+	file.write(reinterpret_cast<const char*>(&REFLECTION_CACHE_VERSION), sizeof(uint32_t));
+	file.write(reinterpret_cast<const char*>(&sourceHash), sizeof(uint64_t));
+	file.write(reinterpret_cast<const char*>(reflection.digest.data()), reflection.digest.size());
+	file.write(reinterpret_cast<const char*>(&numBindings), sizeof(uint32_t));
+
+	for (const ShaderResourceBindingDesc& binding : reflection.bindings)
+	{
+		const uint32_t values[4] = { static_cast<uint32_t>(binding.type), binding.space, binding.lowerBound, binding.upperBound };
+		file.write(reinterpret_cast<const char*>(values), sizeof(values));
+	}
+
+	return file.good();
+}
+//=============================================================================
+bool LoadShaderReflection(const std::wstring& path, uint64_t expectedSourceHash, ShaderReflectionData& reflection)
+{
+	std::ifstream file(std::filesystem::path(path), std::ios::binary);
+	if (!file) return false;
+
+	uint32_t magic = 0;
+	uint32_t version = 0;
+	uint32_t numBindings = 0;
+	uint64_t sourceHash = 0;
+	std::array<uint8_t, 16> digest{};
+
+	file.read(reinterpret_cast<char*>(&magic), sizeof(uint32_t));
+	file.read(reinterpret_cast<char*>(&version), sizeof(uint32_t));
+	file.read(reinterpret_cast<char*>(&sourceHash), sizeof(uint64_t));
+	file.read(reinterpret_cast<char*>(digest.data()), digest.size());
+	file.read(reinterpret_cast<char*>(&numBindings), sizeof(uint32_t));
+
+	if (!file || magic != REFLECTION_CACHE_MAGIC || version != REFLECTION_CACHE_VERSION || sourceHash != expectedSourceHash) return false;
+
+	std::vector<ShaderResourceBindingDesc> bindings(numBindings);
+	for (ShaderResourceBindingDesc& binding : bindings)
+	{
+		uint32_t values[4]{};
+		file.read(reinterpret_cast<char*>(values), sizeof(values));
+		if (!file || values[0] > static_cast<uint32_t>(ShaderBindingType::sampler)) return false;
+
+		binding.type       = static_cast<ShaderBindingType>(values[0]);
+		binding.space      = values[1];
+		binding.lowerBound = values[2];
+		binding.upperBound = values[3];
+	}
+
+	reflection.digest = digest;
+	reflection.bindings = std::move(bindings);
+	return true;
+}
+//=============================================================================
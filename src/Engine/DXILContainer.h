@@ -0,0 +1,54 @@
+﻿#pragma once
+
+// CPU-only reader for the DXIL container (DXBC) format. It does not depend on the D3D12 runtime or on dxcompiler.dll, so it can be used by tools and on any platform.
+// Resource bindings are read from the PSV0 (pipeline state validation) part, which survives -Qstrip_reflect.
+
+constexpr uint32_t MakeDXILFourCC(char a, char b, char c, char d)
+{
+	return static_cast<uint32_t>(static_cast<uint8_t>(a)) | (static_cast<uint32_t>(static_cast<uint8_t>(b)) << 8) | (static_cast<uint32_t>(static_cast<uint8_t>(c)) << 16) | (static_cast<uint32_t>(static_cast<uint8_t>(d)) << 24);
+}
+
+constexpr uint32_t DXIL_FOURCC_CONTAINER = MakeDXILFourCC('D', 'X', 'B', 'C');
+constexpr uint32_t DXIL_FOURCC_PSV0      = MakeDXILFourCC('P', 'S', 'V', '0');
+constexpr uint32_t DXIL_FOURCC_DXIL      = MakeDXILFourCC('D', 'X', 'I', 'L');
+constexpr uint32_t DXIL_UNBOUNDED_RANGE  = UINT32_MAX;
+
+enum class ShaderBindingType : uint8_t
+{
+	cbv = 0,
+	srv,
+	uav,
+	sampler
+};
+
+struct ShaderResourceBindingDesc final
+{
+	ShaderBindingType type{ ShaderBindingType::cbv };
+	uint32_t          space{ 0 };
+	uint32_t          lowerBound{ 0 };
+	uint32_t          upperBound{ 0 }; // inclusive, DXIL_UNBOUNDED_RANGE for unbounded arrays
+
+	bool operator==(const ShaderResourceBindingDesc&) const = default;
+};
+
+struct ShaderReflectionData final
+{
+	std::array<uint8_t, 16>                digest{};
+	std::vector<ShaderResourceBindingDesc> bindings;
+};
+
+struct DXILContainerPart final
+{
+	uint32_t       fourCC{ 0 };
+	const uint8_t* data{ nullptr };
+	uint32_t       size{ 0 };
+};
+
+// Returns false if the blob is not a well-formed container. All offsets and sizes are bounds checked.
+[[nodiscard]] bool ParseDXILContainerParts(const void* data, size_t size, std::array<uint8_t, 16>& digest, std::vector<DXILContainerPart>& parts);
+[[nodiscard]] bool ParseDXILReflection(const void* data, size_t size, ShaderReflectionData& reflection);
+
+// Binary cache stored next to the compiled DXIL, keyed by HashShaderSource() of the compilation that wrote it. A cache that
+// matches lets the DXIL next to it be loaded without compiling, as long as the DXIL digest matches reflection.digest too.
+[[nodiscard]] bool SaveShaderReflection(const std::wstring& path, uint64_t sourceHash, const ShaderReflectionData& reflection);
+[[nodiscard]] bool LoadShaderReflection(const std::wstring& path, uint64_t expectedSourceHash, ShaderReflectionData& reflection);
@@ -0,0 +1,144 @@
+﻿#include "stdafx.h"
+#include "DrawList.h"
+#include "JobSystem.h"
+#include <bit>
+//=============================================================================
+namespace
+{
+	constexpr uint32_t RADIX_BITS = 11; // 6 passes, the histograms of a chunk still fit L1
+	constexpr uint32_t RADIX_SIZE = 1u << RADIX_BITS;
+	constexpr uint32_t NUM_RADIX_PASSES = (64 + RADIX_BITS - 1) / RADIX_BITS;
+	constexpr uint32_t PARALLEL_SORT_CHUNK_SIZE = 16384; // smaller lists are sorted on the calling thread
+
+	// non-negative floats order like their bits, the sign bit is dropped and the lowest mantissa bits are cut off
+	uint64_t quantizeDepth(float viewDepth)
+	{
+		const float depth = viewDepth > 0.0f ? viewDepth : 0.0f; // NaN goes to 0 as well
+		return std::bit_cast<uint32_t>(depth) >> (31 - DRAW_KEY_DEPTH_BITS);
+	}
+
+	uint32_t getDigit(uint64_t key, uint32_t pass)
+	{
+		return static_cast<uint32_t>(key >> (pass * RADIX_BITS)) & (RADIX_SIZE - 1);
+	}
+}
+//=============================================================================
+uint64_t MakeOpaqueDrawKey(uint32_t pass, uint32_t pipeline, uint32_t material, float viewDepth)
+{
+	assert(pass < (1u << DRAW_KEY_PASS_BITS) && pipeline < (1u << DRAW_KEY_PIPELINE_BITS) && material < (1u << DRAW_KEY_MATERIAL_BITS));
+	return uint64_t(pass) << (64 - DRAW_KEY_PASS_BITS) |
+		uint64_t(pipeline) << (DRAW_KEY_MATERIAL_BITS + DRAW_KEY_DEPTH_BITS) |
+		uint64_t(material) << DRAW_KEY_DEPTH_BITS |
+		quantizeDepth(viewDepth);
+}
+//=============================================================================
+uint64_t MakeTransparentDrawKey(uint32_t pass, uint32_t pipeline, uint32_t material, float viewDepth)
+{
+	assert(pass < (1u << DRAW_KEY_PASS_BITS) && pipeline < (1u << DRAW_KEY_PIPELINE_BITS) && material < (1u << DRAW_KEY_MATERIAL_BITS));
+	const uint64_t depth = ((1ull << DRAW_KEY_DEPTH_BITS) - 1) - quantizeDepth(viewDepth);
+	return uint64_t(pass) << (64 - DRAW_KEY_PASS_BITS) |
+		depth << (DRAW_KEY_PIPELINE_BITS + DRAW_KEY_MATERIAL_BITS) |
+		uint64_t(pipeline) << DRAW_KEY_MATERIAL_BITS |
+		uint64_t(material);
+}
+//=============================================================================
+void DrawList::Reserve(uint32_t numDraws)
+{
+	m_items.reserve(numDraws);
+	m_orderedKeys.reserve(numDraws);
+	m_order.reserve(numDraws);
+}
+//=============================================================================
+void DrawList::Clear()
+{
+	m_items.clear();
+	m_orderedKeys.clear();
+	m_order.clear();
+	m_sorted = true;
+}
+//=============================================================================
+void DrawList::Add(uint64_t key, const DrawItem& item)
+{
+	m_sorted = m_sorted && (m_orderedKeys.empty() || m_orderedKeys.back() <= key);
+	m_order.push_back(static_cast<uint32_t>(m_items.size()));
+	m_orderedKeys.push_back(key);
+	m_items.push_back(item);
+}
+//=============================================================================
+void DrawList::SetSharedResources(uint32_t resourceSpace, const PipelineResourceSpace* resources)
+{
+	m_sharedResourceSpace = resourceSpace;
+	m_sharedResources = resources;
+}
+//=============================================================================
+void DrawList::Sort(JobSystem* jobSystem)
+{
+	if (m_sorted) return;
+	m_sorted = true;
+
+	// LSD radix sort of (key, item) pairs, RADIX_BITS per pass. Every chunk counts its digits, the chunks then scatter in order into
+	// their slices of each bucket, which keeps the sort stable. Passes over a digit all keys share are skipped.
+	const uint32_t count = GetCount();
+	const uint32_t numChunks = jobSystem ? std::clamp((count + PARALLEL_SORT_CHUNK_SIZE - 1) / PARALLEL_SORT_CHUNK_SIZE, 1u, (jobSystem->GetNumWorkerThreads() + 1) * 4) : 1;
+	const uint32_t chunkSize = (count + numChunks - 1) / numChunks;
+	m_scratchKeys.resize(count);
+	m_scratchOrder.resize(count);
+	m_histograms.resize(size_t(numChunks) * RADIX_SIZE);
+
+	const auto forEachChunk = [&](auto&& body)
+	{
+		const auto run = [&](uint32_t firstChunk, uint32_t endChunk)
+		{
+			for (uint32_t chunk = firstChunk; chunk < endChunk; chunk++) body(chunk, chunk * chunkSize, std::min((chunk + 1) * chunkSize, count));
+		};
+		if (numChunks > 1) jobSystem->ParallelFor(numChunks, run);
+		else run(0, numChunks);
+	};
+
+	// the bits that differ between any two keys
+	uint64_t differingBits = 0;
+	for (uint64_t key : m_orderedKeys) differingBits |= key ^ m_orderedKeys[0];
+
+	for (uint32_t pass = 0; pass < NUM_RADIX_PASSES; pass++)
+	{
+		if (getDigit(differingBits, pass) == 0) continue;
+
+		const uint64_t* keys = m_orderedKeys.data();
+		const uint32_t* order = m_order.data();
+		forEachChunk([&](uint32_t chunk, uint32_t begin, uint32_t end)
+		{
+			uint32_t* histogram = &m_histograms[size_t(chunk) * RADIX_SIZE];
+			std::fill(histogram, histogram + RADIX_SIZE, 0u);
+			for (uint32_t i = begin; i < end; i++) histogram[getDigit(keys[i], pass)]++;
+		});
+
+		// bucket by bucket, chunk by chunk: the first output position of every (chunk, digit)
+		uint32_t offset = 0;
+		for (uint32_t digit = 0; digit < RADIX_SIZE; digit++)
+		{
+			for (uint32_t chunk = 0; chunk < numChunks; chunk++)
+			{
+				uint32_t& histogram = m_histograms[size_t(chunk) * RADIX_SIZE + digit];
+				const uint32_t digitCount = histogram;
+				histogram = offset;
+				offset += digitCount;
+			}
+		}
+
+		uint64_t* scratchKeys = m_scratchKeys.data();
+		uint32_t* scratchOrder = m_scratchOrder.data();
+		forEachChunk([&](uint32_t chunk, uint32_t begin, uint32_t end)
+		{
+			uint32_t* offsets = &m_histograms[size_t(chunk) * RADIX_SIZE];
+			for (uint32_t i = begin; i < end; i++)
+			{
+				const uint32_t position = offsets[getDigit(keys[i], pass)]++;
+				scratchKeys[position] = keys[i];
+				scratchOrder[position] = order[i];
+			}
+		});
+		m_orderedKeys.swap(m_scratchKeys);
+		m_order.swap(m_scratchOrder);
+	}
+}
+//=============================================================================
@@ -0,0 +1,150 @@
+﻿#pragma once
+
+#include <span>
+
+// Draw submission sorted by 64-bit keys. The key packs what should stay together into the high bits, Sort() orders the draws by
+// it with a radix sort (in parallel on a job system for large lists) and Submit() emits them, setting the pipeline, the resources
+// and the index buffer only when they differ from the previous draw. The ids in the keys only order the draws, the state is
+// compared by pointer: two pipelines sharing an id cost extra state changes but never draw with the wrong state.
+//
+// Opaque key:      pass | pipeline | material | depth front to back
+// Transparent key: pass | depth back to front | pipeline | material
+
+class JobSystem;
+struct PipelineInfo;
+class PipelineResourceSpace;
+struct BufferResource;
+
+constexpr uint32_t DRAW_KEY_PASS_BITS = 6;
+constexpr uint32_t DRAW_KEY_PIPELINE_BITS = 12;
+constexpr uint32_t DRAW_KEY_MATERIAL_BITS = 18;
+constexpr uint32_t DRAW_KEY_DEPTH_BITS = 28;
+static_assert(DRAW_KEY_PASS_BITS + DRAW_KEY_PIPELINE_BITS + DRAW_KEY_MATERIAL_BITS + DRAW_KEY_DEPTH_BITS == 64);
+
+// viewDepth >= 0, ids below 1 << their number of bits
+[[nodiscard]] uint64_t MakeOpaqueDrawKey(uint32_t pass, uint32_t pipeline, uint32_t material, float viewDepth);
+[[nodiscard]] uint64_t MakeTransparentDrawKey(uint32_t pass, uint32_t pipeline, uint32_t material, float viewDepth);
+[[nodiscard]] constexpr uint32_t GetDrawKeyPass(uint64_t key) { return static_cast<uint32_t>(key >> (64 - DRAW_KEY_PASS_BITS)); }
+
+struct DrawItem final
+{
+	const PipelineInfo*          pipeline{ nullptr };
+	const PipelineResourceSpace* resources{ nullptr }; // optional, bound to resourceSpace
+	uint32_t                     resourceSpace{ 0 };
+	const BufferResource*        indexBuffer{ nullptr };
+	uint32_t                     indexCount{ 0 };
+	uint32_t                     instanceCount{ 1 };
+	uint32_t                     startIndexLocation{ 0 };
+	uint32_t                     baseVertexLocation{ 0 };
+	uint32_t                     startInstanceLocation{ 0 };
+};
+
+struct DrawListStats final
+{
+	uint32_t numDraws{ 0 };
+	uint32_t numPipelineChanges{ 0 };
+	uint32_t numResourceChanges{ 0 };
+	uint32_t numIndexBufferChanges{ 0 };
+};
+
+class DrawList final
+{
+public:
+	void Reserve(uint32_t numDraws);
+	void Clear();
+
+	void Add(uint64_t key, const DrawItem& item);
+	// Resources every draw uses, e.g. the pass constants. Submit() binds them after every pipeline change.
+	void SetSharedResources(uint32_t resourceSpace, const PipelineResourceSpace* resources);
+
+	// Orders the draws by key, draws with equal keys keep the order of Add(). Without Sort() they are submitted in that order.
+	void Sort(JobSystem* jobSystem = nullptr);
+
+	// Works with GraphicsCommandContextD3D12 and CommandStreamRecorder. A pipeline change rebinds the resources, the new root
+	// signature invalidates them.
+	template<typename Context>
+	DrawListStats Submit(Context& context) const;
+	// Only the draws of one pass, the list has to be sorted
+	template<typename Context>
+	DrawListStats Submit(Context& context, uint32_t pass) const;
+
+	[[nodiscard]] uint32_t GetCount() const { return static_cast<uint32_t>(m_items.size()); }
+	[[nodiscard]] const DrawItem& GetItem(uint32_t item) const { return m_items[item]; }
+	// Submission order: item indices and their keys
+	[[nodiscard]] std::span<const uint32_t> GetOrder() const { return m_order; }
+	[[nodiscard]] std::span<const uint64_t> GetOrderedKeys() const { return m_orderedKeys; }
+
+private:
+	template<typename Context>
+	DrawListStats submitRange(Context& context, uint32_t begin, uint32_t end) const;
+
+	std::vector<DrawItem>        m_items;
+	std::vector<uint64_t>        m_orderedKeys;
+	std::vector<uint32_t>        m_order;
+	bool                         m_sorted{ true };
+	const PipelineResourceSpace* m_sharedResources{ nullptr };
+	uint32_t                     m_sharedResourceSpace{ 0 };
+
+	// radix sort scratch, kept to avoid reallocations every frame
+	std::vector<uint64_t>        m_scratchKeys;
+	std::vector<uint32_t>        m_scratchOrder;
+	std::vector<uint32_t>        m_histograms;
+};
+
+template<typename Context>
+inline DrawListStats DrawList::Submit(Context& context) const
+{
+	return submitRange(context, 0, GetCount());
+}
+
+template<typename Context>
+inline DrawListStats DrawList::Submit(Context& context, uint32_t pass) const
+{
+	assert(m_sorted);
+	const auto first = std::partition_point(m_orderedKeys.begin(), m_orderedKeys.end(), [pass](uint64_t key) { return GetDrawKeyPass(key) < pass; });
+	const auto end = std::partition_point(first, m_orderedKeys.end(), [pass](uint64_t key) { return GetDrawKeyPass(key) == pass; });
+	return submitRange(context, static_cast<uint32_t>(first - m_orderedKeys.begin()), static_cast<uint32_t>(end - m_orderedKeys.begin()));
+}
+
+template<typename Context>
+inline DrawListStats DrawList::submitRange(Context& context, uint32_t begin, uint32_t end) const
+{
+	DrawListStats stats{};
+	const PipelineInfo* pipeline = nullptr;
+	const PipelineResourceSpace* resources = nullptr;
+	uint32_t resourceSpace = 0;
+	const BufferResource* indexBuffer = nullptr;
+	for (uint32_t position = begin; position < end; position++)
+	{
+		const DrawItem& item = m_items[m_order[position]];
+		assert(item.pipeline && item.indexBuffer);
+		if (item.pipeline != pipeline)
+		{
+			context.SetPipeline(*item.pipeline);
+			pipeline = item.pipeline;
+			resources = nullptr;
+			stats.numPipelineChanges++;
+			if (m_sharedResources)
+			{
+				context.SetPipelineResources(m_sharedResourceSpace, *m_sharedResources);
+				stats.numResourceChanges++;
+			}
+		}
+		if (item.resources && (item.resources != resources || item.resourceSpace != resourceSpace))
+		{
+			context.SetPipelineResources(item.resourceSpace, *item.resources);
+			resources = item.resources;
+			resourceSpace = item.resourceSpace;
+			stats.numResourceChanges++;
+		}
+		if (item.indexBuffer != indexBuffer)
+		{
+			context.SetIndexBuffer(*item.indexBuffer);
+			indexBuffer = item.indexBuffer;
+			stats.numIndexBufferChanges++;
+		}
+		context.DrawIndexedInstanced(item.indexCount, item.instanceCount, item.startIndexLocation, item.baseVertexLocation, item.startInstanceLocation);
+		stats.numDraws++;
+	}
+	return stats;
+}
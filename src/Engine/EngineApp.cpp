@@ -32,6 +32,14 @@ bool EngineApp::Create(const EngineAppCreateInfo& createInfo)
 #endif
 
 	if (!m_log.Create(createInfo.log)) return false;
+	if (!m_profiler.Create(createInfo.profiler)) return false;
+	ProfilerSetThreadName("Main Thread");
+	if (!m_jobs.Create(createInfo.jobs)) return false;
+	if (!m_frameStats.Create(createInfo.frameStats)) return false;
+	if (!m_framePacer.Create(createInfo.pacing)) return false;
+	if (!m_timestep.Create(createInfo.timestep)) return false;
+	m_traceCaptureKey = createInfo.traceCaptureKey;
+	m_pipelinedFrames = createInfo.pipelinedFrames;
 	if (!m_window.Create(createInfo.window)) return false;
 	m_window.ConnectInputSystem(&m_input);
 	if (!m_input.Create(createInfo.input)) return false;
@@ -44,16 +52,29 @@ bool EngineApp::Create(const EngineAppCreateInfo& createInfo)
 	windowData.width = m_window.GetWidth();
 	windowData.height = m_window.GetHeight();
 
-	if (!m_render.Create(windowData, createInfo.render)) return false;
+	RenderSystemCreateInfo renderCreateInfo = createInfo.render;
+	renderCreateInfo.maxFrameLatency = m_framePacer.GetMaxFrameLatency();
+	if (!m_render.Create(windowData, renderCreateInfo)) return false;
 
 	return !RequestExitStatus;
 }
 //=============================================================================
 void EngineApp::Destroy()
 {
+	if (m_inSimulationFrame)
+	{
+		m_inSimulationFrame = false;
+		m_framePipeline.EndSimulationFrame();
+	}
+	m_framePipeline.Destroy();
 	m_render.Destroy();
 	m_input.Destroy();
 	m_window.Destroy();
+	m_timestep.Destroy();
+	m_framePacer.Destroy();
+	m_frameStats.Destroy();
+	m_jobs.Destroy();
+	m_profiler.Destroy();
 	m_log.Destroy();
 	RequestExitStatus = true;
 }
@@ -65,30 +86,15 @@ bool EngineApp::IsShouldClose() const
 //=============================================================================
 void EngineApp::BeginFrame()
 {
-	// TODO: time metric
+	m_frameStats.BeginFrame();
 	{
-		static uint64_t frameCounter = 0;
-		static double elapsedSeconds = 0.0;
-		static std::chrono::high_resolution_clock clock;
-		static auto t0 = clock.now();
-
-		frameCounter++;
-		auto t1 = clock.now();
-		auto deltaTime = t1 - t0;
-		t0 = t1;
-		elapsedSeconds += deltaTime.count() * 1e-9;
-		if (elapsedSeconds > 1.0)
-		{
-			char buffer[500];
-			auto fps = frameCounter / elapsedSeconds;
-			sprintf_s(buffer, 500, "FPS: %f\n", fps);
-			Print(buffer);
-
-			frameCounter = 0;
-			elapsedSeconds = 0.0;
-		}
+		// wait before polling, so the frame sees the latest input. Pipelined, the render thread waits on the swap chain.
+		ScopedFrameStatsTime waitTime(FrameStatsMetric::wait);
+		if (!m_framePipeline.IsPipelined()) m_render.WaitForFrameLatency();
+		m_framePacer.WaitForNextFrame();
 	}
-	
+	m_timestep.Advance(ProfilerGetTime());
+
 	m_window.PollEvent();
 	if (m_window.IsShouldClose())
 	{
@@ -97,12 +103,59 @@ void EngineApp::BeginFrame()
 		return;
 	}
 	m_input.Update();
+	if (m_traceCaptureKey != Key::None && m_input.IsPressedThisFrame(m_traceCaptureKey))
+	{
+		m_profiler.BeginTraceCapture();
+	}
 
-	m_render.Resize(m_window.GetWidth(), m_window.GetHeight());
+	if (!m_framePipeline.IsCreated())
+	{
+		m_render.Resize(m_window.GetWidth(), m_window.GetHeight());
+		return;
+	}
+
+	{
+		ScopedFrameStatsTime waitTime(FrameStatsMetric::wait);
+		m_renderPacketIndex = m_framePipeline.BeginSimulationFrame();
+		m_inSimulationFrame = true;
+	}
+	EngineRenderPacket& packet = m_enginePackets[m_renderPacketIndex];
+	packet.frameBufferWidth = m_window.GetWidth();
+	packet.frameBufferHeight = m_window.GetHeight();
+	if (!m_framePipeline.IsPipelined()) m_render.Resize(packet.frameBufferWidth, packet.frameBufferHeight);
 }
 //=============================================================================
 void EngineApp::EndFrame()
 {
+	if (m_inSimulationFrame)
+	{
+		m_inSimulationFrame = false;
+		m_framePipeline.EndSimulationFrame();
+	}
 	if (IsShouldClose()) return;
+
+	m_profiler.EndFrame();
+}
+//=============================================================================
+bool EngineApp::SetRenderFunction(FramePipeline::RenderFunction render)
+{
+	if (m_framePipeline.IsCreated())
+	{
+		Fatal("EngineApp::SetRenderFunction() called twice");
+		return false;
+	}
+
+	FramePipelineCreateInfo createInfo{};
+	createInfo.pipelined = m_pipelinedFrames;
+	return m_framePipeline.Create(createInfo, [this, pipelined = m_pipelinedFrames, render = std::move(render)](uint32_t packetIndex, uint64_t frameIndex)
+	{
+		if (pipelined)
+		{
+			const EngineRenderPacket& packet = m_enginePackets[packetIndex];
+			m_render.WaitForFrameLatency();
+			m_render.Resize(packet.frameBufferWidth, packet.frameBufferHeight);
+		}
+		render(packetIndex, frameIndex);
+	});
 }
 //=============================================================================
\ No newline at end of file
@@ -1,16 +1,30 @@
 ﻿#pragma once
 
 #include "LogSystem.h"
+#include "Profiler.h"
+#include "JobSystem.h"
+#include "FrameStats.h"
+#include "FramePacer.h"
+#include "FramePipeline.h"
+#include "FixedTimestep.h"
 #include "WindowSystem.h"
 #include "InputSystem.h"
 #include "RenderSystem.h"
 
 struct EngineAppCreateInfo final
 {
-	LogSystemCreateInfo    log{};
-	WindowSystemCreateInfo window{};
-	InputSystemCreateInfo  input{};
-	RenderSystemCreateInfo render{};
+	LogSystemCreateInfo      log{};
+	ProfilerSystemCreateInfo profiler{};
+	JobSystemCreateInfo      jobs{};
+	FrameStatsCreateInfo     frameStats{};
+	FramePacerCreateInfo     pacing{};
+	FixedTimestepCreateInfo  timestep{};
+	WindowSystemCreateInfo   window{};
+	InputSystemCreateInfo    input{};
+	RenderSystemCreateInfo   render{};
+
+	Key                      traceCaptureKey{ Key::F11 }; // starts a profiler trace capture, Key::None - disabled
+	bool                     pipelinedFrames{ false };     // SetRenderFunction() renders on a render thread, one frame behind the simulation
 };
 
 class EngineApp final
@@ -24,16 +38,50 @@ public:
 	void BeginFrame();
 	void EndFrame();
 
+	// Moves rendering into render(), see FramePipeline.h. Between BeginFrame() and EndFrame() the game fills the render packet
+	// GetRenderPacketIndex() and must not read the render state, render() only reads its own packet.
+	[[nodiscard]] bool SetRenderFunction(FramePipeline::RenderFunction render);
+	[[nodiscard]] uint32_t GetRenderPacketIndex() const { return m_renderPacketIndex; }
+
+	// Runs the simulation ticks of the frame: while (engine.StepSimulation()) Update(engine.GetTimestep().GetTickSeconds());
+	// Render with engine.GetTimestep().GetInterpolationAlpha() between the last two simulated states.
+	[[nodiscard]] bool StepSimulation() { return m_timestep.Step(); }
+	[[nodiscard]] const FixedTimestep& GetTimestep() const { return m_timestep; }
+
 	[[nodiscard]] auto& GetLogSystem() { return m_log; }
+	[[nodiscard]] auto& GetProfilerSystem() { return m_profiler; }
+	[[nodiscard]] auto& GetJobSystem() { return m_jobs; }
+	[[nodiscard]] auto& GetFrameStats() { return m_frameStats; }
+	[[nodiscard]] auto& GetFramePacer() { return m_framePacer; }
 	[[nodiscard]] auto& GetWindowSystem() { return m_window; }
 	[[nodiscard]] auto& GetInputSystem() { return m_input; }
 	[[nodiscard]] auto& GetRenderSystem() { return m_render; }
 
 private:
-	LogSystem    m_log{};
-	WindowSystem m_window{};
-	InputSystem  m_input{};
-	RenderSystem m_render{};
+	LogSystem      m_log{};
+	ProfilerSystem m_profiler{};
+	JobSystem      m_jobs{};
+	FrameStats     m_frameStats{};
+	FramePacer     m_framePacer{};
+	FixedTimestep  m_timestep{};
+	WindowSystem   m_window{};
+	InputSystem    m_input{};
+	RenderSystem   m_render{};
+
+	Key            m_traceCaptureKey{ Key::None };
+
+	// frame state the render function of a pipelined frame needs from the main thread
+	struct EngineRenderPacket final
+	{
+		uint32_t frameBufferWidth{ 0 };
+		uint32_t frameBufferHeight{ 0 };
+	};
+
+	FramePipeline                      m_framePipeline{};
+	RenderPackets<EngineRenderPacket>  m_enginePackets{};
+	bool                               m_pipelinedFrames{ false };
+	bool                               m_inSimulationFrame{ false };
+	uint32_t                           m_renderPacketIndex{ 0 };
 
 
 };
\ No newline at end of file
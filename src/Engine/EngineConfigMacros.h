@@ -25,10 +25,25 @@
 #	define PLATFORM_EMSCRIPTEN 1
 #endif
 
+// D3D12 exists on Windows only. Elsewhere the platform independent parts of the engine build without it, see src/CMakeLists.txt.
+#if !PLATFORM_WINDOWS
+#	undef RENDER_D3D12
+#	define RENDER_D3D12 0
+#endif
+
 #if defined(_DEBUG)
 #	define RHI_VALIDATION_ENABLED 1
 #else
 #	define RHI_VALIDATION_ENABLED 0
 #endif
 
+// In-engine CPU profiler fed by SCOPED_CPU_MARKER. When 0, the markers only forward to PIX (or compile to nothing).
+#define ENABLE_PROFILER 1
+
+#if PLATFORM_WINDOWS && RENDER_D3D12
+#	define ENABLE_PIX_MARKERS 1
+#else
+#	define ENABLE_PIX_MARKERS 0
+#endif
+
 #define ENABLE_UNIT_TEST 1
\ No newline at end of file
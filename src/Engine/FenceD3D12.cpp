@@ -4,6 +4,7 @@
 #include "Log.h"
 #include "HelperD3D12.h"
 #include "GPUMarker.h"
+#include "FrameStats.h"
 //=============================================================================
 bool FenceD3D12::Create(ID3D12Device14* device, const char* debugName)
 {
@@ -44,6 +45,7 @@ bool FenceD3D12::WaitOnCPU(uint64_t FenceWaitValue, DWORD timeout) const
 	if (!IsFenceComplete(FenceWaitValue))
 	{
 		SCOPED_CPU_MARKER_C("GPU_BOUND", 0xFF005500);
+		ScopedFrameStatsTime waitTime(FrameStatsMetric::wait);
 		HRESULT result = m_fence->SetEventOnCompletion(FenceWaitValue, m_event.Get());
 		if (FAILED(result))
 		{
@@ -0,0 +1,117 @@
+﻿#include "stdafx.h"
+#include "Fiber.h"
+#include "Log.h"
+//=============================================================================
+Fiber::~Fiber()
+{
+	Destroy();
+}
+//=============================================================================
+#if PLATFORM_WINDOWS
+//=============================================================================
+bool Fiber::Create(size_t stackSize, EntryFunction entry, void* userData)
+{
+	assert(!m_handle);
+	m_entry = entry;
+	m_userData = userData;
+	m_handle = CreateFiberEx(0, stackSize, FIBER_FLAG_FLOAT_SWITCH, &Fiber::entryPoint, this);
+	if (!m_handle)
+	{
+		Fatal("CreateFiberEx() failed: " + std::to_string(GetLastError()));
+		return false;
+	}
+	return true;
+}
+//=============================================================================
+void Fiber::Destroy()
+{
+	if (m_handle && !m_isThread) DeleteFiber(m_handle);
+	m_handle = nullptr;
+}
+//=============================================================================
+bool Fiber::ConvertCurrentThread()
+{
+	assert(!m_handle);
+	m_handle = ConvertThreadToFiberEx(nullptr, FIBER_FLAG_FLOAT_SWITCH);
+	if (!m_handle)
+	{
+		Fatal("ConvertThreadToFiberEx() failed: " + std::to_string(GetLastError()));
+		return false;
+	}
+	m_isThread = true;
+	return true;
+}
+//=============================================================================
+void Fiber::RevertCurrentThread()
+{
+	if (m_handle && m_isThread) ConvertFiberToThread();
+	m_handle = nullptr;
+	m_isThread = false;
+}
+//=============================================================================
+void Fiber::Switch([[maybe_unused]] Fiber& from, Fiber& to)
+{
+	assert(GetCurrentFiber() == from.m_handle);
+	SwitchToFiber(to.m_handle);
+}
+//=============================================================================
+void WINAPI Fiber::entryPoint(void* fiber)
+{
+	Fiber& self = *static_cast<Fiber*>(fiber);
+	self.m_entry(self.m_userData);
+	assert(false && "fiber entry function returned");
+}
+//=============================================================================
+#else
+//=============================================================================
+bool Fiber::Create(size_t stackSize, EntryFunction entry, void* userData)
+{
+	assert(!m_stack);
+	m_entry = entry;
+	m_userData = userData;
+	m_stack.reset(new std::byte[stackSize]); // not zeroed, untouched pages stay uncommitted
+
+	if (getcontext(&m_context) != 0)
+	{
+		Fatal("getcontext() failed");
+		return false;
+	}
+	m_context.uc_stack.ss_sp = m_stack.get();
+	m_context.uc_stack.ss_size = stackSize;
+	m_context.uc_link = nullptr;
+
+	// makecontext() passes int arguments only, the pointer goes in two halves
+	const uint64_t fiber = reinterpret_cast<uintptr_t>(this);
+	makecontext(&m_context, reinterpret_cast<void(*)()>(&Fiber::entryPoint), 2, static_cast<uint32_t>(fiber), static_cast<uint32_t>(fiber >> 32));
+	return true;
+}
+//=============================================================================
+void Fiber::Destroy()
+{
+	m_stack.reset();
+}
+//=============================================================================
+bool Fiber::ConvertCurrentThread()
+{
+	// the context of the thread is saved by the first Switch() away from it
+	return true;
+}
+//=============================================================================
+void Fiber::RevertCurrentThread()
+{
+}
+//=============================================================================
+void Fiber::Switch(Fiber& from, Fiber& to)
+{
+	swapcontext(&from.m_context, &to.m_context);
+}
+//=============================================================================
+void Fiber::entryPoint(uint32_t fiberLow, uint32_t fiberHigh)
+{
+	Fiber& self = *reinterpret_cast<Fiber*>(static_cast<uintptr_t>(fiberLow) | (static_cast<uintptr_t>(fiberHigh) << 32));
+	self.m_entry(self.m_userData);
+	assert(false && "fiber entry function returned");
+}
+//=============================================================================
+#endif // PLATFORM_WINDOWS
+//=============================================================================
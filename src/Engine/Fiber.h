@@ -0,0 +1,42 @@
+﻿#pragma once
+
+#if !PLATFORM_WINDOWS
+#	include <ucontext.h>
+#endif
+
+// Cooperative user-mode thread: its own stack and register context, switched explicitly with Fiber::Switch().
+// Windows fibers on Windows, ucontext elsewhere. A thread has to call ConvertCurrentThread() before it switches to any fiber,
+// the fiber it gets back represents the thread's original stack.
+
+class Fiber final
+{
+public:
+	using EntryFunction = void(*)(void* userData);
+
+	~Fiber();
+
+	// entry must never return, it switches away instead
+	[[nodiscard]] bool Create(size_t stackSize, EntryFunction entry, void* userData);
+	void Destroy();
+
+	[[nodiscard]] bool ConvertCurrentThread();
+	void RevertCurrentThread();
+
+	// Saves the current context into from and continues to. from must be the fiber running on this thread.
+	static void Switch(Fiber& from, Fiber& to);
+
+private:
+#if PLATFORM_WINDOWS
+	static void WINAPI entryPoint(void* fiber);
+
+	void*                        m_handle{ nullptr };
+	bool                         m_isThread{ false };
+#else
+	static void entryPoint(uint32_t fiberLow, uint32_t fiberHigh);
+
+	ucontext_t                   m_context{};
+	std::unique_ptr<std::byte[]> m_stack;
+#endif
+	EntryFunction                m_entry{ nullptr };
+	void*                        m_userData{ nullptr };
+};
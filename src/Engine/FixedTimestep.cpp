@@ -0,0 +1,65 @@
+﻿#include "stdafx.h"
+#include "FixedTimestep.h"
+#include "Log.h"
+//=============================================================================
+bool FixedTimestep::Create(const FixedTimestepCreateInfo& createInfo)
+{
+	if (createInfo.tickRate <= 0.0 || createInfo.maxTicksPerFrame == 0 || createInfo.maxFrameSeconds <= 0.0)
+	{
+		Fatal("FixedTimestep: invalid create info");
+		return false;
+	}
+
+	m_createInfo = createInfo;
+	m_tickDuration = std::max<uint64_t>(static_cast<uint64_t>(1e9 / m_createInfo.tickRate), 1);
+	m_lastTime = 0;
+	m_frameDuration = 0;
+	m_accumulator = 0;
+	m_tickIndex = 0;
+	m_droppedTicks = 0;
+	m_frameTicks = 0;
+	m_pendingTicks = 0;
+	m_alpha = 0.0;
+	return true;
+}
+//=============================================================================
+void FixedTimestep::Destroy()
+{
+	m_tickDuration = 0;
+}
+//=============================================================================
+void FixedTimestep::Advance(uint64_t time)
+{
+	if (m_tickDuration == 0) return;
+
+	// ticks the previous frame did not step are dropped
+	m_droppedTicks += m_pendingTicks;
+	m_accumulator -= static_cast<uint64_t>(m_pendingTicks) * m_tickDuration;
+
+	m_frameDuration = m_lastTime != 0 && time > m_lastTime ? time - m_lastTime : 0;
+	m_lastTime = time;
+	m_frameDuration = std::min(m_frameDuration, static_cast<uint64_t>(m_createInfo.maxFrameSeconds * 1e9));
+	m_accumulator += m_frameDuration;
+
+	uint64_t ticks = m_accumulator / m_tickDuration;
+	if (ticks > m_createInfo.maxTicksPerFrame)
+	{
+		m_droppedTicks += ticks - m_createInfo.maxTicksPerFrame;
+		m_accumulator -= (ticks - m_createInfo.maxTicksPerFrame) * m_tickDuration;
+		ticks = m_createInfo.maxTicksPerFrame;
+	}
+	m_frameTicks = static_cast<uint32_t>(ticks);
+	m_pendingTicks = m_frameTicks;
+	m_alpha = static_cast<double>(m_accumulator - ticks * m_tickDuration) / static_cast<double>(m_tickDuration);
+}
+//=============================================================================
+bool FixedTimestep::Step()
+{
+	if (m_pendingTicks == 0) return false;
+
+	m_pendingTicks--;
+	m_accumulator -= m_tickDuration;
+	m_tickIndex++;
+	return true;
+}
+//=============================================================================
@@ -0,0 +1,47 @@
+﻿#pragma once
+
+// Fixed-timestep simulation clock. Every frame adds its real duration to an accumulator and runs as many simulation ticks of
+// a constant duration as fit in it. Rendering interpolates between the last two simulated states with GetInterpolationAlpha().
+// Ticks per frame are capped: when the simulation falls behind (debugger break, load hitch, or a tick slower than real time)
+// the time it can not catch up on is dropped instead of piling up into ever longer frames.
+
+struct FixedTimestepCreateInfo final
+{
+	double   tickRate{ 60.0 };          // simulation ticks per second
+	uint32_t maxTicksPerFrame{ 4 };     // catch-up limit
+	double   maxFrameSeconds{ 0.25 };   // a longer frame counts as this long (e.g. after a breakpoint)
+};
+
+class FixedTimestep final
+{
+public:
+	[[nodiscard]] bool Create(const FixedTimestepCreateInfo& createInfo);
+	void Destroy();
+
+	// Adds the time since the previous call to the accumulator, time in ProfilerGetTime() nanoseconds.
+	// The first call starts the clock and runs no tick.
+	void Advance(uint64_t time);
+	// Consumes one tick of the current frame, false when the frame has none left: while (timestep.Step()) Update(timestep.GetTickSeconds());
+	[[nodiscard]] bool Step();
+
+	// Fraction of a tick the simulation is behind real time, after the frame's ticks: render lerp(previous, current, alpha)
+	[[nodiscard]] double GetInterpolationAlpha() const { return m_alpha; }
+	[[nodiscard]] double GetTickSeconds() const { return static_cast<double>(m_tickDuration) * 1e-9; }
+	[[nodiscard]] double GetFrameSeconds() const { return static_cast<double>(m_frameDuration) * 1e-9; }
+	[[nodiscard]] double GetSimulationSeconds() const { return static_cast<double>(m_tickIndex) * GetTickSeconds(); }
+	[[nodiscard]] uint64_t GetTickIndex() const { return m_tickIndex; }         // ticks run since Create()
+	[[nodiscard]] uint32_t GetFrameTicks() const { return m_frameTicks; }       // ticks of the current frame
+	[[nodiscard]] uint64_t GetNumDroppedTicks() const { return m_droppedTicks; } // ticks lost to the catch-up limit
+
+private:
+	FixedTimestepCreateInfo m_createInfo{};
+	uint64_t                m_tickDuration{ 0 };  // ns
+	uint64_t                m_lastTime{ 0 };
+	uint64_t                m_frameDuration{ 0 };
+	uint64_t                m_accumulator{ 0 };   // ns not simulated yet, the pending ticks included
+	uint64_t                m_tickIndex{ 0 };
+	uint64_t                m_droppedTicks{ 0 };
+	uint32_t                m_frameTicks{ 0 };
+	uint32_t                m_pendingTicks{ 0 };
+	double                  m_alpha{ 0.0 };
+};
@@ -0,0 +1,120 @@
+﻿#include "stdafx.h"
+#include "FramePacer.h"
+#include "Profiler.h"
+#include "Log.h"
+#include <thread>
+#if defined(_M_X64) || defined(__x86_64__)
+#	include <immintrin.h>
+#endif
+//=============================================================================
+SystemFramePacerClock::SystemFramePacerClock()
+{
+#if PLATFORM_WINDOWS
+	// Windows 10 1803+, the default timer has the resolution of the system tick (up to 15.6 ms)
+	m_timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+#endif
+}
+//=============================================================================
+SystemFramePacerClock::~SystemFramePacerClock()
+{
+#if PLATFORM_WINDOWS
+	if (m_timer) CloseHandle(m_timer);
+#endif
+}
+//=============================================================================
+uint64_t SystemFramePacerClock::Now()
+{
+	return ProfilerGetTime();
+}
+//=============================================================================
+void SystemFramePacerClock::Sleep(uint64_t nanoseconds)
+{
+#if PLATFORM_WINDOWS
+	if (m_timer)
+	{
+		LARGE_INTEGER dueTime;
+		dueTime.QuadPart = -static_cast<LONGLONG>(nanoseconds / 100); // relative, in 100 ns units
+		if (SetWaitableTimerEx(m_timer, &dueTime, 0, nullptr, nullptr, nullptr, 0))
+		{
+			WaitForSingleObject(m_timer, INFINITE);
+			return;
+		}
+	}
+#endif
+	std::this_thread::sleep_for(std::chrono::nanoseconds(nanoseconds));
+}
+//=============================================================================
+void SystemFramePacerClock::Spin()
+{
+#if defined(_M_X64) || defined(__x86_64__)
+	_mm_pause();
+#else
+	std::this_thread::yield();
+#endif
+}
+//=============================================================================
+bool FramePacer::Create(const FramePacerCreateInfo& createInfo, FramePacerClock* clock)
+{
+	if (createInfo.targetFPS < 0.0 || createInfo.spinThresholdMs < 0.0)
+	{
+		Fatal("FramePacer: invalid create info");
+		return false;
+	}
+
+	m_createInfo = createInfo;
+	m_clock = clock ? clock : &m_systemClock;
+	m_sleepMargin = static_cast<uint64_t>(m_createInfo.spinThresholdMs * 1e6);
+	SetTargetFPS(m_createInfo.targetFPS);
+	return true;
+}
+//=============================================================================
+void FramePacer::Destroy()
+{
+	m_clock = nullptr;
+	m_framePeriod = 0;
+	m_nextDeadline = 0;
+}
+//=============================================================================
+void FramePacer::SetTargetFPS(double targetFPS)
+{
+	m_createInfo.targetFPS = std::max(targetFPS, 0.0);
+	m_framePeriod = m_createInfo.targetFPS > 0.0 ? static_cast<uint64_t>(1e9 / m_createInfo.targetFPS) : 0;
+	m_nextDeadline = 0;
+}
+//=============================================================================
+uint64_t FramePacer::WaitForNextFrame()
+{
+	if (!m_clock || m_framePeriod == 0) return 0;
+
+	const uint64_t beginTime = m_clock->Now();
+	// The first frame, or a frame that ran late by more than a whole period: restart the cadence from now
+	// instead of letting a burst of short frames catch up.
+	if (m_nextDeadline == 0 || beginTime > m_nextDeadline + m_framePeriod)
+	{
+		m_nextDeadline = beginTime + m_framePeriod;
+		return 0;
+	}
+
+	const uint64_t spinThreshold = static_cast<uint64_t>(m_createInfo.spinThresholdMs * 1e6);
+	uint64_t now = beginTime;
+	while (now < m_nextDeadline && m_nextDeadline - now > m_sleepMargin)
+	{
+		const uint64_t sleepTime = m_nextDeadline - now - m_sleepMargin;
+		m_clock->Sleep(sleepTime);
+		const uint64_t wakeTime = m_clock->Now();
+
+		// Keep the margin above the worst recent oversleep, decaying back to the spin threshold when the timer behaves
+		const uint64_t oversleep = wakeTime - now > sleepTime ? wakeTime - now - sleepTime : 0;
+		m_sleepMargin = std::max(spinThreshold + oversleep, m_sleepMargin - (m_sleepMargin - spinThreshold) / 16);
+		now = wakeTime;
+	}
+	while (now < m_nextDeadline)
+	{
+		m_clock->Spin();
+		now = m_clock->Now();
+	}
+
+	m_nextDeadline += m_framePeriod;
+	return now - beginTime;
+}
+//=============================================================================
@@ -0,0 +1,72 @@
+﻿#pragma once
+
+// Frame pacing. EngineApp::BeginFrame() first waits on the frame latency of the swap chain (RenderSystem::WaitForFrameLatency()),
+// then FramePacer::WaitForNextFrame() holds the frame back until the target frame rate allows it to start, and only then polls input.
+// Input is sampled as late as possible and the CPU never runs more than maxFrameLatency frames ahead of the display.
+//
+// The limiter sleeps coarsely while the deadline is far away and spins for the last part, the sleep margin adapts to the
+// measured oversleep of the OS timer. All time goes through FramePacerClock, so the limiter runs against a fake clock in tests.
+
+struct FramePacerCreateInfo final
+{
+	double   targetFPS{ 0.0 };         // frame rate limit, 0 - unlimited
+	uint32_t maxFrameLatency{ 2 };     // frames the CPU may queue ahead of the display
+	bool     lowLatency{ false };      // maxFrameLatency 1: the least input lag, at the cost of CPU/GPU overlap
+	double   spinThresholdMs{ 1.0 };   // the limiter never sleeps closer to the deadline than this
+};
+
+class FramePacerClock
+{
+public:
+	virtual ~FramePacerClock() = default;
+
+	// nanoseconds, monotonic
+	virtual uint64_t Now() = 0;
+	// may return early or late
+	virtual void     Sleep(uint64_t nanoseconds) = 0;
+	// one iteration of the spin wait
+	virtual void     Spin() = 0;
+};
+
+// ProfilerGetTime() and the most precise sleep of the platform (a high resolution waitable timer on Windows)
+class SystemFramePacerClock final : public FramePacerClock
+{
+public:
+	SystemFramePacerClock();
+	~SystemFramePacerClock();
+
+	uint64_t Now() final;
+	void     Sleep(uint64_t nanoseconds) final;
+	void     Spin() final;
+
+private:
+#if PLATFORM_WINDOWS
+	HANDLE m_timer{ nullptr };
+#endif
+};
+
+class FramePacer final
+{
+public:
+	// clock - nullptr for the system clock, otherwise it must outlive the pacer
+	[[nodiscard]] bool Create(const FramePacerCreateInfo& createInfo, FramePacerClock* clock = nullptr);
+	void Destroy();
+
+	// Blocks until the next frame may start. Returns the time waited, in nanoseconds.
+	uint64_t WaitForNextFrame();
+
+	void SetTargetFPS(double targetFPS);
+	[[nodiscard]] double GetTargetFPS() const { return m_createInfo.targetFPS; }
+	[[nodiscard]] bool IsLowLatency() const { return m_createInfo.lowLatency; }
+	// what the swap chain has to be created with
+	[[nodiscard]] uint32_t GetMaxFrameLatency() const { return m_createInfo.lowLatency ? 1 : std::max(m_createInfo.maxFrameLatency, 1u); }
+	[[nodiscard]] uint64_t GetSleepMargin() const { return m_sleepMargin; }
+
+private:
+	FramePacerCreateInfo   m_createInfo{};
+	SystemFramePacerClock  m_systemClock;
+	FramePacerClock*       m_clock{ nullptr };
+	uint64_t               m_framePeriod{ 0 };    // ns, 0 - unlimited
+	uint64_t               m_nextDeadline{ 0 };   // 0 - the next frame starts the cadence
+	uint64_t               m_sleepMargin{ 0 };    // ns before the deadline where sleeping stops and spinning begins
+};
@@ -0,0 +1,120 @@
+﻿#include "stdafx.h"
+#include "FramePipeline.h"
+#include "Profiler.h"
+#include "GPUMarker.h"
+#include "Log.h"
+//=============================================================================
+void HandoffFence::Signal(uint64_t value)
+{
+	{
+		std::lock_guard lock(m_mutex);
+		m_value.store(value, std::memory_order_release);
+	}
+	m_condition.notify_all();
+}
+//=============================================================================
+void HandoffFence::Wait(uint64_t value)
+{
+	if (m_value.load(std::memory_order_acquire) >= value) return;
+
+	std::unique_lock lock(m_mutex);
+	m_condition.wait(lock, [this, value] { return m_value.load(std::memory_order_acquire) >= value; });
+}
+//=============================================================================
+FramePipeline::~FramePipeline()
+{
+	assert(!m_renderThread.joinable());
+}
+//=============================================================================
+bool FramePipeline::Create(const FramePipelineCreateInfo& createInfo, RenderFunction render)
+{
+	assert(!IsCreated());
+	if (!render)
+	{
+		Fatal("FramePipeline: no render function");
+		return false;
+	}
+
+	m_createInfo = createInfo;
+	m_render = std::move(render);
+	m_frameIndex = 0;
+	m_inSimulation = false;
+	m_simulatedFence.Signal(0);
+	m_renderedFence.Signal(0);
+	m_stopFrame.store(UINT64_MAX, std::memory_order_relaxed);
+
+	if (m_createInfo.pipelined)
+	{
+		m_renderThread = std::thread(&FramePipeline::renderThread, this);
+	}
+	return true;
+}
+//=============================================================================
+void FramePipeline::Destroy()
+{
+	assert(!m_inSimulation);
+	if (m_renderThread.joinable())
+	{
+		m_stopFrame.store(m_frameIndex, std::memory_order_relaxed);
+		m_simulatedFence.Signal(UINT64_MAX);
+		m_renderThread.join();
+	}
+	m_render = nullptr;
+}
+//=============================================================================
+uint32_t FramePipeline::BeginSimulationFrame()
+{
+	assert(IsCreated() && !m_inSimulation);
+	m_inSimulation = true;
+
+	// The packet of this frame was last read by frame N - 2, which is rendered once the fence reaches N - 1
+	if (m_frameIndex >= FRAME_PIPELINE_NUM_PACKETS && m_renderedFence.GetValue() < m_frameIndex - 1)
+	{
+		SCOPED_CPU_MARKER("WaitForRenderThread");
+		m_renderedFence.Wait(m_frameIndex - 1);
+	}
+	return static_cast<uint32_t>(m_frameIndex % FRAME_PIPELINE_NUM_PACKETS);
+}
+//=============================================================================
+void FramePipeline::EndSimulationFrame()
+{
+	assert(m_inSimulation);
+	m_inSimulation = false;
+
+	if (IsPipelined())
+	{
+		m_simulatedFence.Signal(m_frameIndex + 1);
+	}
+	else
+	{
+		m_render(static_cast<uint32_t>(m_frameIndex % FRAME_PIPELINE_NUM_PACKETS), m_frameIndex);
+		m_renderedFence.Signal(m_frameIndex + 1);
+	}
+	m_frameIndex++;
+}
+//=============================================================================
+void FramePipeline::Flush()
+{
+	if (m_renderedFence.GetValue() >= m_frameIndex) return;
+
+	SCOPED_CPU_MARKER("WaitForRenderThread");
+	m_renderedFence.Wait(m_frameIndex);
+}
+//=============================================================================
+void FramePipeline::renderThread()
+{
+	ProfilerSetThreadName(m_createInfo.renderThreadName);
+
+	for (uint64_t frameIndex = 0;; frameIndex++)
+	{
+		m_simulatedFence.Wait(frameIndex + 1);
+		if (frameIndex >= m_stopFrame.load(std::memory_order_relaxed)) break;
+
+		{
+			SCOPED_CPU_MARKER("RenderFrame");
+			m_render(static_cast<uint32_t>(frameIndex % FRAME_PIPELINE_NUM_PACKETS), frameIndex);
+		}
+		m_renderedFence.Signal(frameIndex + 1);
+	}
+}
+//=============================================================================
@@ -0,0 +1,83 @@
+﻿#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <thread>
+
+// Pipelined frames. The simulation (the main thread) fills render packet N+1 while the render thread records frame N from packet N.
+// The packets are double-buffered: every frame writes the packet FramePipeline::BeginSimulationFrame() returns and never touches it
+// again after EndSimulationFrame(), the render thread only reads it. Two hand-off fences order the threads:
+//   simulated - frames handed to the render thread, the render thread waits on it for its next packet
+//   rendered  - frames the render thread finished, the simulation waits on it before it overwrites a packet
+// Without pipelining EndSimulationFrame() renders the packet on the calling thread, the game code is the same in both modes.
+
+constexpr uint32_t FRAME_PIPELINE_NUM_PACKETS = 2;
+
+// Monotonic counter threads wait on, like a D3D12 fence on the CPU
+class HandoffFence final
+{
+public:
+	void     Signal(uint64_t value);
+	void     Wait(uint64_t value);
+	[[nodiscard]] uint64_t GetValue() const { return m_value.load(std::memory_order_acquire); }
+
+private:
+	std::mutex              m_mutex;
+	std::condition_variable m_condition;
+	std::atomic<uint64_t>   m_value{ 0 };
+};
+
+struct FramePipelineCreateInfo final
+{
+	bool        pipelined{ true };                  // false - render on the simulation thread
+	const char* renderThreadName{ "Render Thread" };
+};
+
+class FramePipeline final
+{
+public:
+	// Called once per frame with the packet index of that frame, on the render thread when pipelined
+	using RenderFunction = std::function<void(uint32_t packetIndex, uint64_t frameIndex)>;
+
+	~FramePipeline();
+
+	[[nodiscard]] bool Create(const FramePipelineCreateInfo& createInfo, RenderFunction render);
+	// Renders the frames already handed off, then stops the render thread
+	void Destroy();
+
+	// Simulation thread. Returns the packet to fill, waits while the render thread still reads it.
+	[[nodiscard]] uint32_t BeginSimulationFrame();
+	void EndSimulationFrame();
+
+	// Blocks until every frame handed off so far is rendered
+	void Flush();
+
+	[[nodiscard]] bool IsCreated() const { return m_render != nullptr; }
+	[[nodiscard]] bool IsPipelined() const { return m_renderThread.joinable(); }
+	[[nodiscard]] uint64_t GetFrameIndex() const { return m_frameIndex; }
+
+private:
+	void renderThread();
+
+	FramePipelineCreateInfo m_createInfo{};
+	RenderFunction          m_render;
+	std::thread             m_renderThread;
+	std::atomic<uint64_t>   m_stopFrame{ UINT64_MAX }; // the render thread exits before rendering this frame
+	HandoffFence            m_simulatedFence;
+	HandoffFence            m_renderedFence;
+	uint64_t                m_frameIndex{ 0 };      // frame being simulated
+	bool                    m_inSimulation{ false };
+};
+
+// Storage of the double-buffered render packets, indexed by FramePipeline::BeginSimulationFrame()
+template<typename T>
+class RenderPackets final
+{
+public:
+	T&       operator[](uint32_t packetIndex) { return m_packets[packetIndex]; }
+	const T& operator[](uint32_t packetIndex) const { return m_packets[packetIndex]; }
+
+private:
+	std::array<T, FRAME_PIPELINE_NUM_PACKETS> m_packets{};
+};
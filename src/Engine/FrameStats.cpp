@@ -0,0 +1,256 @@
+﻿#include "stdafx.h"
+#include "FrameStats.h"
+#include "Profiler.h"
+#include "Log.h"
+//=============================================================================
+FrameStats* thisFrameStats = nullptr;
+//=============================================================================
+void FrameStatsAddWaitTime(uint64_t nanoseconds)
+{
+	if (thisFrameStats) thisFrameStats->m_waitTime.fetch_add(nanoseconds, std::memory_order_relaxed);
+}
+//=============================================================================
+void FrameStatsAddPresentTime(uint64_t nanoseconds)
+{
+	if (thisFrameStats) thisFrameStats->m_presentTime.fetch_add(nanoseconds, std::memory_order_relaxed);
+}
+//=============================================================================
+void FrameStatsRecordGPUTime(uint64_t frameIndex, uint64_t nanoseconds)
+{
+	if (!thisFrameStats) return;
+
+	std::lock_guard lock(thisFrameStats->m_gpuTimeMutex);
+	if (!thisFrameStats->m_frames) return;
+	// A GPU profiler with a single frame slot in flight resolves the frame it just recorded, before BeginFrame() closed it
+	if (frameIndex >= thisFrameStats->m_frameIndex.load(std::memory_order_relaxed))
+	{
+		thisFrameStats->m_pendingGPUTimes.push_back({ frameIndex, nanoseconds });
+		return;
+	}
+
+	// writeFrame() holds the lock, the slot can not change in between
+	FrameStats::FrameRecord& record = thisFrameStats->m_frames[frameIndex % thisFrameStats->m_createInfo.historySize];
+	if (record.frameIndex.load(std::memory_order_relaxed) == frameIndex)
+	{
+		record.gpuTime.store(nanoseconds, std::memory_order_relaxed);
+	}
+}
+//=============================================================================
+uint64_t FrameStatsGetFrameIndex()
+{
+	return thisFrameStats ? thisFrameStats->GetFrameIndex() : 0;
+}
+//=============================================================================
+ScopedFrameStatsTime::ScopedFrameStatsTime(FrameStatsMetric metric)
+	: m_metric(metric)
+	, m_beginTime(ProfilerGetTime())
+{
+	assert(metric == FrameStatsMetric::wait || metric == FrameStatsMetric::present);
+}
+//=============================================================================
+ScopedFrameStatsTime::~ScopedFrameStatsTime()
+{
+	const uint64_t time = ProfilerGetTime() - m_beginTime;
+	if (m_metric == FrameStatsMetric::wait) FrameStatsAddWaitTime(time);
+	else FrameStatsAddPresentTime(time);
+}
+//=============================================================================
+FrameStats::~FrameStats()
+{
+	assert(thisFrameStats != this);
+}
+//=============================================================================
+bool FrameStats::Create(const FrameStatsCreateInfo& createInfo)
+{
+	assert(!thisFrameStats);
+
+	if (createInfo.historySize == 0 || createInfo.histogramBucketMs <= 0.0 || createInfo.numHistogramBuckets == 0)
+	{
+		Fatal("FrameStats: invalid create info");
+		return false;
+	}
+
+	m_createInfo = createInfo;
+	m_frames = std::make_unique<FrameRecord[]>(m_createInfo.historySize);
+	m_frameIndex.store(0, std::memory_order_relaxed);
+	m_waitTime.store(0, std::memory_order_relaxed);
+	m_presentTime.store(0, std::memory_order_relaxed);
+	m_numTotalHitches.store(0, std::memory_order_relaxed);
+	{
+		std::lock_guard lock(m_gpuTimeMutex);
+		m_pendingGPUTimes.clear();
+	}
+	m_frameBeginTime = 0;
+	m_averageFrameMs = 0.0;
+	m_lastReportTime = 0;
+
+	thisFrameStats = this;
+	return true;
+}
+//=============================================================================
+void FrameStats::Destroy()
+{
+	if (thisFrameStats == this) thisFrameStats = nullptr;
+	std::lock_guard lock(m_gpuTimeMutex);
+	m_frames.reset();
+	m_pendingGPUTimes.clear();
+}
+//=============================================================================
+void FrameStats::BeginFrame()
+{
+	if (!m_frames) return;
+
+	const uint64_t now = ProfilerGetTime();
+	const uint64_t waitTime = m_waitTime.exchange(0, std::memory_order_relaxed);
+	const uint64_t presentTime = m_presentTime.exchange(0, std::memory_order_relaxed);
+
+	// the first frame has no begin, only the times reported from now on belong to a measured frame
+	if (m_frameBeginTime == 0)
+	{
+		m_frameBeginTime = now;
+		m_lastReportTime = now;
+		std::lock_guard lock(m_gpuTimeMutex);
+		m_pendingGPUTimes.clear();
+		return;
+	}
+
+	const uint64_t frameTime = now - m_frameBeginTime;
+	m_frameBeginTime = now;
+
+	const double frameMs = static_cast<double>(frameTime) * 1e-6;
+	const bool hitch = m_averageFrameMs > 0.0 && frameMs > m_createInfo.hitchMinMs && frameMs > m_averageFrameMs * m_createInfo.hitchFactor;
+	if (hitch) m_numTotalHitches.fetch_add(1, std::memory_order_relaxed);
+	else m_averageFrameMs = m_averageFrameMs > 0.0 ? m_averageFrameMs + (frameMs - m_averageFrameMs) * 0.05 : frameMs;
+
+	{
+		// a GPU time of this frame arriving now goes to the pending times or to the closed record, not in between
+		std::lock_guard lock(m_gpuTimeMutex);
+		const uint64_t frameIndex = m_frameIndex.load(std::memory_order_relaxed);
+		writeFrame(frameIndex, frameTime, waitTime, presentTime, hitch);
+		m_frameIndex.store(frameIndex + 1, std::memory_order_relaxed);
+	}
+
+	if (m_createInfo.reportIntervalSeconds > 0.0 && static_cast<double>(now - m_lastReportTime) * 1e-9 >= m_createInfo.reportIntervalSeconds)
+	{
+		m_lastReportTime = now;
+		PrintSummary();
+	}
+}
+//=============================================================================
+void FrameStats::writeFrame(uint64_t frameIndex, uint64_t frameTime, uint64_t waitTime, uint64_t presentTime, bool hitch)
+{
+	FrameRecord& record = m_frames[frameIndex % m_createInfo.historySize];
+	record.frameIndex.store(INVALID_FRAME, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	record.frameTime.store(frameTime, std::memory_order_relaxed);
+	record.waitTime.store(waitTime, std::memory_order_relaxed);
+	record.presentTime.store(presentTime, std::memory_order_relaxed);
+	record.gpuTime.store(takePendingGPUTime(frameIndex), std::memory_order_relaxed);
+	record.hitch.store(hitch, std::memory_order_relaxed);
+	record.frameIndex.store(frameIndex, std::memory_order_release);
+}
+//=============================================================================
+uint64_t FrameStats::takePendingGPUTime(uint64_t frameIndex)
+{
+	uint64_t gpuTime = 0;
+	for (const PendingGPUTime& pending : m_pendingGPUTimes)
+	{
+		if (pending.frameIndex == frameIndex) gpuTime = pending.gpuTime;
+	}
+	// older frames can not be closed any more
+	std::erase_if(m_pendingGPUTimes, [frameIndex](const PendingGPUTime& pending) { return pending.frameIndex <= frameIndex; });
+	return gpuTime;
+}
+//=============================================================================
+void FrameStats::GetSummary(FrameStatsSummary& summary) const
+{
+	summary = {};
+	summary.histogram.assign(m_createInfo.numHistogramBuckets, 0);
+	if (!m_frames) return;
+
+	constexpr size_t NUM_METRICS = static_cast<size_t>(FrameStatsMetric::count);
+	std::vector<double> samples[NUM_METRICS];
+
+	const uint64_t endFrame = m_frameIndex.load(std::memory_order_relaxed);
+	const uint64_t beginFrame = endFrame > m_createInfo.historySize ? endFrame - m_createInfo.historySize : 0;
+	for (size_t metric = 0; metric < NUM_METRICS; metric++) samples[metric].reserve(endFrame - beginFrame);
+
+	for (uint64_t frameIndex = beginFrame; frameIndex < endFrame; frameIndex++)
+	{
+		const FrameRecord& record = m_frames[frameIndex % m_createInfo.historySize];
+		if (record.frameIndex.load(std::memory_order_acquire) != frameIndex) continue;
+		const uint64_t frameTime = record.frameTime.load(std::memory_order_relaxed);
+		const uint64_t waitTime = record.waitTime.load(std::memory_order_relaxed);
+		const uint64_t presentTime = record.presentTime.load(std::memory_order_relaxed);
+		const uint64_t gpuTime = record.gpuTime.load(std::memory_order_relaxed);
+		const bool hitch = record.hitch.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (record.frameIndex.load(std::memory_order_relaxed) != frameIndex) continue; // overwritten while reading
+
+		const uint64_t busyTime = waitTime + presentTime;
+		samples[static_cast<size_t>(FrameStatsMetric::frame)].push_back(static_cast<double>(frameTime) * 1e-6);
+		samples[static_cast<size_t>(FrameStatsMetric::cpu)].push_back(static_cast<double>(frameTime > busyTime ? frameTime - busyTime : 0) * 1e-6);
+		samples[static_cast<size_t>(FrameStatsMetric::wait)].push_back(static_cast<double>(waitTime) * 1e-6);
+		samples[static_cast<size_t>(FrameStatsMetric::present)].push_back(static_cast<double>(presentTime) * 1e-6);
+		if (gpuTime != 0) samples[static_cast<size_t>(FrameStatsMetric::gpu)].push_back(static_cast<double>(gpuTime) * 1e-6);
+		if (hitch) summary.numHitches++;
+
+		const size_t bucket = static_cast<size_t>(static_cast<double>(frameTime) * 1e-6 / m_createInfo.histogramBucketMs);
+		summary.histogram[std::min(bucket, summary.histogram.size() - 1)]++;
+	}
+
+	summary.numFrames = static_cast<uint32_t>(samples[static_cast<size_t>(FrameStatsMetric::frame)].size());
+	summary.numGPUFrames = static_cast<uint32_t>(samples[static_cast<size_t>(FrameStatsMetric::gpu)].size());
+	summary.numTotalHitches = m_numTotalHitches.load(std::memory_order_relaxed);
+
+	for (size_t metric = 0; metric < NUM_METRICS; metric++)
+	{
+		std::vector<double>& values = samples[metric];
+		if (values.empty()) continue;
+
+		std::sort(values.begin(), values.end());
+		// nearest rank
+		const auto percentile = [&values](double p)
+		{
+			const size_t rank = static_cast<size_t>(std::ceil(p * static_cast<double>(values.size())));
+			return values[std::clamp<size_t>(rank, 1, values.size()) - 1];
+		};
+
+		double total = 0.0;
+		for (double value : values) total += value;
+
+		FrameStatsValues& result = summary.values[metric];
+		result.avgMs = total / static_cast<double>(values.size());
+		result.p50Ms = percentile(0.50);
+		result.p95Ms = percentile(0.95);
+		result.p99Ms = percentile(0.99);
+		result.maxMs = values.back();
+	}
+
+	const double avgFrameMs = summary.Get(FrameStatsMetric::frame).avgMs;
+	summary.fps = avgFrameMs > 0.0 ? 1000.0 / avgFrameMs : 0.0;
+}
+//=============================================================================
+void FrameStats::PrintSummary() const
+{
+	FrameStatsSummary summary;
+	GetSummary(summary);
+	if (summary.numFrames == 0) return;
+
+	const FrameStatsValues& frame = summary.Get(FrameStatsMetric::frame);
+	const FrameStatsValues& cpu = summary.Get(FrameStatsMetric::cpu);
+	const FrameStatsValues& wait = summary.Get(FrameStatsMetric::wait);
+	const FrameStatsValues& gpu = summary.Get(FrameStatsMetric::gpu);
+
+	char buffer[512];
+	int length = snprintf(buffer, sizeof(buffer),
+		"FPS: %.1f | frame ms p50 %.2f p95 %.2f p99 %.2f max %.2f | cpu p95 %.2f | wait p95 %.2f | hitches %u (%llu total)",
+		summary.fps, frame.p50Ms, frame.p95Ms, frame.p99Ms, frame.maxMs, cpu.p95Ms, wait.p95Ms,
+		summary.numHitches, static_cast<unsigned long long>(summary.numTotalHitches));
+	if (summary.numGPUFrames > 0 && length > 0 && static_cast<size_t>(length) < sizeof(buffer))
+	{
+		snprintf(buffer + length, sizeof(buffer) - length, " | gpu p50 %.2f p95 %.2f", gpu.p50Ms, gpu.p95Ms);
+	}
+	Print(buffer);
+}
+//=============================================================================
@@ -0,0 +1,139 @@
+﻿#pragma once
+
+#include <atomic>
+
+// Per-frame timing history. EngineApp::BeginFrame() closes the previous frame and writes its times into a fixed ring,
+// GetSummary() computes percentiles, hitch counts and a frame time histogram over the frames in the ring.
+// The ring has one writer (the main thread) and any number of lock-free readers, e.g. a stats overlay or a dashboard thread.
+//
+// Frame time    - BeginFrame() to BeginFrame().
+// Wait time     - the CPU blocked on GPU fences, the swap chain frame latency or the frame limiter (FrameStatsAddWaitTime()).
+// Present time  - spent inside the swap chain Present(), reported with FrameStatsAddPresentTime().
+// CPU time      - frame time without wait and present time.
+// GPU time      - first to last GPU timestamp of the frame on the first queue of the GPU profiler. Arrives a few frames late
+//                 and is 0 until then or when the backend has no GPU profiler.
+
+enum class FrameStatsMetric : uint8_t
+{
+	frame,
+	cpu,
+	wait,
+	present,
+	gpu,
+
+	count
+};
+
+struct FrameStatsCreateInfo final
+{
+	uint32_t historySize{ 512 };            // frames kept in the ring
+	double   reportIntervalSeconds{ 1.0 };  // print a summary line every N seconds, 0 - never
+	double   hitchFactor{ 2.0 };            // a hitch is a frame longer than hitchFactor * average frame time
+	double   hitchMinMs{ 5.0 };             // and longer than this, so short frames at high FPS are not counted
+	double   histogramBucketMs{ 2.0 };
+	uint32_t numHistogramBuckets{ 32 };      // the last bucket also counts every longer frame
+};
+
+struct FrameStatsValues final
+{
+	double avgMs{ 0.0 };
+	double p50Ms{ 0.0 };
+	double p95Ms{ 0.0 };
+	double p99Ms{ 0.0 };
+	double maxMs{ 0.0 };
+};
+
+struct FrameStatsSummary final
+{
+	uint32_t              numFrames{ 0 };       // frames in the window
+	uint32_t              numGPUFrames{ 0 };    // frames of the window with a GPU time
+	double                fps{ 0.0 };
+	FrameStatsValues      values[static_cast<size_t>(FrameStatsMetric::count)]{};
+	uint32_t              numHitches{ 0 };      // in the window
+	uint64_t              numTotalHitches{ 0 }; // since Create()
+	std::vector<uint32_t> histogram;            // frame time, FrameStatsCreateInfo::histogramBucketMs per bucket
+
+	[[nodiscard]] const FrameStatsValues& Get(FrameStatsMetric metric) const { return values[static_cast<size_t>(metric)]; }
+};
+
+// Thread-safe, the time is added to the frame currently running on the main thread. Ignored while no FrameStats exists.
+void FrameStatsAddWaitTime(uint64_t nanoseconds);
+void FrameStatsAddPresentTime(uint64_t nanoseconds);
+// GPU time of a frame index returned by FrameStatsGetFrameIndex() while that frame was recorded. Thread-safe, the GPU profiler
+// calls it from the render thread in pipelined mode. The time of a frame that BeginFrame() did not close yet is kept until it does.
+void FrameStatsRecordGPUTime(uint64_t frameIndex, uint64_t nanoseconds);
+[[nodiscard]] uint64_t FrameStatsGetFrameIndex();
+
+// Adds the lifetime of the scope as wait or present time
+class ScopedFrameStatsTime final
+{
+public:
+	explicit ScopedFrameStatsTime(FrameStatsMetric metric);
+	~ScopedFrameStatsTime();
+
+	ScopedFrameStatsTime(const ScopedFrameStatsTime&) = delete;
+	ScopedFrameStatsTime& operator=(const ScopedFrameStatsTime&) = delete;
+
+private:
+	FrameStatsMetric m_metric;
+	uint64_t         m_beginTime;
+};
+
+class FrameStats final
+{
+public:
+	~FrameStats();
+
+	[[nodiscard]] bool Create(const FrameStatsCreateInfo& createInfo);
+	void Destroy();
+
+	// Closes the running frame and starts the next one. Main thread, once per frame.
+	void BeginFrame();
+
+	// Lock-free, callable from any thread. Frames overwritten while they are read are skipped.
+	void GetSummary(FrameStatsSummary& summary) const;
+	void PrintSummary() const;
+
+	[[nodiscard]] uint64_t GetFrameIndex() const { return m_frameIndex.load(std::memory_order_relaxed); }
+	[[nodiscard]] const FrameStatsCreateInfo& GetCreateInfo() const { return m_createInfo; }
+
+private:
+	friend void FrameStatsAddWaitTime(uint64_t);
+	friend void FrameStatsAddPresentTime(uint64_t);
+	friend void FrameStatsRecordGPUTime(uint64_t, uint64_t);
+
+	// Seqlock slot: frameIndex is INVALID_FRAME while the writer updates the slot
+	struct FrameRecord final
+	{
+		std::atomic<uint64_t> frameIndex{ INVALID_FRAME };
+		std::atomic<uint64_t> frameTime{ 0 };
+		std::atomic<uint64_t> waitTime{ 0 };
+		std::atomic<uint64_t> presentTime{ 0 };
+		std::atomic<uint64_t> gpuTime{ 0 };
+		std::atomic<bool>     hitch{ false };
+	};
+	static constexpr uint64_t INVALID_FRAME = UINT64_MAX;
+
+	void writeFrame(uint64_t frameIndex, uint64_t frameTime, uint64_t waitTime, uint64_t presentTime, bool hitch);
+	uint64_t takePendingGPUTime(uint64_t frameIndex);
+
+	struct PendingGPUTime final
+	{
+		uint64_t frameIndex;
+		uint64_t gpuTime;
+	};
+
+	FrameStatsCreateInfo           m_createInfo{};
+	std::unique_ptr<FrameRecord[]> m_frames;
+	std::atomic<uint64_t>          m_frameIndex{ 0 };      // frame running on the main thread
+	std::atomic<uint64_t>          m_waitTime{ 0 };        // of the running frame
+	std::atomic<uint64_t>          m_presentTime{ 0 };
+	std::atomic<uint64_t>          m_numTotalHitches{ 0 };
+	// GPU times arrive on the thread of the GPU profiler: the mutex guards the pending times and the gpuTime of the ring
+	// against writeFrame()
+	std::mutex                     m_gpuTimeMutex;
+	std::vector<PendingGPUTime>    m_pendingGPUTimes;      // of frames not closed yet
+	uint64_t                       m_frameBeginTime{ 0 };
+	double                         m_averageFrameMs{ 0.0 }; // exponential average, hitches excluded
+	uint64_t                       m_lastReportTime{ 0 };
+};
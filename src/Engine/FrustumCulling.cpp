@@ -0,0 +1,317 @@
+﻿#include "stdafx.h"
+#include "FrustumCulling.h"
+#include "SubmeshTable.h"
+#include "JobSystem.h"
+#if defined(_M_X64) || defined(__x86_64__)
+#	define CULLING_X64 1
+#	include <immintrin.h>
+#	if defined(_MSC_VER)
+#		include <intrin.h>
+#		define CULLING_TARGET_AVX2
+#	else
+#		define CULLING_TARGET_AVX2 __attribute__((target("avx2")))
+#	endif
+#else
+#	define CULLING_X64 0
+#endif
+//=============================================================================
+namespace
+{
+	// per plane: normal, distance and the absolute normal, scalar values for the SIMD broadcasts
+	struct CullingPlanes final
+	{
+		float normalX[6], normalY[6], normalZ[6], distance[6];
+		float absNormalX[6], absNormalY[6], absNormalZ[6];
+	};
+
+	CullingPlanes preparePlanes(const CullingFrustum& frustum)
+	{
+		CullingPlanes planes{};
+		for (uint32_t plane = 0; plane < 6; plane++)
+		{
+			const glm::vec4& source = frustum.planes[plane];
+			planes.normalX[plane] = source.x;
+			planes.normalY[plane] = source.y;
+			planes.normalZ[plane] = source.z;
+			planes.distance[plane] = source.w;
+			planes.absNormalX[plane] = std::abs(source.x);
+			planes.absNormalY[plane] = std::abs(source.y);
+			planes.absNormalZ[plane] = std::abs(source.z);
+		}
+		return planes;
+	}
+
+	uint32_t cullScalar(const CullingPlanes& planes, const CullingBounds& bounds, uint32_t begin, uint32_t end, uint32_t* visible)
+	{
+		const float* centerX = bounds.GetCenterX();
+		const float* centerY = bounds.GetCenterY();
+		const float* centerZ = bounds.GetCenterZ();
+		const float* extentX = bounds.GetExtentX();
+		const float* extentY = bounds.GetExtentY();
+		const float* extentZ = bounds.GetExtentZ();
+
+		uint32_t numVisible = 0;
+		for (uint32_t box = begin; box < end; box++)
+		{
+			bool inside = true;
+			for (uint32_t plane = 0; plane < 6; plane++)
+			{
+				const float distance = planes.normalX[plane] * centerX[box] + planes.normalY[plane] * centerY[box] + planes.normalZ[plane] * centerZ[box] + planes.distance[plane];
+				const float radius = planes.absNormalX[plane] * extentX[box] + planes.absNormalY[plane] * extentY[box] + planes.absNormalZ[plane] * extentZ[box];
+				inside = inside && distance + radius >= 0.0f;
+			}
+			// branchless, the index is overwritten when the box is culled
+			visible[numVisible] = box;
+			numVisible += inside ? 1 : 0;
+		}
+		return numVisible;
+	}
+
+#if CULLING_X64
+	uint32_t cullSSE(const CullingPlanes& planes, const CullingBounds& bounds, uint32_t begin, uint32_t end, uint32_t* visible)
+	{
+		const float* centerX = bounds.GetCenterX();
+		const float* centerY = bounds.GetCenterY();
+		const float* centerZ = bounds.GetCenterZ();
+		const float* extentX = bounds.GetExtentX();
+		const float* extentY = bounds.GetExtentY();
+		const float* extentZ = bounds.GetExtentZ();
+
+		const __m128 zero = _mm_setzero_ps();
+		uint32_t numVisible = 0;
+		uint32_t box = begin;
+		for (; box + 4 <= end; box += 4)
+		{
+			const __m128 cx = _mm_loadu_ps(centerX + box);
+			const __m128 cy = _mm_loadu_ps(centerY + box);
+			const __m128 cz = _mm_loadu_ps(centerZ + box);
+			const __m128 ex = _mm_loadu_ps(extentX + box);
+			const __m128 ey = _mm_loadu_ps(extentY + box);
+			const __m128 ez = _mm_loadu_ps(extentZ + box);
+
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (uint32_t plane = 0; plane < 6; plane++)
+			{
+				__m128 distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes.normalX[plane]), cx), _mm_set1_ps(planes.distance[plane]));
+				distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(planes.normalY[plane]), cy));
+				distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(planes.normalZ[plane]), cz));
+				__m128 radius = _mm_mul_ps(_mm_set1_ps(planes.absNormalX[plane]), ex);
+				radius = _mm_add_ps(radius, _mm_mul_ps(_mm_set1_ps(planes.absNormalY[plane]), ey));
+				radius = _mm_add_ps(radius, _mm_mul_ps(_mm_set1_ps(planes.absNormalZ[plane]), ez));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), zero));
+			}
+
+			const uint32_t mask = static_cast<uint32_t>(_mm_movemask_ps(inside));
+			for (uint32_t lane = 0; lane < 4; lane++)
+			{
+				visible[numVisible] = box + lane;
+				numVisible += (mask >> lane) & 1;
+			}
+		}
+		return numVisible + cullScalar(planes, bounds, box, end, visible + numVisible);
+	}
+
+	// 8 lane indices packed into 4 bits each, the visible lanes of a movemask first
+	struct LeftPackTable final
+	{
+		constexpr LeftPackTable()
+		{
+			for (uint32_t mask = 0; mask < 256; mask++)
+			{
+				uint32_t packed = 0;
+				uint32_t numLanes = 0;
+				for (uint32_t lane = 0; lane < 8; lane++)
+				{
+					if (mask & (1u << lane)) packed |= lane << (4 * numLanes++);
+				}
+				lanes[mask] = packed;
+			}
+		}
+
+		uint32_t lanes[256]{};
+	};
+	constexpr LeftPackTable LEFT_PACK_TABLE;
+
+	CULLING_TARGET_AVX2 uint32_t cullAVX2(const CullingPlanes& planes, const CullingBounds& bounds, uint32_t begin, uint32_t end, uint32_t* visible)
+	{
+		const float* centerX = bounds.GetCenterX();
+		const float* centerY = bounds.GetCenterY();
+		const float* centerZ = bounds.GetCenterZ();
+		const float* extentX = bounds.GetExtentX();
+		const float* extentY = bounds.GetExtentY();
+		const float* extentZ = bounds.GetExtentZ();
+
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256i laneShifts = _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28);
+		const __m256i laneMask = _mm256_set1_epi32(7);
+		uint32_t numVisible = 0;
+		uint32_t box = begin;
+		for (; box + 8 <= end; box += 8)
+		{
+			const __m256 cx = _mm256_loadu_ps(centerX + box);
+			const __m256 cy = _mm256_loadu_ps(centerY + box);
+			const __m256 cz = _mm256_loadu_ps(centerZ + box);
+			const __m256 ex = _mm256_loadu_ps(extentX + box);
+			const __m256 ey = _mm256_loadu_ps(extentY + box);
+			const __m256 ez = _mm256_loadu_ps(extentZ + box);
+
+			__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (uint32_t plane = 0; plane < 6; plane++)
+			{
+				__m256 distance = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(planes.normalX[plane]), cx), _mm256_set1_ps(planes.distance[plane]));
+				distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(planes.normalY[plane]), cy));
+				distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(planes.normalZ[plane]), cz));
+				__m256 radius = _mm256_mul_ps(_mm256_set1_ps(planes.absNormalX[plane]), ex);
+				radius = _mm256_add_ps(radius, _mm256_mul_ps(_mm256_set1_ps(planes.absNormalY[plane]), ey));
+				radius = _mm256_add_ps(radius, _mm256_mul_ps(_mm256_set1_ps(planes.absNormalZ[plane]), ez));
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_GE_OQ));
+			}
+
+			// left-pack the visible indices with one store, it may write up to 7 stale indices behind them but never past box + 8
+			const uint32_t mask = static_cast<uint32_t>(_mm256_movemask_ps(inside));
+			const __m256i lanes = _mm256_and_si256(_mm256_srlv_epi32(_mm256_set1_epi32(static_cast<int>(LEFT_PACK_TABLE.lanes[mask])), laneShifts), laneMask);
+			const __m256i indices = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(box)), lanes);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(visible + numVisible), indices);
+			numVisible += static_cast<uint32_t>(_mm_popcnt_u32(mask));
+		}
+		return numVisible + cullScalar(planes, bounds, box, end, visible + numVisible);
+	}
+
+	bool isAVX2Supported()
+	{
+#	if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7) return false;
+		__cpuid(info, 1);
+		const bool osSavesYMM = (info[2] & (1 << 27)) && (_xgetbv(0) & 6) == 6; // OSXSAVE, XMM and YMM state
+		const bool popcnt = info[2] & (1 << 23);
+		__cpuidex(info, 7, 0);
+		return osSavesYMM && popcnt && (info[1] & (1 << 5));
+#	else
+		return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+#	endif
+	}
+#endif // CULLING_X64
+}
+//=============================================================================
+CullingFrustum CullingFrustum::FromViewProjection(const glm::mat4& viewProjection, bool zeroToOneDepth)
+{
+	// Gribb, Hartmann: "Fast Extraction of Viewing Frustum Planes from the World-View-Projection Matrix"
+	const glm::mat4 rows = glm::transpose(viewProjection);
+	const glm::vec4 row0 = rows[0];
+	const glm::vec4 row1 = rows[1];
+	const glm::vec4 row2 = rows[2];
+	const glm::vec4 row3 = rows[3];
+
+	CullingFrustum frustum{};
+	frustum.planes[0] = row3 + row0; // left
+	frustum.planes[1] = row3 - row0; // right
+	frustum.planes[2] = row3 + row1; // bottom
+	frustum.planes[3] = row3 - row1; // top
+	frustum.planes[4] = zeroToOneDepth ? row2 : row3 + row2; // near
+	frustum.planes[5] = row3 - row2; // far
+	for (glm::vec4& plane : frustum.planes) plane /= glm::length(glm::vec3(plane));
+	return frustum;
+}
+//=============================================================================
+void CullingBounds::Reserve(uint32_t numBoxes)
+{
+	for (std::vector<float>* values : { &m_centerX, &m_centerY, &m_centerZ, &m_extentX, &m_extentY, &m_extentZ }) values->reserve(numBoxes);
+}
+//=============================================================================
+void CullingBounds::Clear()
+{
+	for (std::vector<float>* values : { &m_centerX, &m_centerY, &m_centerZ, &m_extentX, &m_extentY, &m_extentZ }) values->clear();
+}
+//=============================================================================
+uint32_t CullingBounds::Add(const glm::vec3& center, const glm::vec3& extents)
+{
+	const uint32_t index = GetCount();
+	m_centerX.push_back(center.x);
+	m_centerY.push_back(center.y);
+	m_centerZ.push_back(center.z);
+	m_extentX.push_back(extents.x);
+	m_extentY.push_back(extents.y);
+	m_extentZ.push_back(extents.z);
+	return index;
+}
+//=============================================================================
+void CullingBounds::Set(uint32_t index, const glm::vec3& center, const glm::vec3& extents)
+{
+	assert(index < GetCount());
+	m_centerX[index] = center.x;
+	m_centerY[index] = center.y;
+	m_centerZ[index] = center.z;
+	m_extentX[index] = extents.x;
+	m_extentY[index] = extents.y;
+	m_extentZ[index] = extents.z;
+}
+//=============================================================================
+void CullingBounds::Assign(const SubmeshTable& submeshes)
+{
+	Clear();
+	Reserve(submeshes.GetCount());
+	const std::span<const glm::vec3> centers = submeshes.GetBoundsCenters();
+	const std::span<const glm::vec3> extents = submeshes.GetBoundsExtents();
+	for (size_t index = 0; index < centers.size(); index++) Add(centers[index], extents[index]);
+}
+//=============================================================================
+CullingPath GetBestCullingPath()
+{
+#if CULLING_X64
+	static const CullingPath bestPath = isAVX2Supported() ? CullingPath::avx2 : CullingPath::sse;
+	return bestPath;
+#else
+	return CullingPath::scalar;
+#endif
+}
+//=============================================================================
+uint32_t CullBoxes(const CullingFrustum& frustum, const CullingBounds& bounds, uint32_t begin, uint32_t end, uint32_t* visible, CullingPath path)
+{
+	assert(begin <= end && end <= bounds.GetCount());
+	const CullingPlanes planes = preparePlanes(frustum);
+	if (path == CullingPath::automatic) path = GetBestCullingPath();
+
+#if CULLING_X64
+	if (path == CullingPath::avx2 && GetBestCullingPath() == CullingPath::avx2) return cullAVX2(planes, bounds, begin, end, visible);
+	if (path != CullingPath::scalar) return cullSSE(planes, bounds, begin, end, visible);
+#endif
+	return cullScalar(planes, bounds, begin, end, visible);
+}
+//=============================================================================
+std::span<const uint32_t> FrustumCuller::Cull(const CullingFrustum& frustum, const CullingBounds& bounds, JobSystem* jobSystem, CullingPath path)
+{
+	const uint32_t numBoxes = bounds.GetCount();
+	if (m_capacity < numBoxes)
+	{
+		m_visible = std::make_unique_for_overwrite<uint32_t[]>(numBoxes);
+		m_capacity = numBoxes;
+	}
+
+	// every block culls into its own range of the output, the left-pack stores stay inside of it
+	const uint32_t numBlocks = (numBoxes + CULLING_BLOCK_SIZE - 1) / CULLING_BLOCK_SIZE;
+	m_blockCounts.resize(numBlocks);
+	const auto cullBlocks = [&](uint32_t firstBlock, uint32_t endBlock)
+	{
+		for (uint32_t block = firstBlock; block < endBlock; block++)
+		{
+			const uint32_t begin = block * CULLING_BLOCK_SIZE;
+			const uint32_t end = std::min(begin + CULLING_BLOCK_SIZE, numBoxes);
+			m_blockCounts[block] = CullBoxes(frustum, bounds, begin, end, m_visible.get() + begin, path);
+		}
+	};
+	if (jobSystem && numBlocks > 1) jobSystem->ParallelFor(numBlocks, cullBlocks);
+	else cullBlocks(0, numBlocks);
+
+	// the blocks move down in order, a block never moves over one that is still to be moved
+	uint32_t numVisible = 0;
+	for (uint32_t block = 0; block < numBlocks; block++)
+	{
+		const uint32_t begin = block * CULLING_BLOCK_SIZE;
+		if (numVisible != begin) memmove(m_visible.get() + numVisible, m_visible.get() + begin, m_blockCounts[block] * sizeof(uint32_t));
+		numVisible += m_blockCounts[block];
+	}
+	return { m_visible.get(), numVisible };
+}
+//=============================================================================
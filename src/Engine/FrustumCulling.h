@@ -0,0 +1,75 @@
+﻿#pragma once
+
+#include <span>
+
+// Frustum culling of axis-aligned boxes stored as structure of arrays. A box is culled when it lies completely behind one of
+// the six planes (center distance + projected extents < 0), boxes crossing a frustum corner outside of all planes are kept.
+// CullBoxes() tests 8 boxes per iteration with AVX2, 4 with SSE, whatever the CPU supports; FrustumCuller splits the boxes into
+// blocks of CULLING_BLOCK_SIZE, culls the blocks with JobSystem::ParallelFor() and compacts the visible indices in box order.
+
+class JobSystem;
+class SubmeshTable;
+
+constexpr uint32_t CULLING_BLOCK_SIZE = 4096; // multiple of 8
+
+enum class CullingPath : uint8_t
+{
+	automatic, // the widest one the CPU supports
+	scalar,
+	sse,
+	avx2
+};
+
+struct CullingFrustum final
+{
+	// Planes of a view projection matrix that maps depth to [0, 1] (D3D) or to [-1, 1] (OpenGL)
+	static CullingFrustum FromViewProjection(const glm::mat4& viewProjection, bool zeroToOneDepth = true);
+
+	glm::vec4 planes[6]; // normalized, xyz points into the frustum: dot(xyz, point) + w >= 0 inside
+};
+
+class CullingBounds final
+{
+public:
+	void Reserve(uint32_t numBoxes);
+	void Clear();
+
+	uint32_t Add(const glm::vec3& center, const glm::vec3& extents);
+	void Set(uint32_t index, const glm::vec3& center, const glm::vec3& extents);
+	// Replaces the boxes with the bounds of the submeshes, box i is SubmeshId{ i }
+	void Assign(const SubmeshTable& submeshes);
+
+	[[nodiscard]] uint32_t GetCount() const { return static_cast<uint32_t>(m_centerX.size()); }
+	[[nodiscard]] const float* GetCenterX() const { return m_centerX.data(); }
+	[[nodiscard]] const float* GetCenterY() const { return m_centerY.data(); }
+	[[nodiscard]] const float* GetCenterZ() const { return m_centerZ.data(); }
+	[[nodiscard]] const float* GetExtentX() const { return m_extentX.data(); }
+	[[nodiscard]] const float* GetExtentY() const { return m_extentY.data(); }
+	[[nodiscard]] const float* GetExtentZ() const { return m_extentZ.data(); }
+
+private:
+	std::vector<float> m_centerX;
+	std::vector<float> m_centerY;
+	std::vector<float> m_centerZ;
+	std::vector<float> m_extentX;
+	std::vector<float> m_extentY;
+	std::vector<float> m_extentZ;
+};
+
+// Writes the indices of the visible boxes of [begin, end) to visible in order, visible has room for end - begin indices.
+// Returns their number.
+uint32_t CullBoxes(const CullingFrustum& frustum, const CullingBounds& bounds, uint32_t begin, uint32_t end, uint32_t* visible, CullingPath path = CullingPath::automatic);
+
+[[nodiscard]] CullingPath GetBestCullingPath();
+
+class FrustumCuller final
+{
+public:
+	// Visible box indices in increasing order, valid until the next Cull(). Without a job system the culling runs on this thread.
+	std::span<const uint32_t> Cull(const CullingFrustum& frustum, const CullingBounds& bounds, JobSystem* jobSystem, CullingPath path = CullingPath::automatic);
+
+private:
+	std::unique_ptr<uint32_t[]> m_visible;
+	uint32_t                    m_capacity{ 0 };
+	std::vector<uint32_t>       m_blockCounts;
+};
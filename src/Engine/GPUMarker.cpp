@@ -1,22 +1,41 @@
 ﻿#include "stdafx.h"
 #include "GPUMarker.h"
+#include "GPUProfilerD3D12.h"
 //=============================================================================
-ScopedMarker::ScopedMarker(const char* pLabel, unsigned PIXColor)
+#if ENABLE_PIX_MARKERS || ENABLE_PROFILER
+ScopedMarker::ScopedMarker(const char* pLabel, [[maybe_unused]] unsigned PIXColor)
 {
+#if ENABLE_PIX_MARKERS
 	PIXBeginEvent(PIXColor, pLabel);
+#endif
+#if ENABLE_PROFILER
+	ProfilerBeginZone(pLabel);
+#endif
 }
 //=============================================================================
 ScopedMarker::~ScopedMarker()
 {
+#if ENABLE_PROFILER
+	ProfilerEndZone();
+#endif
+#if ENABLE_PIX_MARKERS
 	PIXEndEvent();
+#endif
 }
+#endif // ENABLE_PIX_MARKERS || ENABLE_PROFILER
+#if RENDER_D3D12
 //=============================================================================
 // https://devblogs.microsoft.com/pix/winpixeventruntime/#:~:text=An%20%E2%80%9Cevent%E2%80%9D%20represents%20a%20region,a%20single%20point%20in%20time.
 // https://devblogs.microsoft.com/pix/pix-2008-26-new-capture-layer/
 ScopedGPUMarker::ScopedGPUMarker(ID3D12GraphicsCommandList* pCmdList, const char* pLabel, unsigned PIXColor)
 	: mpCmdList(pCmdList)
+	, m_isCommandList(true)
+	, m_label(pLabel)
 {
 	PIXBeginEvent(mpCmdList, (unsigned long long)PIXColor, pLabel);
+#if ENABLE_PROFILER
+	m_beginQuery = GPUProfilerBeginZone(mpCmdList);
+#endif
 }
 //=============================================================================
 ScopedGPUMarker::ScopedGPUMarker(ID3D12CommandQueue* pCmdQueue, const char* pLabel, unsigned PIXColor)
@@ -27,6 +46,17 @@ ScopedGPUMarker::ScopedGPUMarker(ID3D12CommandQueue* pCmdQueue, const char* pLab
 //=============================================================================
 ScopedGPUMarker::~ScopedGPUMarker()
 {
-	PIXEndEvent(mpCmdList);
+	if (m_isCommandList)
+	{
+#if ENABLE_PROFILER
+		GPUProfilerEndZone(mpCmdList, m_label, m_beginQuery);
+#endif
+		PIXEndEvent(mpCmdList);
+	}
+	else
+	{
+		PIXEndEvent(mpCmdQueue);
+	}
 }
-//=============================================================================
\ No newline at end of file
+//=============================================================================
+#endif // RENDER_D3D12
@@ -1,29 +1,58 @@
 ﻿#pragma once
 
+#include "Profiler.h"
+
+#if !ENABLE_PIX_MARKERS && !defined(PIX_COLOR_DEFAULT)
+#	define PIX_COLOR_DEFAULT 0
+#endif
+
 #define SCOPED_GPU_MARKER(pCmd, pStr)             ScopedGPUMarker GPUMarker(pCmd,pStr)
 
-#define SCOPED_CPU_MARKER(pStr)                   ScopedMarker    CPUMarker(pStr)
-#define SCOPED_CPU_MARKER_C(pStr, PIXColor)       ScopedMarker    CPUMarker(pStr, PIXColor)
-#define SCOPED_CPU_MARKER_F(pStr, ...)            ScopedMarker    CPUMarker(PIX_COLOR_DEFAULT, pStr, __VA_ARGS__)
-#define SCOPED_CPU_MARKER_CF(PIXColor, pStr, ...) ScopedMarker    CPUMarker(PIXColor, pStr, __VA_ARGS__)
+// CPU markers go to PIX and to the in-engine profiler (see Profiler.h). With both disabled they compile to nothing.
+#if ENABLE_PIX_MARKERS || ENABLE_PROFILER
+#	define SCOPED_CPU_MARKER(pStr)                   ScopedMarker    CPUMarker(pStr)
+#	define SCOPED_CPU_MARKER_C(pStr, PIXColor)       ScopedMarker    CPUMarker(pStr, PIXColor)
+#	define SCOPED_CPU_MARKER_F(pStr, ...)            ScopedMarker    CPUMarker(PIX_COLOR_DEFAULT, pStr, __VA_ARGS__)
+#	define SCOPED_CPU_MARKER_CF(PIXColor, pStr, ...) ScopedMarker    CPUMarker(PIXColor, pStr, __VA_ARGS__)
 
-class ScopedMarker
+class ScopedMarker final
 {
 public:
+	// pLabel must be a string literal (or outlive the profiler), formatted labels are interned
 	ScopedMarker(const char* pLabel, unsigned PIXColor = PIX_COLOR_DEFAULT);
 	template<class ... Args>
 	ScopedMarker(unsigned PIXColor, const char* pLabel, Args&&... args);
 	~ScopedMarker();
+
+	ScopedMarker(const ScopedMarker&) = delete;
+	ScopedMarker(ScopedMarker&&) = delete;
+	ScopedMarker& operator=(const ScopedMarker&) = delete;
+	ScopedMarker& operator=(ScopedMarker&&) = delete;
 };
 
 template<class ...Args>
-inline ScopedMarker::ScopedMarker(unsigned PIXColor, const char* pFormat, Args && ...args)
+inline ScopedMarker::ScopedMarker([[maybe_unused]] unsigned PIXColor, const char* pFormat, Args && ...args)
 {
 	char buf[256];
-	sprintf_s(buf, pFormat, args...);
+	snprintf(buf, sizeof(buf), pFormat, args...);
+#if ENABLE_PIX_MARKERS
 	PIXBeginEvent(PIXColor, buf);
+#endif
+#if ENABLE_PROFILER
+	ProfilerBeginZone(ProfilerInternName(buf));
+#endif
 }
+#else
+#	define SCOPED_CPU_MARKER(pStr)                   ((void)0)
+#	define SCOPED_CPU_MARKER_C(pStr, PIXColor)       ((void)0)
+#	define SCOPED_CPU_MARKER_F(pStr, ...)            ((void)0)
+#	define SCOPED_CPU_MARKER_CF(PIXColor, pStr, ...) ((void)0)
+#endif // ENABLE_PIX_MARKERS || ENABLE_PROFILER
 
+#if RENDER_D3D12
+
+// On a command list the marker also records begin/end timestamps for the GPU profiler (see GPUProfiler.h), pLabel must be a string literal.
+// Queue markers are PIX only.
 class ScopedGPUMarker
 {
 public:
@@ -40,6 +69,9 @@ private:
 		ID3D12GraphicsCommandList* mpCmdList;
 		ID3D12CommandQueue* mpCmdQueue;
 	};
+	bool        m_isCommandList{ false };
+	const char* m_label{ nullptr };
+	uint32_t    m_beginQuery{ UINT32_MAX };
 };
 
 // TODO: совместить с ScopedGPUMarker
@@ -58,4 +90,6 @@ public:
 
 private:
 	ComPtr<ID3D12GraphicsCommandList> m_commandList;
-};
\ No newline at end of file
+};
+
+#endif // RENDER_D3D12
@@ -0,0 +1,198 @@
+﻿#include "stdafx.h"
+#include "GPUProfiler.h"
+#include "Profiler.h"
+#include "FrameStats.h"
+#include "Log.h"
+//=============================================================================
+GPUProfiler* thisGPUProfiler = nullptr;
+//=============================================================================
+GPUProfiler::~GPUProfiler()
+{
+	assert(thisGPUProfiler != this);
+}
+//=============================================================================
+bool GPUProfiler::Create(const GPUProfilerCreateInfo& createInfo, GPUTimestampDevice* device)
+{
+	assert(!thisGPUProfiler);
+	assert(device);
+
+	if (createInfo.numQueues == 0 || createInfo.numQueues > GPU_PROFILER_MAX_QUEUES || createInfo.maxQueriesPerFrame < 2)
+	{
+		Fatal("GPUProfiler: invalid create info");
+		return false;
+	}
+
+	m_createInfo = createInfo;
+	m_device = device;
+	m_numFrameSlots = GetNumFrameSlots(createInfo.numFramesInFlight);
+	m_currentSlot.store(0, std::memory_order_relaxed);
+	m_numDroppedZones.store(0, std::memory_order_relaxed);
+
+	for (uint32_t queue = 0; queue < m_createInfo.numQueues; queue++)
+	{
+		m_queues[queue].slots = std::make_unique<FrameSlot[]>(m_numFrameSlots);
+		m_queues[queue].timestampFrequency = m_device->GetTimestampFrequency(queue);
+		if (m_queues[queue].timestampFrequency == 0)
+		{
+			Fatal("GPUProfiler: the timestamp frequency of queue " + std::to_string(queue) + " is unknown");
+			return false;
+		}
+		if (!m_createInfo.queueNames[queue]) m_createInfo.queueNames[queue] = "GPU Queue";
+	}
+
+	thisGPUProfiler = this;
+	return true;
+}
+//=============================================================================
+void GPUProfiler::Destroy()
+{
+	if (thisGPUProfiler == this) thisGPUProfiler = nullptr;
+
+	for (Queue& queue : m_queues)
+	{
+		queue.slots.reset();
+		queue.timestampFrequency = 0;
+	}
+	m_device = nullptr;
+	m_numFrameSlots = 0;
+}
+//=============================================================================
+uint32_t GPUProfiler::BeginZone(uint32_t queue)
+{
+	if (!m_device || queue >= m_createInfo.numQueues) return UINT32_MAX;
+
+	const uint32_t slotIndex = m_currentSlot.load(std::memory_order_acquire);
+	const uint32_t query = m_queues[queue].slots[slotIndex].numQueries.fetch_add(1, std::memory_order_relaxed);
+	if (query >= m_createInfo.maxQueriesPerFrame)
+	{
+		m_numDroppedZones.fetch_add(1, std::memory_order_relaxed);
+		return UINT32_MAX;
+	}
+	return slotIndex * m_createInfo.maxQueriesPerFrame + query;
+}
+//=============================================================================
+uint32_t GPUProfiler::EndZone(uint32_t queue, const char* name, uint32_t beginQuery)
+{
+	// the drop was counted by BeginZone()
+	if (!m_device || queue >= m_createInfo.numQueues || beginQuery == UINT32_MAX) return UINT32_MAX;
+
+	// the end goes to the same frame slot as the begin, both are in one command list
+	const uint32_t slotIndex = beginQuery / m_createInfo.maxQueriesPerFrame;
+	const uint32_t firstQuery = slotIndex * m_createInfo.maxQueriesPerFrame;
+	FrameSlot& slot = m_queues[queue].slots[slotIndex];
+
+	const uint32_t query = slot.numQueries.fetch_add(1, std::memory_order_relaxed);
+	if (query >= m_createInfo.maxQueriesPerFrame)
+	{
+		m_numDroppedZones.fetch_add(1, std::memory_order_relaxed);
+		return UINT32_MAX;
+	}
+
+	{
+		std::lock_guard lock(slot.zonesMutex);
+		slot.zones.push_back({ name, beginQuery - firstQuery, query });
+	}
+	return firstQuery + query;
+}
+//=============================================================================
+void GPUProfiler::EndFrame()
+{
+	if (!m_device) return;
+
+	const uint32_t currentSlot = m_currentSlot.load(std::memory_order_relaxed);
+	for (uint32_t queue = 0; queue < m_createInfo.numQueues; queue++)
+	{
+		FrameSlot& slot = m_queues[queue].slots[currentSlot];
+		const uint32_t numQueries = std::min(slot.numQueries.load(std::memory_order_relaxed), m_createInfo.maxQueriesPerFrame);
+		if (numQueries == 0) continue;
+
+		if (!m_device->CalibrateClock(queue, slot.gpuCalibration, slot.cpuCalibration))
+		{
+			m_numDroppedZones.fetch_add(slot.zones.size(), std::memory_order_relaxed);
+			resetFrame(slot);
+			continue;
+		}
+		slot.frameIndex = FrameStatsGetFrameIndex();
+		slot.resolveFence = m_device->ResolveTimestamps(queue, currentSlot, currentSlot * m_createInfo.maxQueriesPerFrame, numQueries);
+		slot.pending = true;
+	}
+
+	// Oldest frames first, so the zones reach the CPU profiler in order
+	const uint32_t nextSlot = (currentSlot + 1) % m_numFrameSlots;
+	for (uint32_t age = 0; age < m_numFrameSlots; age++)
+	{
+		const uint32_t slotIndex = (nextSlot + age) % m_numFrameSlots;
+		for (uint32_t queue = 0; queue < m_createInfo.numQueues; queue++)
+		{
+			const FrameSlot& slot = m_queues[queue].slots[slotIndex];
+			if (slot.pending && m_device->IsFenceComplete(queue, slot.resolveFence)) readFrame(queue, slotIndex);
+		}
+	}
+
+	// The next frame records into this slot. Normally the frame fences already waited for it, this only stalls when they did not.
+	for (uint32_t queue = 0; queue < m_createInfo.numQueues; queue++)
+	{
+		const FrameSlot& slot = m_queues[queue].slots[nextSlot];
+		if (slot.pending)
+		{
+			m_device->WaitForFence(queue, slot.resolveFence);
+			readFrame(queue, nextSlot);
+		}
+	}
+
+	m_currentSlot.store(nextSlot, std::memory_order_release);
+}
+//=============================================================================
+void GPUProfiler::readFrame(uint32_t queue, uint32_t slotIndex)
+{
+	FrameSlot& slot = m_queues[queue].slots[slotIndex];
+	const uint32_t numQueries = std::min(slot.numQueries.load(std::memory_order_relaxed), m_createInfo.maxQueriesPerFrame);
+	const uint64_t* timestamps = m_device->ReadTimestamps(queue, slotIndex * m_createInfo.maxQueriesPerFrame, numQueries);
+	if (!timestamps)
+	{
+		m_numDroppedZones.fetch_add(slot.zones.size(), std::memory_order_relaxed);
+		resetFrame(slot);
+		return;
+	}
+
+	const double nanosecondsPerTick = 1e9 / static_cast<double>(m_queues[queue].timestampFrequency);
+	const auto toCPUTime = [&](uint64_t timestamp)
+	{
+		const double offset = static_cast<double>(static_cast<int64_t>(timestamp - slot.gpuCalibration)) * nanosecondsPerTick;
+		return slot.cpuCalibration + static_cast<uint64_t>(static_cast<int64_t>(offset));
+	};
+
+	uint64_t frameBegin = UINT64_MAX;
+	uint64_t frameEnd = 0;
+	for (const Zone& zone : slot.zones)
+	{
+		const uint64_t beginTimestamp = timestamps[zone.beginQuery];
+		const uint64_t endTimestamp = timestamps[zone.endQuery];
+		// a query that was never written (e.g. its command list was not submitted) reads as garbage or 0
+		if (beginTimestamp == 0 || endTimestamp < beginTimestamp)
+		{
+			m_numDroppedZones.fetch_add(1, std::memory_order_relaxed);
+			continue;
+		}
+		ProfilerRecordGPUZone(m_createInfo.queueNames[queue], zone.name, toCPUTime(beginTimestamp), toCPUTime(endTimestamp));
+		frameBegin = std::min(frameBegin, beginTimestamp);
+		frameEnd = std::max(frameEnd, endTimestamp);
+	}
+
+	// the first queue is the graphics queue, its zones span the GPU frame
+	if (queue == 0 && frameEnd > frameBegin)
+	{
+		FrameStatsRecordGPUTime(slot.frameIndex, static_cast<uint64_t>(static_cast<double>(frameEnd - frameBegin) * nanosecondsPerTick));
+	}
+
+	resetFrame(slot);
+}
+//=============================================================================
+void GPUProfiler::resetFrame(FrameSlot& slot)
+{
+	slot.numQueries.store(0, std::memory_order_relaxed);
+	slot.zones.clear();
+	slot.pending = false;
+	slot.resolveFence = 0;
+}
+//=============================================================================
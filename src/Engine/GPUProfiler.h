@@ -0,0 +1,99 @@
+﻿#pragma once
+
+#include <atomic>
+
+// GPU timestamp profiler. Every queue owns a timestamp query range per frame in flight; a zone writes one query at begin
+// and one at end, the frame's queries are resolved into a readback buffer when the frame ends and read back once the GPU
+// finished that frame. Timestamps are converted to the CPU profiler clock with the queue clock calibration, so GPU zones
+// line up with the CPU zones in statistics and trace captures (see Profiler.h).
+//
+// This part does only the query bookkeeping. All GPU work goes through GPUTimestampDevice, which a test can replace with a mock.
+
+constexpr uint32_t GPU_PROFILER_MAX_QUEUES = 4;
+
+// Query heap, resolve and readback of one API. queue is the index of GPUProfilerCreateInfo::queueNames.
+class GPUTimestampDevice
+{
+public:
+	virtual ~GPUTimestampDevice() = default;
+
+	// Copies the queries [firstQuery, firstQuery + numQueries) of the queue to its readback buffer on the GPU timeline.
+	// frameSlot selects the resources of the frame being resolved. Returns the fence value that marks the copy as done.
+	virtual uint64_t ResolveTimestamps(uint32_t queue, uint32_t frameSlot, uint32_t firstQuery, uint32_t numQueries) = 0;
+	virtual bool     IsFenceComplete(uint32_t queue, uint64_t fenceValue) = 0;
+	virtual void     WaitForFence(uint32_t queue, uint64_t fenceValue) = 0;
+	// Resolved timestamps of the queries [firstQuery, firstQuery + numQueries), valid after the resolve fence completed
+	virtual const uint64_t* ReadTimestamps(uint32_t queue, uint32_t firstQuery, uint32_t numQueries) = 0;
+	// Ticks per second of the queue timestamps
+	virtual uint64_t GetTimestampFrequency(uint32_t queue) = 0;
+	// A GPU timestamp and the ProfilerGetTime() taken at the same moment
+	virtual bool     CalibrateClock(uint32_t queue, uint64_t& gpuTimestamp, uint64_t& cpuTime) = 0;
+};
+
+struct GPUProfilerCreateInfo final
+{
+	uint32_t    numQueues{ 1 };
+	const char* queueNames[GPU_PROFILER_MAX_QUEUES]{}; // string literals, shown as the queue tracks of the profiler
+	uint32_t    maxQueriesPerFrame{ 1024 };            // per queue, two queries per zone
+	uint32_t    numFramesInFlight{ 2 };
+};
+
+class GPUProfiler final
+{
+public:
+	~GPUProfiler();
+
+	[[nodiscard]] bool Create(const GPUProfilerCreateInfo& createInfo, GPUTimestampDevice* device);
+	void Destroy();
+
+	// Thread-safe while command lists of the current frame are recorded. Both return the query index to write the timestamp to,
+	// UINT32_MAX when the frame is out of queries. name must be a string literal.
+	[[nodiscard]] uint32_t BeginZone(uint32_t queue);
+	[[nodiscard]] uint32_t EndZone(uint32_t queue, const char* name, uint32_t beginQuery);
+
+	// Call after the last command list of the frame was submitted to every queue: resolves the frame's queries,
+	// then hands the zones of all frames the GPU finished over to the CPU profiler.
+	void EndFrame();
+
+	// One slot more than frames in flight: the slot being recorded is never one the GPU may still resolve into.
+	// The device needs GetNumFrameSlots() * maxQueriesPerFrame queries per queue.
+	[[nodiscard]] static uint32_t GetNumFrameSlots(uint32_t numFramesInFlight) { return std::max(numFramesInFlight, 1u) + 1; }
+	[[nodiscard]] uint32_t GetNumFrameSlots() const { return m_numFrameSlots; }
+	[[nodiscard]] uint64_t GetNumDroppedZones() const { return m_numDroppedZones.load(std::memory_order_relaxed); }
+
+private:
+	struct Zone final
+	{
+		const char* name;
+		uint32_t    beginQuery; // relative to the first query of the frame slot
+		uint32_t    endQuery;
+	};
+
+	struct FrameSlot final
+	{
+		std::atomic<uint32_t> numQueries{ 0 };
+		std::mutex            zonesMutex;
+		std::vector<Zone>     zones;
+		bool                  pending{ false };    // resolved, waiting for the GPU
+		uint64_t              resolveFence{ 0 };
+		uint64_t              gpuCalibration{ 0 };
+		uint64_t              cpuCalibration{ 0 };
+		uint64_t              frameIndex{ 0 };     // FrameStatsGetFrameIndex() of the recorded frame
+	};
+
+	struct Queue final
+	{
+		std::unique_ptr<FrameSlot[]> slots;
+		uint64_t                     timestampFrequency{ 0 };
+	};
+
+	void readFrame(uint32_t queue, uint32_t slotIndex);
+	void resetFrame(FrameSlot& slot);
+
+	GPUProfilerCreateInfo  m_createInfo{};
+	GPUTimestampDevice*    m_device{ nullptr };
+	uint32_t               m_numFrameSlots{ 0 };
+	std::atomic<uint32_t>  m_currentSlot{ 0 };
+	Queue                  m_queues[GPU_PROFILER_MAX_QUEUES];
+	std::atomic<uint64_t>  m_numDroppedZones{ 0 };
+};
@@ -0,0 +1,202 @@
+﻿#include "stdafx.h"
+#if RENDER_D3D12
+#include "GPUProfilerD3D12.h"
+#include "oCommandQueueD3D12.h"
+#include "RHICoreD3D12.h"
+#include "Profiler.h"
+#include "Log.h"
+//=============================================================================
+GPUTimestampDeviceD3D12* thisGPUTimestampDevice = nullptr;
+extern GPUProfiler* thisGPUProfiler;
+//=============================================================================
+GPUTimestampDeviceD3D12::~GPUTimestampDeviceD3D12()
+{
+	assert(thisGPUTimestampDevice != this);
+}
+//=============================================================================
+bool GPUTimestampDeviceD3D12::Create(ID3D12Device* device, oCommandQueueD3D12* const* queues, uint32_t numQueues, uint32_t numQueries, uint32_t numFrameSlots)
+{
+	assert(!thisGPUTimestampDevice);
+	assert(numQueues <= GPU_PROFILER_MAX_QUEUES);
+
+	m_numQueues = numQueues;
+	for (uint32_t queueIndex = 0; queueIndex < numQueues; queueIndex++)
+	{
+		Queue& queue = m_queues[queueIndex];
+		queue.queue = queues[queueIndex];
+		queue.type = queue.queue->GetDeviceQueue()->GetDesc().Type;
+		if (queue.type == D3D12_COMMAND_LIST_TYPE_COPY)
+		{
+			Fatal("GPU timestamps on the copy queue are not supported");
+			return false;
+		}
+
+		D3D12_QUERY_HEAP_DESC queryHeapDesc = {};
+		queryHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+		queryHeapDesc.Count = numQueries;
+		HRESULT result = device->CreateQueryHeap(&queryHeapDesc, IID_PPV_ARGS(&queue.queryHeap));
+		if (FAILED(result))
+		{
+			Fatal("ID3D12Device::CreateQueryHeap() failed: " + DXErrorToStr(result));
+			return false;
+		}
+
+		const auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK);
+		const auto bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(uint64_t(numQueries) * sizeof(uint64_t));
+		result = device->CreateCommittedResource(
+			&heapProperties,
+			D3D12_HEAP_FLAG_NONE,
+			&bufferDesc,
+			D3D12_RESOURCE_STATE_COPY_DEST,
+			nullptr,
+			IID_PPV_ARGS(&queue.readbackBuffer));
+		if (FAILED(result))
+		{
+			Fatal("ID3D12Device::CreateCommittedResource() failed: " + DXErrorToStr(result));
+			return false;
+		}
+
+		// Readback buffers may stay mapped, the data is only read after the resolve fence completed
+		void* readbackData = nullptr;
+		result = queue.readbackBuffer->Map(0, nullptr, &readbackData);
+		if (FAILED(result))
+		{
+			Fatal("ID3D12Resource::Map() failed: " + DXErrorToStr(result));
+			return false;
+		}
+		queue.readbackData = static_cast<const uint64_t*>(readbackData);
+
+		queue.commandAllocators.resize(numFrameSlots);
+		for (ComPtr<ID3D12CommandAllocator>& commandAllocator : queue.commandAllocators)
+		{
+			result = device->CreateCommandAllocator(queue.type, IID_PPV_ARGS(&commandAllocator));
+			if (FAILED(result))
+			{
+				Fatal("ID3D12Device::CreateCommandAllocator() failed: " + DXErrorToStr(result));
+				return false;
+			}
+		}
+
+		result = device->CreateCommandList(0, queue.type, queue.commandAllocators[0].Get(), nullptr, IID_PPV_ARGS(&queue.commandList));
+		if (FAILED(result))
+		{
+			Fatal("ID3D12Device::CreateCommandList() failed: " + DXErrorToStr(result));
+			return false;
+		}
+		queue.commandList->Close();
+	}
+
+	thisGPUTimestampDevice = this;
+	return true;
+}
+//=============================================================================
+void GPUTimestampDeviceD3D12::Destroy()
+{
+	if (thisGPUTimestampDevice == this) thisGPUTimestampDevice = nullptr;
+
+	for (Queue& queue : m_queues)
+	{
+		if (queue.readbackBuffer && queue.readbackData) queue.readbackBuffer->Unmap(0, nullptr);
+		queue = {};
+	}
+	m_numQueues = 0;
+}
+//=============================================================================
+uint64_t GPUTimestampDeviceD3D12::ResolveTimestamps(uint32_t queueIndex, uint32_t frameSlot, uint32_t firstQuery, uint32_t numQueries)
+{
+	Queue& queue = m_queues[queueIndex];
+	ID3D12CommandAllocator* commandAllocator = queue.commandAllocators[frameSlot].Get();
+
+	// GPUProfiler only reuses a frame slot after its previous resolve completed
+	HRESULT result = commandAllocator->Reset();
+	if (SUCCEEDED(result)) result = queue.commandList->Reset(commandAllocator, nullptr);
+	if (FAILED(result))
+	{
+		Fatal("Failed to reset the timestamp resolve command list: " + DXErrorToStr(result));
+		return 0;
+	}
+
+	queue.commandList->ResolveQueryData(queue.queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, firstQuery, numQueries, queue.readbackBuffer.Get(), uint64_t(firstQuery) * sizeof(uint64_t));
+	return queue.queue->ExecuteCommandList(queue.commandList.Get());
+}
+//=============================================================================
+bool GPUTimestampDeviceD3D12::IsFenceComplete(uint32_t queueIndex, uint64_t fenceValue)
+{
+	return m_queues[queueIndex].queue->IsFenceComplete(fenceValue);
+}
+//=============================================================================
+void GPUTimestampDeviceD3D12::WaitForFence(uint32_t queueIndex, uint64_t fenceValue)
+{
+	m_queues[queueIndex].queue->WaitForFenceCPUBlocking(fenceValue);
+}
+//=============================================================================
+const uint64_t* GPUTimestampDeviceD3D12::ReadTimestamps(uint32_t queueIndex, uint32_t firstQuery, [[maybe_unused]] uint32_t numQueries)
+{
+	const Queue& queue = m_queues[queueIndex];
+	return queue.readbackData ? queue.readbackData + firstQuery : nullptr;
+}
+//=============================================================================
+uint64_t GPUTimestampDeviceD3D12::GetTimestampFrequency(uint32_t queueIndex)
+{
+	uint64_t frequency = 0;
+	if (FAILED(m_queues[queueIndex].queue->GetDeviceQueue()->GetTimestampFrequency(&frequency))) return 0;
+	return frequency;
+}
+//=============================================================================
+bool GPUTimestampDeviceD3D12::CalibrateClock(uint32_t queueIndex, uint64_t& gpuTimestamp, uint64_t& cpuTime)
+{
+	uint64_t cpuTimestamp = 0;
+	if (FAILED(m_queues[queueIndex].queue->GetDeviceQueue()->GetClockCalibration(&gpuTimestamp, &cpuTimestamp))) return false;
+
+	// The calibration CPU timestamp is a QueryPerformanceCounter() value, move it to the profiler clock
+	LARGE_INTEGER counter;
+	LARGE_INTEGER frequency;
+	QueryPerformanceCounter(&counter);
+	const uint64_t now = ProfilerGetTime();
+	QueryPerformanceFrequency(&frequency);
+
+	const int64_t elapsedTicks = counter.QuadPart - static_cast<int64_t>(cpuTimestamp);
+	cpuTime = now - static_cast<uint64_t>(static_cast<double>(elapsedTicks) * 1e9 / static_cast<double>(frequency.QuadPart));
+	return true;
+}
+//=============================================================================
+uint32_t GPUTimestampDeviceD3D12::GetQueueIndex(D3D12_COMMAND_LIST_TYPE type) const
+{
+	// bundles are executed as part of a direct command list
+	if (type == D3D12_COMMAND_LIST_TYPE_BUNDLE) return UINT32_MAX;
+
+	for (uint32_t queueIndex = 0; queueIndex < m_numQueues; queueIndex++)
+	{
+		if (m_queues[queueIndex].type == type) return queueIndex;
+	}
+	return UINT32_MAX;
+}
+//=============================================================================
+uint32_t GPUProfilerBeginZone(ID3D12GraphicsCommandList* commandList)
+{
+	if (!thisGPUProfiler || !thisGPUTimestampDevice) return UINT32_MAX;
+
+	const uint32_t queue = thisGPUTimestampDevice->GetQueueIndex(commandList->GetType());
+	if (queue == UINT32_MAX) return UINT32_MAX;
+
+	const uint32_t query = thisGPUProfiler->BeginZone(queue);
+	if (query != UINT32_MAX)
+	{
+		commandList->EndQuery(thisGPUTimestampDevice->GetQueryHeap(queue), D3D12_QUERY_TYPE_TIMESTAMP, query);
+	}
+	return query;
+}
+//=============================================================================
+void GPUProfilerEndZone(ID3D12GraphicsCommandList* commandList, const char* name, uint32_t beginQuery)
+{
+	if (beginQuery == UINT32_MAX || !thisGPUProfiler || !thisGPUTimestampDevice) return;
+
+	const uint32_t queue = thisGPUTimestampDevice->GetQueueIndex(commandList->GetType());
+	const uint32_t query = thisGPUProfiler->EndZone(queue, name, beginQuery);
+	if (query != UINT32_MAX)
+	{
+		commandList->EndQuery(thisGPUTimestampDevice->GetQueryHeap(queue), D3D12_QUERY_TYPE_TIMESTAMP, query);
+	}
+}
+//=============================================================================
+#endif // RENDER_D3D12
@@ -0,0 +1,50 @@
+﻿#pragma once
+
+#if RENDER_D3D12
+
+#include "GPUProfiler.h"
+
+class oCommandQueueD3D12;
+
+// Timestamp query heap, resolve command lists and a persistently mapped readback buffer per queue.
+// Copy queues are not supported, their timestamps need an optional query heap type.
+class GPUTimestampDeviceD3D12 final : public GPUTimestampDevice
+{
+public:
+	~GPUTimestampDeviceD3D12();
+
+	[[nodiscard]] bool Create(ID3D12Device* device, oCommandQueueD3D12* const* queues, uint32_t numQueues, uint32_t numQueries, uint32_t numFrameSlots);
+	void Destroy();
+
+	uint64_t        ResolveTimestamps(uint32_t queue, uint32_t frameSlot, uint32_t firstQuery, uint32_t numQueries) final;
+	bool            IsFenceComplete(uint32_t queue, uint64_t fenceValue) final;
+	void            WaitForFence(uint32_t queue, uint64_t fenceValue) final;
+	const uint64_t* ReadTimestamps(uint32_t queue, uint32_t firstQuery, uint32_t numQueries) final;
+	uint64_t        GetTimestampFrequency(uint32_t queue) final;
+	bool            CalibrateClock(uint32_t queue, uint64_t& gpuTimestamp, uint64_t& cpuTime) final;
+
+	// UINT32_MAX when command lists of this type are not profiled
+	[[nodiscard]] uint32_t GetQueueIndex(D3D12_COMMAND_LIST_TYPE type) const;
+	[[nodiscard]] ID3D12QueryHeap* GetQueryHeap(uint32_t queue) const { return m_queues[queue].queryHeap.Get(); }
+
+private:
+	struct Queue final
+	{
+		oCommandQueueD3D12*                         queue{ nullptr };
+		D3D12_COMMAND_LIST_TYPE                     type{ D3D12_COMMAND_LIST_TYPE_DIRECT };
+		ComPtr<ID3D12QueryHeap>                     queryHeap;
+		ComPtr<ID3D12Resource>                      readbackBuffer;
+		const uint64_t*                             readbackData{ nullptr };
+		std::vector<ComPtr<ID3D12CommandAllocator>> commandAllocators; // per frame slot
+		ComPtr<ID3D12GraphicsCommandList>           commandList;
+	};
+
+	Queue    m_queues[GPU_PROFILER_MAX_QUEUES];
+	uint32_t m_numQueues{ 0 };
+};
+
+// Used by ScopedGPUMarker. Write a timestamp into the command list while a GPU profiler runs and return its query, UINT32_MAX otherwise.
+uint32_t GPUProfilerBeginZone(ID3D12GraphicsCommandList* commandList);
+void     GPUProfilerEndZone(ID3D12GraphicsCommandList* commandList, const char* name, uint32_t beginQuery);
+
+#endif // RENDER_D3D12
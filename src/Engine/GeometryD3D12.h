@@ -3,6 +3,7 @@
 #if RENDER_D3D12
 
 #include "GPUBufferD3D12.h"
+#include "SubmeshTable.h"
 
 struct SubmeshGeometry final
 {
@@ -37,9 +38,18 @@ struct MeshGeometry final
 	UINT IndexBufferByteSize = 0;
 
 	// A MeshGeometry may store multiple geometries in one vertex/index buffer.
-	// Use this container to define the Submesh geometries so we can draw
-	// the Submeshes individually.
-	std::unordered_map<std::string, SubmeshGeometry> DrawArgs;
+	// The submeshes are drawn by SubmeshId, the names are only looked up while loading.
+	SubmeshTable Submeshes;
+	SubmeshNameIndex SubmeshNames;
+
+	SubmeshId AddSubmesh(std::string_view name, const SubmeshGeometry& submesh)
+	{
+		const SubmeshId id = Submeshes.Add(submesh.IndexCount, submesh.StartIndexLocation, submesh.BaseVertexLocation,
+			{ submesh.Bounds.Center.x, submesh.Bounds.Center.y, submesh.Bounds.Center.z },
+			{ submesh.Bounds.Extents.x, submesh.Bounds.Extents.y, submesh.Bounds.Extents.z });
+		if (!SubmeshNames.Add(name, id)) return {};
+		return id;
+	}
 
 	D3D12_VERTEX_BUFFER_VIEW VertexBufferView() const
 	{
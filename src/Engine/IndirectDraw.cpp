@@ -0,0 +1,31 @@
+﻿#include "stdafx.h"
+#include "IndirectDraw.h"
+#include "FrustumCulling.h"
+//=============================================================================
+uint32_t CullIndirectDraws(const CullingFrustum& frustum, std::span<const IndirectDrawObject> objects, uint64_t objectConstantsAddress, IndirectDrawCommand* commands)
+{
+	uint32_t numCommands = 0;
+	for (uint32_t objectIndex = 0; objectIndex < objects.size(); objectIndex++)
+	{
+		const IndirectDrawObject& object = objects[objectIndex];
+		bool inside = true;
+		for (const glm::vec4& plane : frustum.planes)
+		{
+			const float distance = plane.x * object.boundsCenter.x + plane.y * object.boundsCenter.y + plane.z * object.boundsCenter.z + plane.w;
+			const float radius = std::abs(plane.x) * object.boundsExtents.x + std::abs(plane.y) * object.boundsExtents.y + std::abs(plane.z) * object.boundsExtents.z;
+			inside = inside && distance + radius >= 0.0f;
+		}
+		if (!inside) continue;
+
+		IndirectDrawCommand& command = commands[numCommands++];
+		command.objectConstantsAddress = objectConstantsAddress + uint64_t(objectIndex) * INDIRECT_OBJECT_CONSTANTS_STRIDE;
+		command.indexCountPerInstance = object.indexCount;
+		command.instanceCount = 1;
+		command.startIndexLocation = object.startIndexLocation;
+		command.baseVertexLocation = object.baseVertexLocation;
+		command.startInstanceLocation = 0;
+		command.padding = 0;
+	}
+	return numCommands;
+}
+//=============================================================================
@@ -0,0 +1,57 @@
+﻿#pragma once
+
+#include <span>
+#include "Data/Shaders/Shared.h"
+
+// GPU-driven drawing of static geometry: the draws live in a structured buffer of IndirectDrawObjects, a compute pass culls
+// them against the frustum and appends an IndirectDrawCommand per visible object, ExecuteIndirect() then draws the appended
+// commands (see IndirectDrawD3D12 and IndirectCull.hlsl). A command sets the per-object constant buffer of the draw, object i
+// has its MeshConstants at objectConstantsAddress + i * INDIRECT_OBJECT_CONSTANTS_STRIDE, and draws one instance.
+//
+// CullIndirectDraws() is the reference of the compute pass on the CPU. It tests the boxes the same way as the shader and as
+// CullBoxes(), and writes the commands in object order; the GPU appends them in any order.
+
+struct CullingFrustum;
+
+constexpr uint32_t INDIRECT_OBJECT_CONSTANTS_STRIDE = hlsl::INDIRECT_OBJECT_CONSTANTS_STRIDE; // shared with IndirectCull.hlsl
+constexpr uint32_t INDIRECT_CULL_GROUP_SIZE = 64; // numthreads of IndirectCull.hlsl
+
+// matches IndirectDrawObject in Data/Shaders/Shared.h, the asserts below keep the copy in sync
+struct IndirectDrawObject final
+{
+	glm::vec3 boundsCenter{ 0.0f };
+	uint32_t  indexCount{ 0 };
+	glm::vec3 boundsExtents{ 0.0f };
+	uint32_t  startIndexLocation{ 0 };
+	int32_t   baseVertexLocation{ 0 };
+	uint32_t  padding[3]{};
+};
+static_assert(sizeof(IndirectDrawObject) == sizeof(hlsl::IndirectDrawObject));
+static_assert(offsetof(IndirectDrawObject, boundsCenter) == offsetof(hlsl::IndirectDrawObject, boundsCenter));
+static_assert(offsetof(IndirectDrawObject, indexCount) == offsetof(hlsl::IndirectDrawObject, indexCount));
+static_assert(offsetof(IndirectDrawObject, boundsExtents) == offsetof(hlsl::IndirectDrawObject, boundsExtents));
+static_assert(offsetof(IndirectDrawObject, startIndexLocation) == offsetof(hlsl::IndirectDrawObject, startIndexLocation));
+static_assert(offsetof(IndirectDrawObject, baseVertexLocation) == offsetof(hlsl::IndirectDrawObject, baseVertexLocation));
+
+// matches IndirectDrawCommand in Data/Shaders/Shared.h: a root CBV address followed by D3D12_DRAW_INDEXED_ARGUMENTS
+struct IndirectDrawCommand final
+{
+	uint64_t objectConstantsAddress{ 0 };
+	uint32_t indexCountPerInstance{ 0 };
+	uint32_t instanceCount{ 0 };
+	uint32_t startIndexLocation{ 0 };
+	int32_t  baseVertexLocation{ 0 };
+	uint32_t startInstanceLocation{ 0 };
+	uint32_t padding{ 0 };
+};
+static_assert(sizeof(IndirectDrawCommand) == sizeof(hlsl::IndirectDrawCommand));
+static_assert(offsetof(IndirectDrawCommand, objectConstantsAddress) == offsetof(hlsl::IndirectDrawCommand, objectConstantsAddress));
+static_assert(offsetof(IndirectDrawCommand, indexCountPerInstance) == offsetof(hlsl::IndirectDrawCommand, indexCountPerInstance));
+static_assert(offsetof(IndirectDrawCommand, instanceCount) == offsetof(hlsl::IndirectDrawCommand, instanceCount));
+static_assert(offsetof(IndirectDrawCommand, startIndexLocation) == offsetof(hlsl::IndirectDrawCommand, startIndexLocation));
+static_assert(offsetof(IndirectDrawCommand, baseVertexLocation) == offsetof(hlsl::IndirectDrawCommand, baseVertexLocation));
+static_assert(offsetof(IndirectDrawCommand, startInstanceLocation) == offsetof(hlsl::IndirectDrawCommand, startInstanceLocation));
+
+// Writes a command for every object inside of the frustum to commands, which has room for objects.size() commands. Returns
+// their number.
+uint32_t CullIndirectDraws(const CullingFrustum& frustum, std::span<const IndirectDrawObject> objects, uint64_t objectConstantsAddress, IndirectDrawCommand* commands);
@@ -0,0 +1,168 @@
+﻿#include "stdafx.h"
+#if RENDER_D3D12
+#include "IndirectDrawD3D12.h"
+#include "oRHIBackendD3D12.h"
+#include "FrustumCulling.h"
+//=============================================================================
+bool IndirectDrawD3D12::Create(const PipelineStateObject& drawPipeline, uint32_t maxObjects)
+{
+	assert(maxObjects > 0);
+	m_maxObjects = maxObjects;
+
+	// every command sets the per-object CBV, then draws
+	const std::optional<uint32_t>& objectCBV = drawPipeline.pipelineResourceMapping.cbvMapping[PER_OBJECT_SPACE];
+	if (!objectCBV.has_value())
+	{
+		Error("IndirectDrawD3D12: the draw pipeline has no per-object constant buffer");
+		return false;
+	}
+
+	D3D12_INDIRECT_ARGUMENT_DESC arguments[2]{};
+	arguments[0].Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT_BUFFER_VIEW;
+	arguments[0].ConstantBufferView.RootParameterIndex = objectCBV.value();
+	arguments[1].Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+
+	D3D12_COMMAND_SIGNATURE_DESC signatureDesc{};
+	signatureDesc.ByteStride = sizeof(IndirectDrawCommand);
+	signatureDesc.NumArgumentDescs = 2;
+	signatureDesc.pArgumentDescs = arguments;
+	HRESULT result = ogRHI.device->CreateCommandSignature(&signatureDesc, drawPipeline.rootSignature.Get(), IID_PPV_ARGS(&m_commandSignature));
+	if (FAILED(result))
+	{
+		Error("ID3D12Device14::CreateCommandSignature() failed: " + DXErrorToStr(result));
+		return false;
+	}
+
+	ShaderCreationDesc cullShaderDesc;
+	cullShaderDesc.shaderName = L"IndirectCull.hlsl";
+	cullShaderDesc.entryPoint = L"ComputeShader";
+	cullShaderDesc.type = ShaderType::compute;
+	m_cullShader = CreateShader(cullShaderDesc);
+	if (!m_cullShader) return false;
+
+	ComputePipelineDesc cullPipelineDesc;
+	cullPipelineDesc.computeShader = m_cullShader.get();
+	m_cullPipeline = CreateComputePipeline(cullPipelineDesc);
+	if (!m_cullPipeline) return false;
+	m_cullPipelineInfo.pipeline = m_cullPipeline.get();
+
+	BufferCreationDesc objectsDesc{};
+	objectsDesc.size = maxObjects * static_cast<uint32_t>(sizeof(IndirectDrawObject));
+	objectsDesc.stride = sizeof(IndirectDrawObject);
+	objectsDesc.viewFlags = BufferViewFlags::srv;
+	objectsDesc.accessFlags = BufferAccessFlags::hostWritable;
+	m_objects = CreateBuffer(objectsDesc);
+
+	BufferCreationDesc commandsDesc{};
+	commandsDesc.size = maxObjects * static_cast<uint32_t>(sizeof(IndirectDrawCommand));
+	commandsDesc.stride = sizeof(IndirectDrawCommand);
+	commandsDesc.viewFlags = BufferViewFlags::uav;
+	m_commands = CreateBuffer(commandsDesc);
+
+	BufferCreationDesc countDesc{};
+	countDesc.size = sizeof(uint32_t);
+	countDesc.viewFlags = BufferViewFlags::uav;
+	countDesc.isRawAccess = true;
+	m_count = CreateBuffer(countDesc);
+
+	BufferCreationDesc zeroDesc{};
+	zeroDesc.size = sizeof(uint32_t);
+	zeroDesc.accessFlags = BufferAccessFlags::hostWritable;
+	m_zero = CreateBuffer(zeroDesc);
+	if (!m_objects || !m_commands || !m_count || !m_zero)
+	{
+		Error("IndirectDrawD3D12: failed to create the buffers");
+		return false;
+	}
+	uint32_t zero = 0;
+	m_zero->SetMappedData(&zero, sizeof(zero));
+
+	BufferCreationDesc constantsDesc{};
+	constantsDesc.size = sizeof(IndirectCullConstants);
+	constantsDesc.viewFlags = BufferViewFlags::cbv;
+	constantsDesc.accessFlags = BufferAccessFlags::hostWritable;
+	for (uint32_t frameIndex = 0; frameIndex < NUM_FRAMES_IN_FLIGHT; frameIndex++)
+	{
+		m_cullConstants[frameIndex] = CreateBuffer(constantsDesc);
+		if (!m_cullConstants[frameIndex])
+		{
+			Error("IndirectDrawD3D12: failed to create the cull constant buffers");
+			return false;
+		}
+		m_cullSpaces[frameIndex].SetCBV(m_cullConstants[frameIndex].get());
+		m_cullSpaces[frameIndex].SetUAV({ 0, m_commands.get() });
+		m_cullSpaces[frameIndex].SetUAV({ 1, m_count.get() });
+		m_cullSpaces[frameIndex].Lock();
+	}
+	return true;
+}
+//=============================================================================
+void IndirectDrawD3D12::Destroy()
+{
+	for (std::unique_ptr<BufferResource>& constants : m_cullConstants)
+	{
+		if (constants) DestroyBuffer(std::move(constants));
+	}
+	if (m_zero) DestroyBuffer(std::move(m_zero));
+	if (m_count) DestroyBuffer(std::move(m_count));
+	if (m_commands) DestroyBuffer(std::move(m_commands));
+	if (m_objects) DestroyBuffer(std::move(m_objects));
+	if (m_cullPipeline) DestroyPipelineStateObject(std::move(m_cullPipeline));
+	if (m_cullShader) DestroyShader(std::move(m_cullShader));
+	m_commandSignature.Reset();
+	m_cullSpaces = {};
+	m_numObjects = 0;
+}
+//=============================================================================
+bool IndirectDrawD3D12::SetObjects(std::span<const IndirectDrawObject> objects, const BufferResource& objectConstants)
+{
+	if (objects.size() > m_maxObjects)
+	{
+		Error("IndirectDrawD3D12: " + std::to_string(objects.size()) + " objects, the buffers hold " + std::to_string(m_maxObjects));
+		return false;
+	}
+	if (objectConstants.desc.Width < objects.size() * INDIRECT_OBJECT_CONSTANTS_STRIDE)
+	{
+		Error("IndirectDrawD3D12: the object constant buffer is too small");
+		return false;
+	}
+
+	if (!objects.empty()) memcpy(m_objects->mappedResource, objects.data(), objects.size_bytes());
+	m_objectConstantsAddress = objectConstants.virtualAddress;
+	m_numObjects = static_cast<uint32_t>(objects.size());
+	return true;
+}
+//=============================================================================
+void IndirectDrawD3D12::Cull(GraphicsCommandContextD3D12& context, const CullingFrustum& frustum)
+{
+	const uint32_t frameIndex = ogRHI.GetCurrentBackBufferIndex();
+	IndirectCullConstants constants;
+	for (uint32_t plane = 0; plane < 6; plane++) constants.frustumPlanes[plane] = frustum.planes[plane];
+	constants.objectConstantsAddress = m_objectConstantsAddress;
+	constants.objectBufferIndex = m_objects->descriptorHeapIndex;
+	constants.numObjects = m_numObjects;
+	m_cullConstants[frameIndex]->SetMappedData(&constants, sizeof(constants));
+
+	context.AddBarrier(*m_count, D3D12_RESOURCE_STATE_COPY_DEST);
+	context.FlushBarriers();
+	context.CopyBufferRegion(*m_count, 0, *m_zero, 0, sizeof(uint32_t));
+
+	context.AddBarrier(*m_count, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	context.AddBarrier(*m_commands, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	context.FlushBarriers();
+	context.SetPipeline(m_cullPipelineInfo);
+	context.SetPipelineResources(PER_PASS_SPACE, m_cullSpaces[frameIndex]);
+	if (m_numObjects > 0) context.Dispatch1D(m_numObjects, INDIRECT_CULL_GROUP_SIZE);
+
+	context.AddBarrier(*m_count, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+	context.AddBarrier(*m_commands, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+	context.FlushBarriers();
+}
+//=============================================================================
+void IndirectDrawD3D12::Draw(GraphicsCommandContextD3D12& context)
+{
+	if (m_numObjects == 0) return;
+	context.ExecuteIndirect(m_commandSignature.Get(), m_numObjects, *m_commands, m_count.get());
+}
+//=============================================================================
+#endif // RENDER_D3D12
@@ -0,0 +1,59 @@
+﻿#pragma once
+
+#if RENDER_D3D12
+
+#include "IndirectDraw.h"
+#include "oCommandContextD3D12.h"
+
+// GPU-driven drawing of static geometry with ExecuteIndirect(). Cull() records a compute pass (IndirectCull.hlsl) that tests the
+// objects against the frustum and appends a command per visible object, Draw() executes the appended commands with the count
+// the pass wrote. The command signature sets the per-object CBV of the draw pipeline before every draw, so Mesh.hlsl draws the
+// objects without changes. The CPU never touches the draws of the static geometry again after SetObjects().
+
+// matches IndirectCullConstants in Data/Shaders/Shared.h
+struct IndirectCullConstants final
+{
+	glm::vec4 frustumPlanes[6];
+	uint64_t  objectConstantsAddress{ 0 };
+	uint32_t  objectBufferIndex{ 0 };
+	uint32_t  numObjects{ 0 };
+};
+static_assert(sizeof(IndirectCullConstants) == sizeof(hlsl::IndirectCullConstants));
+static_assert(offsetof(IndirectCullConstants, frustumPlanes) == offsetof(hlsl::IndirectCullConstants, frustumPlanes));
+static_assert(offsetof(IndirectCullConstants, objectConstantsAddress) == offsetof(hlsl::IndirectCullConstants, objectConstantsAddress));
+static_assert(offsetof(IndirectCullConstants, objectBufferIndex) == offsetof(hlsl::IndirectCullConstants, objectBufferIndex));
+static_assert(offsetof(IndirectCullConstants, numObjects) == offsetof(hlsl::IndirectCullConstants, numObjects));
+
+class IndirectDrawD3D12 final
+{
+public:
+	// drawPipeline is the pipeline Draw() is used with, its per-object CBV is the one the commands set
+	[[nodiscard]] bool Create(const PipelineStateObject& drawPipeline, uint32_t maxObjects);
+	void Destroy();
+
+	// objectConstants holds the MeshConstants of object i at i * INDIRECT_OBJECT_CONSTANTS_STRIDE. The objects are written into an
+	// upload heap the GPU reads from, call it when no frame in flight draws them.
+	[[nodiscard]] bool SetObjects(std::span<const IndirectDrawObject> objects, const BufferResource& objectConstants);
+
+	// Resets the count, records the culling pass and leaves the commands ready for Draw(). Changes the pipeline.
+	void Cull(GraphicsCommandContextD3D12& context, const CullingFrustum& frustum);
+	// The draw pipeline, the other resource spaces and the index buffer have to be set
+	void Draw(GraphicsCommandContextD3D12& context);
+
+private:
+	ComPtr<ID3D12CommandSignature>                                    m_commandSignature;
+	std::unique_ptr<Shader>                                           m_cullShader;
+	std::unique_ptr<PipelineStateObject>                              m_cullPipeline;
+	PipelineInfo                                                      m_cullPipelineInfo;
+	std::unique_ptr<BufferResource>                                   m_objects;
+	std::unique_ptr<BufferResource>                                   m_commands;
+	std::unique_ptr<BufferResource>                                   m_count;
+	std::unique_ptr<BufferResource>                                   m_zero;      // copied into m_count before every pass
+	std::array<std::unique_ptr<BufferResource>, NUM_FRAMES_IN_FLIGHT> m_cullConstants;
+	std::array<PipelineResourceSpace, NUM_FRAMES_IN_FLIGHT>           m_cullSpaces;
+	uint64_t                                                          m_objectConstantsAddress{ 0 };
+	uint32_t                                                          m_numObjects{ 0 };
+	uint32_t                                                          m_maxObjects{ 0 };
+};
+
+#endif // RENDER_D3D12
@@ -32,6 +32,7 @@ public:
 	glm::vec2 GetDeltaMouse() const;
 	bool IsPress(Key key) const;
 	bool IsPress(MouseButton mouseKey) const;
+	bool IsPressedThisFrame(Key key) const; // only in the frame the key went down
 
 private:
 	void onResuming();
@@ -74,6 +74,11 @@ bool InputSystem::IsPress(Key key) const
 	return m_lastKeyboardState.IsKeyDown(key);
 }
 //=============================================================================
+bool InputSystem::IsPressedThisFrame(Key key) const
+{
+	return m_keys.IsKeyPressed(key);
+}
+//=============================================================================
 bool InputSystem::IsPress(MouseButton mouseKey) const
 {
 	switch (mouseKey)
@@ -0,0 +1,69 @@
+﻿#include "stdafx.h"
+#include "InstanceBatcher.h"
+//=============================================================================
+namespace
+{
+	bool canMerge(const DrawItem& batch, const DrawItem& draw)
+	{
+		return batch.pipeline == draw.pipeline &&
+			batch.resources == draw.resources &&
+			batch.resourceSpace == draw.resourceSpace &&
+			batch.indexBuffer == draw.indexBuffer &&
+			batch.indexCount == draw.indexCount &&
+			batch.startIndexLocation == draw.startIndexLocation &&
+			batch.baseVertexLocation == draw.baseVertexLocation;
+	}
+}
+//=============================================================================
+uint64_t MakeInstancingDrawKey(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh)
+{
+	assert(mesh < (1u << DRAW_KEY_DEPTH_BITS));
+	return MakeOpaqueDrawKey(pass, pipeline, material, 0.0f) | mesh;
+}
+//=============================================================================
+void InstanceBatcher::Reserve(uint32_t numDraws)
+{
+	m_drawList.Reserve(numDraws);
+	m_addedInstances.reserve(numDraws);
+	m_instances.reserve(numDraws);
+}
+//=============================================================================
+void InstanceBatcher::Clear()
+{
+	m_drawList.Clear();
+	m_addedInstances.clear();
+	m_instances.clear();
+	m_batches.clear();
+}
+//=============================================================================
+void InstanceBatcher::Add(uint64_t key, const DrawItem& draw, const MeshInstanceData& instance)
+{
+	m_drawList.Add(key, draw);
+	m_addedInstances.push_back(instance);
+}
+//=============================================================================
+void InstanceBatcher::Build(JobSystem* jobSystem)
+{
+	m_drawList.Sort(jobSystem);
+	m_instances.resize(m_addedInstances.size());
+	m_batches.clear();
+
+	const std::span<const uint32_t> order = m_drawList.GetOrder();
+	const std::span<const uint64_t> keys = m_drawList.GetOrderedKeys();
+	InstanceBatch* batch = nullptr;
+	for (uint32_t position = 0; position < order.size(); position++)
+	{
+		const DrawItem& draw = m_drawList.GetItem(order[position]);
+		if (!batch || !canMerge(batch->draw, draw))
+		{
+			batch = &m_batches.emplace_back();
+			batch->key = keys[position];
+			batch->draw = draw;
+			batch->draw.instanceCount = 0;
+			batch->draw.startInstanceLocation = position;
+		}
+		batch->draw.instanceCount++;
+		m_instances[position] = m_addedInstances[order[position]];
+	}
+}
+//=============================================================================
@@ -0,0 +1,57 @@
+﻿#pragma once
+
+#include "DrawList.h"
+
+// Automatic instancing: draws of the same mesh with the same pipeline and resources are merged into one instanced draw. Every
+// added draw brings its per-instance data, Build() sorts the draws by key and merges neighbours whose DrawItems match in state
+// and index range. The instances of a batch are contiguous in GetInstances(), in the order of Add(), and the batch draws them
+// with startInstanceLocation set to its first instance. The instance data travels to the GPU in a structured buffer (see
+// InstanceBufferD3D12), which also carries what differs between the merged draws: the world matrix and the material.
+//
+// Draws only merge when they are neighbours after sorting, MakeInstancingDrawKey() puts the mesh into the low bits for that.
+
+class JobSystem;
+
+// matches MeshInstance in Data/Shaders/Shared.h
+struct MeshInstanceData final
+{
+	glm::mat4 worldMatrix{ 1.0f };
+	uint32_t  vertexBufferIndex{ 0 };
+	uint32_t  textureIndex{ 0 };
+	uint32_t  padding[2]{};
+};
+static_assert(sizeof(MeshInstanceData) == 80);
+
+struct InstanceBatch final
+{
+	uint64_t key{ 0 };
+	DrawItem draw; // instanceCount and startInstanceLocation select the instances of the batch
+};
+
+// pass | pipeline | material | mesh, the ids below 1 << their number of bits in the opaque key. The material stands for
+// draw.resources: materials that differ only in MeshInstanceData, like bindless textures, should share an id so that their
+// instances merge.
+[[nodiscard]] uint64_t MakeInstancingDrawKey(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh);
+
+class InstanceBatcher final
+{
+public:
+	void Reserve(uint32_t numDraws);
+	void Clear();
+
+	// draw.instanceCount and draw.startInstanceLocation are ignored, every Add() is one instance
+	void Add(uint64_t key, const DrawItem& draw, const MeshInstanceData& instance);
+
+	// Sorts the draws (on the job system for large lists) and merges them into batches
+	void Build(JobSystem* jobSystem = nullptr);
+
+	[[nodiscard]] uint32_t GetNumDraws() const { return m_drawList.GetCount(); }
+	[[nodiscard]] const std::vector<InstanceBatch>& GetBatches() const { return m_batches; }
+	[[nodiscard]] const std::vector<MeshInstanceData>& GetInstances() const { return m_instances; }
+
+private:
+	DrawList                      m_drawList;
+	std::vector<MeshInstanceData> m_addedInstances; // in the order of Add()
+	std::vector<MeshInstanceData> m_instances;      // in batch order
+	std::vector<InstanceBatch>    m_batches;
+};
@@ -0,0 +1,106 @@
+﻿#include "stdafx.h"
+#if RENDER_D3D12
+#include "InstanceBufferD3D12.h"
+#include "oRHIBackendD3D12.h"
+//=============================================================================
+namespace
+{
+	constexpr uint32_t MIN_INSTANCE_CAPACITY = 1024;
+	constexpr uint32_t MIN_BATCH_CAPACITY = 256;
+	constexpr uint32_t BATCH_CONSTANTS_STRIDE = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT;
+	static_assert(sizeof(InstanceBatchConstants) <= BATCH_CONSTANTS_STRIDE);
+}
+//=============================================================================
+bool InstanceBufferD3D12::Upload(const InstanceBatcher& batcher, DrawList& drawList, uint32_t resourceSpace)
+{
+	const std::vector<InstanceBatch>& batches = batcher.GetBatches();
+	const std::vector<MeshInstanceData>& instances = batcher.GetInstances();
+	if (batches.empty()) return true;
+
+	FrameBuffers& frame = m_frames[ogRHI.GetCurrentBackBufferIndex()];
+	if (!reserve(frame, static_cast<uint32_t>(instances.size()), static_cast<uint32_t>(batches.size())))
+		return false;
+
+	memcpy(frame.instances->mappedResource, instances.data(), instances.size() * sizeof(MeshInstanceData));
+
+	drawList.Reserve(drawList.GetCount() + static_cast<uint32_t>(batches.size()));
+	for (uint32_t batchIndex = 0; batchIndex < batches.size(); batchIndex++)
+	{
+		const InstanceBatch& batch = batches[batchIndex];
+		const InstanceBatchConstants constants{ frame.instances->descriptorHeapIndex, batch.draw.startInstanceLocation };
+		memcpy(frame.batchConstants->mappedResource + size_t(batchIndex) * BATCH_CONSTANTS_STRIDE, &constants, sizeof(constants));
+
+		DrawItem draw = batch.draw;
+		draw.resources = &frame.batchSpaces[batchIndex];
+		draw.resourceSpace = resourceSpace;
+		draw.startInstanceLocation = 0;
+		drawList.Add(batch.key, draw);
+	}
+	return true;
+}
+//=============================================================================
+void InstanceBufferD3D12::Destroy()
+{
+	for (FrameBuffers& frame : m_frames)
+	{
+		if (frame.instances) DestroyBuffer(std::move(frame.instances));
+		if (frame.batchConstants) DestroyBuffer(std::move(frame.batchConstants));
+		frame = {};
+	}
+}
+//=============================================================================
+bool InstanceBufferD3D12::reserve(FrameBuffers& frame, uint32_t numInstances, uint32_t numBatches)
+{
+	// the buffers of this frame are no longer in use by the GPU, DestroyBuffer() keeps them alive until the frame comes around again
+	if (numInstances > frame.instanceCapacity)
+	{
+		const uint32_t capacity = std::max({ numInstances, frame.instanceCapacity * 2, MIN_INSTANCE_CAPACITY });
+		if (frame.instances) DestroyBuffer(std::move(frame.instances));
+		frame.instanceCapacity = 0;
+
+		BufferCreationDesc desc{};
+		desc.size = capacity * static_cast<uint32_t>(sizeof(MeshInstanceData));
+		desc.stride = sizeof(MeshInstanceData);
+		desc.viewFlags = BufferViewFlags::srv;
+		desc.accessFlags = BufferAccessFlags::hostWritable;
+		frame.instances = CreateBuffer(desc);
+		if (!frame.instances || !frame.instances->mappedResource)
+		{
+			Error("InstanceBufferD3D12: failed to create the instance buffer");
+			return false;
+		}
+		frame.instanceCapacity = capacity;
+	}
+
+	if (numBatches > frame.batchCapacity)
+	{
+		const uint32_t capacity = std::max({ numBatches, frame.batchCapacity * 2, MIN_BATCH_CAPACITY });
+		if (frame.batchConstants) DestroyBuffer(std::move(frame.batchConstants));
+		frame.batchCapacity = 0;
+
+		// bound as root CBVs by address, the buffer needs no descriptor
+		BufferCreationDesc desc{};
+		desc.size = capacity * BATCH_CONSTANTS_STRIDE;
+		desc.accessFlags = BufferAccessFlags::hostWritable;
+		frame.batchConstants = CreateBuffer(desc);
+		if (!frame.batchConstants || !frame.batchConstants->mappedResource)
+		{
+			Error("InstanceBufferD3D12: failed to create the batch constant buffer");
+			return false;
+		}
+
+		// resizing moves the views, every space points to its view again
+		frame.batchViews.resize(capacity);
+		frame.batchSpaces.resize(capacity);
+		for (uint32_t batch = 0; batch < capacity; batch++)
+		{
+			frame.batchViews[batch].virtualAddress = frame.batchConstants->virtualAddress + uint64_t(batch) * BATCH_CONSTANTS_STRIDE;
+			frame.batchSpaces[batch].SetCBV(&frame.batchViews[batch]);
+			if (!frame.batchSpaces[batch].IsLocked()) frame.batchSpaces[batch].Lock();
+		}
+		frame.batchCapacity = capacity;
+	}
+	return true;
+}
+//=============================================================================
+#endif // RENDER_D3D12
@@ -0,0 +1,46 @@
+﻿#pragma once
+
+#if RENDER_D3D12
+
+#include "InstanceBatcher.h"
+#include "oRenderCoreD3D12.h"
+
+// GPU side of InstanceBatcher: every frame in flight owns a host-writable structured buffer with the instances and a constant
+// buffer with one InstanceBatchConstants per batch, 256 bytes apart. Shader model 6.6 has no SV_StartInstanceLocation, the
+// batch constants tell the shader where the instances of its batch begin (see MeshInstanced.hlsl). The buffers grow by
+// doubling, the old ones are released once the GPU is done with them.
+
+// matches InstanceBatchConstants in Data/Shaders/Shared.h
+struct InstanceBatchConstants final
+{
+	uint32_t instanceBufferIndex{ 0 };
+	uint32_t firstInstance{ 0 };
+};
+
+class InstanceBufferD3D12 final
+{
+public:
+	// Writes the instances into the buffers of the current frame and adds one draw per batch to drawList, with the batch
+	// constants bound to resourceSpace (PER_OBJECT_SPACE in MeshInstanced.hlsl). The draws stay valid until the next Upload()
+	// of the same frame. The batches draw from instance 0, the shader adds firstInstance to SV_InstanceID.
+	[[nodiscard]] bool Upload(const InstanceBatcher& batcher, DrawList& drawList, uint32_t resourceSpace = PER_OBJECT_SPACE);
+	void Destroy();
+
+private:
+	struct FrameBuffers final
+	{
+		std::unique_ptr<BufferResource>    instances;
+		std::unique_ptr<BufferResource>    batchConstants;
+		uint32_t                           instanceCapacity{ 0 };
+		uint32_t                           batchCapacity{ 0 };
+		// one CBV per batch into batchConstants, only the virtual address of a view is set
+		std::vector<BufferResource>        batchViews;
+		std::vector<PipelineResourceSpace> batchSpaces;
+	};
+
+	[[nodiscard]] bool reserve(FrameBuffers& frame, uint32_t numInstances, uint32_t numBatches);
+
+	std::array<FrameBuffers, NUM_FRAMES_IN_FLIGHT> m_frames;
+};
+
+#endif // RENDER_D3D12
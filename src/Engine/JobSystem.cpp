@@ -0,0 +1,461 @@
+﻿#include "stdafx.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+#include "Log.h"
+#if defined(_M_X64) || defined(__x86_64__)
+#	include <immintrin.h>
+#endif
+//=============================================================================
+JobSystem* thisJobSystem = nullptr;
+//=============================================================================
+namespace
+{
+	struct JobSystemThread final
+	{
+		const JobSystem* system{ nullptr };
+		uint32_t         index{ 0 };
+	};
+	thread_local JobSystemThread currentThread;
+
+	constexpr uint32_t SPIN_COUNT_BEFORE_SLEEP = 256;
+	constexpr uint32_t COUNTER_LOCK = 1u << 31;
+
+	inline void spinPause()
+	{
+#if defined(_M_X64) || defined(__x86_64__)
+		_mm_pause();
+#else
+		std::this_thread::yield();
+#endif
+	}
+
+	inline uint32_t xorshift(uint32_t& state)
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+}
+//=============================================================================
+void JobSystem::WorkStealingDeque::Create(uint32_t capacity)
+{
+	m_buffer = std::make_unique<std::atomic<Job*>[]>(capacity);
+	m_mask = static_cast<int64_t>(capacity) - 1;
+	m_top.store(0, std::memory_order_relaxed);
+	m_bottom.store(0, std::memory_order_relaxed);
+}
+//=============================================================================
+bool JobSystem::WorkStealingDeque::Push(Job* job)
+{
+	const int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+	const int64_t top = m_top.load(std::memory_order_acquire);
+	if (bottom - top > m_mask) return false;
+
+	m_buffer[bottom & m_mask].store(job, std::memory_order_relaxed);
+	// publishes the job to thieves
+	m_bottom.store(bottom + 1, std::memory_order_release);
+	return true;
+}
+//=============================================================================
+JobSystem::Job* JobSystem::WorkStealingDeque::Pop()
+{
+	const int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+	m_bottom.store(bottom, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t top = m_top.load(std::memory_order_relaxed);
+
+	if (top > bottom)
+	{
+		// empty
+		m_bottom.store(bottom + 1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	Job* job = m_buffer[bottom & m_mask].load(std::memory_order_relaxed);
+	if (top == bottom)
+	{
+		// the last job, race the thieves for it
+		if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) job = nullptr;
+		m_bottom.store(bottom + 1, std::memory_order_relaxed);
+	}
+	return job;
+}
+//=============================================================================
+JobSystem::Job* JobSystem::WorkStealingDeque::Steal()
+{
+	int64_t top = m_top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	const int64_t bottom = m_bottom.load(std::memory_order_acquire);
+	if (top >= bottom) return nullptr;
+
+	Job* job = m_buffer[top & m_mask].load(std::memory_order_relaxed);
+	if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) return nullptr; // lost to another thief or the owner
+	return job;
+}
+//=============================================================================
+int64_t JobSystem::WorkStealingDeque::GetSize() const
+{
+	const int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+	const int64_t top = m_top.load(std::memory_order_relaxed);
+	return std::max<int64_t>(bottom - top, 0);
+}
+//=============================================================================
+JobSystem::~JobSystem()
+{
+	assert(thisJobSystem != this);
+	assert(m_workers.empty());
+}
+//=============================================================================
+bool JobSystem::Create(const JobSystemCreateInfo& createInfo)
+{
+	assert(!thisJobSystem);
+
+	if (createInfo.jobsPerThread < 2 || (createInfo.jobsPerThread & (createInfo.jobsPerThread - 1)) != 0)
+	{
+		Fatal("JobSystem: jobsPerThread must be a power of two");
+		return false;
+	}
+	if (createInfo.useFibers && (createInfo.fibersPerThread == 0 || createInfo.fiberStackSize < 16 * 1024))
+	{
+		Fatal("JobSystem: fiber mode needs at least one fiber per thread and 16 KiB of stack");
+		return false;
+	}
+
+	m_createInfo = createInfo;
+	uint32_t numWorkers = m_createInfo.numWorkerThreads;
+	if (numWorkers == 0) numWorkers = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+	const uint32_t numThreads = 1 + numWorkers + m_createInfo.maxExternalThreads;
+	m_threads.resize(numThreads);
+	for (uint32_t threadIndex = 0; threadIndex < numThreads; threadIndex++)
+	{
+		m_threads[threadIndex] = std::make_unique<ThreadState>();
+		ThreadState& state = *m_threads[threadIndex];
+		state.deque.Create(m_createInfo.jobsPerThread);
+		state.jobs = std::make_unique<Job[]>(m_createInfo.jobsPerThread);
+		state.random = threadIndex * 0x9E3779B9u + 1;
+	}
+
+	m_stop.store(false, std::memory_order_relaxed);
+	m_numQueuedJobs.store(0, std::memory_order_relaxed);
+	m_numSleeping.store(0, std::memory_order_relaxed);
+	m_numThreads.store(1 + numWorkers, std::memory_order_release);
+	currentThread = { this, 0 };
+
+	m_workers.reserve(numWorkers);
+	for (uint32_t worker = 0; worker < numWorkers; worker++)
+	{
+		m_workers.emplace_back(&JobSystem::workerThread, this, 1 + worker);
+	}
+
+	thisJobSystem = this;
+	return true;
+}
+//=============================================================================
+void JobSystem::Destroy()
+{
+	if (thisJobSystem == this) thisJobSystem = nullptr;
+
+	{
+		std::lock_guard lock(m_sleepMutex);
+		m_stop.store(true, std::memory_order_seq_cst);
+	}
+	m_sleepCondition.notify_all();
+	for (std::thread& worker : m_workers) worker.join();
+	m_workers.clear();
+
+	if (currentThread.system == this) currentThread = {};
+	m_threads.clear();
+	m_numThreads.store(0, std::memory_order_relaxed);
+}
+//=============================================================================
+void JobSystem::Wait(const JobCounter& counter)
+{
+	if (counter.IsDone()) return;
+
+	ThreadState* state = getThreadState();
+	if (state && state->currentFiber)
+	{
+		// park the job, the worker loop resumes it on this thread once the counter is done
+		JobFiber& fiber = *state->currentFiber;
+		fiber.waitCounter = &counter;
+		state->waitingFibers.push_back(&fiber);
+		state->currentFiber = nullptr;
+		Fiber::Switch(fiber.fiber, state->loopFiber);
+		return;
+	}
+
+	uint32_t spinCount = 0;
+	while (!counter.IsDone())
+	{
+		if (state && resumeWaitingFiber(*state))
+		{
+			spinCount = 0;
+		}
+		else if (Job* job = state ? findJob(*state) : nullptr)
+		{
+			execute(*job);
+			spinCount = 0;
+		}
+		else if (++spinCount < SPIN_COUNT_BEFORE_SLEEP)
+		{
+			spinPause();
+		}
+		else
+		{
+			// the remaining jobs run on other threads
+			std::this_thread::yield();
+		}
+	}
+}
+//=============================================================================
+JobSystem::ThreadState* JobSystem::getThreadState()
+{
+	if (currentThread.system == this) return m_threads[currentThread.index].get();
+	if (m_threads.empty()) return nullptr;
+
+	const uint32_t threadIndex = m_numThreads.fetch_add(1, std::memory_order_acq_rel);
+	if (threadIndex >= m_threads.size())
+	{
+		m_numThreads.store(static_cast<uint32_t>(m_threads.size()), std::memory_order_relaxed);
+		return nullptr;
+	}
+	currentThread = { this, threadIndex };
+	return m_threads[threadIndex].get();
+}
+//=============================================================================
+JobSystem::Job* JobSystem::allocateJob(ThreadState& state)
+{
+	Job& job = state.jobs[state.nextJob & (m_createInfo.jobsPerThread - 1)];
+	// The pool wrapped around onto a job that did not finish yet. Waiting for it could deadlock when it is
+	// a caller of this very job, the caller runs the job inline instead.
+	if (!job.free.load(std::memory_order_acquire)) return nullptr;
+
+	state.nextJob++;
+	job.free.store(false, std::memory_order_relaxed);
+	return &job;
+}
+//=============================================================================
+void JobSystem::submit(ThreadState& state, Job& job)
+{
+	if (!state.deque.Push(&job))
+	{
+		// deque full, nobody is stealing fast enough
+		execute(job);
+		return;
+	}
+
+	m_numQueuedJobs.fetch_add(1, std::memory_order_seq_cst);
+	if (m_numSleeping.load(std::memory_order_seq_cst) > 0)
+	{
+		std::lock_guard lock(m_sleepMutex);
+		m_sleepCondition.notify_one();
+	}
+}
+//=============================================================================
+bool JobSystem::holdBack(Job& job, const JobCounter& dependency)
+{
+	uint32_t count = dependency.m_count.load(std::memory_order_relaxed);
+	while (true)
+	{
+		if (count == 0) return false;
+		if (count & COUNTER_LOCK)
+		{
+			spinPause();
+			count = dependency.m_count.load(std::memory_order_relaxed);
+		}
+		else if (dependency.m_count.compare_exchange_weak(count, count | COUNTER_LOCK, std::memory_order_acquire, std::memory_order_relaxed))
+		{
+			break;
+		}
+	}
+
+	job.nextContinuation = static_cast<Job*>(dependency.m_continuations);
+	dependency.m_continuations = &job;
+	dependency.m_count.fetch_and(~COUNTER_LOCK, std::memory_order_release);
+	return true;
+}
+//=============================================================================
+void JobSystem::finishJob(JobCounter& counter)
+{
+	// The last job takes the lock with the same operation that brings the count to zero, the counter is not done until it
+	// took the continuations. Jobs scheduled with the counter in the meantime count on top of the lock bit.
+	uint32_t count = counter.m_count.load(std::memory_order_relaxed);
+	while (true)
+	{
+		if ((count & ~COUNTER_LOCK) > 1)
+		{
+			if (counter.m_count.compare_exchange_weak(count, count - 1, std::memory_order_acq_rel, std::memory_order_relaxed)) return;
+		}
+		else if (count & COUNTER_LOCK)
+		{
+			spinPause();
+			count = counter.m_count.load(std::memory_order_relaxed);
+		}
+		else if (counter.m_count.compare_exchange_weak(count, COUNTER_LOCK, std::memory_order_acq_rel, std::memory_order_relaxed))
+		{
+			break;
+		}
+	}
+
+	Job* continuations = static_cast<Job*>(counter.m_continuations);
+	counter.m_continuations = nullptr;
+	// the last access to the counter, a waiter may destroy it from here on
+	counter.m_count.fetch_and(~COUNTER_LOCK, std::memory_order_acq_rel);
+
+	ThreadState* state = getThreadState();
+	while (continuations)
+	{
+		Job& job = *continuations;
+		continuations = job.nextContinuation;
+		job.nextContinuation = nullptr;
+		if (state) submit(*state, job);
+		else execute(job);
+	}
+}
+//=============================================================================
+JobSystem::Job* JobSystem::findJob(ThreadState& state)
+{
+	Job* job = state.deque.Pop();
+	if (!job)
+	{
+		const uint32_t numThreads = std::min(m_numThreads.load(std::memory_order_acquire), static_cast<uint32_t>(m_threads.size()));
+		const uint32_t first = xorshift(state.random) % numThreads;
+		for (uint32_t i = 0; i < numThreads && !job; i++)
+		{
+			ThreadState& victim = *m_threads[(first + i) % numThreads];
+			if (&victim != &state) job = victim.deque.Steal();
+		}
+	}
+	if (job) m_numQueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+	return job;
+}
+//=============================================================================
+void JobSystem::execute(Job& job)
+{
+	ThreadState* state = currentThread.system == this ? m_threads[currentThread.index].get() : nullptr;
+	// on a fiber already (inline and helping paths) the job shares its stack
+	JobFiber* fiber = state && state->useFibers && !state->currentFiber ? acquireFiber(*state) : nullptr;
+	if (!fiber)
+	{
+		runJob(job);
+		return;
+	}
+
+	fiber->job = &job;
+	state->currentFiber = fiber;
+	// returns when the job finished or waits
+	Fiber::Switch(state->loopFiber, fiber->fiber);
+}
+//=============================================================================
+void JobSystem::runJob(Job& job)
+{
+	JobCounter* counter = job.counter;
+	job.invoke(job);
+	job.free.store(true, std::memory_order_release);
+	if (counter) finishJob(*counter);
+}
+//=============================================================================
+JobSystem::JobFiber* JobSystem::acquireFiber(ThreadState& state)
+{
+	if (state.freeFibers.empty())
+	{
+		if (state.fibers.size() >= m_createInfo.fibersPerThread) return nullptr;
+
+		auto fiber = std::make_unique<JobFiber>();
+		fiber->system = this;
+		fiber->state = &state;
+		if (!fiber->fiber.Create(m_createInfo.fiberStackSize, &JobSystem::fiberMain, fiber.get())) return nullptr;
+		state.freeFibers.push_back(fiber.get());
+		state.fibers.push_back(std::move(fiber));
+	}
+
+	JobFiber* fiber = state.freeFibers.back();
+	state.freeFibers.pop_back();
+	return fiber;
+}
+//=============================================================================
+bool JobSystem::resumeWaitingFiber(ThreadState& state)
+{
+	for (size_t i = 0; i < state.waitingFibers.size(); i++)
+	{
+		JobFiber* fiber = state.waitingFibers[i];
+		if (!fiber->waitCounter->IsDone()) continue;
+
+		state.waitingFibers[i] = state.waitingFibers.back();
+		state.waitingFibers.pop_back();
+		fiber->waitCounter = nullptr;
+		state.currentFiber = fiber;
+		Fiber::Switch(state.loopFiber, fiber->fiber);
+		return true;
+	}
+	return false;
+}
+//=============================================================================
+void JobSystem::fiberMain(void* userData)
+{
+	JobFiber& fiber = *static_cast<JobFiber*>(userData);
+	while (true)
+	{
+		fiber.system->runJob(*fiber.job);
+		fiber.job = nullptr;
+
+		ThreadState& state = *fiber.state;
+		state.currentFiber = nullptr;
+		state.freeFibers.push_back(&fiber);
+		Fiber::Switch(fiber.fiber, state.loopFiber);
+	}
+}
+//=============================================================================
+void JobSystem::workerThread(uint32_t threadIndex)
+{
+	currentThread = { this, threadIndex };
+	ThreadState& state = *m_threads[threadIndex];
+#if ENABLE_PROFILER
+	ProfilerSetThreadName(ProfilerInternName(("Job Worker " + std::to_string(threadIndex)).c_str()));
+#endif
+	state.useFibers = m_createInfo.useFibers && state.loopFiber.ConvertCurrentThread();
+
+	uint32_t spinCount = 0;
+	while (!m_stop.load(std::memory_order_relaxed))
+	{
+		if (resumeWaitingFiber(state))
+		{
+			spinCount = 0;
+			continue;
+		}
+		if (Job* job = findJob(state))
+		{
+			execute(*job);
+			spinCount = 0;
+			continue;
+		}
+		if (++spinCount < SPIN_COUNT_BEFORE_SLEEP)
+		{
+			spinPause();
+			continue;
+		}
+		if (!state.waitingFibers.empty())
+		{
+			// a parked job can only resume here, keep polling its counter
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::unique_lock lock(m_sleepMutex);
+		m_numSleeping.fetch_add(1, std::memory_order_seq_cst);
+		m_sleepCondition.wait(lock, [this] { return m_stop.load(std::memory_order_relaxed) || m_numQueuedJobs.load(std::memory_order_seq_cst) > 0; });
+		m_numSleeping.fetch_sub(1, std::memory_order_relaxed);
+		spinCount = 0;
+	}
+
+	// jobs still parked are dropped with their stacks
+	state.waitingFibers.clear();
+	state.freeFibers.clear();
+	state.fibers.clear();
+	if (state.useFibers) state.loopFiber.RevertCurrentThread();
+	state.useFibers = false;
+	currentThread = {};
+}
+//=============================================================================
@@ -0,0 +1,227 @@
+﻿#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <thread>
+#include "Fiber.h"
+
+// Work-stealing job system. Every thread that schedules jobs owns a Chase-Lev deque: the owner pushes and pops at the bottom (LIFO,
+// cache-warm), idle threads steal from the top (FIFO, the oldest and usually largest work). Worker threads sleep when no deque has work.
+// A thread waiting on a JobCounter runs jobs instead of blocking, so the main thread takes part in its own ParallelFor().
+//
+// Jobs are stored inline in a fixed pool per thread, scheduling does not allocate. Captures are limited to JOB_STORAGE_SIZE bytes,
+// capture larger state by pointer. A job that finds its pool slot still in use runs inline on the scheduling thread.
+// Threads other than the main thread and the workers get a deque on their first Schedule()/Wait(), up to
+// JobSystemCreateInfo::maxExternalThreads of them; beyond that their jobs run inline.
+//
+// With JobSystemCreateInfo::useFibers the workers run every job on a fiber of their own pool. Wait() inside such a job does not
+// block the worker: the fiber is parked and the worker picks up other jobs, resuming the fiber once the counter is done.
+// A parked fiber always resumes on the thread it started on, thread_local state stays valid across Wait(). The main thread
+// and external threads keep running jobs on their own stack and wait by helping. A job without a free fiber (the pool holds
+// fibersPerThread of them) runs on the worker stack and waits by helping as well. Profiler zones open across a Wait() in a
+// fiber may interleave with the zones of the jobs that ran meanwhile.
+//
+// A job scheduled with a dependency is held back on the dependency counter and queued by the job that brings the counter to
+// zero, only jobs that can run right away are ever queued. A thread helping in Wait() therefore never picks up a job that would
+// have to wait for one below it on its own stack.
+
+constexpr uint32_t JOB_STORAGE_SIZE = 48;
+
+class JobCounter final
+{
+public:
+	[[nodiscard]] bool IsDone() const { return m_count.load(std::memory_order_acquire) == 0; }
+
+private:
+	friend class JobSystem;
+	// Jobs scheduled with this counter and not finished yet. The top bit locks the continuations and is set while the count
+	// goes to zero, so a waiter sees the counter done only after the job system touched it for the last time.
+	mutable std::atomic<uint32_t> m_count{ 0 };
+	mutable void*                 m_continuations{ nullptr }; // JobSystem::Job list of the jobs that depend on this counter
+};
+
+struct JobSystemCreateInfo final
+{
+	uint32_t numWorkerThreads{ 0 };   // 0 - one per hardware thread, minus the main thread
+	uint32_t maxExternalThreads{ 4 }; // threads besides main and workers that schedule jobs, e.g. the render thread
+	uint32_t jobsPerThread{ 4096 };   // deque capacity and job pool size of each thread, power of two
+	bool     useFibers{ true };       // workers run jobs on fibers, Wait() in a job suspends it instead of the thread
+	uint32_t fibersPerThread{ 32 };   // fibers of each worker, created on demand
+	uint32_t fiberStackSize{ 256 * 1024 }; // reserved, pages are committed as the stack grows
+};
+
+class JobSystem final
+{
+public:
+	~JobSystem();
+
+	// The calling thread becomes the main thread of the job system
+	[[nodiscard]] bool Create(const JobSystemCreateInfo& createInfo);
+	// Jobs still queued or suspended are dropped, wait on their counters first
+	void Destroy();
+
+	// Runs function() on any thread. counter, if not nullptr, counts the job until it finished.
+	// The job starts only after dependency, if not nullptr, is done. Until then it is kept on the dependency, not queued.
+	template<typename F>
+	void Schedule(F&& function, JobCounter* counter = nullptr, const JobCounter* dependency = nullptr);
+
+	// Runs jobs on the calling thread until the counter is done, or suspends the calling job when it runs on a fiber
+	void Wait(const JobCounter& counter);
+
+	// body(begin, end) for the chunks of [0, count), returns when all ran. Lazy binary splitting: a thread halves its range and
+	// offers the upper half for stealing only while its own deque is nearly empty, so the chunks stay large when every thread
+	// is busy and get smaller as threads go idle. No chunk is smaller than minChunkSize, unless count is.
+	template<typename F>
+	void ParallelFor(uint32_t count, F&& body, uint32_t minChunkSize = 1);
+
+	[[nodiscard]] uint32_t GetNumWorkerThreads() const { return static_cast<uint32_t>(m_workers.size()); }
+	[[nodiscard]] bool IsCreated() const { return !m_threads.empty(); }
+
+private:
+	struct Job final
+	{
+		alignas(std::max_align_t) std::byte storage[JOB_STORAGE_SIZE];
+		void              (*invoke)(Job& job){ nullptr }; // calls and destroys the stored function
+		JobCounter*       counter{ nullptr };
+		Job*              nextContinuation{ nullptr }; // while held back on a dependency
+		std::atomic<bool> free{ true };
+	};
+
+	// Chase-Lev deque with a fixed capacity (Le, Pop, Cohen, Zappa Nardelli: "Correct and Efficient Work-Stealing for Weak Memory Models")
+	class WorkStealingDeque final
+	{
+	public:
+		void Create(uint32_t capacity);
+		[[nodiscard]] bool Push(Job* job);  // owner, false when full
+		[[nodiscard]] Job* Pop();           // owner
+		[[nodiscard]] Job* Steal();         // any thread
+		[[nodiscard]] int64_t GetSize() const;
+
+	private:
+		alignas(64) std::atomic<int64_t>        m_top{ 0 };
+		alignas(64) std::atomic<int64_t>        m_bottom{ 0 };
+		std::unique_ptr<std::atomic<Job*>[]>    m_buffer;
+		int64_t                                 m_mask{ 0 };
+	};
+
+	struct ThreadState;
+
+	struct JobFiber final
+	{
+		Fiber             fiber;
+		JobSystem*        system{ nullptr };
+		ThreadState*      state{ nullptr };
+		Job*              job{ nullptr };         // the job to run next
+		const JobCounter* waitCounter{ nullptr }; // while suspended
+	};
+
+	struct ThreadState final
+	{
+		WorkStealingDeque                      deque;
+		std::unique_ptr<Job[]>                 jobs;
+		uint32_t                               nextJob{ 0 };
+		uint32_t                               random{ 0 };        // steal victim selection
+
+		// workers in fiber mode only, touched by the owning thread alone
+		bool                                   useFibers{ false };
+		Fiber                                  loopFiber;          // the worker's own stack
+		JobFiber*                              currentFiber{ nullptr };
+		std::vector<std::unique_ptr<JobFiber>> fibers;
+		std::vector<JobFiber*>                 freeFibers;
+		std::vector<JobFiber*>                 waitingFibers;
+	};
+
+	template<typename F>
+	void parallelForRange(F* body, uint32_t begin, uint32_t end, uint32_t grain, JobCounter* counter);
+
+	[[nodiscard]] ThreadState* getThreadState();
+	[[nodiscard]] Job* allocateJob(ThreadState& state);
+	void submit(ThreadState& state, Job& job);
+	[[nodiscard]] bool holdBack(Job& job, const JobCounter& dependency);
+	void finishJob(JobCounter& counter);
+	[[nodiscard]] Job* findJob(ThreadState& state);
+	void execute(Job& job);
+	void runJob(Job& job);
+	[[nodiscard]] JobFiber* acquireFiber(ThreadState& state);
+	[[nodiscard]] bool resumeWaitingFiber(ThreadState& state);
+	static void fiberMain(void* userData);
+	void workerThread(uint32_t threadIndex);
+
+	JobSystemCreateInfo                       m_createInfo{};
+	std::vector<std::unique_ptr<ThreadState>> m_threads;          // main, workers, external threads
+	std::vector<std::thread>                  m_workers;
+	std::atomic<uint32_t>                     m_numThreads{ 0 };  // slots of m_threads handed out
+	std::atomic<bool>                         m_stop{ false };
+
+	std::atomic<int64_t>                      m_numQueuedJobs{ 0 };
+	std::atomic<uint32_t>                     m_numSleeping{ 0 };
+	std::mutex                                m_sleepMutex;
+	std::condition_variable                   m_sleepCondition;
+};
+
+//=============================================================================
+template<typename F>
+inline void JobSystem::Schedule(F&& function, JobCounter* counter, const JobCounter* dependency)
+{
+	using Function = std::decay_t<F>;
+	static_assert(sizeof(Function) <= JOB_STORAGE_SIZE && alignof(Function) <= alignof(std::max_align_t), "job captures too much, capture by pointer");
+
+	ThreadState* state = getThreadState();
+	Job* pooledJob = state ? allocateJob(*state) : nullptr;
+	if (!pooledJob)
+	{
+		if (dependency) Wait(*dependency);
+		function();
+		return;
+	}
+
+	Job& job = *pooledJob;
+	new (job.storage) Function(std::forward<F>(function));
+	job.invoke = [](Job& storedJob)
+	{
+		Function* function = std::launder(reinterpret_cast<Function*>(storedJob.storage));
+		(*function)();
+		function->~Function();
+	};
+	job.counter = counter;
+	job.nextContinuation = nullptr;
+	if (counter) counter->m_count.fetch_add(1, std::memory_order_relaxed);
+	if (dependency && holdBack(job, *dependency)) return;
+	submit(*state, job);
+}
+//=============================================================================
+template<typename F>
+inline void JobSystem::ParallelFor(uint32_t count, F&& body, uint32_t minChunkSize)
+{
+	if (count == 0) return;
+
+	// the smallest chunk worth a job of its own, a few per thread
+	const uint32_t numThreads = GetNumWorkerThreads() + 1;
+	const uint32_t grain = std::max({ minChunkSize, count / (numThreads * 32), 1u });
+
+	JobCounter counter;
+	parallelForRange<std::remove_reference_t<F>>(&body, 0, count, grain, &counter);
+	Wait(counter);
+}
+//=============================================================================
+template<typename F>
+inline void JobSystem::parallelForRange(F* body, uint32_t begin, uint32_t end, uint32_t grain, JobCounter* counter)
+{
+	ThreadState* state = getThreadState();
+	while (begin < end)
+	{
+		// both halves and the last chunk of a range keep at least grain elements
+		if (state && end - begin >= 2 * grain && state->deque.GetSize() < 2)
+		{
+			const uint32_t middle = begin + (end - begin) / 2;
+			Schedule([this, body, middle, end, grain, counter] { parallelForRange(body, middle, end, grain, counter); }, counter);
+			end = middle;
+			continue;
+		}
+
+		const uint32_t chunkEnd = end - begin >= 2 * grain ? begin + grain : end;
+		(*body)(begin, chunkEnd);
+		begin = chunkEnd;
+	}
+}
+//=============================================================================
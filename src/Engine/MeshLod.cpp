@@ -0,0 +1,250 @@
+﻿#include "stdafx.h"
+#include "MeshLod.h"
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include "Log.h"
+#if defined(_M_X64) || defined(__x86_64__)
+#	define LOD_X64 1
+#	include <immintrin.h>
+#	if defined(_MSC_VER)
+#		define LOD_TARGET_AVX2
+#	else
+#		define LOD_TARGET_AVX2 __attribute__((target("avx2")))
+#	endif
+#else
+#	define LOD_X64 0
+#endif
+//=============================================================================
+namespace
+{
+	// Level k fits when error[k] * scale * projectionScale / maxPixelError <= distance to the sphere. The scalar values are the
+	// errors in pixels at distance 1 per unit of scale, for the SIMD broadcasts.
+	struct LodThresholds final
+	{
+		float    pixelErrors[MAX_MESH_LODS];
+		uint32_t numLods;
+		float    lowBand;  // 1 - hysteresis, a coarser level is taken only when it fits the distance shortened by it
+		float    highBand; // 1 + hysteresis, a finer level is taken only when the current one does not fit the lengthened distance
+	};
+
+	LodThresholds prepareThresholds(const LodSelectionParams& params, std::span<const MeshLod> lods)
+	{
+		LodThresholds thresholds{};
+		thresholds.numLods = static_cast<uint32_t>(std::min<size_t>(lods.size(), MAX_MESH_LODS));
+		const float errorToPixels = params.projectionScale / std::max(params.maxPixelError, 1e-6f);
+		for (uint32_t lod = 0; lod < thresholds.numLods; lod++) thresholds.pixelErrors[lod] = lods[lod].error * errorToPixels;
+		const float hysteresis = std::clamp(params.hysteresis, 0.0f, 1.0f);
+		thresholds.lowBand = 1.0f - hysteresis;
+		thresholds.highBand = 1.0f + hysteresis;
+		return thresholds;
+	}
+
+	void selectScalar(const LodSelectionParams& params, const LodThresholds& thresholds, LodInstances& instances, uint32_t begin, uint32_t end)
+	{
+		const float* centerX = instances.GetCenterX();
+		const float* centerY = instances.GetCenterY();
+		const float* centerZ = instances.GetCenterZ();
+		const float* radius = instances.GetRadius();
+		const float* scale = instances.GetScale();
+		uint32_t* lods = instances.GetLods();
+
+		for (uint32_t instance = begin; instance < end; instance++)
+		{
+			const float dx = centerX[instance] - params.cameraPosition.x;
+			const float dy = centerY[instance] - params.cameraPosition.y;
+			const float dz = centerZ[instance] - params.cameraPosition.z;
+			const float distance = std::max(std::sqrt(dx * dx + dy * dy + dz * dz) - radius[instance], 0.0f);
+			const float low = distance * thresholds.lowBand;
+			const float high = distance * thresholds.highBand;
+
+			// the errors increase down the chain, the levels that fit are the first ones
+			float coarsest = 0.0f;
+			float finest = 0.0f;
+			for (uint32_t lod = 1; lod < thresholds.numLods; lod++)
+			{
+				const float error = thresholds.pixelErrors[lod] * scale[instance];
+				coarsest += error <= low ? 1.0f : 0.0f;
+				finest += error <= high ? 1.0f : 0.0f;
+			}
+			const float current = static_cast<float>(lods[instance]);
+			lods[instance] = static_cast<uint32_t>(std::min(std::max(current, coarsest), finest));
+		}
+	}
+
+#if LOD_X64
+	void selectSSE(const LodSelectionParams& params, const LodThresholds& thresholds, LodInstances& instances, uint32_t begin, uint32_t end)
+	{
+		const float* centerX = instances.GetCenterX();
+		const float* centerY = instances.GetCenterY();
+		const float* centerZ = instances.GetCenterZ();
+		const float* radius = instances.GetRadius();
+		const float* scale = instances.GetScale();
+		uint32_t* lods = instances.GetLods();
+
+		const __m128 cameraX = _mm_set1_ps(params.cameraPosition.x);
+		const __m128 cameraY = _mm_set1_ps(params.cameraPosition.y);
+		const __m128 cameraZ = _mm_set1_ps(params.cameraPosition.z);
+		const __m128 lowBand = _mm_set1_ps(thresholds.lowBand);
+		const __m128 highBand = _mm_set1_ps(thresholds.highBand);
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 zero = _mm_setzero_ps();
+		uint32_t instance = begin;
+		for (; instance + 4 <= end; instance += 4)
+		{
+			const __m128 dx = _mm_sub_ps(_mm_loadu_ps(centerX + instance), cameraX);
+			const __m128 dy = _mm_sub_ps(_mm_loadu_ps(centerY + instance), cameraY);
+			const __m128 dz = _mm_sub_ps(_mm_loadu_ps(centerZ + instance), cameraZ);
+			const __m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+			const __m128 distance = _mm_max_ps(_mm_sub_ps(_mm_sqrt_ps(lengthSquared), _mm_loadu_ps(radius + instance)), zero);
+			const __m128 low = _mm_mul_ps(distance, lowBand);
+			const __m128 high = _mm_mul_ps(distance, highBand);
+			const __m128 instanceScale = _mm_loadu_ps(scale + instance);
+
+			__m128 coarsest = zero;
+			__m128 finest = zero;
+			for (uint32_t lod = 1; lod < thresholds.numLods; lod++)
+			{
+				const __m128 error = _mm_mul_ps(_mm_set1_ps(thresholds.pixelErrors[lod]), instanceScale);
+				coarsest = _mm_add_ps(coarsest, _mm_and_ps(_mm_cmple_ps(error, low), one));
+				finest = _mm_add_ps(finest, _mm_and_ps(_mm_cmple_ps(error, high), one));
+			}
+			__m128i* lodsOut = reinterpret_cast<__m128i*>(lods + instance);
+			const __m128 current = _mm_cvtepi32_ps(_mm_loadu_si128(lodsOut));
+			_mm_storeu_si128(lodsOut, _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(current, coarsest), finest)));
+		}
+		selectScalar(params, thresholds, instances, instance, end);
+	}
+
+	LOD_TARGET_AVX2 void selectAVX2(const LodSelectionParams& params, const LodThresholds& thresholds, LodInstances& instances, uint32_t begin, uint32_t end)
+	{
+		const float* centerX = instances.GetCenterX();
+		const float* centerY = instances.GetCenterY();
+		const float* centerZ = instances.GetCenterZ();
+		const float* radius = instances.GetRadius();
+		const float* scale = instances.GetScale();
+		uint32_t* lods = instances.GetLods();
+
+		const __m256 cameraX = _mm256_set1_ps(params.cameraPosition.x);
+		const __m256 cameraY = _mm256_set1_ps(params.cameraPosition.y);
+		const __m256 cameraZ = _mm256_set1_ps(params.cameraPosition.z);
+		const __m256 lowBand = _mm256_set1_ps(thresholds.lowBand);
+		const __m256 highBand = _mm256_set1_ps(thresholds.highBand);
+		const __m256 one = _mm256_set1_ps(1.0f);
+		const __m256 zero = _mm256_setzero_ps();
+		uint32_t instance = begin;
+		for (; instance + 8 <= end; instance += 8)
+		{
+			const __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(centerX + instance), cameraX);
+			const __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(centerY + instance), cameraY);
+			const __m256 dz = _mm256_sub_ps(_mm256_loadu_ps(centerZ + instance), cameraZ);
+			const __m256 lengthSquared = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+			const __m256 distance = _mm256_max_ps(_mm256_sub_ps(_mm256_sqrt_ps(lengthSquared), _mm256_loadu_ps(radius + instance)), zero);
+			const __m256 low = _mm256_mul_ps(distance, lowBand);
+			const __m256 high = _mm256_mul_ps(distance, highBand);
+			const __m256 instanceScale = _mm256_loadu_ps(scale + instance);
+
+			__m256 coarsest = zero;
+			__m256 finest = zero;
+			for (uint32_t lod = 1; lod < thresholds.numLods; lod++)
+			{
+				const __m256 error = _mm256_mul_ps(_mm256_set1_ps(thresholds.pixelErrors[lod]), instanceScale);
+				coarsest = _mm256_add_ps(coarsest, _mm256_and_ps(_mm256_cmp_ps(error, low, _CMP_LE_OQ), one));
+				finest = _mm256_add_ps(finest, _mm256_and_ps(_mm256_cmp_ps(error, high, _CMP_LE_OQ), one));
+			}
+			__m256i* lodsOut = reinterpret_cast<__m256i*>(lods + instance);
+			const __m256 current = _mm256_cvtepi32_ps(_mm256_loadu_si256(lodsOut));
+			_mm256_storeu_si256(lodsOut, _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(current, coarsest), finest)));
+		}
+		selectScalar(params, thresholds, instances, instance, end);
+	}
+#endif // LOD_X64
+}
+//=============================================================================
+bool BuildLodChain(std::span<const uint32_t> indices, const float* positions, uint32_t numVertices, uint32_t positionStride, const LodChainDesc& desc, MeshLodChain& chain)
+{
+	chain.indices.assign(indices.begin(), indices.end());
+	chain.lods.assign(1, MeshLod{ 0, static_cast<uint32_t>(indices.size()), 0.0f });
+
+	std::vector<uint32_t> simplified;
+	const uint32_t maxLods = std::min(desc.maxLods, MAX_MESH_LODS);
+	while (chain.lods.size() < maxLods)
+	{
+		const MeshLod& previous = chain.lods.back();
+		const uint32_t targetTriangles = static_cast<uint32_t>(float(previous.indexCount / 3) * desc.reduction);
+		if (targetTriangles < desc.minTriangles) break;
+
+		// Every level starts from the source, its error is measured against the source and the flip check of the simplifier
+		// compares with the surface of the source. Starting from the level before is faster, but the errors would only add up
+		// to a bound and the normals the flip check compares with would drift level by level.
+		SimplifyDesc simplifyDesc;
+		simplifyDesc.targetIndexCount = targetTriangles * 3;
+		simplifyDesc.targetError = desc.maxError;
+		float error = 0.0f;
+		if (!SimplifyMesh(indices, positions, numVertices, positionStride, simplifyDesc, simplified, &error))
+		{
+			Error("BuildLodChain: LOD " + std::to_string(chain.lods.size()) + " failed");
+			return false;
+		}
+		if (float(simplified.size()) > float(previous.indexCount) * desc.minReduction) break;
+
+		// the simplifier keeps the surviving triangles in source order, with the gaps the collapses left the cache misses more
+		if (!OptimizeVertexCache(std::span<uint32_t>(simplified), numVertices))
+		{
+			Error("BuildLodChain: LOD " + std::to_string(chain.lods.size()) + " has invalid indices");
+			return false;
+		}
+
+		const MeshLod lod{ static_cast<uint32_t>(chain.indices.size()), static_cast<uint32_t>(simplified.size()), std::max(error, previous.error) };
+		chain.indices.insert(chain.indices.end(), simplified.begin(), simplified.end());
+		chain.lods.push_back(lod);
+	}
+	return true;
+}
+//=============================================================================
+void LodInstances::Reserve(uint32_t numInstances)
+{
+	for (std::vector<float>* values : { &m_centerX, &m_centerY, &m_centerZ, &m_radius, &m_scale }) values->reserve(numInstances);
+	m_lods.reserve(numInstances);
+}
+//=============================================================================
+void LodInstances::Clear()
+{
+	for (std::vector<float>* values : { &m_centerX, &m_centerY, &m_centerZ, &m_radius, &m_scale }) values->clear();
+	m_lods.clear();
+}
+//=============================================================================
+uint32_t LodInstances::Add(const glm::vec3& center, float radius, float scale)
+{
+	const uint32_t index = GetCount();
+	m_centerX.push_back(center.x);
+	m_centerY.push_back(center.y);
+	m_centerZ.push_back(center.z);
+	m_radius.push_back(radius);
+	m_scale.push_back(scale);
+	m_lods.push_back(0);
+	return index;
+}
+//=============================================================================
+void LodInstances::Set(uint32_t index, const glm::vec3& center, float radius, float scale)
+{
+	assert(index < GetCount());
+	m_centerX[index] = center.x;
+	m_centerY[index] = center.y;
+	m_centerZ[index] = center.z;
+	m_radius[index] = radius;
+	m_scale[index] = scale;
+}
+//=============================================================================
+void SelectLods(const LodSelectionParams& params, std::span<const MeshLod> lods, LodInstances& instances, uint32_t begin, uint32_t end, CullingPath path)
+{
+	assert(begin <= end && end <= instances.GetCount());
+	const LodThresholds thresholds = prepareThresholds(params, lods);
+	if (path == CullingPath::automatic) path = GetBestCullingPath();
+
+#if LOD_X64
+	if (path == CullingPath::avx2 && GetBestCullingPath() == CullingPath::avx2) return selectAVX2(params, thresholds, instances, begin, end);
+	if (path != CullingPath::scalar) return selectSSE(params, thresholds, instances, begin, end);
+#endif
+	selectScalar(params, thresholds, instances, begin, end);
+}
+//=============================================================================
@@ -0,0 +1,85 @@
+﻿#pragma once
+
+#include <span>
+#include "FrustumCulling.h"
+
+// Discrete levels of detail of a mesh and their selection by projected error.
+//  - BuildLodChain() simplifies the source with SimplifyMesh() to LodChainDesc::reduction of the triangles of the level before,
+//    level by level, and appends the indices to one index buffer, LOD 0 is the source. The levels share the vertex buffer. The
+//    error of a level is measured against the source, in mesh units, it never decreases down the chain. Every simplified level
+//    is put in vertex cache order with OptimizeVertexCache(), LOD 0 is left as it is: run the MeshOptimizer.h passes on the
+//    source first.
+//  - SelectLods() picks per instance the coarsest level whose error, scaled to world units and projected at the distance of the
+//    bounding sphere, stays under LodSelectionParams::maxPixelError pixels. Near a switch distance the current level is kept
+//    within a relative band of LodSelectionParams::hysteresis, an instance moving back and forth there does not pop every frame.
+//    The instances are structure of arrays, 8 are selected per iteration with AVX2, 4 with SSE, whatever the CPU supports.
+
+constexpr uint32_t MAX_MESH_LODS = 8;
+
+struct MeshLod final
+{
+	uint32_t startIndexLocation{ 0 };
+	uint32_t indexCount{ 0 };
+	float    error{ 0.0f }; // mesh units
+};
+
+struct MeshLodChain final
+{
+	std::vector<uint32_t> indices; // all levels, LOD 0 first
+	std::vector<MeshLod>  lods;
+};
+
+struct LodChainDesc final
+{
+	uint32_t maxLods{ MAX_MESH_LODS };
+	float    reduction{ 0.5f };    // triangles of a level relative to the level before
+	uint32_t minTriangles{ 64 };   // no level is made below it
+	float    maxError{ FLT_MAX };  // no level is made past it, mesh units
+	float    minReduction{ 0.8f }; // a level keeping more of the triangles of the one before ends the chain, the mesh is locked
+};
+
+// positions: numVertices float3 positionStride bytes apart
+[[nodiscard]] bool BuildLodChain(std::span<const uint32_t> indices, const float* positions, uint32_t numVertices, uint32_t positionStride, const LodChainDesc& desc, MeshLodChain& chain);
+
+struct LodSelectionParams final
+{
+	// Pixels per world unit at distance 1: viewport height / (2 * tan(vertical fov / 2)) for a perspective projection
+	[[nodiscard]] static float ProjectionScale(float verticalFov, float viewportHeight) { return viewportHeight / (2.0f * std::tan(verticalFov * 0.5f)); }
+
+	glm::vec3 cameraPosition{ 0.0f };
+	float     projectionScale{ 1.0f };
+	float     maxPixelError{ 1.0f };
+	float     hysteresis{ 0.1f };
+};
+
+// Instances of one mesh, the bounding sphere in world units and the scale from mesh to world units
+class LodInstances final
+{
+public:
+	void Reserve(uint32_t numInstances);
+	void Clear();
+
+	uint32_t Add(const glm::vec3& center, float radius, float scale);
+	void Set(uint32_t index, const glm::vec3& center, float radius, float scale);
+
+	[[nodiscard]] uint32_t GetCount() const { return static_cast<uint32_t>(m_centerX.size()); }
+	[[nodiscard]] const float* GetCenterX() const { return m_centerX.data(); }
+	[[nodiscard]] const float* GetCenterY() const { return m_centerY.data(); }
+	[[nodiscard]] const float* GetCenterZ() const { return m_centerZ.data(); }
+	[[nodiscard]] const float* GetRadius() const { return m_radius.data(); }
+	[[nodiscard]] const float* GetScale() const { return m_scale.data(); }
+	// the selected levels, a new instance starts at LOD 0
+	[[nodiscard]] const uint32_t* GetLods() const { return m_lods.data(); }
+	[[nodiscard]] uint32_t* GetLods() { return m_lods.data(); }
+
+private:
+	std::vector<float>    m_centerX;
+	std::vector<float>    m_centerY;
+	std::vector<float>    m_centerZ;
+	std::vector<float>    m_radius;
+	std::vector<float>    m_scale;
+	std::vector<uint32_t> m_lods;
+};
+
+// Updates the levels of the instances [begin, end) in place, lods are the levels of their mesh. path: as for CullBoxes().
+void SelectLods(const LodSelectionParams& params, std::span<const MeshLod> lods, LodInstances& instances, uint32_t begin, uint32_t end, CullingPath path = CullingPath::automatic);
@@ -0,0 +1,355 @@
+﻿#include "stdafx.h"
+#include "MeshOptimizer.h"
+#include "Log.h"
+//=============================================================================
+namespace
+{
+	constexpr uint32_t INVALID_VERTEX = UINT32_MAX;
+	constexpr uint32_t INVALID_TRIANGLE = UINT32_MAX;
+
+	// Forsyth's scoring, the cache is a LRU of FORSYTH_CACHE_SIZE entries
+	constexpr uint32_t FORSYTH_CACHE_SIZE = 32;
+	constexpr uint32_t FORSYTH_MAX_VALENCE = 32; // the valence boost barely changes past it
+	constexpr float    FORSYTH_CACHE_DECAY_POWER = 1.5f;
+	constexpr float    FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+	constexpr float    FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+	constexpr float    FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+	struct ForsythScores final
+	{
+		ForsythScores()
+		{
+			for (uint32_t position = 0; position < FORSYTH_CACHE_SIZE; position++)
+			{
+				// the three vertices of the last triangle score the same, using them again does not depend on their order
+				cache[position] = position < 3 ? FORSYTH_LAST_TRIANGLE_SCORE
+					: std::pow(1.0f - float(position - 3) / float(FORSYTH_CACHE_SIZE - 3), FORSYTH_CACHE_DECAY_POWER);
+			}
+			valence[0] = 0.0f;
+			for (uint32_t triangles = 1; triangles <= FORSYTH_MAX_VALENCE; triangles++)
+				valence[triangles] = FORSYTH_VALENCE_BOOST_SCALE * std::pow(float(triangles), -FORSYTH_VALENCE_BOOST_POWER);
+		}
+
+		float Get(int32_t cachePosition, uint32_t liveTriangles) const
+		{
+			if (liveTriangles == 0) return -1.0f; // no triangle is scored with it
+			return (cachePosition < 0 ? 0.0f : cache[cachePosition]) + valence[std::min(liveTriangles, FORSYTH_MAX_VALENCE)];
+		}
+
+		float cache[FORSYTH_CACHE_SIZE];
+		float valence[FORSYTH_MAX_VALENCE + 1];
+	};
+
+	// FIFO post-transform cache: a vertex is a hit while fewer than size vertices were transformed after it
+	class FifoCache final
+	{
+	public:
+		FifoCache(uint32_t numVertices, uint32_t size) : m_timestamps(numVertices, 0), m_time(size + 1), m_size(size) {}
+
+		uint32_t Transform(uint32_t a, uint32_t b, uint32_t c)
+		{
+			return transform(a) + transform(b) + transform(c);
+		}
+		void Flush() { m_time += m_size + 1; }
+
+	private:
+		uint32_t transform(uint32_t vertex)
+		{
+			if (m_time - m_timestamps[vertex] <= m_size) return 0;
+			m_timestamps[vertex] = m_time++;
+			return 1;
+		}
+
+		std::vector<uint32_t> m_timestamps;
+		uint32_t              m_time;
+		uint32_t              m_size;
+	};
+
+	template<typename Index>
+	bool validate(const char* name, std::span<const Index> indices, uint32_t numVertices)
+	{
+		if (indices.size() % 3 != 0)
+		{
+			Error(std::string(name) + ": the index count " + std::to_string(indices.size()) + " is not a multiple of 3");
+			return false;
+		}
+		for (uint32_t index : indices)
+		{
+			if (index >= numVertices)
+			{
+				Error(std::string(name) + ": index " + std::to_string(index) + " out of range, the mesh has " + std::to_string(numVertices) + " vertices");
+				return false;
+			}
+		}
+		return true;
+	}
+
+	glm::vec3 getPosition(const float* positions, uint32_t positionStride, uint32_t vertex)
+	{
+		const float* position = reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(positions) + size_t(vertex) * positionStride);
+		return { position[0], position[1], position[2] };
+	}
+
+	template<typename Index>
+	bool optimizeVertexCache(std::span<Index> indices, uint32_t numVertices)
+	{
+		if (!validate<Index>("OptimizeVertexCache", indices, numVertices)) return false;
+		const uint32_t numTriangles = static_cast<uint32_t>(indices.size() / 3);
+		if (numTriangles == 0) return true;
+		static const ForsythScores scores;
+
+		// vertex to triangle adjacency, the first liveTriangles[v] entries of a vertex are its triangles not emitted yet
+		std::vector<uint32_t> liveTriangles(numVertices, 0);
+		for (Index index : indices) liveTriangles[index]++;
+		std::vector<uint32_t> adjacencyOffsets(size_t(numVertices) + 1, 0);
+		for (uint32_t vertex = 0; vertex < numVertices; vertex++) adjacencyOffsets[vertex + 1] = adjacencyOffsets[vertex] + liveTriangles[vertex];
+		std::vector<uint32_t> adjacency(indices.size());
+		std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (uint32_t triangle = 0; triangle < numTriangles; triangle++)
+		{
+			for (uint32_t corner = 0; corner < 3; corner++) adjacency[fill[indices[triangle * 3 + corner]]++] = triangle;
+		}
+
+		std::vector<int32_t> cachePositions(numVertices, -1);
+		std::vector<float> vertexScores(numVertices);
+		for (uint32_t vertex = 0; vertex < numVertices; vertex++) vertexScores[vertex] = scores.Get(-1, liveTriangles[vertex]);
+		std::vector<float> triangleScores(numTriangles);
+		uint32_t best = 0;
+		for (uint32_t triangle = 0; triangle < numTriangles; triangle++)
+		{
+			const Index* corners = &indices[triangle * 3];
+			triangleScores[triangle] = vertexScores[corners[0]] + vertexScores[corners[1]] + vertexScores[corners[2]];
+			if (triangleScores[triangle] > triangleScores[best]) best = triangle;
+		}
+
+		std::vector<Index> result(indices.size());
+		std::vector<bool> emitted(numTriangles, false);
+		uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+		uint32_t newCache[FORSYTH_CACHE_SIZE + 3];
+		uint32_t cacheSize = 0;
+		uint32_t nextTriangle = 0;
+		for (uint32_t output = 0; output < numTriangles; output++)
+		{
+			if (best == INVALID_TRIANGLE)
+			{
+				// nothing in the cache has triangles left, start over at the next triangle in the input order
+				while (emitted[nextTriangle]) nextTriangle++;
+				best = nextTriangle;
+			}
+			Index corners[3]{ indices[best * 3], indices[best * 3 + 1], indices[best * 3 + 2] };
+			memcpy(&result[output * 3], corners, sizeof(corners));
+			emitted[best] = true;
+
+			uint32_t newCacheSize = 0;
+			for (Index vertex : corners)
+			{
+				uint32_t* live = &adjacency[adjacencyOffsets[vertex]];
+				uint32_t* triangle = std::find(live, live + liveTriangles[vertex], best);
+				*triangle = live[--liveTriangles[vertex]];
+				if (std::find(newCache, newCache + newCacheSize, uint32_t(vertex)) == newCache + newCacheSize) newCache[newCacheSize++] = vertex;
+			}
+			for (uint32_t entry = 0; entry < cacheSize; entry++)
+			{
+				if (cache[entry] != corners[0] && cache[entry] != corners[1] && cache[entry] != corners[2]) newCache[newCacheSize++] = cache[entry];
+			}
+
+			// Rescore the vertices that moved in the cache or left it and the triangles around them. The best next triangle is
+			// one around a vertex still in the cache, a triangle elsewhere cannot have gained. It is picked while the scores are
+			// updated, a triangle around two moved vertices competes with the first update only, which costs little and saves a
+			// second walk over the adjacency.
+			best = INVALID_TRIANGLE;
+			float bestScore = -FLT_MAX;
+			cacheSize = std::min(newCacheSize, FORSYTH_CACHE_SIZE);
+			for (uint32_t entry = 0; entry < newCacheSize; entry++)
+			{
+				const uint32_t vertex = newCache[entry];
+				const bool inCache = entry < FORSYTH_CACHE_SIZE;
+				if (inCache) cache[entry] = vertex;
+				cachePositions[vertex] = inCache ? static_cast<int32_t>(entry) : -1;
+				const float score = scores.Get(cachePositions[vertex], liveTriangles[vertex]);
+				const float difference = score - vertexScores[vertex];
+				vertexScores[vertex] = score;
+				for (uint32_t adjacent = adjacencyOffsets[vertex]; adjacent < adjacencyOffsets[vertex] + liveTriangles[vertex]; adjacent++)
+				{
+					const uint32_t triangle = adjacency[adjacent];
+					triangleScores[triangle] += difference;
+					if (inCache && triangleScores[triangle] > bestScore)
+					{
+						best = triangle;
+						bestScore = triangleScores[triangle];
+					}
+				}
+			}
+		}
+		std::copy(result.begin(), result.end(), indices.begin());
+		return true;
+	}
+
+	template<typename Index>
+	bool optimizeOverdraw(std::span<Index> indices, const float* positions, uint32_t numVertices, uint32_t positionStride, float threshold)
+	{
+		if (!validate<Index>("OptimizeOverdraw", indices, numVertices)) return false;
+		const uint32_t numTriangles = static_cast<uint32_t>(indices.size() / 3);
+		if (numTriangles == 0) return true;
+
+		// A triangle with three cache misses starts a patch the cache order does not connect to what was drawn before, the
+		// patches can be reordered without losing hits.
+		FifoCache cache(numVertices, VERTEX_CACHE_ANALYZE_SIZE);
+		std::vector<uint32_t> patches;
+		std::vector<uint8_t> misses(numTriangles);
+		for (uint32_t triangle = 0; triangle < numTriangles; triangle++)
+		{
+			misses[triangle] = static_cast<uint8_t>(cache.Transform(indices[triangle * 3], indices[triangle * 3 + 1], indices[triangle * 3 + 2]));
+			if (triangle == 0 || misses[triangle] == 3) patches.push_back(triangle);
+		}
+		patches.push_back(numTriangles);
+
+		// Patches are split further where the ACMR of the part so far is within threshold of the ACMR of the whole patch: a cluster
+		// drawn from a cold cache costs about as much as it did in the cache order.
+		std::vector<uint32_t> clusters;
+		for (size_t patch = 0; patch + 1 < patches.size(); patch++)
+		{
+			const uint32_t begin = patches[patch];
+			const uint32_t end = patches[patch + 1];
+			uint32_t patchMisses = 0;
+			for (uint32_t triangle = begin; triangle < end; triangle++) patchMisses += misses[triangle];
+			const float clusterThreshold = threshold * static_cast<float>(patchMisses) / static_cast<float>(end - begin);
+
+			cache.Flush();
+			clusters.push_back(begin);
+			uint32_t clusterMisses = 0;
+			uint32_t clusterTriangles = 0;
+			for (uint32_t triangle = begin; triangle < end; triangle++)
+			{
+				clusterMisses += cache.Transform(indices[triangle * 3], indices[triangle * 3 + 1], indices[triangle * 3 + 2]);
+				clusterTriangles++;
+				if (triangle + 1 < end && static_cast<float>(clusterMisses) <= clusterThreshold * static_cast<float>(clusterTriangles))
+				{
+					clusters.push_back(triangle + 1);
+					clusterMisses = 0;
+					clusterTriangles = 0;
+					cache.Flush();
+				}
+			}
+		}
+		clusters.push_back(numTriangles);
+
+		// Clusters facing away from the center of the mesh are drawn first, on a convex-ish mesh they are the ones in front
+		glm::vec3 meshCenter(0.0f);
+		for (Index index : indices) meshCenter += getPosition(positions, positionStride, index);
+		meshCenter /= static_cast<float>(indices.size());
+		const uint32_t numClusters = static_cast<uint32_t>(clusters.size() - 1);
+		std::vector<float> sortKeys(numClusters);
+		for (uint32_t cluster = 0; cluster < numClusters; cluster++)
+		{
+			glm::vec3 center(0.0f);
+			glm::vec3 normal(0.0f);
+			for (uint32_t triangle = clusters[cluster]; triangle < clusters[cluster + 1]; triangle++)
+			{
+				const glm::vec3 a = getPosition(positions, positionStride, indices[triangle * 3]);
+				const glm::vec3 b = getPosition(positions, positionStride, indices[triangle * 3 + 1]);
+				const glm::vec3 c = getPosition(positions, positionStride, indices[triangle * 3 + 2]);
+				center += a + b + c;
+				normal += glm::cross(b - a, c - a); // weighted by area
+			}
+			center /= static_cast<float>((clusters[cluster + 1] - clusters[cluster]) * 3);
+			const float normalLength = glm::length(normal);
+			sortKeys[cluster] = normalLength > 0.0f ? glm::dot(center - meshCenter, normal / normalLength) : 0.0f;
+		}
+		std::vector<uint32_t> order(numClusters);
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [&sortKeys](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+		std::vector<Index> result;
+		result.reserve(indices.size());
+		for (uint32_t cluster : order)
+			result.insert(result.end(), indices.begin() + size_t(clusters[cluster]) * 3, indices.begin() + size_t(clusters[cluster + 1]) * 3);
+		std::copy(result.begin(), result.end(), indices.begin());
+		return true;
+	}
+
+	template<typename Index>
+	uint32_t optimizeVertexFetch(std::span<Index> indices, void* vertices, uint32_t numVertices, uint32_t vertexSize)
+	{
+		if (!validate<Index>("OptimizeVertexFetch", indices, numVertices)) return 0;
+
+		std::vector<uint32_t> remap(numVertices, INVALID_VERTEX);
+		uint32_t numUsedVertices = 0;
+		for (Index& index : indices)
+		{
+			if (remap[index] == INVALID_VERTEX) remap[index] = numUsedVertices++;
+			index = static_cast<Index>(remap[index]);
+		}
+
+		uint8_t* data = static_cast<uint8_t*>(vertices);
+		const std::vector<uint8_t> source(data, data + size_t(numVertices) * vertexSize);
+		for (uint32_t vertex = 0; vertex < numVertices; vertex++)
+		{
+			if (remap[vertex] != INVALID_VERTEX) memcpy(data + size_t(remap[vertex]) * vertexSize, source.data() + size_t(vertex) * vertexSize, vertexSize);
+		}
+		return numUsedVertices;
+	}
+
+	template<typename Index>
+	VertexCacheStatistics analyzeVertexCache(std::span<const Index> indices, uint32_t numVertices, uint32_t cacheSize)
+	{
+		VertexCacheStatistics statistics;
+		if (indices.size() < 3 || !validate<Index>("AnalyzeVertexCache", indices, numVertices)) return statistics;
+
+		FifoCache cache(numVertices, cacheSize);
+		std::vector<bool> referenced(numVertices, false);
+		uint32_t numReferenced = 0;
+		for (size_t index = 0; index + 2 < indices.size(); index += 3)
+			statistics.verticesTransformed += cache.Transform(indices[index], indices[index + 1], indices[index + 2]);
+		for (Index index : indices)
+		{
+			if (referenced[index]) continue;
+			referenced[index] = true;
+			numReferenced++;
+		}
+		statistics.acmr = static_cast<float>(statistics.verticesTransformed) / static_cast<float>(indices.size() / 3);
+		statistics.atvr = static_cast<float>(statistics.verticesTransformed) / static_cast<float>(numReferenced);
+		return statistics;
+	}
+}
+//=============================================================================
+bool OptimizeVertexCache(std::span<uint32_t> indices, uint32_t numVertices)
+{
+	return optimizeVertexCache(indices, numVertices);
+}
+//=============================================================================
+bool OptimizeVertexCache(std::span<uint16_t> indices, uint32_t numVertices)
+{
+	return optimizeVertexCache(indices, numVertices);
+}
+//=============================================================================
+bool OptimizeOverdraw(std::span<uint32_t> indices, const float* positions, uint32_t numVertices, uint32_t positionStride, float threshold)
+{
+	return optimizeOverdraw(indices, positions, numVertices, positionStride, threshold);
+}
+//=============================================================================
+bool OptimizeOverdraw(std::span<uint16_t> indices, const float* positions, uint32_t numVertices, uint32_t positionStride, float threshold)
+{
+	return optimizeOverdraw(indices, positions, numVertices, positionStride, threshold);
+}
+//=============================================================================
+uint32_t OptimizeVertexFetch(std::span<uint32_t> indices, void* vertices, uint32_t numVertices, uint32_t vertexSize)
+{
+	return optimizeVertexFetch(indices, vertices, numVertices, vertexSize);
+}
+//=============================================================================
+uint32_t OptimizeVertexFetch(std::span<uint16_t> indices, void* vertices, uint32_t numVertices, uint32_t vertexSize)
+{
+	return optimizeVertexFetch(indices, vertices, numVertices, vertexSize);
+}
+//=============================================================================
+VertexCacheStatistics AnalyzeVertexCache(std::span<const uint32_t> indices, uint32_t numVertices, uint32_t cacheSize)
+{
+	return analyzeVertexCache(indices, numVertices, cacheSize);
+}
+//=============================================================================
+VertexCacheStatistics AnalyzeVertexCache(std::span<const uint16_t> indices, uint32_t numVertices, uint32_t cacheSize)
+{
+	return analyzeVertexCache(indices, numVertices, cacheSize);
+}
+//=============================================================================
@@ -0,0 +1,41 @@
+﻿#pragma once
+
+#include <span>
+
+// Reorders indexed triangle lists for the GPU before they are uploaded. The passes are meant to run once at mesh creation, in
+// this order:
+//  1. OptimizeVertexCache() - Forsyth's linear-speed vertex cache optimisation: triangles are emitted greedily by a score that
+//     favours vertices recently used and vertices with few triangles left, so the post-transform cache hits more often.
+//  2. OptimizeOverdraw() - splits the cache-ordered triangles into clusters where the cache starts over anyway and draws the
+//     clusters that face outwards first, so the front of a convex-ish mesh hides its back. The threshold limits the ACMR lost.
+//  3. OptimizeVertexFetch() - stores the vertices in the order the indices first use them, dropping unused ones, so the fetch
+//     from memory walks the vertex buffer forwards.
+// AnalyzeVertexCache() reports the cache metrics the passes are judged by.
+
+constexpr uint32_t VERTEX_CACHE_ANALYZE_SIZE = 16;   // FIFO entries, a conservative size for current GPUs
+constexpr float    OVERDRAW_DEFAULT_THRESHOLD = 1.05f;
+
+struct VertexCacheStatistics final
+{
+	uint32_t verticesTransformed{ 0 };
+	float    acmr{ 0.0f }; // transformed vertices per triangle, 0.5 at best on a regular grid, 3 at worst
+	float    atvr{ 0.0f }; // transformed vertices per referenced vertex, 1 at best
+};
+
+// The optimizers return false for an index count that is not a multiple of 3 or an index out of range and leave the data as it is.
+[[nodiscard]] bool OptimizeVertexCache(std::span<uint32_t> indices, uint32_t numVertices);
+[[nodiscard]] bool OptimizeVertexCache(std::span<uint16_t> indices, uint32_t numVertices);
+
+// indices have to be vertex cache optimized. positions: numVertices float3 positionStride bytes apart. threshold: the ACMR of the
+// result may grow about threshold times (a little more, the clusters lose the cache hits they got from their
+// neighbours), 1 keeps the cache order of every cluster.
+[[nodiscard]] bool OptimizeOverdraw(std::span<uint32_t> indices, const float* positions, uint32_t numVertices, uint32_t positionStride, float threshold = OVERDRAW_DEFAULT_THRESHOLD);
+[[nodiscard]] bool OptimizeOverdraw(std::span<uint16_t> indices, const float* positions, uint32_t numVertices, uint32_t positionStride, float threshold = OVERDRAW_DEFAULT_THRESHOLD);
+
+// Reorders numVertices vertices of vertexSize bytes in place and remaps the indices. Returns the number of vertices the indices use,
+// the vertices past it are unused and can be cut off, or 0 for invalid indices.
+[[nodiscard]] uint32_t OptimizeVertexFetch(std::span<uint32_t> indices, void* vertices, uint32_t numVertices, uint32_t vertexSize);
+[[nodiscard]] uint32_t OptimizeVertexFetch(std::span<uint16_t> indices, void* vertices, uint32_t numVertices, uint32_t vertexSize);
+
+[[nodiscard]] VertexCacheStatistics AnalyzeVertexCache(std::span<const uint32_t> indices, uint32_t numVertices, uint32_t cacheSize = VERTEX_CACHE_ANALYZE_SIZE);
+[[nodiscard]] VertexCacheStatistics AnalyzeVertexCache(std::span<const uint16_t> indices, uint32_t numVertices, uint32_t cacheSize = VERTEX_CACHE_ANALYZE_SIZE);
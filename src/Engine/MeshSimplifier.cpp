@@ -0,0 +1,261 @@
+﻿#include "stdafx.h"
+#include "MeshSimplifier.h"
+#include "Log.h"
+//=============================================================================
+namespace
+{
+	// Symmetric 4x4 matrix summing the squared plane equations of triangles, weighted by their area. Divided by the summed weight
+	// the value at a point is the mean squared distance to the planes.
+	struct Quadric final
+	{
+		void AddPlane(const glm::dvec3& normal, double distance, double weight)
+		{
+			a2 += weight * normal.x * normal.x; ab += weight * normal.x * normal.y; ac += weight * normal.x * normal.z; ad += weight * normal.x * distance;
+			b2 += weight * normal.y * normal.y; bc += weight * normal.y * normal.z; bd += weight * normal.y * distance;
+			c2 += weight * normal.z * normal.z; cd += weight * normal.z * distance;
+			d2 += weight * distance * distance;
+			this->weight += weight;
+		}
+
+		Quadric& operator+=(const Quadric& other)
+		{
+			a2 += other.a2; ab += other.ab; ac += other.ac; ad += other.ad;
+			b2 += other.b2; bc += other.bc; bd += other.bd;
+			c2 += other.c2; cd += other.cd;
+			d2 += other.d2;
+			weight += other.weight;
+			return *this;
+		}
+
+		double a2{ 0.0 }, ab{ 0.0 }, ac{ 0.0 }, ad{ 0.0 }, b2{ 0.0 }, bc{ 0.0 }, bd{ 0.0 }, c2{ 0.0 }, cd{ 0.0 }, d2{ 0.0 };
+		double weight{ 0.0 };
+	};
+
+	// mean squared distance of point to the planes of a + b
+	double evaluate(const Quadric& a, const Quadric& b, const glm::vec3& point)
+	{
+		const double weight = a.weight + b.weight;
+		if (weight <= 0.0) return 0.0;
+		const double x = point.x, y = point.y, z = point.z;
+		const double value =
+			(a.a2 + b.a2) * x * x + (a.b2 + b.b2) * y * y + (a.c2 + b.c2) * z * z + (a.d2 + b.d2) +
+			2.0 * ((a.ab + b.ab) * x * y + (a.ac + b.ac) * x * z + (a.bc + b.bc) * y * z + (a.ad + b.ad) * x + (a.bd + b.bd) * y + (a.cd + b.cd) * z);
+		return std::abs(value) / weight; // rounding can make a sum of squares slightly negative
+	}
+
+	struct Collapse final
+	{
+		uint32_t from;
+		uint32_t to;
+		float    cost; // squared error
+	};
+
+	// Vertices on an edge without an opposite edge and vertices sharing their position with another vertex
+	std::vector<uint8_t> findLockedVertices(std::span<const uint32_t> indices, const std::vector<glm::vec3>& positions)
+	{
+		const uint32_t numVertices = static_cast<uint32_t>(positions.size());
+		std::vector<uint8_t> locked(numVertices, 0);
+
+		std::vector<uint32_t> byPosition(numVertices);
+		std::iota(byPosition.begin(), byPosition.end(), 0);
+		const auto lessPosition = [&](uint32_t a, uint32_t b)
+		{
+			const glm::vec3& pa = positions[a];
+			const glm::vec3& pb = positions[b];
+			return pa.x != pb.x ? pa.x < pb.x : pa.y != pb.y ? pa.y < pb.y : pa.z < pb.z;
+		};
+		std::sort(byPosition.begin(), byPosition.end(), lessPosition);
+		for (uint32_t vertex = 1; vertex < numVertices; vertex++)
+		{
+			if (positions[byPosition[vertex]] == positions[byPosition[vertex - 1]]) locked[byPosition[vertex]] = locked[byPosition[vertex - 1]] = 1;
+		}
+
+		// directed edges a -> b sorted, an edge is on a border when b -> a is missing
+		std::vector<uint64_t> edges;
+		edges.reserve(indices.size());
+		for (size_t triangle = 0; triangle < indices.size(); triangle += 3)
+		{
+			for (uint32_t corner = 0; corner < 3; corner++)
+			{
+				const uint64_t a = indices[triangle + corner];
+				const uint64_t b = indices[triangle + (corner + 1) % 3];
+				edges.push_back(a << 32 | b);
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+		for (const uint64_t edge : edges)
+		{
+			const uint64_t opposite = edge << 32 | edge >> 32;
+			if (!std::binary_search(edges.begin(), edges.end(), opposite)) locked[edge >> 32] = locked[edge & 0xFFFFFFFF] = 1;
+		}
+		return locked;
+	}
+
+	// cos of about 75 degrees
+	constexpr float MAX_NORMAL_TURN_COS = 0.25f;
+
+	bool turnsTooFar(const glm::vec3& normal, const glm::vec3& reference)
+	{
+		return glm::dot(normal, reference) <= MAX_NORMAL_TURN_COS * glm::length(normal) * glm::length(reference);
+	}
+
+	// The normal of the triangle must not turn by more than about 75 degrees when from moves to the position of to, neither from
+	// its normal now nor from the surface of the source mesh at its corners. Only checking against the normal now is not enough,
+	// the turns of successive collapses add up to inverted triangles. A degenerate triangle has no side.
+	bool flipsTriangle(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& sourceNormals, uint32_t a, uint32_t b, uint32_t c, uint32_t from, uint32_t to)
+	{
+		const glm::vec3 before = glm::cross(positions[b] - positions[a], positions[c] - positions[a]);
+		if (glm::dot(before, before) == 0.0f) return false;
+		a = a == from ? to : a;
+		b = b == from ? to : b;
+		c = c == from ? to : c;
+		const glm::vec3 after = glm::cross(positions[b] - positions[a], positions[c] - positions[a]);
+		return turnsTooFar(after, before) || turnsTooFar(after, sourceNormals[a] + sourceNormals[b] + sourceNormals[c]);
+	}
+}
+//=============================================================================
+bool SimplifyMesh(std::span<const uint32_t> indices, const float* positions, uint32_t numVertices, uint32_t positionStride, const SimplifyDesc& desc, std::vector<uint32_t>& result, float* error)
+{
+	if (error) *error = 0.0f;
+	if (indices.size() % 3 != 0)
+	{
+		Error("SimplifyMesh: the index count " + std::to_string(indices.size()) + " is not a multiple of 3");
+		return false;
+	}
+	for (uint32_t index : indices)
+	{
+		if (index >= numVertices)
+		{
+			Error("SimplifyMesh: index " + std::to_string(index) + " out of range, the mesh has " + std::to_string(numVertices) + " vertices");
+			return false;
+		}
+	}
+
+	std::vector<glm::vec3> vertexPositions(numVertices);
+	for (uint32_t vertex = 0; vertex < numVertices; vertex++)
+		vertexPositions[vertex] = *reinterpret_cast<const glm::vec3*>(reinterpret_cast<const uint8_t*>(positions) + size_t(vertex) * positionStride);
+
+	result.assign(indices.begin(), indices.end());
+	const std::vector<uint8_t> locked = findLockedVertices(indices, vertexPositions);
+
+	std::vector<Quadric> quadrics(numVertices);
+	std::vector<glm::vec3> sourceNormals(numVertices, glm::vec3(0.0f)); // area weighted normals of the source triangles around a vertex
+	for (size_t triangle = 0; triangle < result.size(); triangle += 3)
+	{
+		const glm::dvec3 a(vertexPositions[result[triangle]]);
+		const glm::dvec3 b(vertexPositions[result[triangle + 1]]);
+		const glm::dvec3 c(vertexPositions[result[triangle + 2]]);
+		const glm::dvec3 normal = glm::cross(b - a, c - a);
+		const double length = glm::length(normal);
+		if (length == 0.0) continue;
+		Quadric quadric;
+		quadric.AddPlane(normal / length, -glm::dot(normal / length, a), length * 0.5);
+		for (uint32_t corner = 0; corner < 3; corner++)
+		{
+			quadrics[result[triangle + corner]] += quadric;
+			sourceNormals[result[triangle + corner]] += glm::vec3(normal);
+		}
+	}
+
+	const double maxCost = double(desc.targetError) * double(desc.targetError);
+	double largestCost = 0.0;
+	std::vector<uint32_t> remap(numVertices);
+	std::iota(remap.begin(), remap.end(), 0);
+	std::vector<uint8_t> touched(numVertices, 0);
+	std::vector<uint32_t> triangleOffsets(numVertices + 1);
+	std::vector<uint32_t> vertexTriangles;
+	std::vector<Collapse> collapses;
+
+	// every pass applies the cheapest collapses of the current mesh that do not touch each other
+	while (result.size() > desc.targetIndexCount)
+	{
+		const uint32_t numTriangles = static_cast<uint32_t>(result.size() / 3);
+
+		// triangles around every vertex
+		std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+		for (uint32_t index : result) triangleOffsets[index + 1]++;
+		for (uint32_t vertex = 0; vertex < numVertices; vertex++) triangleOffsets[vertex + 1] += triangleOffsets[vertex];
+		vertexTriangles.resize(result.size());
+		{
+			std::vector<uint32_t> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+			for (uint32_t triangle = 0; triangle < numTriangles; triangle++)
+			{
+				for (uint32_t corner = 0; corner < 3; corner++) vertexTriangles[fill[result[triangle * 3 + corner]]++] = triangle;
+			}
+		}
+
+		// A consistently wound interior edge is a -> b in one triangle and b -> a in the other, a < b takes it once. Border
+		// edges have both vertices locked.
+		collapses.clear();
+		for (uint32_t triangle = 0; triangle < numTriangles; triangle++)
+		{
+			for (uint32_t corner = 0; corner < 3; corner++)
+			{
+				const uint32_t a = result[triangle * 3 + corner];
+				const uint32_t b = result[triangle * 3 + (corner + 1) % 3];
+				if (a >= b || (locked[a] && locked[b])) continue;
+				const double costAB = locked[a] ? DBL_MAX : evaluate(quadrics[a], quadrics[b], vertexPositions[b]);
+				const double costBA = locked[b] ? DBL_MAX : evaluate(quadrics[a], quadrics[b], vertexPositions[a]);
+				const double cost = std::min(costAB, costBA);
+				if (cost > maxCost) continue;
+				collapses.push_back(costAB <= costBA ? Collapse{ a, b, float(cost) } : Collapse{ b, a, float(cost) });
+			}
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+		const uint32_t trianglesToRemove = numTriangles - static_cast<uint32_t>(desc.targetIndexCount / 3);
+		uint32_t numRemoved = 0;
+		uint32_t numApplied = 0;
+		for (const Collapse& collapse : collapses)
+		{
+			if (numRemoved >= trianglesToRemove) break;
+			if (touched[collapse.from] || touched[collapse.to]) continue;
+
+			// the corners are remapped through the collapses of this pass, the check sees the mesh as it is now
+			uint32_t numCollapsing = 0;
+			bool flips = false;
+			for (uint32_t slot = triangleOffsets[collapse.from]; slot < triangleOffsets[collapse.from + 1] && !flips; slot++)
+			{
+				const uint32_t* corners = &result[vertexTriangles[slot] * 3];
+				const uint32_t a = remap[corners[0]];
+				const uint32_t b = remap[corners[1]];
+				const uint32_t c = remap[corners[2]];
+				if (a == b || b == c || a == c) continue; // removed by another collapse already
+				if (a == collapse.to || b == collapse.to || c == collapse.to)
+				{
+					numCollapsing++;
+					continue;
+				}
+				flips = flipsTriangle(vertexPositions, sourceNormals, a, b, c, collapse.from, collapse.to);
+			}
+			if (flips) continue;
+
+			remap[collapse.from] = collapse.to;
+			touched[collapse.from] = touched[collapse.to] = 1;
+			quadrics[collapse.to] += quadrics[collapse.from];
+			largestCost = std::max(largestCost, double(collapse.cost));
+			numRemoved += numCollapsing;
+			numApplied++;
+		}
+		if (numApplied == 0) break;
+
+		size_t numIndices = 0;
+		for (size_t triangle = 0; triangle < result.size(); triangle += 3)
+		{
+			const uint32_t a = remap[result[triangle]];
+			const uint32_t b = remap[result[triangle + 1]];
+			const uint32_t c = remap[result[triangle + 2]];
+			if (a == b || b == c || a == c) continue;
+			result[numIndices++] = a;
+			result[numIndices++] = b;
+			result[numIndices++] = c;
+		}
+		result.resize(numIndices);
+		std::iota(remap.begin(), remap.end(), 0);
+		std::fill(touched.begin(), touched.end(), 0);
+	}
+
+	if (error) *error = static_cast<float>(std::sqrt(largestCost));
+	return true;
+}
+//=============================================================================
@@ -0,0 +1,24 @@
+﻿#pragma once
+
+#include <span>
+
+// Edge-collapse simplification with quadric error metrics (Garland, Heckbert: "Surface Simplification Using Quadric Error
+// Metrics"). An edge collapses one of its vertices into the other, the simplified index buffer only references vertices of the
+// source, so all levels of detail of a mesh share its vertex buffer.
+//  - Collapses run in passes: the candidate edges are sorted by the error of the collapse, the cheapest ones that touch no vertex
+//    collapsed in the same pass and flip no triangle are applied until the target is reached. A collapse flips a triangle when
+//    its normal turns by more than about 75 degrees from its normal before or from the normals of the source at its corners.
+//  - Vertices on open borders and vertices sharing their position with another vertex (uv and normal seams) are locked, so the
+//    outline of the mesh and its seams do not move.
+// The error of a collapse is the area weighted root mean square distance of the kept vertex to the planes of the source
+// triangles merged into the two vertices, in mesh units.
+
+struct SimplifyDesc final
+{
+	uint32_t targetIndexCount{ 0 };
+	float    targetError{ FLT_MAX }; // no collapse with a larger error is done, whether the target count is reached or not
+};
+
+// positions: numVertices float3 positionStride bytes apart. error receives the largest error of the collapses done. Returns false
+// for an index count that is not a multiple of 3 or an index out of range.
+[[nodiscard]] bool SimplifyMesh(std::span<const uint32_t> indices, const float* positions, uint32_t numVertices, uint32_t positionStride, const SimplifyDesc& desc, std::vector<uint32_t>& result, float* error = nullptr);
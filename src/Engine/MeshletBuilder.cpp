@@ -0,0 +1,425 @@
+﻿#include "stdafx.h"
+#include "MeshletBuilder.h"
+#include "Log.h"
+//=============================================================================
+namespace
+{
+	constexpr uint32_t INVALID_SLOT = UINT32_MAX;
+	constexpr uint8_t TRIANGLE_FREE = 0;
+	constexpr uint8_t TRIANGLE_CANDIDATE = 1;
+	constexpr uint8_t TRIANGLE_EMITTED = 2;
+	constexpr float MIN_CONE_SPREAD = 0.1f; // a cone wider than ~84 degrees culls too little to be worth the test
+
+	struct MeshletDataHeader final
+	{
+		uint32_t magic{ MESHLET_DATA_MAGIC };
+		uint32_t version{ MESHLET_DATA_VERSION };
+		uint32_t numMeshlets{ 0 };
+		uint32_t numVertexIndices{ 0 };
+		uint32_t numTriangles{ 0 };
+		uint32_t reserved{ 0 };
+	};
+
+	int32_t quantizeSnorm8(float value)
+	{
+		return static_cast<int32_t>(std::round(std::clamp(value, -1.0f, 1.0f) * 127.0f));
+	}
+
+	glm::vec3 getPosition(const float* positions, uint32_t positionStride, uint32_t vertex)
+	{
+		const float* position = reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(positions) + size_t(vertex) * positionStride);
+		return { position[0], position[1], position[2] };
+	}
+
+	// Ritter: a sphere through the two points farthest apart along an axis, grown over the points outside of it
+	void computeBoundingSphere(const glm::vec3* points, uint32_t numPoints, glm::vec3& center, float& radius)
+	{
+		uint32_t minPoint[3]{};
+		uint32_t maxPoint[3]{};
+		for (uint32_t point = 1; point < numPoints; point++)
+		{
+			for (int axis = 0; axis < 3; axis++)
+			{
+				if (points[point][axis] < points[minPoint[axis]][axis]) minPoint[axis] = point;
+				if (points[point][axis] > points[maxPoint[axis]][axis]) maxPoint[axis] = point;
+			}
+		}
+		int widestAxis = 0;
+		float widestDistance = 0.0f;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			const float distance = glm::distance(points[minPoint[axis]], points[maxPoint[axis]]);
+			if (distance > widestDistance)
+			{
+				widestAxis = axis;
+				widestDistance = distance;
+			}
+		}
+
+		center = (points[minPoint[widestAxis]] + points[maxPoint[widestAxis]]) * 0.5f;
+		radius = widestDistance * 0.5f;
+		for (uint32_t point = 0; point < numPoints; point++)
+		{
+			const float distance = glm::distance(points[point], center);
+			if (distance > radius)
+			{
+				const float newRadius = (radius + distance) * 0.5f;
+				center += (points[point] - center) * ((newRadius - radius) / distance);
+				radius = newRadius;
+			}
+		}
+		// float rounding of the growth steps
+		for (uint32_t point = 0; point < numPoints; point++) radius = std::max(radius, glm::distance(points[point], center));
+	}
+
+	class MeshletBuilder final
+	{
+	public:
+		template<typename Index>
+		bool Build(std::span<const Index> indices, const float* positions, uint32_t numVertices, uint32_t positionStride, MeshletData& meshletData);
+
+	private:
+		uint32_t getNumNewVertices(uint32_t triangle) const;
+		glm::vec3 getCentroid(uint32_t triangle) const;
+		void addTriangle(uint32_t triangle, Meshlet& meshlet, MeshletData& meshletData);
+		uint32_t findNextTriangle(const Meshlet& meshlet, const MeshletData& meshletData);
+		void finishMeshlet(const Meshlet& meshlet, MeshletData& meshletData);
+
+		std::vector<uint32_t>  m_indices;
+		const float*           m_positions{ nullptr };
+		uint32_t               m_positionStride{ 0 };
+		std::vector<uint32_t>  m_adjacencyOffsets; // triangles using vertex v: m_adjacency[m_adjacencyOffsets[v], m_adjacencyOffsets[v + 1])
+		std::vector<uint32_t>  m_adjacency;
+		std::vector<uint32_t>  m_liveTriangles;    // per vertex, triangles not yet in a meshlet
+		std::vector<uint32_t>  m_slots;            // per vertex, its index in the current meshlet
+		std::vector<uint8_t>   m_triangleStates;
+		std::vector<uint32_t>  m_candidates;       // triangles next to the current meshlet, each once
+		glm::vec3              m_vertexSum{ 0.0f };  // of the current meshlet
+		std::vector<glm::vec3> m_points;
+		uint32_t               m_nextSeed{ 0 };
+	};
+	//=========================================================================
+	template<typename Index>
+	bool MeshletBuilder::Build(std::span<const Index> indices, const float* positions, uint32_t numVertices, uint32_t positionStride, MeshletData& meshletData)
+	{
+		meshletData = {};
+		if (indices.size() % 3 != 0)
+		{
+			Error("BuildMeshlets: the index count " + std::to_string(indices.size()) + " is not a multiple of 3");
+			return false;
+		}
+		m_indices.assign(indices.begin(), indices.end());
+		for (uint32_t index : m_indices)
+		{
+			if (index >= numVertices)
+			{
+				Error("BuildMeshlets: index " + std::to_string(index) + " out of range, the mesh has " + std::to_string(numVertices) + " vertices");
+				return false;
+			}
+		}
+		m_positions = positions;
+		m_positionStride = positionStride;
+		const uint32_t numTriangles = static_cast<uint32_t>(m_indices.size() / 3);
+
+		// vertex to triangle adjacency
+		m_liveTriangles.assign(numVertices, 0);
+		for (uint32_t index : m_indices) m_liveTriangles[index]++;
+		m_adjacencyOffsets.resize(size_t(numVertices) + 1);
+		m_adjacencyOffsets[0] = 0;
+		for (uint32_t vertex = 0; vertex < numVertices; vertex++) m_adjacencyOffsets[vertex + 1] = m_adjacencyOffsets[vertex] + m_liveTriangles[vertex];
+		m_adjacency.resize(m_indices.size());
+		std::vector<uint32_t> fill(m_adjacencyOffsets.begin(), m_adjacencyOffsets.end() - 1);
+		for (uint32_t triangle = 0; triangle < numTriangles; triangle++)
+		{
+			for (uint32_t corner = 0; corner < 3; corner++) m_adjacency[fill[m_indices[triangle * 3 + corner]]++] = triangle;
+		}
+
+		m_slots.assign(numVertices, INVALID_SLOT);
+		m_triangleStates.assign(numTriangles, TRIANGLE_FREE);
+		m_candidates.clear();
+		m_nextSeed = 0;
+		meshletData.meshlets.reserve(numTriangles / MESHLET_MAX_TRIANGLES + 1);
+		meshletData.triangles.reserve(numTriangles);
+
+		uint32_t triangle = numTriangles > 0 ? 0 : INVALID_SLOT;
+		while (triangle != INVALID_SLOT)
+		{
+			Meshlet meshlet;
+			m_vertexSum = glm::vec3(0.0f);
+			meshlet.vertexOffset = static_cast<uint32_t>(meshletData.vertexIndices.size());
+			meshlet.triangleOffset = static_cast<uint32_t>(meshletData.triangles.size());
+			while (triangle != INVALID_SLOT)
+			{
+				addTriangle(triangle, meshlet, meshletData);
+				triangle = findNextTriangle(meshlet, meshletData);
+			}
+			finishMeshlet(meshlet, meshletData);
+
+			// the next meshlet starts next to this one, at the candidate with the fewest open triangles around it
+			uint32_t bestLive = UINT32_MAX;
+			for (uint32_t candidate : m_candidates)
+			{
+				if (m_triangleStates[candidate] == TRIANGLE_EMITTED) continue;
+				m_triangleStates[candidate] = TRIANGLE_FREE;
+				const uint32_t* corners = &m_indices[candidate * 3];
+				const uint32_t live = m_liveTriangles[corners[0]] + m_liveTriangles[corners[1]] + m_liveTriangles[corners[2]];
+				if (live < bestLive)
+				{
+					bestLive = live;
+					triangle = candidate;
+				}
+			}
+			m_candidates.clear();
+			if (triangle == INVALID_SLOT)
+			{
+				while (m_nextSeed < numTriangles && m_triangleStates[m_nextSeed] == TRIANGLE_EMITTED) m_nextSeed++;
+				if (m_nextSeed < numTriangles) triangle = m_nextSeed;
+			}
+		}
+		return true;
+	}
+	//=========================================================================
+	uint32_t MeshletBuilder::getNumNewVertices(uint32_t triangle) const
+	{
+		const uint32_t* corners = &m_indices[triangle * 3];
+		uint32_t numNewVertices = m_slots[corners[0]] == INVALID_SLOT ? 1 : 0;
+		numNewVertices += m_slots[corners[1]] == INVALID_SLOT && corners[1] != corners[0] ? 1 : 0;
+		numNewVertices += m_slots[corners[2]] == INVALID_SLOT && corners[2] != corners[0] && corners[2] != corners[1] ? 1 : 0;
+		return numNewVertices;
+	}
+	//=========================================================================
+	glm::vec3 MeshletBuilder::getCentroid(uint32_t triangle) const
+	{
+		const uint32_t* corners = &m_indices[triangle * 3];
+		return (getPosition(m_positions, m_positionStride, corners[0]) + getPosition(m_positions, m_positionStride, corners[1]) +
+			getPosition(m_positions, m_positionStride, corners[2])) * (1.0f / 3.0f);
+	}
+	//=========================================================================
+	void MeshletBuilder::addTriangle(uint32_t triangle, Meshlet& meshlet, MeshletData& meshletData)
+	{
+		uint32_t packed = 0;
+		for (uint32_t corner = 0; corner < 3; corner++)
+		{
+			const uint32_t vertex = m_indices[triangle * 3 + corner];
+			if (m_slots[vertex] == INVALID_SLOT)
+			{
+				m_slots[vertex] = meshlet.vertexCount++;
+				meshletData.vertexIndices.push_back(vertex);
+				m_vertexSum += getPosition(m_positions, m_positionStride, vertex);
+				for (uint32_t adjacent = m_adjacencyOffsets[vertex]; adjacent < m_adjacencyOffsets[vertex + 1]; adjacent++)
+				{
+					const uint32_t candidate = m_adjacency[adjacent];
+					if (m_triangleStates[candidate] != TRIANGLE_FREE) continue;
+					m_triangleStates[candidate] = TRIANGLE_CANDIDATE;
+					m_candidates.push_back(candidate);
+				}
+			}
+			packed |= m_slots[vertex] << (corner * 8);
+			m_liveTriangles[vertex]--;
+		}
+		meshletData.triangles.push_back(packed);
+		meshlet.triangleCount++;
+		m_triangleStates[triangle] = TRIANGLE_EMITTED;
+	}
+	//=========================================================================
+	uint32_t MeshletBuilder::findNextTriangle(const Meshlet& meshlet, const MeshletData& meshletData)
+	{
+		if (meshlet.triangleCount == MESHLET_MAX_TRIANGLES) return INVALID_SLOT;
+
+		// Fewest new vertices first, that closes holes before the meshlet grows. Then the fewest open triangles around it, that
+		// takes corners before the next meshlet would be left with a pocket, and the triangle closest to the centroid of the
+		// meshlet, that keeps it round instead of growing a strip along the index order.
+		const glm::vec3 centroid = m_vertexSum / static_cast<float>(meshlet.vertexCount);
+		uint32_t best = INVALID_SLOT;
+		uint32_t bestNewVertices = UINT32_MAX;
+		uint32_t bestLive = UINT32_MAX;
+		float bestDistance = FLT_MAX;
+		size_t numCandidates = 0;
+		for (uint32_t candidate : m_candidates)
+		{
+			if (m_triangleStates[candidate] == TRIANGLE_EMITTED) continue;
+			m_candidates[numCandidates++] = candidate;
+
+			const uint32_t newVertices = getNumNewVertices(candidate);
+			if (newVertices > bestNewVertices || meshlet.vertexCount + newVertices > MESHLET_MAX_VERTICES) continue;
+			const uint32_t* corners = &m_indices[candidate * 3];
+			const uint32_t live = m_liveTriangles[corners[0]] + m_liveTriangles[corners[1]] + m_liveTriangles[corners[2]];
+			if (newVertices == bestNewVertices && live > bestLive) continue;
+			const glm::vec3 offset = getCentroid(candidate) - centroid;
+			const float distance = glm::dot(offset, offset);
+			if (newVertices < bestNewVertices || live < bestLive || distance < bestDistance)
+			{
+				best = candidate;
+				bestNewVertices = newVertices;
+				bestLive = live;
+				bestDistance = distance;
+			}
+		}
+		m_candidates.resize(numCandidates);
+		if (best != INVALID_SLOT || numCandidates > 0) return best;
+
+		// An island is complete. Small islands (foliage cards, debris) share meshlets: the meshlet continues with the next triangle
+		// in index order while it has room and that triangle is near, a far one would only inflate the bounds.
+		while (m_nextSeed < m_triangleStates.size() && m_triangleStates[m_nextSeed] == TRIANGLE_EMITTED) m_nextSeed++;
+		if (m_nextSeed == m_triangleStates.size() || meshlet.vertexCount + getNumNewVertices(m_nextSeed) > MESHLET_MAX_VERTICES)
+			return INVALID_SLOT;
+		float radius = 0.0f;
+		for (uint32_t vertex = meshlet.vertexOffset; vertex < meshletData.vertexIndices.size(); vertex++)
+		{
+			radius = std::max(radius, glm::distance(getPosition(m_positions, m_positionStride, meshletData.vertexIndices[vertex]), centroid));
+		}
+		return glm::distance(getCentroid(m_nextSeed), centroid) <= radius * 2.0f ? m_nextSeed : INVALID_SLOT;
+	}
+	//=========================================================================
+	void MeshletBuilder::finishMeshlet(const Meshlet& meshlet, MeshletData& meshletData)
+	{
+		const uint32_t* vertexIndices = &meshletData.vertexIndices[meshlet.vertexOffset];
+		m_points.resize(meshlet.vertexCount);
+		for (uint32_t vertex = 0; vertex < meshlet.vertexCount; vertex++)
+		{
+			m_points[vertex] = getPosition(m_positions, m_positionStride, vertexIndices[vertex]);
+			m_slots[vertexIndices[vertex]] = INVALID_SLOT;
+		}
+
+		MeshletBounds bounds;
+		computeBoundingSphere(m_points.data(), meshlet.vertexCount, bounds.center, bounds.radius);
+
+		// normal cone: the average normal and the widest angle to it
+		glm::vec3 normals[MESHLET_MAX_TRIANGLES];
+		uint32_t numNormals = 0;
+		glm::vec3 axis(0.0f);
+		for (uint32_t triangle = 0; triangle < meshlet.triangleCount; triangle++)
+		{
+			const uint32_t packed = meshletData.triangles[meshlet.triangleOffset + triangle];
+			const glm::vec3& a = m_points[packed & 0xFF];
+			const glm::vec3& b = m_points[(packed >> 8) & 0xFF];
+			const glm::vec3& c = m_points[(packed >> 16) & 0xFF];
+			const glm::vec3 normal = glm::cross(b - a, c - a);
+			const float length = glm::length(normal);
+			if (length <= 0.0f) continue; // degenerate
+			normals[numNormals] = normal / length;
+			axis += normals[numNormals++];
+		}
+
+		uint32_t cone = 0x7F000000; // cutoff 1: never culled
+		const float axisLength = glm::length(axis);
+		if (numNormals > 0 && axisLength > 0.0f)
+		{
+			axis /= axisLength;
+			float minDot = 1.0f;
+			for (uint32_t normal = 0; normal < numNormals; normal++) minDot = std::min(minDot, glm::dot(normals[normal], axis));
+			if (minDot > MIN_CONE_SPREAD)
+			{
+				// The cone is culled when dot(center - camera, axis) >= cutoff * distance + radius, cutoff = sin of the spread. The
+				// quantized axis is off by up to its rounding error, the cutoff is raised by that error to stay conservative.
+				const int32_t quantizedAxis[3]{ quantizeSnorm8(axis.x), quantizeSnorm8(axis.y), quantizeSnorm8(axis.z) };
+				float axisError = 0.0f;
+				for (int component = 0; component < 3; component++) axisError += std::abs(quantizedAxis[component] / 127.0f - axis[component]);
+				const float cutoff = std::sqrt(1.0f - minDot * minDot) + axisError;
+				const int32_t quantizedCutoff = std::min(127, static_cast<int32_t>(std::ceil(cutoff * 127.0f)));
+				cone = (uint32_t(quantizedAxis[0]) & 0xFF) | (uint32_t(quantizedAxis[1]) & 0xFF) << 8 | (uint32_t(quantizedAxis[2]) & 0xFF) << 16 | uint32_t(quantizedCutoff) << 24;
+			}
+		}
+		bounds.normalCone = cone;
+
+		meshletData.meshlets.push_back(meshlet);
+		meshletData.bounds.push_back(bounds);
+	}
+}
+//=============================================================================
+bool BuildMeshlets(std::span<const uint32_t> indices, const float* positions, uint32_t numVertices, uint32_t positionStride, MeshletData& meshletData)
+{
+	MeshletBuilder builder;
+	return builder.Build(indices, positions, numVertices, positionStride, meshletData);
+}
+//=============================================================================
+bool BuildMeshlets(std::span<const uint16_t> indices, const float* positions, uint32_t numVertices, uint32_t positionStride, MeshletData& meshletData)
+{
+	MeshletBuilder builder;
+	return builder.Build(indices, positions, numVertices, positionStride, meshletData);
+}
+//=============================================================================
+glm::vec4 UnpackMeshletCone(uint32_t normalCone)
+{
+	const auto unpack = [normalCone](uint32_t shift) { return static_cast<float>(static_cast<int8_t>((normalCone >> shift) & 0xFF)) / 127.0f; };
+	return { unpack(0), unpack(8), unpack(16), unpack(24) };
+}
+//=============================================================================
+bool IsMeshletBackfacing(const MeshletBounds& bounds, const glm::vec3& cameraPosition)
+{
+	const glm::vec4 cone = UnpackMeshletCone(bounds.normalCone);
+	const glm::vec3 toCenter = bounds.center - cameraPosition;
+	return glm::dot(toCenter, glm::vec3(cone)) >= cone.w * glm::length(toCenter) + bounds.radius;
+}
+//=============================================================================
+void SerializeMeshlets(const MeshletData& meshletData, std::vector<uint8_t>& blob)
+{
+	MeshletDataHeader header;
+	header.numMeshlets = static_cast<uint32_t>(meshletData.meshlets.size());
+	header.numVertexIndices = static_cast<uint32_t>(meshletData.vertexIndices.size());
+	header.numTriangles = static_cast<uint32_t>(meshletData.triangles.size());
+
+	// sized once, the arrays are copied at running offsets
+	blob.resize(sizeof(header) + size_t(header.numMeshlets) * (sizeof(Meshlet) + sizeof(MeshletBounds)) + (size_t(header.numVertexIndices) + header.numTriangles) * sizeof(uint32_t));
+	size_t offset = 0;
+	const auto append = [&blob, &offset](const void* data, size_t size)
+	{
+		if (size == 0) return;
+		memcpy(blob.data() + offset, data, size);
+		offset += size;
+	};
+	append(&header, sizeof(header));
+	append(meshletData.meshlets.data(), meshletData.meshlets.size() * sizeof(Meshlet));
+	append(meshletData.bounds.data(), meshletData.bounds.size() * sizeof(MeshletBounds));
+	append(meshletData.vertexIndices.data(), meshletData.vertexIndices.size() * sizeof(uint32_t));
+	append(meshletData.triangles.data(), meshletData.triangles.size() * sizeof(uint32_t));
+	assert(offset == blob.size());
+}
+//=============================================================================
+bool DeserializeMeshlets(const uint8_t* blob, size_t size, MeshletData& meshletData)
+{
+	MeshletDataHeader header;
+	if (size < sizeof(header))
+	{
+		Error("DeserializeMeshlets: the blob is too small");
+		return false;
+	}
+	memcpy(&header, blob, sizeof(header));
+	if (header.magic != MESHLET_DATA_MAGIC || header.version != MESHLET_DATA_VERSION)
+	{
+		Error("DeserializeMeshlets: unknown format or version " + std::to_string(header.version));
+		return false;
+	}
+	const size_t expectedSize = sizeof(header) + size_t(header.numMeshlets) * (sizeof(Meshlet) + sizeof(MeshletBounds)) +
+		(size_t(header.numVertexIndices) + header.numTriangles) * sizeof(uint32_t);
+	if (size != expectedSize)
+	{
+		Error("DeserializeMeshlets: the blob has " + std::to_string(size) + " bytes instead of " + std::to_string(expectedSize));
+		return false;
+	}
+
+	const uint8_t* read = blob + sizeof(header);
+	const auto take = [&read]<typename T>(std::vector<T>& array, uint32_t count)
+	{
+		array.resize(count);
+		memcpy(array.data(), read, size_t(count) * sizeof(T));
+		read += size_t(count) * sizeof(T);
+	};
+	take(meshletData.meshlets, header.numMeshlets);
+	take(meshletData.bounds, header.numMeshlets);
+	take(meshletData.vertexIndices, header.numVertexIndices);
+	take(meshletData.triangles, header.numTriangles);
+
+	for (const Meshlet& meshlet : meshletData.meshlets)
+	{
+		if (meshlet.vertexCount > MESHLET_MAX_VERTICES || meshlet.triangleCount > MESHLET_MAX_TRIANGLES ||
+			size_t(meshlet.vertexOffset) + meshlet.vertexCount > header.numVertexIndices || size_t(meshlet.triangleOffset) + meshlet.triangleCount > header.numTriangles)
+		{
+			Error("DeserializeMeshlets: a meshlet is out of range");
+			meshletData = {};
+			return false;
+		}
+	}
+	return true;
+}
+//=============================================================================
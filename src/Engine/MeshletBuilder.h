@@ -0,0 +1,68 @@
+﻿#pragma once
+
+#include <span>
+#include "Data/Shaders/Shared.h"
+
+// Splits indexed triangle lists into meshlets of at most MESHLET_MAX_VERTICES vertices and MESHLET_MAX_TRIANGLES triangles, the
+// unit of work of a mesh shader or of a compute pass that culls clusters before an indirect draw.
+//  - A meshlet grows from a seed triangle by adding the neighbour that brings the fewest new vertices, the nearest one among
+//    equals, so meshlets are compact patches of the surface, which keeps their bounds tight. A meshlet that completes a small
+//    island continues with the next triangle in index order when it is near.
+//  - Every meshlet gets a bounding sphere and a normal cone. The cone is quantized to 8 bits per component and widened to stay
+//    conservative, a meshlet whose triangles face too many directions gets a cone that never culls.
+//  - The data is plain arrays, the same at runtime and in a cooked asset: SerializeMeshlets() and DeserializeMeshlets() store
+//    it in a versioned blob.
+//
+// Meshlet vertex i is vertexIndices[vertexOffset + i], an index of the source vertex buffer. Triangle j is packed into
+// triangles[triangleOffset + j] as three 8-bit meshlet vertex indices.
+
+constexpr uint32_t MESHLET_MAX_VERTICES = 64;
+constexpr uint32_t MESHLET_MAX_TRIANGLES = 124;
+constexpr uint32_t MESHLET_DATA_MAGIC = 0x4C48534D; // 'MSHL'
+constexpr uint32_t MESHLET_DATA_VERSION = 1;
+
+// matches Meshlet in Data/Shaders/Shared.h
+struct Meshlet final
+{
+	uint32_t vertexOffset{ 0 };
+	uint32_t triangleOffset{ 0 };
+	uint32_t vertexCount{ 0 };
+	uint32_t triangleCount{ 0 };
+};
+static_assert(sizeof(Meshlet) == sizeof(hlsl::Meshlet));
+static_assert(offsetof(Meshlet, vertexOffset) == offsetof(hlsl::Meshlet, vertexOffset));
+static_assert(offsetof(Meshlet, triangleOffset) == offsetof(hlsl::Meshlet, triangleOffset));
+static_assert(offsetof(Meshlet, vertexCount) == offsetof(hlsl::Meshlet, vertexCount));
+static_assert(offsetof(Meshlet, triangleCount) == offsetof(hlsl::Meshlet, triangleCount));
+
+// matches MeshletBounds in Data/Shaders/Shared.h
+struct MeshletBounds final
+{
+	glm::vec3 center{ 0.0f };
+	float     radius{ 0.0f };
+	uint32_t  normalCone{ 0 }; // axis xyz and cutoff, snorm8 each
+};
+static_assert(sizeof(MeshletBounds) == sizeof(hlsl::MeshletBounds));
+static_assert(offsetof(MeshletBounds, center) == offsetof(hlsl::MeshletBounds, center));
+static_assert(offsetof(MeshletBounds, radius) == offsetof(hlsl::MeshletBounds, radius));
+static_assert(offsetof(MeshletBounds, normalCone) == offsetof(hlsl::MeshletBounds, normalCone));
+
+struct MeshletData final
+{
+	std::vector<Meshlet>       meshlets;
+	std::vector<MeshletBounds> bounds;        // one per meshlet
+	std::vector<uint32_t>      vertexIndices;
+	std::vector<uint32_t>      triangles;     // i0 | i1 << 8 | i2 << 16
+};
+
+// positions: numVertices float3 positionStride bytes apart. Indices of degenerate triangles are kept in the meshlets, their
+// normals are ignored by the cone. Returns false for an index count that is not a multiple of 3 or an index out of range.
+[[nodiscard]] bool BuildMeshlets(std::span<const uint32_t> indices, const float* positions, uint32_t numVertices, uint32_t positionStride, MeshletData& meshletData);
+[[nodiscard]] bool BuildMeshlets(std::span<const uint16_t> indices, const float* positions, uint32_t numVertices, uint32_t positionStride, MeshletData& meshletData);
+
+// Cone test of a meshlet against a camera position, the same as the test on the GPU: true when all triangles face away
+[[nodiscard]] bool IsMeshletBackfacing(const MeshletBounds& bounds, const glm::vec3& cameraPosition);
+[[nodiscard]] glm::vec4 UnpackMeshletCone(uint32_t normalCone); // axis, cutoff
+
+void SerializeMeshlets(const MeshletData& meshletData, std::vector<uint8_t>& blob);
+[[nodiscard]] bool DeserializeMeshlets(const uint8_t* blob, size_t size, MeshletData& meshletData);
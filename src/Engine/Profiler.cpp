@@ -0,0 +1,670 @@
+﻿#include "stdafx.h"
+#include "Profiler.h"
+#include "Log.h"
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <unordered_set>
+//=============================================================================
+ProfilerSystem* thisProfilerSystem = nullptr;
+//=============================================================================
+uint64_t ProfilerGetTime()
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+//=============================================================================
+#if ENABLE_PROFILER
+namespace
+{
+	constexpr uint32_t THREAD_RING_SIZE = 1u << 14; // events per thread, power of two
+
+	struct ProfilerEvent final
+	{
+		const char* name; // nullptr - end of the innermost zone
+		uint64_t    time;
+	};
+
+	// Single producer (the owning thread), single consumer (ProfilerSystem::EndFrame()).
+	struct ThreadRing final
+	{
+		std::array<ProfilerEvent, THREAD_RING_SIZE> events;
+		alignas(64) std::atomic<uint64_t> writeIndex{ 0 };
+		alignas(64) std::atomic<uint64_t> readIndex{ 0 };
+		std::atomic<uint64_t>             numDropped{ 0 };
+		// guarded by threadRingsMutex
+		bool                              inUse{ true };
+		uint32_t                          index{ 0 };
+		const char*                       name{ nullptr };
+		// producer only
+		uint32_t                          recordedDepth{ 0 }; // begins written whose end is not written yet
+		uint32_t                          droppedDepth{ 0 };  // begins dropped whose end has to be dropped too
+	};
+
+	std::atomic<bool>                        profilerActive{ false };
+	std::mutex                               threadRingsMutex;
+	std::vector<std::unique_ptr<ThreadRing>> threadRings; // never shrinks, the ring of an exited thread is reused by the next new thread
+
+	struct ThreadRingOwner final
+	{
+		~ThreadRingOwner()
+		{
+			if (!ring) return;
+			std::lock_guard lock(threadRingsMutex);
+			ring->inUse = false;
+		}
+		ThreadRing* ring{ nullptr };
+	};
+	thread_local ThreadRingOwner currentThreadRing;
+
+	std::mutex                      internedNamesMutex;
+	std::unordered_set<std::string> internedNames;
+
+	struct QueueEventRecord final
+	{
+		const char*        queueName;
+		ProfilerQueueEvent event;
+		uint32_t           threadIndex;
+		uint64_t           fenceValue;
+		uint64_t           time;
+	};
+
+	struct GPUZoneRecord final
+	{
+		const char* queueName;
+		const char* name;
+		uint64_t    beginTime;
+		uint64_t    endTime;
+	};
+
+	std::atomic<bool>             traceCaptureActive{ false };
+	std::mutex                    queueEventsMutex;
+	std::vector<QueueEventRecord> queueEvents;
+
+	std::mutex                    gpuZonesMutex;
+	std::vector<GPUZoneRecord>    gpuZones;
+
+	ThreadRing& getThreadRing()
+	{
+		if (!currentThreadRing.ring)
+		{
+			std::lock_guard lock(threadRingsMutex);
+			for (const std::unique_ptr<ThreadRing>& ring : threadRings)
+			{
+				// all zones of the exited thread are closed, so the ring can continue with the new thread
+				if (!ring->inUse)
+				{
+					ring->inUse = true;
+					ring->name = nullptr;
+					ring->recordedDepth = 0;
+					ring->droppedDepth = 0;
+					currentThreadRing.ring = ring.get();
+					break;
+				}
+			}
+			if (!currentThreadRing.ring)
+			{
+				threadRings.push_back(std::make_unique<ThreadRing>());
+				threadRings.back()->index = static_cast<uint32_t>(threadRings.size() - 1);
+				currentThreadRing.ring = threadRings.back().get();
+			}
+		}
+		return *currentThreadRing.ring;
+	}
+
+	// The consumer only needs the ring pointers, which stay valid after the lock is released
+	void getThreadRings(std::vector<ThreadRing*>& rings)
+	{
+		std::lock_guard lock(threadRingsMutex);
+		rings.resize(threadRings.size());
+		for (size_t i = 0; i < threadRings.size(); i++)
+		{
+			rings[i] = threadRings[i].get();
+		}
+	}
+
+	void getThreadNames(std::vector<const char*>& names)
+	{
+		std::lock_guard lock(threadRingsMutex);
+		names.resize(threadRings.size());
+		for (size_t i = 0; i < threadRings.size(); i++)
+		{
+			names[i] = threadRings[i]->name;
+		}
+	}
+
+	void discardThreadRings()
+	{
+		std::vector<ThreadRing*> rings;
+		getThreadRings(rings);
+		for (ThreadRing* ring : rings)
+		{
+			ring->readIndex.store(ring->writeIndex.load(std::memory_order_acquire), std::memory_order_release);
+		}
+	}
+
+	void appendJsonString(std::string& json, const char* str)
+	{
+		json += '"';
+		for (; *str; str++)
+		{
+			const char c = *str;
+			if (c == '"' || c == '\\') { json += '\\'; json += c; }
+			else if (static_cast<unsigned char>(c) < 0x20) json += ' ';
+			else json += c;
+		}
+		json += '"';
+	}
+
+	template<class ... Args>
+	void appendFormat(std::string& json, const char* format, Args... args)
+	{
+		char buffer[256];
+		const int length = snprintf(buffer, sizeof(buffer), format, args...);
+		if (length > 0) json.append(buffer, std::min<size_t>(static_cast<size_t>(length), sizeof(buffer) - 1));
+	}
+}
+//=============================================================================
+void ProfilerBeginZone(const char* name)
+{
+	ThreadRing& ring = getThreadRing();
+
+	// A begin is only written when there is room left for its end and for the ends of all open zones,
+	// so a full ring drops whole zones and the consumer never sees a broken nesting.
+	const uint64_t write = ring.writeIndex.load(std::memory_order_relaxed);
+	const uint64_t used = write - ring.readIndex.load(std::memory_order_acquire);
+	if (ring.droppedDepth != 0 || !profilerActive.load(std::memory_order_relaxed) || used + ring.recordedDepth + 2 > THREAD_RING_SIZE)
+	{
+		if (ring.droppedDepth == 0 && profilerActive.load(std::memory_order_relaxed))
+			ring.numDropped.fetch_add(1, std::memory_order_relaxed);
+		ring.droppedDepth++;
+		return;
+	}
+
+	ring.events[write & (THREAD_RING_SIZE - 1)] = { name, ProfilerGetTime() };
+	ring.writeIndex.store(write + 1, std::memory_order_release);
+	ring.recordedDepth++;
+}
+//=============================================================================
+void ProfilerEndZone()
+{
+	ThreadRing& ring = getThreadRing();
+	if (ring.droppedDepth != 0)
+	{
+		ring.droppedDepth--;
+		return;
+	}
+	if (ring.recordedDepth == 0) return; // begun before the ring existed
+
+	const uint64_t write = ring.writeIndex.load(std::memory_order_relaxed);
+	ring.events[write & (THREAD_RING_SIZE - 1)] = { nullptr, ProfilerGetTime() };
+	ring.writeIndex.store(write + 1, std::memory_order_release);
+	ring.recordedDepth--;
+}
+//=============================================================================
+const char* ProfilerInternName(const char* name)
+{
+	std::lock_guard lock(internedNamesMutex);
+	return internedNames.emplace(name).first->c_str();
+}
+//=============================================================================
+void ProfilerSetThreadName(const char* name)
+{
+	ThreadRing& ring = getThreadRing();
+	std::lock_guard lock(threadRingsMutex);
+	ring.name = name;
+}
+//=============================================================================
+void ProfilerRecordQueueEvent(const char* queueName, ProfilerQueueEvent event, uint64_t fenceValue)
+{
+	if (!traceCaptureActive.load(std::memory_order_relaxed)) return;
+
+	const QueueEventRecord record{ queueName, event, getThreadRing().index, fenceValue, ProfilerGetTime() };
+	std::lock_guard lock(queueEventsMutex);
+	queueEvents.push_back(record);
+}
+//=============================================================================
+void ProfilerRecordGPUZone(const char* queueName, const char* name, uint64_t beginTime, uint64_t endTime)
+{
+	if (!profilerActive.load(std::memory_order_relaxed)) return;
+
+	std::lock_guard lock(gpuZonesMutex);
+	gpuZones.push_back({ queueName, name, beginTime, endTime });
+}
+#endif // ENABLE_PROFILER
+//=============================================================================
+void ParseProfilerCommandLine(int argc, char* argv[], ProfilerSystemCreateInfo& createInfo)
+{
+	for (int argIndex = 1; argIndex < argc; argIndex++)
+	{
+		const std::string_view arg = argv[argIndex];
+		if (arg == "--trace")
+		{
+			createInfo.traceOnStart = true;
+			if (argIndex + 1 < argc && isdigit(static_cast<unsigned char>(argv[argIndex + 1][0])))
+			{
+				createInfo.traceFrames = std::max(1u, static_cast<uint32_t>(strtoul(argv[++argIndex], nullptr, 10)));
+			}
+		}
+		else if (arg == "--trace-out" && argIndex + 1 < argc)
+		{
+			createInfo.tracePath = argv[++argIndex];
+		}
+	}
+}
+//=============================================================================
+ProfilerSystem::~ProfilerSystem()
+{
+	assert(!thisProfilerSystem);
+}
+//=============================================================================
+bool ProfilerSystem::Create(const ProfilerSystemCreateInfo& createInfo)
+{
+	assert(!thisProfilerSystem);
+
+	m_createInfo = createInfo;
+	m_zones.clear();
+	m_zoneLookup.clear();
+	m_openZones.clear();
+	m_queueNames.clear();
+	m_frameIndex = 0;
+	ResetStats();
+	thisProfilerSystem = this;
+
+#if ENABLE_PROFILER
+	discardThreadRings();
+	profilerActive.store(true, std::memory_order_relaxed);
+#endif
+
+	if (m_createInfo.traceOnStart) BeginTraceCapture();
+	return true;
+}
+//=============================================================================
+void ProfilerSystem::Destroy()
+{
+#if ENABLE_PROFILER
+	if (thisProfilerSystem == this)
+	{
+		// an interrupted capture is still worth looking at
+		if (m_traceFramesLeft != 0) endTraceCapture();
+		profilerActive.store(false, std::memory_order_relaxed);
+		discardThreadRings();
+	}
+#endif
+	thisProfilerSystem = nullptr;
+}
+//=============================================================================
+void ProfilerSystem::EndFrame()
+{
+#if ENABLE_PROFILER
+	std::vector<ThreadRing*> rings;
+	getThreadRings(rings);
+	if (m_openZones.size() < rings.size()) m_openZones.resize(rings.size());
+
+	// A zone is accounted to the frame in which it ends, so long tasks of worker threads are not split between frames.
+	for (uint32_t threadIndex = 0; threadIndex < rings.size(); threadIndex++)
+	{
+		ThreadRing& ring = *rings[threadIndex];
+		std::vector<OpenZone>& openZones = m_openZones[threadIndex];
+
+		const uint64_t read = ring.readIndex.load(std::memory_order_relaxed);
+		const uint64_t write = ring.writeIndex.load(std::memory_order_acquire);
+		for (uint64_t index = read; index < write; index++)
+		{
+			const ProfilerEvent& event = ring.events[index & (THREAD_RING_SIZE - 1)];
+			if (event.name)
+			{
+				const uint32_t parent = openZones.empty() ? UINT32_MAX : openZones.back().zone;
+				openZones.push_back({ findOrAddZone(threadIndex, parent, event.name), event.time, 0 });
+			}
+			else if (!openZones.empty()) // the begin was discarded by Create()
+			{
+				const OpenZone zone = openZones.back();
+				openZones.pop_back();
+
+				const uint64_t duration = event.time - zone.beginTime;
+				FrameAccum& accum = m_frameAccum[zone.zone];
+				accum.time += duration;
+				accum.selfTime += duration - std::min(zone.childTime, duration);
+				accum.calls++;
+				if (!openZones.empty()) openZones.back().childTime += duration;
+
+				// zones begun before the capture would start outside of the trace
+				if (m_traceFramesLeft != 0 && zone.beginTime >= m_traceBeginTime)
+				{
+					m_traceZones.push_back({ m_zones[zone.zone].name, threadIndex, zone.beginTime, event.time });
+				}
+			}
+		}
+		ring.readIndex.store(write, std::memory_order_release);
+
+		m_numDroppedZones += ring.numDropped.exchange(0, std::memory_order_relaxed);
+	}
+
+	collectGPUZones();
+
+	for (size_t zoneIndex = 0; zoneIndex < m_zones.size(); zoneIndex++)
+	{
+		ProfilerZoneStats& zone = m_zones[zoneIndex];
+		FrameAccum& accum = m_frameAccum[zoneIndex];
+
+		zone.lastFrameCalls = accum.calls;
+		zone.lastFrameMs = static_cast<double>(accum.time) * 1e-6;
+		if (accum.calls != 0)
+		{
+			const double selfMs = static_cast<double>(accum.selfTime) * 1e-6;
+			zone.minMs = zone.numFrames ? std::min(zone.minMs, zone.lastFrameMs) : zone.lastFrameMs;
+			zone.maxMs = std::max(zone.maxMs, zone.lastFrameMs);
+			zone.totalMs += zone.lastFrameMs;
+			zone.totalSelfMs += selfMs;
+			zone.numCalls += accum.calls;
+			zone.numFrames++;
+		}
+		accum = {};
+	}
+
+	if (m_traceFramesLeft != 0)
+	{
+		{
+			std::lock_guard lock(queueEventsMutex);
+			for (const QueueEventRecord& record : queueEvents)
+			{
+				m_traceQueueEvents.push_back({ getQueueIndex(record.queueName), record.event, record.threadIndex, record.fenceValue, record.time });
+			}
+			queueEvents.clear();
+		}
+		m_traceFrameTimes.push_back(ProfilerGetTime());
+		if (--m_traceFramesLeft == 0) endTraceCapture();
+	}
+#endif // ENABLE_PROFILER
+
+	m_frameIndex++;
+	if (m_createInfo.reportIntervalFrames != 0 && m_frameIndex % m_createInfo.reportIntervalFrames == 0)
+	{
+		PrintReport();
+	}
+}
+//=============================================================================
+void ProfilerSystem::BeginTraceCapture(uint32_t numFrames, const std::string& path)
+{
+#if ENABLE_PROFILER
+	if (m_traceFramesLeft != 0) return;
+
+	m_tracePath = path.empty() ? m_createInfo.tracePath : path;
+	m_traceFramesLeft = numFrames != 0 ? numFrames : std::max(1u, m_createInfo.traceFrames);
+	m_traceBeginTime = ProfilerGetTime();
+	m_traceZones.clear();
+	m_traceQueueEvents.clear();
+	m_traceFrameTimes.clear();
+	{
+		std::lock_guard lock(queueEventsMutex);
+		queueEvents.clear();
+	}
+	traceCaptureActive.store(true, std::memory_order_relaxed);
+	Print("Profiler: capturing " + std::to_string(m_traceFramesLeft) + " frames to " + m_tracePath);
+#endif // ENABLE_PROFILER
+}
+//=============================================================================
+void ProfilerSystem::endTraceCapture()
+{
+#if ENABLE_PROFILER
+	traceCaptureActive.store(false, std::memory_order_relaxed);
+	m_traceFramesLeft = 0;
+	getThreadNames(m_traceThreadNames);
+
+	if (writeTrace())
+		Print("Profiler: trace of " + std::to_string(m_traceFrameTimes.size()) + " frames written to " + m_tracePath);
+	else
+		Error("Failed to write profiler trace " + m_tracePath);
+
+	m_traceZones = {};
+	m_traceQueueEvents = {};
+	m_traceFrameTimes = {};
+#endif // ENABLE_PROFILER
+}
+//=============================================================================
+// Chrome Trace Event Format: https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU
+// CPU threads and GPU queues are separate tracks of one process, timestamps are microseconds since the capture began.
+bool ProfilerSystem::writeTrace() const
+{
+#if ENABLE_PROFILER
+	const auto toMicroseconds = [this](uint64_t time) { return static_cast<double>(time - std::min(time, m_traceBeginTime)) * 1e-3; };
+	const uint64_t traceEndTime = m_traceFrameTimes.empty() ? m_traceBeginTime : m_traceFrameTimes.back();
+
+	std::string json;
+	json.reserve(256 + m_traceZones.size() * 128 + m_traceQueueEvents.size() * 160);
+	json += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	json += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Engine\"}}";
+
+	for (uint32_t threadIndex = 0; threadIndex < m_traceThreadNames.size(); threadIndex++)
+	{
+		appendFormat(json, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", threadIndex);
+		const std::string defaultName = "Thread " + std::to_string(threadIndex);
+		appendJsonString(json, m_traceThreadNames[threadIndex] ? m_traceThreadNames[threadIndex] : defaultName.c_str());
+		json += "}}";
+	}
+	for (uint32_t queueIndex = 0; queueIndex < m_queueNames.size(); queueIndex++)
+	{
+		appendFormat(json, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", PROFILER_GPU_QUEUE_THREAD_INDEX + queueIndex);
+		appendJsonString(json, m_queueNames[queueIndex]);
+		json += "}}";
+	}
+
+	for (size_t frame = 0; frame < m_traceFrameTimes.size(); frame++)
+	{
+		appendFormat(json, ",\n{\"name\":\"Frame %zu\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":%.3f}", frame, toMicroseconds(m_traceFrameTimes[frame]));
+	}
+
+	for (const TraceZone& zone : m_traceZones)
+	{
+		json += ",\n{\"name\":";
+		appendJsonString(json, zone.name);
+		appendFormat(json, ",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+			zone.threadIndex >= PROFILER_GPU_QUEUE_THREAD_INDEX ? "gpu" : "cpu", zone.threadIndex, toMicroseconds(zone.beginTime), static_cast<double>(zone.endTime - zone.beginTime) * 1e-3);
+	}
+
+	// Every signaled fence is an async slice on its queue track, from the signal until the CPU saw it complete.
+	// This is an upper bound of the GPU time, overlapping slices show how many frames are queued.
+	struct PendingFence final
+	{
+		uint64_t value;
+		uint64_t time;
+	};
+	std::vector<std::vector<PendingFence>> pendingFences(m_queueNames.size());
+	const auto endFence = [&](uint32_t queueIndex, const PendingFence& fence, uint64_t time)
+	{
+		json += ",\n{\"name\":";
+		appendJsonString(json, m_queueNames[queueIndex]);
+		appendFormat(json, ",\"cat\":\"gpu\",\"ph\":\"b\",\"id\":\"%u-%llu\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"args\":{\"fence\":%llu}}",
+			queueIndex, static_cast<unsigned long long>(fence.value), PROFILER_GPU_QUEUE_THREAD_INDEX + queueIndex, toMicroseconds(fence.time), static_cast<unsigned long long>(fence.value));
+		json += ",\n{\"name\":";
+		appendJsonString(json, m_queueNames[queueIndex]);
+		appendFormat(json, ",\"cat\":\"gpu\",\"ph\":\"e\",\"id\":\"%u-%llu\",\"pid\":1,\"tid\":%u,\"ts\":%.3f}",
+			queueIndex, static_cast<unsigned long long>(fence.value), PROFILER_GPU_QUEUE_THREAD_INDEX + queueIndex, toMicroseconds(time));
+	};
+
+	for (const TraceQueueEvent& event : m_traceQueueEvents)
+	{
+		const uint32_t queueIndex = event.queueIndex;
+		const unsigned long long fenceValue = static_cast<unsigned long long>(event.fenceValue);
+		std::vector<PendingFence>& pending = pendingFences[queueIndex];
+		switch (event.event)
+		{
+		case ProfilerQueueEvent::submit:
+			json += ",\n{\"name\":";
+			appendJsonString(json, (std::string("Submit ") + m_queueNames[queueIndex]).c_str());
+			appendFormat(json, ",\"cat\":\"gpu\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"args\":{\"fence\":%llu}}",
+				event.threadIndex, toMicroseconds(event.time), fenceValue);
+			break;
+		case ProfilerQueueEvent::signal:
+			pending.push_back({ event.fenceValue, event.time });
+			break;
+		case ProfilerQueueEvent::completed:
+		{
+			size_t numCompleted = 0;
+			while (numCompleted < pending.size() && pending[numCompleted].value <= event.fenceValue)
+			{
+				endFence(queueIndex, pending[numCompleted], event.time);
+				numCompleted++;
+			}
+			pending.erase(pending.begin(), pending.begin() + static_cast<ptrdiff_t>(numCompleted));
+			break;
+		}
+		case ProfilerQueueEvent::wait:
+			appendFormat(json, ",\n{\"name\":\"Wait\",\"cat\":\"gpu\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"args\":{\"fence\":%llu}}",
+				PROFILER_GPU_QUEUE_THREAD_INDEX + queueIndex, toMicroseconds(event.time), fenceValue);
+			break;
+		}
+	}
+
+	// still in flight when the capture ended
+	for (uint32_t queueIndex = 0; queueIndex < m_queueNames.size(); queueIndex++)
+	{
+		for (const PendingFence& fence : pendingFences[queueIndex])
+		{
+			endFence(queueIndex, fence, std::max(traceEndTime, fence.time));
+		}
+	}
+
+	json += "\n]}\n";
+
+	std::ofstream file(m_tracePath, std::ios::binary | std::ios::trunc);
+	if (!file) return false;
+	file.write(json.data(), static_cast<std::streamsize>(json.size()));
+	return static_cast<bool>(file);
+#else
+	return false;
+#endif // ENABLE_PROFILER
+}
+//=============================================================================
+void ProfilerSystem::ResetStats()
+{
+	// Open zones keep their indices, so only the statistics are reset and the zone tree is kept.
+	for (ProfilerZoneStats& zone : m_zones)
+	{
+		zone = { zone.name, zone.parent, zone.depth, zone.threadIndex };
+	}
+	m_frameAccum.assign(m_zones.size(), {});
+	m_numDroppedZones = 0;
+}
+//=============================================================================
+void ProfilerSystem::PrintReport() const
+{
+#if ENABLE_PROFILER
+	std::vector<std::vector<uint32_t>> children(m_zones.size() + 1); // the last entry holds the root zones
+	for (uint32_t zoneIndex = 0; zoneIndex < m_zones.size(); zoneIndex++)
+	{
+		const uint32_t parent = m_zones[zoneIndex].parent;
+		children[parent == UINT32_MAX ? m_zones.size() : parent].push_back(zoneIndex);
+	}
+	std::stable_sort(children.back().begin(), children.back().end(), [&](uint32_t a, uint32_t b) { return m_zones[a].threadIndex < m_zones[b].threadIndex; });
+
+	Print("Profiler: " + std::to_string(m_frameIndex) + " frames, " + std::to_string(m_numDroppedZones) + " dropped zones. avg/min/max/self ms, calls per frame");
+	uint32_t threadIndex = UINT32_MAX;
+	for (uint32_t rootZone : children.back())
+	{
+		if (m_zones[rootZone].threadIndex != threadIndex)
+		{
+			threadIndex = m_zones[rootZone].threadIndex;
+			if (threadIndex >= PROFILER_GPU_QUEUE_THREAD_INDEX)
+				Print(std::string("GPU ") + m_queueNames[threadIndex - PROFILER_GPU_QUEUE_THREAD_INDEX]);
+			else
+				Print("Thread " + std::to_string(threadIndex));
+		}
+		printZone(rootZone, children);
+	}
+#endif // ENABLE_PROFILER
+}
+//=============================================================================
+uint32_t ProfilerSystem::findOrAddZone(uint32_t threadIndex, uint32_t parent, const char* name)
+{
+	const auto [it, inserted] = m_zoneLookup.try_emplace(ZoneKey{ threadIndex, parent, name }, static_cast<uint32_t>(m_zones.size()));
+	if (inserted)
+	{
+		ProfilerZoneStats zone;
+		zone.name = name;
+		zone.parent = parent;
+		zone.depth = parent == UINT32_MAX ? 0 : m_zones[parent].depth + 1;
+		zone.threadIndex = threadIndex;
+		m_zones.push_back(zone);
+		m_frameAccum.emplace_back();
+	}
+	return it->second;
+}
+//=============================================================================
+uint32_t ProfilerSystem::getQueueIndex(const char* queueName)
+{
+	for (uint32_t queueIndex = 0; queueIndex < m_queueNames.size(); queueIndex++)
+	{
+		if (m_queueNames[queueIndex] == queueName || strcmp(m_queueNames[queueIndex], queueName) == 0) return queueIndex;
+	}
+	m_queueNames.push_back(queueName);
+	return static_cast<uint32_t>(m_queueNames.size() - 1);
+}
+//=============================================================================
+// GPU zones of one queue arrive in any order and from several command lists, the zone tree is rebuilt from the time ranges.
+void ProfilerSystem::collectGPUZones()
+{
+#if ENABLE_PROFILER
+	std::vector<GPUZoneRecord> records;
+	{
+		std::lock_guard lock(gpuZonesMutex);
+		records.swap(gpuZones);
+	}
+	if (records.empty()) return;
+
+	std::sort(records.begin(), records.end(), [](const GPUZoneRecord& a, const GPUZoneRecord& b)
+		{
+			if (a.queueName != b.queueName) return a.queueName < b.queueName;
+			if (a.beginTime != b.beginTime) return a.beginTime < b.beginTime;
+			return a.endTime > b.endTime; // the enclosing zone first
+		});
+
+	std::vector<OpenZone> openZones; // childTime is the end time here
+	const char* queueName = nullptr;
+	uint32_t threadIndex = 0;
+	for (const GPUZoneRecord& record : records)
+	{
+		if (record.queueName != queueName)
+		{
+			queueName = record.queueName;
+			threadIndex = PROFILER_GPU_QUEUE_THREAD_INDEX + getQueueIndex(queueName);
+			openZones.clear();
+		}
+		// pop the zones that do not contain this one
+		while (!openZones.empty() && (openZones.back().childTime <= record.beginTime || openZones.back().childTime < record.endTime)) openZones.pop_back();
+
+		const uint32_t parent = openZones.empty() ? UINT32_MAX : openZones.back().zone;
+		const uint32_t zone = findOrAddZone(threadIndex, parent, record.name);
+		const uint64_t duration = record.endTime - record.beginTime;
+		m_frameAccum[zone].time += duration;
+		m_frameAccum[zone].selfTime += duration;
+		m_frameAccum[zone].calls++;
+		if (parent != UINT32_MAX) m_frameAccum[parent].selfTime -= std::min(m_frameAccum[parent].selfTime, duration);
+		openZones.push_back({ zone, record.beginTime, record.endTime });
+
+		if (m_traceFramesLeft != 0 && record.beginTime >= m_traceBeginTime)
+		{
+			m_traceZones.push_back({ record.name, threadIndex, record.beginTime, record.endTime });
+		}
+	}
+#endif // ENABLE_PROFILER
+}
+//=============================================================================
+void ProfilerSystem::printZone(uint32_t zoneIndex, const std::vector<std::vector<uint32_t>>& children) const
+{
+	const ProfilerZoneStats& zone = m_zones[zoneIndex];
+	if (zone.numFrames != 0)
+	{
+		char buffer[512];
+		snprintf(buffer, sizeof(buffer), "%*s%-*s %8.3f %8.3f %8.3f %8.3f %6.1f",
+			static_cast<int>(zone.depth * 2 + 2), "", std::max(1, 40 - static_cast<int>(zone.depth * 2)), zone.name,
+			zone.AvgMs(), zone.minMs, zone.maxMs, zone.AvgSelfMs(), static_cast<double>(zone.numCalls) / static_cast<double>(zone.numFrames));
+		Print(buffer);
+	}
+
+	for (uint32_t child : children[zoneIndex])
+	{
+		printZone(child, children);
+	}
+}
+//=============================================================================
@@ -0,0 +1,174 @@
+﻿#pragma once
+
+// In-engine CPU profiler. SCOPED_CPU_MARKER writes begin/end timestamps into a lock-free ring owned by the calling thread,
+// ProfilerSystem::EndFrame() drains all rings on the main thread and aggregates the nested zones of the frame into per-zone statistics.
+// With ENABLE_PROFILER 0 the markers do not reference the profiler at all and ProfilerSystem does nothing.
+//
+// A trace capture records every zone and queue event of N frames and writes them as Chrome Trace Event JSON,
+// which opens in chrome://tracing and ui.perfetto.dev on any OS.
+
+struct ProfilerSystemCreateInfo final
+{
+	uint32_t    reportIntervalFrames{ 0 };      // print the zone tree every N frames, 0 - never
+	std::string tracePath{ "ProfilerTrace.json" };
+	uint32_t    traceFrames{ 120 };             // frames recorded by one capture
+	bool        traceOnStart{ false };          // begin a capture with the first frame
+};
+
+// Parses --trace [frames] and --trace-out <path>, other arguments are ignored.
+void ParseProfilerCommandLine(int argc, char* argv[], ProfilerSystemCreateInfo& createInfo);
+
+enum class ProfilerQueueEvent : uint8_t
+{
+	submit,    // command list handed to the queue (CPU side)
+	signal,    // fence signal queued, the fence is in flight until completed
+	completed, // the CPU observed that all fences up to the value have completed
+	wait       // the queue waits on the GPU for a fence value
+};
+
+// GPU zones are kept per queue, as if every queue was one more thread starting at this index
+constexpr uint32_t PROFILER_GPU_QUEUE_THREAD_INDEX = 1000;
+
+struct ProfilerZoneStats final
+{
+	const char* name{ nullptr };
+	uint32_t    parent{ UINT32_MAX };  // index in ProfilerSystem::GetZones(), UINT32_MAX for the root zones of a thread
+	uint32_t    depth{ 0 };
+	uint32_t    threadIndex{ 0 };      // PROFILER_GPU_QUEUE_THREAD_INDEX + queue index for GPU zones
+
+	// accumulated over all frames in which the zone was entered; time is inclusive (children included), self time excludes children
+	uint64_t    numFrames{ 0 };
+	uint64_t    numCalls{ 0 };
+	double      minMs{ 0.0 };
+	double      maxMs{ 0.0 };
+	double      totalMs{ 0.0 };
+	double      totalSelfMs{ 0.0 };
+
+	// last completed frame
+	uint32_t    lastFrameCalls{ 0 };
+	double      lastFrameMs{ 0.0 };
+
+	[[nodiscard]] double AvgMs() const { return numFrames ? totalMs / static_cast<double>(numFrames) : 0.0; }
+	[[nodiscard]] double AvgSelfMs() const { return numFrames ? totalSelfMs / static_cast<double>(numFrames) : 0.0; }
+};
+
+// Clock of all profiler timestamps, nanoseconds
+[[nodiscard]] uint64_t ProfilerGetTime();
+
+#if ENABLE_PROFILER
+// Thread-safe, callable from any thread at any time. Events recorded while no ProfilerSystem exists are dropped.
+// The name must outlive the profiler: a string literal or a pointer returned by ProfilerInternName().
+void ProfilerBeginZone(const char* name);
+void ProfilerEndZone();
+// Returns a stable copy of the string, equal strings return the same pointer. Takes a lock, meant for formatted marker names.
+[[nodiscard]] const char* ProfilerInternName(const char* name);
+
+// Shown as the thread name in trace captures. The name must outlive the profiler.
+void ProfilerSetThreadName(const char* name);
+// Only recorded while a trace capture runs. queueName must be a string literal, it identifies the queue track.
+void ProfilerRecordQueueEvent(const char* queueName, ProfilerQueueEvent event, uint64_t fenceValue);
+// A finished GPU zone with timestamps already converted to ProfilerGetTime(). GPU zones are nested by time, not by call order.
+void ProfilerRecordGPUZone(const char* queueName, const char* name, uint64_t beginTime, uint64_t endTime);
+#else
+inline void ProfilerSetThreadName(const char*) {}
+inline void ProfilerRecordQueueEvent(const char*, ProfilerQueueEvent, uint64_t) {}
+inline void ProfilerRecordGPUZone(const char*, const char*, uint64_t, uint64_t) {}
+#endif // ENABLE_PROFILER
+
+class ProfilerSystem final
+{
+public:
+	~ProfilerSystem();
+
+	[[nodiscard]] bool Create(const ProfilerSystemCreateInfo& createInfo);
+	void Destroy();
+
+	// Closes the current frame: drains the thread rings and updates the statistics. Call once per frame on the main thread.
+	void EndFrame();
+
+	void ResetStats();
+	void PrintReport() const;
+
+	// Records the next numFrames frames (0 - ProfilerSystemCreateInfo::traceFrames) and writes them to path (empty - ProfilerSystemCreateInfo::tracePath).
+	// Ignored while a capture is already running.
+	void BeginTraceCapture(uint32_t numFrames = 0, const std::string& path = {});
+	[[nodiscard]] bool IsTraceCaptureActive() const { return m_traceFramesLeft != 0; }
+
+	[[nodiscard]] const std::vector<ProfilerZoneStats>& GetZones() const { return m_zones; }
+	[[nodiscard]] uint64_t GetFrameIndex() const { return m_frameIndex; }
+	[[nodiscard]] uint64_t GetNumDroppedZones() const { return m_numDroppedZones; }
+
+private:
+	struct OpenZone final
+	{
+		uint32_t zone;
+		uint64_t beginTime;
+		uint64_t childTime;
+	};
+
+	struct ZoneKey final
+	{
+		uint32_t    threadIndex;
+		uint32_t    parent;
+		const char* name;
+
+		bool operator==(const ZoneKey&) const = default;
+	};
+
+	struct ZoneKeyHash final
+	{
+		size_t operator()(const ZoneKey& key) const
+		{
+			const size_t hash = std::hash<const char*>()(key.name);
+			return hash ^ ((static_cast<size_t>(key.threadIndex) << 32 | key.parent) + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2));
+		}
+	};
+
+	struct FrameAccum final
+	{
+		uint64_t time{ 0 };
+		uint64_t selfTime{ 0 };
+		uint32_t calls{ 0 };
+	};
+
+	struct TraceZone final
+	{
+		const char* name;
+		uint32_t    threadIndex;
+		uint64_t    beginTime;
+		uint64_t    endTime;
+	};
+
+	struct TraceQueueEvent final
+	{
+		uint32_t           queueIndex;
+		ProfilerQueueEvent event;
+		uint32_t           threadIndex;
+		uint64_t           fenceValue;
+		uint64_t           time;
+	};
+
+	uint32_t findOrAddZone(uint32_t threadIndex, uint32_t parent, const char* name);
+	uint32_t getQueueIndex(const char* queueName);
+	void     collectGPUZones();
+	void     printZone(uint32_t zone, const std::vector<std::vector<uint32_t>>& children) const;
+	void     endTraceCapture();
+	[[nodiscard]] bool writeTrace() const;
+
+	ProfilerSystemCreateInfo                             m_createInfo{};
+	std::vector<ProfilerZoneStats>                       m_zones;
+	std::vector<FrameAccum>                              m_frameAccum; // per zone
+	std::unordered_map<ZoneKey, uint32_t, ZoneKeyHash>   m_zoneLookup;
+	std::vector<std::vector<OpenZone>>                   m_openZones;  // per thread, zones begun but not ended yet
+	uint64_t                                             m_frameIndex{ 0 };
+	uint64_t                                             m_numDroppedZones{ 0 };
+
+	std::string                                          m_tracePath;
+	uint32_t                                             m_traceFramesLeft{ 0 };
+	uint64_t                                             m_traceBeginTime{ 0 };
+	std::vector<TraceZone>                               m_traceZones;
+	std::vector<TraceQueueEvent>                         m_traceQueueEvents;
+	std::vector<uint64_t>                                m_traceFrameTimes;
+	std::vector<const char*>                             m_traceThreadNames; // per thread index
+	std::vector<const char*>                             m_queueNames;       // per queue index
+};
@@ -28,6 +28,7 @@ bool RHIBackend::CreateAPI(const WindowData& wndData, const RenderSystemCreateIn
 		.descriptorHeapManager = descriptorHeapManager };
 	swapChainCreateInfo.presentQueue = &graphicsQueue;
 	swapChainCreateInfo.vSync        = createInfo.vsync;
+	swapChainCreateInfo.maxFrameLatency = createInfo.maxFrameLatency;
 	if (!swapChain.Create(swapChainCreateInfo)) return false;	
 
 	return true;
@@ -131,6 +132,11 @@ void RHIBackend::WaitForGpu()
 	swapChain.WaitForGPU();
 }
 //=============================================================================
+void RHIBackend::WaitForFrameLatency()
+{
+	swapChain.WaitForFrameLatency();
+}
+//=============================================================================
 void RHIBackend::ClearFrameBuffer(const glm::vec4& color)
 {
 	PIXBeginEvent(commandList.Get(), PIX_COLOR_DEFAULT, L"ClearFrameBuffer");
@@ -28,6 +28,7 @@ public:
 	void Present(D3D12_RESOURCE_STATES beforeState = D3D12_RESOURCE_STATE_RENDER_TARGET);
 
 	void WaitForGpu();
+	void WaitForFrameLatency();
 
 	void ClearFrameBuffer(const glm::vec4& color);
 
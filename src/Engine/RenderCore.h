@@ -20,6 +20,7 @@ struct RenderSystemCreateInfo final
 	ContextCreateInfo context;
 
 	bool vsync{ false };
+	uint32_t maxFrameLatency{ 2 }; // see FramePacerCreateInfo
 };
 
 inline uint32_t GetGroupCount(uint32_t threadCount, uint32_t groupSize)
@@ -0,0 +1,527 @@
+﻿#include "stdafx.h"
+#include "RenderGraph.h"
+#include "Log.h"
+//=============================================================================
+namespace
+{
+	constexpr RenderGraphAccess WRITE_ACCESS = RenderGraphAccess::renderTarget | RenderGraphAccess::depthWrite | RenderGraphAccess::unorderedAccess | RenderGraphAccess::copyDest;
+
+	inline bool isSingleAccess(RenderGraphAccess access)
+	{
+		const uint16_t bits = static_cast<uint16_t>(access);
+		return bits != 0 && (bits & (bits - 1)) == 0;
+	}
+
+	inline bool isReadOnly(RenderGraphAccess access)
+	{
+		return access != RenderGraphAccess::none && (access & RENDER_GRAPH_READ_ONLY_ACCESS) == access;
+	}
+
+	inline bool isComputeQueueAccess(RenderGraphAccess access)
+	{
+		return (access & RENDER_GRAPH_COMPUTE_QUEUE_ACCESS) == access;
+	}
+
+	inline uint64_t alignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+}
+//=============================================================================
+void RenderGraphPassBuilder::Read(RenderGraphResource resource, RenderGraphAccess access)
+{
+	m_graph.addAccess(m_pass, resource, access, false);
+}
+//=============================================================================
+void RenderGraphPassBuilder::Write(RenderGraphResource resource, RenderGraphAccess access)
+{
+	m_graph.addAccess(m_pass, resource, access, true);
+}
+//=============================================================================
+void RenderGraphPassBuilder::SetSideEffects()
+{
+	m_graph.m_passes[m_pass].sideEffects = true;
+}
+//=============================================================================
+void RenderGraphPassBuilder::SetAsyncCompute()
+{
+	m_graph.m_passes[m_pass].asyncCompute = true;
+}
+//=============================================================================
+void RenderGraph::Reset()
+{
+	m_resources.clear();
+	m_passes.clear();
+	m_compiledPasses.clear();
+	m_barriers.clear();
+	m_firstFinalBarrier = 0;
+	m_finalWaitForPass = RENDER_GRAPH_INVALID_INDEX;
+	m_numDependencyLevels = 0;
+	m_heapSizes.clear();
+	m_unaliasedSize = 0;
+}
+//=============================================================================
+RenderGraphResource RenderGraph::CreateTransient(const char* name, const RenderGraphTransientDesc& desc)
+{
+	assert(desc.size > 0 && desc.alignment > 0);
+	ResourceNode& resource = m_resources.emplace_back();
+	resource.name = name;
+	resource.transient = true;
+	resource.transientDesc = desc;
+	return { static_cast<uint32_t>(m_resources.size() - 1) };
+}
+//=============================================================================
+RenderGraphResource RenderGraph::Import(const char* name, RenderGraphAccess initialAccess, RenderGraphAccess finalAccess)
+{
+	ResourceNode& resource = m_resources.emplace_back();
+	resource.name = name;
+	resource.initialAccess = initialAccess;
+	resource.finalAccess = finalAccess;
+	return { static_cast<uint32_t>(m_resources.size() - 1) };
+}
+//=============================================================================
+RenderGraphPassBuilder RenderGraph::AddPass(const char* name)
+{
+	m_passes.emplace_back().name = name;
+	return { *this, static_cast<uint32_t>(m_passes.size() - 1) };
+}
+//=============================================================================
+bool RenderGraph::Compile()
+{
+	m_compiledPasses.clear();
+	m_barriers.clear();
+	m_firstFinalBarrier = 0;
+	m_finalWaitForPass = RENDER_GRAPH_INVALID_INDEX;
+	m_numDependencyLevels = 0;
+	m_heapSizes.clear();
+	m_unaliasedSize = 0;
+	for (ResourceNode& resource : m_resources)
+	{
+		resource.placement = {};
+		resource.aliased = false;
+		resource.aliasedResource = {};
+	}
+
+	for (const PassNode& pass : m_passes)
+	{
+		if (!pass.valid) return false;
+		if (!pass.asyncCompute) continue;
+		for (const ResourceAccess& access : pass.accesses)
+		{
+			if (isComputeQueueAccess(access.access)) continue;
+			Error("RenderGraph: async compute pass '" + pass.name + "' uses '" + m_resources[access.resource].name + "' with an access the compute queue does not support");
+			return false;
+		}
+	}
+	if (!buildDependencies()) return false;
+
+	cullPasses();
+	placeTransients();
+	if (!buildBarriers()) return false;
+	reduceWaits();
+	return true;
+}
+//=============================================================================
+RenderGraphSimulation RenderGraph::Simulate(const std::vector<double>& passCosts) const
+{
+	assert(passCosts.size() == m_passes.size());
+
+	RenderGraphSimulation simulation{};
+	simulation.passStart.resize(m_compiledPasses.size(), 0.0);
+	simulation.passEnd.resize(m_compiledPasses.size(), 0.0);
+
+	// every queue runs its passes in order, a wait holds a pass back until the other queue got that far
+	double queueEnd[2] = { 0.0, 0.0 };
+	for (uint32_t compiledIndex = 0; compiledIndex < m_compiledPasses.size(); compiledIndex++)
+	{
+		const RenderGraphCompiledPass& compiledPass = m_compiledPasses[compiledIndex];
+		const size_t queue = static_cast<size_t>(compiledPass.queue);
+		const double cost = passCosts[compiledPass.pass];
+
+		double start = queueEnd[queue];
+		if (compiledPass.waitForPass != RENDER_GRAPH_INVALID_INDEX) start = std::max(start, simulation.passEnd[compiledPass.waitForPass]);
+
+		simulation.passStart[compiledIndex] = start;
+		simulation.passEnd[compiledIndex] = start + cost;
+		queueEnd[queue] = start + cost;
+		(compiledPass.queue == RenderGraphQueue::graphics ? simulation.graphicsTime : simulation.computeTime) += cost;
+	}
+	if (m_finalWaitForPass != RENDER_GRAPH_INVALID_INDEX) queueEnd[0] = std::max(queueEnd[0], simulation.passEnd[m_finalWaitForPass]);
+
+	simulation.frameTime = std::max(queueEnd[0], queueEnd[1]);
+	simulation.serialTime = simulation.graphicsTime + simulation.computeTime;
+	simulation.overlapTime = simulation.serialTime - simulation.frameTime;
+	return simulation;
+}
+//=============================================================================
+void RenderGraph::addAccess(uint32_t pass, RenderGraphResource resource, RenderGraphAccess access, bool write)
+{
+	assert(resource.index < m_resources.size());
+	PassNode& node = m_passes[pass];
+
+	const bool validAccess = write ? isSingleAccess(access) && (access & WRITE_ACCESS) == access : isReadOnly(access) || access == RenderGraphAccess::unorderedAccess;
+	if (!validAccess)
+	{
+		Error("RenderGraph: pass '" + node.name + "' uses '" + m_resources[resource.index].name + "' with an access that can not be " + (write ? "written" : "read"));
+		node.valid = false;
+		return;
+	}
+
+	for (ResourceAccess& existing : node.accesses)
+	{
+		if (existing.resource != resource.index) continue;
+
+		const RenderGraphAccess merged = existing.access | access;
+		if (merged == RenderGraphAccess::unorderedAccess)
+		{
+			existing.write = existing.write || write;
+		}
+		else if (!existing.write && !write && isReadOnly(merged))
+		{
+			existing.access = merged;
+		}
+		else if (existing.access != access || existing.write != write)
+		{
+			Error("RenderGraph: pass '" + node.name + "' uses '" + m_resources[resource.index].name + "' in conflicting ways");
+			node.valid = false;
+		}
+		return;
+	}
+	node.accesses.push_back({ resource.index, access, write });
+}
+//=============================================================================
+bool RenderGraph::buildDependencies()
+{
+	std::vector<uint32_t> lastWriter(m_resources.size(), RENDER_GRAPH_INVALID_INDEX);
+	std::vector<std::vector<uint32_t>> readersSinceWrite(m_resources.size());
+
+	for (uint32_t passIndex = 0; passIndex < m_passes.size(); passIndex++)
+	{
+		PassNode& pass = m_passes[passIndex];
+		pass.producers.clear();
+		pass.antiDependencies.clear();
+		pass.compiledIndex = RENDER_GRAPH_INVALID_INDEX;
+
+		for (const ResourceAccess& access : pass.accesses)
+		{
+			// a write keeps what it does not overwrite, it depends on the previous writer just as a read does
+			if (lastWriter[access.resource] != RENDER_GRAPH_INVALID_INDEX)
+			{
+				pass.producers.push_back(lastWriter[access.resource]);
+			}
+			else if (m_resources[access.resource].transient && !access.write)
+			{
+				Error("RenderGraph: pass '" + pass.name + "' reads '" + m_resources[access.resource].name + "' before any pass wrote it");
+				return false;
+			}
+
+			if (access.write)
+			{
+				for (uint32_t reader : readersSinceWrite[access.resource])
+				{
+					if (reader != passIndex) pass.antiDependencies.push_back(reader);
+				}
+				readersSinceWrite[access.resource].clear();
+				lastWriter[access.resource] = passIndex;
+			}
+			else
+			{
+				readersSinceWrite[access.resource].push_back(passIndex);
+			}
+		}
+
+		for (std::vector<uint32_t>* passes : { &pass.producers, &pass.antiDependencies })
+		{
+			std::sort(passes->begin(), passes->end());
+			passes->erase(std::unique(passes->begin(), passes->end()), passes->end());
+		}
+	}
+	return true;
+}
+//=============================================================================
+void RenderGraph::cullPasses()
+{
+	const uint32_t numPasses = static_cast<uint32_t>(m_passes.size());
+	std::vector<bool> alive(numPasses, false);
+	for (uint32_t passIndex = 0; passIndex < numPasses; passIndex++)
+	{
+		const PassNode& pass = m_passes[passIndex];
+		alive[passIndex] = pass.sideEffects;
+		for (const ResourceAccess& access : pass.accesses)
+		{
+			if (access.write && !m_resources[access.resource].transient) alive[passIndex] = true;
+		}
+	}
+
+	// producers come first in declaration order, one backward sweep reaches all of them
+	for (uint32_t passIndex = numPasses; passIndex-- > 0;)
+	{
+		if (!alive[passIndex]) continue;
+		for (uint32_t producer : m_passes[passIndex].producers) alive[producer] = true;
+	}
+
+	for (uint32_t passIndex = 0; passIndex < numPasses; passIndex++)
+	{
+		if (!alive[passIndex]) continue;
+
+		PassNode& pass = m_passes[passIndex];
+		RenderGraphCompiledPass compiledPass{};
+		compiledPass.pass = passIndex;
+		compiledPass.queue = pass.asyncCompute ? RenderGraphQueue::compute : RenderGraphQueue::graphics;
+		for (const std::vector<uint32_t>* dependencies : { &pass.producers, &pass.antiDependencies })
+		{
+			for (uint32_t dependency : *dependencies)
+			{
+				if (!alive[dependency]) continue; // a culled reader does not order anything
+				compiledPass.dependencyLevel = std::max(compiledPass.dependencyLevel, m_compiledPasses[m_passes[dependency].compiledIndex].dependencyLevel + 1);
+			}
+		}
+		m_numDependencyLevels = std::max(m_numDependencyLevels, compiledPass.dependencyLevel + 1);
+
+		pass.compiledIndex = static_cast<uint32_t>(m_compiledPasses.size());
+		m_compiledPasses.push_back(compiledPass);
+	}
+}
+//=============================================================================
+void RenderGraph::placeTransients()
+{
+	std::vector<uint32_t> transients;
+	std::vector<bool> usedByCompute(m_resources.size(), false);
+	for (const RenderGraphCompiledPass& compiledPass : m_compiledPasses)
+	{
+		const uint32_t compiledIndex = m_passes[compiledPass.pass].compiledIndex;
+		for (const ResourceAccess& access : m_passes[compiledPass.pass].accesses)
+		{
+			ResourceNode& resource = m_resources[access.resource];
+			if (!resource.transient) continue;
+
+			if (resource.placement.firstPass == RENDER_GRAPH_INVALID_INDEX)
+			{
+				resource.placement.firstPass = compiledIndex;
+				resource.placement.heapGroup = resource.transientDesc.heapGroup;
+				transients.push_back(access.resource);
+			}
+			resource.placement.lastPass = compiledIndex;
+			if (compiledPass.queue == RenderGraphQueue::compute) usedByCompute[access.resource] = true;
+		}
+	}
+
+	// the queues only wait for each other where the resources say so, memory shared with a compute transient could still be
+	// in use on the other queue: such transients occupy their memory for the whole frame
+	const uint32_t lastCompiledPass = static_cast<uint32_t>(m_compiledPasses.size()) - 1;
+	auto overlaps = [&](uint32_t a, uint32_t b)
+	{
+		const RenderGraphPlacement& placementA = m_resources[a].placement;
+		const RenderGraphPlacement& placementB = m_resources[b].placement;
+		const uint32_t firstA = usedByCompute[a] ? 0 : placementA.firstPass;
+		const uint32_t lastA = usedByCompute[a] ? lastCompiledPass : placementA.lastPass;
+		const uint32_t firstB = usedByCompute[b] ? 0 : placementB.firstPass;
+		const uint32_t lastB = usedByCompute[b] ? lastCompiledPass : placementB.lastPass;
+		return lastA >= firstB && firstA <= lastB;
+	};
+
+	// largest first, the small ones fill the gaps
+	std::sort(transients.begin(), transients.end(), [this](uint32_t a, uint32_t b)
+	{
+		const ResourceNode& resourceA = m_resources[a];
+		const ResourceNode& resourceB = m_resources[b];
+		if (resourceA.transientDesc.size != resourceB.transientDesc.size) return resourceA.transientDesc.size > resourceB.transientDesc.size;
+		return resourceA.placement.firstPass < resourceB.placement.firstPass;
+	});
+
+	std::vector<uint32_t> placed;
+	std::vector<uint32_t> conflicts;
+	for (uint32_t resourceIndex : transients)
+	{
+		ResourceNode& resource = m_resources[resourceIndex];
+		const RenderGraphTransientDesc& desc = resource.transientDesc;
+		RenderGraphPlacement& placement = resource.placement;
+
+		// first fit below the resources that are alive at the same time
+		conflicts.clear();
+		for (uint32_t other : placed)
+		{
+			if (m_resources[other].placement.heapGroup != placement.heapGroup || !overlaps(resourceIndex, other)) continue;
+			conflicts.push_back(other);
+		}
+		std::sort(conflicts.begin(), conflicts.end(), [this](uint32_t a, uint32_t b) { return m_resources[a].placement.offset < m_resources[b].placement.offset; });
+
+		uint64_t offset = 0;
+		for (uint32_t other : conflicts)
+		{
+			const ResourceNode& otherResource = m_resources[other];
+			if (alignUp(offset, desc.alignment) + desc.size <= otherResource.placement.offset) break;
+			offset = std::max(offset, otherResource.placement.offset + otherResource.transientDesc.size);
+		}
+		placement.offset = alignUp(offset, desc.alignment);
+		placed.push_back(resourceIndex);
+
+		if (m_heapSizes.size() <= placement.heapGroup) m_heapSizes.resize(placement.heapGroup + 1, 0);
+		m_heapSizes[placement.heapGroup] = std::max(m_heapSizes[placement.heapGroup], placement.offset + desc.size);
+		m_unaliasedSize += desc.size;
+	}
+
+	// the memory of a transient held something else earlier in the frame
+	for (uint32_t resourceIndex : placed)
+	{
+		ResourceNode& resource = m_resources[resourceIndex];
+		const RenderGraphPlacement& placement = resource.placement;
+		uint32_t numPrevious = 0;
+		for (uint32_t other : placed)
+		{
+			const ResourceNode& otherResource = m_resources[other];
+			const RenderGraphPlacement& otherPlacement = otherResource.placement;
+			if (otherPlacement.heapGroup != placement.heapGroup || otherPlacement.lastPass >= placement.firstPass || overlaps(resourceIndex, other)) continue;
+			if (otherPlacement.offset >= placement.offset + resource.transientDesc.size || placement.offset >= otherPlacement.offset + otherResource.transientDesc.size) continue;
+			resource.aliasedResource = { other };
+			numPrevious++;
+		}
+		resource.aliased = numPrevious > 0;
+		if (numPrevious > 1) resource.aliasedResource = {};
+	}
+}
+//=============================================================================
+bool RenderGraph::buildBarriers()
+{
+	std::vector<std::vector<ResourceUse>> uses(m_resources.size());
+	for (uint32_t compiledIndex = 0; compiledIndex < m_compiledPasses.size(); compiledIndex++)
+	{
+		for (const ResourceAccess& access : m_passes[m_compiledPasses[compiledIndex].pass].accesses)
+		{
+			uses[access.resource].push_back({ compiledIndex, access.access, access.write });
+		}
+	}
+
+	std::vector<std::vector<RenderGraphBarrier>> passBarriers(m_compiledPasses.size());
+	std::vector<std::vector<RenderGraphBarrier>> releaseBarriers(m_compiledPasses.size());
+	std::vector<RenderGraphBarrier> finalBarriers;
+	for (uint32_t resourceIndex = 0; resourceIndex < m_resources.size(); resourceIndex++)
+	{
+		const ResourceNode& resource = m_resources[resourceIndex];
+		const std::vector<ResourceUse>& resourceUses = uses[resourceIndex];
+		const RenderGraphResource handle{ resourceIndex };
+
+		RenderGraphAccess current = resource.transient ? RenderGraphAccess::none : resource.initialAccess;
+		bool lastWasUnorderedWrite = false;
+		uint32_t lastUse[2] = { RENDER_GRAPH_INVALID_INDEX, RENDER_GRAPH_INVALID_INDEX }; // per queue
+		uint32_t lastWriteQueue = RENDER_GRAPH_INVALID_INDEX;
+		for (size_t useIndex = 0; useIndex < resourceUses.size(); useIndex++)
+		{
+			const ResourceUse& use = resourceUses[useIndex];
+			const RenderGraphQueue queue = m_compiledPasses[use.compiledPass].queue;
+			const bool onCompute = queue == RenderGraphQueue::compute;
+			std::vector<RenderGraphBarrier>& barriers = passBarriers[use.compiledPass];
+
+			RenderGraphAccess target = use.access;
+			if (!use.write && isReadOnly(use.access))
+			{
+				if (isReadOnly(current) && (current & use.access) == use.access && (!onCompute || isComputeQueueAccess(current)))
+				{
+					target = current;
+				}
+				else
+				{
+					// one transition into everything the following readers of the same queue need
+					for (size_t next = useIndex + 1; next < resourceUses.size() && !resourceUses[next].write && isReadOnly(resourceUses[next].access)
+						&& m_compiledPasses[resourceUses[next].compiledPass].queue == queue; next++)
+					{
+						target = target | resourceUses[next].access;
+					}
+				}
+			}
+
+			bool stateChange = true;
+			if (resource.transient && useIndex == 0)
+			{
+				if (resource.aliased)
+				{
+					RenderGraphBarrier& barrier = barriers.emplace_back();
+					barrier.type = RenderGraphBarrierType::aliasing;
+					barrier.resource = handle;
+					barrier.aliasedResource = resource.aliasedResource;
+				}
+				barriers.push_back({ RenderGraphBarrierType::transition, handle, {}, RenderGraphAccess::none, target });
+			}
+			else if (target != current && onCompute && !isComputeQueueAccess(current))
+			{
+				// the compute queue can not leave a graphics state, the previous user releases the resource to it
+				if (useIndex == 0)
+				{
+					Error("RenderGraph: async compute pass '" + m_passes[m_compiledPasses[use.compiledPass].pass].name + "' is the first to use '" + resource.name + "', which is imported in a state the compute queue can not leave");
+					return false;
+				}
+				const uint32_t previousPass = resourceUses[useIndex - 1].compiledPass;
+				assert(m_compiledPasses[previousPass].queue == RenderGraphQueue::graphics);
+				releaseBarriers[previousPass].push_back({ RenderGraphBarrierType::transition, handle, {}, current, target });
+			}
+			else if (target != current)
+			{
+				barriers.push_back({ RenderGraphBarrierType::transition, handle, {}, current, target });
+			}
+			else
+			{
+				if (target == RenderGraphAccess::unorderedAccess && (lastWasUnorderedWrite || use.write))
+				{
+					barriers.push_back({ RenderGraphBarrierType::unorderedAccess, handle, {} });
+				}
+				stateChange = false;
+			}
+
+			// the other queue has to be done with the resource unless both only read it in the same state
+			const uint32_t otherQueue = onCompute ? 0 : 1;
+			if (lastUse[otherQueue] != RENDER_GRAPH_INVALID_INDEX && (use.write || stateChange || lastWriteQueue == otherQueue))
+			{
+				uint32_t& waitForPass = m_compiledPasses[use.compiledPass].waitForPass;
+				waitForPass = waitForPass == RENDER_GRAPH_INVALID_INDEX ? lastUse[otherQueue] : std::max(waitForPass, lastUse[otherQueue]);
+			}
+
+			current = target;
+			lastWasUnorderedWrite = use.write && use.access == RenderGraphAccess::unorderedAccess;
+			lastUse[onCompute ? 1 : 0] = use.compiledPass;
+			if (use.write) lastWriteQueue = onCompute ? 1 : 0;
+		}
+
+		if (!resource.transient && current != resource.finalAccess)
+		{
+			finalBarriers.push_back({ RenderGraphBarrierType::transition, handle, {}, current, resource.finalAccess });
+		}
+	}
+
+	for (uint32_t compiledIndex = 0; compiledIndex < m_compiledPasses.size(); compiledIndex++)
+	{
+		std::vector<RenderGraphBarrier>& barriers = passBarriers[compiledIndex];
+		// memory hand-over before the transitions of the new resources
+		std::stable_partition(barriers.begin(), barriers.end(), [](const RenderGraphBarrier& barrier) { return barrier.type == RenderGraphBarrierType::aliasing; });
+
+		RenderGraphCompiledPass& compiledPass = m_compiledPasses[compiledIndex];
+		compiledPass.firstBarrier = static_cast<uint32_t>(m_barriers.size());
+		compiledPass.numBarriers = static_cast<uint32_t>(barriers.size());
+		m_barriers.insert(m_barriers.end(), barriers.begin(), barriers.end());
+
+		compiledPass.firstReleaseBarrier = static_cast<uint32_t>(m_barriers.size());
+		compiledPass.numReleaseBarriers = static_cast<uint32_t>(releaseBarriers[compiledIndex].size());
+		m_barriers.insert(m_barriers.end(), releaseBarriers[compiledIndex].begin(), releaseBarriers[compiledIndex].end());
+
+		if (compiledPass.queue == RenderGraphQueue::compute) m_finalWaitForPass = compiledIndex;
+	}
+	m_firstFinalBarrier = static_cast<uint32_t>(m_barriers.size());
+	m_barriers.insert(m_barriers.end(), finalBarriers.begin(), finalBarriers.end());
+	return true;
+}
+//=============================================================================
+void RenderGraph::reduceWaits()
+{
+	// a queue that already waited for a later pass of the other queue needs no wait for an earlier one
+	uint32_t synced[2] = { RENDER_GRAPH_INVALID_INDEX, RENDER_GRAPH_INVALID_INDEX };
+	auto reduce = [&synced](RenderGraphQueue queue, uint32_t& waitForPass)
+	{
+		if (waitForPass == RENDER_GRAPH_INVALID_INDEX) return;
+		uint32_t& queueSynced = synced[static_cast<size_t>(queue)];
+		if (queueSynced != RENDER_GRAPH_INVALID_INDEX && queueSynced >= waitForPass) waitForPass = RENDER_GRAPH_INVALID_INDEX;
+		else queueSynced = waitForPass;
+	};
+
+	for (RenderGraphCompiledPass& compiledPass : m_compiledPasses) reduce(compiledPass.queue, compiledPass.waitForPass);
+	reduce(RenderGraphQueue::graphics, m_finalWaitForPass);
+}
+//=============================================================================
@@ -0,0 +1,241 @@
+﻿#pragma once
+
+// Frame graph compiler. Passes declare the resources they read and write, Compile() turns that into an execution plan:
+//  - passes whose results nobody consumes are culled: a pass survives when it has side effects, writes an imported resource
+//    or writes something a surviving pass reads
+//  - the surviving passes keep their declaration order and get a dependency level, passes of one level are independent
+//  - one batch of barriers before each pass, with consecutive read-only uses of a resource merged into one combined read state
+//  - transient resources whose lifetimes do not overlap share memory, aliasing barriers mark the hand-over
+//  - passes flagged async compute go to the compute queue. A pass waits for the latest pass of the other queue that touched one
+//    of its resources when either side writes it or its state changes in between, concurrent reads need no wait. The compute
+//    queue can not leave graphics-only states, the last graphics user hands such a resource over with a release barrier.
+//    Transients used on the compute queue are not aliased, their memory could still be in use by the other queue.
+//  - Simulate() estimates from per-pass costs how much of the compute work overlaps the graphics work
+//
+// The compiler knows nothing about the graphics API, sizes and alignments of transient resources come from the backend
+// (see RenderGraphD3D12), which also turns accesses into API states.
+
+enum class RenderGraphAccess : uint16_t
+{
+	none               = 0,
+	renderTarget       = 1 << 0,
+	depthWrite         = 1 << 1,
+	depthRead          = 1 << 2,
+	pixelShaderRead    = 1 << 3,
+	nonPixelShaderRead = 1 << 4,
+	unorderedAccess    = 1 << 5,
+	copySource         = 1 << 6,
+	copyDest           = 1 << 7,
+	indirectArgument   = 1 << 8,
+	present            = 1 << 9
+};
+
+constexpr RenderGraphAccess operator|(RenderGraphAccess a, RenderGraphAccess b)
+{
+	return static_cast<RenderGraphAccess>(static_cast<uint16_t>(a) | static_cast<uint16_t>(b));
+}
+
+constexpr RenderGraphAccess operator&(RenderGraphAccess a, RenderGraphAccess b)
+{
+	return static_cast<RenderGraphAccess>(static_cast<uint16_t>(a) & static_cast<uint16_t>(b));
+}
+
+// accesses that can be combined into one state
+constexpr RenderGraphAccess RENDER_GRAPH_READ_ONLY_ACCESS = RenderGraphAccess::depthRead | RenderGraphAccess::pixelShaderRead |
+	RenderGraphAccess::nonPixelShaderRead | RenderGraphAccess::copySource | RenderGraphAccess::indirectArgument;
+// accesses a compute queue can use and transition between, present is the common state
+constexpr RenderGraphAccess RENDER_GRAPH_COMPUTE_QUEUE_ACCESS = RenderGraphAccess::unorderedAccess | RenderGraphAccess::nonPixelShaderRead |
+	RenderGraphAccess::copySource | RenderGraphAccess::copyDest | RenderGraphAccess::present;
+
+enum class RenderGraphQueue : uint8_t
+{
+	graphics = 0,
+	compute  = 1
+};
+
+constexpr uint32_t RENDER_GRAPH_INVALID_INDEX = UINT32_MAX;
+
+struct RenderGraphResource final
+{
+	[[nodiscard]] bool IsValid() const { return index != RENDER_GRAPH_INVALID_INDEX; }
+	bool operator==(const RenderGraphResource&) const = default;
+
+	uint32_t index{ RENDER_GRAPH_INVALID_INDEX };
+};
+
+struct RenderGraphTransientDesc final
+{
+	uint64_t size{ 0 };
+	uint64_t alignment{ 1 };
+	uint32_t heapGroup{ 0 }; // only resources of one group share memory, e.g. render targets and other textures
+};
+
+enum class RenderGraphBarrierType : uint8_t
+{
+	transition,
+	unorderedAccess,
+	aliasing
+};
+
+struct RenderGraphBarrier final
+{
+	RenderGraphBarrierType type{ RenderGraphBarrierType::transition };
+	RenderGraphResource    resource;
+	RenderGraphResource    aliasedResource;                 // aliasing: the previous user of the memory, invalid when there were several
+	RenderGraphAccess      before{ RenderGraphAccess::none }; // transition: none on the first use of a transient resource, its contents are undefined
+	RenderGraphAccess      after{ RenderGraphAccess::none };
+};
+
+struct RenderGraphCompiledPass final
+{
+	uint32_t         pass{ 0 };                                // index in AddPass() order
+	uint32_t         dependencyLevel{ 0 };
+	RenderGraphQueue queue{ RenderGraphQueue::graphics };
+	uint32_t         waitForPass{ RENDER_GRAPH_INVALID_INDEX }; // compiled pass of the other queue that has to finish first
+	uint32_t         firstBarrier{ 0 };                        // issued before the pass
+	uint32_t         numBarriers{ 0 };
+	uint32_t         firstReleaseBarrier{ 0 };                 // issued after the pass, hand resources to the compute queue
+	uint32_t         numReleaseBarriers{ 0 };
+};
+
+struct RenderGraphSimulation final
+{
+	std::vector<double> passStart;       // per compiled pass
+	std::vector<double> passEnd;
+	double              graphicsTime{ 0.0 }; // busy time of each queue
+	double              computeTime{ 0.0 };
+	double              frameTime{ 0.0 };    // both queues done
+	double              serialTime{ 0.0 };   // everything on the graphics queue
+	double              overlapTime{ 0.0 };  // serialTime - frameTime
+};
+
+struct RenderGraphPlacement final
+{
+	uint32_t heapGroup{ 0 };
+	uint64_t offset{ 0 };
+	uint32_t firstPass{ RENDER_GRAPH_INVALID_INDEX }; // compiled pass indices, invalid when no surviving pass uses the resource
+	uint32_t lastPass{ RENDER_GRAPH_INVALID_INDEX };
+};
+
+class RenderGraph;
+
+class RenderGraphPassBuilder final
+{
+public:
+	// Several accesses of one resource are merged, a pass may read and write a resource only through unorderedAccess
+	void Read(RenderGraphResource resource, RenderGraphAccess access);
+	void Write(RenderGraphResource resource, RenderGraphAccess access);
+	// The pass is never culled, e.g. a readback or a pass with outputs outside of the graph
+	void SetSideEffects();
+	// The pass runs on the compute queue, it may only use RENDER_GRAPH_COMPUTE_QUEUE_ACCESS
+	void SetAsyncCompute();
+
+	[[nodiscard]] uint32_t GetPassIndex() const { return m_pass; }
+
+private:
+	friend class RenderGraph;
+	RenderGraphPassBuilder(RenderGraph& graph, uint32_t pass) : m_graph(graph), m_pass(pass) {}
+
+	RenderGraph& m_graph;
+	uint32_t     m_pass;
+};
+
+class RenderGraph final
+{
+public:
+	// Forgets all passes and resources
+	void Reset();
+
+	RenderGraphResource CreateTransient(const char* name, const RenderGraphTransientDesc& desc);
+	// A resource owned outside of the graph, in initialAccess when the graph starts and left in finalAccess
+	RenderGraphResource Import(const char* name, RenderGraphAccess initialAccess, RenderGraphAccess finalAccess);
+	RenderGraphPassBuilder AddPass(const char* name);
+
+	// Returns false and reports an Error() for reads of transient resources nobody wrote, for conflicting accesses and for
+	// compute passes that would have to transition a resource out of its imported graphics state
+	[[nodiscard]] bool Compile();
+
+	// Plays the compiled passes on two queues, passCosts holds the GPU time of every pass in AddPass() order (e.g. from the
+	// GPU profiler). Barriers and waits cost nothing.
+	[[nodiscard]] RenderGraphSimulation Simulate(const std::vector<double>& passCosts) const;
+
+	[[nodiscard]] const std::vector<RenderGraphCompiledPass>& GetCompiledPasses() const { return m_compiledPasses; }
+	[[nodiscard]] const std::vector<RenderGraphBarrier>& GetBarriers() const { return m_barriers; }
+	// Returns imported resources to their final access, issued after the last pass
+	[[nodiscard]] uint32_t GetFirstFinalBarrier() const { return m_firstFinalBarrier; }
+	// The last compute pass, the final barriers wait for it. Invalid without compute passes.
+	[[nodiscard]] uint32_t GetFinalWaitForPass() const { return m_finalWaitForPass; }
+	[[nodiscard]] uint32_t GetNumDependencyLevels() const { return m_numDependencyLevels; }
+
+	[[nodiscard]] uint32_t GetNumPasses() const { return static_cast<uint32_t>(m_passes.size()); }
+	[[nodiscard]] const std::string& GetPassName(uint32_t pass) const { return m_passes[pass].name; }
+	[[nodiscard]] bool IsPassCulled(uint32_t pass) const { return m_passes[pass].compiledIndex == RENDER_GRAPH_INVALID_INDEX; }
+
+	[[nodiscard]] uint32_t GetNumResources() const { return static_cast<uint32_t>(m_resources.size()); }
+	[[nodiscard]] const std::string& GetResourceName(RenderGraphResource resource) const { return m_resources[resource.index].name; }
+	[[nodiscard]] bool IsTransient(RenderGraphResource resource) const { return m_resources[resource.index].transient; }
+	[[nodiscard]] const RenderGraphPlacement& GetPlacement(RenderGraphResource resource) const { return m_resources[resource.index].placement; }
+	// Memory of every heap group after aliasing, and what the transient resources would need without it
+	[[nodiscard]] const std::vector<uint64_t>& GetHeapSizes() const { return m_heapSizes; }
+	[[nodiscard]] uint64_t GetUnaliasedSize() const { return m_unaliasedSize; }
+
+private:
+	friend class RenderGraphPassBuilder;
+
+	struct ResourceNode final
+	{
+		std::string              name;
+		bool                     transient{ false };
+		RenderGraphTransientDesc transientDesc{};
+		RenderGraphAccess        initialAccess{ RenderGraphAccess::none };
+		RenderGraphAccess        finalAccess{ RenderGraphAccess::none };
+		RenderGraphPlacement     placement{};
+		bool                     aliased{ false };      // another transient used the memory earlier in the frame
+		RenderGraphResource      aliasedResource;       // that transient, invalid when there were several
+	};
+
+	struct ResourceAccess final
+	{
+		uint32_t          resource{ 0 };
+		RenderGraphAccess access{ RenderGraphAccess::none };
+		bool              write{ false };
+	};
+
+	struct PassNode final
+	{
+		std::string                 name;
+		std::vector<ResourceAccess> accesses;         // one per resource
+		std::vector<uint32_t>       producers;        // wrote what the pass accesses, they survive when the pass does
+		std::vector<uint32_t>       antiDependencies; // read what the pass overwrites, order only
+		bool                        sideEffects{ false };
+		bool                        asyncCompute{ false };
+		bool                        valid{ true };
+		uint32_t                    compiledIndex{ RENDER_GRAPH_INVALID_INDEX };
+	};
+
+	// one use of a resource by a surviving pass
+	struct ResourceUse final
+	{
+		uint32_t          compiledPass{ 0 };
+		RenderGraphAccess access{ RenderGraphAccess::none };
+		bool              write{ false };
+	};
+
+	void addAccess(uint32_t pass, RenderGraphResource resource, RenderGraphAccess access, bool write);
+	[[nodiscard]] bool buildDependencies();
+	void cullPasses();
+	void placeTransients();
+	[[nodiscard]] bool buildBarriers();
+	void reduceWaits();
+
+	std::vector<ResourceNode>            m_resources;
+	std::vector<PassNode>                m_passes;
+
+	std::vector<RenderGraphCompiledPass> m_compiledPasses;
+	std::vector<RenderGraphBarrier>      m_barriers;
+	uint32_t                             m_firstFinalBarrier{ 0 };
+	uint32_t                             m_finalWaitForPass{ RENDER_GRAPH_INVALID_INDEX };
+	uint32_t                             m_numDependencyLevels{ 0 };
+	std::vector<uint64_t>                m_heapSizes;
+	uint64_t                             m_unaliasedSize{ 0 };
+};
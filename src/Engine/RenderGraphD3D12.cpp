@@ -0,0 +1,503 @@
+﻿#include "stdafx.h"
+#if RENDER_D3D12
+#include "RenderGraphD3D12.h"
+#include "oRHIBackendD3D12.h"
+#include "GPUMarker.h"
+#include "JobSystem.h"
+#include "Log.h"
+//=============================================================================
+extern JobSystem* thisJobSystem;
+//=============================================================================
+namespace
+{
+	// resource heap tier 1 keeps render targets and other textures apart
+	constexpr uint32_t HEAP_GROUP_RT_DS_TEXTURES = 0;
+	constexpr uint32_t HEAP_GROUP_OTHER_TEXTURES = 1;
+
+	constexpr std::pair<RenderGraphAccess, D3D12_RESOURCE_STATES> ACCESS_STATES[] =
+	{
+		{ RenderGraphAccess::renderTarget,       D3D12_RESOURCE_STATE_RENDER_TARGET },
+		{ RenderGraphAccess::depthWrite,         D3D12_RESOURCE_STATE_DEPTH_WRITE },
+		{ RenderGraphAccess::depthRead,          D3D12_RESOURCE_STATE_DEPTH_READ },
+		{ RenderGraphAccess::pixelShaderRead,    D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE },
+		{ RenderGraphAccess::nonPixelShaderRead, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE },
+		{ RenderGraphAccess::unorderedAccess,    D3D12_RESOURCE_STATE_UNORDERED_ACCESS },
+		{ RenderGraphAccess::copySource,         D3D12_RESOURCE_STATE_COPY_SOURCE },
+		{ RenderGraphAccess::copyDest,           D3D12_RESOURCE_STATE_COPY_DEST },
+		{ RenderGraphAccess::indirectArgument,   D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT },
+	};
+
+	D3D12_RESOURCE_STATES toD3D12States(RenderGraphAccess access)
+	{
+		// present and none are both D3D12_RESOURCE_STATE_COMMON
+		D3D12_RESOURCE_STATES states = D3D12_RESOURCE_STATE_COMMON;
+		for (const auto& [accessBit, state] : ACCESS_STATES)
+		{
+			if ((access & accessBit) == accessBit) states |= state;
+		}
+		return states;
+	}
+
+	RenderGraphAccess toAccess(D3D12_RESOURCE_STATES states)
+	{
+		if (states == D3D12_RESOURCE_STATE_COMMON) return RenderGraphAccess::present;
+
+		RenderGraphAccess access = RenderGraphAccess::none;
+		for (const auto& [accessBit, state] : ACCESS_STATES)
+		{
+			if ((states & state) == state) access = access | accessBit;
+		}
+		return access;
+	}
+
+	bool isSameTexture(const TextureCreationDesc& a, const TextureCreationDesc& b)
+	{
+		const D3D12_RESOURCE_DESC& descA = a.resourceDesc;
+		const D3D12_RESOURCE_DESC& descB = b.resourceDesc;
+		return a.viewFlags == b.viewFlags && descA.Dimension == descB.Dimension && descA.Alignment == descB.Alignment && descA.Width == descB.Width &&
+			descA.Height == descB.Height && descA.DepthOrArraySize == descB.DepthOrArraySize && descA.MipLevels == descB.MipLevels && descA.Format == descB.Format &&
+			descA.SampleDesc.Count == descB.SampleDesc.Count && descA.SampleDesc.Quality == descB.SampleDesc.Quality && descA.Layout == descB.Layout && descA.Flags == descB.Flags;
+	}
+
+	bool isComputeQueueState(D3D12_RESOURCE_STATES states)
+	{
+		constexpr D3D12_RESOURCE_STATES computeStates = D3D12_RESOURCE_STATE_UNORDERED_ACCESS | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE |
+			D3D12_RESOURCE_STATE_COPY_DEST | D3D12_RESOURCE_STATE_COPY_SOURCE;
+		return (states & ~computeStates) == 0;
+	}
+
+	bool isRenderTargetOrDepth(const TextureCreationDesc& desc)
+	{
+		return (desc.viewFlags & (TextureViewFlags::rtv | TextureViewFlags::dsv)) != TextureViewFlags::none;
+	}
+}
+//=============================================================================
+RenderGraphD3D12::~RenderGraphD3D12()
+{
+	assert(m_graphicsContexts.empty() && m_computeContexts.empty());
+}
+//=============================================================================
+bool RenderGraphD3D12::Create(const RenderGraphD3D12CreateInfo& createInfo)
+{
+	if (createInfo.maxRecordingContexts == 0 || createInfo.minPassesPerContext == 0)
+	{
+		Fatal("RenderGraphD3D12: maxRecordingContexts and minPassesPerContext must not be 0");
+		return false;
+	}
+	m_createInfo = createInfo;
+	m_frameIndex = 0;
+	return true;
+}
+//=============================================================================
+void RenderGraphD3D12::Destroy()
+{
+	if (!m_graphicsContexts.empty() || !m_computeContexts.empty() || !m_heaps.empty()) WaitForIdle();
+
+	for (CachedTexture& cachedTexture : m_cachedTextures) DestroyTexture(std::move(cachedTexture.texture));
+	m_cachedTextures.clear();
+	for (std::unique_ptr<GraphicsCommandContextD3D12>& context : m_graphicsContexts) DestroyContext(std::move(context));
+	m_graphicsContexts.clear();
+	for (std::unique_ptr<ComputeCommandContextD3D12>& context : m_computeContexts) DestroyContext(std::move(context));
+	m_computeContexts.clear();
+	m_segments.clear();
+	m_heaps.clear();
+	for (auto& retiredHeaps : m_retiredHeaps) retiredHeaps.clear();
+
+	m_graph.Reset();
+	m_passes.clear();
+	m_textures.clear();
+	m_transientTextures.clear();
+}
+//=============================================================================
+void RenderGraphD3D12::BeginFrame()
+{
+	m_frameIndex++;
+	m_graph.Reset();
+	m_passes.clear();
+	m_textures.clear();
+	m_transientTextures.clear();
+	// ogRHI.BeginFrame() waited for the frame that retired them
+	m_retiredHeaps[ogRHI.GetCurrentBackBufferIndex()].clear();
+}
+//=============================================================================
+RenderGraphResource RenderGraphD3D12::ImportTexture(const char* name, TextureResource& texture, D3D12_RESOURCE_STATES finalState)
+{
+	const RenderGraphResource resource = m_graph.Import(name, toAccess(texture.state), toAccess(finalState));
+	m_textures.push_back(&texture);
+	return resource;
+}
+//=============================================================================
+RenderGraphResource RenderGraphD3D12::CreateTexture(const char* name, const TextureCreationDesc& desc)
+{
+	TransientTexture transient{ desc, GetTextureAllocationInfo(desc) };
+
+	RenderGraphTransientDesc transientDesc{};
+	transientDesc.size = transient.allocationInfo.SizeInBytes;
+	transientDesc.alignment = transient.allocationInfo.Alignment;
+	transientDesc.heapGroup = isRenderTargetOrDepth(desc) ? HEAP_GROUP_RT_DS_TEXTURES : HEAP_GROUP_OTHER_TEXTURES;
+
+	const RenderGraphResource resource = m_graph.CreateTransient(name, transientDesc);
+	m_textures.push_back(nullptr);
+	m_transientTextures.emplace(resource.index, transient);
+	return resource;
+}
+//=============================================================================
+bool RenderGraphD3D12::Execute()
+{
+	SCOPED_CPU_MARKER("RenderGraph");
+	if (!m_graph.Compile()) return false;
+	if (!preparePlacementHeaps()) return false;
+
+	for (const auto& [resourceIndex, transient] : m_transientTextures)
+	{
+		if (m_graph.GetPlacement({ resourceIndex }).firstPass == RENDER_GRAPH_INVALID_INDEX) continue; // only culled passes used it
+		m_textures[resourceIndex] = acquireTexture(resourceIndex);
+		if (!m_textures[resourceIndex]) return false;
+	}
+	buildD3D12Barriers();
+	buildSegments();
+
+	const uint32_t numSegments = static_cast<uint32_t>(m_segments.size());
+	if (thisJobSystem && numSegments > 1)
+	{
+		JobCounter counter;
+		for (uint32_t segmentIndex = 1; segmentIndex < numSegments; segmentIndex++)
+		{
+			thisJobSystem->Schedule([this, segmentIndex] { recordSegment(m_segments[segmentIndex]); }, &counter);
+		}
+		recordSegment(m_segments[0]);
+		thisJobSystem->Wait(counter);
+	}
+	else
+	{
+		for (const Segment& segment : m_segments) recordSegment(segment);
+	}
+
+	// the segments were created in pass order, everything a segment waits for is submitted before it
+	const uint64_t graphicsFenceBeforeGraph = ogRHI.graphicsQueue->GetNextFenceValue() - 1;
+	bool computeWaited = false;
+	for (Segment& segment : m_segments)
+	{
+		const bool onCompute = segment.queue == RenderGraphQueue::compute;
+		if (segment.waitForSegment != RENDER_GRAPH_INVALID_INDEX)
+		{
+			WaitOnContextWork(m_segments[segment.waitForSegment].submission, onCompute ? ContextWaitType::compute : ContextWaitType::graphics);
+			computeWaited = computeWaited || onCompute;
+		}
+		else if (onCompute && !computeWaited)
+		{
+			// the prologue is the first graphics list of the graph when there is one
+			if (m_segments[0].withPrologueBarriers) WaitOnContextWork(m_segments[0].submission, ContextWaitType::compute);
+			else ogRHI.computeQueue->InsertWaitForQueueFence(ogRHI.graphicsQueue, graphicsFenceBeforeGraph);
+			computeWaited = true;
+		}
+		segment.submission = SubmitContextWork(*segment.context);
+	}
+
+	for (uint32_t resourceIndex = 0; resourceIndex < m_textures.size(); resourceIndex++)
+	{
+		if (m_textures[resourceIndex]) m_textures[resourceIndex]->state = m_finalStates[resourceIndex];
+	}
+
+	// textures no frame asked for in a while
+	for (size_t index = 0; index < m_cachedTextures.size();)
+	{
+		if (m_cachedTextures[index].lastUsedFrame + NUM_FRAMES_IN_FLIGHT < m_frameIndex)
+		{
+			DestroyTexture(std::move(m_cachedTextures[index].texture));
+			m_cachedTextures[index] = std::move(m_cachedTextures.back());
+			m_cachedTextures.pop_back();
+		}
+		else
+		{
+			index++;
+		}
+	}
+	return true;
+}
+//=============================================================================
+bool RenderGraphD3D12::preparePlacementHeaps()
+{
+	const std::vector<uint64_t>& heapSizes = m_graph.GetHeapSizes();
+	if (m_heaps.size() < heapSizes.size()) m_heaps.resize(heapSizes.size());
+
+	for (uint32_t heapGroup = 0; heapGroup < heapSizes.size(); heapGroup++)
+	{
+		PlacementHeap& heap = m_heaps[heapGroup];
+		const uint64_t size = (heapSizes[heapGroup] + D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT - 1) / D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT * D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+		if (size <= heap.size) continue;
+
+		// the textures placed into the old heap go with it, frames in flight may still use both
+		if (heap.allocation)
+		{
+			releaseCachedTextures(heapGroup);
+			m_retiredHeaps[ogRHI.GetCurrentBackBufferIndex()].push_back(std::move(heap.allocation));
+		}
+
+		uint64_t alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+		for (const auto& [resourceIndex, transient] : m_transientTextures)
+		{
+			if (m_graph.GetPlacement({ resourceIndex }).heapGroup == heapGroup) alignment = std::max(alignment, transient.allocationInfo.Alignment);
+		}
+
+		D3D12MA::ALLOCATION_DESC allocationDesc{};
+		allocationDesc.HeapType = D3D12_HEAP_TYPE_DEFAULT;
+		allocationDesc.ExtraHeapFlags = heapGroup == HEAP_GROUP_RT_DS_TEXTURES ? D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES : D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+		const D3D12_RESOURCE_ALLOCATION_INFO allocationInfo{ size, alignment };
+
+		HRESULT result = ogRHI.allocator->AllocateMemory(&allocationDesc, &allocationInfo, &heap.allocation);
+		if (FAILED(result))
+		{
+			Fatal("D3D12MA::Allocator::AllocateMemory() failed: " + DXErrorToStr(result));
+			heap.size = 0;
+			return false;
+		}
+		heap.size = size;
+	}
+	return true;
+}
+//=============================================================================
+TextureResource* RenderGraphD3D12::acquireTexture(uint32_t resourceIndex)
+{
+	const TransientTexture& transient = m_transientTextures.at(resourceIndex);
+	const RenderGraphPlacement& placement = m_graph.GetPlacement({ resourceIndex });
+
+	for (CachedTexture& cachedTexture : m_cachedTextures)
+	{
+		if (cachedTexture.lastUsedFrame == m_frameIndex || cachedTexture.heapGroup != placement.heapGroup || cachedTexture.offset != placement.offset) continue;
+		if (!isSameTexture(cachedTexture.desc, transient.desc)) continue;
+
+		cachedTexture.lastUsedFrame = m_frameIndex;
+		return cachedTexture.texture.get();
+	}
+
+	std::unique_ptr<TextureResource> texture = ::CreateTexture(transient.desc, m_heaps[placement.heapGroup].allocation.Get(), placement.offset);
+	if (!texture) return nullptr;
+
+	CachedTexture& cachedTexture = m_cachedTextures.emplace_back();
+	cachedTexture.desc = transient.desc;
+	cachedTexture.heapGroup = placement.heapGroup;
+	cachedTexture.offset = placement.offset;
+	cachedTexture.texture = std::move(texture);
+	cachedTexture.lastUsedFrame = m_frameIndex;
+	return cachedTexture.texture.get();
+}
+//=============================================================================
+void RenderGraphD3D12::releaseCachedTextures(uint32_t heapGroup)
+{
+	for (CachedTexture& cachedTexture : m_cachedTextures)
+	{
+		if (cachedTexture.heapGroup == heapGroup) DestroyTexture(std::move(cachedTexture.texture));
+	}
+	std::erase_if(m_cachedTextures, [heapGroup](const CachedTexture& cachedTexture) { return cachedTexture.heapGroup == heapGroup; });
+}
+//=============================================================================
+void RenderGraphD3D12::buildD3D12Barriers()
+{
+	const std::vector<RenderGraphCompiledPass>& compiledPasses = m_graph.GetCompiledPasses();
+	const std::vector<RenderGraphBarrier>& barriers = m_graph.GetBarriers();
+	const uint32_t numPasses = static_cast<uint32_t>(compiledPasses.size());
+
+	m_d3d12Barriers.clear();
+	m_barrierBatchOffsets.clear();
+	m_prologueBarriers.clear();
+	m_passDiscards.resize(numPasses);
+	for (std::vector<TextureResource*>& discards : m_passDiscards) discards.clear();
+
+	// the cached transient textures are in whatever state the last frame left them
+	std::vector<D3D12_RESOURCE_STATES>& states = m_finalStates;
+	states.assign(m_textures.size(), D3D12_RESOURCE_STATE_COMMON);
+	for (uint32_t resourceIndex = 0; resourceIndex < m_textures.size(); resourceIndex++)
+	{
+		if (m_textures[resourceIndex]) states[resourceIndex] = m_textures[resourceIndex]->state;
+	}
+
+	std::vector<D3D12_RESOURCE_BARRIER> aliasingBarriers;
+	std::vector<D3D12_RESOURCE_BARRIER> otherBarriers;
+	std::vector<uint32_t> aliasedResources;
+	// before and after every pass in the order of the graph, the waits keep the queues in that order where it matters
+	for (uint32_t batchIndex = 0; batchIndex <= numPasses * 2; batchIndex++)
+	{
+		const uint32_t compiledIndex = batchIndex / 2;
+		uint32_t firstBarrier = m_graph.GetFirstFinalBarrier();
+		uint32_t endBarrier = static_cast<uint32_t>(barriers.size());
+		bool onCompute = false;
+		if (compiledIndex < numPasses)
+		{
+			const RenderGraphCompiledPass& compiledPass = compiledPasses[compiledIndex];
+			const bool isRelease = batchIndex % 2 == 1;
+			onCompute = compiledPass.queue == RenderGraphQueue::compute;
+			firstBarrier = isRelease ? compiledPass.firstReleaseBarrier : compiledPass.firstBarrier;
+			endBarrier = firstBarrier + (isRelease ? compiledPass.numReleaseBarriers : compiledPass.numBarriers);
+		}
+
+		aliasingBarriers.clear();
+		otherBarriers.clear();
+		aliasedResources.clear();
+		for (uint32_t barrierIndex = firstBarrier; barrierIndex < endBarrier; barrierIndex++)
+		{
+			const RenderGraphBarrier& barrier = barriers[barrierIndex];
+			TextureResource& texture = *m_textures[barrier.resource.index];
+			D3D12_RESOURCE_BARRIER& d3d12Barrier = barrier.type == RenderGraphBarrierType::aliasing ? aliasingBarriers.emplace_back() : otherBarriers.emplace_back();
+
+			switch (barrier.type)
+			{
+			case RenderGraphBarrierType::aliasing:
+				d3d12Barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_ALIASING;
+				d3d12Barrier.Aliasing.pResourceBefore = barrier.aliasedResource.IsValid() ? m_textures[barrier.aliasedResource.index]->resource.Get() : nullptr;
+				d3d12Barrier.Aliasing.pResourceAfter = texture.resource.Get();
+				aliasedResources.push_back(barrier.resource.index);
+				break;
+			case RenderGraphBarrierType::unorderedAccess:
+				d3d12Barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+				d3d12Barrier.UAV.pResource = texture.resource.Get();
+				break;
+			case RenderGraphBarrierType::transition:
+			{
+				const D3D12_RESOURCE_STATES after = toD3D12States(barrier.after);
+				if (barrier.before == RenderGraphAccess::none)
+				{
+					// first use of a transient: the memory may have held another texture in an earlier frame
+					if (std::find(aliasedResources.begin(), aliasedResources.end(), barrier.resource.index) == aliasedResources.end())
+					{
+						D3D12_RESOURCE_BARRIER& aliasingBarrier = aliasingBarriers.emplace_back();
+						aliasingBarrier.Type = D3D12_RESOURCE_BARRIER_TYPE_ALIASING;
+						aliasingBarrier.Aliasing.pResourceBefore = nullptr;
+						aliasingBarrier.Aliasing.pResourceAfter = texture.resource.Get();
+					}
+					if (after == D3D12_RESOURCE_STATE_RENDER_TARGET || after == D3D12_RESOURCE_STATE_DEPTH_WRITE) m_passDiscards[compiledIndex].push_back(&texture);
+
+					if (onCompute && !isComputeQueueState(states[barrier.resource.index]))
+					{
+						D3D12_RESOURCE_BARRIER& prologueBarrier = m_prologueBarriers.emplace_back();
+						prologueBarrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+						prologueBarrier.Transition.pResource = texture.resource.Get();
+						prologueBarrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+						prologueBarrier.Transition.StateBefore = states[barrier.resource.index];
+						prologueBarrier.Transition.StateAfter = D3D12_RESOURCE_STATE_COMMON;
+						states[barrier.resource.index] = D3D12_RESOURCE_STATE_COMMON;
+					}
+				}
+
+				if (states[barrier.resource.index] == after)
+				{
+					otherBarriers.pop_back();
+					break;
+				}
+				d3d12Barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+				d3d12Barrier.Transition.pResource = texture.resource.Get();
+				d3d12Barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+				d3d12Barrier.Transition.StateBefore = states[barrier.resource.index];
+				d3d12Barrier.Transition.StateAfter = after;
+				states[barrier.resource.index] = after;
+				break;
+			}
+			}
+		}
+
+		m_barrierBatchOffsets.push_back(static_cast<uint32_t>(m_d3d12Barriers.size()));
+		m_d3d12Barriers.insert(m_d3d12Barriers.end(), aliasingBarriers.begin(), aliasingBarriers.end());
+		m_d3d12Barriers.insert(m_d3d12Barriers.end(), otherBarriers.begin(), otherBarriers.end());
+	}
+	m_barrierBatchOffsets.push_back(static_cast<uint32_t>(m_d3d12Barriers.size()));
+}
+//=============================================================================
+void RenderGraphD3D12::buildSegments()
+{
+	const std::vector<RenderGraphCompiledPass>& compiledPasses = m_graph.GetCompiledPasses();
+	const uint32_t numPasses = static_cast<uint32_t>(compiledPasses.size());
+	const uint32_t finalWaitForPass = m_graph.GetFinalWaitForPass();
+
+	// a pass the other queue waits for ends its segment, the wait is for the fence signaled after the command list
+	std::vector<bool> signalAfter(numPasses, false);
+	for (const RenderGraphCompiledPass& compiledPass : compiledPasses)
+	{
+		if (compiledPass.waitForPass != RENDER_GRAPH_INVALID_INDEX) signalAfter[compiledPass.waitForPass] = true;
+	}
+	if (finalWaitForPass != RENDER_GRAPH_INVALID_INDEX) signalAfter[finalWaitForPass] = true;
+
+	const uint32_t passesPerSegment = std::max(m_createInfo.minPassesPerContext, (numPasses + m_createInfo.maxRecordingContexts - 1) / m_createInfo.maxRecordingContexts);
+	std::vector<uint32_t> segmentOfPass(numPasses, RENDER_GRAPH_INVALID_INDEX);
+	uint32_t openSegment[2] = { RENDER_GRAPH_INVALID_INDEX, RENDER_GRAPH_INVALID_INDEX }; // per queue
+
+	m_segments.clear();
+	if (!m_prologueBarriers.empty()) m_segments.emplace_back().withPrologueBarriers = true;
+	for (uint32_t compiledIndex = 0; compiledIndex < numPasses; compiledIndex++)
+	{
+		const RenderGraphCompiledPass& compiledPass = compiledPasses[compiledIndex];
+		uint32_t& segmentIndex = openSegment[static_cast<size_t>(compiledPass.queue)];
+		if (segmentIndex == RENDER_GRAPH_INVALID_INDEX || compiledPass.waitForPass != RENDER_GRAPH_INVALID_INDEX || m_segments[segmentIndex].passes.size() >= passesPerSegment)
+		{
+			segmentIndex = static_cast<uint32_t>(m_segments.size());
+			Segment& segment = m_segments.emplace_back();
+			segment.queue = compiledPass.queue;
+			if (compiledPass.waitForPass != RENDER_GRAPH_INVALID_INDEX) segment.waitForSegment = segmentOfPass[compiledPass.waitForPass];
+		}
+		m_segments[segmentIndex].passes.push_back(compiledIndex);
+		segmentOfPass[compiledIndex] = segmentIndex;
+		if (signalAfter[compiledIndex]) segmentIndex = RENDER_GRAPH_INVALID_INDEX;
+	}
+
+	// the final barriers go behind the last graphics pass, after the compute queue is done
+	const uint32_t lastGraphicsSegment = openSegment[static_cast<size_t>(RenderGraphQueue::graphics)];
+	if (finalWaitForPass == RENDER_GRAPH_INVALID_INDEX && lastGraphicsSegment != RENDER_GRAPH_INVALID_INDEX)
+	{
+		m_segments[lastGraphicsSegment].withFinalBarriers = true;
+	}
+	else
+	{
+		Segment& segment = m_segments.emplace_back();
+		segment.withFinalBarriers = true;
+		if (finalWaitForPass != RENDER_GRAPH_INVALID_INDEX) segment.waitForSegment = segmentOfPass[finalWaitForPass];
+	}
+
+	uint32_t numContexts[2] = { 0, 0 };
+	for (Segment& segment : m_segments)
+	{
+		if (segment.queue == RenderGraphQueue::compute)
+		{
+			if (m_computeContexts.size() <= numContexts[1]) m_computeContexts.push_back(CreateComputeContext());
+			segment.context = m_computeContexts[numContexts[1]++].get();
+		}
+		else
+		{
+			if (m_graphicsContexts.size() <= numContexts[0]) m_graphicsContexts.push_back(CreateGraphicsContext());
+			segment.context = m_graphicsContexts[numContexts[0]++].get();
+		}
+	}
+}
+//=============================================================================
+void RenderGraphD3D12::recordSegment(const Segment& segment)
+{
+	CommandContextD3D12& context = *segment.context;
+	context.Reset(false);
+	ID3D12GraphicsCommandList* commandList = context.GetCommandList().Get();
+
+	const auto issueBarriers = [this, commandList](uint32_t batchIndex)
+	{
+		const uint32_t numBarriers = m_barrierBatchOffsets[batchIndex + 1] - m_barrierBatchOffsets[batchIndex];
+		if (numBarriers > 0) commandList->ResourceBarrier(numBarriers, &m_d3d12Barriers[m_barrierBatchOffsets[batchIndex]]);
+	};
+
+	const std::vector<RenderGraphCompiledPass>& compiledPasses = m_graph.GetCompiledPasses();
+	for (uint32_t compiledIndex : segment.passes)
+	{
+		issueBarriers(compiledIndex * 2);
+		// aliased render targets have undefined contents, the pass has to overwrite them
+		for (TextureResource* texture : m_passDiscards[compiledIndex]) commandList->DiscardResource(texture->resource.Get(), nullptr);
+
+		const uint32_t passIndex = compiledPasses[compiledIndex].pass;
+		const PassRecord& pass = m_passes[passIndex];
+		{
+			ScopedGPUMarker marker(commandList, pass.label ? pass.label : m_graph.GetPassName(passIndex).c_str());
+			if (segment.queue == RenderGraphQueue::compute) pass.executeCompute(static_cast<ComputeCommandContextD3D12&>(context));
+			else pass.execute(static_cast<GraphicsCommandContextD3D12&>(context));
+		}
+		issueBarriers(compiledIndex * 2 + 1);
+	}
+
+	if (segment.withPrologueBarriers) commandList->ResourceBarrier(static_cast<UINT>(m_prologueBarriers.size()), m_prologueBarriers.data());
+	if (segment.withFinalBarriers) issueBarriers(static_cast<uint32_t>(compiledPasses.size()) * 2);
+}
+//=============================================================================
+#endif // RENDER_D3D12
@@ -0,0 +1,159 @@
+﻿#pragma once
+
+#if RENDER_D3D12
+
+#include <functional>
+#include "RenderGraph.h"
+#include "Profiler.h"
+#include "oCommandContextD3D12.h"
+
+// Executes a RenderGraph on the graphics and compute queues of ogRHI. Transient textures are placed into one heap per heap
+// group and reused across frames while their description and placement stay the same. The surviving passes of each queue are
+// split into segments at the waits of the graph and into groups of about numPasses / maxRecordingContexts, every segment is
+// recorded into its own command list as a job when a JobSystem exists, and the lists are submitted in pass order. A segment
+// that has to wait for the other queue gets WaitOnContextWork() on the list holding that pass. The compute queue also waits
+// for the graphics work submitted before the graph, transient memory may be reused from the previous frame. A cached texture
+// that an earlier frame left in a graphics state goes back to the common state in a graphics list ahead of everything else.
+//
+// Per frame: ogRHI.BeginFrame(), the first Reset() of ogRHI.graphicsContext (it resets the descriptor heap of the frame),
+// BeginFrame(), the ImportTexture()/CreateTexture()/AddPass() calls, Execute().
+
+struct RenderGraphD3D12CreateInfo final
+{
+	uint32_t maxRecordingContexts{ 4 }; // command lists recorded in parallel, the queue switches of the graph may add more
+	uint32_t minPassesPerContext{ 4 };  // fewer passes are not worth a command list of their own
+};
+
+class RenderGraphD3D12 final
+{
+public:
+	using ExecuteFunction = std::function<void(GraphicsCommandContextD3D12& context)>;
+	using ComputeExecuteFunction = std::function<void(ComputeCommandContextD3D12& context)>;
+
+	~RenderGraphD3D12();
+
+	[[nodiscard]] bool Create(const RenderGraphD3D12CreateInfo& createInfo);
+	void Destroy();
+
+	// Starts describing a new frame, the resources of the previous one are no longer valid
+	void BeginFrame();
+
+	// texture.state is its state when the graph starts
+	RenderGraphResource ImportTexture(const char* name, TextureResource& texture, D3D12_RESOURCE_STATES finalState);
+	RenderGraphResource CreateTexture(const char* name, const TextureCreationDesc& desc);
+
+	// setup(RenderGraphPassBuilder&) declares the accesses right away, execute runs during Execute() unless the pass is culled,
+	// possibly on another thread and at the same time as other passes
+	template<typename Setup>
+	void AddPass(const char* name, Setup&& setup, ExecuteFunction execute);
+	// The same on the compute queue, the pass may only use RENDER_GRAPH_COMPUTE_QUEUE_ACCESS
+	template<typename Setup>
+	void AddAsyncComputePass(const char* name, Setup&& setup, ComputeExecuteFunction execute);
+
+	// Compiles the graph, records the passes and submits them
+	[[nodiscard]] bool Execute();
+
+	// Valid in the execute functions
+	[[nodiscard]] TextureResource& GetTexture(RenderGraphResource resource) { return *m_textures[resource.index]; }
+
+	[[nodiscard]] const RenderGraph& GetGraph() const { return m_graph; }
+
+private:
+	struct TransientTexture final
+	{
+		TextureCreationDesc              desc;
+		D3D12_RESOURCE_ALLOCATION_INFO   allocationInfo{};
+	};
+
+	struct CachedTexture final
+	{
+		TextureCreationDesc              desc;
+		uint32_t                         heapGroup{ 0 };
+		uint64_t                         offset{ 0 };
+		std::unique_ptr<TextureResource> texture;
+		uint64_t                         lastUsedFrame{ 0 };
+	};
+
+	struct PlacementHeap final
+	{
+		ComPtr<D3D12MA::Allocation>      allocation;
+		uint64_t                         size{ 0 };
+	};
+
+	struct PassRecord final
+	{
+		const char*                      label{ nullptr }; // interned for the GPU profiler, the graph keeps the name otherwise
+		ExecuteFunction                  execute;
+		ComputeExecuteFunction           executeCompute;
+	};
+
+	// passes of one queue recorded into one command list
+	struct Segment final
+	{
+		RenderGraphQueue                 queue{ RenderGraphQueue::graphics };
+		std::vector<uint32_t>            passes;            // compiled pass indices
+		uint32_t                         waitForSegment{ RENDER_GRAPH_INVALID_INDEX };
+		bool                             withPrologueBarriers{ false };
+		bool                             withFinalBarriers{ false };
+		CommandContextD3D12*             context{ nullptr };
+		ContextSubmissionResult          submission{};
+	};
+
+	[[nodiscard]] bool preparePlacementHeaps();
+	[[nodiscard]] TextureResource* acquireTexture(uint32_t resourceIndex);
+	void releaseCachedTextures(uint32_t heapGroup);
+	void buildD3D12Barriers();
+	void buildSegments();
+	void recordSegment(const Segment& segment);
+	template<typename Setup>
+	PassRecord& addPass(const char* name, bool asyncCompute, Setup&& setup);
+
+	RenderGraphD3D12CreateInfo                                m_createInfo{};
+	RenderGraph                                               m_graph;
+	std::vector<PassRecord>                                   m_passes;
+	std::vector<TextureResource*>                             m_textures;          // per graph resource
+	std::unordered_map<uint32_t, TransientTexture>            m_transientTextures; // by graph resource
+	std::vector<D3D12_RESOURCE_STATES>                        m_finalStates;       // per graph resource, after the frame
+	std::vector<D3D12_RESOURCE_BARRIER>                       m_d3d12Barriers;
+	std::vector<uint32_t>                                     m_barrierBatchOffsets; // before and after every compiled pass, the final barriers, one past the last
+	std::vector<D3D12_RESOURCE_BARRIER>                       m_prologueBarriers;  // graphics states of the first compute uses
+	std::vector<std::vector<TextureResource*>>                m_passDiscards;      // aliased render targets to initialize, per compiled pass
+
+	std::vector<PlacementHeap>                                m_heaps;
+	std::array<std::vector<ComPtr<D3D12MA::Allocation>>, NUM_FRAMES_IN_FLIGHT> m_retiredHeaps;
+	std::vector<CachedTexture>                                m_cachedTextures;
+	std::vector<Segment>                                      m_segments;
+	std::vector<std::unique_ptr<GraphicsCommandContextD3D12>> m_graphicsContexts;
+	std::vector<std::unique_ptr<ComputeCommandContextD3D12>>  m_computeContexts;
+	uint64_t                                                  m_frameIndex{ 0 };
+};
+
+//=============================================================================
+template<typename Setup>
+inline void RenderGraphD3D12::AddPass(const char* name, Setup&& setup, ExecuteFunction execute)
+{
+	addPass(name, false, std::forward<Setup>(setup)).execute = std::move(execute);
+}
+//=============================================================================
+template<typename Setup>
+inline void RenderGraphD3D12::AddAsyncComputePass(const char* name, Setup&& setup, ComputeExecuteFunction execute)
+{
+	addPass(name, true, std::forward<Setup>(setup)).executeCompute = std::move(execute);
+}
+//=============================================================================
+template<typename Setup>
+inline RenderGraphD3D12::PassRecord& RenderGraphD3D12::addPass(const char* name, bool asyncCompute, Setup&& setup)
+{
+	RenderGraphPassBuilder builder = m_graph.AddPass(name);
+	if (asyncCompute) builder.SetAsyncCompute();
+	setup(builder);
+
+	PassRecord& pass = m_passes.emplace_back();
+#if ENABLE_PROFILER
+	pass.label = ProfilerInternName(name);
+#endif
+	return pass;
+}
+//=============================================================================
+
+#endif // RENDER_D3D12
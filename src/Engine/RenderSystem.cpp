@@ -1,5 +1,6 @@
 ﻿#include "stdafx.h"
 #include "RenderSystem.h"
+#include "oRHIBackendD3D12.h"
 //=============================================================================
 RenderSystem::~RenderSystem()
 {
@@ -21,6 +22,13 @@ void RenderSystem::Resize(uint32_t width, uint32_t height)
 	gRHI.ResizeFrameBuffer(width, height);
 }
 //=============================================================================
+void RenderSystem::WaitForFrameLatency()
+{
+	// Only the swap chain that presents signals its latency object, the one of the other backend would run into the timeout
+	if (ogRHI.IsCreated()) ogRHI.WaitForFrameLatency();
+	else gRHI.WaitForFrameLatency();
+}
+//=============================================================================
 void RenderSystem::BeginFrame()
 {
 	gRHI.BeginFrame();
@@ -17,6 +17,7 @@ public:
 	void Destroy();
 
 	void Resize(uint32_t width, uint32_t height);
+	void WaitForFrameLatency();
 	void BeginFrame();
 	void EndFrame();
 
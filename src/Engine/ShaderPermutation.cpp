@@ -0,0 +1,221 @@
+﻿#include "stdafx.h"
+#if RENDER_D3D12
+#include "ShaderPermutation.h"
+#include "oRHIBackendD3D12.h"
+#include "Log.h"
+#include "StringUtils.h"
+#include <fstream>
+#include <sstream>
+//=============================================================================
+bool ShaderPermutationSet::Create(const ShaderCreationDesc& baseDesc, const std::vector<ShaderFeatureDesc>& features)
+{
+	m_baseDesc = baseDesc;
+	m_features = features;
+	m_keyMask = 0;
+
+	for (const ShaderFeatureDesc& feature : m_features)
+	{
+		if (m_keyMask & feature.field.Mask())
+		{
+			Fatal("Shader feature " + std::string(feature.define.begin(), feature.define.end()) + " overlaps another feature of the permutation key");
+			return false;
+		}
+		m_keyMask |= feature.field.Mask();
+	}
+
+	return true;
+}
+//=============================================================================
+void ShaderPermutationSet::Destroy()
+{
+	for (auto& [key, shader] : m_variants)
+	{
+		DestroyShader(std::move(shader));
+	}
+	m_variants.clear();
+	m_features.clear();
+	m_keyMask = 0;
+}
+//=============================================================================
+Shader* ShaderPermutationSet::GetVariant(uint64_t key)
+{
+	if (key & ~m_keyMask)
+	{
+		Warning("Permutation key uses bits that are not declared as shader features, they are ignored");
+		key &= m_keyMask;
+	}
+
+	auto it = m_variants.find(key);
+	if (it != m_variants.end())
+	{
+		return it->second.get();
+	}
+
+	std::unique_ptr<Shader> shader = CreateShader(MakeVariantDesc(key));
+	if (!shader)
+	{
+		return nullptr;
+	}
+
+	return m_variants.emplace(key, std::move(shader)).first->second.get();
+}
+//=============================================================================
+ShaderCreationDesc ShaderPermutationSet::MakeVariantDesc(uint64_t key) const
+{
+	ShaderCreationDesc desc = m_baseDesc;
+
+	// All features are always defined, so the shader can use #if FEATURE without #ifdef
+	for (const ShaderFeatureDesc& feature : m_features)
+	{
+		desc.defines.push_back({ feature.define, std::to_wstring(GetShaderFeature(key, feature.field)) });
+	}
+
+	wchar_t keyName[17]{};
+	swprintf_s(keyName, L"%016llX", key);
+	desc.variantName = keyName;
+
+	return desc;
+}
+//=============================================================================
+void ShaderPermutationLibrary::Destroy()
+{
+	for (auto& [name, set] : m_sets)
+	{
+		set->Destroy();
+	}
+	m_sets.clear();
+	m_usedVariants.clear();
+	m_unknownUsage.clear();
+}
+//=============================================================================
+ShaderPermutationSet* ShaderPermutationLibrary::Register(const ShaderCreationDesc& baseDesc, const std::vector<ShaderFeatureDesc>& features)
+{
+	const std::wstring setName = makeSetName(baseDesc);
+	auto it = m_sets.find(setName);
+	if (it != m_sets.end())
+	{
+		return it->second.get();
+	}
+
+	auto set = std::make_unique<ShaderPermutationSet>();
+	if (!set->Create(baseDesc, features))
+	{
+		return nullptr;
+	}
+
+	return m_sets.emplace(setName, std::move(set)).first->second.get();
+}
+//=============================================================================
+Shader* ShaderPermutationLibrary::GetVariant(ShaderPermutationSet* set, uint64_t key)
+{
+	assert(set);
+	key &= set->GetKeyMask();
+
+	const bool wasCompiled = set->IsVariantCompiled(key);
+	Shader* shader = set->GetVariant(key);
+
+	// a variant that failed to compile is not listed, the next run would fail on it again before it is even requested
+	if (shader && !wasCompiled)
+	{
+		std::vector<uint64_t>& usedKeys = m_usedVariants[makeSetName(set->GetBaseDesc())];
+		if (std::find(usedKeys.begin(), usedKeys.end(), key) == usedKeys.end())
+		{
+			usedKeys.push_back(key);
+		}
+	}
+
+	return shader;
+}
+//=============================================================================
+bool ShaderPermutationLibrary::SaveUsageList(const std::string& path) const
+{
+	std::ofstream file(path, std::ios::trunc);
+	if (!file)
+	{
+		Error("Failed to open shader usage list " + path);
+		return false;
+	}
+
+	for (const auto& [setName, keys] : m_usedVariants)
+	{
+		const ShaderPermutationSet& set = *m_sets.at(setName);
+		for (uint64_t key : keys)
+		{
+			file << makeUsageLine(set, key) << "\n";
+		}
+	}
+	for (const std::string& line : m_unknownUsage)
+	{
+		file << line << "\n";
+	}
+
+	return file.good();
+}
+//=============================================================================
+bool ShaderPermutationLibrary::Prewarm(const std::string& path)
+{
+	std::ifstream file(path);
+	if (!file)
+	{
+		// a missing list is normal on the first run
+		return true;
+	}
+
+	std::string line;
+	while (std::getline(file, line))
+	{
+		std::istringstream lineStream(line);
+		std::string shaderName;
+		std::string entryPoint;
+		uint64_t key = 0;
+		if (!(lineStream >> shaderName >> entryPoint >> std::hex >> key))
+		{
+			continue;
+		}
+
+		const std::wstring setName = ASCIIToUnicode(shaderName + " " + entryPoint);
+		auto it = m_sets.find(setName);
+		if (it == m_sets.end())
+		{
+			if (std::find(m_unknownUsage.begin(), m_unknownUsage.end(), line) == m_unknownUsage.end())
+			{
+				m_unknownUsage.push_back(line);
+			}
+			continue;
+		}
+
+		if (!GetVariant(it->second.get(), key))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+//=============================================================================
+std::wstring ShaderPermutationLibrary::makeSetName(const ShaderCreationDesc& desc)
+{
+	return desc.shaderName + L" " + desc.entryPoint;
+}
+//=============================================================================
+std::string ShaderPermutationLibrary::makeUsageLine(const ShaderPermutationSet& set, uint64_t key)
+{
+	// the Cooker parses these lines, see ParseShaderUsageList()
+	static const char* stages[] = { "vs", "ps", "cs" };
+
+	const ShaderCreationDesc desc = set.MakeVariantDesc(key);
+	const std::wstring setName = makeSetName(desc);
+	std::ostringstream line;
+	line << std::string(setName.begin(), setName.end()) << " " << std::hex << key << std::dec << " " << stages[static_cast<size_t>(desc.type)];
+	for (const ShaderDefine& define : desc.defines)
+	{
+		line << " " << std::string(define.name.begin(), define.name.end());
+		if (!define.value.empty())
+		{
+			line << "=" << std::string(define.value.begin(), define.value.end());
+		}
+	}
+	return line.str();
+}
+//=============================================================================
+#endif // RENDER_D3D12
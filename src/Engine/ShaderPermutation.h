@@ -0,0 +1,96 @@
+﻿#pragma once
+
+#if RENDER_D3D12
+
+#include "oRenderCoreD3D12.h"
+#include "AssetPack.h"
+
+// A feature occupies numBits bits of the 64-bit permutation key starting at offset. Fields are declared as constexpr, for example:
+//	constexpr ShaderFeatureField MESH_ALPHA_TEST = MakeShaderFeatureField(0, 1);
+//	constexpr ShaderFeatureField MESH_NUM_LIGHTS = MESH_ALPHA_TEST.Next(2);
+//	constexpr uint64_t key = SetShaderFeature(SetShaderFeature(0, MESH_ALPHA_TEST, 1), MESH_NUM_LIGHTS, 3);
+struct ShaderFeatureField final
+{
+	uint8_t offset{ 0 };
+	uint8_t numBits{ 1 };
+
+	constexpr uint64_t Mask() const { return (numBits >= 64 ? ~0ull : ((1ull << numBits) - 1)) << offset; }
+	constexpr uint64_t MaxValue() const { return Mask() >> offset; }
+	constexpr ShaderFeatureField Next(uint8_t bits = 1) const;
+};
+
+constexpr ShaderFeatureField MakeShaderFeatureField(uint32_t offset, uint32_t numBits)
+{
+	// throwing in a constant expression is a compile error, so an overflowing constexpr declaration does not compile
+	if (numBits == 0 || offset + numBits > 64) throw "Shader feature field does not fit into the 64-bit permutation key";
+	return ShaderFeatureField{ static_cast<uint8_t>(offset), static_cast<uint8_t>(numBits) };
+}
+
+constexpr ShaderFeatureField ShaderFeatureField::Next(uint8_t bits) const
+{
+	return MakeShaderFeatureField(offset + numBits, bits);
+}
+
+constexpr uint64_t SetShaderFeature(uint64_t key, ShaderFeatureField field, uint64_t value)
+{
+	return (key & ~field.Mask()) | ((value << field.offset) & field.Mask());
+}
+
+constexpr uint64_t GetShaderFeature(uint64_t key, ShaderFeatureField field)
+{
+	return (key & field.Mask()) >> field.offset;
+}
+
+struct ShaderFeatureDesc final
+{
+	std::wstring       define; // the value of the field is passed as define=value
+	ShaderFeatureField field;
+};
+
+// All permutations of one shader entry point. Variants are compiled on first use and kept until Destroy().
+class ShaderPermutationSet final
+{
+public:
+	[[nodiscard]] bool Create(const ShaderCreationDesc& baseDesc, const std::vector<ShaderFeatureDesc>& features);
+	void Destroy();
+
+	Shader* GetVariant(uint64_t key);
+	bool IsVariantCompiled(uint64_t key) const { return m_variants.find(key) != m_variants.end(); }
+	size_t GetNumCompiledVariants() const { return m_variants.size(); }
+
+	const ShaderCreationDesc& GetBaseDesc() const { return m_baseDesc; }
+	uint64_t GetKeyMask() const { return m_keyMask; }
+	ShaderCreationDesc MakeVariantDesc(uint64_t key) const;
+
+private:
+	ShaderCreationDesc                                     m_baseDesc;
+	std::vector<ShaderFeatureDesc>                         m_features;
+	uint64_t                                               m_keyMask{ 0 };
+	std::unordered_map<uint64_t, std::unique_ptr<Shader>> m_variants;
+};
+
+// Owns the permutation sets of the application and records which variants were compiled, so that a later run can load them up front.
+// The usage list is a text file with one "shaderName entryPoint hexKey stage [DEFINE[=value] ...]" line per variant. The Cooker reads it
+// and cooks the listed variants into the asset pack, CreateShader() then loads their DXIL from the pack instead of compiling it.
+class ShaderPermutationLibrary final
+{
+public:
+	void Destroy();
+
+	ShaderPermutationSet* Register(const ShaderCreationDesc& baseDesc, const std::vector<ShaderFeatureDesc>& features);
+	Shader* GetVariant(ShaderPermutationSet* set, uint64_t key);
+
+	[[nodiscard]] bool SaveUsageList(const std::string& path = SHADER_USAGE_LIST_PATH) const;
+	// Creates all variants of registered sets listed in the file. Lines of unknown shaders are kept, so that saving does not lose them.
+	[[nodiscard]] bool Prewarm(const std::string& path = SHADER_USAGE_LIST_PATH);
+
+private:
+	static std::wstring makeSetName(const ShaderCreationDesc& desc);
+	static std::string makeUsageLine(const ShaderPermutationSet& set, uint64_t key);
+
+	std::unordered_map<std::wstring, std::unique_ptr<ShaderPermutationSet>> m_sets;
+	std::unordered_map<std::wstring, std::vector<uint64_t>>                m_usedVariants; // per set name, in order of first use
+	std::vector<std::string>                                               m_unknownUsage; // usage lines of sets that were not registered
+};
+
+#endif // RENDER_D3D12
@@ -0,0 +1,55 @@
+﻿#include "stdafx.h"
+#include "SubmeshTable.h"
+#include "Log.h"
+//=============================================================================
+void SubmeshTable::Reserve(uint32_t numSubmeshes)
+{
+	m_indexCounts.reserve(numSubmeshes);
+	m_startIndexLocations.reserve(numSubmeshes);
+	m_baseVertexLocations.reserve(numSubmeshes);
+	m_boundsCenters.reserve(numSubmeshes);
+	m_boundsExtents.reserve(numSubmeshes);
+}
+//=============================================================================
+void SubmeshTable::Clear()
+{
+	m_indexCounts.clear();
+	m_startIndexLocations.clear();
+	m_baseVertexLocations.clear();
+	m_boundsCenters.clear();
+	m_boundsExtents.clear();
+}
+//=============================================================================
+SubmeshId SubmeshTable::Add(uint32_t indexCount, uint32_t startIndexLocation, int32_t baseVertexLocation, const glm::vec3& boundsCenter, const glm::vec3& boundsExtents)
+{
+	const SubmeshId id{ GetCount() };
+	m_indexCounts.push_back(indexCount);
+	m_startIndexLocations.push_back(startIndexLocation);
+	m_baseVertexLocations.push_back(baseVertexLocation);
+	m_boundsCenters.push_back(boundsCenter);
+	m_boundsExtents.push_back(boundsExtents);
+	return id;
+}
+//=============================================================================
+void SubmeshNameIndex::Clear()
+{
+	m_ids.clear();
+}
+//=============================================================================
+bool SubmeshNameIndex::Add(std::string_view name, SubmeshId id)
+{
+	assert(id.IsValid());
+	if (!m_ids.emplace(name, id).second)
+	{
+		Error("SubmeshNameIndex: the submesh name '" + std::string(name) + "' is used twice");
+		return false;
+	}
+	return true;
+}
+//=============================================================================
+SubmeshId SubmeshNameIndex::Find(std::string_view name) const
+{
+	const auto it = m_ids.find(name);
+	return it != m_ids.end() ? it->second : SubmeshId{};
+}
+//=============================================================================
@@ -0,0 +1,68 @@
+﻿#pragma once
+
+#include <span>
+
+// Submeshes of a mesh as parallel arrays addressed by SubmeshId. Draw and culling loops walk the array they need and touch no
+// strings. Names are for loading only: SubmeshNameIndex maps them to ids once, the ids are kept for drawing.
+
+constexpr uint32_t INVALID_SUBMESH_INDEX = UINT32_MAX;
+
+struct SubmeshId final
+{
+	[[nodiscard]] bool IsValid() const { return index != INVALID_SUBMESH_INDEX; }
+	bool operator==(const SubmeshId&) const = default;
+
+	uint32_t index{ INVALID_SUBMESH_INDEX };
+};
+
+class SubmeshTable final
+{
+public:
+	void Reserve(uint32_t numSubmeshes);
+	void Clear();
+
+	SubmeshId Add(uint32_t indexCount, uint32_t startIndexLocation, int32_t baseVertexLocation, const glm::vec3& boundsCenter, const glm::vec3& boundsExtents);
+
+	[[nodiscard]] uint32_t GetCount() const { return static_cast<uint32_t>(m_indexCounts.size()); }
+
+	[[nodiscard]] uint32_t GetIndexCount(SubmeshId id) const { return m_indexCounts[id.index]; }
+	[[nodiscard]] uint32_t GetStartIndexLocation(SubmeshId id) const { return m_startIndexLocations[id.index]; }
+	[[nodiscard]] int32_t GetBaseVertexLocation(SubmeshId id) const { return m_baseVertexLocations[id.index]; }
+	[[nodiscard]] const glm::vec3& GetBoundsCenter(SubmeshId id) const { return m_boundsCenters[id.index]; }
+	[[nodiscard]] const glm::vec3& GetBoundsExtents(SubmeshId id) const { return m_boundsExtents[id.index]; }
+
+	// One element per submesh, indexed by SubmeshId::index
+	[[nodiscard]] std::span<const uint32_t> GetIndexCounts() const { return m_indexCounts; }
+	[[nodiscard]] std::span<const uint32_t> GetStartIndexLocations() const { return m_startIndexLocations; }
+	[[nodiscard]] std::span<const int32_t> GetBaseVertexLocations() const { return m_baseVertexLocations; }
+	[[nodiscard]] std::span<const glm::vec3> GetBoundsCenters() const { return m_boundsCenters; }
+	[[nodiscard]] std::span<const glm::vec3> GetBoundsExtents() const { return m_boundsExtents; }
+
+private:
+	std::vector<uint32_t>  m_indexCounts;
+	std::vector<uint32_t>  m_startIndexLocations;
+	std::vector<int32_t>   m_baseVertexLocations;
+	std::vector<glm::vec3> m_boundsCenters;
+	std::vector<glm::vec3> m_boundsExtents;
+};
+
+// Load-time name lookup, e.g. for the submesh names of an asset
+class SubmeshNameIndex final
+{
+public:
+	void Clear();
+
+	// Returns false and reports an Error() when the name is taken
+	[[nodiscard]] bool Add(std::string_view name, SubmeshId id);
+	// Invalid when the name is unknown
+	[[nodiscard]] SubmeshId Find(std::string_view name) const;
+
+private:
+	struct StringHash final
+	{
+		using is_transparent = void;
+		size_t operator()(std::string_view name) const { return std::hash<std::string_view>{}(name); }
+	};
+
+	std::unordered_map<std::string, SubmeshId, StringHash, std::equal_to<>> m_ids;
+};
@@ -5,6 +5,7 @@
 #include "Log.h"
 #include "Monitor.h"
 #include "GPUMarker.h"
+#include "FrameStats.h"
 #include "ContextD3D12.h"
 #include "HelperD3D12.h"
 #include "DescriptorHeapManagerD3D12.h"
@@ -48,6 +49,7 @@ bool SwapChainD3D12::Create(const SwapChainD3D12CreateInfo& createInfo)
 	m_descriptorHeapManager = &createInfo.descriptorHeapManager;
 	m_numBackBuffers        = createInfo.numBackBuffers;
 	m_vSync                 = createInfo.vSync;
+	m_maxFrameLatency       = std::max(createInfo.maxFrameLatency, 1u);
 	m_supportAllowTearing   = m_supportAllowTearing && !m_vSync;
 
 	if (!createSwapChain(createInfo)) return false;
@@ -82,6 +84,11 @@ void SwapChainD3D12::Destroy()
 	//if (m_descriptorHeapManager) m_descriptorHeapManager->FreeDescriptor(m_depthStencilDescriptor);
 
 	m_fence.Destroy();
+	if (m_frameLatencyWaitableObject)
+	{
+		CloseHandle(m_frameLatencyWaitableObject);
+		m_frameLatencyWaitableObject = nullptr;
+	}
 	m_swapChain.Reset();
 	m_device.Reset();
 }
@@ -135,7 +142,11 @@ bool SwapChainD3D12::Present()
 	if (syncInterval == 0) presentFlags |= DXGI_PRESENT_RESTART; // DXGI_PRESENT_RESTART означает, что мы разрешаем получать буферы не по порядку, например 0, 1, 2, 1, 0, 2
 	// TODO: проверить работу флагов Present
 
-	HRESULT result = m_swapChain->Present(syncInterval, presentFlags);
+	HRESULT result;
+	{
+		ScopedFrameStatsTime presentTime(FrameStatsMetric::present);
+		result = m_swapChain->Present(syncInterval, presentFlags);
+	}
 	if (FAILED(result))
 	{
 		Fatal("IDXGISwapChain4::Present() failed: " + DXErrorToStr(result));
@@ -173,6 +184,20 @@ void SwapChainD3D12::WaitForGPU()
 	}
 }
 //=============================================================================
+bool SwapChainD3D12::WaitForFrameLatency(DWORD timeout)
+{
+	if (!m_frameLatencyWaitableObject) return true;
+
+	SCOPED_CPU_MARKER("WaitForFrameLatency");
+	const DWORD result = WaitForSingleObjectEx(m_frameLatencyWaitableObject, timeout, TRUE);
+	if (result == WAIT_TIMEOUT)
+	{
+		Warning("SwapChain timed out on WaitForFrameLatency()");
+		return false;
+	}
+	return result == WAIT_OBJECT_0;
+}
+//=============================================================================
 void SwapChainD3D12::SetHDRMetaData(ColorSpace colorSpace, float MaxOutputNits, float MinOutputNits, float MaxContentLightLevel, float MaxFrameAverageLightLevel)
 {
 	if (!IsHDRFormat())
@@ -345,6 +370,7 @@ bool SwapChainD3D12::createSwapChain(const SwapChainD3D12CreateInfo& createInfo)
 	swapChainDesc.SwapEffect            = swapEffect;
 	swapChainDesc.AlphaMode             = DXGI_ALPHA_MODE_IGNORE;
 	swapChainDesc.Flags                 = m_supportAllowTearing ? DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING : 0;
+	swapChainDesc.Flags                |= DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT; // ResizeBuffers() keeps the flags
 
 	DXGI_SWAP_CHAIN_FULLSCREEN_DESC fsSwapChainDesc = {};
 	fsSwapChainDesc.Windowed = TRUE;
@@ -372,6 +398,15 @@ bool SwapChainD3D12::createSwapChain(const SwapChainD3D12CreateInfo& createInfo)
 		return false;
 	}
 
+	// With the waitable object the limit replaces IDXGIDevice1::SetMaximumFrameLatency(), the default is 1 frame
+	result = m_swapChain->SetMaximumFrameLatency(m_maxFrameLatency);
+	if (FAILED(result))
+	{
+		Fatal("IDXGISwapChain2::SetMaximumFrameLatency() failed: " + DXErrorToStr(result));
+		return false;
+	}
+	m_frameLatencyWaitableObject = m_swapChain->GetFrameLatencyWaitableObject();
+
 	// Set color space for HDR if specified
 	if (createInfo.HDR && isHDRCapableDisplayAvailable)
 	{
@@ -27,6 +27,7 @@ struct SwapChainD3D12CreateInfo final
 	CommandQueueD3D12*          presentQueue{ nullptr };
 	int                         numBackBuffers{ MAX_BACK_BUFFER_COUNT };
 	bool                        vSync{ false };
+	uint32_t                    maxFrameLatency{ 2 }; // frames queued for presentation before WaitForFrameLatency() blocks
 	bool                        HDR{ false };
 	SwapChainBitDepth           bitDepth = SwapChainBitDepth::_8;
 };
@@ -44,6 +45,8 @@ public:
 	bool Present();
 	void MoveToNextFrame();
 	void WaitForGPU();
+	// Blocks until the swap chain accepts another frame, call before the frame samples input. Returns false on timeout.
+	bool WaitForFrameLatency(DWORD timeout = 1000);
 
 	void SetHDRMetaData(ColorSpace ColorSpace, float MaxOutputNits, float MinOutputNits, float MaxContentLightLevel, float MaxFrameAverageLightLevel);
 	void SetHDRMetaData(const SetHDRMetaDataParams& p) { SetHDRMetaData(p.ColorSpace, p.MaxOutputNits, p.MinOutputNits, p.MaxContentLightLevel, p.MaxFrameAverageLightLevel); }
@@ -109,6 +112,8 @@ private:
 	// Synchronization objects
 	FenceD3D12                  m_fence;
 	uint64_t                    m_fenceValues[MAX_BACK_BUFFER_COUNT] = {};
+	HANDLE                      m_frameLatencyWaitableObject{ nullptr };
+	uint32_t                    m_maxFrameLatency{ 0 };
 
 	DescriptorHeapManagerD3D12* m_descriptorHeapManager{ nullptr };
 
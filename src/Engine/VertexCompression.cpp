@@ -0,0 +1,171 @@
+﻿#include "stdafx.h"
+#include "VertexCompression.h"
+//=============================================================================
+namespace
+{
+	constexpr float UNORM16_MAX = 65535.0f;
+	constexpr float SNORM16_MAX = 32767.0f;
+	constexpr uint32_t TANGENT_SIGN_BIT = 1u << 16; // the lowest bit of y
+
+	const glm::vec3& getAttribute(const void* vertices, uint32_t vertexStride, uint32_t vertex, uint32_t offset)
+	{
+		return *reinterpret_cast<const glm::vec3*>(static_cast<const uint8_t*>(vertices) + size_t(vertex) * vertexStride + offset);
+	}
+
+	uint32_t packSnorm16x2(const glm::vec2& value)
+	{
+		const int32_t x = static_cast<int32_t>(std::round(std::clamp(value.x, -1.0f, 1.0f) * SNORM16_MAX));
+		const int32_t y = static_cast<int32_t>(std::round(std::clamp(value.y, -1.0f, 1.0f) * SNORM16_MAX));
+		return (uint32_t(x) & 0xFFFF) | (uint32_t(y) & 0xFFFF) << 16;
+	}
+
+	glm::vec2 unpackSnorm16x2(uint32_t packed)
+	{
+		const float x = static_cast<float>(static_cast<int16_t>(packed & 0xFFFF));
+		const float y = static_cast<float>(static_cast<int16_t>(packed >> 16));
+		return glm::max(glm::vec2(x, y) / SNORM16_MAX, glm::vec2(-1.0f));
+	}
+
+	glm::vec2 encodeOctahedral(const glm::vec3& unitVector)
+	{
+		const float length = std::abs(unitVector.x) + std::abs(unitVector.y) + std::abs(unitVector.z);
+		if (length == 0.0f) return { 0.0f, 0.0f }; // a zero normal of a degenerate vertex becomes +z
+		const glm::vec3 n = unitVector / length;
+		if (n.z >= 0.0f) return { n.x, n.y };
+		// the lower hemisphere folds over the diagonals
+		return { (1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f), (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f) };
+	}
+
+	glm::vec3 decodeOctahedral(const glm::vec2& encoded)
+	{
+		glm::vec3 n(encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y));
+		const float t = std::max(-n.z, 0.0f);
+		n.x += n.x >= 0.0f ? -t : t;
+		n.y += n.y >= 0.0f ? -t : t;
+		return glm::normalize(n);
+	}
+}
+//=============================================================================
+PositionQuantization ComputePositionQuantization(const float* positions, uint32_t numVertices, uint32_t positionStride)
+{
+	PositionQuantization quantization;
+	if (numVertices == 0) return quantization;
+	glm::vec3 minimum(FLT_MAX);
+	glm::vec3 maximum(-FLT_MAX);
+	for (uint32_t vertex = 0; vertex < numVertices; vertex++)
+	{
+		const glm::vec3& position = getAttribute(positions, positionStride, vertex, 0);
+		minimum = glm::min(minimum, position);
+		maximum = glm::max(maximum, position);
+	}
+	quantization.offset = minimum;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		// a flat axis keeps a scale that is not 0, the quantized value is 0 on it anyway
+		const float extent = maximum[axis] - minimum[axis];
+		quantization.scale[axis] = extent > 0.0f ? extent / UNORM16_MAX : 1.0f;
+	}
+	return quantization;
+}
+//=============================================================================
+glm::uvec3 QuantizePosition(const glm::vec3& position, const PositionQuantization& quantization)
+{
+	const glm::vec3 normalized = glm::clamp((position - quantization.offset) / quantization.scale, glm::vec3(0.0f), glm::vec3(UNORM16_MAX));
+	return glm::uvec3(glm::round(normalized));
+}
+//=============================================================================
+glm::vec3 DequantizePosition(const glm::uvec3& quantized, const PositionQuantization& quantization)
+{
+	return quantization.offset + glm::vec3(quantized) * quantization.scale;
+}
+//=============================================================================
+uint32_t PackOctahedral(const glm::vec3& unitVector)
+{
+	// Rounding each component to the nearest step is not always the nearest direction, the four neighbours are tried for four
+	// more decodes, meshes are compressed once. They are compared by distance, a float dot product this close to 1 cannot tell
+	// them apart.
+	const float length = glm::length(unitVector);
+	if (length == 0.0f) return packSnorm16x2(encodeOctahedral(unitVector));
+	const glm::vec3 direction = unitVector / length;
+	const glm::vec2 base = glm::floor(encodeOctahedral(direction) * SNORM16_MAX);
+	uint32_t best = 0;
+	float bestDistance = FLT_MAX;
+	for (uint32_t neighbour = 0; neighbour < 4; neighbour++)
+	{
+		const glm::vec2 candidate = (base + glm::vec2(float(neighbour & 1), float(neighbour >> 1))) / SNORM16_MAX;
+		const uint32_t packed = packSnorm16x2(candidate);
+		const glm::vec3 difference = decodeOctahedral(unpackSnorm16x2(packed)) - direction;
+		const float distance = glm::dot(difference, difference);
+		if (distance < bestDistance)
+		{
+			best = packed;
+			bestDistance = distance;
+		}
+	}
+	return best;
+}
+//=============================================================================
+glm::vec3 UnpackOctahedral(uint32_t packed)
+{
+	return decodeOctahedral(unpackSnorm16x2(packed));
+}
+//=============================================================================
+uint32_t PackTangent(const glm::vec4& tangent)
+{
+	return (PackOctahedral(glm::vec3(tangent)) & ~TANGENT_SIGN_BIT) | (tangent.w < 0.0f ? TANGENT_SIGN_BIT : 0);
+}
+//=============================================================================
+glm::vec4 UnpackTangent(uint32_t packed)
+{
+	return glm::vec4(UnpackOctahedral(packed), (packed & TANGENT_SIGN_BIT) != 0 ? -1.0f : 1.0f);
+}
+//=============================================================================
+uint32_t PackHalf2(const glm::vec2& value)
+{
+	return glm::packHalf2x16(value);
+}
+//=============================================================================
+glm::vec2 UnpackHalf2(uint32_t packed)
+{
+	return glm::unpackHalf2x16(packed);
+}
+//=============================================================================
+uint32_t PackColor(const glm::vec4& color)
+{
+	return glm::packUnorm4x8(color);
+}
+//=============================================================================
+glm::vec4 UnpackColor(uint32_t packed)
+{
+	return glm::unpackUnorm4x8(packed);
+}
+//=============================================================================
+PositionQuantization CompressMeshVertices(const void* vertices, uint32_t numVertices, uint32_t vertexStride, uint32_t positionOffset, uint32_t normalOffset, uint32_t uvOffset, CompressedMeshVertex* compressed)
+{
+	const PositionQuantization quantization = ComputePositionQuantization(reinterpret_cast<const float*>(static_cast<const uint8_t*>(vertices) + positionOffset), numVertices, vertexStride);
+	for (uint32_t vertex = 0; vertex < numVertices; vertex++)
+	{
+		const glm::uvec3 position = QuantizePosition(getAttribute(vertices, vertexStride, vertex, positionOffset), quantization);
+		const glm::vec3& normal = getAttribute(vertices, vertexStride, vertex, normalOffset);
+		const glm::vec2& uv = *reinterpret_cast<const glm::vec2*>(static_cast<const uint8_t*>(vertices) + size_t(vertex) * vertexStride + uvOffset);
+
+		CompressedMeshVertex& output = compressed[vertex];
+		output.positionXY = position.x | position.y << 16;
+		output.positionZ = position.z;
+		output.normal = PackOctahedral(normal);
+		output.uv = PackHalf2(uv);
+	}
+	return quantization;
+}
+//=============================================================================
+CompressedMeshConstants MakeCompressedMeshConstants(const glm::mat4& worldMatrix, const PositionQuantization& quantization, uint32_t vertexBufferIndex, uint32_t textureIndex)
+{
+	CompressedMeshConstants constants;
+	constants.worldMatrix = worldMatrix;
+	constants.positionOffset = quantization.offset;
+	constants.vertexBufferIndex = vertexBufferIndex;
+	constants.positionScale = quantization.scale;
+	constants.textureIndex = textureIndex;
+	return constants;
+}
+//=============================================================================
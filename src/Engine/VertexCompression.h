@@ -0,0 +1,69 @@
+﻿#pragma once
+
+#include "Data/Shaders/Shared.h"
+
+// Compact vertex attributes. The shaders decode them with the helpers of Data/Shaders/Common.hlsl, the Unpack functions here are
+// the same decoding on the CPU.
+//  - positions: unorm16 per component relative to the bounds of the mesh, the error is at most 1/131070 of the extent. The
+//    offset and the scale go into the constants of the draw.
+//  - normals: octahedral, snorm16 per component, under 0.005 degrees of error. Tangents are the same with the bitangent sign in
+//    the lowest bit of y, under 0.01 degrees.
+//  - uvs: half per component, within half a texel of a 2048 texture in [0, 1]; uvs that tile far past 1 lose precision.
+//  - colors: RGBA8 unorm.
+// CompressedMeshVertex is MeshVertex in 16 bytes instead of 32.
+
+// matches CompressedMeshVertex in Data/Shaders/Shared.h
+struct CompressedMeshVertex final
+{
+	uint32_t positionXY{ 0 }; // unorm16 x | y << 16
+	uint32_t positionZ{ 0 };  // unorm16, the high half is free
+	uint32_t normal{ 0 };     // octahedral snorm16 x | y << 16
+	uint32_t uv{ 0 };         // half x | y << 16
+};
+static_assert(sizeof(CompressedMeshVertex) == 16);
+static_assert(sizeof(CompressedMeshVertex) == sizeof(hlsl::CompressedMeshVertex));
+static_assert(offsetof(CompressedMeshVertex, positionXY) == offsetof(hlsl::CompressedMeshVertex, positionXY));
+static_assert(offsetof(CompressedMeshVertex, positionZ) == offsetof(hlsl::CompressedMeshVertex, positionZ));
+static_assert(offsetof(CompressedMeshVertex, normal) == offsetof(hlsl::CompressedMeshVertex, normal));
+static_assert(offsetof(CompressedMeshVertex, uv) == offsetof(hlsl::CompressedMeshVertex, uv));
+
+// matches CompressedMeshConstants in Data/Shaders/Shared.h
+struct CompressedMeshConstants final
+{
+	glm::mat4 worldMatrix{ 1.0f };
+	glm::vec3 positionOffset{ 0.0f };
+	uint32_t  vertexBufferIndex{ 0 };
+	glm::vec3 positionScale{ 1.0f };
+	uint32_t  textureIndex{ 0 };
+};
+static_assert(sizeof(CompressedMeshConstants) == sizeof(hlsl::CompressedMeshConstants));
+static_assert(offsetof(CompressedMeshConstants, worldMatrix) == offsetof(hlsl::CompressedMeshConstants, worldMatrix));
+static_assert(offsetof(CompressedMeshConstants, positionOffset) == offsetof(hlsl::CompressedMeshConstants, positionOffset));
+static_assert(offsetof(CompressedMeshConstants, vertexBufferIndex) == offsetof(hlsl::CompressedMeshConstants, vertexBufferIndex));
+static_assert(offsetof(CompressedMeshConstants, positionScale) == offsetof(hlsl::CompressedMeshConstants, positionScale));
+static_assert(offsetof(CompressedMeshConstants, textureIndex) == offsetof(hlsl::CompressedMeshConstants, textureIndex));
+
+// position = offset + unorm16 * scale
+struct PositionQuantization final
+{
+	glm::vec3 offset{ 0.0f };
+	glm::vec3 scale{ 1.0f };
+};
+
+[[nodiscard]] PositionQuantization ComputePositionQuantization(const float* positions, uint32_t numVertices, uint32_t positionStride);
+[[nodiscard]] glm::uvec3 QuantizePosition(const glm::vec3& position, const PositionQuantization& quantization);
+[[nodiscard]] glm::vec3 DequantizePosition(const glm::uvec3& quantized, const PositionQuantization& quantization);
+
+[[nodiscard]] uint32_t PackOctahedral(const glm::vec3& unitVector);
+[[nodiscard]] glm::vec3 UnpackOctahedral(uint32_t packed);
+[[nodiscard]] uint32_t PackTangent(const glm::vec4& tangent); // w: bitangent sign
+[[nodiscard]] glm::vec4 UnpackTangent(uint32_t packed);
+[[nodiscard]] uint32_t PackHalf2(const glm::vec2& value);
+[[nodiscard]] glm::vec2 UnpackHalf2(uint32_t packed);
+[[nodiscard]] uint32_t PackColor(const glm::vec4& color);
+[[nodiscard]] glm::vec4 UnpackColor(uint32_t packed);
+
+// Compresses interleaved float vertices: float3 position, float3 normal and float2 uv at the given offsets of every vertexStride
+// bytes. Returns the quantization the draw constants need.
+PositionQuantization CompressMeshVertices(const void* vertices, uint32_t numVertices, uint32_t vertexStride, uint32_t positionOffset, uint32_t normalOffset, uint32_t uvOffset, CompressedMeshVertex* compressed);
+[[nodiscard]] CompressedMeshConstants MakeCompressedMeshConstants(const glm::mat4& worldMatrix, const PositionQuantization& quantization, uint32_t vertexBufferIndex, uint32_t textureIndex);
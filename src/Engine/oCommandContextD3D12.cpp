@@ -4,6 +4,62 @@
 #include "oRHIBackendD3D12.h"
 #include "Log.h"
 //=============================================================================
+namespace
+{
+	// bindings are sorted by binding index
+	const Resource* findBindingResource(const std::vector<PipelineResourceBinding>& bindings, uint32_t bindingIndex)
+	{
+		auto it = std::lower_bound(bindings.begin(), bindings.end(), PipelineResourceBinding{ bindingIndex, nullptr }, SortPipelineBindings);
+		return it != bindings.end() && it->bindingIndex == bindingIndex ? it->resource : nullptr;
+	}
+
+	// The root signature only has the bindings of the pipeline layout, DXC strips the ones the shaders do not use. The descriptor
+	// table of a space takes the UAVs, then the SRVs of the layout in binding order, resources of the space outside the layout are
+	// skipped. Returns false if the space misses a binding of the layout.
+	bool gatherTableDescriptors(uint32_t spaceId, const ShaderResourceSpaceLayout& spaceLayout, const PipelineResourceSpace& resources, D3D12_CPU_DESCRIPTOR_HANDLE* handles)
+	{
+		uint32_t currentHandleIndex = 0;
+		for (uint32_t bindingIndex : spaceLayout.UAVBindings)
+		{
+			const Resource* uav = findBindingResource(resources.GetUAVs(), bindingIndex);
+			if (!uav)
+			{
+				Error("PipelineResourceSpace has no UAV u" + std::to_string(bindingIndex) + ", space" + std::to_string(spaceId) + " used by the bound pipeline");
+				return false;
+			}
+
+			if (uav->type == oGPUResourceType::buffer)
+			{
+				handles[currentHandleIndex++] = static_cast<const BufferResource*>(uav)->UAVDescriptor.CPUHandle;
+			}
+			else
+			{
+				handles[currentHandleIndex++] = static_cast<const TextureResource*>(uav)->UAVDescriptor.CPUHandle;
+			}
+		}
+
+		for (uint32_t bindingIndex : spaceLayout.SRVBindings)
+		{
+			const Resource* srv = findBindingResource(resources.GetSRVs(), bindingIndex);
+			if (!srv)
+			{
+				Error("PipelineResourceSpace has no SRV t" + std::to_string(bindingIndex) + ", space" + std::to_string(spaceId) + " used by the bound pipeline");
+				return false;
+			}
+
+			if (srv->type == oGPUResourceType::buffer)
+			{
+				handles[currentHandleIndex++] = static_cast<const BufferResource*>(srv)->SRVDescriptor.CPUHandle;
+			}
+			else
+			{
+				handles[currentHandleIndex++] = static_cast<const TextureResource*>(srv)->SRVDescriptor.CPUHandle;
+			}
+		}
+		return true;
+	}
+}
+//=============================================================================
 CommandContextD3D12::CommandContextD3D12(D3D12_COMMAND_LIST_TYPE commandType) 
 	: m_contextType(commandType)
 {
@@ -26,7 +82,7 @@ CommandContextD3D12::CommandContextD3D12(D3D12_COMMAND_LIST_TYPE commandType)
 	}
 }
 //=============================================================================
-void CommandContextD3D12::Reset()
+void CommandContextD3D12::Reset(bool resetDescriptorHeap)
 {
 	const uint32_t frameId = ogRHI.GetCurrentBackBufferIndex();
 
@@ -35,7 +91,7 @@ void CommandContextD3D12::Reset()
 
 	if (m_contextType != D3D12_COMMAND_LIST_TYPE_COPY)
 	{
-		bindDescriptorHeaps(frameId);
+		bindDescriptorHeaps(frameId, resetDescriptorHeap);
 	}
 }
 //=============================================================================
@@ -91,10 +147,10 @@ void CommandContextD3D12::FlushBarriers()
 	}
 }
 //=============================================================================
-void CommandContextD3D12::bindDescriptorHeaps(uint32_t frameIndex)
+void CommandContextD3D12::bindDescriptorHeaps(uint32_t frameIndex, bool resetDescriptorHeap)
 {
 	m_currentSRVHeap = &ogRHI.GetSRVHeap(frameIndex);
-	m_currentSRVHeap->Reset();
+	if (resetDescriptorHeap) m_currentSRVHeap->Reset();
 
 	ID3D12DescriptorHeap* heapsToBind[2];
 	heapsToBind[0] = ogRHI.GetSRVHeap(frameIndex).GetD3DHeap().Get();
@@ -113,7 +169,7 @@ void CommandContextD3D12::CopyBufferRegion(Resource& destination, uint64_t destO
 	m_commandList->CopyBufferRegion(destination.resource.Get(), destOffset, source.resource.Get(), sourceOffset, numBytes);
 }
 //=============================================================================
-void CommandContextD3D12::CopyTextureRegion(Resource& destination, Resource& source, size_t sourceOffset, SubResourceLayouts& subResourceLayouts, uint32_t numSubResources)
+void CommandContextD3D12::CopyTextureRegion(Resource& destination, Resource& source, size_t sourceOffset, const SubResourceLayouts& subResourceLayouts, uint32_t numSubResources)
 {
 	for (uint32_t subResourceIndex = 0; subResourceIndex < numSubResources; subResourceIndex++)
 	{
@@ -228,19 +284,26 @@ void GraphicsCommandContextD3D12::SetPipelineResources(uint32_t spaceId, const P
 	assert(m_currentPipeline);
 	assert(resources.IsLocked());
 
+	// Only the bindings the pipeline uses are bound, see gatherTableDescriptors()
+	const ShaderResourceSpaceLayout& spaceLayout = m_currentPipeline->resourceLayout.spaces[spaceId];
+
 	static const uint32_t maxNumHandlesPerBinding = 16;
 	static const uint32_t singleDescriptorRangeCopyArray[maxNumHandlesPerBinding]{ 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 ,1 };
 
 	const BufferResource* cbv = resources.GetCBV();
-	const auto& uavs = resources.GetUAVs();
-	const auto& srvs = resources.GetSRVs();
-	const uint32_t numTableHandles = static_cast<uint32_t>(uavs.size() + srvs.size());
+	const uint32_t numTableHandles = static_cast<uint32_t>(spaceLayout.UAVBindings.size() + spaceLayout.SRVBindings.size());
 	D3D12_CPU_DESCRIPTOR_HANDLE handles[maxNumHandlesPerBinding]{};
-	uint32_t currentHandleIndex = 0;
+
 	assert(numTableHandles <= maxNumHandlesPerBinding);
 
-	if (cbv)
+	if (spaceLayout.hasCBV)
 	{
+		if (!cbv)
+		{
+			Error("PipelineResourceSpace has no CBV b0, space" + std::to_string(spaceId) + " used by the bound pipeline");
+			return;
+		}
+
 		auto& cbvMapping = m_currentPipeline->pipelineResourceMapping.cbvMapping[spaceId];
 		assert(cbvMapping.has_value());
 
@@ -258,35 +321,11 @@ void GraphicsCommandContextD3D12::SetPipelineResources(uint32_t spaceId, const P
 		}
 	}
 
-	if (numTableHandles == 0)
+	if (numTableHandles == 0 || !gatherTableDescriptors(spaceId, spaceLayout, resources, handles))
 	{
 		return;
 	}
 
-	for (auto& uav : uavs)
-	{
-		if (uav.resource->type == oGPUResourceType::buffer)
-		{
-			handles[currentHandleIndex++] = static_cast<BufferResource*>(uav.resource)->UAVDescriptor.CPUHandle;
-		}
-		else
-		{
-			handles[currentHandleIndex++] = static_cast<TextureResource*>(uav.resource)->UAVDescriptor.CPUHandle;
-		}
-	}
-
-	for (auto& srv : srvs)
-	{
-		if (srv.resource->type == oGPUResourceType::buffer)
-		{
-			handles[currentHandleIndex++] = static_cast<BufferResource*>(srv.resource)->SRVDescriptor.CPUHandle;
-		}
-		else
-		{
-			handles[currentHandleIndex++] = static_cast<TextureResource*>(srv.resource)->SRVDescriptor.CPUHandle;
-		}
-	}
-
 	DescriptorHandleD3D12 blockStart = m_currentSRVHeap->AllocateUserDescriptorBlock(numTableHandles);
 	CopyDescriptors(1, &blockStart.CPUHandle, &numTableHandles, numTableHandles, handles, singleDescriptorRangeCopyArray, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 
@@ -359,6 +398,12 @@ void GraphicsCommandContextD3D12::DrawIndexedInstanced(uint32_t indexCountPerIns
 	m_commandList->DrawIndexedInstanced(indexCountPerInstance, instanceCount, startIndexLocation, baseVertexLocation, startInstanceLocation);
 }
 //=============================================================================
+void GraphicsCommandContextD3D12::ExecuteIndirect(ID3D12CommandSignature* commandSignature, uint32_t maxCommandCount, const BufferResource& argumentBuffer, const BufferResource* countBuffer)
+{
+	assert(commandSignature);
+	m_commandList->ExecuteIndirect(commandSignature, maxCommandCount, argumentBuffer.resource.Get(), 0, countBuffer ? countBuffer->resource.Get() : nullptr, 0);
+}
+//=============================================================================
 void GraphicsCommandContextD3D12::Dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ)
 {
 	m_commandList->Dispatch(groupCountX, groupCountY, groupCountZ);
@@ -398,55 +443,37 @@ void ComputeCommandContextD3D12::SetPipelineResources(uint32_t spaceId, const Pi
 	assert(m_currentPipeline);
 	assert(resources.IsLocked());
 
+	// Only the bindings the pipeline uses are bound, see gatherTableDescriptors()
+	const ShaderResourceSpaceLayout& spaceLayout = m_currentPipeline->resourceLayout.spaces[spaceId];
+
 	static const uint32_t maxNumHandlesPerBinding = 16;
 	static const uint32_t singleDescriptorRangeCopyArray[maxNumHandlesPerBinding]{ 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 ,1 };
 
 	const BufferResource* cbv = resources.GetCBV();
-	const auto& uavs = resources.GetUAVs();
-	const auto& srvs = resources.GetSRVs();
-	const uint32_t numTableHandles = static_cast<uint32_t>(uavs.size() + srvs.size());
+	const uint32_t numTableHandles = static_cast<uint32_t>(spaceLayout.UAVBindings.size() + spaceLayout.SRVBindings.size());
 	D3D12_CPU_DESCRIPTOR_HANDLE handles[maxNumHandlesPerBinding]{};
-	uint32_t currentHandleIndex = 0;
 
 	assert(numTableHandles <= maxNumHandlesPerBinding);
 
-	if (cbv)
+	if (spaceLayout.hasCBV)
 	{
+		if (!cbv)
+		{
+			Error("PipelineResourceSpace has no CBV b0, space" + std::to_string(spaceId) + " used by the bound pipeline");
+			return;
+		}
+
 		auto& cbvMapping = m_currentPipeline->pipelineResourceMapping.cbvMapping[spaceId];
 		assert(cbvMapping.has_value());
 
 		m_commandList->SetComputeRootConstantBufferView(cbvMapping.value(), cbv->virtualAddress);
 	}
 
-	if (numTableHandles == 0)
+	if (numTableHandles == 0 || !gatherTableDescriptors(spaceId, spaceLayout, resources, handles))
 	{
 		return;
 	}
 
-	for (auto& uav : uavs)
-	{
-		if (uav.resource->type == oGPUResourceType::buffer)
-		{
-			handles[currentHandleIndex++] = static_cast<BufferResource*>(uav.resource)->UAVDescriptor.CPUHandle;
-		}
-		else
-		{
-			handles[currentHandleIndex++] = static_cast<TextureResource*>(uav.resource)->UAVDescriptor.CPUHandle;
-		}
-	}
-
-	for (auto& srv : srvs)
-	{
-		if (srv.resource->type == oGPUResourceType::buffer)
-		{
-			handles[currentHandleIndex++] = static_cast<BufferResource*>(srv.resource)->SRVDescriptor.CPUHandle;
-		}
-		else
-		{
-			handles[currentHandleIndex++] = static_cast<TextureResource*>(srv.resource)->SRVDescriptor.CPUHandle;
-		}
-	}
-
 	DescriptorHandleD3D12 blockStart = m_currentSRVHeap->AllocateUserDescriptorBlock(numTableHandles);
 	CopyDescriptors(1, &blockStart.CPUHandle, &numTableHandles, numTableHandles, handles, singleDescriptorRangeCopyArray, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 
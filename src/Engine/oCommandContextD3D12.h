@@ -14,15 +14,16 @@ public:
 	auto GetCommandType() { return m_contextType; }
 	auto GetCommandList() { return m_commandList; }
 
-	void Reset();
+	// Contexts recorded in parallel share the descriptor heap of the frame, only the first one of the frame resets it
+	void Reset(bool resetDescriptorHeap = true);
 	void AddBarrier(Resource& resource, D3D12_RESOURCE_STATES newState);
 	void FlushBarriers();
 	void CopyResource(const Resource& destination, const Resource& source);
 	void CopyBufferRegion(Resource& destination, uint64_t destOffset, Resource& source, uint64_t sourceOffset, uint64_t numBytes);
-	void CopyTextureRegion(Resource& destination, Resource& source, size_t sourceOffset, SubResourceLayouts& subResourceLayouts, uint32_t numSubResources);
+	void CopyTextureRegion(Resource& destination, Resource& source, size_t sourceOffset, const SubResourceLayouts& subResourceLayouts, uint32_t numSubResources);
 
 protected:
-	void bindDescriptorHeaps(uint32_t frameIndex);
+	void bindDescriptorHeaps(uint32_t frameIndex, bool resetDescriptorHeap);
 
 	D3D12_COMMAND_LIST_TYPE             m_contextType{ D3D12_COMMAND_LIST_TYPE_DIRECT };
 	ComPtr<ID3D12GraphicsCommandList10> m_commandList{ nullptr };
@@ -55,6 +56,8 @@ public:
 	void DrawIndexed(uint32_t indexCount, uint32_t startIndexLocation = 0, uint32_t baseVertexLocation = 0);
 	void DrawInstanced(uint32_t vertexCountPerInstance, uint32_t instanceCount, uint32_t startVertexLocation = 0, uint32_t startInstanceLocation = 0);
 	void DrawIndexedInstanced(uint32_t indexCountPerInstance, uint32_t instanceCount, uint32_t startIndexLocation, uint32_t baseVertexLocation, uint32_t startInstanceLocation);
+	// The arguments (and the count) are in D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT, without a count buffer maxCommandCount commands are executed
+	void ExecuteIndirect(ID3D12CommandSignature* commandSignature, uint32_t maxCommandCount, const BufferResource& argumentBuffer, const BufferResource* countBuffer = nullptr);
 	void Dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ);
 	void Dispatch1D(uint32_t threadCountX, uint32_t groupSizeX);
 	void Dispatch2D(uint32_t threadCountX, uint32_t threadCountY, uint32_t groupSizeX, uint32_t groupSizeY);
@@ -3,6 +3,23 @@
 #include "oCommandQueueD3D12.h"
 #include "oRenderCoreD3D12.h"
 #include "Log.h"
+#include "GPUMarker.h"
+#include "FrameStats.h"
+//=============================================================================
+namespace
+{
+	// Track names of the profiler trace
+	const char* getQueueName(D3D12_COMMAND_LIST_TYPE type)
+	{
+		switch (type)
+		{
+		case D3D12_COMMAND_LIST_TYPE_DIRECT:  return "Graphics Queue";
+		case D3D12_COMMAND_LIST_TYPE_COMPUTE: return "Compute Queue";
+		case D3D12_COMMAND_LIST_TYPE_COPY:    return "Copy Queue";
+		default:                              return "Queue";
+		}
+	}
+}
 //=============================================================================
 oCommandQueueD3D12::oCommandQueueD3D12(ComPtr<ID3D12Device> device, D3D12_COMMAND_LIST_TYPE commandType)
 	: m_queueType(commandType)
@@ -48,7 +65,12 @@ oCommandQueueD3D12::~oCommandQueueD3D12()
 //=============================================================================
 uint64_t oCommandQueueD3D12::PollCurrentFenceValue()
 {
-	m_lastCompletedFenceValue = (std::max)(m_lastCompletedFenceValue, m_fence->GetCompletedValue());
+	const uint64_t completedValue = m_fence->GetCompletedValue();
+	if (completedValue > m_lastCompletedFenceValue)
+	{
+		m_lastCompletedFenceValue = completedValue;
+		ProfilerRecordQueueEvent(getQueueName(m_queueType), ProfilerQueueEvent::completed, completedValue);
+	}
 	return m_lastCompletedFenceValue;
 }
 //=============================================================================
@@ -64,16 +86,19 @@ bool oCommandQueueD3D12::IsFenceComplete(uint64_t fenceValue)
 //=============================================================================
 void oCommandQueueD3D12::InsertWait(uint64_t fenceValue)
 {
+	ProfilerRecordQueueEvent(getQueueName(m_queueType), ProfilerQueueEvent::wait, fenceValue);
 	m_queue->Wait(m_fence.Get(), fenceValue);
 }
 //=============================================================================
 void oCommandQueueD3D12::InsertWaitForQueueFence(oCommandQueueD3D12* otherQueue, uint64_t fenceValue)
 {
+	ProfilerRecordQueueEvent(getQueueName(m_queueType), ProfilerQueueEvent::wait, fenceValue);
 	m_queue->Wait(otherQueue->GetFence().Get(), fenceValue);
 }
 //=============================================================================
 void oCommandQueueD3D12::InsertWaitForQueue(oCommandQueueD3D12* otherQueue)
 {
+	ProfilerRecordQueueEvent(getQueueName(m_queueType), ProfilerQueueEvent::wait, otherQueue->GetNextFenceValue() - 1);
 	m_queue->Wait(otherQueue->GetFence().Get(), otherQueue->GetNextFenceValue() - 1);
 }
 //=============================================================================
@@ -82,12 +107,15 @@ void oCommandQueueD3D12::WaitForFenceCPUBlocking(uint64_t fenceValue)
 	if (IsFenceComplete(fenceValue)) return;
 
 	{
+		SCOPED_CPU_MARKER("WaitForFence");
+		ScopedFrameStatsTime waitTime(FrameStatsMetric::wait);
 		std::lock_guard<std::mutex> lockGuard(m_eventMutex);
 
 		m_fence->SetEventOnCompletion(fenceValue, m_fenceEventHandle);
 		WaitForSingleObjectEx(m_fenceEventHandle, INFINITE, false);
 		m_lastCompletedFenceValue = fenceValue;
 	}
+	ProfilerRecordQueueEvent(getQueueName(m_queueType), ProfilerQueueEvent::completed, fenceValue);
 }
 //=============================================================================
 void oCommandQueueD3D12::WaitForIdle()
@@ -104,6 +132,8 @@ uint64_t oCommandQueueD3D12::ExecuteCommandList(ID3D12CommandList* commandList)
 		return 0;
 	}
 
+	// the fence value is the one SignalFence() is about to use, submissions come from one thread
+	ProfilerRecordQueueEvent(getQueueName(m_queueType), ProfilerQueueEvent::submit, m_nextFenceValue);
 	m_queue->ExecuteCommandLists(1, &commandList);
 
 	return SignalFence();
@@ -114,6 +144,7 @@ uint64_t oCommandQueueD3D12::SignalFence()
 	std::lock_guard<std::mutex> lockGuard(m_fenceMutex);
 
 	m_queue->Signal(m_fence.Get(), m_nextFenceValue);
+	ProfilerRecordQueueEvent(getQueueName(m_queueType), ProfilerQueueEvent::signal, m_nextFenceValue);
 
 	return m_nextFenceValue++;
 }
@@ -4,6 +4,8 @@
 #include "WindowData.h"
 #include "Log.h"
 #include "oRenderCoreD3D12.h"
+#include "GPUMarker.h"
+#include "FrameStats.h"
 //=============================================================================
 oRHIBackend ogRHI{};
 //=============================================================================
@@ -33,6 +35,7 @@ bool oRHIBackend::CreateAPI(const WindowData& wndData, const RenderSystemCreateI
 {
 	frameBufferWidth = wndData.width;
 	frameBufferHeight = wndData.height;
+	maxFrameLatency = std::max(createInfo.maxFrameLatency, 1u);
 
 	enableDebugLayer();
 	if (!createAdapter())          return false;
@@ -147,7 +150,12 @@ bool oRHIBackend::CreateAPI(const WindowData& wndData, const RenderSystemCreateI
 	freeReservedDescriptorIndices.resize(NUM_RESERVED_SRV_DESCRIPTORS - 1);
 	std::iota(freeReservedDescriptorIndices.begin(), freeReservedDescriptorIndices.end(), 1);
 
+	if (!createGPUProfiler()) return false;
 
+	if (cookedAssets.Open(COOKED_ASSET_PACK_PATH))
+	{
+		Print("Using cooked assets from " + std::string(COOKED_ASSET_PACK_PATH));
+	}
 
 	return true;
 }
@@ -156,6 +164,8 @@ void oRHIBackend::DestroyAPI()
 {
 	WaitForIdle();
 	destroyMainRenderTarget();
+	if (frameLatencyWaitableObject) CloseHandle(frameLatencyWaitableObject);
+	frameLatencyWaitableObject = nullptr;
 	swapChain.Reset();
 	release();
 }
@@ -211,6 +221,20 @@ void oRHIBackend::BeginFrame()
 	contextSubmissions[currentBackBufferIndex].clear();
 }
 //=============================================================================
+bool oRHIBackend::WaitForFrameLatency(DWORD timeout)
+{
+	if (!frameLatencyWaitableObject) return true;
+
+	SCOPED_CPU_MARKER("WaitForFrameLatency");
+	const DWORD result = WaitForSingleObjectEx(frameLatencyWaitableObject, timeout, TRUE);
+	if (result == WAIT_TIMEOUT)
+	{
+		Warning("oRHIBackend timed out on WaitForFrameLatency()");
+		return false;
+	}
+	return result == WAIT_OBJECT_0;
+}
+//=============================================================================
 void oRHIBackend::EndFrame()
 {
 	uploadContexts[currentBackBufferIndex]->ProcessUploads();
@@ -222,7 +246,14 @@ void oRHIBackend::EndFrame()
 //=============================================================================
 void oRHIBackend::Present()
 {
-	swapChain->Present(0, 0);
+#if ENABLE_PROFILER
+	// all command lists of the frame are submitted by now
+	gpuProfiler.EndFrame();
+#endif
+	{
+		ScopedFrameStatsTime presentTime(FrameStatsMetric::present);
+		swapChain->Present(0, 0);
+	}
 	endOfFrameFences[currentBackBufferIndex].graphicsQueueFence = graphicsQueue->SignalFence();
 }
 //=============================================================================
@@ -247,6 +278,11 @@ void oRHIBackend::release()
 		ProcessDestructions(frameIndex);
 	}
 
+#if ENABLE_PROFILER
+	gpuProfiler.Destroy();
+	gpuTimestampDevice.Destroy();
+#endif
+
 	delete copyQueue; copyQueue = nullptr;
 	delete computeQueue; computeQueue = nullptr;
 	delete graphicsQueue; graphicsQueue = nullptr;
@@ -264,6 +300,9 @@ void oRHIBackend::release()
 		uploadContexts[frameIndex] = nullptr;
 	}
 
+	rootSignatureCache.clear();
+	cookedAssets.Close();
+
 	allocator.Reset();
 	device.Reset();
 
@@ -498,8 +537,7 @@ bool oRHIBackend::createSwapChain(const WindowData& wndData)
 	swapChainDesc.SwapEffect            = DXGI_SWAP_EFFECT_FLIP_DISCARD;
 	swapChainDesc.Scaling               = DXGI_SCALING_STRETCH;
 	swapChainDesc.AlphaMode             = DXGI_ALPHA_MODE_UNSPECIFIED;
-	// It is recommended to always allow tearing if tearing support is available.
-	swapChainDesc.Flags =  0;
+	swapChainDesc.Flags                 = DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT; // ResizeBuffers() keeps the flags
 
 	ComPtr<IDXGISwapChain1> swapChain1;
 	result = DXGIFactory->CreateSwapChainForHwnd(graphicsQueue->GetDeviceQueue().Get(), wndData.hwnd, &swapChainDesc, nullptr, nullptr, &swapChain1);
@@ -523,6 +561,15 @@ bool oRHIBackend::createSwapChain(const WindowData& wndData)
 		return false;
 	}
 
+	// With the waitable object the limit replaces IDXGIDevice1::SetMaximumFrameLatency(), the default is 1 frame
+	result = swapChain->SetMaximumFrameLatency(maxFrameLatency);
+	if (FAILED(result))
+	{
+		Fatal("IDXGISwapChain2::SetMaximumFrameLatency() failed: " + DXErrorToStr(result));
+		return false;
+	}
+	frameLatencyWaitableObject = swapChain->GetFrameLatencyWaitableObject();
+
 	currentBackBufferIndex = 0;
 
 	return createMainRenderTarget();
@@ -559,6 +606,25 @@ bool oRHIBackend::createMainRenderTarget()
 	return true;
 }
 //=============================================================================
+bool oRHIBackend::createGPUProfiler()
+{
+#if ENABLE_PROFILER
+	GPUProfilerCreateInfo createInfo;
+	createInfo.numQueues = 2;
+	createInfo.queueNames[0] = "Graphics Queue";
+	createInfo.queueNames[1] = "Compute Queue";
+	createInfo.numFramesInFlight = NUM_FRAMES_IN_FLIGHT;
+
+	oCommandQueueD3D12* queues[] = { graphicsQueue, computeQueue };
+	const uint32_t numFrameSlots = GPUProfiler::GetNumFrameSlots(createInfo.numFramesInFlight);
+	if (!gpuTimestampDevice.Create(device.Get(), queues, createInfo.numQueues, createInfo.maxQueriesPerFrame * numFrameSlots, numFrameSlots))
+		return false;
+	if (!gpuProfiler.Create(createInfo, &gpuTimestampDevice))
+		return false;
+#endif
+	return true;
+}
+//=============================================================================
 void oRHIBackend::destroyMainRenderTarget()
 {
 	for (uint32_t bufferIndex = 0; bufferIndex < MAX_BACK_BUFFER_COUNT; bufferIndex++)
@@ -665,7 +731,7 @@ std::unique_ptr<BufferResource> CreateBuffer(const BufferCreationDesc& desc)
 	return newBuffer;
 }
 //=============================================================================
-std::unique_ptr<TextureResource> CreateTexture(const TextureCreationDesc& desc)
+std::unique_ptr<TextureResource> CreateTexture(const TextureCreationDesc& desc, D3D12MA::Allocation* placementHeap, uint64_t placementOffset)
 {
 	D3D12_RESOURCE_DESC textureDesc = desc.resourceDesc;
 	textureDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
@@ -737,7 +803,19 @@ std::unique_ptr<TextureResource> CreateTexture(const TextureCreationDesc& desc)
 	D3D12MA::ALLOCATION_DESC allocationDesc{};
 	allocationDesc.HeapType = D3D12_HEAP_TYPE_DEFAULT;
 
-	ogRHI.allocator->CreateResource(&allocationDesc, &textureDesc, resourceState, (!hasRTV && !hasDSV) ? nullptr : &clearValue, &newTexture->allocation, IID_PPV_ARGS(&newTexture->resource));
+	if (placementHeap)
+	{
+		HRESULT result = ogRHI.allocator->CreateAliasingResource(placementHeap, placementOffset, &textureDesc, resourceState, (!hasRTV && !hasDSV) ? nullptr : &clearValue, IID_PPV_ARGS(&newTexture->resource));
+		if (FAILED(result))
+		{
+			Fatal("D3D12MA::Allocator::CreateAliasingResource() failed: " + DXErrorToStr(result));
+			return nullptr;
+		}
+	}
+	else
+	{
+		ogRHI.allocator->CreateResource(&allocationDesc, &textureDesc, resourceState, (!hasRTV && !hasDSV) ? nullptr : &clearValue, &newTexture->allocation, IID_PPV_ARGS(&newTexture->resource));
+	}
 
 	if (hasSRV)
 	{
@@ -810,6 +888,18 @@ std::unique_ptr<TextureResource> CreateTexture(const TextureCreationDesc& desc)
 	return newTexture;
 }
 //=============================================================================
+D3D12_RESOURCE_ALLOCATION_INFO GetTextureAllocationInfo(const TextureCreationDesc& desc)
+{
+	// the typeless depth formats CreateTexture() uses have the same size
+	D3D12_RESOURCE_DESC textureDesc = desc.resourceDesc;
+	textureDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+	if ((desc.viewFlags & TextureViewFlags::rtv) == TextureViewFlags::rtv) textureDesc.Flags |= D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
+	if ((desc.viewFlags & TextureViewFlags::dsv) == TextureViewFlags::dsv) textureDesc.Flags |= D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
+	if ((desc.viewFlags & TextureViewFlags::uav) == TextureViewFlags::uav) textureDesc.Flags |= D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+
+	return ogRHI.device->GetResourceAllocationInfo(0, 1, &textureDesc);
+}
+//=============================================================================
 std::unique_ptr<TextureResource> CreateTextureFromFile(const std::string& texturePath)
 {
 	auto s2ws = [](const std::string& s)
@@ -826,7 +916,15 @@ std::unique_ptr<TextureResource> CreateTextureFromFile(const std::string& textur
 		};
 
 	std::unique_ptr<DirectX::ScratchImage> imageData = std::make_unique<DirectX::ScratchImage>();
-	HRESULT loadResult = DirectX::LoadFromDDSFile(s2ws(texturePath).c_str(), DirectX::DDS_FLAGS_NONE, nullptr, *imageData);
+	HRESULT loadResult = E_FAIL;
+	if (const AssetPackEntry* cookedTexture = ogRHI.cookedAssets.Find(MakeTextureAssetName(texturePath)))
+	{
+		loadResult = DirectX::LoadFromDDSMemory(ogRHI.cookedAssets.GetData(*cookedTexture), cookedTexture->size, DirectX::DDS_FLAGS_NONE, nullptr, *imageData);
+	}
+	else
+	{
+		loadResult = DirectX::LoadFromDDSFile(s2ws(texturePath).c_str(), DirectX::DDS_FLAGS_NONE, nullptr, *imageData);
+	}
 	assert(loadResult == S_OK);
 
 	const DirectX::TexMetadata& textureMetaData = imageData->GetMetadata();
@@ -892,28 +990,53 @@ std::unique_ptr<TextureResource> CreateTextureFromFile(const std::string& textur
 	return newTexture;
 }
 //=============================================================================
-std::unique_ptr<Shader> CreateShader(const ShaderCreationDesc& desc)
+std::unique_ptr<Shader> CreateShaderFromCookedAsset(const AssetPackEntry& cookedShader)
 {
-	IDxcUtils* dxcUtils = nullptr;
-	IDxcCompiler3* dxcCompiler = nullptr;
-	IDxcIncludeHandler* dxcIncludeHandler = nullptr;
-
+	ComPtr<IDxcUtils> dxcUtils;
 	DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&dxcUtils));
-	DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&dxcCompiler));
-	dxcUtils->CreateDefaultIncludeHandler(&dxcIncludeHandler);
 
-	std::wstring sourcePath;
-	sourcePath.append(SHADER_SOURCE_PATH);
-	sourcePath.append(desc.shaderName);
+	ComPtr<IDxcBlobEncoding> shaderBlob;
+	HRESULT result = dxcUtils->CreateBlob(ogRHI.cookedAssets.GetData(cookedShader), static_cast<uint32_t>(cookedShader.size), DXC_CP_ACP, &shaderBlob);
+	if (FAILED(result))
+	{
+		Fatal("IDxcUtils::CreateBlob() failed: " + DXErrorToStr(result));
+		return nullptr;
+	}
 
-	IDxcBlobEncoding* sourceBlobEncoding = nullptr;
-	dxcUtils->LoadFile(sourcePath.c_str(), nullptr, &sourceBlobEncoding);
+	std::unique_ptr<Shader> shader = std::make_unique<Shader>();
+	shader->shaderBlob = shaderBlob;
+	if (!ParseDXILReflection(shaderBlob->GetBufferPointer(), shaderBlob->GetBufferSize(), shader->reflection))
+	{
+		Fatal("Failed to read resource bindings of cooked shader " + cookedShader.name);
+		return nullptr;
+	}
 
-	DxcBuffer sourceBuffer{};
-	sourceBuffer.Ptr = sourceBlobEncoding->GetBufferPointer();
-	sourceBuffer.Size = sourceBlobEncoding->GetBufferSize();
-	sourceBuffer.Encoding = DXC_CP_ACP;
+	return shader;
+}
+//=============================================================================
+// The DXIL of an earlier compilation of the same source, defines and target, or nullptr
+std::unique_ptr<Shader> CreateShaderFromCache(const std::wstring& dxilPath, const std::wstring& layoutPath, uint64_t sourceHash)
+{
+	std::unique_ptr<Shader> shader = std::make_unique<Shader>();
+	if (!LoadShaderReflection(layoutPath, sourceHash, shader->reflection)) return nullptr;
+
+	ComPtr<IDxcUtils> dxcUtils;
+	DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&dxcUtils));
+
+	ComPtr<IDxcBlobEncoding> shaderBlob;
+	if (FAILED(dxcUtils->LoadFile(dxilPath.c_str(), nullptr, &shaderBlob))) return nullptr;
+
+	// the cache describes the DXIL it was written with, not whatever is in the file now
+	std::array<uint8_t, 16> digest{};
+	std::vector<DXILContainerPart> parts;
+	if (!ParseDXILContainerParts(shaderBlob->GetBufferPointer(), shaderBlob->GetBufferSize(), digest, parts) || digest != shader->reflection.digest) return nullptr;
 
+	shader->shaderBlob = shaderBlob;
+	return shader;
+}
+//=============================================================================
+std::unique_ptr<Shader> CreateShader(const ShaderCreationDesc& desc)
+{
 	LPCWSTR target = nullptr;
 
 	switch (desc.type)
@@ -929,11 +1052,78 @@ std::unique_ptr<Shader> CreateShader(const ShaderCreationDesc& desc)
 		break;
 	default:
 		Fatal("Unimplemented shader type.");
-		break;
+		return nullptr;
+	}
+
+	std::vector<std::wstring> defines;
+	defines.reserve(desc.defines.size());
+	for (const ShaderDefine& define : desc.defines)
+	{
+		defines.push_back(define.value.empty() ? define.name : define.name + L"=" + define.value);
+	}
+
+	uint64_t sourceHash = 0;
+	const bool hasSource = HashShaderSource(SHADER_SOURCE_PATH, desc.shaderName, desc.entryPoint, target, defines, sourceHash);
+
+	if (const AssetPackEntry* cookedShader = ogRHI.cookedAssets.Find(MakeShaderAssetName(desc.shaderName, desc.entryPoint, desc.variantName, defines)))
+	{
+		// A pack cooked before the source was edited is stale, compile the source instead. Without the sources (a shipped build)
+		// the pack is the only input and is trusted.
+		if (!hasSource || sourceHash == cookedShader->sourceHash)
+		{
+			return CreateShaderFromCookedAsset(*cookedShader);
+		}
+		Warning("Cooked shader " + cookedShader->name + " is out of date, run the Cooker again");
+	}
+
+	std::wstring dxilPath;
+	std::wstring pdbPath;
+
+	dxilPath.append(SHADER_OUTPUT_PATH);
+	dxilPath.append(desc.shaderName);
+	dxilPath.erase(dxilPath.end() - 5, dxilPath.end());
+	dxilPath.append(L"_");
+	dxilPath.append(desc.entryPoint);
+	if (!desc.variantName.empty())
+	{
+		dxilPath.append(L"_");
+		dxilPath.append(desc.variantName);
+	}
+	dxilPath.append(L".dxil");
+
+	pdbPath = dxilPath;
+	pdbPath.append(L".pdb");
+
+	std::wstring layoutPath = dxilPath;
+	layoutPath.append(L".layout");
+
+	if (hasSource)
+	{
+		if (std::unique_ptr<Shader> cachedShader = CreateShaderFromCache(dxilPath, layoutPath, sourceHash)) return cachedShader;
 	}
 
+	IDxcUtils* dxcUtils = nullptr;
+	IDxcCompiler3* dxcCompiler = nullptr;
+	IDxcIncludeHandler* dxcIncludeHandler = nullptr;
+
+	DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&dxcUtils));
+	DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&dxcCompiler));
+	dxcUtils->CreateDefaultIncludeHandler(&dxcIncludeHandler);
+
+	std::wstring sourcePath;
+	sourcePath.append(SHADER_SOURCE_PATH);
+	sourcePath.append(desc.shaderName);
+
+	IDxcBlobEncoding* sourceBlobEncoding = nullptr;
+	dxcUtils->LoadFile(sourcePath.c_str(), nullptr, &sourceBlobEncoding);
+
+	DxcBuffer sourceBuffer{};
+	sourceBuffer.Ptr = sourceBlobEncoding->GetBufferPointer();
+	sourceBuffer.Size = sourceBlobEncoding->GetBufferSize();
+	sourceBuffer.Encoding = DXC_CP_ACP;
+
 	std::vector<LPCWSTR> arguments;
-	arguments.reserve(8);
+	arguments.reserve(8 + defines.size() * 2);
 
 	arguments.push_back(desc.shaderName.c_str());
 	arguments.push_back(L"-E");
@@ -943,6 +1133,11 @@ std::unique_ptr<Shader> CreateShader(const ShaderCreationDesc& desc)
 	arguments.push_back(L"-Zi");
 	arguments.push_back(L"-WX");
 	arguments.push_back(L"-Qstrip_reflect");
+	for (const std::wstring& define : defines)
+	{
+		arguments.push_back(L"-D");
+		arguments.push_back(define.c_str());
+	}
 
 	IDxcResult* compilationResults = nullptr;
 	dxcCompiler->Compile(&sourceBuffer, arguments.data(), static_cast<uint32_t>(arguments.size()), dxcIncludeHandler, IID_PPV_ARGS(&compilationResults));
@@ -968,17 +1163,6 @@ std::unique_ptr<Shader> CreateShader(const ShaderCreationDesc& desc)
 		Fatal("Shader compilation failed");
 	}
 
-	std::wstring dxilPath;
-	std::wstring pdbPath;
-
-	dxilPath.append(SHADER_OUTPUT_PATH);
-	dxilPath.append(desc.shaderName);
-	dxilPath.erase(dxilPath.end() - 5, dxilPath.end());
-	dxilPath.append(L".dxil");
-
-	pdbPath = dxilPath;
-	pdbPath.append(L".pdb");
-
 	IDxcBlob* shaderBlob = nullptr;
 	compilationResults->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&shaderBlob), nullptr);
 	if (shaderBlob != nullptr)
@@ -1012,29 +1196,45 @@ std::unique_ptr<Shader> CreateShader(const ShaderCreationDesc& desc)
 	dxcCompiler->Release();
 	dxcUtils->Release();
 
+	if (!shaderBlob)
+	{
+		return nullptr;
+	}
+
 	std::unique_ptr<Shader> shader = std::make_unique<Shader>();
 	shader->shaderBlob = shaderBlob;
 
+	if (!ParseDXILReflection(shaderBlob->GetBufferPointer(), shaderBlob->GetBufferSize(), shader->reflection))
+	{
+		Fatal("Failed to read resource bindings of shader " + std::string(desc.shaderName.begin(), desc.shaderName.end()));
+		return nullptr;
+	}
+
+	// without the hash of the source the next run could not tell a stale cache apart, it compiles again
+	if (hasSource && !SaveShaderReflection(layoutPath, sourceHash, shader->reflection))
+	{
+		Warning("Failed to write shader reflection cache " + std::string(layoutPath.begin(), layoutPath.end()));
+	}
+
 	return shader;
 }
 //=============================================================================
-ID3D12RootSignature* CreateRootSignature(const PipelineResourceLayout& layout, PipelineResourceMapping& resourceMapping)
+ComPtr<ID3D12RootSignature> CreateRootSignature(const ShaderResourceLayout& layout, PipelineResourceMapping& resourceMapping)
 {
 	std::vector<D3D12_ROOT_PARAMETER1> rootParameters;
 	std::array<std::vector<D3D12_DESCRIPTOR_RANGE1>, NUM_RESOURCE_SPACES> desciptorRanges;
 
 	for (uint32_t spaceId = 0; spaceId < NUM_RESOURCE_SPACES; spaceId++)
 	{
-		PipelineResourceSpace* currentSpace = layout.spaces[spaceId];
+		const ShaderResourceSpaceLayout& currentSpace = layout.spaces[spaceId];
 		std::vector<D3D12_DESCRIPTOR_RANGE1>& currentDescriptorRange = desciptorRanges[spaceId];
 
-		if (currentSpace)
+		if (!currentSpace.IsEmpty())
 		{
-			const BufferResource* cbv = currentSpace->GetCBV();
-			auto& uavs = currentSpace->GetUAVs();
-			auto& srvs = currentSpace->GetSRVs();
+			const auto& uavs = currentSpace.UAVBindings;
+			const auto& srvs = currentSpace.SRVBindings;
 
-			if (cbv)
+			if (currentSpace.hasCBV)
 			{
 				D3D12_ROOT_PARAMETER1 rootParameter{};
 				rootParameter.ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
@@ -1051,10 +1251,10 @@ ID3D12RootSignature* CreateRootSignature(const PipelineResourceLayout& layout, P
 				continue;
 			}
 
-			for (auto& uav : uavs)
+			for (uint32_t uav : uavs)
 			{
 				D3D12_DESCRIPTOR_RANGE1 range{};
-				range.BaseShaderRegister = uav.bindingIndex;
+				range.BaseShaderRegister = uav;
 				range.NumDescriptors = 1;
 				range.OffsetInDescriptorsFromTableStart = static_cast<uint32_t>(currentDescriptorRange.size());
 				range.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_UAV;
@@ -1064,10 +1264,10 @@ ID3D12RootSignature* CreateRootSignature(const PipelineResourceLayout& layout, P
 				currentDescriptorRange.push_back(range);
 			}
 
-			for (auto& srv : srvs)
+			for (uint32_t srv : srvs)
 			{
 				D3D12_DESCRIPTOR_RANGE1 range{};
-				range.BaseShaderRegister = srv.bindingIndex;
+				range.BaseShaderRegister = srv;
 				range.NumDescriptors = 1;
 				range.OffsetInDescriptorsFromTableStart = static_cast<uint32_t>(currentDescriptorRange.size());
 				range.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
@@ -1105,7 +1305,7 @@ ID3D12RootSignature* CreateRootSignature(const PipelineResourceLayout& layout, P
 		return nullptr;
 	}
 
-	ID3D12RootSignature* rootSignature = nullptr;
+	ComPtr<ID3D12RootSignature> rootSignature;
 	result = ogRHI.device->CreateRootSignature(0, rootSignatureBlob->GetBufferPointer(), rootSignatureBlob->GetBufferSize(), IID_PPV_ARGS(&rootSignature));
 	if (FAILED(result))
 	{
@@ -1116,7 +1316,57 @@ ID3D12RootSignature* CreateRootSignature(const PipelineResourceLayout& layout, P
 	return rootSignature;
 }
 //=============================================================================
-std::unique_ptr<PipelineStateObject> CreateGraphicsPipeline(const GraphicsPipelineDesc& desc, const PipelineResourceLayout& layout)
+ID3D12RootSignature* GetOrCreateRootSignature(const ShaderResourceLayout& layout, PipelineResourceMapping& resourceMapping)
+{
+	const size_t layoutHash = layout.Hash();
+	auto range = ogRHI.rootSignatureCache.equal_range(layoutHash);
+	for (auto it = range.first; it != range.second; ++it)
+	{
+		if (it->second.layout == layout)
+		{
+			resourceMapping = it->second.resourceMapping;
+			return it->second.rootSignature.Get();
+		}
+	}
+
+	RootSignatureCacheEntry entry;
+	entry.layout = layout;
+	entry.rootSignature = CreateRootSignature(layout, entry.resourceMapping);
+	if (!entry.rootSignature) return nullptr;
+
+	resourceMapping = entry.resourceMapping;
+	return ogRHI.rootSignatureCache.emplace(layoutHash, std::move(entry))->second.rootSignature.Get();
+}
+//=============================================================================
+bool GetShaderResourceLayout(const GraphicsPipelineDesc& desc, ShaderResourceLayout& layout)
+{
+	if (desc.vertexShader && !MakeShaderResourceLayout(desc.vertexShader->reflection, layout)) return false;
+	if (desc.pixelShader && !MakeShaderResourceLayout(desc.pixelShader->reflection, layout)) return false;
+	return true;
+}
+//=============================================================================
+#if RHI_VALIDATION_ENABLED
+// Every binding used by the shaders has to be present in the user layout, otherwise the descriptor tables do not line up with the HLSL.
+bool IsResourceLayoutCompatible(const ShaderResourceLayout& providedLayout, const ShaderResourceLayout& shaderLayout)
+{
+	auto containsAll = [](const std::vector<uint32_t>& provided, const std::vector<uint32_t>& required)
+	{
+		return std::includes(provided.begin(), provided.end(), required.begin(), required.end());
+	};
+
+	for (uint32_t spaceId = 0; spaceId < NUM_RESOURCE_SPACES; spaceId++)
+	{
+		const ShaderResourceSpaceLayout& provided = providedLayout.spaces[spaceId];
+		const ShaderResourceSpaceLayout& required = shaderLayout.spaces[spaceId];
+		if (required.hasCBV && !provided.hasCBV) return false;
+		if (!containsAll(provided.UAVBindings, required.UAVBindings)) return false;
+		if (!containsAll(provided.SRVBindings, required.SRVBindings)) return false;
+	}
+	return true;
+}
+#endif // RHI_VALIDATION_ENABLED
+//=============================================================================
+std::unique_ptr<PipelineStateObject> CreateGraphicsPipeline(const GraphicsPipelineDesc& desc, const ShaderResourceLayout& layout)
 {
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC pipelineDesc{};
 	pipelineDesc.NodeMask = 0;
@@ -1150,8 +1400,10 @@ std::unique_ptr<PipelineStateObject> CreateGraphicsPipeline(const GraphicsPipeli
 
 	std::unique_ptr<PipelineStateObject> newPipeline = std::make_unique<PipelineStateObject>();
 	newPipeline->pipelineType = PipelineType::graphics;
+	newPipeline->resourceLayout = layout;
 
-	pipelineDesc.pRootSignature = CreateRootSignature(layout, newPipeline->pipelineResourceMapping);
+	pipelineDesc.pRootSignature = GetOrCreateRootSignature(layout, newPipeline->pipelineResourceMapping);
+	if (!pipelineDesc.pRootSignature) return nullptr;
 
 	ID3D12PipelineState* graphicsPipeline = nullptr;
 	HRESULT result = ogRHI.device->CreateGraphicsPipelineState(&pipelineDesc, IID_PPV_ARGS(&graphicsPipeline));
@@ -1167,16 +1419,18 @@ std::unique_ptr<PipelineStateObject> CreateGraphicsPipeline(const GraphicsPipeli
 	return newPipeline;
 }
 //=============================================================================
-std::unique_ptr<PipelineStateObject> CreateComputePipeline(const ComputePipelineDesc& desc, const PipelineResourceLayout& layout)
+std::unique_ptr<PipelineStateObject> CreateComputePipeline(const ComputePipelineDesc& desc, const ShaderResourceLayout& layout)
 {
 	std::unique_ptr<PipelineStateObject> newPipeline = std::make_unique<PipelineStateObject>();
 	newPipeline->pipelineType = PipelineType::compute;
+	newPipeline->resourceLayout = layout;
 
 	D3D12_COMPUTE_PIPELINE_STATE_DESC pipelineDesc{};
 	pipelineDesc.NodeMask = 0;
 	pipelineDesc.CS.pShaderBytecode = desc.computeShader->shaderBlob->GetBufferPointer();
 	pipelineDesc.CS.BytecodeLength = desc.computeShader->shaderBlob->GetBufferSize();
-	pipelineDesc.pRootSignature = CreateRootSignature(layout, newPipeline->pipelineResourceMapping);
+	pipelineDesc.pRootSignature = GetOrCreateRootSignature(layout, newPipeline->pipelineResourceMapping);
+	if (!pipelineDesc.pRootSignature) return nullptr;
 
 	ID3D12PipelineState* computePipeline = nullptr;
 	HRESULT result = ogRHI.device->CreateComputePipelineState(&pipelineDesc, IID_PPV_ARGS(&computePipeline));
@@ -1192,6 +1446,78 @@ std::unique_ptr<PipelineStateObject> CreateComputePipeline(const ComputePipeline
 	return newPipeline;
 }
 //=============================================================================
+std::unique_ptr<PipelineStateObject> CreateGraphicsPipeline(const GraphicsPipelineDesc& desc)
+{
+	ShaderResourceLayout layout;
+	if (!GetShaderResourceLayout(desc, layout))
+	{
+		Fatal("Failed to build the pipeline resource layout from shader reflection");
+		return nullptr;
+	}
+
+	return CreateGraphicsPipeline(desc, layout);
+}
+//=============================================================================
+std::unique_ptr<PipelineStateObject> CreateGraphicsPipeline(const GraphicsPipelineDesc& desc, const PipelineResourceLayout& layout)
+{
+	const ShaderResourceLayout providedLayout = MakeShaderResourceLayout(layout);
+
+#if RHI_VALIDATION_ENABLED
+	ShaderResourceLayout shaderLayout;
+	if (GetShaderResourceLayout(desc, shaderLayout) && !IsResourceLayoutCompatible(providedLayout, shaderLayout))
+	{
+		Warning("PipelineResourceLayout does not match the resources used by the shaders");
+	}
+#endif // RHI_VALIDATION_ENABLED
+
+	// The declared layout merged with the reflected one: the root signature has every binding the shaders use, and the bindings
+	// the user declared stay in the layout even when DXC stripped them.
+	ShaderResourceLayout pipelineLayout = providedLayout;
+	if (!GetShaderResourceLayout(desc, pipelineLayout))
+	{
+		Fatal("Failed to build the pipeline resource layout from shader reflection");
+		return nullptr;
+	}
+
+	return CreateGraphicsPipeline(desc, pipelineLayout);
+}
+//=============================================================================
+std::unique_ptr<PipelineStateObject> CreateComputePipeline(const ComputePipelineDesc& desc)
+{
+	ShaderResourceLayout layout;
+	if (!MakeShaderResourceLayout(desc.computeShader->reflection, layout))
+	{
+		Fatal("Failed to build the pipeline resource layout from shader reflection");
+		return nullptr;
+	}
+
+	return CreateComputePipeline(desc, layout);
+}
+//=============================================================================
+std::unique_ptr<PipelineStateObject> CreateComputePipeline(const ComputePipelineDesc& desc, const PipelineResourceLayout& layout)
+{
+	const ShaderResourceLayout providedLayout = MakeShaderResourceLayout(layout);
+
+#if RHI_VALIDATION_ENABLED
+	ShaderResourceLayout shaderLayout;
+	if (MakeShaderResourceLayout(desc.computeShader->reflection, shaderLayout) && !IsResourceLayoutCompatible(providedLayout, shaderLayout))
+	{
+		Warning("PipelineResourceLayout does not match the resources used by the shader");
+	}
+#endif // RHI_VALIDATION_ENABLED
+
+	// The declared layout merged with the reflected one: the root signature has every binding the shader uses, and the bindings
+	// the user declared stay in the layout even when DXC stripped them.
+	ShaderResourceLayout pipelineLayout = providedLayout;
+	if (!MakeShaderResourceLayout(desc.computeShader->reflection, pipelineLayout))
+	{
+		Fatal("Failed to build the pipeline resource layout from shader reflection");
+		return nullptr;
+	}
+
+	return CreateComputePipeline(desc, pipelineLayout);
+}
+//=============================================================================
 std::unique_ptr<GraphicsCommandContextD3D12> CreateGraphicsContext()
 {
 	std::unique_ptr<GraphicsCommandContextD3D12> newGraphicsContext = std::make_unique<GraphicsCommandContextD3D12>();
@@ -7,6 +7,8 @@
 #include "oRHIBackendD3D12.h"
 #include "oCommandQueueD3D12.h"
 #include "DescriptorHeapD3D12.h"
+#include "AssetPack.h"
+#include "GPUProfilerD3D12.h"
 
 struct WindowData;
 
@@ -18,6 +20,13 @@ struct DestructionQueue final
 	std::vector<std::unique_ptr<CommandContextD3D12>> contextsToDestroy;
 };
 
+struct RootSignatureCacheEntry final
+{
+	ShaderResourceLayout        layout;
+	PipelineResourceMapping     resourceMapping;
+	ComPtr<ID3D12RootSignature> rootSignature;
+};
+
 class oRHIBackend final
 {
 public:
@@ -27,9 +36,12 @@ public:
 	void DestroyAPI();
 
 	void ResizeFrameBuffer(uint32_t width, uint32_t height);
+	// EngineApp::BeginFrame() waited on the frame latency of the swap chain already, see RenderSystem::WaitForFrameLatency()
 	void BeginFrame();
 	void EndFrame();
 	void Present();
+	bool WaitForFrameLatency(DWORD timeout = 1000);
+	[[nodiscard]] bool IsCreated() const { return swapChain != nullptr; }
 
 	uint32_t GetCurrentBackBufferIndex() const { return currentBackBufferIndex; }
 	RenderPassDescriptorHeapD3D12& GetSamplerHeap() { return *samplerRenderPassDescriptorHeap; }
@@ -60,6 +72,8 @@ public:
 	uint32_t                     frameBufferWidth{ 0 };
 	uint32_t                     frameBufferHeight{ 0 };
 	uint32_t                     currentBackBufferIndex{ 0 }; // TODO: юзать swapChain->GetCurrentBackBufferIndex()
+	HANDLE                       frameLatencyWaitableObject{ nullptr };
+	uint32_t                     maxFrameLatency{ 2 };
 
 
 
@@ -74,6 +88,18 @@ public:
 	std::array<std::vector<std::pair<uint64_t, D3D12_COMMAND_LIST_TYPE>>, NUM_FRAMES_IN_FLIGHT> contextSubmissions;
 	std::array<DestructionQueue, NUM_FRAMES_IN_FLIGHT> destructionQueues;
 
+	// Pipelines with the same resource layout share one root signature. Keyed by ShaderResourceLayout::Hash().
+	std::unordered_multimap<size_t, RootSignatureCacheEntry> rootSignatureCache;
+
+	// Output of the Cooker tool. When an asset is found here, it is used instead of compiling or decoding the source file.
+	AssetPack                    cookedAssets;
+
+#if ENABLE_PROFILER
+	// Timestamps of ScopedGPUMarker on the graphics and compute queues
+	GPUTimestampDeviceD3D12      gpuTimestampDevice;
+	GPUProfiler                  gpuProfiler;
+#endif
+
 private:
 	void enableDebugLayer();
 	bool createAdapter();
@@ -84,6 +110,7 @@ private:
 	bool createDescriptorHeap();
 	bool createSwapChain(const WindowData& wndData);
 	bool createMainRenderTarget();
+	bool createGPUProfiler();
 	void destroyMainRenderTarget();
 	void release();
 };
@@ -93,10 +120,18 @@ extern oRHIBackend ogRHI;
 // TODO: рассортировать
 
 std::unique_ptr<BufferResource>      CreateBuffer(const BufferCreationDesc& desc);
-std::unique_ptr<TextureResource>     CreateTexture(const TextureCreationDesc& desc);
+// With placementHeap the texture is placed at placementOffset into that memory instead of getting its own, textures placed into
+// overlapping memory alias each other
+std::unique_ptr<TextureResource>     CreateTexture(const TextureCreationDesc& desc, D3D12MA::Allocation* placementHeap = nullptr, uint64_t placementOffset = 0);
+D3D12_RESOURCE_ALLOCATION_INFO       GetTextureAllocationInfo(const TextureCreationDesc& desc);
 std::unique_ptr<TextureResource>     CreateTextureFromFile(const std::string& texturePath);
 std::unique_ptr<Shader>              CreateShader(const ShaderCreationDesc& desc);
+// The resource layout is taken from the shader reflection
+std::unique_ptr<PipelineStateObject> CreateGraphicsPipeline(const GraphicsPipelineDesc& desc);
+std::unique_ptr<PipelineStateObject> CreateGraphicsPipeline(const GraphicsPipelineDesc& desc, const ShaderResourceLayout& layout);
 std::unique_ptr<PipelineStateObject> CreateGraphicsPipeline(const GraphicsPipelineDesc& desc, const PipelineResourceLayout& layout);
+std::unique_ptr<PipelineStateObject> CreateComputePipeline(const ComputePipelineDesc& desc);
+std::unique_ptr<PipelineStateObject> CreateComputePipeline(const ComputePipelineDesc& desc, const ShaderResourceLayout& layout);
 std::unique_ptr<PipelineStateObject> CreateComputePipeline(const ComputePipelineDesc& desc, const PipelineResourceLayout& layout);
 std::unique_ptr<GraphicsCommandContextD3D12>     CreateGraphicsContext();
 std::unique_ptr<ComputeCommandContextD3D12>      CreateComputeContext();
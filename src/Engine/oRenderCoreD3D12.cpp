@@ -99,4 +99,98 @@ uint32_t PipelineResourceSpace::getIndexOfBindingIndex(const std::vector<Pipelin
 	return UINT_MAX;
 }
 //=============================================================================
+size_t ShaderResourceLayout::Hash() const
+{
+	size_t hash = 0;
+	auto hashCombine = [&hash](size_t value)
+	{
+		hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+	};
+
+	for (const ShaderResourceSpaceLayout& space : spaces)
+	{
+		hashCombine(space.hasCBV);
+		hashCombine(space.UAVBindings.size());
+		for (uint32_t binding : space.UAVBindings) hashCombine(binding);
+		hashCombine(space.SRVBindings.size());
+		for (uint32_t binding : space.SRVBindings) hashCombine(binding);
+	}
+
+	return hash;
+}
+//=============================================================================
+ShaderResourceSpaceLayout MakeShaderResourceSpaceLayout(const PipelineResourceSpace& space)
+{
+	ShaderResourceSpaceLayout spaceLayout;
+	spaceLayout.hasCBV = space.GetCBV() != nullptr;
+	for (const PipelineResourceBinding& uav : space.GetUAVs()) spaceLayout.UAVBindings.push_back(uav.bindingIndex);
+	for (const PipelineResourceBinding& srv : space.GetSRVs()) spaceLayout.SRVBindings.push_back(srv.bindingIndex);
+	return spaceLayout;
+}
+//=============================================================================
+ShaderResourceLayout MakeShaderResourceLayout(const PipelineResourceLayout& layout)
+{
+	ShaderResourceLayout shaderLayout;
+	for (uint32_t spaceId = 0; spaceId < NUM_RESOURCE_SPACES; spaceId++)
+	{
+		if (layout.spaces[spaceId])
+		{
+			shaderLayout.spaces[spaceId] = MakeShaderResourceSpaceLayout(*layout.spaces[spaceId]);
+		}
+	}
+	return shaderLayout;
+}
+//=============================================================================
+bool MakeShaderResourceLayout(const ShaderReflectionData& reflection, ShaderResourceLayout& layout)
+{
+	auto addBinding = [](std::vector<uint32_t>& bindings, uint32_t bindingIndex)
+	{
+		auto it = std::lower_bound(bindings.begin(), bindings.end(), bindingIndex);
+		if (it == bindings.end() || *it != bindingIndex)
+		{
+			bindings.insert(it, bindingIndex);
+		}
+	};
+
+	for (const ShaderResourceBindingDesc& binding : reflection.bindings)
+	{
+		// Samplers are accessed through SamplerDescriptorHeap and do not take part in the root signature.
+		if (binding.type == ShaderBindingType::sampler) continue;
+
+		if (binding.space >= NUM_RESOURCE_SPACES)
+		{
+			Error("Shader binding uses space" + std::to_string(binding.space) + ", only " + std::to_string(NUM_RESOURCE_SPACES) + " resource spaces are supported");
+			return false;
+		}
+		if (binding.upperBound == DXIL_UNBOUNDED_RANGE)
+		{
+			Error("Unbounded resource arrays are not supported, use ResourceDescriptorHeap instead");
+			return false;
+		}
+
+		ShaderResourceSpaceLayout& spaceLayout = layout.spaces[binding.space];
+		switch (binding.type)
+		{
+		case ShaderBindingType::cbv:
+			if (binding.lowerBound != 0 || binding.upperBound != 0)
+			{
+				Error("Only one constant buffer at register b0 is supported per resource space");
+				return false;
+			}
+			spaceLayout.hasCBV = true;
+			break;
+		case ShaderBindingType::srv:
+			for (uint32_t bindingIndex = binding.lowerBound; bindingIndex <= binding.upperBound; bindingIndex++) addBinding(spaceLayout.SRVBindings, bindingIndex);
+			break;
+		case ShaderBindingType::uav:
+			for (uint32_t bindingIndex = binding.lowerBound; bindingIndex <= binding.upperBound; bindingIndex++) addBinding(spaceLayout.UAVBindings, bindingIndex);
+			break;
+		default:
+			break;
+		}
+	}
+
+	return true;
+}
+//=============================================================================
 #endif // RENDER_D3D12
\ No newline at end of file
@@ -4,6 +4,7 @@
 
 #include "RenderCore.h"
 #include "RHICoreD3D12.h"
+#include "DXILContainer.h"
 
 constexpr uint32_t    NUM_FRAMES_IN_FLIGHT = 2;
 constexpr uint32_t    oNUM_RTV_STAGING_DESCRIPTORS = 256;
@@ -225,6 +226,30 @@ struct PipelineResourceLayout final
 	std::array<PipelineResourceSpace*, NUM_RESOURCE_SPACES> spaces{ nullptr };
 };
 
+// Shape of a resource space as seen by the root signature: which bindings exist, without the resources bound to them.
+struct ShaderResourceSpaceLayout final
+{
+	bool                  hasCBV{ false };
+	std::vector<uint32_t> UAVBindings; // sorted
+	std::vector<uint32_t> SRVBindings; // sorted
+
+	bool IsEmpty() const { return !hasCBV && UAVBindings.empty() && SRVBindings.empty(); }
+	bool operator==(const ShaderResourceSpaceLayout&) const = default;
+};
+
+struct ShaderResourceLayout final
+{
+	std::array<ShaderResourceSpaceLayout, NUM_RESOURCE_SPACES> spaces{};
+
+	size_t Hash() const;
+	bool operator==(const ShaderResourceLayout&) const = default;
+};
+
+ShaderResourceSpaceLayout MakeShaderResourceSpaceLayout(const PipelineResourceSpace& space);
+ShaderResourceLayout MakeShaderResourceLayout(const PipelineResourceLayout& layout);
+// Adds the reflected bindings of one shader stage to the layout, call it once per stage. Returns false if a binding can not be expressed by the root signature of this backend.
+[[nodiscard]] bool MakeShaderResourceLayout(const ShaderReflectionData& reflection, ShaderResourceLayout& layout);
+
 struct RenderTargetDesc final
 {
 	std::array<DXGI_FORMAT, D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT> renderTargetFormats{ DXGI_FORMAT_UNKNOWN };
@@ -232,16 +257,25 @@ struct RenderTargetDesc final
 	DXGI_FORMAT depthStencilFormat{ DXGI_FORMAT_UNKNOWN };
 };
 
+struct ShaderDefine final
+{
+	std::wstring name;
+	std::wstring value;
+};
+
 struct ShaderCreationDesc final
 {
-	std::wstring shaderName;
-	std::wstring entryPoint;
-	ShaderType   type{ ShaderType::compute };
+	std::wstring              shaderName;
+	std::wstring              entryPoint;
+	ShaderType                type{ ShaderType::compute };
+	std::vector<ShaderDefine> defines;
+	std::wstring              variantName; // appended to the compiled file name so that variants of one entry point do not overwrite each other
 };
 
 struct Shader final
 {
-	ComPtr<IDxcBlob> shaderBlob;
+	ComPtr<IDxcBlob>     shaderBlob;
+	ShaderReflectionData reflection;
 };
 
 struct GraphicsPipelineDesc final
@@ -323,6 +357,7 @@ struct PipelineStateObject final
 	ComPtr<ID3D12RootSignature> rootSignature;
 	PipelineType                pipelineType{ PipelineType::graphics };
 	PipelineResourceMapping     pipelineResourceMapping;
+	ShaderResourceLayout        resourceLayout;
 };
 
 struct PipelineInfo final
@@ -73,16 +73,13 @@ void ExampleRender001()
 			mTrianglePerObjectSpace.SetCBV(mTriangleConstantBuffer.get());
 			mTrianglePerObjectSpace.Lock();
 
-			PipelineResourceLayout resourceLayout;
-			resourceLayout.spaces[PER_OBJECT_SPACE] = &mTrianglePerObjectSpace;
-
 			GraphicsPipelineDesc trianglePipelineDesc = GetDefaultGraphicsPipelineDesc();
 			trianglePipelineDesc.vertexShader = mTriangleVertexShader.get();
 			trianglePipelineDesc.pixelShader = mTrianglePixelShader.get();
 			trianglePipelineDesc.renderTargetDesc.numRenderTargets = 1;
 			trianglePipelineDesc.renderTargetDesc.renderTargetFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
 
-			mTrianglePSO = CreateGraphicsPipeline(trianglePipelineDesc, resourceLayout);
+			mTrianglePSO = CreateGraphicsPipeline(trianglePipelineDesc);
 		}
 
 		while (!engine.IsShouldClose())
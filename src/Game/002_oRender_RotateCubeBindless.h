@@ -1,4 +1,6 @@
 ﻿#include "stdafx.h"
+#include "Engine/RenderGraphD3D12.h"
+#include "Engine/ShaderPermutation.h"
 
 void ExampleRender002()
 {
@@ -29,15 +31,13 @@ void ExampleRender002()
 			glm::vec3 cameraPosition;
 		};
 
-		std::unique_ptr<TextureResource> mDepthBuffer;
 		std::unique_ptr<TextureResource> mWoodTexture;
 		std::unique_ptr<BufferResource> mMeshVertexBuffer;
 		std::array<std::unique_ptr<BufferResource>, NUM_FRAMES_IN_FLIGHT> mMeshConstantBuffers;
 		std::unique_ptr<BufferResource> mMeshPassConstantBuffer;
 		PipelineResourceSpace mMeshPerObjectResourceSpace;
 		PipelineResourceSpace mMeshPerPassResourceSpace;
-		std::unique_ptr<Shader> mMeshVertexShader;
-		std::unique_ptr<Shader> mMeshPixelShader;
+		ShaderPermutationLibrary mShaderLibrary;
 		std::unique_ptr<PipelineStateObject> mMeshPSO;
 
 		// InitializeMeshResources
@@ -135,14 +135,6 @@ void ExampleRender002()
 			mMeshPassConstantBuffer = CreateBuffer(meshPassConstantDesc);
 			mMeshPassConstantBuffer->SetMappedData(&passConstants, sizeof(MeshPassConstants));
 
-			TextureCreationDesc depthBufferDesc;
-			depthBufferDesc.resourceDesc.Format = DXGI_FORMAT_D32_FLOAT;
-			depthBufferDesc.resourceDesc.Width = screenSize.x;
-			depthBufferDesc.resourceDesc.Height = screenSize.y;
-			depthBufferDesc.viewFlags = TextureViewFlags::srv | TextureViewFlags::dsv;
-
-			mDepthBuffer = CreateTexture(depthBufferDesc);
-
 			ShaderCreationDesc meshShaderVSDesc;
 			meshShaderVSDesc.shaderName = L"Mesh.hlsl";
 			meshShaderVSDesc.entryPoint = L"VertexShader";
@@ -153,16 +145,19 @@ void ExampleRender002()
 			meshShaderPSDesc.entryPoint = L"PixelShader";
 			meshShaderPSDesc.type = ShaderType::pixel;
 
-			mMeshVertexShader = CreateShader(meshShaderVSDesc);
-			mMeshPixelShader = CreateShader(meshShaderPSDesc);
+			// Mesh.hlsl has no features yet, each set has the single variant 0. Prewarm creates the variants the last run used,
+			// from the cooked asset pack when the Cooker was run on the usage list.
+			ShaderPermutationSet* meshVertexShaders = mShaderLibrary.Register(meshShaderVSDesc, {});
+			ShaderPermutationSet* meshPixelShaders = mShaderLibrary.Register(meshShaderPSDesc, {});
+			if (!mShaderLibrary.Prewarm()) Warning("Failed to prewarm the shaders of " + std::string(SHADER_USAGE_LIST_PATH));
 
 			GraphicsPipelineDesc meshPipelineDesc = GetDefaultGraphicsPipelineDesc();
-			meshPipelineDesc.vertexShader = mMeshVertexShader.get();
-			meshPipelineDesc.pixelShader = mMeshPixelShader.get();
+			meshPipelineDesc.vertexShader = mShaderLibrary.GetVariant(meshVertexShaders, 0);
+			meshPipelineDesc.pixelShader = mShaderLibrary.GetVariant(meshPixelShaders, 0);
 			meshPipelineDesc.renderTargetDesc.numRenderTargets = 1;
 			meshPipelineDesc.renderTargetDesc.renderTargetFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
 			meshPipelineDesc.depthStencilDesc.DepthEnable = true;
-			meshPipelineDesc.renderTargetDesc.depthStencilFormat = depthBufferDesc.resourceDesc.Format;
+			meshPipelineDesc.renderTargetDesc.depthStencilFormat = DXGI_FORMAT_D32_FLOAT;
 			meshPipelineDesc.depthStencilDesc.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL;
 
 			mMeshPerObjectResourceSpace.SetCBV(mMeshConstantBuffers[0].get());
@@ -171,32 +166,48 @@ void ExampleRender002()
 			mMeshPerPassResourceSpace.SetCBV(mMeshPassConstantBuffer.get());
 			mMeshPerPassResourceSpace.Lock();
 
-			PipelineResourceLayout meshResourceLayout;
-			meshResourceLayout.spaces[PER_OBJECT_SPACE] = &mMeshPerObjectResourceSpace;
-			meshResourceLayout.spaces[PER_PASS_SPACE] = &mMeshPerPassResourceSpace;
-
-			mMeshPSO = CreateGraphicsPipeline(meshPipelineDesc, meshResourceLayout);
+			mMeshPSO = CreateGraphicsPipeline(meshPipelineDesc);
 		}
 
+		// The frame is a render graph: the depth buffer is a transient of the graph, the barriers of the back buffer and the
+		// depth buffer come from the accesses of the pass
+		RenderGraphD3D12 renderGraph;
+		if (!renderGraph.Create({})) return;
+
 		while (!engine.IsShouldClose())
 		{
 			engine.BeginFrame();
 
-			TextureResource& backBuffer = ogRHI.GetCurrentBackBuffer();
-
+			// resets the descriptor heap of the frame, the graph records into contexts of its own
 			ogRHI.graphicsContext->Reset();
-			ogRHI.graphicsContext->AddBarrier(backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
-			ogRHI.graphicsContext->AddBarrier(*mDepthBuffer, D3D12_RESOURCE_STATE_DEPTH_WRITE);
-			ogRHI.graphicsContext->FlushBarriers();
+			renderGraph.BeginFrame();
 
-			ogRHI.graphicsContext->ClearRenderTarget(backBuffer, glm::vec4(0.3f, 0.3f, 0.8f, 1.0f));
-			ogRHI.graphicsContext->ClearDepthStencilTarget(*mDepthBuffer, 1.0f, 0);
+			const glm::ivec2 screenSize = rhi.GetFrameBufferSize();
+			TextureCreationDesc depthBufferDesc;
+			depthBufferDesc.resourceDesc.Format = DXGI_FORMAT_D32_FLOAT;
+			depthBufferDesc.resourceDesc.Width = screenSize.x;
+			depthBufferDesc.resourceDesc.Height = screenSize.y;
+			depthBufferDesc.viewFlags = TextureViewFlags::srv | TextureViewFlags::dsv;
+
+			const RenderGraphResource backBuffer = renderGraph.ImportTexture("BackBuffer", ogRHI.GetCurrentBackBuffer(), D3D12_RESOURCE_STATE_PRESENT);
+			const RenderGraphResource depthBuffer = renderGraph.CreateTexture("DepthBuffer", depthBufferDesc);
 
 			static float rotation = 0.0f;
 			rotation += 0.01f;
 
-			if (mMeshVertexBuffer->isReady && mWoodTexture->isReady)
+			renderGraph.AddPass("Mesh", [&](RenderGraphPassBuilder& builder)
+			{
+				builder.Write(backBuffer, RenderGraphAccess::renderTarget);
+				builder.Write(depthBuffer, RenderGraphAccess::depthWrite);
+			},
+			[&](GraphicsCommandContextD3D12& context)
 			{
+				TextureResource& backBufferTexture = renderGraph.GetTexture(backBuffer);
+				TextureResource& depthBufferTexture = renderGraph.GetTexture(depthBuffer);
+				context.ClearRenderTarget(backBufferTexture, glm::vec4(0.3f, 0.3f, 0.8f, 1.0f));
+				context.ClearDepthStencilTarget(depthBufferTexture, 1.0f, 0);
+				if (!mMeshVertexBuffer->isReady || !mWoodTexture->isReady) return;
+
 				MeshConstants meshConstants;
 				meshConstants.vertexBufferIndex = mMeshVertexBuffer->descriptorHeapIndex;
 				meshConstants.textureIndex = mWoodTexture->descriptorHeapIndex;
@@ -208,35 +219,32 @@ void ExampleRender002()
 
 				PipelineInfo pipeline;
 				pipeline.pipeline = mMeshPSO.get();
-				pipeline.renderTargets.push_back(&backBuffer);
-				pipeline.depthStencilTarget = mDepthBuffer.get();
-
-				ogRHI.graphicsContext->SetPipeline(pipeline);
-				ogRHI.graphicsContext->SetPipelineResources(PER_OBJECT_SPACE, mMeshPerObjectResourceSpace);
-				ogRHI.graphicsContext->SetPipelineResources(PER_PASS_SPACE, mMeshPerPassResourceSpace);
-				ogRHI.graphicsContext->SetDefaultViewPortAndScissor(rhi.GetFrameBufferSize());
-				ogRHI.graphicsContext->SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-				ogRHI.graphicsContext->Draw(36);
-			}
+				pipeline.renderTargets.push_back(&backBufferTexture);
+				pipeline.depthStencilTarget = &depthBufferTexture;
 
-			ogRHI.graphicsContext->AddBarrier(backBuffer, D3D12_RESOURCE_STATE_PRESENT);
-			ogRHI.graphicsContext->FlushBarriers();
+				context.SetPipeline(pipeline);
+				context.SetPipelineResources(PER_OBJECT_SPACE, mMeshPerObjectResourceSpace);
+				context.SetPipelineResources(PER_PASS_SPACE, mMeshPerPassResourceSpace);
+				context.SetDefaultViewPortAndScissor(screenSize);
+				context.SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+				context.Draw(36);
+			});
 
-			SubmitContextWork(*ogRHI.graphicsContext);
+			if (!renderGraph.Execute()) break; // Compile() reported why
 
 			engine.EndFrame();
 		}
+		renderGraph.Destroy();
 
 		DestroyPipelineStateObject(std::move(mMeshPSO));
-		DestroyShader(std::move(mMeshPixelShader));
-		DestroyShader(std::move(mMeshVertexShader));
+		if (!mShaderLibrary.SaveUsageList()) Warning("Shader usage list was not saved, the Cooker will not cook the variants of this run");
+		mShaderLibrary.Destroy();
 		DestroyBuffer(std::move(mMeshVertexBuffer));
 		DestroyBuffer(std::move(mMeshPassConstantBuffer));
 		for (size_t i = 0; i < NUM_FRAMES_IN_FLIGHT; i++)
 		{
 			DestroyBuffer(std::move(mMeshConstantBuffers[i]));
 		}
-		DestroyTexture(std::move(mDepthBuffer));
 		DestroyTexture(std::move(mWoodTexture));
 	}
 	engine.Destroy();
@@ -1,4 +1,5 @@
 ﻿#include "stdafx.h"
+#include "Engine/MeshOptimizer.h"
 
 namespace e005
 {
@@ -109,6 +110,7 @@ void ExampleRender005()
 
 		// Create geometry
 		MeshGeometry boxGeo;
+		SubmeshId boxSubmesh;
 		{
 			std::array<Vertex, 8> vertices =
 			{
@@ -149,6 +151,16 @@ void ExampleRender005()
 				4, 3, 7
 			};
 
+			// The mesh creation passes of MeshOptimizer.h, in their order, before the buffers are filled. The cube uses all of
+			// its vertices, the fetch pass only reorders them.
+			const uint32_t numVertices = static_cast<uint32_t>(vertices.size());
+			if (!OptimizeVertexCache(std::span<uint16_t>(indices), numVertices) ||
+				!OptimizeOverdraw(std::span<uint16_t>(indices), &vertices[0].position.x, numVertices, sizeof(Vertex)) ||
+				OptimizeVertexFetch(std::span<uint16_t>(indices), vertices.data(), numVertices, sizeof(Vertex)) != numVertices)
+			{
+				Fatal("Failed to optimize the cube mesh");
+			}
+
 			const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
 			const UINT ibByteSize = (UINT)indices.size() * sizeof(std::uint16_t);
 
@@ -172,7 +184,7 @@ void ExampleRender005()
 			submesh.StartIndexLocation = 0;
 			submesh.BaseVertexLocation = 0;
 
-			boxGeo.DrawArgs["box"] = submesh;
+			boxSubmesh = boxGeo.AddSubmesh("box", submesh);
 		}
 
 		DirectX::XMFLOAT4X4 mWorld = e005::Identity4x4();
@@ -304,7 +316,7 @@ void ExampleRender005()
 
 					commandList->SetGraphicsRootDescriptorTable(0, cbDescriptor.GPUHandle);
 
-					commandList->DrawIndexedInstanced(boxGeo.DrawArgs["box"].IndexCount, 1, 0, 0, 0);
+					commandList->DrawIndexedInstanced(boxGeo.Submeshes.GetIndexCount(boxSubmesh), 1, 0, 0, 0);
 				}
 				PIXEndEvent(commandList);
 
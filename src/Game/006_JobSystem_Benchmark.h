@@ -0,0 +1,91 @@
+﻿#include "stdafx.h"
+#include "Benchmark.h"
+
+namespace jobSystemBenchmark
+{
+	using namespace benchmark;
+
+	float Work(uint32_t index, uint32_t iterations)
+	{
+		float value = static_cast<float>(index);
+		for (uint32_t i = 0; i < iterations; i++) value = std::sqrt(value + 1.0f) * 1.0001f;
+		return value;
+	}
+
+	void SpawnTree(JobSystem& jobs, uint32_t depth, JobCounter* counter)
+	{
+		if (depth == 0) return;
+		jobs.Schedule([&jobs, depth, counter] { SpawnTree(jobs, depth - 1, counter); }, counter);
+		jobs.Schedule([&jobs, depth, counter] { SpawnTree(jobs, depth - 1, counter); }, counter);
+	}
+
+	void Run(JobSystem& jobs)
+	{
+		Print("JobSystem benchmark, " + std::to_string(jobs.GetNumWorkerThreads()) + " worker threads + main thread, median of " + std::to_string(NUM_RUNS) + " runs");
+
+		// scheduling overhead: empty jobs from one thread, the workers steal them
+		{
+			constexpr uint32_t NUM_JOBS = 100000;
+			const double time = Measure([&]
+			{
+				JobCounter counter;
+				for (uint32_t i = 0; i < NUM_JOBS; i++) jobs.Schedule([] {}, &counter);
+				jobs.Wait(counter);
+			});
+			Report("empty jobs", time, Format("%.1f ns/job", time * 1e6 / NUM_JOBS));
+		}
+
+		// every job spawns two more, all threads push and steal
+		{
+			constexpr uint32_t DEPTH = 16;
+			const double time = Measure([&]
+			{
+				JobCounter counter;
+				SpawnTree(jobs, DEPTH, &counter);
+				jobs.Wait(counter);
+			});
+			Report("recursive spawn", time, Format("%.1f ns/job", time * 1e6 / ((1u << (DEPTH + 1)) - 2)));
+		}
+
+		// hand-off latency: every job depends on the previous one
+		{
+			constexpr uint32_t NUM_JOBS = 1000;
+			const double time = Measure([&]
+			{
+				std::vector<JobCounter> counters(NUM_JOBS);
+				for (uint32_t i = 0; i < NUM_JOBS; i++) jobs.Schedule([] {}, &counters[i], i > 0 ? &counters[i - 1] : nullptr);
+				jobs.Wait(counters.back());
+			});
+			Report("dependency chain", time, Format("%.1f ns/job", time * 1e6 / NUM_JOBS));
+		}
+
+		// ParallelFor speedup, uniform and unbalanced cost per element
+		{
+			constexpr uint32_t COUNT = 1u << 20;
+			std::vector<float> results(COUNT);
+
+			const auto uniform = [&results](uint32_t begin, uint32_t end) { for (uint32_t i = begin; i < end; i++) results[i] = Work(i, 16); };
+			const double serial = Measure([&] { uniform(0, COUNT); });
+			const double parallel = Measure([&] { jobs.ParallelFor(COUNT, uniform); });
+			Report("ParallelFor serial", serial, "");
+			Report("ParallelFor uniform", parallel, serial);
+
+			// the last elements cost 64 times more than the first ones, fixed chunks would leave threads idle
+			const auto unbalanced = [&results](uint32_t begin, uint32_t end) { for (uint32_t i = begin; i < end; i++) results[i] = Work(i, 1 + i / (COUNT / 64)); };
+			const double unbalancedSerial = Measure([&] { unbalanced(0, COUNT); });
+			const double unbalancedParallel = Measure([&] { jobs.ParallelFor(COUNT, unbalanced); });
+			Report("ParallelFor unbalanced", unbalancedParallel, unbalancedSerial);
+		}
+	}
+}
+
+void ExampleJobSystemBenchmark()
+{
+	EngineAppCreateInfo engineAppCreateInfo{};
+	EngineApp engine;
+	if (engine.Create(engineAppCreateInfo))
+	{
+		jobSystemBenchmark::Run(engine.GetJobSystem());
+	}
+	engine.Destroy();
+}
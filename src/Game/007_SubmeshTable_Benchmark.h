@@ -0,0 +1,95 @@
+﻿#include "stdafx.h"
+#include "Benchmark.h"
+#include <random>
+
+namespace submeshTableBenchmark
+{
+	using namespace benchmark;
+
+	constexpr uint32_t NUM_SUBMESHES = 100000;
+
+	void Run()
+	{
+		Print("Submesh layout benchmark, " + std::to_string(NUM_SUBMESHES) + " submeshes, median of " + std::to_string(NUM_RUNS) + " runs");
+
+		// the same submeshes in both layouts, a draw list holds names or ids in a shuffled order
+		std::unordered_map<std::string, SubmeshGeometry> drawArgs;
+		MeshGeometry mesh;
+		mesh.Submeshes.Reserve(NUM_SUBMESHES);
+		std::vector<std::string> drawNames;
+		std::vector<SubmeshId> drawIds;
+
+		std::mt19937 random(2025);
+		for (uint32_t i = 0; i < NUM_SUBMESHES; i++)
+		{
+			SubmeshGeometry submesh;
+			submesh.IndexCount = 36 + random() % 3000;
+			submesh.StartIndexLocation = i * 4096;
+			submesh.BaseVertexLocation = static_cast<int>(i * 1024);
+			submesh.Bounds.Center = { static_cast<float>(random() % 2000) - 1000.0f, 0.0f, static_cast<float>(random() % 2000) - 1000.0f };
+			submesh.Bounds.Extents = { 1.0f, 1.0f, 1.0f };
+
+			const std::string name = "submesh_" + std::to_string(i);
+			drawArgs[name] = submesh;
+			drawNames.push_back(name);
+			drawIds.push_back(mesh.AddSubmesh(name, submesh));
+		}
+		std::vector<uint32_t> order(NUM_SUBMESHES);
+		std::iota(order.begin(), order.end(), 0u);
+		std::shuffle(order.begin(), order.end(), random);
+		for (uint32_t i = 0; i < NUM_SUBMESHES; i++)
+		{
+			std::swap(drawNames[i], drawNames[order[i]]);
+			std::swap(drawIds[i], drawIds[order[i]]);
+		}
+
+		// draw arguments of a draw list
+		uint64_t checksum = 0;
+		const double lookupByName = Measure([&]
+		{
+			checksum = 0;
+			for (const std::string& name : drawNames)
+			{
+				const SubmeshGeometry& submesh = drawArgs[name];
+				checksum += submesh.IndexCount + submesh.StartIndexLocation + submesh.BaseVertexLocation;
+			}
+		});
+		Report("DrawArgs[name]", lookupByName, lookupByName, checksum);
+
+		const double lookupById = Measure([&]
+		{
+			checksum = 0;
+			const SubmeshTable& table = mesh.Submeshes;
+			for (SubmeshId id : drawIds) checksum += table.GetIndexCount(id) + table.GetStartIndexLocation(id) + table.GetBaseVertexLocation(id);
+		});
+		Report("SubmeshTable by id", lookupById, lookupByName, checksum);
+
+		// all submeshes, e.g. culling reads only the bounds
+		const double mapBounds = Measure([&]
+		{
+			checksum = 0;
+			for (const auto& [name, submesh] : drawArgs) checksum += submesh.Bounds.Center.x + submesh.Bounds.Extents.x > 0.0f;
+		});
+		Report("DrawArgs iterate bounds", mapBounds, mapBounds, checksum);
+
+		const double tableBounds = Measure([&]
+		{
+			checksum = 0;
+			const std::span<const glm::vec3> centers = mesh.Submeshes.GetBoundsCenters();
+			const std::span<const glm::vec3> extents = mesh.Submeshes.GetBoundsExtents();
+			for (size_t i = 0; i < centers.size(); i++) checksum += centers[i].x + extents[i].x > 0.0f;
+		});
+		Report("SubmeshTable iterate bounds", tableBounds, mapBounds, checksum);
+	}
+}
+
+void ExampleSubmeshTableBenchmark()
+{
+	EngineAppCreateInfo engineAppCreateInfo{};
+	EngineApp engine;
+	if (engine.Create(engineAppCreateInfo))
+	{
+		submeshTableBenchmark::Run();
+	}
+	engine.Destroy();
+}
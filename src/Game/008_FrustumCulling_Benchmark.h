@@ -0,0 +1,69 @@
+﻿#include "stdafx.h"
+#include "Benchmark.h"
+#include "Engine/FrustumCulling.h"
+#include <random>
+
+namespace frustumCullingBenchmark
+{
+	using namespace benchmark;
+
+	constexpr uint32_t NUM_BOXES = 1000000;
+
+	void Run(JobSystem& jobSystem)
+	{
+		Print("Frustum culling benchmark, " + std::to_string(NUM_BOXES) + " boxes, " + std::to_string(jobSystem.GetNumWorkerThreads()) + " worker threads, median of " + std::to_string(NUM_RUNS) + " runs");
+
+		// a city block of boxes around a camera looking along the ground
+		CullingBounds bounds;
+		bounds.Reserve(NUM_BOXES);
+		std::mt19937 random(2025);
+		std::uniform_real_distribution<float> position(-1000.0f, 1000.0f);
+		std::uniform_real_distribution<float> height(0.0f, 50.0f);
+		std::uniform_real_distribution<float> extent(0.5f, 10.0f);
+		for (uint32_t i = 0; i < NUM_BOXES; i++)
+			bounds.Add({ position(random), height(random), position(random) }, { extent(random), extent(random), extent(random) });
+
+		const glm::mat4 view = glm::lookAtLH(glm::vec3(0.0f, 20.0f, 0.0f), glm::vec3(1.0f, 15.0f, 0.5f), glm::vec3(0.0f, 1.0f, 0.0f));
+		const glm::mat4 projection = glm::perspectiveFovLH_ZO(glm::radians(60.0f), 1600.0f, 900.0f, 0.1f, 1500.0f);
+		const CullingFrustum frustum = CullingFrustum::FromViewProjection(projection * view);
+
+		// single thread, one path at a time
+		std::vector<uint32_t> visible(NUM_BOXES);
+		uint32_t numVisible = 0;
+		const double scalar = Measure([&] { numVisible = CullBoxes(frustum, bounds, 0, NUM_BOXES, visible.data(), CullingPath::scalar); });
+		Report("scalar, 1 thread", scalar, scalar, numVisible, "visible");
+		const uint32_t expectedVisible = numVisible;
+
+		const double sse = Measure([&] { numVisible = CullBoxes(frustum, bounds, 0, NUM_BOXES, visible.data(), CullingPath::sse); });
+		Report("SSE, 1 thread", sse, scalar, numVisible, "visible");
+
+		if (GetBestCullingPath() == CullingPath::avx2)
+		{
+			const double avx2 = Measure([&] { numVisible = CullBoxes(frustum, bounds, 0, NUM_BOXES, visible.data(), CullingPath::avx2); });
+			Report("AVX2, 1 thread", avx2, scalar, numVisible, "visible");
+		}
+		else
+		{
+			Print("  AVX2 is not supported by this CPU");
+		}
+
+		// blocks on all worker threads, compacted into one list
+		FrustumCuller culler;
+		const double parallel = Measure([&] { numVisible = static_cast<uint32_t>(culler.Cull(frustum, bounds, &jobSystem).size()); });
+		Report("FrustumCuller, job system", parallel, scalar, numVisible, "visible");
+
+		if (numVisible != expectedVisible)
+			Error("Frustum culling benchmark: the paths disagree, " + std::to_string(numVisible) + " visible instead of " + std::to_string(expectedVisible));
+	}
+}
+
+void ExampleFrustumCullingBenchmark()
+{
+	EngineAppCreateInfo engineAppCreateInfo{};
+	EngineApp engine;
+	if (engine.Create(engineAppCreateInfo))
+	{
+		frustumCullingBenchmark::Run(engine.GetJobSystem());
+	}
+	engine.Destroy();
+}
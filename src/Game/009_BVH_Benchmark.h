@@ -0,0 +1,13 @@
+﻿#include "stdafx.h"
+#include "BVHBenchmark.h"
+
+void ExampleBVHBenchmark()
+{
+	EngineAppCreateInfo engineAppCreateInfo{};
+	EngineApp engine;
+	if (engine.Create(engineAppCreateInfo))
+	{
+		bvhBenchmark::Run(engine.GetJobSystem());
+	}
+	engine.Destroy();
+}
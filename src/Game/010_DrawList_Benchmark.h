@@ -0,0 +1,119 @@
+﻿#include "stdafx.h"
+#include "Benchmark.h"
+#include "Engine/DrawList.h"
+#include <random>
+
+namespace drawListBenchmark
+{
+	using namespace benchmark;
+
+	constexpr uint32_t NUM_DRAWS = 100000;
+	constexpr uint32_t NUM_SORT_KEYS = 1000000;
+	constexpr uint32_t NUM_PIPELINES = 64;
+	constexpr uint32_t NUM_MATERIALS = 2048;
+	constexpr uint32_t NUM_MESHES = 16; // one index buffer each
+
+	// a scene in the order a culling pass finds it: every draw picks a pipeline, a material and a mesh at random
+	void FillDrawList(DrawList& drawList, uint32_t numDraws, const std::vector<PipelineInfo>& pipelines, const std::vector<PipelineResourceSpace>& materials,
+		const std::vector<BufferResource>& indexBuffers, std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> depth(0.1f, 1000.0f);
+		drawList.Clear();
+		drawList.Reserve(numDraws);
+		for (uint32_t draw = 0; draw < numDraws; draw++)
+		{
+			const uint32_t material = random() % NUM_MATERIALS;
+			const uint32_t pipeline = material % NUM_PIPELINES; // materials use one pipeline each
+			const uint32_t mesh = random() % NUM_MESHES;
+			const bool transparent = draw % 16 == 0;
+
+			DrawItem item;
+			item.pipeline = &pipelines[pipeline];
+			item.resources = &materials[material];
+			item.resourceSpace = 1;
+			item.indexBuffer = &indexBuffers[mesh];
+			item.indexCount = 36 + mesh * 300;
+			const uint64_t key = transparent ? MakeTransparentDrawKey(1, pipeline, material, depth(random)) : MakeOpaqueDrawKey(0, pipeline, material, depth(random));
+			drawList.Add(key, item);
+		}
+	}
+
+	void Run(JobSystem& jobSystem)
+	{
+		Print("Draw list benchmark, " + std::to_string(NUM_DRAWS) + " draws, " + std::to_string(NUM_PIPELINES) + " pipelines, " +
+			std::to_string(NUM_MATERIALS) + " materials, median of " + std::to_string(NUM_RUNS) + " runs");
+
+		// the stream records pointers only, the state objects need not be created
+		std::vector<PipelineInfo> pipelines(NUM_PIPELINES);
+		std::vector<PipelineResourceSpace> materials(NUM_MATERIALS);
+		std::vector<BufferResource> indexBuffers(NUM_MESHES);
+		std::mt19937 random(2025);
+
+		DrawList drawList;
+		FillDrawList(drawList, NUM_DRAWS, pipelines, materials, indexBuffers, random);
+
+		CommandStream stream;
+		if (!stream.Create(size_t(NUM_DRAWS) * 4 * 64)) return;
+		{
+			CommandStreamRecorder recorder(stream);
+			drawList.Submit(recorder);
+			ReportStream("unsorted", stream);
+		}
+		drawList.Sort(&jobSystem);
+		stream.Reset();
+		{
+			CommandStreamRecorder recorder(stream);
+			drawList.Submit(recorder);
+			ReportStream("sorted", stream);
+		}
+
+		// transparent draws go back to front, state comes second there
+		for (uint32_t pass = 0; pass < 2; pass++)
+		{
+			stream.Reset();
+			CommandStreamRecorder recorder(stream);
+			drawList.Submit(recorder, pass);
+			ReportStream(pass == 0 ? "sorted, opaque pass" : "sorted, transparent pass", stream);
+		}
+
+		// sorting a million keys: std::sort on the pairs, the radix sort on one thread and on the job system
+		FillDrawList(drawList, NUM_SORT_KEYS, pipelines, materials, indexBuffers, random);
+		std::vector<std::pair<uint64_t, uint32_t>> pairs(NUM_SORT_KEYS);
+		const double stdSort = Measure([&]
+		{
+			for (uint32_t draw = 0; draw < NUM_SORT_KEYS; draw++) pairs[draw] = { drawList.GetOrderedKeys()[draw], draw };
+			std::sort(pairs.begin(), pairs.end());
+		});
+		Report("std::sort, 1M keys", stdSort, stdSort);
+
+		// Sort() returns at once on a sorted list, every run sorts a copy of the unsorted one
+		const DrawList unsortedList = drawList;
+		DrawList sortList;
+		const auto measureSort = [&](JobSystem* sortJobSystem)
+		{
+			std::array<double, NUM_RUNS> times{};
+			for (double& time : times)
+			{
+				sortList = unsortedList;
+				const uint64_t beginTime = ProfilerGetTime();
+				sortList.Sort(sortJobSystem);
+				time = static_cast<double>(ProfilerGetTime() - beginTime) * 1e-6;
+			}
+			std::sort(times.begin(), times.end());
+			return times[NUM_RUNS / 2];
+		};
+		Report("radix sort, 1 thread", measureSort(nullptr), stdSort);
+		Report("radix sort, job system", measureSort(&jobSystem), stdSort);
+	}
+}
+
+void ExampleDrawListBenchmark()
+{
+	EngineAppCreateInfo engineAppCreateInfo{};
+	EngineApp engine;
+	if (engine.Create(engineAppCreateInfo))
+	{
+		drawListBenchmark::Run(engine.GetJobSystem());
+	}
+	engine.Destroy();
+}
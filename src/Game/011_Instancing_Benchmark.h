@@ -0,0 +1,121 @@
+﻿#include "stdafx.h"
+#include "Benchmark.h"
+#include "Engine/InstanceBatcher.h"
+#include <random>
+
+namespace instancingBenchmark
+{
+	using namespace benchmark;
+
+	constexpr uint32_t NUM_DRAWS = 100000;
+	constexpr uint32_t NUM_PIPELINES = 8;
+	constexpr uint32_t NUM_MATERIALS = 64;
+	constexpr uint32_t NUM_MESHES = 32; // one index buffer each
+
+	void Run(JobSystem& jobSystem)
+	{
+		Print("Instancing benchmark, " + std::to_string(NUM_DRAWS) + " props, " + std::to_string(NUM_MESHES) + " meshes, " +
+			std::to_string(NUM_MATERIALS) + " materials, median of " + std::to_string(NUM_RUNS) + " runs");
+
+		// the stream records pointers only, the state objects need not be created
+		std::vector<PipelineInfo> pipelines(NUM_PIPELINES);
+		std::vector<BufferResource> indexBuffers(NUM_MESHES);
+		std::mt19937 random(2025);
+		std::uniform_real_distribution<float> position(-1000.0f, 1000.0f);
+
+		// a forest of repeated props: every prop picks a mesh and a material, the material picks the pipeline
+		struct Prop
+		{
+			uint32_t  mesh;
+			uint32_t  material;
+			glm::mat4 worldMatrix;
+		};
+		std::vector<Prop> props(NUM_DRAWS);
+		for (Prop& prop : props)
+		{
+			prop.mesh = random() % NUM_MESHES;
+			prop.material = random() % NUM_MATERIALS;
+			prop.worldMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(position(random), 0.0f, position(random)));
+		}
+		const auto makeDraw = [&](const Prop& prop)
+		{
+			DrawItem draw;
+			draw.pipeline = &pipelines[prop.material % NUM_PIPELINES];
+			draw.indexBuffer = &indexBuffers[prop.mesh];
+			draw.indexCount = 36 + prop.mesh * 300;
+			return draw;
+		};
+
+		CommandStream stream;
+		if (!stream.Create(size_t(NUM_DRAWS) * 4 * 64)) return;
+
+		// one draw per prop, every draw binds its own MeshConstants
+		std::vector<PipelineResourceSpace> objectSpaces(NUM_DRAWS);
+		DrawList drawList;
+		drawList.Reserve(NUM_DRAWS);
+		for (uint32_t draw = 0; draw < NUM_DRAWS; draw++)
+		{
+			const Prop& prop = props[draw];
+			DrawItem item = makeDraw(prop);
+			item.resources = &objectSpaces[draw];
+			drawList.Add(MakeInstancingDrawKey(0, prop.material % NUM_PIPELINES, prop.material, prop.mesh), item);
+		}
+		drawList.Sort(&jobSystem);
+		{
+			CommandStreamRecorder recorder(stream);
+			drawList.Submit(recorder);
+			ReportStream("sorted, one draw per prop", stream);
+		}
+
+		// merged: the texture travels with the instance, so the materials share a key and the props of a mesh and a pipeline
+		// share a batch. Every batch binds its batch constants like InstanceBufferD3D12 does.
+		InstanceBatcher batcher;
+		const auto fillBatcher = [&]
+		{
+			batcher.Clear();
+			batcher.Reserve(NUM_DRAWS);
+			for (const Prop& prop : props)
+			{
+				MeshInstanceData instance;
+				instance.worldMatrix = prop.worldMatrix;
+				instance.vertexBufferIndex = prop.mesh;
+				instance.textureIndex = prop.material;
+				batcher.Add(MakeInstancingDrawKey(0, prop.material % NUM_PIPELINES, 0, prop.mesh), makeDraw(prop), instance);
+			}
+		};
+		fillBatcher();
+		batcher.Build(&jobSystem);
+
+		std::vector<PipelineResourceSpace> batchSpaces(batcher.GetBatches().size());
+		DrawList batchList;
+		for (uint32_t batch = 0; batch < batcher.GetBatches().size(); batch++)
+		{
+			DrawItem item = batcher.GetBatches()[batch].draw;
+			item.resources = &batchSpaces[batch];
+			batchList.Add(batcher.GetBatches()[batch].key, item);
+		}
+		stream.Reset();
+		{
+			CommandStreamRecorder recorder(stream);
+			batchList.Submit(recorder);
+			ReportStream("instanced", stream);
+		}
+		Print("  " + std::to_string(batcher.GetInstances().size() * sizeof(MeshInstanceData) / 1024) + " KiB of instance data per frame");
+
+		// the batcher runs every frame: adding the draws and merging them
+		const double serialBuild = Measure([&] { fillBatcher(); batcher.Build(); });
+		Report("add and build, 1 thread", serialBuild, serialBuild);
+		Report("add and build, job system", Measure([&] { fillBatcher(); batcher.Build(&jobSystem); }), serialBuild);
+	}
+}
+
+void ExampleInstancingBenchmark()
+{
+	EngineAppCreateInfo engineAppCreateInfo{};
+	EngineApp engine;
+	if (engine.Create(engineAppCreateInfo))
+	{
+		instancingBenchmark::Run(engine.GetJobSystem());
+	}
+	engine.Destroy();
+}
@@ -0,0 +1,118 @@
+﻿#include "stdafx.h"
+#include "Benchmark.h"
+#include "Engine/CommandStream.h"
+#include "Engine/FrustumCulling.h"
+#include "Engine/IndirectDraw.h"
+#include <random>
+
+namespace indirectDrawBenchmark
+{
+	using namespace benchmark;
+
+	constexpr uint32_t NUM_OBJECTS = 200000;
+	constexpr uint32_t NUM_MESHES = 16;
+	constexpr uint32_t NUM_VIEWS = 8;
+	constexpr uint64_t OBJECT_CONSTANTS_ADDRESS = 0x100000000ull; // any GPU address, the commands only point there
+
+	void Run(JobSystem& jobSystem)
+	{
+		Print("Indirect draw benchmark, " + std::to_string(NUM_OBJECTS) + " static objects, " + std::to_string(NUM_VIEWS) + " views, median of " + std::to_string(NUM_RUNS) + " runs");
+
+		// static props spread over the ground, every object draws a range of one shared index buffer
+		std::vector<IndirectDrawObject> objects(NUM_OBJECTS);
+		CullingBounds bounds;
+		bounds.Reserve(NUM_OBJECTS);
+		std::mt19937 random(2025);
+		std::uniform_real_distribution<float> position(-2000.0f, 2000.0f);
+		std::uniform_real_distribution<float> height(0.0f, 50.0f);
+		std::uniform_real_distribution<float> extent(0.5f, 10.0f);
+		for (IndirectDrawObject& object : objects)
+		{
+			const uint32_t mesh = random() % NUM_MESHES;
+			object.boundsCenter = { position(random), height(random), position(random) };
+			object.boundsExtents = { extent(random), extent(random), extent(random) };
+			object.indexCount = 36 + mesh * 300;
+			object.startIndexLocation = mesh * 10000;
+			object.baseVertexLocation = static_cast<int32_t>(mesh * 5000);
+			bounds.Add(object.boundsCenter, object.boundsExtents);
+		}
+
+		std::vector<CullingFrustum> frustums(NUM_VIEWS);
+		for (CullingFrustum& frustum : frustums)
+		{
+			const glm::vec3 eye(position(random) * 0.5f, 20.0f, position(random) * 0.5f);
+			const glm::mat4 view = glm::lookAtLH(eye, eye + glm::vec3(position(random), -10.0f, position(random)), glm::vec3(0.0f, 1.0f, 0.0f));
+			frustum = CullingFrustum::FromViewProjection(glm::perspectiveFovLH_ZO(glm::radians(60.0f), 1600.0f, 900.0f, 0.1f, 1000.0f) * view);
+		}
+
+		// the CPU reference of the compute pass has to find the boxes FrustumCuller finds, with the arguments of their objects
+		std::vector<IndirectDrawCommand> commands(NUM_OBJECTS);
+		FrustumCuller culler;
+		uint64_t numVisible = 0;
+		for (const CullingFrustum& frustum : frustums)
+		{
+			const uint32_t numCommands = CullIndirectDraws(frustum, objects, OBJECT_CONSTANTS_ADDRESS, commands.data());
+			const std::span<const uint32_t> visible = culler.Cull(frustum, bounds, &jobSystem);
+			bool matches = numCommands == visible.size();
+			for (uint32_t command = 0; matches && command < numCommands; command++)
+			{
+				const IndirectDrawObject& object = objects[visible[command]];
+				matches = commands[command].objectConstantsAddress == OBJECT_CONSTANTS_ADDRESS + uint64_t(visible[command]) * INDIRECT_OBJECT_CONSTANTS_STRIDE &&
+					commands[command].indexCountPerInstance == object.indexCount && commands[command].instanceCount == 1 &&
+					commands[command].startIndexLocation == object.startIndexLocation && commands[command].baseVertexLocation == object.baseVertexLocation;
+			}
+			if (!matches)
+			{
+				Error("Indirect draw benchmark: the commands do not match the visible boxes");
+				return;
+			}
+			numVisible += numCommands;
+		}
+		Print("  " + std::to_string(numVisible / NUM_VIEWS) + " visible objects per view on average, the reference matches FrustumCuller");
+
+		// What the CPU does per frame on each path: cull and record a draw per visible object, or record the cull dispatch and
+		// one ExecuteIndirect no matter how many objects there are.
+		std::vector<PipelineResourceSpace> objectSpaces(NUM_OBJECTS);
+		PipelineInfo pipeline;
+		BufferResource indexBuffer;
+		CommandStream stream;
+		if (!stream.Create(size_t(NUM_OBJECTS) * 2 * 64)) return;
+		uint32_t numCommands = 0;
+		const double cpuDraws = Measure([&]
+		{
+			numCommands = 0;
+			for (const CullingFrustum& frustum : frustums)
+			{
+				stream.Reset();
+				CommandStreamRecorder recorder(stream);
+				recorder.SetPipeline(pipeline);
+				recorder.SetIndexBuffer(indexBuffer);
+				for (uint32_t object : culler.Cull(frustum, bounds, &jobSystem))
+				{
+					recorder.SetPipelineResources(0, objectSpaces[object]);
+					recorder.DrawIndexed(objects[object].indexCount, objects[object].startIndexLocation, objects[object].baseVertexLocation);
+				}
+				numCommands += stream.GetNumCommands();
+			}
+		});
+		Report("CPU culling and draws, all views", cpuDraws, cpuDraws);
+		Print("  " + std::to_string(numCommands / NUM_VIEWS) + " commands per view, the indirect path records the same few commands for any number of objects");
+
+		const double reference = Measure([&]
+		{
+			for (const CullingFrustum& frustum : frustums) CullIndirectDraws(frustum, objects, OBJECT_CONSTANTS_ADDRESS, commands.data());
+		});
+		Report("CPU reference of the GPU pass, 1 thread", reference, cpuDraws);
+	}
+}
+
+void ExampleIndirectDrawBenchmark()
+{
+	EngineAppCreateInfo engineAppCreateInfo{};
+	EngineApp engine;
+	if (engine.Create(engineAppCreateInfo))
+	{
+		indirectDrawBenchmark::Run(engine.GetJobSystem());
+	}
+	engine.Destroy();
+}
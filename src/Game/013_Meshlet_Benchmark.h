@@ -0,0 +1,157 @@
+﻿#include "stdafx.h"
+#include "Benchmark.h"
+#include "Engine/MeshletBuilder.h"
+
+namespace meshletBenchmark
+{
+	using namespace benchmark;
+
+	constexpr uint32_t NUM_SLICES = 1024;
+	constexpr uint32_t NUM_STACKS = 512; // 1M triangles
+	constexpr float    RADIUS = 10.0f;
+
+	// a bumpy sphere, rows of quads from pole to pole
+	void CreateMesh(std::vector<glm::vec3>& positions, std::vector<uint32_t>& indices)
+	{
+		positions.clear();
+		indices.clear();
+		for (uint32_t stack = 0; stack <= NUM_STACKS; stack++)
+		{
+			const float phi = glm::pi<float>() * stack / NUM_STACKS;
+			for (uint32_t slice = 0; slice <= NUM_SLICES; slice++)
+			{
+				const float theta = glm::two_pi<float>() * slice / NUM_SLICES;
+				const float radius = RADIUS * (1.0f + 0.02f * std::sin(theta * 24.0f) * std::sin(phi * 12.0f));
+				positions.emplace_back(radius * std::sin(phi) * std::cos(theta), radius * std::cos(phi), radius * std::sin(phi) * std::sin(theta));
+			}
+		}
+		for (uint32_t stack = 0; stack < NUM_STACKS; stack++)
+		{
+			for (uint32_t slice = 0; slice < NUM_SLICES; slice++)
+			{
+				const uint32_t v0 = stack * (NUM_SLICES + 1) + slice;
+				const uint32_t v1 = v0 + NUM_SLICES + 1;
+				indices.insert(indices.end(), { v0, v0 + 1, v1, v0 + 1, v1 + 1, v1 });
+			}
+		}
+	}
+
+	// every source triangle in exactly one meshlet, in the limits
+	bool Validate(const MeshletData& meshletData, const std::vector<uint32_t>& indices)
+	{
+		std::vector<std::array<uint32_t, 3>> source(indices.size() / 3);
+		for (size_t triangle = 0; triangle < source.size(); triangle++) source[triangle] = { indices[triangle * 3], indices[triangle * 3 + 1], indices[triangle * 3 + 2] };
+		std::vector<std::array<uint32_t, 3>> built;
+		built.reserve(source.size());
+		for (const Meshlet& meshlet : meshletData.meshlets)
+		{
+			if (meshlet.vertexCount > MESHLET_MAX_VERTICES || meshlet.triangleCount > MESHLET_MAX_TRIANGLES) return false;
+			for (uint32_t triangle = 0; triangle < meshlet.triangleCount; triangle++)
+			{
+				const uint32_t packed = meshletData.triangles[meshlet.triangleOffset + triangle];
+				std::array<uint32_t, 3> corners;
+				for (uint32_t corner = 0; corner < 3; corner++)
+				{
+					const uint32_t vertex = (packed >> (corner * 8)) & 0xFF;
+					if (vertex >= meshlet.vertexCount) return false;
+					corners[corner] = meshletData.vertexIndices[meshlet.vertexOffset + vertex];
+				}
+				built.push_back(corners);
+			}
+		}
+		std::sort(source.begin(), source.end());
+		std::sort(built.begin(), built.end());
+		return source == built;
+	}
+
+	void Run()
+	{
+		std::vector<glm::vec3> positions;
+		std::vector<uint32_t> indices;
+		CreateMesh(positions, indices);
+		const uint32_t numTriangles = static_cast<uint32_t>(indices.size() / 3);
+		Print("Meshlet benchmark, " + std::to_string(numTriangles) + " triangles, " + std::to_string(positions.size()) + " vertices, median of " + std::to_string(NUM_RUNS) + " runs");
+
+		MeshletData meshletData;
+		bool built = true;
+		const double build = Measure([&]
+		{
+			built = BuildMeshlets(indices, &positions[0].x, static_cast<uint32_t>(positions.size()), sizeof(glm::vec3), meshletData) && built;
+		});
+		if (!built || !Validate(meshletData, indices))
+		{
+			Error("Meshlet benchmark: the meshlets do not cover the mesh");
+			return;
+		}
+		Report("BuildMeshlets", build, PerSecond(numTriangles, build, "triangles"));
+
+		const size_t numMeshlets = meshletData.meshlets.size();
+		double averageRadius = 0.0;
+		for (const MeshletBounds& bounds : meshletData.bounds) averageRadius += bounds.radius;
+		char buffer[256];
+		snprintf(buffer, sizeof(buffer), "  %zu meshlets, %.1f of %u vertices and %.1f of %u triangles on average, bounding radius %.3f",
+			numMeshlets, double(meshletData.vertexIndices.size()) / numMeshlets, MESHLET_MAX_VERTICES, double(numTriangles) / numMeshlets, MESHLET_MAX_TRIANGLES,
+			averageRadius / numMeshlets);
+		Print(buffer);
+
+		// the cooked form: the blob has to come back unchanged
+		std::vector<uint8_t> blob;
+		MeshletData loaded;
+		bool loadedMatches = true;
+		const double load = Measure([&]
+		{
+			SerializeMeshlets(meshletData, blob);
+			loadedMatches = DeserializeMeshlets(blob.data(), blob.size(), loaded) && loadedMatches;
+		});
+		loadedMatches = loadedMatches && loaded.vertexIndices == meshletData.vertexIndices && loaded.triangles == meshletData.triangles &&
+			memcmp(loaded.meshlets.data(), meshletData.meshlets.data(), numMeshlets * sizeof(Meshlet)) == 0 &&
+			memcmp(loaded.bounds.data(), meshletData.bounds.data(), numMeshlets * sizeof(MeshletBounds)) == 0;
+		if (!loadedMatches)
+		{
+			Error("Meshlet benchmark: the serialized meshlets do not load back");
+			return;
+		}
+		// a round trip writes and reads the blob once each
+		snprintf(buffer, sizeof(buffer), "%.0f MB/s", 2.0 * blob.size() / (1024.0 * 1024.0) / (load * 1e-3));
+		Report("Serialize and deserialize", load, buffer);
+		Print("  " + std::to_string(blob.size() / 1024) + " KB cooked, " + std::to_string(blob.size() * 8 / numTriangles) + " bits per triangle");
+
+		// Cone culling from a few cameras around the sphere. A culled meshlet must not have a triangle facing the camera.
+		const glm::vec3 cameras[] = { { 0.0f, 0.0f, -30.0f }, { 25.0f, 10.0f, 0.0f }, { 0.0f, 40.0f, 5.0f }, { 12.0f, -12.0f, 12.0f } };
+		size_t numCulled = 0;
+		for (const glm::vec3& camera : cameras)
+		{
+			for (size_t meshletIndex = 0; meshletIndex < numMeshlets; meshletIndex++)
+			{
+				if (!IsMeshletBackfacing(meshletData.bounds[meshletIndex], camera)) continue;
+				numCulled++;
+				const Meshlet& meshlet = meshletData.meshlets[meshletIndex];
+				for (uint32_t triangle = 0; triangle < meshlet.triangleCount; triangle++)
+				{
+					const uint32_t packed = meshletData.triangles[meshlet.triangleOffset + triangle];
+					const glm::vec3& a = positions[meshletData.vertexIndices[meshlet.vertexOffset + (packed & 0xFF)]];
+					const glm::vec3& b = positions[meshletData.vertexIndices[meshlet.vertexOffset + ((packed >> 8) & 0xFF)]];
+					const glm::vec3& c = positions[meshletData.vertexIndices[meshlet.vertexOffset + ((packed >> 16) & 0xFF)]];
+					if (glm::dot(glm::cross(b - a, c - a), camera - a) > 0.0f)
+					{
+						Error("Meshlet benchmark: a meshlet facing the camera was cone culled");
+						return;
+					}
+				}
+			}
+		}
+		snprintf(buffer, sizeof(buffer), "  %.1f%% of the meshlets cone culled per camera, none of them faces the camera", 100.0 * numCulled / (numMeshlets * std::size(cameras)));
+		Print(buffer);
+	}
+}
+
+void ExampleMeshletBenchmark()
+{
+	EngineAppCreateInfo engineAppCreateInfo{};
+	EngineApp engine;
+	if (engine.Create(engineAppCreateInfo))
+	{
+		meshletBenchmark::Run();
+	}
+	engine.Destroy();
+}
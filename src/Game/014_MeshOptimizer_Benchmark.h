@@ -0,0 +1,156 @@
+﻿#include "stdafx.h"
+#include "Benchmark.h"
+#include "Engine/MeshOptimizer.h"
+#include <random>
+
+namespace meshOptimizerBenchmark
+{
+	using namespace benchmark;
+
+	constexpr uint32_t NUM_SLICES = 512;
+	constexpr uint32_t NUM_STACKS = 256; // 262144 triangles
+
+	struct Vertex final
+	{
+		glm::vec3 position;
+		glm::vec3 normal;
+		glm::vec2 uv;
+	};
+
+	void ReportVertexCache(const char* name, double milliseconds, const std::vector<uint32_t>& indices, uint32_t numVertices)
+	{
+		const VertexCacheStatistics statistics = AnalyzeVertexCache(indices, numVertices);
+		char buffer[64];
+		snprintf(buffer, sizeof(buffer), "ACMR %.3f  ATVR %.3f", statistics.acmr, statistics.atvr);
+		Report(name, milliseconds, buffer);
+	}
+
+	// A bumpy sphere, rows of quads from pole to pole. Exporters and merged meshes rarely keep such an order, the triangles
+	// and the vertices are shuffled to start from an index buffer as authored.
+	void CreateMesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+	{
+		for (uint32_t stack = 0; stack <= NUM_STACKS; stack++)
+		{
+			const float phi = glm::pi<float>() * stack / NUM_STACKS;
+			for (uint32_t slice = 0; slice <= NUM_SLICES; slice++)
+			{
+				const float theta = glm::two_pi<float>() * slice / NUM_SLICES;
+				const glm::vec3 normal(std::sin(phi) * std::cos(theta), std::cos(phi), std::sin(phi) * std::sin(theta));
+				const float radius = 10.0f * (1.0f + 0.02f * std::sin(theta * 24.0f) * std::sin(phi * 12.0f));
+				vertices.push_back({ normal * radius, normal, { float(slice) / NUM_SLICES, float(stack) / NUM_STACKS } });
+			}
+		}
+		std::vector<std::array<uint32_t, 3>> triangles;
+		for (uint32_t stack = 0; stack < NUM_STACKS; stack++)
+		{
+			for (uint32_t slice = 0; slice < NUM_SLICES; slice++)
+			{
+				const uint32_t v0 = stack * (NUM_SLICES + 1) + slice;
+				const uint32_t v1 = v0 + NUM_SLICES + 1;
+				triangles.push_back({ v0, v0 + 1, v1 });
+				triangles.push_back({ v0 + 1, v1 + 1, v1 });
+			}
+		}
+
+		std::mt19937 random(2025);
+		std::shuffle(triangles.begin(), triangles.end(), random);
+		std::vector<uint32_t> remap(vertices.size());
+		std::iota(remap.begin(), remap.end(), 0);
+		std::shuffle(remap.begin(), remap.end(), random);
+		std::vector<Vertex> shuffled(vertices.size());
+		for (size_t vertex = 0; vertex < vertices.size(); vertex++) shuffled[remap[vertex]] = vertices[vertex];
+		vertices.swap(shuffled);
+		for (const std::array<uint32_t, 3>& triangle : triangles)
+			indices.insert(indices.end(), { remap[triangle[0]], remap[triangle[1]], remap[triangle[2]] });
+	}
+
+	// the same triangles with the same vertex data, in any order
+	bool SameTriangles(const std::vector<Vertex>& verticesA, const std::vector<uint32_t>& indicesA, const std::vector<Vertex>& verticesB, const std::vector<uint32_t>& indicesB)
+	{
+		const auto collect = [](const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+		{
+			std::vector<std::array<float, 9>> triangles(indices.size() / 3);
+			for (size_t triangle = 0; triangle < triangles.size(); triangle++)
+			{
+				for (uint32_t corner = 0; corner < 3; corner++)
+				{
+					const glm::vec3& position = vertices[indices[triangle * 3 + corner]].position;
+					triangles[triangle][corner * 3] = position.x;
+					triangles[triangle][corner * 3 + 1] = position.y;
+					triangles[triangle][corner * 3 + 2] = position.z;
+				}
+			}
+			std::sort(triangles.begin(), triangles.end());
+			return triangles;
+		};
+		return indicesA.size() == indicesB.size() && collect(verticesA, indicesA) == collect(verticesB, indicesB);
+	}
+
+	void Run()
+	{
+		std::vector<Vertex> sourceVertices;
+		std::vector<uint32_t> sourceIndices;
+		CreateMesh(sourceVertices, sourceIndices);
+		const uint32_t numVertices = static_cast<uint32_t>(sourceVertices.size());
+		Print("Mesh optimizer benchmark, " + std::to_string(sourceIndices.size() / 3) + " triangles, " + std::to_string(numVertices) + " vertices, FIFO cache of " +
+			std::to_string(VERTEX_CACHE_ANALYZE_SIZE) + ", median of " + std::to_string(NUM_RUNS) + " runs");
+		ReportVertexCache("As authored", 0.0, sourceIndices, numVertices);
+
+		// every pass starts from the output of the one before, as at mesh creation
+		std::vector<uint32_t> indices;
+		bool succeeded = true;
+		const double vertexCache = Measure([&]
+		{
+			indices = sourceIndices;
+			succeeded = OptimizeVertexCache(indices, numVertices) && succeeded;
+		});
+		ReportVertexCache("OptimizeVertexCache", vertexCache, indices, numVertices);
+
+		const std::vector<uint32_t> cacheOrder = indices;
+		const double overdraw = Measure([&]
+		{
+			indices = cacheOrder;
+			succeeded = OptimizeOverdraw(indices, &sourceVertices[0].position.x, numVertices, sizeof(Vertex)) && succeeded;
+		});
+		ReportVertexCache("OptimizeOverdraw", overdraw, indices, numVertices);
+
+		const std::vector<uint32_t> overdrawOrder = indices;
+		std::vector<Vertex> vertices;
+		uint32_t numUsedVertices = 0;
+		const double vertexFetch = Measure([&]
+		{
+			indices = overdrawOrder;
+			vertices = sourceVertices;
+			numUsedVertices = OptimizeVertexFetch(indices, vertices.data(), numVertices, sizeof(Vertex));
+		});
+		ReportVertexCache("OptimizeVertexFetch", vertexFetch, indices, numVertices);
+
+		if (!succeeded || numUsedVertices != numVertices || !SameTriangles(sourceVertices, sourceIndices, vertices, indices))
+		{
+			Error("Mesh optimizer benchmark: the optimized mesh does not have the triangles of the source");
+			return;
+		}
+
+		// how far apart in the vertex buffer consecutive fetches are, the fetch order pass makes the walk mostly forwards
+		const auto averageStride = [](const std::vector<uint32_t>& order)
+		{
+			double distance = 0.0;
+			for (size_t index = 1; index < order.size(); index++) distance += std::abs(double(order[index]) - double(order[index - 1]));
+			return distance / double(order.size() - 1);
+		};
+		char buffer[256];
+		snprintf(buffer, sizeof(buffer), "  average distance between fetched vertices: %.0f before, %.0f after the fetch order pass", averageStride(overdrawOrder), averageStride(indices));
+		Print(buffer);
+	}
+}
+
+void ExampleMeshOptimizerBenchmark()
+{
+	EngineAppCreateInfo engineAppCreateInfo{};
+	EngineApp engine;
+	if (engine.Create(engineAppCreateInfo))
+	{
+		meshOptimizerBenchmark::Run();
+	}
+	engine.Destroy();
+}
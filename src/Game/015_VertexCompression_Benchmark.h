@@ -0,0 +1,121 @@
+﻿#include "stdafx.h"
+#include "Benchmark.h"
+#include "Engine/VertexCompression.h"
+#include <glm/gtx/component_wise.hpp>
+#include <random>
+
+namespace vertexCompressionBenchmark
+{
+	using namespace benchmark;
+
+	constexpr uint32_t NUM_SLICES = 1024;
+	constexpr uint32_t NUM_STACKS = 1024; // 1M vertices
+	constexpr uint32_t NUM_RANDOM_VALUES = 1000000;
+
+	// MeshVertex of Data/Shaders/Shared.h
+	struct MeshVertex final
+	{
+		glm::vec3 position;
+		glm::vec2 uv;
+		glm::vec3 normal;
+	};
+	static_assert(sizeof(MeshVertex) == 32);
+
+	// a bumpy sphere 100 units across, uvs wrap it once
+	std::vector<MeshVertex> CreateMesh()
+	{
+		std::vector<MeshVertex> vertices;
+		for (uint32_t stack = 0; stack <= NUM_STACKS; stack++)
+		{
+			const float phi = glm::pi<float>() * stack / NUM_STACKS;
+			for (uint32_t slice = 0; slice <= NUM_SLICES; slice++)
+			{
+				const float theta = glm::two_pi<float>() * slice / NUM_SLICES;
+				const glm::vec3 direction(std::sin(phi) * std::cos(theta), std::cos(phi), std::sin(phi) * std::sin(theta));
+				const float bump = 0.05f * std::sin(theta * 24.0f) * std::sin(phi * 12.0f);
+				vertices.push_back({ direction * 50.0f * (1.0f + bump), { float(slice) / NUM_SLICES, float(stack) / NUM_STACKS },
+					glm::normalize(direction + glm::vec3(bump, -bump, bump)) });
+			}
+		}
+		return vertices;
+	}
+
+	// acos of a float dot product cannot resolve angles this small
+	float AngleDegrees(const glm::vec3& a, const glm::vec3& b)
+	{
+		const glm::dvec3 da(a);
+		const glm::dvec3 db(b);
+		return static_cast<float>(glm::degrees(std::atan2(glm::length(glm::cross(da, db)), glm::dot(da, db))));
+	}
+
+	void Run()
+	{
+		const std::vector<MeshVertex> vertices = CreateMesh();
+		const uint32_t numVertices = static_cast<uint32_t>(vertices.size());
+		Print("Vertex compression benchmark, " + std::to_string(numVertices) + " vertices, median of " + std::to_string(NUM_RUNS) + " runs");
+
+		std::vector<CompressedMeshVertex> compressed(numVertices);
+		PositionQuantization quantization;
+		const double compress = Measure([&]
+		{
+			quantization = CompressMeshVertices(vertices.data(), numVertices, sizeof(MeshVertex), offsetof(MeshVertex, position), offsetof(MeshVertex, normal),
+				offsetof(MeshVertex, uv), compressed.data());
+		});
+		Report("CompressMeshVertices", compress, PerSecond(numVertices, compress, "vertices"));
+		Print("  " + std::to_string(vertices.size() * sizeof(MeshVertex) / 1024) + " KB of MeshVertex, " + std::to_string(compressed.size() * sizeof(CompressedMeshVertex) / 1024) +
+			" KB of CompressedMeshVertex to upload and to fetch");
+
+		// Decoded the way Common.hlsl decodes, the errors have to stay in the bounds VertexCompression.h gives
+		const glm::vec3 extent = quantization.scale * 65535.0f;
+		float positionError = 0.0f;
+		float normalError = 0.0f;
+		float uvError = 0.0f;
+		for (uint32_t vertex = 0; vertex < numVertices; vertex++)
+		{
+			const CompressedMeshVertex& packed = compressed[vertex];
+			const glm::vec3 position = DequantizePosition({ packed.positionXY & 0xFFFF, packed.positionXY >> 16, packed.positionZ & 0xFFFF }, quantization);
+			positionError = std::max(positionError, glm::compMax(glm::abs(position - vertices[vertex].position) / extent));
+			normalError = std::max(normalError, AngleDegrees(UnpackOctahedral(packed.normal), vertices[vertex].normal));
+			uvError = std::max(uvError, glm::compMax(glm::abs(UnpackHalf2(packed.uv) - vertices[vertex].uv)));
+		}
+
+		// tangents and colors are not in MeshVertex, random ones check their packing
+		std::mt19937 random(2025);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		float tangentError = 0.0f;
+		float colorError = 0.0f;
+		bool signsMatch = true;
+		for (uint32_t value = 0; value < NUM_RANDOM_VALUES; value++)
+		{
+			glm::vec3 direction(unit(random), unit(random), unit(random));
+			if (glm::dot(direction, direction) < 1e-6f) continue;
+			const glm::vec4 tangent(glm::normalize(direction), unit(random) < 0.0f ? -1.0f : 1.0f);
+			const glm::vec4 unpackedTangent = UnpackTangent(PackTangent(tangent));
+			tangentError = std::max(tangentError, AngleDegrees(glm::vec3(unpackedTangent), glm::vec3(tangent)));
+			signsMatch = signsMatch && unpackedTangent.w == tangent.w;
+
+			const glm::vec4 color = glm::abs(glm::vec4(unit(random), unit(random), unit(random), unit(random)));
+			colorError = std::max(colorError, glm::compMax(glm::abs(UnpackColor(PackColor(color)) - color)));
+		}
+
+		char buffer[256];
+		snprintf(buffer, sizeof(buffer), "  max errors: position %.2e of the extent, normal %.4f deg, uv %.2e, tangent %.4f deg, color %.4f",
+			positionError, normalError, uvError, tangentError, colorError);
+		Print(buffer);
+		if (positionError > 1.0f / 131070.0f + 1e-6f || normalError > 0.005f || uvError > 1.0f / 2048.0f || tangentError > 0.01f || !signsMatch || colorError > 0.5f / 255.0f + 1e-6f)
+		{
+			Error("Vertex compression benchmark: a decoded attribute is off by more than its format allows");
+		}
+	}
+}
+
+void ExampleVertexCompressionBenchmark()
+{
+	EngineAppCreateInfo engineAppCreateInfo{};
+	EngineApp engine;
+	if (engine.Create(engineAppCreateInfo))
+	{
+		vertexCompressionBenchmark::Run();
+	}
+	engine.Destroy();
+}
@@ -0,0 +1,198 @@
+﻿#include "stdafx.h"
+#include "Benchmark.h"
+#include "Engine/MeshLod.h"
+#include <random>
+
+namespace lodBenchmark
+{
+	using namespace benchmark;
+
+	constexpr uint32_t NUM_SLICES = 512;
+	constexpr uint32_t NUM_STACKS = 256; // 262144 triangles
+	constexpr float    MESH_RADIUS = 10.0f;
+	constexpr uint32_t NUM_INSTANCES = 1000000;
+	constexpr float    WORLD_SIZE = 1000.0f;
+	constexpr uint32_t NUM_FRAMES = 1000;
+
+	// a bumpy sphere, rows of quads from pole to pole
+	void CreateMesh(std::vector<glm::vec3>& positions, std::vector<uint32_t>& indices)
+	{
+		for (uint32_t stack = 0; stack <= NUM_STACKS; stack++)
+		{
+			const float phi = glm::pi<float>() * stack / NUM_STACKS;
+			// exactly 0 at the poles, the triangles there are degenerate instead of slivers of rounding noise
+			const float ring = stack == 0 || stack == NUM_STACKS ? 0.0f : std::sin(phi);
+			for (uint32_t slice = 0; slice <= NUM_SLICES; slice++)
+			{
+				const float theta = glm::two_pi<float>() * slice / NUM_SLICES;
+				const glm::vec3 direction(ring * std::cos(theta), std::cos(phi), ring * std::sin(theta));
+				positions.push_back(direction * MESH_RADIUS * (1.0f + 0.02f * std::sin(theta * 24.0f) * std::sin(phi * 12.0f)));
+			}
+		}
+		for (uint32_t stack = 0; stack < NUM_STACKS; stack++)
+		{
+			for (uint32_t slice = 0; slice < NUM_SLICES; slice++)
+			{
+				const uint32_t v0 = stack * (NUM_SLICES + 1) + slice;
+				const uint32_t v1 = v0 + NUM_SLICES + 1;
+				indices.insert(indices.end(), { v0, v0 + 1, v1, v0 + 1, v1 + 1, v1 });
+			}
+		}
+	}
+
+	// A triangle is inverted when its normal points against the surface of the source mesh at its corners, back-face culling
+	// shows it as a hole. The levels only reference vertices of the source, their normals are the area weighted normals of the
+	// source triangles around them.
+	std::vector<glm::vec3> ComputeVertexNormals(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices)
+	{
+		std::vector<glm::vec3> normals(positions.size(), glm::vec3(0.0f));
+		for (size_t triangle = 0; triangle < indices.size(); triangle += 3)
+		{
+			const glm::vec3& a = positions[indices[triangle]];
+			const glm::vec3 normal = glm::cross(positions[indices[triangle + 1]] - a, positions[indices[triangle + 2]] - a);
+			for (uint32_t corner = 0; corner < 3; corner++) normals[indices[triangle + corner]] += normal;
+		}
+		return normals;
+	}
+
+	uint32_t CountInvertedTriangles(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals, std::span<const uint32_t> indices)
+	{
+		uint32_t numInverted = 0;
+		for (size_t triangle = 0; triangle < indices.size(); triangle += 3)
+		{
+			const glm::vec3& a = positions[indices[triangle]];
+			const glm::vec3 normal = glm::cross(positions[indices[triangle + 1]] - a, positions[indices[triangle + 2]] - a);
+			if (glm::dot(normal, normal) == 0.0f) continue;
+			const glm::vec3 surface = normals[indices[triangle]] + normals[indices[triangle + 1]] + normals[indices[triangle + 2]];
+			numInverted += glm::dot(normal, surface) < 0.0f ? 1 : 0;
+		}
+		return numInverted;
+	}
+
+	void Run()
+	{
+		std::vector<glm::vec3> positions;
+		std::vector<uint32_t> indices;
+		CreateMesh(positions, indices);
+		const uint32_t numVertices = static_cast<uint32_t>(positions.size());
+		Print("LOD benchmark, " + std::to_string(indices.size() / 3) + " triangles, " + std::to_string(numVertices) + " vertices, " + std::to_string(NUM_INSTANCES) +
+			" instances, median of " + std::to_string(NUM_RUNS) + " runs");
+
+		MeshLodChain chain;
+		bool succeeded = true;
+		const double build = Measure([&] { succeeded = BuildLodChain(indices, &positions[0].x, numVertices, sizeof(glm::vec3), LodChainDesc{}, chain) && succeeded; });
+		Report("BuildLodChain", build, PerSecond(double(indices.size() / 3), build, "source triangles"));
+		bool chainValid = succeeded && !chain.lods.empty();
+		const std::vector<glm::vec3> normals = ComputeVertexNormals(positions, indices);
+		for (size_t lod = 0; lod < chain.lods.size(); lod++)
+		{
+			const MeshLod& level = chain.lods[lod];
+			bool indicesValid = true;
+			for (uint32_t index = 0; index < level.indexCount; index++) indicesValid = indicesValid && chain.indices[level.startIndexLocation + index] < numVertices;
+			const uint32_t numInverted = indicesValid ? CountInvertedTriangles(positions, normals, std::span(chain.indices).subspan(level.startIndexLocation, level.indexCount)) : 0;
+			char buffer[256];
+			snprintf(buffer, sizeof(buffer), "  LOD %zu: %7u triangles, error %.4f (%.3f%% of the radius), %u inverted", lod, level.indexCount / 3, level.error,
+				100.0f * level.error / MESH_RADIUS, numInverted);
+			Print(buffer);
+			chainValid = chainValid && indicesValid && numInverted == 0;
+			if (lod > 0) chainValid = chainValid && level.indexCount < chain.lods[lod - 1].indexCount && level.error >= chain.lods[lod - 1].error;
+		}
+		if (!chainValid)
+		{
+			Error("LOD benchmark: the LOD chain is not a valid chain of decreasing triangle counts without inverted triangles");
+			return;
+		}
+
+		// a 1080p view with a 60 degree vertical fov, the instances scattered around the camera
+		LodSelectionParams params;
+		params.projectionScale = LodSelectionParams::ProjectionScale(glm::radians(60.0f), 1080.0f);
+		params.maxPixelError = 1.0f;
+		params.hysteresis = 0.1f;
+		std::mt19937 random(2025);
+		std::uniform_real_distribution<float> coordinate(-WORLD_SIZE * 0.5f, WORLD_SIZE * 0.5f);
+		std::uniform_real_distribution<float> scales(0.5f, 2.0f);
+		LodInstances sourceInstances;
+		sourceInstances.Reserve(NUM_INSTANCES);
+		for (uint32_t instance = 0; instance < NUM_INSTANCES; instance++)
+		{
+			const float scale = scales(random);
+			sourceInstances.Add({ coordinate(random), coordinate(random), coordinate(random) }, MESH_RADIUS * 1.02f * scale, scale);
+		}
+
+		// One selection from the same levels for every path, they have to select the same ones. The timed runs repeat it on levels
+		// that were already selected, the work per instance is the same.
+		std::array<LodInstances, 3> instances{ sourceInstances, sourceInstances, sourceInstances };
+		const CullingPath paths[] = { CullingPath::scalar, CullingPath::sse, CullingPath::avx2 };
+		const char* names[] = { "SelectLods scalar", "SelectLods SSE", "SelectLods AVX2" };
+		double baseline = 0.0;
+		for (size_t path = 0; path < std::size(paths); path++)
+		{
+			if (paths[path] == CullingPath::avx2 && GetBestCullingPath() != CullingPath::avx2) continue;
+			SelectLods(params, chain.lods, instances[path], 0, NUM_INSTANCES, paths[path]);
+			if (!std::equal(instances[path].GetLods(), instances[path].GetLods() + NUM_INSTANCES, instances[0].GetLods()))
+			{
+				Error("LOD benchmark: the SIMD paths select other levels than the scalar one");
+				return;
+			}
+			LodInstances timed = instances[path];
+			const double time = Measure([&] { SelectLods(params, chain.lods, timed, 0, NUM_INSTANCES, paths[path]); });
+			if (path == 0) baseline = time;
+			Report(names[path], time, baseline);
+		}
+
+		std::array<uint32_t, MAX_MESH_LODS> histogram{};
+		uint64_t numTriangles = 0;
+		for (uint32_t instance = 0; instance < NUM_INSTANCES; instance++)
+		{
+			const uint32_t lod = instances[0].GetLods()[instance];
+			histogram[lod]++;
+			numTriangles += chain.lods[lod].indexCount / 3;
+		}
+		std::string levels = "  instances per LOD:";
+		for (size_t lod = 0; lod < chain.lods.size(); lod++) levels += " " + std::to_string(histogram[lod]);
+		Print(levels);
+		char buffer[256];
+		snprintf(buffer, sizeof(buffer), "  %.0f M triangles instead of %.0f M at full detail", double(numTriangles) * 1e-6, double(indices.size() / 3) * double(NUM_INSTANCES) * 1e-6);
+		Print(buffer);
+
+		// A camera shaking 2% around the distance where LOD 1 becomes acceptable: without hysteresis the level switches almost
+		// every frame, with it the level stays.
+		const float switchDistance = chain.lods.size() > 1 ? chain.lods[1].error * params.projectionScale / params.maxPixelError + MESH_RADIUS * 1.02f : 100.0f;
+		const auto countSwitches = [&](float hysteresis)
+		{
+			LodSelectionParams shaking = params;
+			shaking.hysteresis = hysteresis;
+			LodInstances single;
+			single.Add(glm::vec3(0.0f), MESH_RADIUS * 1.02f, 1.0f);
+			uint32_t numSwitches = 0;
+			for (uint32_t frame = 0; frame < NUM_FRAMES; frame++)
+			{
+				const uint32_t previous = single.GetLods()[0];
+				shaking.cameraPosition = glm::vec3(0.0f, 0.0f, switchDistance * (1.0f + 0.02f * std::sin(float(frame) * 0.7f)));
+				SelectLods(shaking, chain.lods, single, 0, 1);
+				numSwitches += single.GetLods()[0] != previous ? 1 : 0;
+			}
+			return numSwitches;
+		};
+		const uint32_t withoutHysteresis = countSwitches(0.0f);
+		const uint32_t withHysteresis = countSwitches(params.hysteresis);
+		snprintf(buffer, sizeof(buffer), "  LOD switches over %u frames around the LOD 1 distance: %u without hysteresis, %u with %.0f%%", NUM_FRAMES, withoutHysteresis,
+			withHysteresis, params.hysteresis * 100.0f);
+		Print(buffer);
+		if (withHysteresis > 1)
+		{
+			Error("LOD benchmark: the hysteresis band does not keep the level");
+		}
+	}
+}
+
+void ExampleLodBenchmark()
+{
+	EngineAppCreateInfo engineAppCreateInfo{};
+	EngineApp engine;
+	if (engine.Create(engineAppCreateInfo))
+	{
+		lodBenchmark::Run();
+	}
+	engine.Destroy();
+}
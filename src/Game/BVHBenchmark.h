@@ -0,0 +1,135 @@
+﻿#pragma once
+
+// The BVH benchmark without the sample around it: 009_BVH_Benchmark.h runs it in the engine app on Windows,
+// Benchmarks/BVHBenchmark.cpp on the platforms the CMake build covers. It needs no more than the platform independent engine.
+#include "Benchmark.h"
+#include "Engine/JobSystem.h"
+#include "Engine/FrustumCulling.h"
+#include "Engine/BoundingVolumeHierarchy.h"
+#include <atomic>
+#include <random>
+
+namespace bvhBenchmark
+{
+	using namespace benchmark;
+
+	constexpr uint32_t NUM_BOXES = 1000000;
+	constexpr uint32_t NUM_RAYS = 100000;
+	constexpr uint32_t NUM_SPHERES = 100000;
+	constexpr uint32_t NUM_VIEWS = 16;
+
+	void Run(JobSystem& jobSystem)
+	{
+		Print("BVH benchmark, " + std::to_string(NUM_BOXES) + " boxes, " + std::to_string(jobSystem.GetNumWorkerThreads()) + " worker threads, median of " + std::to_string(NUM_RUNS) + " runs");
+
+		// a static city: boxes spread over the ground
+		CullingBounds bounds;
+		bounds.Reserve(NUM_BOXES);
+		std::mt19937 random(2025);
+		std::uniform_real_distribution<float> position(-2000.0f, 2000.0f);
+		std::uniform_real_distribution<float> height(0.0f, 50.0f);
+		std::uniform_real_distribution<float> extent(0.5f, 10.0f);
+		for (uint32_t i = 0; i < NUM_BOXES; i++)
+			bounds.Add({ position(random), height(random), position(random) }, { extent(random), extent(random), extent(random) });
+
+		// build
+		BoundingVolumeHierarchy bvh;
+		const double serialBuild = Measure([&] { (void)bvh.Build(bounds); });
+		Report("build, 1 thread", serialBuild, serialBuild, bvh.GetNodes().size());
+		const double parallelBuild = Measure([&] { (void)bvh.Build(bounds, &jobSystem); });
+		Report("build, job system", parallelBuild, serialBuild, bvh.GetNodes().size());
+		Print("  depth " + std::to_string(bvh.GetDepth()) + ", SAH cost " + std::to_string(bvh.GetSAHCost()) + ", " +
+			std::to_string(bvh.GetNodes().size() * sizeof(BvhNode) / 1024) + " KiB of nodes");
+
+		// views close to the ground see a small part of the city, brute force tests every box
+		std::vector<CullingFrustum> frustums(NUM_VIEWS);
+		for (CullingFrustum& frustum : frustums)
+		{
+			const glm::vec3 eye(position(random) * 0.5f, 20.0f, position(random) * 0.5f);
+			const glm::mat4 view = glm::lookAtLH(eye, eye + glm::vec3(position(random), -10.0f, position(random)), glm::vec3(0.0f, 1.0f, 0.0f));
+			frustum = CullingFrustum::FromViewProjection(glm::perspectiveFovLH_ZO(glm::radians(60.0f), 1600.0f, 900.0f, 0.1f, 500.0f) * view);
+		}
+		FrustumCuller culler;
+		uint64_t bruteForceVisible = 0;
+		const double bruteForce = Measure([&]
+		{
+			bruteForceVisible = 0;
+			for (const CullingFrustum& frustum : frustums) bruteForceVisible += culler.Cull(frustum, bounds, &jobSystem).size();
+		});
+		Report("frustums, FrustumCuller", bruteForce, bruteForce, bruteForceVisible);
+
+		std::vector<std::vector<uint32_t>> visible(NUM_VIEWS);
+		uint64_t bvhVisible = 0;
+		const double bvhFrustums = Measure([&]
+		{
+			jobSystem.ParallelFor(NUM_VIEWS, [&](uint32_t begin, uint32_t end)
+			{
+				for (uint32_t view = begin; view < end; view++)
+				{
+					visible[view].clear();
+					bvh.QueryFrustum(frustums[view], visible[view]);
+				}
+			});
+			bvhVisible = 0;
+			for (const std::vector<uint32_t>& primitives : visible) bvhVisible += primitives.size();
+		});
+		Report("frustums, BVH", bvhFrustums, bruteForce, bvhVisible);
+		if (bvhVisible != bruteForceVisible)
+			Error("BVH benchmark: " + std::to_string(bvhVisible) + " visible boxes instead of " + std::to_string(bruteForceVisible));
+
+		// rays along the ground and spheres around random points, one query per ParallelFor item
+		std::vector<BvhRay> rays(NUM_RAYS);
+		for (BvhRay& ray : rays)
+		{
+			ray.origin = { position(random), height(random), position(random) };
+			ray.direction = glm::normalize(glm::vec3(position(random), position(random) * 0.01f, position(random)));
+			ray.maxDistance = 1000.0f;
+		}
+		std::atomic<uint64_t> numHits{ 0 };
+		const double raycasts = Measure([&]
+		{
+			numHits = 0;
+			jobSystem.ParallelFor(NUM_RAYS, [&](uint32_t begin, uint32_t end)
+			{
+				uint64_t hits = 0;
+				for (uint32_t ray = begin; ray < end; ray++)
+				{
+					BvhRayHit hit;
+					hits += bvh.Raycast(rays[ray], hit) ? 1 : 0;
+				}
+				numHits += hits;
+			}, 256);
+		});
+		Report("raycasts, BVH", raycasts, PerSecond(NUM_RAYS, raycasts, "rays") + "  (" + std::to_string(numHits.load()) + " hits)");
+
+		std::vector<glm::vec3> sphereCenters(NUM_SPHERES);
+		for (glm::vec3& center : sphereCenters) center = { position(random), height(random), position(random) };
+		std::atomic<uint64_t> numOverlaps{ 0 };
+		const double spheres = Measure([&]
+		{
+			numOverlaps = 0;
+			jobSystem.ParallelFor(NUM_SPHERES, [&](uint32_t begin, uint32_t end)
+			{
+				std::vector<uint32_t> overlaps;
+				for (uint32_t sphere = begin; sphere < end; sphere++)
+				{
+					overlaps.clear();
+					bvh.QuerySphere(sphereCenters[sphere], 10.0f, overlaps);
+					numOverlaps += overlaps.size();
+				}
+			}, 256);
+		});
+		Report("sphere queries, BVH", spheres, PerSecond(NUM_SPHERES, spheres, "queries") + "  (" + std::to_string(numOverlaps.load()) + " overlaps)");
+
+		// every box drifts a little, refit against a rebuild
+		std::uniform_real_distribution<float> drift(-2.0f, 2.0f);
+		for (uint32_t i = 0; i < NUM_BOXES; i++)
+		{
+			const glm::vec3 center(bounds.GetCenterX()[i] + drift(random), bounds.GetCenterY()[i], bounds.GetCenterZ()[i] + drift(random));
+			bounds.Set(i, center, { bounds.GetExtentX()[i], bounds.GetExtentY()[i], bounds.GetExtentZ()[i] });
+		}
+		const double refit = Measure([&] { bvh.Refit(bounds); });
+		Report("refit, 1 thread", refit, serialBuild, bvh.GetNodes().size()); // against the build on 1 thread it replaces
+		Print("  SAH cost after refit " + std::to_string(bvh.GetSAHCost()));
+	}
+}
@@ -0,0 +1,71 @@
+﻿#pragma once
+
+#include "Engine/CommandStream.h"
+
+// Timing and output of the benchmark samples. A time is the median of NUM_RUNS runs, a line of the report is the name, the
+// time and a detail, usually the speedup over a baseline.
+namespace benchmark
+{
+	constexpr uint32_t NUM_RUNS = 7;
+
+	// median of NUM_RUNS runs, milliseconds
+	template<typename F>
+	double Measure(F&& run)
+	{
+		std::array<double, NUM_RUNS> times{};
+		for (double& time : times)
+		{
+			const uint64_t beginTime = ProfilerGetTime();
+			run();
+			time = static_cast<double>(ProfilerGetTime() - beginTime) * 1e-6;
+		}
+		std::sort(times.begin(), times.end());
+		return times[NUM_RUNS / 2];
+	}
+
+	// one value in printf format, e.g. Format("%.1f ns/job", nanoseconds) as the detail of a report
+	inline std::string Format(const char* format, double value)
+	{
+		char buffer[64];
+		snprintf(buffer, sizeof(buffer), format, value);
+		return buffer;
+	}
+
+	// a throughput as the detail of a report, e.g. "12.34 million rays/s"
+	inline std::string PerSecond(double count, double milliseconds, const char* unit)
+	{
+		return Format("%6.2f million ", count / milliseconds * 1e-3) + unit + "/s";
+	}
+
+	inline void Report(const char* name, double milliseconds, const std::string& detail)
+	{
+		char buffer[256];
+		snprintf(buffer, sizeof(buffer), "  %-40s %9.3f ms  %s", name, milliseconds, detail.c_str());
+		Print(buffer);
+	}
+
+	inline void Report(const char* name, double milliseconds, double baseline)
+	{
+		char buffer[32];
+		snprintf(buffer, sizeof(buffer), "%6.2fx", baseline / milliseconds);
+		Report(name, milliseconds, buffer);
+	}
+
+	// count: a checksum or the number of results, so that the compiler keeps the work and the paths can be compared
+	inline void Report(const char* name, double milliseconds, double baseline, uint64_t count, const char* unit = nullptr)
+	{
+		char buffer[64];
+		snprintf(buffer, sizeof(buffer), "%6.2fx  (%llu%s%s)", baseline / milliseconds, static_cast<unsigned long long>(count), unit ? " " : "", unit ? unit : "");
+		Report(name, milliseconds, buffer);
+	}
+
+	// what replaying the stream would submit, the null replay counts it
+	inline void ReportStream(const char* name, const CommandStream& stream)
+	{
+		const CommandStreamStats stats = ReplayCommandStreamNull(stream);
+		char buffer[256];
+		snprintf(buffer, sizeof(buffer), "  %-40s %7u draws  %7u SetPipeline  %7u SetPipelineResources  %7u commands", name,
+			stats.numDraws, stats.numPipelineChanges, stats.numResourceBindings, stats.numCommands);
+		Print(buffer);
+	}
+}
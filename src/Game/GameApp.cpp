@@ -1,51 +1,97 @@
 ﻿#include "stdafx.h"
 
-void GameApp()
+// Everything the render function needs from the simulation of one frame
+struct RenderPacket final
+{
+	glm::vec4 clearColor{ 0.4f, 0.6f, 0.9f, 1.0f };
+	float     interpolationAlpha{ 0.0f }; // between the previous and the current simulation tick
+};
+
+// The simulation of the sample: the clear color pulses at a fixed rate, whatever the frame rate
+struct SimulationState final
+{
+	double phase{ 0.0 }; // radians
+};
+
+void Simulate(SimulationState& state, double tickSeconds)
+{
+	constexpr double PULSES_PER_SECOND = 0.25;
+	state.phase += glm::two_pi<double>() * PULSES_PER_SECOND * tickSeconds;
+}
+
+glm::vec4 ClearColor(const SimulationState& previous, const SimulationState& current, float alpha)
+{
+	const float pulse = 0.5f + 0.5f * static_cast<float>(std::sin(glm::mix(previous.phase, current.phase, double(alpha))));
+	return glm::vec4(glm::mix(glm::vec3(0.4f, 0.6f, 0.9f), glm::vec3(0.2f, 0.3f, 0.6f), pulse), 1.0f);
+}
+
+void RenderFrame(const RenderPacket& packet)
+{
+	gRHI.Prepare();
+
+	// Clear the render target.
+	{
+		auto commandList = gRHI.GetCommandList();
+		const auto rtvDescriptor = gRHI.GetRenderTargetView();
+		const auto dsvDescriptor = gRHI.GetDepthStencilView();
+		const auto viewport = gRHI.GetScreenViewport();
+		const auto scissorRect = gRHI.GetScissorRect();
+
+		PIXBeginEvent(commandList, PIX_COLOR_DEFAULT, L"Clear");
+
+		commandList->OMSetRenderTargets(1, &rtvDescriptor, FALSE, &dsvDescriptor);
+		commandList->ClearRenderTargetView(rtvDescriptor, &packet.clearColor[0], 0, nullptr);
+		commandList->ClearDepthStencilView(dsvDescriptor, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+		commandList->RSSetViewports(1, &viewport);
+		commandList->RSSetScissorRects(1, &scissorRect);
+
+		PIXEndEvent(commandList);
+	}
+
+	auto commandList = gRHI.GetCommandList();
+	PIXBeginEvent(commandList, PIX_COLOR_DEFAULT, L"Render");
+	{
+		// TODO: Add your rendering code here.
+	}
+	PIXEndEvent(commandList);
+
+	PIXBeginEvent(PIX_COLOR_DEFAULT, L"Present");
+	gRHI.Present();
+	PIXEndEvent();
+}
+
+void GameApp(int argc, char* argv[])
 {
 	EngineAppCreateInfo engineAppCreateInfo{};
-	EngineApp engine;
-	if (engine.Create(engineAppCreateInfo))
+	ParseProfilerCommandLine(argc, argv, engineAppCreateInfo.profiler);
+	for (int i = 1; i < argc; i++)
 	{
-		auto& rhi = engine.GetRenderSystem();
+		if (strcmp(argv[i], "--pipelined") == 0) engineAppCreateInfo.pipelinedFrames = true;
+	}
 
+	EngineApp engine;
+	RenderPackets<RenderPacket> renderPackets;
+	SimulationState previousState;
+	SimulationState currentState;
+	if (engine.Create(engineAppCreateInfo) && 
+		engine.SetRenderFunction([&renderPackets](uint32_t packetIndex, uint64_t) { RenderFrame(renderPackets[packetIndex]); }))
+	{
 		while (!engine.IsShouldClose())
 		{
 			engine.BeginFrame();
+			if (engine.IsShouldClose()) break;
+
+			// Update
+			while (engine.StepSimulation())
+			{
+				previousState = currentState;
+				Simulate(currentState, engine.GetTimestep().GetTickSeconds());
+			}
 
-			// Render
 			{
-				gRHI.Prepare();
-
-				// Clear the render target.
-				{
-					const FLOAT clearColor[] = { 0.4f, 0.6f, 0.9f, 1.0f };
-					auto commandList = gRHI.GetCommandList();
-					const auto rtvDescriptor = gRHI.GetRenderTargetView();
-					const auto dsvDescriptor = gRHI.GetDepthStencilView();
-					const auto viewport = gRHI.GetScreenViewport();
-					const auto scissorRect = gRHI.GetScissorRect();
-
-					PIXBeginEvent(commandList, PIX_COLOR_DEFAULT, L"Clear");
-
-					commandList->OMSetRenderTargets(1, &rtvDescriptor, FALSE, &dsvDescriptor);
-					commandList->ClearRenderTargetView(rtvDescriptor, clearColor, 0, nullptr);
-					commandList->ClearDepthStencilView(dsvDescriptor, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
-					commandList->RSSetViewports(1, &viewport);
-					commandList->RSSetScissorRects(1, &scissorRect);
-
-					PIXEndEvent(commandList);
-				}
-
-				auto commandList = gRHI.GetCommandList();
-				PIXBeginEvent(commandList, PIX_COLOR_DEFAULT, L"Render");
-				{
-					// TODO: Add your rendering code here.
-				}
-				PIXEndEvent(commandList);
-
-				PIXBeginEvent(PIX_COLOR_DEFAULT, L"Present");
-				gRHI.Present();
-				PIXEndEvent();
+				RenderPacket& packet = renderPackets[engine.GetRenderPacketIndex()];
+				packet.interpolationAlpha = static_cast<float>(engine.GetTimestep().GetInterpolationAlpha());
+				packet.clearColor = ClearColor(previousState, currentState, packet.interpolationAlpha);
 			}
 
 			engine.EndFrame();
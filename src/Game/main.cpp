@@ -6,6 +6,17 @@
 #	include "003_Render_TriangleBundles.h"
 #	include "004_Render_TriangleCB.h"
 #	include "005_Render_Cube.h"
+#	include "006_JobSystem_Benchmark.h"
+#	include "007_SubmeshTable_Benchmark.h"
+#	include "008_FrustumCulling_Benchmark.h"
+#	include "009_BVH_Benchmark.h"
+#	include "010_DrawList_Benchmark.h"
+#	include "011_Instancing_Benchmark.h"
+#	include "012_IndirectDraw_Benchmark.h"
+#	include "013_Meshlet_Benchmark.h"
+#	include "014_MeshOptimizer_Benchmark.h"
+#	include "015_VertexCompression_Benchmark.h"
+#	include "016_Lod_Benchmark.h"
 
 #	include "xxx_Render_Test.h"
 #endif
@@ -26,11 +37,22 @@ int main(
 	//ExampleRender003();
 	//ExampleRender004();
 	//ExampleRender005();
+	//ExampleJobSystemBenchmark();
+	//ExampleSubmeshTableBenchmark();
+	//ExampleFrustumCullingBenchmark();
+	//ExampleBVHBenchmark();
+	//ExampleDrawListBenchmark();
+	//ExampleInstancingBenchmark();
+	//ExampleIndirectDrawBenchmark();
+	//ExampleMeshletBenchmark();
+	//ExampleMeshOptimizerBenchmark();
+	//ExampleVertexCompressionBenchmark();
+	//ExampleLodBenchmark();
 
 	ExampleRenderXXX();
 #else
-	extern void GameApp();
-	GameApp();
+	extern void GameApp(int argc, char* argv[]);
+	GameApp(argc, argv);
 #endif
 }
 //=============================================================================
\ No newline at end of file
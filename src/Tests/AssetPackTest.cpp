@@ -0,0 +1,115 @@
+﻿#include "Test.h"
+#include "Engine/AssetPack.h"
+#include <fstream>
+//=============================================================================
+namespace
+{
+	void writeTextFile(const std::filesystem::path& path, const std::string& text)
+	{
+		std::filesystem::create_directories(path.parent_path());
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file << text;
+	}
+
+	bool hashTriangle(const std::vector<std::wstring>& defines, uint64_t& hash, const std::wstring& target = L"vs_6_6", const std::wstring& entryPoint = L"VertexShader")
+	{
+		return HashShaderSource("Data/Shaders/", L"Triangle.hlsl", entryPoint, target, defines, hash);
+	}
+
+	// The layout of bin: the shaders include Common.hlsl by its path from the working directory, Common.hlsl includes Shared.h
+	// next to it
+	void TestShaderSourceHash()
+	{
+		writeTextFile("Data/Shaders/Triangle.hlsl", "#include \"Data/Shaders/Common.hlsl\"\nfloat4 VertexShader() : SV_Position { return 0; }\n");
+		writeTextFile("Data/Shaders/Common.hlsl", "#include \"Shared.h\"\n");
+		writeTextFile("Data/Shaders/Shared.h", "#define SHARED 1\n");
+
+		uint64_t hash = 0;
+		CHECK(hashTriangle({}, hash));
+		uint64_t again = 0;
+		CHECK(hashTriangle({}, again));
+		CHECK(hash == again);
+
+		// every input of the compilation changes it
+		uint64_t other = 0;
+		CHECK(hashTriangle({ L"USE_FOG=1" }, other));
+		CHECK(other != hash);
+		CHECK(hashTriangle({}, other, L"ps_6_6"));
+		CHECK(other != hash);
+		CHECK(hashTriangle({}, other, L"vs_6_6", L"OtherShader"));
+		CHECK(other != hash);
+
+		// the order of the defines does not
+		uint64_t defines = 0;
+		CHECK(hashTriangle({ L"A=1", L"B=0" }, defines));
+		CHECK(hashTriangle({ L"B=0", L"A=1" }, other));
+		CHECK(defines == other);
+
+		// an edited include, two levels down, makes the cooked shader stale
+		writeTextFile("Data/Shaders/Shared.h", "#define SHARED 2\n");
+		CHECK(hashTriangle({}, other));
+		CHECK(other != hash);
+
+		// a missing include
+		writeTextFile("Data/Shaders/Common.hlsl", "#include \"Missing.h\"\n");
+		CHECK(!hashTriangle({}, other));
+		CHECK(!HashShaderSource("Data/Shaders/", L"Missing.hlsl", L"VertexShader", L"vs_6_6", {}, other));
+	}
+
+	void TestShaderAssetName()
+	{
+		CHECK(MakeShaderAssetName(L"Mesh.hlsl", L"VertexShader", L"", {}) == "Shaders/Mesh.hlsl/VertexShader");
+		CHECK(MakeShaderAssetName(L"Mesh.hlsl", L"VertexShader", L"0000000000000001", {}) == "Shaders/Mesh.hlsl/VertexShader/0000000000000001");
+
+		const std::string name = MakeShaderAssetName(L"Mesh.hlsl", L"VertexShader", L"0000000000000001", { L"USE_FOG=1", L"SKINNED=0" });
+		CHECK(name == "Shaders/Mesh.hlsl/VertexShader/0000000000000001/SKINNED=0,USE_FOG=1");
+		CHECK(name == MakeShaderAssetName(L"Mesh.hlsl", L"VertexShader", L"0000000000000001", { L"SKINNED=0", L"USE_FOG=1" }));
+		// the same variant key with other defines, e.g. features registered in another order
+		CHECK(name != MakeShaderAssetName(L"Mesh.hlsl", L"VertexShader", L"0000000000000001", { L"USE_FOG=0", L"SKINNED=1" }));
+	}
+
+	void TestPackRoundTrip()
+	{
+		const std::string shader = "DXBC shader";
+		const std::string texture = "DDS texture";
+		AssetPackWriter writer;
+		writer.AddAsset("Textures/Wood.dds", AssetType::texture, 2, texture.data(), texture.size());
+		writer.AddAsset("Shaders/Mesh.hlsl/VertexShader", AssetType::shader, 1, shader.data(), shader.size());
+		CHECK(writer.Write("Test.pak"));
+
+		AssetPack pack;
+		CHECK(pack.Open("Test.pak"));
+		CHECK(pack.GetEntries().size() == 2);
+		const AssetPackEntry* entry = pack.Find("Shaders/Mesh.hlsl/VertexShader");
+		CHECK(entry != nullptr);
+		if (entry)
+		{
+			CHECK(entry->type == AssetType::shader);
+			CHECK(entry->sourceHash == 1);
+			CHECK(std::string(reinterpret_cast<const char*>(pack.GetData(*entry)), entry->size) == shader);
+		}
+		CHECK(pack.Find("Shaders/Mesh.hlsl/PixelShader") == nullptr);
+
+		// a truncated pack is rejected
+		std::filesystem::resize_file("Test.pak", std::filesystem::file_size("Test.pak") - 1);
+		CHECK(!pack.Open("Test.pak"));
+	}
+}
+//=============================================================================
+int main()
+{
+	// Shader includes resolve against the working directory, the tests run in a directory of their own
+	const std::filesystem::path workingDirectory = std::filesystem::current_path();
+	const std::filesystem::path testDirectory = std::filesystem::temp_directory_path() / "AssetPackTest";
+	std::filesystem::remove_all(testDirectory);
+	std::filesystem::create_directories(testDirectory);
+	std::filesystem::current_path(testDirectory);
+
+	TestShaderSourceHash();
+	TestShaderAssetName();
+	TestPackRoundTrip();
+
+	std::filesystem::current_path(workingDirectory);
+	std::filesystem::remove_all(testDirectory);
+	return TestResult("AssetPackTest");
+}
@@ -0,0 +1,176 @@
+﻿#include "Test.h"
+#include "Engine/BoundingVolumeHierarchy.h"
+#include "Engine/FrustumCulling.h"
+#include "Engine/JobSystem.h"
+#include <random>
+//=============================================================================
+namespace
+{
+	constexpr uint32_t NUM_BOXES = 20000;
+
+	void makeBounds(CullingBounds& bounds, std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+		std::uniform_real_distribution<float> extent(0.1f, 5.0f);
+		bounds.Clear();
+		for (uint32_t box = 0; box < NUM_BOXES; box++)
+			bounds.Add({ position(random), position(random) * 0.1f, position(random) }, { extent(random), extent(random), extent(random) });
+	}
+
+	glm::vec3 getMin(const CullingBounds& bounds, uint32_t box)
+	{
+		return { bounds.GetCenterX()[box] - bounds.GetExtentX()[box], bounds.GetCenterY()[box] - bounds.GetExtentY()[box], bounds.GetCenterZ()[box] - bounds.GetExtentZ()[box] };
+	}
+
+	glm::vec3 getMax(const CullingBounds& bounds, uint32_t box)
+	{
+		return { bounds.GetCenterX()[box] + bounds.GetExtentX()[box], bounds.GetCenterY()[box] + bounds.GetExtentY()[box], bounds.GetCenterZ()[box] + bounds.GetExtentZ()[box] };
+	}
+
+	std::vector<uint32_t> sorted(std::vector<uint32_t> primitives)
+	{
+		std::sort(primitives.begin(), primitives.end());
+		return primitives;
+	}
+
+	// slab test, the entry distance or -1 for a miss
+	float rayEnters(const BvhRay& ray, const glm::vec3& min, const glm::vec3& max)
+	{
+		float entry = 0.0f;
+		float exit = ray.maxDistance;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			if (ray.direction[axis] == 0.0f)
+			{
+				if (ray.origin[axis] < min[axis] || ray.origin[axis] > max[axis]) return -1.0f;
+				continue;
+			}
+			float near = (min[axis] - ray.origin[axis]) / ray.direction[axis];
+			float far = (max[axis] - ray.origin[axis]) / ray.direction[axis];
+			if (near > far) std::swap(near, far);
+			entry = std::max(entry, near);
+			exit = std::min(exit, far);
+		}
+		return entry <= exit ? entry : -1.0f;
+	}
+
+	// The queries find what testing every box finds
+	void checkQueries(const BoundingVolumeHierarchy& bvh, const CullingBounds& bounds, std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+		for (uint32_t view = 0; view < 8; view++)
+		{
+			const glm::vec3 eye(unit(random) * 100.0f, 10.0f, unit(random) * 100.0f);
+			const glm::mat4 viewMatrix = glm::lookAtRH(eye, eye + glm::vec3(unit(random), -0.2f, unit(random)), glm::vec3(0.0f, 1.0f, 0.0f));
+			const CullingFrustum frustum = CullingFrustum::FromViewProjection(glm::perspectiveRH_ZO(glm::radians(60.0f), 1.6f, 0.1f, 150.0f) * viewMatrix);
+
+			std::vector<uint32_t> expected(NUM_BOXES);
+			expected.resize(CullBoxes(frustum, bounds, 0, NUM_BOXES, expected.data(), CullingPath::scalar));
+			std::vector<uint32_t> found;
+			bvh.QueryFrustum(frustum, found);
+			CHECK(sorted(found) == expected);
+		}
+
+		for (uint32_t sphere = 0; sphere < 64; sphere++)
+		{
+			const glm::vec3 center(unit(random) * 200.0f, unit(random) * 20.0f, unit(random) * 200.0f);
+			const float radius = 2.0f + 20.0f * std::abs(unit(random));
+			std::vector<uint32_t> expected;
+			for (uint32_t box = 0; box < NUM_BOXES; box++)
+			{
+				const glm::vec3 closest = glm::clamp(center, getMin(bounds, box), getMax(bounds, box));
+				if (glm::dot(closest - center, closest - center) <= radius * radius) expected.push_back(box);
+			}
+			std::vector<uint32_t> found;
+			bvh.QuerySphere(center, radius, found);
+			CHECK(sorted(found) == expected);
+		}
+
+		uint32_t numHits = 0;
+		for (uint32_t rayIndex = 0; rayIndex < 256; rayIndex++)
+		{
+			BvhRay ray;
+			ray.origin = { unit(random) * 200.0f, unit(random) * 20.0f, unit(random) * 200.0f };
+			ray.direction = { unit(random), unit(random) * 0.05f, unit(random) };
+			ray.maxDistance = 300.0f;
+
+			float nearest = -1.0f;
+			for (uint32_t box = 0; box < NUM_BOXES; box++)
+			{
+				const float distance = rayEnters(ray, getMin(bounds, box), getMax(bounds, box));
+				if (distance >= 0.0f && (nearest < 0.0f || distance < nearest)) nearest = distance;
+			}
+
+			BvhRayHit hit;
+			const bool hasHit = bvh.Raycast(ray, hit);
+			CHECK(hasHit == (nearest >= 0.0f));
+			if (!hasHit || nearest < 0.0f) continue;
+			numHits++;
+			// ties may report either box, the distance is the same
+			CHECK_NEAR(hit.distance, nearest, 1e-3);
+			CHECK_NEAR(rayEnters(ray, getMin(bounds, hit.primitive), getMax(bounds, hit.primitive)), nearest, 1e-3);
+		}
+		CHECK(numHits > 0);
+	}
+
+	void TestQueries()
+	{
+		std::mt19937 random(11);
+		CullingBounds bounds;
+		makeBounds(bounds, random);
+
+		BoundingVolumeHierarchy bvh;
+		CHECK(bvh.Build(bounds));
+		CHECK(bvh.GetNumPrimitives() == NUM_BOXES);
+		CHECK(bvh.GetDepth() > 0 && bvh.GetDepth() <= BVH_MAX_DEPTH);
+		checkQueries(bvh, bounds, random);
+
+		// a parallel build gives a tree that answers the same
+		JobSystem jobSystem;
+		JobSystemCreateInfo createInfo;
+		createInfo.numWorkerThreads = 3;
+		CHECK(jobSystem.Create(createInfo));
+		BoundingVolumeHierarchy parallelBvh;
+		CHECK(parallelBvh.Build(bounds, &jobSystem));
+		checkQueries(parallelBvh, bounds, random);
+		jobSystem.Destroy();
+
+		// moved boxes are found at their new places after a refit
+		std::uniform_real_distribution<float> drift(-3.0f, 3.0f);
+		for (uint32_t box = 0; box < NUM_BOXES; box++)
+		{
+			const glm::vec3 center(bounds.GetCenterX()[box] + drift(random), bounds.GetCenterY()[box], bounds.GetCenterZ()[box] + drift(random));
+			bounds.Set(box, center, { bounds.GetExtentX()[box], bounds.GetExtentY()[box], bounds.GetExtentZ()[box] });
+		}
+		bvh.Refit(bounds);
+		checkQueries(bvh, bounds, random);
+	}
+
+	void TestEmpty()
+	{
+		CullingBounds bounds;
+		BoundingVolumeHierarchy bvh;
+		CHECK(bvh.Build(bounds));
+		CHECK(bvh.IsEmpty());
+
+		std::vector<uint32_t> found;
+		bvh.QuerySphere(glm::vec3(0.0f), 10.0f, found);
+		CHECK(found.empty());
+		BvhRayHit hit;
+		CHECK(!bvh.Raycast(BvhRay{}, hit));
+
+		// one box, the ray starts inside of it
+		bounds.Add(glm::vec3(0.0f), glm::vec3(1.0f));
+		CHECK(bvh.Build(bounds));
+		CHECK(bvh.Raycast(BvhRay{}, hit));
+		CHECK(hit.primitive == 0 && hit.distance == 0.0f);
+	}
+}
+//=============================================================================
+int main()
+{
+	TestQueries();
+	TestEmpty();
+	return TestResult("BoundingVolumeHierarchyTest");
+}
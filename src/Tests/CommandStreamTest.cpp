@@ -0,0 +1,169 @@
+﻿#include "Test.h"
+#include "Engine/CommandStream.h"
+//=============================================================================
+namespace
+{
+	namespace Command = CommandStreamCommand;
+
+	// The stream stores pointers and never dereferences them, the test passes addresses of plain storage
+	alignas(16) std::byte objectStorage[8][64];
+
+	template<typename T>
+	T& fakeObject(size_t index)
+	{
+		return *reinterpret_cast<T*>(objectStorage[index]);
+	}
+
+	// Every command arrives in order with its arguments, the helpers are resolved while recording
+	void TestRecordAndVisit()
+	{
+		Resource& texture = fakeObject<Resource>(0);
+		Resource& uploadBuffer = fakeObject<Resource>(1);
+		const BufferResource& arguments = fakeObject<BufferResource>(2);
+		const BufferResource& count = fakeObject<BufferResource>(3);
+		const PipelineInfo& pipeline = fakeObject<PipelineInfo>(4);
+		const PipelineResourceSpace& resources = fakeObject<PipelineResourceSpace>(5);
+		void* commandSignature = objectStorage[6];
+		const void* subResourceLayouts = objectStorage[7];
+
+		CommandStream stream;
+		CHECK(stream.Create(4096));
+		CHECK(stream.IsEmpty());
+
+		CommandStreamRecorder recorder(stream);
+		recorder.SetPipeline(pipeline);
+		recorder.SetPipelineResources(2, resources);
+		recorder.DrawIndexed(36, 12, 5);
+		recorder.Dispatch2D(100, 33, 8, 8);
+		recorder.CopyTextureRegion(texture, uploadBuffer, 256, subResourceLayouts, 6);
+		recorder.ExecuteIndirect(commandSignature, 1000, arguments, &count);
+		recorder.ExecuteIndirect(commandSignature, 24, arguments);
+		CHECK(stream.GetNumCommands() == 7);
+		CHECK(!stream.HasOverflowed());
+		CHECK(stream.GetSize() % COMMAND_STREAM_ALIGNMENT == 0);
+
+		std::vector<CommandStreamOp> ops;
+		stream.Visit([&]<typename T>(const T& command)
+		{
+			ops.push_back(T::op);
+			if constexpr (std::is_same_v<T, Command::SetPipeline>)
+			{
+				CHECK(command.pipeline == &pipeline);
+			}
+			else if constexpr (std::is_same_v<T, Command::SetPipelineResources>)
+			{
+				CHECK(command.resources == &resources && command.spaceId == 2);
+			}
+			else if constexpr (std::is_same_v<T, Command::DrawIndexedInstanced>)
+			{
+				CHECK(command.indexCountPerInstance == 36 && command.instanceCount == 1 && command.startIndexLocation == 12 && command.baseVertexLocation == 5 && command.startInstanceLocation == 0);
+			}
+			else if constexpr (std::is_same_v<T, Command::Dispatch>)
+			{
+				CHECK(command.groupCountX == 13 && command.groupCountY == 5 && command.groupCountZ == 1);
+			}
+			else if constexpr (std::is_same_v<T, Command::CopyTextureRegion>)
+			{
+				CHECK(command.destination == &texture && command.source == &uploadBuffer);
+				CHECK(command.sourceOffset == 256 && command.subResourceLayouts == subResourceLayouts && command.numSubResources == 6);
+			}
+			else if constexpr (std::is_same_v<T, Command::ExecuteIndirect>)
+			{
+				CHECK(command.commandSignature == commandSignature && command.argumentBuffer == &arguments);
+				const bool counted = command.countBuffer != nullptr;
+				CHECK(counted ? command.countBuffer == &count && command.maxCommandCount == 1000 : command.maxCommandCount == 24);
+			}
+		});
+		const std::vector<CommandStreamOp> expectedOps = { CommandStreamOp::setPipeline, CommandStreamOp::setPipelineResources, CommandStreamOp::drawIndexedInstanced,
+			CommandStreamOp::dispatch, CommandStreamOp::copyTextureRegion, CommandStreamOp::executeIndirect, CommandStreamOp::executeIndirect };
+		CHECK(ops == expectedOps);
+
+		// a replay does not consume the stream
+		stream.Visit([&](const auto&) { ops.push_back(CommandStreamOp::flushBarriers); });
+		CHECK(ops.size() == 2 * expectedOps.size());
+
+		stream.Reset();
+		CHECK(stream.IsEmpty() && stream.GetNumCommands() == 0);
+		stream.Destroy();
+	}
+
+	// The null replay counts what a backend would submit, nested streams once per execution
+	void TestNullReplay()
+	{
+		Resource& destination = fakeObject<Resource>(0);
+		Resource& source = fakeObject<Resource>(1);
+		const BufferResource& arguments = fakeObject<BufferResource>(2);
+
+		CommandStream staticStream;
+		CHECK(staticStream.Create(1024));
+		{
+			CommandStreamRecorder recorder(staticStream);
+			recorder.SetPipeline(fakeObject<PipelineInfo>(4));
+			recorder.DrawInstanced(3, 10);
+			recorder.ExecuteIndirect(objectStorage[6], 64, arguments);
+		}
+
+		CommandStream stream;
+		CHECK(stream.Create(1024));
+		CommandStreamRecorder recorder(stream);
+		recorder.AddBarrier(destination, 0x400);
+		recorder.AddBarrier(source, 0x800);
+		recorder.FlushBarriers();
+		recorder.CopyResource(destination, source);
+		recorder.CopyBufferRegion(destination, 16, source, 0, 64);
+		recorder.CopyTextureRegion(destination, source, 0, objectStorage[7], 1);
+		recorder.DrawFullScreenTriangle();
+		recorder.Dispatch3D(64, 64, 64, 4, 4, 4);
+		recorder.ExecuteStream(staticStream);
+		recorder.ExecuteStream(staticStream);
+
+		const CommandStreamStats stats = ReplayCommandStreamNull(stream);
+		CHECK(stats.numCommands == 10 + 2 * 3);
+		CHECK(stats.numBarriers == 2);
+		CHECK(stats.numCopies == 3);
+		CHECK(stats.numDraws == 1 + 2);
+		CHECK(stats.numVertices == 3 + 2 * 30);
+		CHECK(stats.numDispatches == 1);
+		CHECK(stats.numThreadGroups == 16 * 16 * 16);
+		CHECK(stats.numPipelineChanges == 2);
+		CHECK(stats.numIndirectExecutes == 2);
+		CHECK(stats.maxIndirectCommands == 2 * 64);
+
+		staticStream.Destroy();
+		stream.Destroy();
+	}
+
+	// A command that does not fit is dropped together with everything after it
+	void TestOverflow()
+	{
+		CommandStream stream;
+		CHECK(stream.Create(64));
+		CommandStreamRecorder recorder(stream);
+		uint32_t numRecorded = 0;
+		while (!stream.HasOverflowed())
+		{
+			recorder.DrawInstanced(3, 1);
+			numRecorded++;
+		}
+		CHECK(stream.GetNumCommands() == numRecorded - 1);
+		CHECK(stream.GetSize() <= stream.GetCapacity());
+
+		recorder.FlushBarriers(); // would fit, but the stream is cut off
+		CHECK(stream.GetNumCommands() == numRecorded - 1);
+		CHECK(ReplayCommandStreamNull(stream).numDraws == numRecorded - 1);
+
+		stream.Reset();
+		CHECK(!stream.HasOverflowed());
+		recorder.FlushBarriers();
+		CHECK(stream.GetNumCommands() == 1);
+		stream.Destroy();
+	}
+}
+//=============================================================================
+int main()
+{
+	TestRecordAndVisit();
+	TestNullReplay();
+	TestOverflow();
+	return TestResult("CommandStreamTest");
+}
@@ -0,0 +1,239 @@
+﻿#include "Test.h"
+#include "Engine/DXILContainer.h"
+#include <filesystem>
+//=============================================================================
+namespace
+{
+	// Values of PSVResourceType from DxilPipelineStateValidation.h
+	constexpr uint32_t PSV_SAMPLER = 1;
+	constexpr uint32_t PSV_CBV = 2;
+	constexpr uint32_t PSV_SRV_TYPED = 3;
+	constexpr uint32_t PSV_SRV_STRUCTURED = 5;
+	constexpr uint32_t PSV_UAV_RAW = 7;
+	constexpr uint32_t PSV_UAV_STRUCTURED_WITH_COUNTER = 9;
+
+	struct PSVBinding final
+	{
+		uint32_t resType;
+		uint32_t space;
+		uint32_t lowerBound;
+		uint32_t upperBound;
+	};
+
+	void append(std::vector<uint8_t>& bytes, uint32_t value)
+	{
+		const uint8_t* data = reinterpret_cast<const uint8_t*>(&value);
+		bytes.insert(bytes.end(), data, data + sizeof(value));
+	}
+
+	void write(std::vector<uint8_t>& bytes, size_t offset, uint32_t value)
+	{
+		memcpy(bytes.data() + offset, &value, sizeof(value));
+	}
+
+	// PSV0 as DXC writes it: runtime info, the resource count and the bind infos. bindInfoSize 24 is the layout of PSV validator
+	// version 1.8, the resource kind and flags follow the four values the parser reads.
+	std::vector<uint8_t> makePSV0(const std::vector<PSVBinding>& bindings, uint32_t bindInfoSize = 16)
+	{
+		std::vector<uint8_t> psv;
+		append(psv, 52); // sizeof(PSVRuntimeInfo3)
+		psv.resize(psv.size() + 52, 0xCD);
+		append(psv, static_cast<uint32_t>(bindings.size()));
+		if (bindings.empty()) return psv;
+
+		append(psv, bindInfoSize);
+		for (const PSVBinding& binding : bindings)
+		{
+			append(psv, binding.resType);
+			append(psv, binding.space);
+			append(psv, binding.lowerBound);
+			append(psv, binding.upperBound);
+			for (uint32_t extra = 16; extra < bindInfoSize; extra += 4) append(psv, 0);
+		}
+		// the signature elements and the rest of PSV0 follow, the parser does not read them
+		append(psv, 0);
+		return psv;
+	}
+
+	std::vector<uint8_t> makeContainer(const std::vector<std::pair<uint32_t, std::vector<uint8_t>>>& parts)
+	{
+		std::vector<uint8_t> container;
+		append(container, DXIL_FOURCC_CONTAINER);
+		for (uint8_t digestByte = 0; digestByte < 16; digestByte++) container.push_back(digestByte + 1);
+		append(container, 1); // major 1, minor 0
+		append(container, 0); // container size, written below
+		append(container, static_cast<uint32_t>(parts.size()));
+
+		const size_t partTable = container.size();
+		container.resize(container.size() + parts.size() * sizeof(uint32_t));
+		for (size_t partIndex = 0; partIndex < parts.size(); partIndex++)
+		{
+			write(container, partTable + partIndex * sizeof(uint32_t), static_cast<uint32_t>(container.size()));
+			append(container, parts[partIndex].first);
+			append(container, static_cast<uint32_t>(parts[partIndex].second.size()));
+			container.insert(container.end(), parts[partIndex].second.begin(), parts[partIndex].second.end());
+		}
+		write(container, 24, static_cast<uint32_t>(container.size()));
+		return container;
+	}
+
+	const std::vector<PSVBinding> BINDINGS =
+	{
+		{ PSV_CBV, 0, 0, 0 },
+		{ PSV_SRV_TYPED, 1, 0, 3 },
+		{ PSV_SRV_STRUCTURED, 0, 5, 5 },
+		{ PSV_UAV_RAW, 0, 2, 2 },
+		{ PSV_UAV_STRUCTURED_WITH_COUNTER, 2, 0, DXIL_UNBOUNDED_RANGE },
+		{ PSV_SAMPLER, 0, 0, 0 },
+	};
+
+	const std::vector<ShaderResourceBindingDesc> EXPECTED =
+	{
+		{ ShaderBindingType::cbv, 0, 0, 0 },
+		{ ShaderBindingType::srv, 1, 0, 3 },
+		{ ShaderBindingType::srv, 0, 5, 5 },
+		{ ShaderBindingType::uav, 0, 2, 2 },
+		{ ShaderBindingType::uav, 2, 0, DXIL_UNBOUNDED_RANGE },
+		{ ShaderBindingType::sampler, 0, 0, 0 },
+	};
+
+	const std::vector<uint8_t> DXIL_PART = { 'D', 'X', 'I', 'L', 0, 1, 2, 3 };
+
+	void TestParseParts()
+	{
+		const std::vector<uint8_t> container = makeContainer({ { DXIL_FOURCC_DXIL, DXIL_PART }, { DXIL_FOURCC_PSV0, makePSV0(BINDINGS) } });
+		std::array<uint8_t, 16> digest{};
+		std::vector<DXILContainerPart> parts;
+		CHECK(ParseDXILContainerParts(container.data(), container.size(), digest, parts));
+		CHECK(parts.size() == 2);
+		CHECK(digest[0] == 1 && digest[15] == 16);
+		if (parts.size() == 2)
+		{
+			CHECK(parts[0].fourCC == DXIL_FOURCC_DXIL);
+			CHECK(parts[0].size == DXIL_PART.size());
+			CHECK(memcmp(parts[0].data, DXIL_PART.data(), DXIL_PART.size()) == 0);
+			CHECK(parts[1].fourCC == DXIL_FOURCC_PSV0);
+		}
+	}
+
+	void TestParseReflection(uint32_t bindInfoSize)
+	{
+		const std::vector<uint8_t> container = makeContainer({ { DXIL_FOURCC_DXIL, DXIL_PART }, { DXIL_FOURCC_PSV0, makePSV0(BINDINGS, bindInfoSize) } });
+		ShaderReflectionData reflection;
+		CHECK(ParseDXILReflection(container.data(), container.size(), reflection));
+		CHECK(reflection.bindings == EXPECTED);
+		CHECK(reflection.digest[0] == 1 && reflection.digest[15] == 16);
+	}
+
+	// A shader without resources has a PSV0 part with a resource count of 0 and no bind info size
+	void TestNoResources()
+	{
+		const std::vector<uint8_t> container = makeContainer({ { DXIL_FOURCC_PSV0, makePSV0({}) } });
+		ShaderReflectionData reflection;
+		reflection.bindings.push_back({});
+		CHECK(ParseDXILReflection(container.data(), container.size(), reflection));
+		CHECK(reflection.bindings.empty());
+	}
+
+	// Unknown resource types are skipped, the other bindings are still read
+	void TestUnknownResourceType()
+	{
+		const std::vector<uint8_t> container = makeContainer({ { DXIL_FOURCC_PSV0, makePSV0({ { 42, 0, 0, 0 }, { PSV_CBV, 3, 0, 0 } }) } });
+		ShaderReflectionData reflection;
+		CHECK(ParseDXILReflection(container.data(), container.size(), reflection));
+		const ShaderResourceBindingDesc expected{ ShaderBindingType::cbv, 3, 0, 0 };
+		CHECK(reflection.bindings.size() == 1 && reflection.bindings[0] == expected);
+	}
+
+	void TestMalformed()
+	{
+		ShaderReflectionData reflection;
+		std::array<uint8_t, 16> digest{};
+		std::vector<DXILContainerPart> parts;
+		const std::vector<uint8_t> container = makeContainer({ { DXIL_FOURCC_DXIL, DXIL_PART }, { DXIL_FOURCC_PSV0, makePSV0(BINDINGS) } });
+
+		CHECK(!ParseDXILContainerParts(nullptr, 0, digest, parts));
+		CHECK(!ParseDXILReflection(nullptr, 0, reflection));
+
+		// every truncation of the blob is rejected, the container size says how much of it there has to be
+		uint32_t numAccepted = 0;
+		for (size_t size = 0; size < container.size(); size++) numAccepted += ParseDXILReflection(container.data(), size, reflection) ? 1 : 0;
+		CHECK(numAccepted == 0);
+
+		std::vector<uint8_t> corrupt = container;
+		corrupt[0] = 'X';
+		CHECK(!ParseDXILContainerParts(corrupt.data(), corrupt.size(), digest, parts));
+
+		corrupt = container;
+		write(corrupt, 28, 1000000); // part count
+		CHECK(!ParseDXILContainerParts(corrupt.data(), corrupt.size(), digest, parts));
+
+		corrupt = container;
+		write(corrupt, 32, static_cast<uint32_t>(corrupt.size()) - 4); // part offset, the part header runs past the end
+		CHECK(!ParseDXILContainerParts(corrupt.data(), corrupt.size(), digest, parts));
+
+		corrupt = container;
+		uint32_t firstPart = 0;
+		memcpy(&firstPart, corrupt.data() + 32, sizeof(firstPart));
+		write(corrupt, firstPart + 4, 0xFFFFFFF0); // part size
+		CHECK(!ParseDXILContainerParts(corrupt.data(), corrupt.size(), digest, parts));
+
+		// no PSV0 part
+		const std::vector<uint8_t> noPSV = makeContainer({ { DXIL_FOURCC_DXIL, DXIL_PART } });
+		CHECK(ParseDXILContainerParts(noPSV.data(), noPSV.size(), digest, parts));
+		CHECK(!ParseDXILReflection(noPSV.data(), noPSV.size(), reflection));
+
+		// PSV0 contents
+		const std::vector<uint8_t> smallBindInfo = makeContainer({ { DXIL_FOURCC_PSV0, makePSV0(BINDINGS, 12) } });
+		CHECK(!ParseDXILReflection(smallBindInfo.data(), smallBindInfo.size(), reflection));
+		const std::vector<uint8_t> inverted = makeContainer({ { DXIL_FOURCC_PSV0, makePSV0({ { PSV_SRV_TYPED, 0, 4, 3 } }) } });
+		CHECK(!ParseDXILReflection(inverted.data(), inverted.size(), reflection));
+		std::vector<uint8_t> psv = makePSV0(BINDINGS);
+		write(psv, 0, 0x7FFFFFFF); // runtime info size
+		const std::vector<uint8_t> runtimeInfo = makeContainer({ { DXIL_FOURCC_PSV0, psv } });
+		CHECK(!ParseDXILReflection(runtimeInfo.data(), runtimeInfo.size(), reflection));
+		psv = makePSV0(BINDINGS);
+		write(psv, 56, 1000); // resource count
+		const std::vector<uint8_t> resourceCount = makeContainer({ { DXIL_FOURCC_PSV0, psv } });
+		CHECK(!ParseDXILReflection(resourceCount.data(), resourceCount.size(), reflection));
+	}
+
+	void TestReflectionCache()
+	{
+		const std::filesystem::path path = std::filesystem::temp_directory_path() / "DXILContainerTest.layout";
+		ShaderReflectionData reflection;
+		for (uint8_t digestByte = 0; digestByte < 16; digestByte++) reflection.digest[digestByte] = digestByte * 7;
+		reflection.bindings = EXPECTED;
+		const uint64_t sourceHash = 0x0123456789abcdefull;
+		CHECK(SaveShaderReflection(path.wstring(), sourceHash, reflection));
+
+		ShaderReflectionData loaded;
+		CHECK(LoadShaderReflection(path.wstring(), sourceHash, loaded));
+		CHECK(loaded.digest == reflection.digest);
+		CHECK(loaded.bindings == reflection.bindings);
+
+		// a cache of another source, define set or target of the shader is rejected and leaves the output untouched
+		ShaderReflectionData rejected;
+		CHECK(!LoadShaderReflection(path.wstring(), sourceHash + 1, rejected));
+		CHECK(rejected.bindings.empty());
+
+		// truncated
+		std::filesystem::resize_file(path, std::filesystem::file_size(path) - 4);
+		CHECK(!LoadShaderReflection(path.wstring(), sourceHash, rejected));
+
+		std::filesystem::remove(path);
+		CHECK(!LoadShaderReflection(path.wstring(), sourceHash, rejected));
+	}
+}
+//=============================================================================
+int main()
+{
+	TestParseParts();
+	TestParseReflection(16);
+	TestParseReflection(24);
+	TestNoResources();
+	TestUnknownResourceType();
+	TestMalformed();
+	TestReflectionCache();
+	return TestResult("DXILContainerTest");
+}
@@ -0,0 +1,187 @@
+﻿#include "Test.h"
+#include "Engine/CommandStream.h"
+#include "Engine/DrawList.h"
+#include "Engine/JobSystem.h"
+#include <random>
+//=============================================================================
+namespace
+{
+	// Submit() only compares and forwards the pointers, the test passes addresses of plain storage
+	alignas(16) std::byte objectStorage[8][64];
+
+	template<typename T>
+	const T& fakeObject(size_t index)
+	{
+		return *reinterpret_cast<const T*>(objectStorage[index]);
+	}
+
+	// The pass orders first, opaque draws then group by state and go front to back, transparent ones go back to front
+	void TestKeys()
+	{
+		CHECK(MakeOpaqueDrawKey(0, 4095, 1000, 1000.0f) < MakeOpaqueDrawKey(1, 0, 0, 0.0f));
+		CHECK(MakeOpaqueDrawKey(2, 3, 1000, 1000.0f) < MakeOpaqueDrawKey(2, 4, 0, 0.0f));
+		CHECK(MakeOpaqueDrawKey(2, 3, 7, 1000.0f) < MakeOpaqueDrawKey(2, 3, 8, 0.0f));
+		CHECK(MakeOpaqueDrawKey(2, 3, 7, 1.0f) < MakeOpaqueDrawKey(2, 3, 7, 2.0f));
+		CHECK(MakeOpaqueDrawKey(2, 3, 7, 0.001f) < MakeOpaqueDrawKey(2, 3, 7, 500.0f));
+		// negative depths and NaN go to the front
+		CHECK(MakeOpaqueDrawKey(2, 3, 7, -5.0f) == MakeOpaqueDrawKey(2, 3, 7, 0.0f));
+		CHECK(MakeOpaqueDrawKey(2, 3, 7, std::numeric_limits<float>::quiet_NaN()) == MakeOpaqueDrawKey(2, 3, 7, 0.0f));
+
+		CHECK(MakeTransparentDrawKey(5, 0, 0, 2.0f) < MakeTransparentDrawKey(5, 0, 0, 1.0f));
+		CHECK(MakeTransparentDrawKey(5, 4095, 1000, 2.0f) < MakeTransparentDrawKey(5, 0, 0, 1.0f));
+		CHECK(MakeTransparentDrawKey(5, 1, 9, 2.0f) < MakeTransparentDrawKey(5, 2, 0, 2.0f));
+		CHECK(MakeTransparentDrawKey(4, 0, 0, 0.0f) < MakeTransparentDrawKey(5, 0, 0, 1000.0f));
+
+		CHECK(GetDrawKeyPass(MakeOpaqueDrawKey(63, 1, 2, 3.0f)) == 63);
+		CHECK(GetDrawKeyPass(MakeTransparentDrawKey(17, 1, 2, 3.0f)) == 17);
+	}
+
+	// The radix sort orders like a stable sort, on the calling thread and on a job system
+	void TestSort()
+	{
+		constexpr uint32_t NUM_DRAWS = 100000;
+		std::mt19937 random(7);
+		std::uniform_int_distribution<uint32_t> pass(0, 3);
+		std::uniform_int_distribution<uint32_t> pipeline(0, 20);
+		std::uniform_int_distribution<uint32_t> material(0, 500);
+		std::uniform_real_distribution<float> depth(0.0f, 100.0f);
+
+		std::vector<uint64_t> keys(NUM_DRAWS);
+		for (uint32_t draw = 0; draw < NUM_DRAWS; draw++)
+		{
+			// every eighth key repeats an earlier one, equal keys have to keep the order of Add()
+			keys[draw] = (draw % 8 == 7) ? keys[draw / 2] : MakeOpaqueDrawKey(pass(random), pipeline(random), material(random), depth(random));
+		}
+		std::vector<uint32_t> expectedOrder(NUM_DRAWS);
+		std::iota(expectedOrder.begin(), expectedOrder.end(), 0u);
+		std::stable_sort(expectedOrder.begin(), expectedOrder.end(), [&](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+
+		const auto checkSorted = [&](const DrawList& drawList)
+		{
+			CHECK(drawList.GetCount() == NUM_DRAWS);
+			CHECK(std::equal(drawList.GetOrder().begin(), drawList.GetOrder().end(), expectedOrder.begin(), expectedOrder.end()));
+			CHECK(std::is_sorted(drawList.GetOrderedKeys().begin(), drawList.GetOrderedKeys().end()));
+			bool keysMatch = true;
+			for (uint32_t position = 0; position < NUM_DRAWS; position++)
+				keysMatch = keysMatch && drawList.GetOrderedKeys()[position] == keys[drawList.GetOrder()[position]];
+			CHECK(keysMatch);
+		};
+
+		DrawList drawList;
+		drawList.Reserve(NUM_DRAWS);
+		for (uint32_t draw = 0; draw < NUM_DRAWS; draw++)
+		{
+			DrawItem item;
+			item.indexCount = draw;
+			drawList.Add(keys[draw], item);
+		}
+		drawList.Sort();
+		checkSorted(drawList);
+		CHECK(drawList.GetItem(expectedOrder[0]).indexCount == expectedOrder[0]);
+
+		JobSystem jobSystem;
+		JobSystemCreateInfo createInfo;
+		createInfo.numWorkerThreads = 3;
+		CHECK(jobSystem.Create(createInfo));
+		drawList.Clear();
+		for (uint32_t draw = 0; draw < NUM_DRAWS; draw++) drawList.Add(keys[draw], DrawItem{});
+		drawList.Sort(&jobSystem);
+		checkSorted(drawList);
+		jobSystem.Destroy();
+
+		// keys that only differ in the lowest bits
+		drawList.Clear();
+		for (uint32_t draw = 0; draw < 1000; draw++) drawList.Add((999 - draw) % 10, DrawItem{});
+		drawList.Sort();
+		CHECK(std::is_sorted(drawList.GetOrderedKeys().begin(), drawList.GetOrderedKeys().end()));
+		CHECK(drawList.GetOrder()[0] == 9 && drawList.GetOrder()[1] == 19);
+	}
+
+	// Recorded through CommandStreamRecorder: state is set only when it changes, the null replay counts the same
+	void TestSubmit()
+	{
+		const PipelineInfo& pipelineA = fakeObject<PipelineInfo>(0);
+		const PipelineInfo& pipelineB = fakeObject<PipelineInfo>(1);
+		const PipelineResourceSpace& sharedResources = fakeObject<PipelineResourceSpace>(2);
+		const PipelineResourceSpace& materialA = fakeObject<PipelineResourceSpace>(3);
+		const PipelineResourceSpace& materialB = fakeObject<PipelineResourceSpace>(4);
+		const BufferResource& indexBuffer = fakeObject<BufferResource>(5);
+
+		const auto makeItem = [&](const PipelineInfo& pipeline, const PipelineResourceSpace& material, uint32_t indexCount)
+		{
+			DrawItem item;
+			item.pipeline = &pipeline;
+			item.resources = &material;
+			item.resourceSpace = 1;
+			item.indexBuffer = &indexBuffer;
+			item.indexCount = indexCount;
+			item.instanceCount = 2;
+			return item;
+		};
+
+		// added out of order, sorting groups the pipelines and materials of each pass
+		DrawList drawList;
+		drawList.SetSharedResources(0, &sharedResources);
+		drawList.Add(MakeOpaqueDrawKey(1, 1, 0, 3.0f), makeItem(pipelineB, materialA, 6));
+		drawList.Add(MakeOpaqueDrawKey(0, 0, 1, 2.0f), makeItem(pipelineA, materialB, 9));
+		drawList.Add(MakeOpaqueDrawKey(0, 0, 0, 5.0f), makeItem(pipelineA, materialA, 3));
+		drawList.Add(MakeOpaqueDrawKey(1, 1, 0, 1.0f), makeItem(pipelineB, materialA, 12));
+		drawList.Add(MakeOpaqueDrawKey(0, 0, 0, 1.0f), makeItem(pipelineA, materialA, 30));
+		drawList.Sort();
+		const std::vector<uint32_t> expectedOrder = { 4, 2, 1, 3, 0 };
+		CHECK(std::equal(drawList.GetOrder().begin(), drawList.GetOrder().end(), expectedOrder.begin(), expectedOrder.end()));
+
+		CommandStream stream;
+		CHECK(stream.Create(4096));
+		std::vector<uint32_t> indexCounts;
+		uint32_t numSharedBindings = 0;
+		{
+			CommandStreamRecorder recorder(stream);
+			const DrawListStats stats = drawList.Submit(recorder);
+			CHECK(stats.numDraws == 5);
+			CHECK(stats.numPipelineChanges == 2);
+			// shared once per pipeline, materials A, B, then A again after the pipeline change
+			CHECK(stats.numResourceChanges == 2 + 3);
+			CHECK(stats.numIndexBufferChanges == 1);
+
+			const CommandStreamStats replay = ReplayCommandStreamNull(stream);
+			CHECK(replay.numDraws == stats.numDraws);
+			CHECK(replay.numPipelineChanges == stats.numPipelineChanges);
+			CHECK(replay.numResourceBindings == stats.numResourceChanges);
+			CHECK(replay.numVertices == 2 * (30 + 3 + 9 + 12 + 6));
+		}
+		stream.Visit([&]<typename T>(const T& command)
+		{
+			if constexpr (std::is_same_v<T, CommandStreamCommand::DrawIndexedInstanced>) indexCounts.push_back(command.indexCountPerInstance);
+			else if constexpr (std::is_same_v<T, CommandStreamCommand::SetPipelineResources>) numSharedBindings += command.resources == &sharedResources ? 1 : 0;
+		});
+		const std::vector<uint32_t> expectedIndexCounts = { 30, 3, 9, 12, 6 };
+		CHECK(indexCounts == expectedIndexCounts);
+		CHECK(numSharedBindings == 2);
+
+		// one pass of the sorted list
+		stream.Reset();
+		indexCounts.clear();
+		{
+			CommandStreamRecorder recorder(stream);
+			const DrawListStats stats = drawList.Submit(recorder, 1);
+			CHECK(stats.numDraws == 2 && stats.numPipelineChanges == 1 && stats.numResourceChanges == 2 && stats.numIndexBufferChanges == 1);
+			CHECK(drawList.Submit(recorder, 2).numDraws == 0);
+		}
+		stream.Visit([&]<typename T>(const T& command)
+		{
+			if constexpr (std::is_same_v<T, CommandStreamCommand::DrawIndexedInstanced>) indexCounts.push_back(command.indexCountPerInstance);
+		});
+		const std::vector<uint32_t> expectedPassIndexCounts = { 12, 6 };
+		CHECK(indexCounts == expectedPassIndexCounts);
+		stream.Destroy();
+	}
+}
+//=============================================================================
+int main()
+{
+	TestKeys();
+	TestSort();
+	TestSubmit();
+	return TestResult("DrawListTest");
+}
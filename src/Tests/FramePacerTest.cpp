@@ -0,0 +1,143 @@
+﻿#include "Test.h"
+#include "Engine/FramePacer.h"
+//=============================================================================
+namespace
+{
+	constexpr uint64_t MS = 1000000;
+	constexpr uint64_t SPIN_STEP = 1000; // ns
+
+	// Time only moves when the pacer sleeps or spins, or when the test runs a frame. A sleep wakes up oversleep late.
+	class FakeClock final : public FramePacerClock
+	{
+	public:
+		uint64_t Now() override { return time; }
+		void Sleep(uint64_t nanoseconds) override { time += nanoseconds + oversleep; numSleeps++; }
+		void Spin() override { time += SPIN_STEP; numSpins++; }
+
+		uint64_t time{ 1000 * MS };
+		uint64_t oversleep{ 0 };
+		uint32_t numSleeps{ 0 };
+		uint32_t numSpins{ 0 };
+	};
+
+	// The frames start one period apart, never before the deadline and at most one spin step after it. A timer that oversleeps
+	// makes the first wait late, the margin covers it from then on.
+	void TestFramesArePaced(uint64_t oversleep)
+	{
+		FakeClock clock;
+		clock.oversleep = oversleep;
+		FramePacer pacer;
+		CHECK(pacer.Create({ .targetFPS = 100.0 }, &clock));
+		const uint64_t period = 10 * MS;
+
+		CHECK(pacer.WaitForNextFrame() == 0); // the first frame starts the cadence
+		const uint64_t firstFrame = clock.time;
+		for (uint64_t frame = 1; frame <= 100; frame++)
+		{
+			clock.time += 3 * MS; // the work of the frame
+			const uint64_t frameEnd = clock.time;
+			const uint64_t waited = pacer.WaitForNextFrame();
+			const uint64_t deadline = firstFrame + frame * period;
+			CHECK(waited == clock.time - frameEnd);
+			CHECK(clock.time >= deadline);
+			if (frame > 1 || oversleep == 0) CHECK(clock.time < deadline + SPIN_STEP);
+		}
+		CHECK(clock.numSleeps > 0);
+		CHECK(pacer.GetSleepMargin() >= MS + oversleep);
+	}
+
+	// The margin grows at once with the oversleep and decays back to the spin threshold once the timer is precise again
+	void TestSleepMarginAdapts()
+	{
+		FakeClock clock;
+		FramePacer pacer;
+		CHECK(pacer.Create({ .targetFPS = 50.0, .spinThresholdMs = 1.0 }, &clock));
+		CHECK(pacer.GetSleepMargin() == MS);
+
+		pacer.WaitForNextFrame();
+		clock.oversleep = 4 * MS;
+		pacer.WaitForNextFrame();
+		CHECK(pacer.GetSleepMargin() == 5 * MS);
+
+		clock.oversleep = 0;
+		uint64_t margin = pacer.GetSleepMargin();
+		for (uint32_t frame = 0; frame < 200; frame++)
+		{
+			pacer.WaitForNextFrame();
+			CHECK(pacer.GetSleepMargin() <= margin);
+			margin = pacer.GetSleepMargin();
+		}
+		CHECK(margin < MS + MS / 10);
+		CHECK(margin >= MS);
+	}
+
+	// A frame late by more than a period restarts the cadence instead of running a burst of frames without waiting
+	void TestLateFrameRestartsCadence()
+	{
+		FakeClock clock;
+		FramePacer pacer;
+		CHECK(pacer.Create({ .targetFPS = 100.0 }, &clock));
+
+		pacer.WaitForNextFrame();
+		clock.time += 35 * MS;
+		CHECK(pacer.WaitForNextFrame() == 0);
+		const uint64_t restart = clock.time;
+		pacer.WaitForNextFrame();
+		CHECK(clock.time >= restart + 10 * MS);
+		CHECK(clock.time < restart + 10 * MS + SPIN_STEP);
+
+		// late by less than a period: no wait, the cadence keeps its phase
+		clock.time += 15 * MS;
+		const uint64_t lateFrame = clock.time;
+		CHECK(pacer.WaitForNextFrame() == 0);
+		CHECK(clock.time == lateFrame);
+		pacer.WaitForNextFrame();
+		CHECK(clock.time >= restart + 30 * MS);
+		CHECK(clock.time < restart + 30 * MS + SPIN_STEP);
+	}
+
+	void TestUnlimited()
+	{
+		FakeClock clock;
+		FramePacer pacer;
+		CHECK(pacer.Create({}, &clock));
+		const uint64_t start = clock.time;
+		for (uint32_t frame = 0; frame < 10; frame++) CHECK(pacer.WaitForNextFrame() == 0);
+		CHECK(clock.time == start);
+		CHECK(clock.numSleeps == 0 && clock.numSpins == 0);
+
+		pacer.SetTargetFPS(100.0);
+		CHECK(pacer.WaitForNextFrame() == 0);
+		pacer.WaitForNextFrame();
+		CHECK(clock.time >= start + 10 * MS);
+		pacer.SetTargetFPS(0.0);
+		CHECK(pacer.WaitForNextFrame() == 0);
+	}
+
+	void TestFrameLatency()
+	{
+		FakeClock clock;
+		FramePacer pacer;
+		CHECK(pacer.Create({ .maxFrameLatency = 3 }, &clock));
+		CHECK(pacer.GetMaxFrameLatency() == 3);
+		CHECK(pacer.Create({ .maxFrameLatency = 0 }, &clock));
+		CHECK(pacer.GetMaxFrameLatency() == 1);
+		CHECK(pacer.Create({ .maxFrameLatency = 3, .lowLatency = true }, &clock));
+		CHECK(pacer.GetMaxFrameLatency() == 1);
+
+		const int numFatalErrors = testNumFatalErrors;
+		CHECK(!pacer.Create({ .targetFPS = -1.0 }, &clock));
+		CHECK(testNumFatalErrors == numFatalErrors + 1);
+	}
+}
+//=============================================================================
+int main()
+{
+	TestFramesArePaced(0);
+	TestFramesArePaced(2 * MS);
+	TestSleepMarginAdapts();
+	TestLateFrameRestartsCadence();
+	TestUnlimited();
+	TestFrameLatency();
+	return TestResult("FramePacerTest");
+}
@@ -0,0 +1,161 @@
+﻿#include "Test.h"
+#include "Engine/FrustumCulling.h"
+#include "Engine/JobSystem.h"
+#include "Engine/SubmeshTable.h"
+#include <random>
+//=============================================================================
+namespace
+{
+	const CullingPath SIMD_PATHS[] = { CullingPath::sse, CullingPath::avx2, CullingPath::automatic };
+
+	// the cube [-10, 10]^3
+	CullingFrustum makeCubeFrustum()
+	{
+		CullingFrustum frustum{};
+		frustum.planes[0] = { 1.0f, 0.0f, 0.0f, 10.0f };
+		frustum.planes[1] = { -1.0f, 0.0f, 0.0f, 10.0f };
+		frustum.planes[2] = { 0.0f, 1.0f, 0.0f, 10.0f };
+		frustum.planes[3] = { 0.0f, -1.0f, 0.0f, 10.0f };
+		frustum.planes[4] = { 0.0f, 0.0f, 1.0f, 10.0f };
+		frustum.planes[5] = { 0.0f, 0.0f, -1.0f, 10.0f };
+		return frustum;
+	}
+
+	std::vector<uint32_t> cull(const CullingFrustum& frustum, const CullingBounds& bounds, uint32_t begin, uint32_t end, CullingPath path)
+	{
+		std::vector<uint32_t> visible(end - begin);
+		visible.resize(CullBoxes(frustum, bounds, begin, end, visible.data(), path));
+		return visible;
+	}
+
+	void makeRandomBounds(CullingBounds& bounds, uint32_t numBoxes, uint32_t seed)
+	{
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+		std::uniform_real_distribution<float> extent(0.1f, 8.0f);
+		bounds.Clear();
+		bounds.Reserve(numBoxes);
+		for (uint32_t box = 0; box < numBoxes; box++)
+			bounds.Add({ position(random), position(random), position(random) }, { extent(random), extent(random), extent(random) });
+	}
+
+	// Inside, outside behind one plane, crossing a plane and crossing a corner outside of all planes, on every path
+	void TestKnownBoxes()
+	{
+		CullingBounds bounds;
+		bounds.Add({ 0.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f });    // 0 inside
+		bounds.Add({ 20.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f });   // 1 outside
+		bounds.Add({ 10.5f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f });   // 2 crossing the right plane
+		bounds.Add({ 0.0f, 0.0f, -11.0f }, { 1.0f, 1.0f, 0.5f });  // 3 behind the near plane
+		bounds.Add({ 11.5f, 11.5f, 0.0f }, { 2.0f, 2.0f, 1.0f });  // 4 outside, but crosses both planes of the corner: kept
+		bounds.Add({ 0.0f, -10.0f, 0.0f }, { 0.0f, 0.0f, 0.0f });  // 5 a point on a plane
+		const std::vector<uint32_t> expected = { 0, 2, 4, 5 };
+
+		const CullingFrustum frustum = makeCubeFrustum();
+		CHECK(cull(frustum, bounds, 0, bounds.GetCount(), CullingPath::scalar) == expected);
+		for (CullingPath path : SIMD_PATHS) CHECK(cull(frustum, bounds, 0, bounds.GetCount(), path) == expected);
+
+		// a range returns the indices of the boxes, not positions in the range
+		const std::vector<uint32_t> range = { 2, 4 };
+		CHECK(cull(frustum, bounds, 1, 5, CullingPath::scalar) == range);
+		for (CullingPath path : SIMD_PATHS) CHECK(cull(frustum, bounds, 1, 5, path) == range);
+	}
+
+	// The SIMD paths keep exactly the boxes of the scalar path, also for ranges that do not start or end on a multiple of 8
+	void TestSIMDMatchesScalar()
+	{
+		CullingBounds bounds;
+		makeRandomBounds(bounds, 10001, 42);
+
+		const glm::mat4 projection = glm::perspectiveRH_ZO(glm::radians(70.0f), 1.5f, 0.5f, 120.0f);
+		std::mt19937 random(3);
+		std::uniform_real_distribution<float> direction(-1.0f, 1.0f);
+		for (uint32_t view = 0; view < 16; view++)
+		{
+			const glm::vec3 eye(direction(random) * 20.0f, direction(random) * 20.0f, direction(random) * 20.0f);
+			const glm::vec3 forward(direction(random), direction(random) * 0.3f, direction(random));
+			const CullingFrustum frustum = CullingFrustum::FromViewProjection(projection * glm::lookAtRH(eye, eye + forward, glm::vec3(0.0f, 1.0f, 0.0f)));
+
+			for (const auto [begin, end] : { std::pair<uint32_t, uint32_t>{ 0, 10001 }, { 3, 9995 }, { 5, 12 }, { 7, 7 } })
+			{
+				const std::vector<uint32_t> scalar = cull(frustum, bounds, begin, end, CullingPath::scalar);
+				for (CullingPath path : SIMD_PATHS) CHECK(cull(frustum, bounds, begin, end, path) == scalar);
+			}
+		}
+	}
+
+	// Both depth conventions give a frustum that keeps what is in front of the camera between the clip planes
+	void TestFromViewProjection()
+	{
+		const glm::mat4 view = glm::lookAtRH(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		const std::pair<glm::mat4, bool> projections[] = { { glm::perspectiveRH_ZO(glm::radians(60.0f), 1.0f, 1.0f, 100.0f), true },
+			{ glm::perspectiveRH_NO(glm::radians(60.0f), 1.0f, 1.0f, 100.0f), false } };
+		for (const auto& [projection, zeroToOneDepth] : projections)
+		{
+			const CullingFrustum frustum = CullingFrustum::FromViewProjection(projection * view, zeroToOneDepth);
+			CullingBounds bounds;
+			bounds.Add({ 0.0f, 0.0f, -50.0f }, glm::vec3(0.1f));  // 0 in front
+			bounds.Add({ 0.0f, 0.0f, 50.0f }, glm::vec3(0.1f));   // 1 behind
+			bounds.Add({ 0.0f, 0.0f, -0.5f }, glm::vec3(0.1f));   // 2 before the near plane
+			bounds.Add({ 0.0f, 0.0f, -150.0f }, glm::vec3(0.1f)); // 3 past the far plane
+			bounds.Add({ 40.0f, 0.0f, -50.0f }, glm::vec3(0.1f)); // 4 outside of the 30 degrees to the right
+			bounds.Add({ 0.0f, 0.0f, -99.5f }, glm::vec3(1.0f));  // 5 crossing the far plane
+			const std::vector<uint32_t> expected = { 0, 5 };
+			CHECK(cull(frustum, bounds, 0, bounds.GetCount(), CullingPath::scalar) == expected);
+			for (const glm::vec4& plane : frustum.planes) CHECK_NEAR(glm::length(glm::vec3(plane)), 1.0, 1e-5);
+		}
+	}
+
+	// The culler compacts the blocks in box order, with and without the job system
+	void TestFrustumCuller()
+	{
+		CullingBounds bounds;
+		makeRandomBounds(bounds, 3 * CULLING_BLOCK_SIZE + 17, 9);
+		const CullingFrustum frustum = CullingFrustum::FromViewProjection(glm::perspectiveRH_ZO(glm::radians(90.0f), 1.0f, 0.1f, 80.0f));
+		const std::vector<uint32_t> expected = cull(frustum, bounds, 0, bounds.GetCount(), CullingPath::scalar);
+		CHECK(!expected.empty());
+
+		FrustumCuller culler;
+		const std::span<const uint32_t> serial = culler.Cull(frustum, bounds, nullptr);
+		CHECK(std::vector<uint32_t>(serial.begin(), serial.end()) == expected);
+
+		JobSystem jobSystem;
+		JobSystemCreateInfo createInfo;
+		createInfo.numWorkerThreads = 3;
+		CHECK(jobSystem.Create(createInfo));
+		for (CullingPath path : { CullingPath::scalar, CullingPath::automatic })
+		{
+			const std::span<const uint32_t> parallel = culler.Cull(frustum, bounds, &jobSystem, path);
+			CHECK(std::vector<uint32_t>(parallel.begin(), parallel.end()) == expected);
+		}
+		jobSystem.Destroy();
+
+		CullingBounds empty;
+		CHECK(culler.Cull(frustum, empty, nullptr).empty());
+	}
+
+	void TestAssignSubmeshes()
+	{
+		SubmeshTable submeshes;
+		submeshes.Add(36, 0, 0, { 1.0f, 2.0f, 3.0f }, { 0.5f, 0.5f, 0.5f });
+		submeshes.Add(36, 36, 0, { -4.0f, 5.0f, -6.0f }, { 1.0f, 2.0f, 3.0f });
+
+		CullingBounds bounds;
+		bounds.Add(glm::vec3(0.0f), glm::vec3(1.0f));
+		bounds.Assign(submeshes);
+		CHECK(bounds.GetCount() == 2);
+		CHECK(bounds.GetCenterX()[1] == -4.0f && bounds.GetCenterY()[1] == 5.0f && bounds.GetCenterZ()[1] == -6.0f);
+		CHECK(bounds.GetExtentX()[1] == 1.0f && bounds.GetExtentY()[1] == 2.0f && bounds.GetExtentZ()[1] == 3.0f);
+		CHECK(bounds.GetCenterX()[0] == 1.0f && bounds.GetExtentZ()[0] == 0.5f);
+	}
+}
+//=============================================================================
+int main()
+{
+	TestKnownBoxes();
+	TestSIMDMatchesScalar();
+	TestFromViewProjection();
+	TestFrustumCuller();
+	TestAssignSubmeshes();
+	return TestResult("FrustumCullingTest");
+}
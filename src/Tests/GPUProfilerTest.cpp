@@ -0,0 +1,208 @@
+﻿#include "Test.h"
+#include "Engine/GPUProfiler.h"
+#include "Engine/FrameStats.h"
+#include <thread>
+//=============================================================================
+namespace
+{
+	constexpr uint32_t MAX_QUERIES = 8;
+
+	// Timestamps in nanoseconds on a GPU clock that equals the CPU clock. A resolve completes once latency more frames ended,
+	// 0 completes it at once, in the EndFrame() that resolved it.
+	class MockTimestampDevice final : public GPUTimestampDevice
+	{
+	public:
+		MockTimestampDevice(uint32_t numSlots, uint32_t latency) : m_latency(latency)
+		{
+			for (uint32_t queue = 0; queue < GPU_PROFILER_MAX_QUEUES; queue++)
+			{
+				queries[queue].assign(numSlots * MAX_QUERIES, 0);
+				m_resolved[queue].assign(numSlots * MAX_QUERIES, 0);
+			}
+		}
+
+		void EndGPUFrame() { m_completedFence = m_lastFence > m_latency ? m_lastFence - m_latency : 0; }
+
+		uint64_t ResolveTimestamps(uint32_t queue, uint32_t, uint32_t firstQuery, uint32_t numQueries) override
+		{
+			std::copy_n(queries[queue].begin() + firstQuery, numQueries, m_resolved[queue].begin() + firstQuery);
+			std::fill_n(queries[queue].begin() + firstQuery, numQueries, 0);
+			m_lastFence++;
+			if (m_latency == 0) m_completedFence = m_lastFence;
+			return m_lastFence;
+		}
+		bool IsFenceComplete(uint32_t, uint64_t fenceValue) override { return fenceValue <= m_completedFence; }
+		void WaitForFence(uint32_t, uint64_t fenceValue) override { m_completedFence = std::max(m_completedFence, fenceValue); numWaits++; }
+		const uint64_t* ReadTimestamps(uint32_t queue, uint32_t firstQuery, uint32_t) override { return m_resolved[queue].data() + firstQuery; }
+		uint64_t GetTimestampFrequency(uint32_t) override { return 1000000000; }
+		bool CalibrateClock(uint32_t, uint64_t& gpuTimestamp, uint64_t& cpuTime) override
+		{
+			gpuTimestamp = 0;
+			cpuTime = 0;
+			return true;
+		}
+
+		std::vector<uint64_t> queries[GPU_PROFILER_MAX_QUEUES]; // written by the "GPU"
+		uint32_t              numWaits{ 0 };
+
+	private:
+		std::vector<uint64_t> m_resolved[GPU_PROFILER_MAX_QUEUES];
+		uint32_t              m_latency;
+		uint64_t              m_lastFence{ 0 };
+		uint64_t              m_completedFence{ 0 };
+	};
+
+	// One zone on the first queue per frame, frame i takes i + 1 milliseconds on the GPU
+	void RecordFrame(GPUProfiler& profiler, MockTimestampDevice& device, uint32_t frame)
+	{
+		const uint32_t beginQuery = profiler.BeginZone(0);
+		const uint32_t endQuery = profiler.EndZone(0, "Frame", beginQuery);
+		CHECK(beginQuery != UINT32_MAX && endQuery != UINT32_MAX);
+		if (beginQuery == UINT32_MAX || endQuery == UINT32_MAX) return;
+
+		const uint64_t begin = 1000000000ull + frame * 100000000ull;
+		device.queries[0][beginQuery] = begin;
+		device.queries[0][endQuery] = begin + (frame + 1) * 1000000ull;
+	}
+
+	// Every frame gets its GPU time in FrameStats, whether the resolve completes in the same EndFrame() or frames later
+	void TestGPUTimesReachFrameStats(uint32_t numFramesInFlight, uint32_t latency)
+	{
+		constexpr uint32_t NUM_FRAMES = 10;
+
+		FrameStatsCreateInfo frameStatsCreateInfo;
+		frameStatsCreateInfo.reportIntervalSeconds = 0.0;
+		FrameStats frameStats;
+		CHECK(frameStats.Create(frameStatsCreateInfo));
+
+		GPUProfilerCreateInfo createInfo;
+		createInfo.maxQueriesPerFrame = MAX_QUERIES;
+		createInfo.numFramesInFlight = numFramesInFlight;
+		MockTimestampDevice device(GPUProfiler::GetNumFrameSlots(numFramesInFlight), latency);
+		GPUProfiler profiler;
+		CHECK(profiler.Create(createInfo, &device));
+
+		frameStats.BeginFrame();
+		for (uint32_t frame = 0; frame < NUM_FRAMES; frame++)
+		{
+			RecordFrame(profiler, device, frame);
+			profiler.EndFrame();
+			device.EndGPUFrame();
+			frameStats.BeginFrame();
+		}
+		// the frames in flight complete before the next ones would be recorded
+		for (uint32_t frame = 0; frame <= latency; frame++)
+		{
+			profiler.EndFrame();
+			device.EndGPUFrame();
+		}
+
+		FrameStatsSummary summary;
+		frameStats.GetSummary(summary);
+		CHECK(summary.numFrames == NUM_FRAMES);
+		CHECK(summary.numGPUFrames == NUM_FRAMES);
+		CHECK_NEAR(summary.Get(FrameStatsMetric::gpu).avgMs, (NUM_FRAMES + 1) * 0.5, 1e-6);
+		CHECK_NEAR(summary.Get(FrameStatsMetric::gpu).maxMs, NUM_FRAMES, 1e-6);
+		CHECK(profiler.GetNumDroppedZones() == 0);
+
+		profiler.Destroy();
+		frameStats.Destroy();
+	}
+
+	// Pipelined, the GPU profiler runs on the render thread while the main thread closes frames. Every GPU time lands in its frame,
+	// whether it arrives before or after the main thread closed it.
+	void TestGPUTimesFromRenderThread()
+	{
+		constexpr uint64_t NUM_FRAMES = 2000;
+
+		FrameStatsCreateInfo frameStatsCreateInfo;
+		frameStatsCreateInfo.historySize = NUM_FRAMES + 16;
+		frameStatsCreateInfo.reportIntervalSeconds = 0.0;
+		FrameStats frameStats;
+		CHECK(frameStats.Create(frameStatsCreateInfo));
+		frameStats.BeginFrame();
+
+		std::thread renderThread([]
+		{
+			for (uint64_t frame = 0; frame < NUM_FRAMES; frame++)
+			{
+				while (FrameStatsGetFrameIndex() < frame) std::this_thread::yield();
+				FrameStatsRecordGPUTime(frame, (frame % 4 + 1) * 1000000ull);
+			}
+		});
+		while (frameStats.GetFrameIndex() < NUM_FRAMES)
+		{
+			frameStats.BeginFrame();
+			if (frameStats.GetFrameIndex() % 8 == 0) std::this_thread::yield();
+		}
+		renderThread.join();
+
+		FrameStatsSummary summary;
+		frameStats.GetSummary(summary);
+		CHECK(summary.numFrames == NUM_FRAMES);
+		CHECK(summary.numGPUFrames == NUM_FRAMES);
+		CHECK_NEAR(summary.Get(FrameStatsMetric::gpu).avgMs, 2.5, 1e-6);
+		frameStats.Destroy();
+	}
+
+	// Zones past maxQueriesPerFrame and zones whose queries the GPU never wrote are dropped and counted
+	void TestDroppedZones()
+	{
+		GPUProfilerCreateInfo createInfo;
+		createInfo.maxQueriesPerFrame = 4;
+		MockTimestampDevice device(GPUProfiler::GetNumFrameSlots(createInfo.numFramesInFlight), 0);
+		GPUProfiler profiler;
+		CHECK(profiler.Create(createInfo, &device));
+
+		const uint32_t first = profiler.BeginZone(0);
+		const uint32_t second = profiler.BeginZone(0);
+		const uint32_t firstEnd = profiler.EndZone(0, "Written", first);
+		const uint32_t secondEnd = profiler.EndZone(0, "Not written", second);
+		CHECK(profiler.BeginZone(0) == UINT32_MAX);
+		CHECK(profiler.GetNumDroppedZones() == 1);
+
+		device.queries[0][first] = 100;
+		device.queries[0][firstEnd] = 200;
+		CHECK(secondEnd != UINT32_MAX);
+		profiler.EndFrame();
+		CHECK(profiler.GetNumDroppedZones() == 2);
+
+		// the next frame starts with all queries free
+		CHECK(profiler.BeginZone(0) != UINT32_MAX);
+		profiler.Destroy();
+	}
+
+	// A slot the GPU did not resolve yet is waited for before the profiler records into it again
+	void TestSlotReuseWaits()
+	{
+		GPUProfilerCreateInfo createInfo;
+		createInfo.maxQueriesPerFrame = MAX_QUERIES;
+		createInfo.numFramesInFlight = 1;
+		const uint32_t numSlots = GPUProfiler::GetNumFrameSlots(createInfo.numFramesInFlight);
+		MockTimestampDevice device(numSlots, 100);
+		GPUProfiler profiler;
+		CHECK(profiler.Create(createInfo, &device));
+
+		for (uint32_t frame = 0; frame < numSlots + 1; frame++)
+		{
+			RecordFrame(profiler, device, frame);
+			profiler.EndFrame();
+		}
+		CHECK(device.numWaits == 2);
+		CHECK(profiler.GetNumDroppedZones() == 0);
+		profiler.Destroy();
+	}
+}
+//=============================================================================
+int main()
+{
+	TestGPUTimesReachFrameStats(2, 0);
+	TestGPUTimesReachFrameStats(1, 0);
+	TestGPUTimesReachFrameStats(2, 1);
+	TestGPUTimesReachFrameStats(2, 2);
+	TestGPUTimesFromRenderThread();
+	TestDroppedZones();
+	TestSlotReuseWaits();
+	return TestResult("GPUProfilerTest");
+}
+//=============================================================================
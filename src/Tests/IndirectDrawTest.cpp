@@ -0,0 +1,76 @@
+﻿#include "Test.h"
+#include "Engine/IndirectDraw.h"
+#include "Engine/FrustumCulling.h"
+#include <random>
+//=============================================================================
+namespace
+{
+	constexpr uint64_t OBJECT_CONSTANTS_ADDRESS = 0x10000;
+
+	// Boxes around the camera, some inside, some outside and some crossing planes of the frustum
+	std::vector<IndirectDrawObject> makeObjects(uint32_t numObjects)
+	{
+		std::mt19937 random(7);
+		std::uniform_real_distribution<float> position(-60.0f, 60.0f);
+		std::uniform_real_distribution<float> size(0.1f, 4.0f);
+
+		std::vector<IndirectDrawObject> objects(numObjects);
+		for (uint32_t objectIndex = 0; objectIndex < numObjects; objectIndex++)
+		{
+			IndirectDrawObject& object = objects[objectIndex];
+			object.boundsCenter = { position(random), position(random), position(random) };
+			object.boundsExtents = { size(random), size(random), size(random) };
+			object.indexCount = 3 * (objectIndex + 1);
+			object.startIndexLocation = 100 * objectIndex;
+			object.baseVertexLocation = -static_cast<int32_t>(objectIndex);
+		}
+		return objects;
+	}
+
+	// The CPU reference of IndirectCull.hlsl keeps exactly the boxes CullBoxes() keeps, in the same order
+	void TestMatchesCullBoxes(CullingPath path)
+	{
+		const glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 2.0f, -5.0f), glm::vec3(10.0f, 0.0f, 20.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		const glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 50.0f);
+		const CullingFrustum frustum = CullingFrustum::FromViewProjection(projection * view);
+
+		const std::vector<IndirectDrawObject> objects = makeObjects(5000);
+		CullingBounds bounds;
+		for (const IndirectDrawObject& object : objects)
+		{
+			bounds.Add(object.boundsCenter, object.boundsExtents);
+		}
+
+		std::vector<uint32_t> visible(objects.size());
+		const uint32_t numVisible = CullBoxes(frustum, bounds, 0, bounds.GetCount(), visible.data(), path);
+		std::vector<IndirectDrawCommand> commands(objects.size());
+		const uint32_t numCommands = CullIndirectDraws(frustum, objects, OBJECT_CONSTANTS_ADDRESS, commands.data());
+
+		CHECK(numVisible > 0 && numVisible < objects.size());
+		CHECK(numCommands == numVisible);
+		for (uint32_t commandIndex = 0; commandIndex < std::min(numCommands, numVisible); commandIndex++)
+		{
+			const uint32_t objectIndex = visible[commandIndex];
+			const IndirectDrawObject& object = objects[objectIndex];
+			const IndirectDrawCommand& command = commands[commandIndex];
+			CHECK(command.objectConstantsAddress == OBJECT_CONSTANTS_ADDRESS + uint64_t(objectIndex) * INDIRECT_OBJECT_CONSTANTS_STRIDE);
+			CHECK(command.indexCountPerInstance == object.indexCount && command.instanceCount == 1);
+			CHECK(command.startIndexLocation == object.startIndexLocation && command.baseVertexLocation == object.baseVertexLocation);
+			CHECK(command.startInstanceLocation == 0);
+		}
+	}
+
+	void TestEmpty()
+	{
+		const CullingFrustum frustum = CullingFrustum::FromViewProjection(glm::mat4(1.0f));
+		CHECK(CullIndirectDraws(frustum, {}, OBJECT_CONSTANTS_ADDRESS, nullptr) == 0);
+	}
+}
+//=============================================================================
+int main()
+{
+	TestMatchesCullBoxes(CullingPath::scalar);
+	TestMatchesCullBoxes(GetBestCullingPath());
+	TestEmpty();
+	return TestResult("IndirectDrawTest");
+}
@@ -0,0 +1,135 @@
+﻿#include "Test.h"
+#include "Engine/InstanceBatcher.h"
+#include "Engine/JobSystem.h"
+#include <random>
+//=============================================================================
+namespace
+{
+	// Build() only compares the pointers, the test passes addresses of plain storage
+	alignas(16) std::byte objectStorage[4][64];
+
+	template<typename T>
+	const T* fakeObject(size_t index)
+	{
+		return reinterpret_cast<const T*>(objectStorage[index]);
+	}
+
+	DrawItem makeDraw(uint32_t indexCount, uint32_t startIndexLocation, uint32_t pipeline = 0)
+	{
+		DrawItem draw;
+		draw.pipeline = fakeObject<PipelineInfo>(pipeline);
+		draw.indexBuffer = fakeObject<BufferResource>(3);
+		draw.indexCount = indexCount;
+		draw.startIndexLocation = startIndexLocation;
+		draw.instanceCount = 99;        // ignored
+		draw.startInstanceLocation = 7; // ignored
+		return draw;
+	}
+
+	MeshInstanceData makeInstance(uint32_t id)
+	{
+		MeshInstanceData instance;
+		instance.worldMatrix[3] = glm::vec4(float(id), 0.0f, 0.0f, 1.0f);
+		instance.textureIndex = id;
+		return instance;
+	}
+
+	// Draws of the same mesh merge, their instances stay in the order of Add()
+	void TestBatches()
+	{
+		const DrawItem box = makeDraw(36, 0);
+		const DrawItem sphere = makeDraw(960, 36);
+		const DrawItem boxOtherPipeline = makeDraw(36, 0, 1);
+
+		InstanceBatcher batcher;
+		batcher.Add(MakeInstancingDrawKey(0, 0, 0, 1), sphere, makeInstance(0));
+		batcher.Add(MakeInstancingDrawKey(0, 0, 0, 0), box, makeInstance(1));
+		batcher.Add(MakeInstancingDrawKey(0, 0, 0, 1), sphere, makeInstance(2));
+		batcher.Add(MakeInstancingDrawKey(0, 1, 0, 0), boxOtherPipeline, makeInstance(3));
+		batcher.Add(MakeInstancingDrawKey(0, 0, 0, 0), box, makeInstance(4));
+		batcher.Add(MakeInstancingDrawKey(0, 0, 0, 1), sphere, makeInstance(5));
+		// same key as the boxes but another index range, the key only orders and never merges by itself
+		batcher.Add(MakeInstancingDrawKey(0, 0, 0, 0), makeDraw(36, 996), makeInstance(6));
+		batcher.Build();
+
+		CHECK(batcher.GetNumDraws() == 7);
+		const std::vector<InstanceBatch>& batches = batcher.GetBatches();
+		CHECK(batches.size() == 4);
+		if (batches.size() != 4) return;
+
+		// boxes, the box with the other index range, spheres, then the other pipeline
+		CHECK(batches[0].draw.startIndexLocation == 0 && batches[0].draw.instanceCount == 2 && batches[0].draw.startInstanceLocation == 0);
+		CHECK(batches[1].draw.startIndexLocation == 996 && batches[1].draw.instanceCount == 1 && batches[1].draw.startInstanceLocation == 2);
+		CHECK(batches[2].draw.indexCount == 960 && batches[2].draw.instanceCount == 3 && batches[2].draw.startInstanceLocation == 3);
+		CHECK(batches[3].draw.pipeline == boxOtherPipeline.pipeline && batches[3].draw.instanceCount == 1 && batches[3].draw.startInstanceLocation == 6);
+		CHECK(batches[2].key == MakeInstancingDrawKey(0, 0, 0, 1));
+
+		const std::vector<MeshInstanceData>& instances = batcher.GetInstances();
+		CHECK(instances.size() == 7);
+		std::vector<uint32_t> ids;
+		for (const MeshInstanceData& instance : instances) ids.push_back(instance.textureIndex);
+		const std::vector<uint32_t> expectedIds = { 1, 4, 6, 0, 2, 5, 3 };
+		CHECK(ids == expectedIds);
+		CHECK(instances[3].worldMatrix[3].x == 0.0f && instances[6].worldMatrix[3].x == 3.0f);
+
+		batcher.Clear();
+		CHECK(batcher.GetNumDraws() == 0 && batcher.GetBatches().empty() && batcher.GetInstances().empty());
+		batcher.Build();
+		CHECK(batcher.GetBatches().empty());
+	}
+
+	// A large scene sorted on the job system: one batch per mesh and every instance once
+	void TestLargeScene()
+	{
+		constexpr uint32_t NUM_MESHES = 50;
+		constexpr uint32_t NUM_DRAWS = 40000;
+		std::mt19937 random(3);
+		std::uniform_int_distribution<uint32_t> meshDistribution(0, NUM_MESHES - 1);
+
+		JobSystem jobSystem;
+		JobSystemCreateInfo createInfo;
+		createInfo.numWorkerThreads = 3;
+		CHECK(jobSystem.Create(createInfo));
+
+		InstanceBatcher batcher;
+		batcher.Reserve(NUM_DRAWS);
+		std::vector<uint32_t> meshCounts(NUM_MESHES, 0);
+		for (uint32_t draw = 0; draw < NUM_DRAWS; draw++)
+		{
+			const uint32_t mesh = meshDistribution(random);
+			meshCounts[mesh]++;
+			MeshInstanceData instance = makeInstance(draw);
+			instance.vertexBufferIndex = mesh;
+			batcher.Add(MakeInstancingDrawKey(0, 0, 0, mesh), makeDraw(36, mesh * 36), instance);
+		}
+		batcher.Build(&jobSystem);
+		jobSystem.Destroy();
+
+		const std::vector<InstanceBatch>& batches = batcher.GetBatches();
+		const std::vector<MeshInstanceData>& instances = batcher.GetInstances();
+		CHECK(batches.size() == NUM_MESHES);
+		uint32_t nextInstance = 0;
+		bool batchesMatch = true;
+		for (const InstanceBatch& batch : batches)
+		{
+			const uint32_t mesh = batch.draw.startIndexLocation / 36;
+			batchesMatch = batchesMatch && batch.draw.startInstanceLocation == nextInstance && batch.draw.instanceCount == meshCounts[mesh];
+			for (uint32_t instance = batch.draw.startInstanceLocation; instance < batch.draw.startInstanceLocation + batch.draw.instanceCount; instance++)
+			{
+				batchesMatch = batchesMatch && instances[instance].vertexBufferIndex == mesh;
+				// in the order of Add()
+				batchesMatch = batchesMatch && (instance == batch.draw.startInstanceLocation || instances[instance - 1].textureIndex < instances[instance].textureIndex);
+			}
+			nextInstance += batch.draw.instanceCount;
+		}
+		CHECK(batchesMatch);
+		CHECK(nextInstance == NUM_DRAWS);
+	}
+}
+//=============================================================================
+int main()
+{
+	TestBatches();
+	TestLargeScene();
+	return TestResult("InstanceBatcherTest");
+}
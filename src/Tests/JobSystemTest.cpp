@@ -0,0 +1,164 @@
+﻿#include "Test.h"
+#include "Engine/JobSystem.h"
+//=============================================================================
+namespace
+{
+	constexpr uint32_t NUM_WORKERS = 3;
+
+	JobSystemCreateInfo makeCreateInfo(bool useFibers)
+	{
+		JobSystemCreateInfo createInfo;
+		createInfo.numWorkerThreads = NUM_WORKERS;
+		createInfo.useFibers = useFibers;
+		return createInfo;
+	}
+
+	// Every job depends on the previous one, the chain is longer than the job pool of a thread. A job that ran before the
+	// one it depends on, or a helping Wait() that took a later job of the chain on top of an earlier one, shows as a wrong order
+	// or a hang.
+	void TestDependencyChain(bool useFibers)
+	{
+		constexpr uint32_t NUM_JOBS = 20000;
+		JobSystem jobs;
+		CHECK(jobs.Create(makeCreateInfo(useFibers)));
+		for (uint32_t run = 0; run < 8; run++)
+		{
+			std::vector<JobCounter> counters(NUM_JOBS);
+			std::atomic<uint32_t> next{ 0 };
+			std::atomic<uint32_t> numOutOfOrder{ 0 };
+			for (uint32_t i = 0; i < NUM_JOBS; i++)
+			{
+				jobs.Schedule([&next, &numOutOfOrder, i]
+				{
+					if (next.load(std::memory_order_relaxed) != i) numOutOfOrder++;
+					next.store(i + 1, std::memory_order_relaxed);
+				}, &counters[i], i > 0 ? &counters[i - 1] : nullptr);
+			}
+			jobs.Wait(counters.back());
+			CHECK(next.load() == NUM_JOBS);
+			CHECK(numOutOfOrder.load() == 0);
+		}
+		jobs.Destroy();
+	}
+
+	// A job fans out and joins: the chain is scheduled from a worker and the chain jobs wait on work of their own
+	void TestChainFromJob(bool useFibers)
+	{
+		constexpr uint32_t NUM_JOBS = 2000;
+		JobSystem jobs;
+		CHECK(jobs.Create(makeCreateInfo(useFibers)));
+		std::vector<JobCounter> counters(NUM_JOBS);
+		std::atomic<uint32_t> next{ 0 };
+		std::atomic<uint32_t> numOutOfOrder{ 0 };
+		std::atomic<uint64_t> sum{ 0 };
+		JobCounter root;
+		jobs.Schedule([&]
+		{
+			for (uint32_t i = 0; i < NUM_JOBS; i++)
+			{
+				jobs.Schedule([&, i]
+				{
+					if (next.load(std::memory_order_relaxed) != i) numOutOfOrder++;
+					JobCounter children;
+					for (uint32_t child = 0; child < 4; child++) jobs.Schedule([&sum, child] { sum += child; }, &children);
+					jobs.Wait(children);
+					next.store(i + 1, std::memory_order_relaxed);
+				}, &counters[i], i > 0 ? &counters[i - 1] : nullptr);
+			}
+		}, &root);
+		jobs.Wait(root);
+		jobs.Wait(counters.back());
+		CHECK(next.load() == NUM_JOBS);
+		CHECK(numOutOfOrder.load() == 0);
+		CHECK(sum.load() == NUM_JOBS * 6ull);
+		jobs.Destroy();
+	}
+
+	// Several jobs depend on one counter, the counter is used again after it was done
+	void TestFanOutAndReuse(bool useFibers)
+	{
+		JobSystem jobs;
+		CHECK(jobs.Create(makeCreateInfo(useFibers)));
+		JobCounter first;
+		JobCounter dependents;
+		std::atomic<bool> firstDone{ false };
+		std::atomic<uint32_t> numEarly{ 0 };
+		jobs.Schedule([&firstDone] { std::this_thread::sleep_for(std::chrono::milliseconds(5)); firstDone = true; }, &first);
+		for (uint32_t i = 0; i < 100; i++) jobs.Schedule([&] { if (!firstDone) numEarly++; }, &dependents, &first);
+		jobs.Wait(dependents);
+		CHECK(first.IsDone());
+		CHECK(numEarly.load() == 0);
+
+		// done: a dependent job is queued at once
+		std::atomic<uint32_t> numRan{ 0 };
+		jobs.Schedule([&numRan] { numRan++; }, &dependents, &first);
+		jobs.Schedule([&numRan] { numRan++; }, &first);
+		jobs.Wait(first);
+		jobs.Wait(dependents);
+		CHECK(numRan.load() == 2);
+		jobs.Destroy();
+	}
+
+	void TestParallelFor(bool useFibers)
+	{
+		constexpr uint32_t COUNT = 1u << 18;
+		JobSystem jobs;
+		CHECK(jobs.Create(makeCreateInfo(useFibers)));
+		std::vector<uint32_t> visits(COUNT, 0);
+		jobs.ParallelFor(COUNT, [&visits](uint32_t begin, uint32_t end) { for (uint32_t i = begin; i < end; i++) visits[i]++; });
+		CHECK(std::all_of(visits.begin(), visits.end(), [](uint32_t numVisits) { return numVisits == 1; }));
+
+		std::atomic<uint32_t> numChunks{ 0 };
+		std::atomic<uint32_t> numSmallChunks{ 0 };
+		jobs.ParallelFor(1000, [&](uint32_t begin, uint32_t end)
+		{
+			numChunks++;
+			if (end - begin < 100) numSmallChunks++;
+		}, 100);
+		CHECK(numChunks.load() > 0);
+		CHECK(numSmallChunks.load() == 0);
+		jobs.Destroy();
+	}
+
+	// Jobs that run a ParallelFor of their own wait inside the job, with fibers the worker runs other jobs meanwhile
+	void TestWaitInsideJob(bool useFibers)
+	{
+		constexpr uint32_t NUM_OUTER = 64;
+		constexpr uint32_t NUM_INNER = 4096;
+		JobSystem jobs;
+		CHECK(jobs.Create(makeCreateInfo(useFibers)));
+		std::vector<uint64_t> sums(NUM_OUTER, 0);
+		JobCounter counter;
+		for (uint32_t outer = 0; outer < NUM_OUTER; outer++)
+		{
+			jobs.Schedule([&jobs, &sums, outer]
+			{
+				std::atomic<uint64_t> sum{ 0 };
+				jobs.ParallelFor(NUM_INNER, [&sum](uint32_t begin, uint32_t end)
+				{
+					uint64_t chunkSum = 0;
+					for (uint32_t i = begin; i < end; i++) chunkSum += i;
+					sum += chunkSum;
+				}, 64);
+				sums[outer] = sum.load();
+			}, &counter);
+		}
+		jobs.Wait(counter);
+		const uint64_t expected = uint64_t(NUM_INNER) * (NUM_INNER - 1) / 2;
+		CHECK(std::all_of(sums.begin(), sums.end(), [expected](uint64_t sum) { return sum == expected; }));
+		jobs.Destroy();
+	}
+}
+//=============================================================================
+int main()
+{
+	for (bool useFibers : { true, false })
+	{
+		TestDependencyChain(useFibers);
+		TestChainFromJob(useFibers);
+		TestFanOutAndReuse(useFibers);
+		TestParallelFor(useFibers);
+		TestWaitInsideJob(useFibers);
+	}
+	return TestResult("JobSystemTest");
+}
@@ -0,0 +1,209 @@
+﻿#include "Test.h"
+#include "Engine/MeshLod.h"
+#include "Engine/MeshOptimizer.h"
+#include <random>
+//=============================================================================
+namespace
+{
+	const CullingPath SIMD_PATHS[] = { CullingPath::sse, CullingPath::avx2, CullingPath::automatic };
+
+	// size x size quads of a rolling height field, curved everywhere so that every collapse has an error
+	void makeTerrain(uint32_t size, std::vector<glm::vec3>& positions, std::vector<uint32_t>& indices)
+	{
+		for (uint32_t y = 0; y <= size; y++)
+		{
+			for (uint32_t x = 0; x <= size; x++)
+			{
+				const float u = float(x) / float(size);
+				const float v = float(y) / float(size);
+				positions.emplace_back(u, 0.05f * std::sin(u * 9.0f) * std::cos(v * 7.0f), v);
+			}
+		}
+		for (uint32_t y = 0; y < size; y++)
+		{
+			for (uint32_t x = 0; x < size; x++)
+			{
+				const uint32_t v0 = y * (size + 1) + x;
+				const uint32_t v1 = v0 + size + 1;
+				indices.insert(indices.end(), { v0, v1, v0 + 1, v0 + 1, v1, v1 + 1 });
+			}
+		}
+	}
+
+	// The levels follow each other in the index buffer, each has fewer triangles and at least the error of the one before
+	void TestLodChain()
+	{
+		std::vector<glm::vec3> positions;
+		std::vector<uint32_t> indices;
+		makeTerrain(64, positions, indices);
+		const uint32_t numVertices = static_cast<uint32_t>(positions.size());
+
+		LodChainDesc desc;
+		MeshLodChain chain;
+		CHECK(BuildLodChain(std::span<const uint32_t>(indices), &positions[0].x, numVertices, sizeof(glm::vec3), desc, chain));
+		CHECK(chain.lods.size() >= 4 && chain.lods.size() <= MAX_MESH_LODS);
+		CHECK(chain.lods[0].startIndexLocation == 0 && chain.lods[0].indexCount == indices.size() && chain.lods[0].error == 0.0f);
+		CHECK(std::equal(indices.begin(), indices.end(), chain.indices.begin()));
+
+		bool monotonic = true;
+		uint32_t nextStart = 0;
+		for (size_t lod = 0; lod < chain.lods.size(); lod++)
+		{
+			const MeshLod& level = chain.lods[lod];
+			monotonic = monotonic && level.startIndexLocation == nextStart && level.indexCount % 3 == 0 && level.indexCount / 3 >= desc.minTriangles;
+			nextStart += level.indexCount;
+			if (lod == 0) continue;
+			const MeshLod& previous = chain.lods[lod - 1];
+			monotonic = monotonic && float(level.indexCount) <= float(previous.indexCount) * desc.minReduction;
+			monotonic = monotonic && level.error >= previous.error && level.error > 0.0f;
+		}
+		CHECK(monotonic);
+		CHECK(nextStart == chain.indices.size());
+		CHECK(std::all_of(chain.indices.begin(), chain.indices.end(), [numVertices](uint32_t index) { return index < numVertices; }));
+		// the simplified levels are in vertex cache order, few vertices are transformed twice. The errors stay within the height
+		// of the terrain.
+		bool cacheOrder = true;
+		for (size_t lod = 1; lod < chain.lods.size(); lod++)
+		{
+			const std::span<const uint32_t> levelIndices(chain.indices.data() + chain.lods[lod].startIndexLocation, chain.lods[lod].indexCount);
+			cacheOrder = cacheOrder && AnalyzeVertexCache(levelIndices, numVertices).atvr < 1.5f;
+		}
+		CHECK(cacheOrder);
+		CHECK(chain.lods.back().error < 0.1f);
+
+		// the limits of the desc end the chain
+		desc.maxLods = 2;
+		CHECK(BuildLodChain(std::span<const uint32_t>(indices), &positions[0].x, numVertices, sizeof(glm::vec3), desc, chain));
+		CHECK(chain.lods.size() == 2);
+		desc.maxLods = MAX_MESH_LODS;
+		desc.minTriangles = static_cast<uint32_t>(indices.size() / 3);
+		CHECK(BuildLodChain(std::span<const uint32_t>(indices), &positions[0].x, numVertices, sizeof(glm::vec3), desc, chain));
+		CHECK(chain.lods.size() == 1 && chain.indices.size() == indices.size());
+	}
+
+	// errors 10, 40 and 160 pixels at distance 1: LOD 1 fits from distance 10, LOD 2 from 40, LOD 3 from 160
+	const MeshLod TEST_LODS[] = { { 0, 3000, 0.0f }, { 3000, 1500, 0.01f }, { 4500, 750, 0.04f }, { 5250, 375, 0.16f } };
+
+	LodSelectionParams makeParams(float hysteresis)
+	{
+		LodSelectionParams params;
+		params.projectionScale = 1000.0f;
+		params.maxPixelError = 1.0f;
+		params.hysteresis = hysteresis;
+		return params;
+	}
+
+	uint32_t selectAt(LodInstances& instances, float distance, const LodSelectionParams& params, CullingPath path = CullingPath::automatic)
+	{
+		instances.Set(0, glm::vec3(0.0f, 0.0f, distance), 0.0f, 1.0f);
+		SelectLods(params, TEST_LODS, instances, 0, 1, path);
+		return instances.GetLods()[0];
+	}
+
+	// A new instance takes the coarsest level that fits, farther instances never get finer levels
+	void TestSelection()
+	{
+		const LodSelectionParams params = makeParams(0.0f);
+		uint32_t previousLod = 0;
+		bool monotonic = true;
+		for (float distance = 0.5f; distance < 400.0f; distance *= 1.05f)
+		{
+			LodInstances instances;
+			instances.Add(glm::vec3(0.0f), 0.0f, 1.0f);
+			const uint32_t lod = selectAt(instances, distance, params);
+			monotonic = monotonic && lod >= previousLod;
+			previousLod = lod;
+		}
+		CHECK(monotonic);
+		CHECK(previousLod == 3);
+
+		LodInstances instances;
+		instances.Add(glm::vec3(0.0f), 0.0f, 1.0f);
+		CHECK(selectAt(instances, 5.0f, params) == 0);
+		CHECK(selectAt(instances, 20.0f, params) == 1);
+		CHECK(selectAt(instances, 100.0f, params) == 2);
+		CHECK(selectAt(instances, 1000.0f, params) == 3);
+
+		// the distance is to the sphere, the error grows with the scale
+		instances.Set(0, glm::vec3(0.0f, 0.0f, 60.0f), 30.0f, 1.0f);
+		SelectLods(params, TEST_LODS, instances, 0, 1);
+		CHECK(instances.GetLods()[0] == 1);
+		instances.Set(0, glm::vec3(0.0f, 0.0f, 100.0f), 0.0f, 3.0f);
+		SelectLods(params, TEST_LODS, instances, 0, 1);
+		CHECK(instances.GetLods()[0] == 1);
+
+		// a mesh with a single level
+		instances.Set(0, glm::vec3(0.0f, 0.0f, 1000.0f), 0.0f, 1.0f);
+		SelectLods(params, std::span<const MeshLod>(TEST_LODS, 1), instances, 0, 1);
+		CHECK(instances.GetLods()[0] == 0);
+	}
+
+	// Around the switch distance of LOD 1 (10) the level only changes past the band of 10%
+	void TestHysteresis()
+	{
+		for (CullingPath path : { CullingPath::scalar, CullingPath::sse, CullingPath::avx2 })
+		{
+			const LodSelectionParams params = makeParams(0.1f);
+			LodInstances instances;
+			instances.Add(glm::vec3(0.0f), 0.0f, 1.0f);
+			CHECK(selectAt(instances, 20.0f, params, path) == 1);
+			// coming closer, LOD 1 stays until it no longer fits 1.1 times the distance
+			CHECK(selectAt(instances, 10.8f, params, path) == 1);
+			CHECK(selectAt(instances, 9.5f, params, path) == 1);
+			CHECK(selectAt(instances, 9.0f, params, path) == 0);
+			// going away, LOD 0 stays until LOD 1 fits 0.9 times the distance
+			CHECK(selectAt(instances, 9.5f, params, path) == 0);
+			CHECK(selectAt(instances, 10.8f, params, path) == 0);
+			CHECK(selectAt(instances, 11.5f, params, path) == 1);
+			// far jumps are not held back
+			CHECK(selectAt(instances, 1000.0f, params, path) == 3);
+			CHECK(selectAt(instances, 1.0f, params, path) == 0);
+		}
+	}
+
+	// The SIMD paths select exactly the levels of the scalar path, also for ranges that do not start or end on a multiple of 8
+	void TestSimdMatchesScalar()
+	{
+		std::mt19937 random(8);
+		std::uniform_real_distribution<float> coordinate(-500.0f, 500.0f);
+		std::uniform_real_distribution<float> radius(0.0f, 20.0f);
+		std::uniform_real_distribution<float> scale(0.2f, 4.0f);
+		std::uniform_real_distribution<float> error(0.0f, 0.05f);
+
+		MeshLod lods[MAX_MESH_LODS];
+		for (uint32_t lod = 1; lod < MAX_MESH_LODS; lod++) lods[lod].error = lods[lod - 1].error + error(random);
+		std::uniform_int_distribution<uint32_t> startLod(0, MAX_MESH_LODS - 1);
+
+		LodInstances source;
+		for (uint32_t instance = 0; instance < 5000; instance++)
+		{
+			source.Add({ coordinate(random), coordinate(random) * 0.1f, coordinate(random) }, radius(random), scale(random));
+			source.GetLods()[instance] = startLod(random);
+		}
+
+		LodSelectionParams params = makeParams(0.15f);
+		params.cameraPosition = glm::vec3(10.0f, 2.0f, -30.0f);
+		params.projectionScale = LodSelectionParams::ProjectionScale(glm::radians(60.0f), 1080.0f);
+		const uint32_t ranges[][2] = { { 0, 5000 }, { 3, 4997 }, { 1, 6 }, { 17, 17 }, { 4000, 4009 } };
+		for (const auto& range : ranges)
+		{
+			LodInstances scalar = source;
+			SelectLods(params, lods, scalar, range[0], range[1], CullingPath::scalar);
+			for (CullingPath path : SIMD_PATHS)
+			{
+				LodInstances simd = source;
+				SelectLods(params, lods, simd, range[0], range[1], path);
+				CHECK(std::equal(simd.GetLods(), simd.GetLods() + simd.GetCount(), scalar.GetLods()));
+			}
+		}
+	}
+}
+//=============================================================================
+int main()
+{
+	TestLodChain();
+	TestSelection();
+	TestHysteresis();
+	TestSimdMatchesScalar();
+	return TestResult("MeshLodTest");
+}
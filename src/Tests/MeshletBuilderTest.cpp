@@ -0,0 +1,217 @@
+﻿#include "Test.h"
+#include "Engine/MeshletBuilder.h"
+#include <array>
+//=============================================================================
+namespace
+{
+	struct TestMesh final
+	{
+		std::vector<glm::vec3> positions;
+		std::vector<uint32_t>  indices;
+	};
+
+	// Unit UV sphere with a seam, the triangles at the poles are degenerate
+	TestMesh makeSphere(uint32_t stacks, uint32_t slices)
+	{
+		TestMesh mesh;
+		for (uint32_t stack = 0; stack <= stacks; stack++)
+		{
+			const float theta = glm::pi<float>() * float(stack) / float(stacks);
+			for (uint32_t slice = 0; slice <= slices; slice++)
+			{
+				const float phi = glm::two_pi<float>() * float(slice) / float(slices);
+				mesh.positions.emplace_back(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+			}
+		}
+		for (uint32_t stack = 0; stack < stacks; stack++)
+		{
+			for (uint32_t slice = 0; slice < slices; slice++)
+			{
+				const uint32_t v0 = stack * (slices + 1) + slice;
+				const uint32_t v1 = v0 + slices + 1;
+				mesh.indices.insert(mesh.indices.end(), { v0, v0 + 1, v1, v0 + 1, v1 + 1, v1 });
+			}
+		}
+		return mesh;
+	}
+
+	bool buildMeshlets(const TestMesh& mesh, MeshletData& meshletData)
+	{
+		return BuildMeshlets(std::span<const uint32_t>(mesh.indices), &mesh.positions[0].x, static_cast<uint32_t>(mesh.positions.size()), sizeof(glm::vec3), meshletData);
+	}
+
+	// the source triangles of the meshlets, each rotated to start at its smallest index so that the winding is kept
+	std::vector<std::array<uint32_t, 3>> getTriangles(const MeshletData& meshletData)
+	{
+		std::vector<std::array<uint32_t, 3>> triangles;
+		for (const Meshlet& meshlet : meshletData.meshlets)
+		{
+			for (uint32_t triangle = 0; triangle < meshlet.triangleCount; triangle++)
+			{
+				const uint32_t packed = meshletData.triangles[meshlet.triangleOffset + triangle];
+				std::array<uint32_t, 3> vertices{};
+				for (uint32_t corner = 0; corner < 3; corner++)
+					vertices[corner] = meshletData.vertexIndices[meshlet.vertexOffset + ((packed >> (corner * 8)) & 0xFF)];
+				std::rotate(vertices.begin(), std::min_element(vertices.begin(), vertices.end()), vertices.end());
+				triangles.push_back(vertices);
+			}
+		}
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+
+	std::vector<std::array<uint32_t, 3>> getTriangles(const TestMesh& mesh)
+	{
+		std::vector<std::array<uint32_t, 3>> triangles;
+		for (size_t first = 0; first < mesh.indices.size(); first += 3)
+		{
+			std::array<uint32_t, 3> vertices = { mesh.indices[first], mesh.indices[first + 1], mesh.indices[first + 2] };
+			std::rotate(vertices.begin(), std::min_element(vertices.begin(), vertices.end()), vertices.end());
+			triangles.push_back(vertices);
+		}
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+
+	// Every meshlet stays within the limits and the meshlets hold every triangle once, degenerate ones included
+	void TestLimitsAndCoverage()
+	{
+		const TestMesh mesh = makeSphere(24, 48);
+		MeshletData meshletData;
+		CHECK(buildMeshlets(mesh, meshletData));
+		CHECK(!meshletData.meshlets.empty());
+		CHECK(meshletData.bounds.size() == meshletData.meshlets.size());
+
+		bool withinLimits = true;
+		bool packedIndicesValid = true;
+		for (const Meshlet& meshlet : meshletData.meshlets)
+		{
+			withinLimits = withinLimits && meshlet.vertexCount > 0 && meshlet.vertexCount <= MESHLET_MAX_VERTICES;
+			withinLimits = withinLimits && meshlet.triangleCount > 0 && meshlet.triangleCount <= MESHLET_MAX_TRIANGLES;
+			withinLimits = withinLimits && meshlet.vertexOffset + meshlet.vertexCount <= meshletData.vertexIndices.size();
+			withinLimits = withinLimits && meshlet.triangleOffset + meshlet.triangleCount <= meshletData.triangles.size();
+			for (uint32_t triangle = 0; triangle < meshlet.triangleCount; triangle++)
+			{
+				const uint32_t packed = meshletData.triangles[meshlet.triangleOffset + triangle];
+				packedIndicesValid = packedIndicesValid && (packed >> 24) == 0;
+				for (uint32_t corner = 0; corner < 3; corner++) packedIndicesValid = packedIndicesValid && ((packed >> (corner * 8)) & 0xFF) < meshlet.vertexCount;
+			}
+		}
+		CHECK(withinLimits);
+		CHECK(packedIndicesValid);
+		CHECK(getTriangles(meshletData) == getTriangles(mesh));
+
+		// the meshlets are at least half full on average
+		CHECK(meshletData.meshlets.size() <= 2 * (mesh.indices.size() / 3 + MESHLET_MAX_TRIANGLES - 1) / MESHLET_MAX_TRIANGLES);
+
+		// uint16 indices give the same meshlets
+		const std::vector<uint16_t> indices16(mesh.indices.begin(), mesh.indices.end());
+		MeshletData meshletData16;
+		CHECK(BuildMeshlets(std::span<const uint16_t>(indices16), &mesh.positions[0].x, static_cast<uint32_t>(mesh.positions.size()), sizeof(glm::vec3), meshletData16));
+		CHECK(meshletData16.vertexIndices == meshletData.vertexIndices && meshletData16.triangles == meshletData.triangles);
+	}
+
+	// The spheres hold their vertices and a meshlet that the cone culls has no triangle facing the camera
+	void TestBounds()
+	{
+		const TestMesh mesh = makeSphere(24, 48);
+		MeshletData meshletData;
+		CHECK(buildMeshlets(mesh, meshletData));
+
+		bool spheresHoldVertices = true;
+		for (size_t meshletIndex = 0; meshletIndex < meshletData.meshlets.size(); meshletIndex++)
+		{
+			const Meshlet& meshlet = meshletData.meshlets[meshletIndex];
+			const MeshletBounds& bounds = meshletData.bounds[meshletIndex];
+			for (uint32_t vertex = 0; vertex < meshlet.vertexCount; vertex++)
+				spheresHoldVertices = spheresHoldVertices && glm::distance(mesh.positions[meshletData.vertexIndices[meshlet.vertexOffset + vertex]], bounds.center) <= bounds.radius * 1.0001f;
+			// a patch of a unit sphere
+			spheresHoldVertices = spheresHoldVertices && bounds.radius < 1.0f;
+		}
+		CHECK(spheresHoldVertices);
+
+		const glm::vec3 cameras[] = { { 0.0f, 0.0f, 10.0f }, { 3.0f, 2.0f, -1.0f }, { 0.0f, -1.5f, 0.0f }, { 0.7f, 0.7f, 0.0f } };
+		for (const glm::vec3& camera : cameras)
+		{
+			uint32_t numCulled = 0;
+			bool conservative = true;
+			for (size_t meshletIndex = 0; meshletIndex < meshletData.meshlets.size(); meshletIndex++)
+			{
+				if (!IsMeshletBackfacing(meshletData.bounds[meshletIndex], camera)) continue;
+				numCulled++;
+				const Meshlet& meshlet = meshletData.meshlets[meshletIndex];
+				for (uint32_t triangle = 0; triangle < meshlet.triangleCount; triangle++)
+				{
+					const uint32_t packed = meshletData.triangles[meshlet.triangleOffset + triangle];
+					const auto position = [&](uint32_t corner) { return mesh.positions[meshletData.vertexIndices[meshlet.vertexOffset + ((packed >> (corner * 8)) & 0xFF)]]; };
+					const glm::vec3 normal = glm::cross(position(1) - position(0), position(2) - position(0));
+					conservative = conservative && glm::dot(normal, position(0) - camera) >= -1e-6f;
+				}
+			}
+			CHECK(conservative);
+			// the camera outside of the sphere sees less than half of it
+			if (glm::length(camera) > 1.0f) CHECK(numCulled > 0);
+		}
+
+		const glm::vec4 cone = UnpackMeshletCone(0x7F00817F);
+		CHECK(cone.x == 1.0f && cone.y == -1.0f && cone.z == 0.0f && cone.w == 1.0f);
+	}
+
+	// The blob gives back the same arrays, a corrupt blob is rejected
+	void TestSerialization()
+	{
+		const TestMesh mesh = makeSphere(16, 32);
+		MeshletData meshletData;
+		CHECK(buildMeshlets(mesh, meshletData));
+
+		std::vector<uint8_t> blob;
+		SerializeMeshlets(meshletData, blob);
+		MeshletData loaded;
+		CHECK(DeserializeMeshlets(blob.data(), blob.size(), loaded));
+		CHECK(loaded.meshlets.size() == meshletData.meshlets.size());
+		CHECK(memcmp(loaded.meshlets.data(), meshletData.meshlets.data(), meshletData.meshlets.size() * sizeof(Meshlet)) == 0);
+		CHECK(memcmp(loaded.bounds.data(), meshletData.bounds.data(), meshletData.bounds.size() * sizeof(MeshletBounds)) == 0);
+		CHECK(loaded.vertexIndices == meshletData.vertexIndices);
+		CHECK(loaded.triangles == meshletData.triangles);
+
+		CHECK(!DeserializeMeshlets(blob.data(), 8, loaded));
+		CHECK(!DeserializeMeshlets(blob.data(), blob.size() - 4, loaded));
+		std::vector<uint8_t> corrupt = blob;
+		corrupt[4] = MESHLET_DATA_VERSION + 1;
+		CHECK(!DeserializeMeshlets(corrupt.data(), corrupt.size(), loaded));
+		// the header is 6 uint32, vertexCount of the first meshlet follows its two offsets
+		corrupt = blob;
+		const uint32_t tooManyVertices = MESHLET_MAX_VERTICES + 1;
+		memcpy(corrupt.data() + 24 + offsetof(Meshlet, vertexCount), &tooManyVertices, sizeof(uint32_t));
+		CHECK(!DeserializeMeshlets(corrupt.data(), corrupt.size(), loaded));
+		CHECK(loaded.meshlets.empty());
+
+		// an empty mesh round trips as well
+		MeshletData empty;
+		SerializeMeshlets(empty, blob);
+		CHECK(DeserializeMeshlets(blob.data(), blob.size(), loaded));
+		CHECK(loaded.meshlets.empty() && loaded.triangles.empty());
+	}
+
+	void TestInvalidInput()
+	{
+		const TestMesh mesh = makeSphere(4, 8);
+		MeshletData meshletData;
+		std::vector<uint32_t> indices = mesh.indices;
+		indices.pop_back();
+		CHECK(!BuildMeshlets(std::span<const uint32_t>(indices), &mesh.positions[0].x, static_cast<uint32_t>(mesh.positions.size()), sizeof(glm::vec3), meshletData));
+		indices = mesh.indices;
+		indices[5] = static_cast<uint32_t>(mesh.positions.size());
+		CHECK(!BuildMeshlets(std::span<const uint32_t>(indices), &mesh.positions[0].x, static_cast<uint32_t>(mesh.positions.size()), sizeof(glm::vec3), meshletData));
+		CHECK(meshletData.meshlets.empty());
+	}
+}
+//=============================================================================
+int main()
+{
+	TestLimitsAndCoverage();
+	TestBounds();
+	TestSerialization();
+	TestInvalidInput();
+	return TestResult("MeshletBuilderTest");
+}
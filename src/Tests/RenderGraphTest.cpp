@@ -0,0 +1,337 @@
+﻿#include "Test.h"
+#include "Engine/RenderGraph.h"
+//=============================================================================
+namespace
+{
+	using Access = RenderGraphAccess;
+
+	const RenderGraphTransientDesc TEXTURE{ 1024, 256, 0 };
+
+	uint32_t compiledIndex(const RenderGraph& graph, uint32_t pass)
+	{
+		const std::vector<RenderGraphCompiledPass>& compiledPasses = graph.GetCompiledPasses();
+		for (uint32_t index = 0; index < compiledPasses.size(); index++)
+		{
+			if (compiledPasses[index].pass == pass) return index;
+		}
+		return RENDER_GRAPH_INVALID_INDEX;
+	}
+
+	// the barriers issued before a pass, or after it with release
+	std::vector<RenderGraphBarrier> passBarriers(const RenderGraph& graph, uint32_t pass, bool release = false)
+	{
+		const RenderGraphCompiledPass& compiledPass = graph.GetCompiledPasses()[compiledIndex(graph, pass)];
+		const uint32_t first = release ? compiledPass.firstReleaseBarrier : compiledPass.firstBarrier;
+		const uint32_t count = release ? compiledPass.numReleaseBarriers : compiledPass.numBarriers;
+		return { graph.GetBarriers().begin() + first, graph.GetBarriers().begin() + first + count };
+	}
+
+	bool isTransition(const RenderGraphBarrier& barrier, RenderGraphResource resource, Access before, Access after)
+	{
+		return barrier.type == RenderGraphBarrierType::transition && barrier.resource == resource && barrier.before == before && barrier.after == after;
+	}
+
+	uint32_t waitForPass(const RenderGraph& graph, uint32_t pass)
+	{
+		const uint32_t waitFor = graph.GetCompiledPasses()[compiledIndex(graph, pass)].waitForPass;
+		return waitFor == RENDER_GRAPH_INVALID_INDEX ? RENDER_GRAPH_INVALID_INDEX : graph.GetCompiledPasses()[waitFor].pass;
+	}
+
+	// Passes survive through side effects, writes of imported resources and what surviving passes read
+	void TestCulling()
+	{
+		RenderGraph graph;
+		const RenderGraphResource backBuffer = graph.Import("BackBuffer", Access::present, Access::present);
+		const RenderGraphResource unused = graph.CreateTransient("Unused", TEXTURE);
+		const RenderGraphResource shadow = graph.CreateTransient("Shadow", TEXTURE);
+		const RenderGraphResource readback = graph.CreateTransient("Readback", TEXTURE);
+
+		RenderGraphPassBuilder unusedPass = graph.AddPass("Unused");
+		unusedPass.Write(unused, Access::renderTarget);
+		RenderGraphPassBuilder shadowPass = graph.AddPass("Shadow");
+		shadowPass.Write(shadow, Access::depthWrite);
+		RenderGraphPassBuilder lighting = graph.AddPass("Lighting");
+		lighting.Read(shadow, Access::pixelShaderRead);
+		lighting.Write(backBuffer, Access::renderTarget);
+		RenderGraphPassBuilder readbackPass = graph.AddPass("Readback");
+		readbackPass.Write(readback, Access::copyDest);
+		readbackPass.SetSideEffects();
+		// reads what Unused wrote but is culled itself, it does not keep Unused alive
+		RenderGraphPassBuilder debug = graph.AddPass("Debug");
+		debug.Read(unused, Access::pixelShaderRead);
+		debug.Write(graph.CreateTransient("DebugOutput", TEXTURE), Access::renderTarget);
+
+		CHECK(graph.Compile());
+		CHECK(graph.IsPassCulled(unusedPass.GetPassIndex()));
+		CHECK(graph.IsPassCulled(debug.GetPassIndex()));
+		CHECK(!graph.IsPassCulled(shadowPass.GetPassIndex()));
+		CHECK(!graph.IsPassCulled(lighting.GetPassIndex()));
+		CHECK(!graph.IsPassCulled(readbackPass.GetPassIndex()));
+		CHECK(graph.GetCompiledPasses().size() == 3);
+		// declaration order, Lighting depends on Shadow
+		CHECK(compiledIndex(graph, shadowPass.GetPassIndex()) < compiledIndex(graph, lighting.GetPassIndex()));
+		CHECK(graph.GetCompiledPasses()[compiledIndex(graph, lighting.GetPassIndex())].dependencyLevel == 1);
+		CHECK(graph.GetCompiledPasses()[compiledIndex(graph, readbackPass.GetPassIndex())].dependencyLevel == 0);
+		CHECK(graph.GetPlacement(unused).firstPass == RENDER_GRAPH_INVALID_INDEX);
+
+		// reading a transient nobody wrote
+		RenderGraph invalid;
+		const RenderGraphResource neverWritten = invalid.CreateTransient("NeverWritten", TEXTURE);
+		RenderGraphPassBuilder reader = invalid.AddPass("Reader");
+		reader.Read(neverWritten, Access::pixelShaderRead);
+		reader.SetSideEffects();
+		CHECK(!invalid.Compile());
+	}
+
+	// Consecutive reads get one transition into the combined read state, the imported resource returns to its final access
+	void TestMergedReadStates()
+	{
+		RenderGraph graph;
+		const RenderGraphResource backBuffer = graph.Import("BackBuffer", Access::present, Access::present);
+		const RenderGraphResource gbuffer = graph.CreateTransient("GBuffer", TEXTURE);
+
+		RenderGraphPassBuilder geometry = graph.AddPass("Geometry");
+		geometry.Write(gbuffer, Access::renderTarget);
+		RenderGraphPassBuilder lighting = graph.AddPass("Lighting");
+		lighting.Read(gbuffer, Access::pixelShaderRead);
+		lighting.Write(backBuffer, Access::renderTarget);
+		RenderGraphPassBuilder reflections = graph.AddPass("Reflections");
+		reflections.Read(gbuffer, Access::nonPixelShaderRead);
+		reflections.Read(gbuffer, Access::copySource);
+		reflections.Write(backBuffer, Access::renderTarget);
+		CHECK(graph.Compile());
+
+		const std::vector<RenderGraphBarrier> geometryBarriers = passBarriers(graph, geometry.GetPassIndex());
+		CHECK(geometryBarriers.size() == 1);
+		CHECK(geometryBarriers.size() == 1 && isTransition(geometryBarriers[0], gbuffer, Access::none, Access::renderTarget));
+
+		const Access combined = Access::pixelShaderRead | Access::nonPixelShaderRead | Access::copySource;
+		const std::vector<RenderGraphBarrier> lightingBarriers = passBarriers(graph, lighting.GetPassIndex());
+		CHECK(lightingBarriers.size() == 2);
+		CHECK(std::count_if(lightingBarriers.begin(), lightingBarriers.end(), [&](const RenderGraphBarrier& barrier) { return isTransition(barrier, gbuffer, Access::renderTarget, combined); }) == 1);
+		CHECK(std::count_if(lightingBarriers.begin(), lightingBarriers.end(), [&](const RenderGraphBarrier& barrier) { return isTransition(barrier, backBuffer, Access::present, Access::renderTarget); }) == 1);
+		CHECK(passBarriers(graph, reflections.GetPassIndex()).empty());
+
+		const std::vector<RenderGraphBarrier>& barriers = graph.GetBarriers();
+		CHECK(barriers.size() - graph.GetFirstFinalBarrier() == 1);
+		CHECK(barriers.size() - graph.GetFirstFinalBarrier() == 1 && isTransition(barriers.back(), backBuffer, Access::renderTarget, Access::present));
+
+		// a write and a read of one resource in a pass conflict unless both are unordered access
+		RenderGraph conflicting;
+		const RenderGraphResource texture = conflicting.Import("Texture", Access::present, Access::present);
+		RenderGraphPassBuilder pass = conflicting.AddPass("Conflicting");
+		pass.Read(texture, Access::pixelShaderRead);
+		pass.Write(texture, Access::renderTarget);
+		CHECK(!conflicting.Compile());
+	}
+
+	// Unordered access after unordered access writes needs a UAV barrier, not a transition
+	void TestUnorderedAccessBarriers()
+	{
+		RenderGraph graph;
+		const RenderGraphResource buffer = graph.Import("Particles", Access::unorderedAccess, Access::unorderedAccess);
+		RenderGraphPassBuilder emit = graph.AddPass("Emit");
+		emit.Write(buffer, Access::unorderedAccess);
+		RenderGraphPassBuilder simulate = graph.AddPass("Simulate");
+		simulate.Read(buffer, Access::unorderedAccess);
+		simulate.Write(buffer, Access::unorderedAccess);
+		RenderGraphPassBuilder draw = graph.AddPass("Draw");
+		draw.Read(buffer, Access::nonPixelShaderRead);
+		draw.SetSideEffects();
+		CHECK(graph.Compile());
+
+		// work from before the graph may still write the imported buffer
+		const std::vector<RenderGraphBarrier> emitBarriers = passBarriers(graph, emit.GetPassIndex());
+		CHECK(emitBarriers.size() == 1 && emitBarriers[0].type == RenderGraphBarrierType::unorderedAccess);
+		const std::vector<RenderGraphBarrier> simulateBarriers = passBarriers(graph, simulate.GetPassIndex());
+		CHECK(simulateBarriers.size() == 1);
+		CHECK(simulateBarriers.size() == 1 && simulateBarriers[0].type == RenderGraphBarrierType::unorderedAccess && simulateBarriers[0].resource == buffer);
+		const std::vector<RenderGraphBarrier> drawBarriers = passBarriers(graph, draw.GetPassIndex());
+		CHECK(drawBarriers.size() == 1 && isTransition(drawBarriers[0], buffer, Access::unorderedAccess, Access::nonPixelShaderRead));
+		// back to unordered access after the graph
+		CHECK(graph.GetBarriers().size() - graph.GetFirstFinalBarrier() == 1);
+	}
+
+	// Transients with disjoint lifetimes share memory, with an aliasing barrier at the hand-over. Overlapping ones do not.
+	void TestTransientAliasing()
+	{
+		RenderGraph graph;
+		const RenderGraphResource backBuffer = graph.Import("BackBuffer", Access::present, Access::present);
+		const RenderGraphResource first = graph.CreateTransient("First", TEXTURE);
+		const RenderGraphResource second = graph.CreateTransient("Second", TEXTURE);
+		const RenderGraphResource third = graph.CreateTransient("Third", TEXTURE);
+		const RenderGraphResource otherGroup = graph.CreateTransient("OtherGroup", { 512, 256, 1 });
+
+		// First lives in passes 0-1, Second in 1-2: they overlap. Third lives in 2-3 and can take the memory of First.
+		RenderGraphPassBuilder pass0 = graph.AddPass("Pass0");
+		pass0.Write(first, Access::renderTarget);
+		pass0.Write(otherGroup, Access::copyDest);
+		RenderGraphPassBuilder pass1 = graph.AddPass("Pass1");
+		pass1.Read(first, Access::pixelShaderRead);
+		pass1.Write(second, Access::renderTarget);
+		RenderGraphPassBuilder pass2 = graph.AddPass("Pass2");
+		pass2.Read(second, Access::pixelShaderRead);
+		pass2.Write(third, Access::renderTarget);
+		RenderGraphPassBuilder pass3 = graph.AddPass("Pass3");
+		pass3.Read(third, Access::pixelShaderRead);
+		pass3.Read(otherGroup, Access::pixelShaderRead);
+		pass3.Write(backBuffer, Access::renderTarget);
+		CHECK(graph.Compile());
+
+		const RenderGraphPlacement& firstPlacement = graph.GetPlacement(first);
+		const RenderGraphPlacement& secondPlacement = graph.GetPlacement(second);
+		const RenderGraphPlacement& thirdPlacement = graph.GetPlacement(third);
+		CHECK(firstPlacement.firstPass == 0 && firstPlacement.lastPass == 1);
+		CHECK(firstPlacement.offset != secondPlacement.offset);
+		CHECK(thirdPlacement.offset == firstPlacement.offset);
+		CHECK(firstPlacement.offset % TEXTURE.alignment == 0 && secondPlacement.offset % TEXTURE.alignment == 0);
+		CHECK(graph.GetPlacement(otherGroup).heapGroup == 1);
+
+		const std::vector<uint64_t>& heapSizes = graph.GetHeapSizes();
+		CHECK(heapSizes.size() == 2);
+		CHECK(heapSizes.size() == 2 && heapSizes[0] == 2 * TEXTURE.size && heapSizes[1] == 512);
+		CHECK(graph.GetUnaliasedSize() == 3 * TEXTURE.size + 512);
+
+		// the aliasing barrier comes before the first transition of Third
+		const std::vector<RenderGraphBarrier> pass2Barriers = passBarriers(graph, pass2.GetPassIndex());
+		CHECK(!pass2Barriers.empty());
+		CHECK(!pass2Barriers.empty() && pass2Barriers[0].type == RenderGraphBarrierType::aliasing && pass2Barriers[0].resource == third && pass2Barriers[0].aliasedResource == first);
+		CHECK(std::count_if(pass2Barriers.begin(), pass2Barriers.end(), [&](const RenderGraphBarrier& barrier) { return isTransition(barrier, third, Access::none, Access::renderTarget); }) == 1);
+		// nothing used the memory of Second before
+		const std::vector<RenderGraphBarrier> pass1Barriers = passBarriers(graph, pass1.GetPassIndex());
+		CHECK(std::none_of(pass1Barriers.begin(), pass1Barriers.end(), [](const RenderGraphBarrier& barrier) { return barrier.type == RenderGraphBarrierType::aliasing; }));
+	}
+
+	// A compute pass that feeds a graphics pass: the graphics pass waits for it, a graphics state is released to the compute
+	// queue by its last graphics user
+	void TestComputeFeedsGraphics()
+	{
+		RenderGraph graph;
+		const RenderGraphResource backBuffer = graph.Import("BackBuffer", Access::present, Access::present);
+		const RenderGraphResource depth = graph.CreateTransient("Depth", TEXTURE);
+		const RenderGraphResource occlusion = graph.CreateTransient("Occlusion", TEXTURE);
+
+		RenderGraphPassBuilder depthPass = graph.AddPass("Depth");
+		depthPass.Write(depth, Access::depthWrite);
+		RenderGraphPassBuilder ssao = graph.AddPass("SSAO");
+		ssao.SetAsyncCompute();
+		ssao.Read(depth, Access::nonPixelShaderRead);
+		ssao.Write(occlusion, Access::unorderedAccess);
+		RenderGraphPassBuilder lighting = graph.AddPass("Lighting");
+		lighting.Read(occlusion, Access::pixelShaderRead);
+		lighting.Write(backBuffer, Access::renderTarget);
+		CHECK(graph.Compile());
+
+		CHECK(graph.GetCompiledPasses()[compiledIndex(graph, ssao.GetPassIndex())].queue == RenderGraphQueue::compute);
+		CHECK(waitForPass(graph, ssao.GetPassIndex()) == depthPass.GetPassIndex());
+		CHECK(waitForPass(graph, lighting.GetPassIndex()) == ssao.GetPassIndex());
+
+		// the compute queue can not leave depthWrite, the depth pass hands the depth buffer over
+		const std::vector<RenderGraphBarrier> release = passBarriers(graph, depthPass.GetPassIndex(), true);
+		CHECK(release.size() == 1 && isTransition(release[0], depth, Access::depthWrite, Access::nonPixelShaderRead));
+		const std::vector<RenderGraphBarrier> ssaoBarriers = passBarriers(graph, ssao.GetPassIndex());
+		CHECK(std::none_of(ssaoBarriers.begin(), ssaoBarriers.end(), [&](const RenderGraphBarrier& barrier) { return barrier.resource == depth; }));
+		// transients of the compute queue keep their memory for the whole frame
+		CHECK(graph.GetPlacement(depth).offset != graph.GetPlacement(occlusion).offset);
+		CHECK(graph.GetFinalWaitForPass() == RENDER_GRAPH_INVALID_INDEX); // Lighting waited for the last compute pass already
+
+		// graphics-only accesses on the compute queue
+		RenderGraph invalid;
+		const RenderGraphResource target = invalid.CreateTransient("Target", TEXTURE);
+		RenderGraphPassBuilder computePass = invalid.AddPass("Compute");
+		computePass.SetAsyncCompute();
+		computePass.Write(target, Access::renderTarget);
+		computePass.SetSideEffects();
+		CHECK(!invalid.Compile());
+	}
+
+	// A queue that waited for a later pass of the other queue does not wait for an earlier one again, concurrent reads in the
+	// same state need no wait at all
+	void TestRedundantWaits()
+	{
+		RenderGraph graph;
+		const RenderGraphResource backBuffer = graph.Import("BackBuffer", Access::present, Access::present);
+		const RenderGraphResource a = graph.CreateTransient("A", TEXTURE);
+		const RenderGraphResource b = graph.CreateTransient("B", TEXTURE);
+		const RenderGraphResource constants = graph.Import("Constants", Access::nonPixelShaderRead, Access::nonPixelShaderRead);
+
+		RenderGraphPassBuilder computeA = graph.AddPass("ComputeA");
+		computeA.SetAsyncCompute();
+		computeA.Write(a, Access::unorderedAccess);
+		computeA.Read(constants, Access::nonPixelShaderRead);
+		RenderGraphPassBuilder computeB = graph.AddPass("ComputeB");
+		computeB.SetAsyncCompute();
+		computeB.Write(b, Access::unorderedAccess);
+		RenderGraphPassBuilder useB = graph.AddPass("UseB");
+		useB.Read(b, Access::nonPixelShaderRead);
+		useB.Read(constants, Access::nonPixelShaderRead);
+		useB.Write(backBuffer, Access::renderTarget);
+		RenderGraphPassBuilder useA = graph.AddPass("UseA");
+		useA.Read(a, Access::nonPixelShaderRead);
+		useA.Write(backBuffer, Access::renderTarget);
+		CHECK(graph.Compile());
+
+		CHECK(waitForPass(graph, computeA.GetPassIndex()) == RENDER_GRAPH_INVALID_INDEX);
+		CHECK(waitForPass(graph, useB.GetPassIndex()) == computeB.GetPassIndex());
+		// ComputeA finished before ComputeB on the same queue
+		CHECK(waitForPass(graph, useA.GetPassIndex()) == RENDER_GRAPH_INVALID_INDEX);
+		CHECK(graph.GetFinalWaitForPass() == RENDER_GRAPH_INVALID_INDEX);
+	}
+
+	// Each queue runs its passes in order, a pass with a wait starts when the pass it waits for ended
+	void TestSimulate()
+	{
+		RenderGraph graph;
+		const RenderGraphResource backBuffer = graph.Import("BackBuffer", Access::present, Access::present);
+		const RenderGraphResource depth = graph.CreateTransient("Depth", TEXTURE);
+		const RenderGraphResource occlusion = graph.CreateTransient("Occlusion", TEXTURE);
+		const RenderGraphResource shadow = graph.CreateTransient("Shadow", TEXTURE);
+
+		RenderGraphPassBuilder depthPass = graph.AddPass("Depth");        // graphics 0-2
+		depthPass.Write(depth, Access::depthWrite);
+		RenderGraphPassBuilder ssao = graph.AddPass("SSAO");              // compute 2-5, after Depth
+		ssao.SetAsyncCompute();
+		ssao.Read(depth, Access::nonPixelShaderRead);
+		ssao.Write(occlusion, Access::unorderedAccess);
+		RenderGraphPassBuilder shadowPass = graph.AddPass("Shadow");      // graphics 2-6, overlaps SSAO
+		shadowPass.Write(shadow, Access::depthWrite);
+		RenderGraphPassBuilder lighting = graph.AddPass("Lighting");      // graphics 6-7, after SSAO and Shadow
+		lighting.Read(occlusion, Access::pixelShaderRead);
+		lighting.Read(shadow, Access::pixelShaderRead);
+		lighting.Write(backBuffer, Access::renderTarget);
+		CHECK(graph.Compile());
+
+		const std::vector<double> costs = { 2.0, 3.0, 4.0, 1.0 };
+		const RenderGraphSimulation simulation = graph.Simulate(costs);
+		const auto start = [&](const RenderGraphPassBuilder& pass) { return simulation.passStart[compiledIndex(graph, pass.GetPassIndex())]; };
+		const auto end = [&](const RenderGraphPassBuilder& pass) { return simulation.passEnd[compiledIndex(graph, pass.GetPassIndex())]; };
+		CHECK_NEAR(start(depthPass), 0.0, 1e-9);
+		CHECK_NEAR(start(ssao), 2.0, 1e-9);
+		CHECK_NEAR(end(ssao), 5.0, 1e-9);
+		CHECK_NEAR(start(shadowPass), 2.0, 1e-9);
+		CHECK_NEAR(start(lighting), 6.0, 1e-9);
+		CHECK_NEAR(simulation.graphicsTime, 7.0, 1e-9);
+		CHECK_NEAR(simulation.computeTime, 3.0, 1e-9);
+		CHECK_NEAR(simulation.frameTime, 7.0, 1e-9);
+		CHECK_NEAR(simulation.serialTime, 10.0, 1e-9);
+		CHECK_NEAR(simulation.overlapTime, 3.0, 1e-9);
+
+		// a long compute pass holds Lighting back
+		const RenderGraphSimulation slowCompute = graph.Simulate({ 2.0, 9.0, 4.0, 1.0 });
+		CHECK_NEAR(slowCompute.passStart[compiledIndex(graph, lighting.GetPassIndex())], 11.0, 1e-9);
+		CHECK_NEAR(slowCompute.frameTime, 12.0, 1e-9);
+		CHECK_NEAR(slowCompute.overlapTime, 4.0, 1e-9);
+	}
+}
+//=============================================================================
+int main()
+{
+	TestCulling();
+	TestMergedReadStates();
+	TestUnorderedAccessBarriers();
+	TestTransientAliasing();
+	TestComputeFeedsGraphics();
+	TestRedundantWaits();
+	TestSimulate();
+	return TestResult("RenderGraphTest");
+}
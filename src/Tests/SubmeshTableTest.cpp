@@ -0,0 +1,62 @@
+﻿#include "Test.h"
+#include "Engine/SubmeshTable.h"
+//=============================================================================
+namespace
+{
+	// Ids are the positions in the arrays, every array has one element per submesh
+	void TestTable()
+	{
+		SubmeshTable table;
+		table.Reserve(3);
+		const SubmeshId box = table.Add(36, 0, 0, glm::vec3(0.0f), glm::vec3(1.0f));
+		const SubmeshId sphere = table.Add(960, 36, 8, glm::vec3(3.0f, 0.0f, 0.0f), glm::vec3(0.5f));
+		const SubmeshId grid = table.Add(600, 996, -4, glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(10.0f, 0.0f, 10.0f));
+
+		CHECK(box.index == 0 && sphere.index == 1 && grid.index == 2);
+		CHECK(box.IsValid() && !SubmeshId{}.IsValid());
+		CHECK(table.GetCount() == 3);
+		CHECK(table.GetIndexCount(sphere) == 960);
+		CHECK(table.GetStartIndexLocation(sphere) == 36);
+		CHECK(table.GetBaseVertexLocation(grid) == -4);
+		CHECK(table.GetBoundsCenter(sphere) == glm::vec3(3.0f, 0.0f, 0.0f));
+		CHECK(table.GetBoundsExtents(grid) == glm::vec3(10.0f, 0.0f, 10.0f));
+
+		CHECK(table.GetIndexCounts().size() == 3 && table.GetStartIndexLocations().size() == 3 && table.GetBaseVertexLocations().size() == 3);
+		CHECK(table.GetBoundsCenters().size() == 3 && table.GetBoundsExtents().size() == 3);
+		uint32_t totalIndices = 0;
+		for (uint32_t indexCount : table.GetIndexCounts()) totalIndices += indexCount;
+		CHECK(totalIndices == 36 + 960 + 600);
+		CHECK(table.GetStartIndexLocations()[grid.index] == 996);
+
+		table.Clear();
+		CHECK(table.GetCount() == 0 && table.GetIndexCounts().empty());
+		CHECK(table.Add(3, 0, 0, glm::vec3(0.0f), glm::vec3(0.0f)).index == 0);
+	}
+
+	void TestNameIndex()
+	{
+		SubmeshNameIndex names;
+		CHECK(names.Add("box", SubmeshId{ 0 }));
+		CHECK(names.Add("sphere", SubmeshId{ 1 }));
+		CHECK(names.Find("sphere") == SubmeshId{ 1 });
+
+		// the lookup takes a view, no string is built for it
+		const std::string key = "box and more";
+		CHECK(names.Find(std::string_view(key).substr(0, 3)) == SubmeshId{ 0 });
+		CHECK(!names.Find("cone").IsValid());
+
+		// a taken name keeps its id
+		CHECK(!names.Add("box", SubmeshId{ 7 }));
+		CHECK(names.Find("box") == SubmeshId{ 0 });
+
+		names.Clear();
+		CHECK(!names.Find("box").IsValid());
+	}
+}
+//=============================================================================
+int main()
+{
+	TestTable();
+	TestNameIndex();
+	return TestResult("SubmeshTableTest");
+}
@@ -0,0 +1,28 @@
+﻿#pragma once
+
+// Checks of the tests in this directory. A failed check prints its location and the test goes on, the test executable returns
+// the number of failed checks. TestSupport.cpp is linked into every test, it routes the engine log to stdout.
+
+#include "Engine/BaseHeader.h"
+#include <cstdio>
+
+extern int testNumFailures;
+extern int testNumFatalErrors; // Fatal() calls, they end the application outside of the tests
+
+#define CHECK(expression) \
+	do \
+	{ \
+		if (!(expression)) \
+		{ \
+			printf("%s(%d): CHECK(%s) failed\n", __FILE__, __LINE__, #expression); \
+			testNumFailures++; \
+		} \
+	} while (0)
+
+#define CHECK_NEAR(value, expected, tolerance) CHECK(std::abs(static_cast<double>(value) - static_cast<double>(expected)) <= (tolerance))
+
+inline int TestResult(const char* name)
+{
+	printf("%s: %s\n", name, testNumFailures == 0 ? "passed" : "FAILED");
+	return testNumFailures;
+}
@@ -0,0 +1,23 @@
+﻿#include "Test.h"
+#include "Engine/LogSystem.h"
+//=============================================================================
+int testNumFailures = 0;
+int testNumFatalErrors = 0;
+//=============================================================================
+// EngineApp ends the application on Fatal(), a test checks the count instead
+void RequestExit()
+{
+	testNumFatalErrors++;
+}
+//=============================================================================
+namespace
+{
+	struct TestLogSystem final
+	{
+		TestLogSystem() { (void)logSystem.Create({}); }
+		~TestLogSystem() { logSystem.Destroy(); }
+
+		LogSystem logSystem;
+	} testLogSystem;
+}
+//=============================================================================
@@ -0,0 +1,160 @@
+﻿#include "Test.h"
+#include "Engine/VertexCompression.h"
+#include <random>
+//=============================================================================
+namespace
+{
+	// degrees between two unit vectors, from the chord so that it stays exact near 0
+	double angleDegrees(const glm::vec3& a, const glm::vec3& b)
+	{
+		const glm::dvec3 difference = glm::dvec3(glm::normalize(a)) - glm::dvec3(glm::normalize(b));
+		return glm::degrees(2.0 * std::asin(std::min(glm::length(difference) * 0.5, 1.0)));
+	}
+
+	// random directions plus the axes and the folds of the octahedron, where the encoding is the least regular
+	std::vector<glm::vec3> makeDirections(std::mt19937& random)
+	{
+		std::vector<glm::vec3> directions = {
+			{ 1.0f, 0.0f, 0.0f }, { -1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f },
+			{ 1.0f, 1.0f, 0.0f }, { -1.0f, 1.0f, 0.0f }, { 1.0f, 0.0f, -1.0f }, { 0.0f, -1.0f, -1.0f }, { 1.0f, 1.0f, 1.0f }, { -1.0f, -1.0f, -1.0f },
+			{ 0.3f, -0.2f, -1e-7f }, { 1e-7f, 1.0f, -1.0f } };
+		std::normal_distribution<float> gaussian;
+		for (uint32_t direction = 0; direction < 100000; direction++) directions.emplace_back(gaussian(random), gaussian(random), gaussian(random));
+		for (glm::vec3& direction : directions) direction = glm::normalize(direction);
+		return directions;
+	}
+
+	// Every axis is off by at most half a step, 1/131070 of the extent of the mesh
+	void TestPositions()
+	{
+		std::mt19937 random(1);
+		std::uniform_real_distribution<float> x(-250.0f, 1250.0f);
+		std::uniform_real_distribution<float> y(0.0f, 0.01f);
+		std::vector<glm::vec3> positions(10000);
+		for (glm::vec3& position : positions) position = { x(random), y(random), 42.0f }; // z is flat
+		positions[0].x = -250.0f;
+		positions[1].x = 1250.0f;
+
+		const PositionQuantization quantization = ComputePositionQuantization(&positions[0].x, static_cast<uint32_t>(positions.size()), sizeof(glm::vec3));
+		CHECK(quantization.offset.x == -250.0f && quantization.offset.z == 42.0f);
+		CHECK(quantization.scale.z > 0.0f);
+
+		glm::vec3 extent(0.0f);
+		for (const glm::vec3& position : positions) extent = glm::max(extent, position - quantization.offset);
+		glm::vec3 maxError(0.0f);
+		bool inRange = true;
+		for (const glm::vec3& position : positions)
+		{
+			const glm::uvec3 quantized = QuantizePosition(position, quantization);
+			inRange = inRange && glm::all(glm::lessThanEqual(quantized, glm::uvec3(65535)));
+			maxError = glm::max(maxError, glm::abs(DequantizePosition(quantized, quantization) - position));
+		}
+		CHECK(inRange);
+		// the float rounding of the decode adds a few ulps of the coordinates
+		CHECK(maxError.x <= extent.x / 131070.0f + 1250.0f * 1e-6f);
+		CHECK(maxError.y <= extent.y / 131070.0f + 1e-8f);
+		CHECK(maxError.z == 0.0f);
+		CHECK(QuantizePosition(positions[0], quantization).x == 0 && QuantizePosition(positions[1], quantization).x == 65535);
+	}
+
+	// Normals under 0.005 degrees, tangents under 0.01 degrees with their sign
+	void TestDirections()
+	{
+		std::mt19937 random(2);
+		const std::vector<glm::vec3> directions = makeDirections(random);
+		double maxNormalError = 0.0;
+		double maxTangentError = 0.0;
+		bool signsKept = true;
+		for (size_t direction = 0; direction < directions.size(); direction++)
+		{
+			maxNormalError = std::max(maxNormalError, angleDegrees(UnpackOctahedral(PackOctahedral(directions[direction])), directions[direction]));
+			const float sign = direction % 2 ? -1.0f : 1.0f;
+			const glm::vec4 tangent = UnpackTangent(PackTangent(glm::vec4(directions[direction], sign)));
+			maxTangentError = std::max(maxTangentError, angleDegrees(glm::vec3(tangent), directions[direction]));
+			signsKept = signsKept && tangent.w == sign;
+		}
+		CHECK(maxNormalError < 0.005);
+		CHECK(maxTangentError < 0.01);
+		CHECK(signsKept);
+
+		// the decode is unit length and the length of the input does not matter
+		CHECK_NEAR(glm::length(UnpackOctahedral(PackOctahedral(glm::vec3(0.2f, -0.3f, -0.9f)))), 1.0, 1e-6);
+		CHECK(PackOctahedral(glm::vec3(3.0f, 0.0f, 4.0f)) == PackOctahedral(glm::vec3(0.6f, 0.0f, 0.8f)));
+		// a zero normal of a degenerate vertex decodes to +z
+		CHECK(UnpackOctahedral(PackOctahedral(glm::vec3(0.0f))) == glm::vec3(0.0f, 0.0f, 1.0f));
+	}
+
+	// Uvs in [0, 1] within half a texel of a 2048 texture, colors within half a step of 8 bits
+	void TestUvsAndColors()
+	{
+		std::mt19937 random(3);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		float maxUvError = 0.0f;
+		float maxColorError = 0.0f;
+		for (uint32_t sample = 0; sample < 100000; sample++)
+		{
+			const glm::vec2 uv(unit(random), unit(random));
+			const glm::vec2 uvError = glm::abs(UnpackHalf2(PackHalf2(uv)) - uv);
+			maxUvError = std::max({ maxUvError, uvError.x, uvError.y });
+
+			const glm::vec4 color(unit(random), unit(random), unit(random), unit(random));
+			const glm::vec4 colorError = glm::abs(UnpackColor(PackColor(color)) - color);
+			maxColorError = std::max({ maxColorError, colorError.x, colorError.y, colorError.z, colorError.w });
+		}
+		CHECK(maxUvError <= 0.5f / 2048.0f);
+		CHECK(maxColorError <= 0.5f / 255.0f + 1e-6f);
+		CHECK(UnpackHalf2(PackHalf2(glm::vec2(0.0f, 1.0f))) == glm::vec2(0.0f, 1.0f));
+		CHECK(UnpackColor(PackColor(glm::vec4(0.0f, 1.0f, 0.0f, 1.0f))) == glm::vec4(0.0f, 1.0f, 0.0f, 1.0f));
+	}
+
+	// A whole mesh: the shader decodes offset + unorm16 * scale from the draw constants
+	void TestCompressMesh()
+	{
+		struct MeshVertex final
+		{
+			glm::vec3 position;
+			glm::vec3 normal;
+			glm::vec2 uv;
+		};
+		std::mt19937 random(4);
+		std::uniform_real_distribution<float> coordinate(-3.0f, 3.0f);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		std::vector<MeshVertex> vertices(1000);
+		for (MeshVertex& vertex : vertices)
+		{
+			vertex.position = { coordinate(random), coordinate(random), coordinate(random) };
+			vertex.normal = glm::normalize(vertex.position);
+			vertex.uv = { unit(random), unit(random) };
+		}
+
+		std::vector<CompressedMeshVertex> compressed(vertices.size());
+		const PositionQuantization quantization = CompressMeshVertices(vertices.data(), static_cast<uint32_t>(vertices.size()), sizeof(MeshVertex),
+			offsetof(MeshVertex, position), offsetof(MeshVertex, normal), offsetof(MeshVertex, uv), compressed.data());
+		const CompressedMeshConstants constants = MakeCompressedMeshConstants(glm::mat4(2.0f), quantization, 5, 9);
+		CHECK(constants.positionOffset == quantization.offset && constants.positionScale == quantization.scale);
+		CHECK(constants.vertexBufferIndex == 5 && constants.textureIndex == 9 && constants.worldMatrix == glm::mat4(2.0f));
+
+		const float maxPositionError = 6.0f / 131070.0f + 1e-6f;
+		bool withinBounds = true;
+		for (size_t vertex = 0; vertex < vertices.size(); vertex++)
+		{
+			const CompressedMeshVertex& packed = compressed[vertex];
+			withinBounds = withinBounds && (packed.positionZ >> 16) == 0;
+			const glm::vec3 quantized(float(packed.positionXY & 0xFFFF), float(packed.positionXY >> 16), float(packed.positionZ));
+			const glm::vec3 position = constants.positionOffset + quantized * constants.positionScale;
+			withinBounds = withinBounds && glm::all(glm::lessThanEqual(glm::abs(position - vertices[vertex].position), glm::vec3(maxPositionError)));
+			withinBounds = withinBounds && angleDegrees(UnpackOctahedral(packed.normal), vertices[vertex].normal) < 0.005;
+			withinBounds = withinBounds && glm::all(glm::lessThanEqual(glm::abs(UnpackHalf2(packed.uv) - vertices[vertex].uv), glm::vec2(0.5f / 2048.0f)));
+		}
+		CHECK(withinBounds);
+	}
+}
+//=============================================================================
+int main()
+{
+	TestPositions();
+	TestDirections();
+	TestUvsAndColors();
+	TestCompressMesh();
+	return TestResult("VertexCompressionTest");
+}